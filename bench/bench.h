@@ -0,0 +1,51 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+// Benchmarks are plain functions that print one line per measurement. They are
+// registered in main.c and run with `geobench [name...]`.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static double bench_seconds() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Random coordinate in [0, 1000]. Each benchmark seeds rand() itself.
+static double random_coord() { return (double)rand() / RAND_MAX * 1000; }
+
+static void bench_report(const char *name, const char *input, unsigned n,
+                         double seconds) {
+  printf("%-28s %-24s n=%-10u %10.3f ms %8.2f ns/elem\n", name, input, n,
+         seconds * 1e3, seconds * 1e9 / n);
+}
+
+void bench_sort();
+void bench_select();
+void bench_point_array();
+void bench_segment_array();
+void bench_spatial_hash();
+void bench_rtree();
+void bench_kd_tree();
+void bench_quadtree();
+void bench_trapezoidal_map();
+void bench_segment_intersection();
+void bench_segment_intersection_parallel();
+void bench_any_intersection();
+void bench_convex_hull();
+void bench_closest_pair();
+void bench_predicates();
+void bench_space_filling_curve();
+void bench_polygon();
+void bench_polygon_boolean();
+void bench_polyline_simplify();
+void bench_delaunay();
+void bench_voronoi();
+void bench_arrangement();
+void bench_polygon_triangulate();
+void bench_rotating_calipers();
+
+#endif
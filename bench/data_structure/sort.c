@@ -0,0 +1,93 @@
+#include "bench.h"
+#include "data_structure/sort.h"
+#include "data_structure/top_k.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const unsigned N = 1 << 20;
+
+// Fills data with 0..n-1 and then swaps `swaps` random pairs, so the fraction
+// of disorder is controlled by the number of swaps.
+static void fill_disordered(void **data, unsigned n, unsigned swaps) {
+  for (long i = 0; i < n; ++i) {
+    data[i] = (void *)i;
+  }
+  for (unsigned i = 0; i < swaps; ++i) {
+    unsigned a = rand() % n;
+    unsigned b = rand() % n;
+    void *t = data[a];
+    data[a] = data[b];
+    data[b] = t;
+  }
+}
+
+static void run(const char *name, sort_t sort, void **input, void **scratch,
+                unsigned n, const char *label) {
+  memcpy(scratch, input, sizeof(void *) * n);
+  double start = bench_seconds();
+  sort(scratch, n);
+  bench_report(name, label, n, bench_seconds() - start);
+}
+
+void bench_sort() {
+  void **input = malloc(sizeof(void *) * N);
+  void **scratch = malloc(sizeof(void *) * N);
+  static const unsigned DISORDER_PER_MILLE[] = {0, 1, 10, 100, 1000};
+  for (unsigned i = 0; i < sizeof(DISORDER_PER_MILLE) / sizeof(unsigned);
+       ++i) {
+    srand(i);
+    unsigned per_mille = DISORDER_PER_MILLE[i];
+    fill_disordered(input, N, (unsigned long)N * per_mille / 1000);
+    char label[32];
+    snprintf(label, sizeof(label), "swaps=%u/1000", per_mille);
+    run("merge_sort", merge_sort, input, scratch, N, label);
+    run("tim_sort", tim_sort, input, scratch, N, label);
+  }
+
+  // Sorted runs of length 1000, alternating ascending and descending
+  for (long i = 0; i < N; ++i) {
+    long run = i / 1000;
+    long offset = run % 2 ? 999 - i % 1000 : i % 1000;
+    input[i] = (void *)((offset << 20) + run);
+  }
+  run("merge_sort", merge_sort, input, scratch, N, "runs=1000");
+  run("tim_sort", tim_sort, input, scratch, N, "runs=1000");
+  free(scratch);
+  free(input);
+}
+
+// Selects the K smallest of N_SELECT random values with a full sort, partial
+// sort and the streaming top k accumulator.
+void bench_select() {
+  static const unsigned N_SELECT = 1 << 24;
+  static const unsigned K = 100;
+  void **input = malloc(sizeof(void *) * N_SELECT);
+  void **scratch = malloc(sizeof(void *) * N_SELECT);
+  srand(0);
+  for (unsigned i = 0; i < N_SELECT; ++i) {
+    input[i] = (void *)(long)rand();
+  }
+
+  run("tim_sort", tim_sort, input, scratch, N_SELECT, "k=100");
+
+  memcpy(scratch, input, sizeof(void *) * N_SELECT);
+  double start = bench_seconds();
+  nth_element(scratch, N_SELECT, K);
+  bench_report("nth_element", "k=100", N_SELECT, bench_seconds() - start);
+
+  memcpy(scratch, input, sizeof(void *) * N_SELECT);
+  start = bench_seconds();
+  partial_sort(scratch, N_SELECT, K);
+  bench_report("partial_sort", "k=100", N_SELECT, bench_seconds() - start);
+
+  start = bench_seconds();
+  TopK top;
+  top_k_init(&top, K);
+  top_k_push_all(&top, input, N_SELECT);
+  free(top_k_elements(&top));
+  top_k_free(&top);
+  bench_report("top_k", "k=100", N_SELECT, bench_seconds() - start);
+
+  free(scratch);
+  free(input);
+}
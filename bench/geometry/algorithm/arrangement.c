@@ -0,0 +1,60 @@
+#include "bench.h"
+#include "geometry/algorithm/arrangement.h"
+#include <math.h>
+#include <stdlib.h>
+
+static const unsigned N = 1 << 20;
+
+// A street grid with jittered intersections, each block edge its own segment
+// as in a road network, and short segments scattered at random, which cross
+// each other.
+void bench_arrangement() {
+  srand(0);
+  unsigned side = (unsigned)sqrt(N / 2);
+  Point *corners = malloc(sizeof(Point) * side * side);
+  for (unsigned i = 0; i < side * side; ++i) {
+    corners[i] = (Point){.x = i % side + (double)rand() / RAND_MAX * 0.4,
+                         .y = i / side + (double)rand() / RAND_MAX * 0.4};
+  }
+  Segment *segments = malloc(sizeof(Segment) * N);
+  unsigned n = 0;
+  for (unsigned y = 0; y < side; ++y) {
+    for (unsigned x = 0; x < side; ++x) {
+      Point p = corners[y * side + x];
+      if (x + 1 < side) {
+        segments[n++] = (Segment){p, corners[y * side + x + 1]};
+      }
+      if (y + 1 < side) {
+        segments[n++] = (Segment){p, corners[(y + 1) * side + x]};
+      }
+    }
+  }
+  free(corners);
+
+  Arrangement arr;
+  unsigned long faces = 0;
+  for (unsigned threads = 1; threads <= 4; threads *= 4) {
+    char input[32];
+    snprintf(input, sizeof(input), "streets, %u threads", threads);
+    double start = bench_seconds();
+    arrangement_build(segments, n, threads, &arr);
+    bench_report("arrangement_build", input, n, bench_seconds() - start);
+    faces += arr.num_faces;
+    arrangement_free(&arr);
+  }
+
+  double extent = 100 * sqrt(N);
+  for (unsigned i = 0; i < N; ++i) {
+    double x = (double)rand() / RAND_MAX * extent;
+    double y = (double)rand() / RAND_MAX * extent;
+    segments[i] = segment_from_coords(x, y, x + rand() % 200 - 100,
+                                      y + rand() % 200 - 100);
+  }
+  double start = bench_seconds();
+  arrangement_build(segments, N, 1, &arr);
+  bench_report("arrangement_build", "random", N, bench_seconds() - start);
+  faces += arr.num_faces;
+  arrangement_free(&arr);
+  printf("%lu faces\n", faces);
+  free(segments);
+}
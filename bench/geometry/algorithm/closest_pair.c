@@ -0,0 +1,37 @@
+#include "bench.h"
+#include "geometry/algorithm/closest_pair.h"
+#include <stdlib.h>
+
+static const unsigned N = 1 << 20;
+
+// Closest pair and all nearest neighbors of uniform points on 1 to 8 threads,
+// and the quadratic closest pair on a small prefix for scale.
+void bench_closest_pair() {
+  srand(0);
+  Point *points = malloc(sizeof(Point) * N);
+  for (unsigned i = 0; i < N; ++i) {
+    points[i] = (Point){.x = random_coord(), .y = random_coord()};
+  }
+  unsigned *nearest = malloc(sizeof(unsigned) * N);
+  unsigned a, b;
+
+  static const unsigned BRUTE_N = 1 << 14;
+  double start = bench_seconds();
+  closest_pair_brute_force(points, BRUTE_N, &a, &b);
+  bench_report("closest_pair_brute_force", "uniform", BRUTE_N,
+               bench_seconds() - start);
+
+  for (unsigned threads = 1; threads <= 8; threads *= 2) {
+    char input[32];
+    snprintf(input, sizeof(input), "uniform, %u threads", threads);
+    start = bench_seconds();
+    closest_pair_parallel(points, N, threads, &a, &b);
+    bench_report("closest_pair_parallel", input, N, bench_seconds() - start);
+    start = bench_seconds();
+    all_nearest_neighbors_parallel(points, N, threads, nearest);
+    bench_report("all_nearest_neighbors", input, N, bench_seconds() - start);
+  }
+  printf("closest pair %u %u\n", a, b);
+  free(nearest);
+  free(points);
+}
@@ -0,0 +1,79 @@
+#include "bench.h"
+#include "geometry/algorithm/convex_hull.h"
+#include <math.h>
+#include <stdlib.h>
+
+static const unsigned N = 1 << 20;
+
+static double random_unit() { return (double)rand() / RAND_MAX; }
+
+static void uniform(Point *points, unsigned n) {
+  for (unsigned i = 0; i < n; ++i) {
+    points[i] = (Point){.x = random_unit(), .y = random_unit()};
+  }
+}
+
+// Every point is on the hull
+static void circle(Point *points, unsigned n) {
+  for (unsigned i = 0; i < n; ++i) {
+    double angle = 2 * M_PI * random_unit();
+    points[i] = (Point){.x = cos(angle), .y = sin(angle)};
+  }
+}
+
+// Gaussian clusters around a few random centers
+static void clustered(Point *points, unsigned n) {
+  static const unsigned CLUSTERS = 16;
+  Point centers[CLUSTERS];
+  for (unsigned i = 0; i < CLUSTERS; ++i) {
+    centers[i] = (Point){.x = random_unit(), .y = random_unit()};
+  }
+  for (unsigned i = 0; i < n; ++i) {
+    Point c = centers[rand() % CLUSTERS];
+    // Box-Muller
+    double r = 0.02 * sqrt(-2 * log(random_unit() * 0.999999 + 1e-9));
+    double angle = 2 * M_PI * random_unit();
+    points[i] = (Point){.x = c.x + r * cos(angle), .y = c.y + r * sin(angle)};
+  }
+}
+
+static Point *hull_parallel4(const Point *points, unsigned n,
+                             unsigned *count) {
+  return convex_hull_parallel(points, n, 4, count);
+}
+
+void bench_convex_hull() {
+  static const struct {
+    const char *name;
+    void (*generate)(Point *, unsigned);
+  } INPUTS[] = {
+      {"uniform", uniform},
+      {"circle", circle},
+      {"clustered", clustered},
+  };
+  static const struct {
+    const char *name;
+    Point *(*hull)(const Point *, unsigned, unsigned *);
+  } HULLS[] = {
+      {"convex_hull", convex_hull},
+      {"convex_hull_monotone_chain", convex_hull_monotone_chain},
+      {"convex_hull_quickhull", convex_hull_quickhull},
+      {"convex_hull_parallel(4)", hull_parallel4},
+  };
+
+  Point *points = malloc(sizeof(Point) * N);
+  char input[32];
+  for (unsigned i = 0; i < sizeof(INPUTS) / sizeof(INPUTS[0]); ++i) {
+    srand(0);
+    INPUTS[i].generate(points, N);
+    for (unsigned j = 0; j < sizeof(HULLS) / sizeof(HULLS[0]); ++j) {
+      unsigned count;
+      double start = bench_seconds();
+      free(HULLS[j].hull(points, N, &count));
+      double seconds = bench_seconds() - start;
+      snprintf(input, sizeof(input), "%s h=%u", INPUTS[i].name, count);
+      bench_report(HULLS[j].name, input, N, seconds);
+    }
+  }
+  free(points);
+}
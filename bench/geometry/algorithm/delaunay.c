@@ -0,0 +1,38 @@
+#include "bench.h"
+#include "geometry/algorithm/delaunay.h"
+#include <stdlib.h>
+
+static const unsigned N = 1 << 20;
+
+// Delaunay triangulation of uniform points on 1 to 8 threads, and of points
+// on an integer grid, where most incircle tests are degenerate and need exact
+// arithmetic.
+void bench_delaunay() {
+  srand(0);
+  Point *points = malloc(sizeof(Point) * N);
+  for (unsigned i = 0; i < N; ++i) {
+    points[i] = (Point){.x = random_coord(), .y = random_coord()};
+  }
+  Triangulation tri;
+  unsigned long triangles = 0;
+  for (unsigned threads = 1; threads <= 8; threads *= 2) {
+    char input[32];
+    snprintf(input, sizeof(input), "uniform, %u threads", threads);
+    double start = bench_seconds();
+    delaunay_triangulate_parallel(points, N, threads, &tri);
+    bench_report("delaunay_triangulate", input, N, bench_seconds() - start);
+    triangles += tri.num_triangles;
+    triangulation_free(&tri);
+  }
+
+  for (unsigned i = 0; i < N; ++i) {
+    points[i] = (Point){.x = i % 1024, .y = i / 1024};
+  }
+  double start = bench_seconds();
+  delaunay_triangulate(points, N, &tri);
+  bench_report("delaunay_triangulate", "grid", N, bench_seconds() - start);
+  triangles += tri.num_triangles;
+  triangulation_free(&tri);
+  printf("%lu triangles\n", triangles);
+  free(points);
+}
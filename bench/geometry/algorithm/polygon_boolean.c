@@ -0,0 +1,117 @@
+#include "bench.h"
+#include "geometry/algorithm/polygon_boolean.h"
+#include <math.h>
+#include <stdlib.h>
+
+static const unsigned N = 1 << 17;
+static const unsigned LAYER_SIZE = 1024;
+static const unsigned LAYER_VERTICES = 64;
+
+static const char *const NAMES[] = {"intersection", "union", "difference",
+                                    "xor"};
+
+// A star shaped polygon around center with five lobes and a little noise on
+// each vertex, about as jagged as a traced outline, and a hole of the same
+// shape at half the size.
+static Polygon random_outline(Point center, double radius, unsigned n) {
+  Point *points = malloc(sizeof(Point) * n);
+  Polygon poly;
+  for (unsigned ring = 0; ring < 2; ++ring) {
+    double scale = ring == 0 ? radius : radius / 2;
+    for (unsigned i = 0; i < n; ++i) {
+      double angle = 2 * M_PI * i / n;
+      double noise = ((double)rand() / RAND_MAX - 0.5) * 2 / n;
+      double r = scale * (0.8 + 0.2 * sin(5 * angle) + noise);
+      points[i] = (Point){.x = center.x + r * cos(angle),
+                          .y = center.y + r * sin(angle)};
+    }
+    if (ring == 0) {
+      polygon_init(&poly, points, n);
+    } else {
+      polygon_add_hole(&poly, points, n);
+    }
+  }
+  free(points);
+  return poly;
+}
+
+// Each operation on two large overlapping outlines, on two layers of small
+// polygons, and clipping a large outline to a box and a hexagon.
+void bench_polygon_boolean() {
+  srand(0);
+  Polygon a = random_outline((Point){500, 500}, 500, N);
+  Polygon b = random_outline((Point){700, 600}, 500, N);
+  PolygonSet out;
+  polygon_set_init(&out);
+  unsigned long rings = 0;
+  for (unsigned op = 0; op < 4; ++op) {
+    polygon_set_clear(&out);
+    double start = bench_seconds();
+    polygon_boolean(&a, &b, op, &out);
+    bench_report("polygon_boolean", NAMES[op], a.num_points + b.num_points,
+                 bench_seconds() - start);
+    rings += out.num_rings;
+  }
+
+  PolygonSet layer_a, layer_b;
+  polygon_set_init(&layer_a);
+  polygon_set_init(&layer_b);
+  for (unsigned i = 0; i < LAYER_SIZE; ++i) {
+    // A grid of cells, so the polygons of a layer do not overlap
+    Point center = {.x = (i % 32) * 30 + 15, .y = (i / 32) * 30 + 15};
+    Polygon poly = random_outline(center, 15, LAYER_VERTICES);
+    polygon_set_add_polygon(&layer_a, &poly);
+    polygon_free(&poly);
+    center.x += 10;
+    center.y += 5;
+    poly = random_outline(center, 15, LAYER_VERTICES);
+    polygon_set_add_polygon(&layer_b, &poly);
+    polygon_free(&poly);
+  }
+  for (unsigned op = 0; op < 4; ++op) {
+    polygon_set_clear(&out);
+    double start = bench_seconds();
+    polygon_set_boolean(&layer_a, &layer_b, op, &out);
+    char input[32];
+    snprintf(input, sizeof(input), "layers, %s", NAMES[op]);
+    bench_report("polygon_set_boolean", input,
+                 layer_a.num_points + layer_b.num_points,
+                 bench_seconds() - start);
+    rings += out.num_rings;
+  }
+
+  BBox box = {.min_x = 200, .min_y = 300, .max_x = 700, .max_y = 650};
+  Polygon window;
+  Point corners[] = {{200, 300}, {700, 300}, {700, 650}, {200, 650}};
+  polygon_init(&window, corners, 4);
+  polygon_set_clear(&out);
+  double start = bench_seconds();
+  polygon_boolean(&a, &window, POLYGON_INTERSECTION, &out);
+  bench_report("polygon_boolean", "box window", a.num_points,
+               bench_seconds() - start);
+  polygon_set_clear(&out);
+  start = bench_seconds();
+  polygon_clip_bbox(&a, box, &out);
+  bench_report("polygon_clip_bbox", "box window", a.num_points,
+               bench_seconds() - start);
+
+  Point hexagon[6];
+  for (unsigned i = 0; i < 6; ++i) {
+    hexagon[i] = (Point){.x = 450 + 300 * cos(M_PI * i / 3),
+                         .y = 500 + 300 * sin(M_PI * i / 3)};
+  }
+  polygon_set_clear(&out);
+  start = bench_seconds();
+  polygon_clip_convex(&a, hexagon, 6, &out);
+  bench_report("polygon_clip_convex", "hexagon window", a.num_points,
+               bench_seconds() - start);
+  rings += out.num_rings;
+  printf("%lu rings\n", rings);
+
+  polygon_free(&window);
+  polygon_set_free(&layer_a);
+  polygon_set_free(&layer_b);
+  polygon_set_free(&out);
+  polygon_free(&a);
+  polygon_free(&b);
+}
@@ -0,0 +1,71 @@
+#include "bench.h"
+#include "geometry/algorithm/polygon_triangulate.h"
+#include <math.h>
+#include <stdlib.h>
+
+static const unsigned N = 1 << 20;
+static const unsigned SET_SIZE = 1 << 15;
+
+static const char *const NAMES[] = {"auto", "monotone", "ear clipping"};
+
+// A ring around center with five lobes and a little noise on each vertex,
+// about as jagged as a traced outline.
+static void outline(Point *points, unsigned n, Point center, double radius) {
+  for (unsigned i = 0; i < n; ++i) {
+    double angle = 2 * M_PI * i / n;
+    double noise = ((double)rand() / RAND_MAX - 0.5) * 2 / n;
+    double r = radius * (0.8 + 0.2 * sin(5 * angle) + noise);
+    points[i] = (Point){.x = center.x + r * cos(angle),
+                        .y = center.y + r * sin(angle)};
+  }
+}
+
+// One large outline with a hole, then a set of small outlines of 8 to 64
+// points, like building footprints, on 1 and 4 threads.
+void bench_polygon_triangulate() {
+  srand(0);
+  Point *points = malloc(sizeof(Point) * N);
+  outline(points, N, (Point){0, 0}, 1000);
+  Polygon poly;
+  polygon_init(&poly, points, N);
+  outline(points, N / 4, (Point){0, 0}, 300);
+  polygon_add_hole(&poly, points, N / 4);
+  unsigned *triangles =
+      malloc(sizeof(unsigned) * 3 * polygon_triangle_count(&poly));
+  unsigned long sink = 0;
+  for (TriangulateMethod method = TRIANGULATE_MONOTONE;
+       method <= TRIANGULATE_EAR_CLIPPING; ++method) {
+    double start = bench_seconds();
+    sink += polygon_triangulate(&poly, method, triangles);
+    bench_report("polygon_triangulate", NAMES[method], poly.num_points,
+                 bench_seconds() - start);
+  }
+  free(triangles);
+  polygon_free(&poly);
+
+  PolygonSet set;
+  polygon_set_init(&set);
+  for (unsigned i = 0; i < SET_SIZE; ++i) {
+    unsigned n = 8 + rand() % 57;
+    outline(points, n, (Point){i % 256 * 10.0, i / 256 * 10.0}, 4);
+    polygon_set_add_ring(&set, points, n, false);
+  }
+  free(points);
+  for (TriangulateMethod method = TRIANGULATE_AUTO;
+       method <= TRIANGULATE_EAR_CLIPPING; ++method) {
+    for (unsigned threads = 1; threads <= 4; threads *= 4) {
+      char input[32];
+      snprintf(input, sizeof(input), "set, %s, %u threads", NAMES[method],
+               threads);
+      PolygonTriangles out;
+      double start = bench_seconds();
+      polygon_set_triangulate(&set, method, threads, &out);
+      bench_report("polygon_set_triangulate", input, set.num_points,
+                   bench_seconds() - start);
+      sink += out.num_triangles;
+      polygon_triangles_free(&out);
+    }
+  }
+  polygon_set_free(&set);
+  printf("%lu triangles\n", sink);
+}
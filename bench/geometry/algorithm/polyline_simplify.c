@@ -0,0 +1,53 @@
+#include "bench.h"
+#include "geometry/algorithm/polyline_simplify.h"
+#include <stdlib.h>
+
+static const unsigned NUM_LINES = 1 << 14;
+static const unsigned LINE_SIZE = 128;
+
+static double random_step() { return (double)rand() / RAND_MAX * 2 - 1; }
+
+// Many random walks, as a tile of map features would have, simplified by each
+// method on one and four threads.
+void bench_polyline_simplify() {
+  srand(0);
+  PolylineSet lines;
+  polyline_set_init(&lines);
+  Point *points = malloc(sizeof(Point) * LINE_SIZE);
+  for (unsigned i = 0; i < NUM_LINES; ++i) {
+    Point p = {0, 0};
+    for (unsigned j = 0; j < LINE_SIZE; ++j) {
+      p.x += random_step();
+      p.y += random_step();
+      points[j] = p;
+    }
+    polyline_set_add(&lines, points, LINE_SIZE);
+  }
+  free(points);
+
+  static const struct {
+    const char *name;
+    SimplifyOptions options;
+  } RUNS[] = {
+      {"douglas_peucker", {SIMPLIFY_DOUGLAS_PEUCKER, 1, false}},
+      {"visvalingam", {SIMPLIFY_VISVALINGAM_WHYATT, 1, false}},
+      {"visvalingam_topology", {SIMPLIFY_VISVALINGAM_WHYATT, 1, true}},
+  };
+  PolylineSet out;
+  polyline_set_init(&out);
+  unsigned long kept = 0;
+  for (unsigned r = 0; r < sizeof(RUNS) / sizeof(RUNS[0]); ++r) {
+    for (unsigned threads = 1; threads <= 4; threads *= 4) {
+      char input[32];
+      snprintf(input, sizeof(input), "%u threads", threads);
+      double start = bench_seconds();
+      polyline_set_simplify(&lines, RUNS[r].options, threads, &out);
+      bench_report(RUNS[r].name, input, lines.num_points,
+                   bench_seconds() - start);
+      kept += out.num_points;
+    }
+  }
+  printf("%lu points kept\n", kept);
+  polyline_set_free(&out);
+  polyline_set_free(&lines);
+}
@@ -0,0 +1,84 @@
+#include "bench.h"
+#include "geometry/algorithm/convex_hull.h"
+#include "geometry/algorithm/rotating_calipers.h"
+#include <math.h>
+#include <stdlib.h>
+
+static const unsigned NUM_FOOTPRINTS = 1 << 16;
+static const unsigned FOOTPRINT_POINTS = 64;
+static const unsigned N = 1 << 22;
+
+// Footprints of many small objects, each a jittered ring of points around a
+// random center and orientation, reusing one scratch buffer throughout.
+void bench_rotating_calipers() {
+  srand(0);
+  unsigned n = NUM_FOOTPRINTS * FOOTPRINT_POINTS;
+  Point *points = malloc(sizeof(Point) * N);
+  for (unsigned f = 0; f < NUM_FOOTPRINTS; ++f) {
+    double cx = (double)rand() / RAND_MAX * 1e5;
+    double cy = (double)rand() / RAND_MAX * 1e5;
+    double angle = (double)rand() / RAND_MAX * M_PI;
+    double stretch = 1 + (double)rand() / RAND_MAX * 3;
+    for (unsigned i = 0; i < FOOTPRINT_POINTS; ++i) {
+      double t = 2 * M_PI * i / FOOTPRINT_POINTS;
+      double x = 10 * stretch * cos(t) + (double)rand() / RAND_MAX;
+      double y = 10 * sin(t) + (double)rand() / RAND_MAX;
+      points[f * FOOTPRINT_POINTS + i] =
+          (Point){cx + x * cos(angle) - y * sin(angle),
+                  cy + x * sin(angle) + y * cos(angle)};
+    }
+  }
+  Point *scratch = malloc(sizeof(Point) * convex_hull_scratch_size(N));
+
+  double sink = 0;
+  double start = bench_seconds();
+  for (unsigned f = 0; f < NUM_FOOTPRINTS; ++f) {
+    OrientedBox box;
+    min_area_box(points + f * FOOTPRINT_POINTS, FOOTPRINT_POINTS, scratch,
+                 &box);
+    sink += box.length * box.width;
+  }
+  bench_report("min_area_box", "64 point footprints", n,
+               bench_seconds() - start);
+
+  start = bench_seconds();
+  for (unsigned f = 0; f < NUM_FOOTPRINTS; ++f) {
+    unsigned a, b;
+    farthest_pair(points + f * FOOTPRINT_POINTS, FOOTPRINT_POINTS, scratch, &a,
+                  &b);
+    sink += a + b;
+  }
+  bench_report("farthest_pair", "64 point footprints", n,
+               bench_seconds() - start);
+
+  start = bench_seconds();
+  for (unsigned f = 0; f < NUM_FOOTPRINTS; ++f) {
+    Circle circle;
+    min_enclosing_circle(points + f * FOOTPRINT_POINTS, FOOTPRINT_POINTS,
+                         scratch, &circle);
+    sink += circle.radius;
+  }
+  bench_report("min_enclosing_circle", "64 point footprints", n,
+               bench_seconds() - start);
+
+  // One large set, where the hull dominates
+  for (unsigned i = 0; i < N; ++i) {
+    double angle = (double)rand() / RAND_MAX * 2 * M_PI;
+    double r = sqrt((double)rand() / RAND_MAX) * 1e4;
+    points[i] = (Point){r * cos(angle), r * sin(angle)};
+  }
+  start = bench_seconds();
+  OrientedBox box;
+  min_area_box(points, N, scratch, &box);
+  bench_report("min_area_box", "uniform disk", N, bench_seconds() - start);
+  sink += box.length * box.width;
+  start = bench_seconds();
+  Circle circle;
+  min_enclosing_circle(points, N, scratch, &circle);
+  bench_report("min_enclosing_circle", "uniform disk", N,
+               bench_seconds() - start);
+  sink += circle.radius;
+  printf("%g sink\n", sink);
+  free(scratch);
+  free(points);
+}
@@ -0,0 +1,107 @@
+#include "bench.h"
+#include "geometry/algorithm/segment_intersection.h"
+#include <math.h>
+#include <stdlib.h>
+
+// Short segments scattered over a large square, so the number of intersecting
+// pairs grows roughly linearly with n.
+static Segment random_segment(unsigned n) {
+  double side = 100 * sqrt(n);
+  double x = (double)rand() / RAND_MAX * side;
+  double y = (double)rand() / RAND_MAX * side;
+  return segment_from_coords(x, y, x + rand() % 200 - 100,
+                             y + rand() % 200 - 100);
+}
+
+// Compares the sweep against testing all pairs. The brute force version is
+// skipped once it would take too long.
+void bench_segment_intersection() {
+  static const unsigned SIZES[] = {1 << 10, 1 << 13, 1 << 16, 1 << 18};
+  static const unsigned BRUTE_FORCE_LIMIT = 1 << 13;
+  char input[32];
+  for (unsigned i = 0; i < sizeof(SIZES) / sizeof(SIZES[0]); ++i) {
+    unsigned n = SIZES[i];
+    srand(0);
+    Segment *segments = malloc(sizeof(Segment) * n);
+    for (unsigned j = 0; j < n; ++j) {
+      segments[j] = random_segment(n);
+    }
+
+    unsigned count;
+    double start = bench_seconds();
+    free(segment_intersections(segments, n, &count));
+    snprintf(input, sizeof(input), "k=%u", count);
+    bench_report("segment_intersections", input, n, bench_seconds() - start);
+
+    if (n <= BRUTE_FORCE_LIMIT) {
+      start = bench_seconds();
+      free(segment_intersections_brute_force(segments, n, &count));
+      bench_report("brute_force", input, n, bench_seconds() - start);
+    }
+    free(segments);
+  }
+}
+
+// Thread scaling of the strip partitioned sweep, from 1 to 64 threads.
+void bench_segment_intersection_parallel() {
+  static const unsigned N = 1 << 18;
+  srand(0);
+  Segment *segments = malloc(sizeof(Segment) * N);
+  for (unsigned j = 0; j < N; ++j) {
+    segments[j] = random_segment(N);
+  }
+  char input[32];
+  for (unsigned threads = 1; threads <= 64; threads *= 2) {
+    unsigned count;
+    double start = bench_seconds();
+    free(segment_intersections_parallel(segments, N, threads, &count));
+    double seconds = bench_seconds() - start;
+    snprintf(input, sizeof(input), "threads=%u k=%u", threads, count);
+    bench_report("segment_intersections_parallel", input, N, seconds);
+  }
+  free(segments);
+}
+
+// Edges of a star shaped polygon with n vertices. The polygon is simple, unless
+// two vertices are swapped, which makes it self-intersecting near the
+// leftmost vertex.
+static Segment *star_polygon(unsigned n, bool swap_vertices) {
+  Point *points = malloc(sizeof(Point) * n);
+  for (unsigned i = 0; i < n; ++i) {
+    double angle = 2 * M_PI * i / n;
+    double radius = 1e6 * (1 + (double)rand() / RAND_MAX);
+    points[i] = (Point){.x = radius * cos(angle), .y = radius * sin(angle)};
+  }
+  if (swap_vertices) {
+    Point p = points[n / 2];
+    points[n / 2] = points[n / 2 + n / 16];
+    points[n / 2 + n / 16] = p;
+  }
+  Segment *edges = malloc(sizeof(Segment) * n);
+  for (unsigned i = 0; i < n; ++i) {
+    Point p0 = points[i];
+    Point p1 = points[(i + 1) % n];
+    edges[i] = segment_from_coords(p0.x, p0.y, p1.x, p1.y);
+  }
+  free(points);
+  return edges;
+}
+
+// Polygon simplicity checks. A simple polygon has to be swept to the end,
+// while a self-intersecting one can stop early.
+void bench_any_intersection() {
+  static const unsigned SIZES[] = {1 << 10, 1 << 16, 1 << 20};
+  for (unsigned i = 0; i < sizeof(SIZES) / sizeof(SIZES[0]); ++i) {
+    unsigned n = SIZES[i];
+    for (unsigned swap_vertices = 0; swap_vertices < 2; ++swap_vertices) {
+      srand(0);
+      Segment *edges = star_polygon(n, swap_vertices);
+      double start = bench_seconds();
+      bool found = segments_any_intersection(edges, n, true, NULL);
+      bench_report("segments_any_intersection",
+                   found ? "star, intersecting" : "star, simple", n,
+                   bench_seconds() - start);
+      free(edges);
+    }
+  }
+}
@@ -0,0 +1,34 @@
+#include "bench.h"
+#include "geometry/algorithm/voronoi.h"
+#include <stdlib.h>
+
+static const unsigned N = 1 << 20;
+
+// Voronoi diagrams of uniform sites and of sites on an integer grid, where
+// most circle events are shared by four sites.
+void bench_voronoi() {
+  srand(0);
+  Point *sites = malloc(sizeof(Point) * N);
+  for (unsigned i = 0; i < N; ++i) {
+    sites[i] = (Point){.x = random_coord(), .y = random_coord()};
+  }
+  BBox box = {.min_x = 0, .min_y = 0, .max_x = 1000, .max_y = 1000};
+  VoronoiDiagram diagram;
+  double start = bench_seconds();
+  voronoi_diagram(sites, N, box, &diagram);
+  bench_report("voronoi_diagram", "uniform", N, bench_seconds() - start);
+  unsigned long edges = diagram.num_edges;
+  voronoi_diagram_free(&diagram);
+
+  for (unsigned i = 0; i < N; ++i) {
+    sites[i] = (Point){.x = i % 1024, .y = i / 1024};
+  }
+  box = (BBox){.min_x = 0, .min_y = 0, .max_x = 1023, .max_y = 1023};
+  start = bench_seconds();
+  voronoi_diagram(sites, N, box, &diagram);
+  bench_report("voronoi_diagram", "grid", N, bench_seconds() - start);
+  edges += diagram.num_edges;
+  voronoi_diagram_free(&diagram);
+  printf("%lu half-edges\n", edges);
+  free(sites);
+}
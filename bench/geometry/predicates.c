@@ -0,0 +1,56 @@
+#include "bench.h"
+#include "geometry/predicates.h"
+#include <stdlib.h>
+
+static const unsigned N = 1 << 20;
+
+static double naive_orient2d(Point a, Point b, Point c) {
+  return (a.x - c.x) * (b.y - c.y) - (a.y - c.y) * (b.x - c.x);
+}
+
+// orient2d and incircle on random triples, which the filter resolves, and on
+// nearly collinear triples, which need the exact stages, with the plain
+// determinant for scale.
+void bench_predicates() {
+  srand(0);
+  Point *points = malloc(sizeof(Point) * (N + 3));
+  Point *collinear = malloc(sizeof(Point) * (N + 2));
+  for (unsigned i = 0; i < N + 3; ++i) {
+    points[i] = (Point){.x = random_coord(), .y = random_coord()};
+  }
+  for (unsigned i = 0; i < N + 2; ++i) {
+    double t = (double)rand() / RAND_MAX;
+    collinear[i] = (Point){.x = 0.5 + t * 24, .y = 0.5 + t * 24};
+  }
+
+  double sum = 0;
+  double start = bench_seconds();
+  for (unsigned i = 0; i < N; ++i) {
+    sum += naive_orient2d(points[i], points[i + 1], points[i + 2]) > 0;
+  }
+  bench_report("naive orient2d", "random", N, bench_seconds() - start);
+  start = bench_seconds();
+  for (unsigned i = 0; i < N; ++i) {
+    sum += orient2d(points[i], points[i + 1], points[i + 2]) > 0;
+  }
+  bench_report("orient2d", "random", N, bench_seconds() - start);
+  start = bench_seconds();
+  for (unsigned i = 0; i < N; ++i) {
+    sum += orient2d(collinear[i], collinear[i + 1], collinear[i + 2]) > 0;
+  }
+  bench_report("orient2d", "nearly collinear", N, bench_seconds() - start);
+  start = bench_seconds();
+  for (unsigned i = 0; i < N; ++i) {
+    sum += incircle(points[i], points[i + 1], points[i + 2], points[i + 3]) > 0;
+  }
+  bench_report("incircle", "random", N, bench_seconds() - start);
+  start = bench_seconds();
+  for (unsigned i = 0; i < N; ++i) {
+    Point d = {.x = collinear[i].x, .y = collinear[i].y};
+    sum += incircle(collinear[i], collinear[i + 1], points[i], d) > 0;
+  }
+  bench_report("incircle", "cocircular", N, bench_seconds() - start);
+  printf("(%.0f positive)\n", sum);
+  free(collinear);
+  free(points);
+}
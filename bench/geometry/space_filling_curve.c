@@ -0,0 +1,52 @@
+#include "bench.h"
+#include "geometry/simd.h"
+#include "geometry/space_filling_curve.h"
+#include <stdlib.h>
+
+static const unsigned N = 1 << 22;
+
+// Morton and Hilbert keys of N random points through the tables and, where
+// the CPU has it, BMI2, then the full spatial_sort.
+void bench_space_filling_curve() {
+  srand(0);
+  Point *points = malloc(sizeof(Point) * N);
+  for (unsigned i = 0; i < N; ++i) {
+    points[i] = (Point){.x = random_coord(), .y = random_coord()};
+  }
+  uint64_t *keys = malloc(sizeof(uint64_t) * N);
+  unsigned *order = malloc(sizeof(unsigned) * N);
+  CurveGrid grid;
+  curve_grid_init(&grid, bbox_from_corners((Point){0, 0}, (Point){1000, 1000}),
+                  curve_grid_bits(N));
+
+  uint64_t sink = 0;
+  const char *curve_names[] = {"morton keys", "hilbert keys"};
+  for (SpaceFillingCurve curve = CURVE_MORTON; curve <= CURVE_HILBERT;
+       ++curve) {
+    simd_set_level(SIMD_SCALAR);
+    double start = bench_seconds();
+    curve_grid_keys(&grid, curve, points, N, keys);
+    bench_report(curve_names[curve], "tables", N, bench_seconds() - start);
+    sink += keys[N / 2];
+    simd_set_level(simd_supported_level());
+    start = bench_seconds();
+    curve_grid_keys(&grid, curve, points, N, keys);
+    bench_report(curve_names[curve],
+                 simd_supported_level() > SIMD_SCALAR ? "bmi2" : "tables", N,
+                 bench_seconds() - start);
+    sink += keys[N / 2];
+  }
+
+  double start = bench_seconds();
+  spatial_sort(points, N, CURVE_MORTON, order, 1);
+  bench_report("spatial_sort", "morton", N, bench_seconds() - start);
+  sink += order[N / 2];
+  start = bench_seconds();
+  spatial_sort(points, N, CURVE_HILBERT, order, 1);
+  bench_report("spatial_sort", "hilbert", N, bench_seconds() - start);
+  sink += order[N / 2];
+  printf("(sink %llu)\n", (unsigned long long)sink);
+  free(order);
+  free(keys);
+  free(points);
+}
@@ -0,0 +1,70 @@
+#include "bench.h"
+#include "geometry/structure/kd_tree.h"
+#include <stdlib.h>
+
+static const unsigned N = 1 << 20;
+static const unsigned QUERIES = 1 << 16;
+static const unsigned K = 8;
+
+static void count_id(unsigned id, void *data) { ++*(unsigned long *)data; }
+
+// Building over uniform points, then nearest queries on 1 to 8 threads against
+// a linear scan, and radius queries.
+void bench_kd_tree() {
+  srand(0);
+  Point *points = malloc(sizeof(Point) * N);
+  for (unsigned i = 0; i < N; ++i) {
+    points[i] = (Point){.x = random_coord(), .y = random_coord()};
+  }
+  Point *queries = malloc(sizeof(Point) * QUERIES);
+  for (unsigned i = 0; i < QUERIES; ++i) {
+    queries[i] = (Point){.x = random_coord(), .y = random_coord()};
+  }
+
+  KDTree tree;
+  double start = bench_seconds();
+  kd_tree_init(&tree, points, N);
+  bench_report("kd_tree_init", "uniform", N, bench_seconds() - start);
+
+  unsigned *ids = malloc(sizeof(unsigned) * QUERIES * K);
+  unsigned *counts = malloc(sizeof(unsigned) * QUERIES);
+  for (unsigned threads = 1; threads <= 8; threads *= 2) {
+    char input[32];
+    snprintf(input, sizeof(input), "k=%u, %u threads", K, threads);
+    start = bench_seconds();
+    kd_tree_nearest_batch(&tree, queries, QUERIES, K, ids, counts, threads);
+    bench_report("kd_tree_nearest_batch", input, QUERIES,
+                 bench_seconds() - start);
+  }
+
+  static const unsigned SCAN_QUERIES = 64;
+  unsigned long nearest = 0;
+  start = bench_seconds();
+  for (unsigned q = 0; q < SCAN_QUERIES; ++q) {
+    double best = INFINITY;
+    for (unsigned i = 0; i < N; ++i) {
+      double dx = points[i].x - queries[q].x;
+      double dy = points[i].y - queries[q].y;
+      if (dx * dx + dy * dy < best) {
+        best = dx * dx + dy * dy;
+        nearest = i;
+      }
+    }
+  }
+  bench_report("linear scan", "k=1", SCAN_QUERIES, bench_seconds() - start);
+
+  unsigned long found = 0;
+  start = bench_seconds();
+  for (unsigned q = 0; q < QUERIES; ++q) {
+    kd_tree_query_radius(&tree, queries[q], 2, count_id, &found);
+  }
+  bench_report("kd_tree_query_radius", "r=2", QUERIES,
+               bench_seconds() - start);
+  printf("found %lu in radius, last nearest %lu\n", found, nearest);
+
+  kd_tree_free(&tree);
+  free(counts);
+  free(ids);
+  free(queries);
+  free(points);
+}
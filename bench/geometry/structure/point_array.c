@@ -0,0 +1,71 @@
+#include "bench.h"
+#include "geometry/simd.h"
+#include "geometry/structure/point_array.h"
+#include <stdlib.h>
+
+static const unsigned N = 1 << 22;
+static const unsigned REPEAT = 10;
+
+static const char *LEVEL_NAMES[] = {"scalar", "avx2", "avx512"};
+
+// One-to-many distances over N points, comparing a loop over point_distance
+// with the PointArray kernels at each SIMD level.
+void bench_point_array() {
+  srand(0);
+  Point *points = malloc(sizeof(Point) * N);
+  for (unsigned i = 0; i < N; ++i) {
+    points[i] = (Point){.x = rand() % 10000, .y = rand() % 10000};
+  }
+  PointArray arr;
+  point_array_from_points(&arr, points, N);
+  double *out = malloc(sizeof(double) * N);
+  Point query = {.x = 5000, .y = 5000};
+
+  double start = bench_seconds();
+  for (unsigned r = 0; r < REPEAT; ++r) {
+    for (unsigned i = 0; i < N; ++i) {
+      out[i] = point_distance(points[i], query);
+    }
+  }
+  bench_report("point_distance loop", "distance", N,
+               (bench_seconds() - start) / REPEAT);
+
+  for (SimdLevel level = SIMD_SCALAR; level <= simd_supported_level();
+       ++level) {
+    simd_set_level(level);
+    start = bench_seconds();
+    for (unsigned r = 0; r < REPEAT; ++r) {
+      point_array_distances(&arr, query, out);
+    }
+    bench_report("point_array_distances", LEVEL_NAMES[level], N,
+                 (bench_seconds() - start) / REPEAT);
+
+    start = bench_seconds();
+    for (unsigned r = 0; r < REPEAT; ++r) {
+      point_array_squared_distances(&arr, query, out);
+    }
+    bench_report("point_array_squared", LEVEL_NAMES[level], N,
+                 (bench_seconds() - start) / REPEAT);
+
+    Point min;
+    Point max;
+    start = bench_seconds();
+    for (unsigned r = 0; r < REPEAT; ++r) {
+      point_array_bounds(&arr, &min, &max);
+    }
+    bench_report("point_array_bounds", LEVEL_NAMES[level], N,
+                 (bench_seconds() - start) / REPEAT);
+
+    start = bench_seconds();
+    for (unsigned r = 0; r < REPEAT; ++r) {
+      point_array_centroid(&arr);
+    }
+    bench_report("point_array_centroid", LEVEL_NAMES[level], N,
+                 (bench_seconds() - start) / REPEAT);
+  }
+  simd_set_level(simd_supported_level());
+
+  free(out);
+  point_array_free(&arr);
+  free(points);
+}
@@ -0,0 +1,111 @@
+#include "bench.h"
+#include "geometry/structure/polygon.h"
+#include <limits.h>
+#include <math.h>
+#include <stdlib.h>
+
+static const unsigned STAR_VERTICES = 1 << 16;
+static const unsigned NUM_POLYGONS = 4096;
+static const unsigned POLYGON_VERTICES = 32;
+static const unsigned N = 1 << 20;
+
+// A star shaped polygon around center with five lobes and a little noise on
+// each vertex, about as jagged as a traced outline.
+static Polygon random_star(Point center, double radius, unsigned n) {
+  Point *points = malloc(sizeof(Point) * n);
+  for (unsigned i = 0; i < n; ++i) {
+    double angle = 2 * M_PI * i / n;
+    double noise = ((double)rand() / RAND_MAX - 0.5) * 2 / n;
+    double r = radius * (0.8 + 0.2 * sin(5 * angle) + noise);
+    points[i] = (Point){.x = center.x + r * cos(angle),
+                        .y = center.y + r * sin(angle)};
+  }
+  Polygon poly;
+  polygon_init(&poly, points, n);
+  free(points);
+  return poly;
+}
+
+// One large star located by ray casting and by its slab index, then uniform
+// points located in thousands of small stars by a scan over the polygons and
+// by the polygon index, on 1 to 8 threads.
+void bench_polygon() {
+  srand(0);
+  Point *points = malloc(sizeof(Point) * N);
+  for (unsigned i = 0; i < N; ++i) {
+    points[i] = (Point){.x = random_coord(), .y = random_coord()};
+  }
+
+  Polygon star = random_star((Point){500, 500}, 500, STAR_VERTICES);
+  static const unsigned SCAN_QUERIES = 1024;
+  unsigned long inside = 0;
+  double start = bench_seconds();
+  for (unsigned i = 0; i < SCAN_QUERIES; ++i) {
+    inside += polygon_locate(&star, points[i]) == POLYGON_INSIDE;
+  }
+  bench_report("polygon_locate", "64k vertex star", SCAN_QUERIES,
+               bench_seconds() - start);
+
+  PolygonSlabs slabs;
+  start = bench_seconds();
+  polygon_slabs_init(&slabs, &star);
+  bench_report("polygon_slabs_init", "64k vertex star", STAR_VERTICES,
+               bench_seconds() - start);
+  PolygonLocation *locations = malloc(sizeof(PolygonLocation) * N);
+  for (unsigned threads = 1; threads <= 8; threads *= 2) {
+    char input[32];
+    snprintf(input, sizeof(input), "64k star, %u threads", threads);
+    start = bench_seconds();
+    polygon_slabs_locate_many(&slabs, points, N, locations, threads);
+    bench_report("polygon_slabs_locate_many", input, N,
+                 bench_seconds() - start);
+  }
+  polygon_slabs_free(&slabs);
+  polygon_free(&star);
+
+  Polygon *polygons = malloc(sizeof(Polygon) * NUM_POLYGONS);
+  for (unsigned i = 0; i < NUM_POLYGONS; ++i) {
+    Point center = {.x = random_coord(), .y = random_coord()};
+    polygons[i] = random_star(center, 10, POLYGON_VERTICES);
+  }
+  unsigned long found = 0;
+  start = bench_seconds();
+  for (unsigned i = 0; i < SCAN_QUERIES; ++i) {
+    for (unsigned j = 0; j < NUM_POLYGONS; ++j) {
+      if (polygon_locate(&polygons[j], points[i]) != POLYGON_OUTSIDE) {
+        ++found;
+        break;
+      }
+    }
+  }
+  bench_report("polygon scan", "4k polygons", SCAN_QUERIES,
+               bench_seconds() - start);
+
+  unsigned *ids = malloc(sizeof(unsigned) * N);
+  for (unsigned threads = 1; threads <= 8; threads *= 2) {
+    char input[32];
+    snprintf(input, sizeof(input), "4k polygons, %u threads", threads);
+    PolygonIndex index;
+    start = bench_seconds();
+    polygon_index_init(&index, polygons, NUM_POLYGONS, threads);
+    bench_report("polygon_index_init", input, NUM_POLYGONS,
+                 bench_seconds() - start);
+    start = bench_seconds();
+    polygon_index_locate_many(&index, points, N, ids, threads);
+    bench_report("polygon_index_locate_many", input, N,
+                 bench_seconds() - start);
+    polygon_index_free(&index);
+  }
+  for (unsigned i = 0; i < N; ++i) {
+    found += ids[i] != UINT_MAX;
+  }
+  printf("%lu inside star, %lu located\n", inside, found);
+
+  for (unsigned i = 0; i < NUM_POLYGONS; ++i) {
+    polygon_free(&polygons[i]);
+  }
+  free(polygons);
+  free(ids);
+  free(locations);
+  free(points);
+}
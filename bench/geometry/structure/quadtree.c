@@ -0,0 +1,67 @@
+#include "bench.h"
+#include "geometry/structure/quadtree.h"
+#include <stdlib.h>
+
+static const unsigned N = 1 << 20;
+static const unsigned TICKS = 4;
+static const unsigned QUERIES = 1 << 14;
+
+static double random_step() { return (double)rand() / RAND_MAX * 2 - 1; }
+
+static void count_id(unsigned id, void *data) { ++*(unsigned long *)data; }
+
+// 1M moving points: inserting them, moving every point by up to one unit per
+// tick, and window and nearest queries between ticks.
+void bench_quadtree() {
+  srand(0);
+  Point *points = malloc(sizeof(Point) * N);
+  for (unsigned i = 0; i < N; ++i) {
+    points[i] = (Point){.x = random_coord(), .y = random_coord()};
+  }
+
+  QuadTree tree;
+  quadtree_init(&tree, (Point){0, 0}, (Point){1000, 1000});
+  double start = bench_seconds();
+  for (unsigned i = 0; i < N; ++i) {
+    quadtree_insert_point(&tree, points[i]);
+  }
+  bench_report("quadtree_insert_point", "uniform", N, bench_seconds() - start);
+
+  unsigned long found = 0;
+  for (unsigned tick = 0; tick < TICKS; ++tick) {
+    for (unsigned i = 0; i < N; ++i) {
+      points[i].x += random_step();
+      points[i].y += random_step();
+    }
+    start = bench_seconds();
+    for (unsigned i = 0; i < N; ++i) {
+      quadtree_move(&tree, i, (Segment){.p0 = points[i], .p1 = points[i]});
+    }
+    bench_report("quadtree_move", "step <= 1", N, bench_seconds() - start);
+  }
+
+  start = bench_seconds();
+  for (unsigned q = 0; q < QUERIES; ++q) {
+    Point min = {random_coord(), random_coord()};
+    Point max = {min.x + 4, min.y + 4};
+    quadtree_query_box(&tree, min, max, count_id, &found);
+  }
+  bench_report("quadtree_query_box", "4x4", QUERIES, bench_seconds() - start);
+
+  unsigned ids[16];
+  start = bench_seconds();
+  for (unsigned q = 0; q < QUERIES; ++q) {
+    Point p = {random_coord(), random_coord()};
+    found += quadtree_nearest(&tree, p, 16, ids);
+  }
+  bench_report("quadtree_nearest", "k=16", QUERIES, bench_seconds() - start);
+
+  start = bench_seconds();
+  for (unsigned i = 0; i < N; ++i) {
+    quadtree_delete(&tree, i);
+  }
+  bench_report("quadtree_delete", "all", N, bench_seconds() - start);
+  printf("found %lu\n", found);
+  quadtree_free(&tree);
+  free(points);
+}
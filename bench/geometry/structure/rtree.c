@@ -0,0 +1,71 @@
+#include "bench.h"
+#include "geometry/structure/rtree.h"
+#include <stdlib.h>
+
+static const unsigned N = 1 << 20;
+static const unsigned QUERIES = 1 << 14;
+static const unsigned UPDATES = 1 << 16;
+
+static void count_id(unsigned id, void *data) { ++*(unsigned long *)data; }
+
+// Bulk loading on 1 to 8 threads, then box, segment and nearest queries and
+// dynamic updates on the loaded tree.
+void bench_rtree() {
+  srand(0);
+  Segment *segments = malloc(sizeof(Segment) * N);
+  for (unsigned i = 0; i < N; ++i) {
+    double x = random_coord();
+    double y = random_coord();
+    segments[i] = segment_from_coords(x, y, x + random_coord() / 500 - 1,
+                                      y + random_coord() / 500 - 1);
+  }
+
+  RTree tree;
+  rtree_init(&tree);
+  for (unsigned threads = 1; threads <= 8; threads *= 2) {
+    char input[32];
+    snprintf(input, sizeof(input), "short, %u threads", threads);
+    double start = bench_seconds();
+    rtree_bulk_load(&tree, segments, N, threads);
+    bench_report("rtree_bulk_load", input, N, bench_seconds() - start);
+  }
+
+  unsigned long found = 0;
+  double start = bench_seconds();
+  for (unsigned q = 0; q < QUERIES; ++q) {
+    Point min = {random_coord(), random_coord()};
+    Point max = {min.x + 4, min.y + 4};
+    rtree_query_box(&tree, min, max, count_id, &found);
+  }
+  bench_report("rtree_query_box", "4x4", QUERIES, bench_seconds() - start);
+
+  start = bench_seconds();
+  for (unsigned q = 0; q < QUERIES; ++q) {
+    double x = random_coord();
+    double y = random_coord();
+    rtree_query_segment(&tree, segment_from_coords(x, y, x + 10, y + 5),
+                        count_id, &found);
+  }
+  bench_report("rtree_query_segment", "length 11", QUERIES,
+               bench_seconds() - start);
+
+  unsigned ids[16];
+  start = bench_seconds();
+  for (unsigned q = 0; q < QUERIES; ++q) {
+    Point p = {random_coord(), random_coord()};
+    found += rtree_nearest(&tree, p, 16, ids);
+  }
+  bench_report("rtree_nearest", "k=16", QUERIES, bench_seconds() - start);
+
+  start = bench_seconds();
+  for (unsigned i = 0; i < UPDATES; ++i) {
+    unsigned id = (unsigned)rand() % N;
+    rtree_delete(&tree, id);
+    rtree_insert_segment(&tree, segments[id]);
+  }
+  bench_report("rtree_delete+insert", "short", UPDATES,
+               bench_seconds() - start);
+  printf("found %lu\n", found);
+  rtree_free(&tree);
+  free(segments);
+}
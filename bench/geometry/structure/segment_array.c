@@ -0,0 +1,74 @@
+#include "bench.h"
+#include "geometry/simd.h"
+#include "geometry/structure/segment_array.h"
+#include <stdlib.h>
+
+static const unsigned N = 1 << 12;
+static const unsigned QUERIES = 1 << 10;
+
+static const char *LEVEL_NAMES[] = {"scalar", "avx2", "avx512"};
+
+static Segment random_segment() {
+  double x = rand() % 10000;
+  double y = rand() % 10000;
+  return segment_from_coords(x, y, x + rand() % 2000 - 1000,
+                             y + rand() % 2000 - 1000);
+}
+
+// One query segment against N candidates, repeated for QUERIES queries.
+// Compares a loop over segment_intersects with segment_intersects_many, and
+// times the box overlap filter on the cached boxes alone.
+void bench_segment_array() {
+  srand(0);
+  Segment *segments = malloc(sizeof(Segment) * N);
+  Segment *queries = malloc(sizeof(Segment) * QUERIES);
+  for (unsigned i = 0; i < N; ++i) {
+    segments[i] = random_segment();
+  }
+  for (unsigned i = 0; i < QUERIES; ++i) {
+    queries[i] = random_segment();
+  }
+  SegmentArray arr;
+  segment_array_from_segments(&arr, segments, N);
+  uint64_t *bitmask = malloc(sizeof(uint64_t) * segment_bitmask_words(N));
+
+  unsigned long hits = 0;
+  double start = bench_seconds();
+  for (unsigned q = 0; q < QUERIES; ++q) {
+    for (unsigned i = 0; i < N; ++i) {
+      hits += segment_intersects(queries[q], segments[i]);
+    }
+  }
+  bench_report("segment_intersects loop", "n=4096", N * QUERIES,
+               bench_seconds() - start);
+
+  for (SimdLevel level = SIMD_SCALAR; level <= simd_supported_level();
+       ++level) {
+    simd_set_level(level);
+    start = bench_seconds();
+    for (unsigned q = 0; q < QUERIES; ++q) {
+      segment_intersects_many(queries[q], &arr, bitmask);
+      hits += bitmask[0] & 1;
+    }
+    bench_report("segment_intersects_many", LEVEL_NAMES[level], N * QUERIES,
+                 bench_seconds() - start);
+  }
+  for (SimdLevel level = SIMD_SCALAR; level <= simd_supported_level();
+       ++level) {
+    simd_set_level(level);
+    start = bench_seconds();
+    for (unsigned q = 0; q < QUERIES; ++q) {
+      bbox_overlaps_many(bbox_from_segment(queries[q]), &arr.boxes, bitmask);
+      hits += bitmask[0] & 1;
+    }
+    bench_report("bbox_overlaps_many", LEVEL_NAMES[level], N * QUERIES,
+                 bench_seconds() - start);
+  }
+  simd_set_level(simd_supported_level());
+  printf("(%lu hits)\n", hits);
+
+  free(bitmask);
+  segment_array_free(&arr);
+  free(queries);
+  free(segments);
+}
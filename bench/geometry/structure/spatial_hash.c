@@ -0,0 +1,86 @@
+#include "bench.h"
+#include "geometry/structure/spatial_hash.h"
+#include <stdlib.h>
+
+static const unsigned N = 1 << 20;
+static const unsigned QUERIES = 1 << 14;
+
+static void count_id(unsigned id, void *data) { ++*(unsigned long *)data; }
+
+static void count_pair(unsigned a, unsigned b, void *data) {
+  ++*(unsigned long *)data;
+}
+
+// Radius queries over uniform points against a linear scan, and candidate
+// pairs over short segments.
+void bench_spatial_hash() {
+  srand(0);
+  Point *points = malloc(sizeof(Point) * N);
+  for (unsigned i = 0; i < N; ++i) {
+    points[i] = (Point){.x = random_coord(), .y = random_coord()};
+  }
+  Point *centers = malloc(sizeof(Point) * QUERIES);
+  for (unsigned i = 0; i < QUERIES; ++i) {
+    centers[i] = (Point){.x = random_coord(), .y = random_coord()};
+  }
+  static const double RADIUS = 2;
+
+  SpatialHash hash;
+  double start = bench_seconds();
+  spatial_hash_init(&hash, spatial_hash_cell_size_points(points, N));
+  for (unsigned i = 0; i < N; ++i) {
+    spatial_hash_insert_point(&hash, points[i]);
+  }
+  bench_report("spatial_hash_insert_point", "uniform", N,
+               bench_seconds() - start);
+
+  unsigned long found = 0;
+  start = bench_seconds();
+  for (unsigned q = 0; q < QUERIES; ++q) {
+    spatial_hash_query_radius(&hash, centers[q], RADIUS, count_id, &found);
+  }
+  bench_report("spatial_hash_query_radius", "uniform r=2", QUERIES,
+               bench_seconds() - start);
+
+  unsigned long scanned = 0;
+  static const unsigned SCAN_QUERIES = 64;
+  start = bench_seconds();
+  for (unsigned q = 0; q < SCAN_QUERIES; ++q) {
+    for (unsigned i = 0; i < N; ++i) {
+      double dx = points[i].x - centers[q].x;
+      double dy = points[i].y - centers[q].y;
+      scanned += dx * dx + dy * dy <= RADIUS * RADIUS;
+    }
+  }
+  bench_report("linear scan", "uniform r=2", SCAN_QUERIES,
+               bench_seconds() - start);
+  spatial_hash_free(&hash);
+
+  // Short segments, about as long as a cell
+  Segment *segments = malloc(sizeof(Segment) * N);
+  for (unsigned i = 0; i < N; ++i) {
+    double x = random_coord();
+    double y = random_coord();
+    segments[i] = segment_from_coords(x, y, x + random_coord() / 500 - 1,
+                                      y + random_coord() / 500 - 1);
+  }
+  start = bench_seconds();
+  spatial_hash_init(&hash, spatial_hash_cell_size(segments, N));
+  for (unsigned i = 0; i < N; ++i) {
+    spatial_hash_insert_segment(&hash, segments[i]);
+  }
+  bench_report("spatial_hash_insert_segment", "short", N,
+               bench_seconds() - start);
+  unsigned long pairs = 0;
+  start = bench_seconds();
+  spatial_hash_candidate_pairs(&hash, count_pair, &pairs);
+  bench_report("spatial_hash_candidate_pairs", "short", N,
+               bench_seconds() - start);
+  printf("found %lu in radius, %lu scanned, %lu candidate pairs\n", found,
+         scanned, pairs);
+  spatial_hash_free(&hash);
+
+  free(segments);
+  free(centers);
+  free(points);
+}
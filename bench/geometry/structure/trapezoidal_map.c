@@ -0,0 +1,66 @@
+#include "bench.h"
+#include "geometry/structure/trapezoidal_map.h"
+#include <math.h>
+#include <stdlib.h>
+
+static const unsigned N = 1 << 20;
+static const unsigned QUERIES = 1 << 22;
+
+// A triangulated grid with jittered vertices, like the edges of a mesh or a
+// fine planar subdivision, and uniform queries located one at a time and in
+// sorted batches.
+void bench_trapezoidal_map() {
+  srand(0);
+  unsigned side = (unsigned)sqrt(N / 3);
+  Point *corners = malloc(sizeof(Point) * side * side);
+  for (unsigned i = 0; i < side * side; ++i) {
+    corners[i] = (Point){.x = i % side + (double)rand() / RAND_MAX * 0.4,
+                         .y = i / side + (double)rand() / RAND_MAX * 0.4};
+  }
+  Segment *segments = malloc(sizeof(Segment) * N);
+  unsigned n = 0;
+  for (unsigned y = 0; y + 1 < side; ++y) {
+    for (unsigned x = 0; x + 1 < side; ++x) {
+      Point p = corners[y * side + x];
+      segments[n++] = (Segment){p, corners[y * side + x + 1]};
+      segments[n++] = (Segment){p, corners[(y + 1) * side + x]};
+      segments[n++] = (Segment){p, corners[(y + 1) * side + x + 1]};
+    }
+  }
+  free(corners);
+
+  TrapezoidalMap map;
+  double start = bench_seconds();
+  trapezoidal_map_init(&map, segments, n);
+  bench_report("trapezoidal_map_init", "grid mesh", n,
+               bench_seconds() - start);
+
+  Point *queries = malloc(sizeof(Point) * QUERIES);
+  for (unsigned i = 0; i < QUERIES; ++i) {
+    queries[i] = (Point){.x = (double)rand() / RAND_MAX * side,
+                         .y = (double)rand() / RAND_MAX * side};
+  }
+  unsigned *out = malloc(sizeof(unsigned) * QUERIES);
+  unsigned long sum = 0;
+  start = bench_seconds();
+  for (unsigned i = 0; i < QUERIES; ++i) {
+    sum += trapezoidal_map_locate(&map, queries[i]);
+  }
+  bench_report("trapezoidal_map_locate", "uniform", QUERIES,
+               bench_seconds() - start);
+  for (unsigned threads = 1; threads <= 4; threads *= 4) {
+    char input[32];
+    snprintf(input, sizeof(input), "uniform, %u threads", threads);
+    start = bench_seconds();
+    trapezoidal_map_locate_many(&map, queries, QUERIES, out, threads);
+    bench_report("trapezoidal_map_locate_many", input, QUERIES,
+                 bench_seconds() - start);
+    sum += out[0];
+  }
+  printf("%u trapezoids, %u nodes, %lu sum\n", map.num_trapezoids,
+         map.num_nodes, sum);
+  trapezoidal_map_free(&map);
+  free(out);
+  free(queries);
+  free(segments);
+}
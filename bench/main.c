@@ -0,0 +1,58 @@
+#include "bench.h"
+#include <string.h>
+
+typedef struct {
+  const char *name;
+  void (*run)();
+} Benchmark;
+
+static const Benchmark BENCHMARKS[] = {
+    {"sort", bench_sort},
+    {"select", bench_select},
+    {"point_array", bench_point_array},
+    {"segment_array", bench_segment_array},
+    {"spatial_hash", bench_spatial_hash},
+    {"rtree", bench_rtree},
+    {"kd_tree", bench_kd_tree},
+    {"quadtree", bench_quadtree},
+    {"trapezoidal_map", bench_trapezoidal_map},
+    {"segment_intersection", bench_segment_intersection},
+    {"segment_intersection_parallel", bench_segment_intersection_parallel},
+    {"any_intersection", bench_any_intersection},
+    {"convex_hull", bench_convex_hull},
+    {"closest_pair", bench_closest_pair},
+    {"predicates", bench_predicates},
+    {"space_filling_curve", bench_space_filling_curve},
+    {"polygon", bench_polygon},
+    {"polygon_boolean", bench_polygon_boolean},
+    {"polyline_simplify", bench_polyline_simplify},
+    {"delaunay", bench_delaunay},
+    {"voronoi", bench_voronoi},
+    {"arrangement", bench_arrangement},
+    {"polygon_triangulate", bench_polygon_triangulate},
+    {"rotating_calipers", bench_rotating_calipers},
+};
+
+static const unsigned NUM_BENCHMARKS =
+    sizeof(BENCHMARKS) / sizeof(BENCHMARKS[0]);
+
+static bool selected(const char *name, int argc, char **argv) {
+  if (argc <= 1) {
+    return true;
+  }
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], name) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+int main(int argc, char **argv) {
+  for (unsigned i = 0; i < NUM_BENCHMARKS; ++i) {
+    if (selected(BENCHMARKS[i].name, argc, argv)) {
+      BENCHMARKS[i].run();
+    }
+  }
+  return 0;
+}
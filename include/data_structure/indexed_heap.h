@@ -0,0 +1,40 @@
+#ifndef INDEXED_HEAP_H
+#define INDEXED_HEAP_H
+
+#include <stdbool.h>
+
+// Min heap of the ids 0..capacity - 1 keyed by doubles. The heap remembers
+// where each id is, so the key of an id in the heap can be changed, or the id
+// removed, in O(log(n)). Ties between keys are broken by id, so the order ids
+// come out in is deterministic.
+typedef struct {
+  // Ids in heap order
+  unsigned *ids;
+  // keys[id] is the key of id, if it is in the heap
+  double *keys;
+  // positions[id] is the index of id in ids, or UINT_MAX if it is not in the
+  // heap
+  unsigned *positions;
+  unsigned size;
+  unsigned capacity;
+} IndexedHeap;
+
+void indexed_heap_init(IndexedHeap *heap, unsigned capacity);
+void indexed_heap_free(IndexedHeap *heap);
+// Removes every id in O(size).
+void indexed_heap_clear(IndexedHeap *heap);
+
+bool indexed_heap_contains(const IndexedHeap *heap, unsigned id);
+// Inserts id with key, or changes its key if it is already in the heap.
+void indexed_heap_update(IndexedHeap *heap, unsigned id, double key);
+// Removes id if it is in the heap.
+void indexed_heap_remove(IndexedHeap *heap, unsigned id);
+// The id with the smallest key, or UINT_MAX if the heap is empty.
+unsigned indexed_heap_peek(const IndexedHeap *heap);
+// Removes and returns the id with the smallest key, or UINT_MAX if the heap is
+// empty.
+unsigned indexed_heap_pop(IndexedHeap *heap);
+
+void indexed_heap_validate(const IndexedHeap *heap);
+
+#endif
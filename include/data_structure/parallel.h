@@ -0,0 +1,13 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <stddef.h>
+
+// Runs fn on each of n_chunks chunks laid out stride bytes apart from ctx, one
+// thread per chunk, and returns once all are done. The calling thread takes
+// the first chunk, and any chunk whose thread cannot be started after the
+// others are joined, so every chunk runs even when threads run out.
+void parallel_for(unsigned n_chunks, void *(*fn)(void *), void *ctx,
+                  size_t stride);
+
+#endif
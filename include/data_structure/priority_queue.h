@@ -16,6 +16,7 @@ void pq_initcn(PriorityQueue *pq, cmp_t cmp, unsigned n);
 
 void pq_push(PriorityQueue *pq, void *val);
 void *pq_pop(PriorityQueue *pq);
+void *pq_peek(PriorityQueue *pq);
 void pq_free(PriorityQueue *pq);
 void pq_validate(PriorityQueue *pq);
 
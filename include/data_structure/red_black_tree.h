@@ -27,6 +27,24 @@ Optional rb_tree_pred(RedBlackTree *tree, void *val);
 Optional rb_tree_succ(RedBlackTree *tree, void *val);
 void **rb_tree_elements(RedBlackTree *tree);
 
+// Node handles. A node stays valid until it is deleted, regardless of other
+// insertions and deletions, so callers can keep a handle to an element and
+// delete it or walk to its neighbors without searching with the comparator.
+RedBlackNode *rb_tree_insert_node(RedBlackTree *tree, void *val);
+void *rb_tree_delete_node(RedBlackTree *tree, RedBlackNode *n);
+void *rb_tree_node_val(RedBlackNode *n);
+RedBlackNode *rb_tree_node_next(RedBlackNode *n);
+RedBlackNode *rb_tree_node_prev(RedBlackNode *n);
+RedBlackNode *rb_tree_first_node(RedBlackTree *tree);
+RedBlackNode *rb_tree_last_node(RedBlackTree *tree);
+// Returns the first node whose value is greater than val, or NULL.
+RedBlackNode *rb_tree_upper_bound(RedBlackTree *tree, void *val);
+// Inserts val right after pos, or first if pos is NULL, without comparing.
+// For sequences ordered by position rather than by a key, the caller is
+// responsible for keeping the comparator, if it is used, consistent.
+RedBlackNode *rb_tree_insert_after(RedBlackTree *tree, RedBlackNode *pos,
+                                   void *val);
+
 void rb_tree_validate(RedBlackTree *tree);
 void rb_tree_validate_expensive(RedBlackTree *tree);
 
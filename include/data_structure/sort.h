@@ -1,5 +1,8 @@
-#ifndef HASH_H
-#define HASH_H
+#ifndef SORT_H
+#define SORT_H
+
+#include "data_structure/comparator.h"
+#include <stdint.h>
 
 typedef void **(*sort_t)(void **, unsigned);
 
@@ -11,4 +14,31 @@ void **quick_sort(void **data, unsigned n);
 void **selection_sort(void **data, unsigned n);
 void **tree_sort(void **data, unsigned n);
 
+// Stable, adaptive merge sort. Runs in O(n) on presorted input and O(n log(n))
+// in the worst case.
+void **tim_sort(void **data, unsigned n);
+void **tim_sortc(void **data, unsigned n, cmp_t cmp);
+
+// Rearranges data so that data[k] is the element that would be there if data
+// were sorted. Elements before k are <= data[k] and elements after k are >=
+// data[k]. Runs in expected O(n) time and O(n log(n)) in the worst case.
+void **nth_element(void **data, unsigned n, unsigned k);
+void **nth_elementc(void **data, unsigned n, unsigned k, cmp_t cmp);
+
+// Sorts the k smallest elements into data[0..k). The order of the remaining
+// elements is unspecified. Runs in O(n + k log(k)) expected time.
+void **partial_sort(void **data, unsigned n, unsigned k);
+void **partial_sortc(void **data, unsigned n, unsigned k, cmp_t cmp);
+
+// Sorts keys in ascending order with a least significant digit radix sort and
+// applies the same permutation to values, which may be NULL. Stable. Each pass
+// counts and scatters on num_threads threads, and passes over a digit that is
+// the same for every key are skipped. O(n) time and O(n) extra space.
+void radix_sort_keys(uint64_t *keys, unsigned *values, unsigned n,
+                     unsigned num_threads);
+
+// Maps a double to a key with the same order, for radix_sort_keys. -0.0 sorts
+// before 0.0 and NaNs of either sign sort after infinity, all with one key.
+uint64_t double_sort_key(double x);
+
 #endif
@@ -0,0 +1,34 @@
+#ifndef TOP_K_H
+#define TOP_K_H
+
+#include "data_structure/comparator.h"
+#include "data_structure/optional.h"
+
+// Keeps the k smallest elements of a stream in O(k) memory. Elements are stored
+// in a fixed-capacity max heap, so the largest kept element is at the root and
+// can be evicted in O(log(k)) when a smaller element arrives.
+typedef struct {
+  void **data;
+  unsigned size;
+  unsigned capacity;
+  cmp_t cmp;
+} TopK;
+
+void top_k_init(TopK *top, unsigned k);
+void top_k_initc(TopK *top, unsigned k, cmp_t cmp);
+void top_k_free(TopK *top);
+
+// Returns true if val is kept, i.e. it is one of the k smallest elements seen
+// so far. Ties with the current largest kept element are rejected.
+bool top_k_push(TopK *top, void *val);
+void top_k_push_all(TopK *top, void **data, unsigned n);
+// The largest kept element. Once the accumulator is full, only elements less
+// than this are kept.
+Optional top_k_max(TopK *top);
+bool top_k_full(TopK *top);
+// Returns a newly allocated array of the kept elements in sorted order.
+void **top_k_elements(TopK *top);
+
+void top_k_validate(TopK *top);
+
+#endif
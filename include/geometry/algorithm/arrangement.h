@@ -0,0 +1,81 @@
+#ifndef ARRANGEMENT_H
+#define ARRANGEMENT_H
+
+#include "geometry/structure/segment.h"
+#include "geometry/structure/trapezoidal_map.h"
+
+// A half-edge of an arrangement. Its face is on its left, and next and prev
+// are the half-edges before and after it counterclockwise around that face.
+// Half-edges come in pairs, so the twin of half-edge h is h ^ 1.
+typedef struct {
+  unsigned origin;
+  unsigned next;
+  unsigned prev;
+  unsigned face;
+  // The input segment this is a piece of, the first if several overlap
+  unsigned segment;
+} ArrangementHalfEdge;
+
+// The subdivision of the plane by a set of segments, as a doubly connected
+// edge list in flat arrays that refer to each other by index.
+//
+// Face 0 is the unbounded face. Every other face f has an outer boundary,
+// which face_edges[f] is a half-edge of, and each face may have holes, the
+// outer boundaries of the pieces of the arrangement inside it. One half-edge
+// of each hole of face f is in holes[hole_starts[f]..hole_starts[f + 1]).
+typedef struct {
+  Point *vertices;
+  // A half-edge leaving each vertex
+  unsigned *vertex_edges;
+  ArrangementHalfEdge *edges;
+  unsigned *face_edges;
+  unsigned *hole_starts;
+  unsigned *holes;
+  unsigned num_vertices;
+  unsigned num_edges;
+  unsigned num_faces;
+} Arrangement;
+
+static inline unsigned arrangement_twin(unsigned edge) { return edge ^ 1; }
+
+// Builds the arrangement of the segments. Segments are split at every
+// intersection found by segment_intersections_parallel on num_threads
+// threads, or by the streaming sweep on one thread, so no intersection list
+// is held. Collinear overlaps are split at the ends of the overlap and kept
+// once. Points closer than 2^-40 of the largest magnitude of a coordinate on
+// both axes are merged into one vertex through a uniform grid hash, so the
+// result does not depend on the scale of the input, and edges that pass that
+// close to a vertex are split there, so edges only meet at shared vertices.
+// Segments that are a single point after merging add nothing.
+//
+// Memory is O(n + k) for k intersections, a few dozen bytes per input segment
+// and per piece.
+void arrangement_build(const Segment *segments, unsigned n,
+                       unsigned num_threads, Arrangement *out);
+
+void arrangement_free(Arrangement *arr);
+
+// The number of half-edges around a face's outer boundary, 0 for the
+// unbounded face.
+unsigned arrangement_face_size(const Arrangement *arr, unsigned face);
+
+// Builds a trapezoidal map over the arrangement's edges for locating points
+// in its faces. Segment s of the map is the edge of half-edges 2s and 2s + 1.
+void arrangement_trapezoidal_map(const Arrangement *arr, TrapezoidalMap *map);
+
+// The face that contains p, given the map from arrangement_trapezoidal_map,
+// in expected O(log(n)). Points on an edge are in the face above it.
+unsigned arrangement_locate(const Arrangement *arr, const TrapezoidalMap *map,
+                            Point p);
+// Runs arrangement_locate for each of the n points on num_threads threads,
+// with the map's sorted batch queries.
+void arrangement_locate_many(const Arrangement *arr,
+                             const TrapezoidalMap *map, const Point *points,
+                             unsigned n, unsigned *faces,
+                             unsigned num_threads);
+
+// Checks that next and prev are inverse, that each half-edge ends where its
+// next starts, and that faces are consistent around every cycle.
+void arrangement_validate(const Arrangement *arr);
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef CLOSEST_PAIR_H
+#define CLOSEST_PAIR_H
+
+#include "geometry/structure/point.h"
+
+// Finds the two closest points by divide and conquer in O(n log(n)) and
+// writes their indices to *a and *b with *a < *b. Returns false if there are
+// fewer than two points. Points at the same position are a pair at distance
+// 0.
+bool closest_pair(const Point *points, unsigned n, unsigned *a, unsigned *b);
+
+// closest_pair with the two halves of the top levels of the recursion solved
+// on separate threads.
+bool closest_pair_parallel(const Point *points, unsigned n,
+                           unsigned num_threads, unsigned *a, unsigned *b);
+
+// O(n^2) reference.
+bool closest_pair_brute_force(const Point *points, unsigned n, unsigned *a,
+                              unsigned *b);
+
+// Writes the index of the nearest other point of every point to nearest, in
+// expected O(n log(n)) with a KD-tree. Ties are broken arbitrarily. Every
+// entry is UINT_MAX if there are fewer than two points.
+void all_nearest_neighbors(const Point *points, unsigned n, unsigned *nearest);
+void all_nearest_neighbors_parallel(const Point *points, unsigned n,
+                                    unsigned num_threads, unsigned *nearest);
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef CONVEX_HULL_H
+#define CONVEX_HULL_H
+
+#include "geometry/structure/point.h"
+
+// Every function here returns the vertices of the convex hull in a newly
+// allocated array and sets *count to its length. Vertices are in
+// counter-clockwise order, starting from the lowest of the leftmost points.
+// Duplicate points and points in the interior of hull edges are left out, so
+// all collinear input gives the two extreme points and a single distinct point
+// gives itself. Orientations are decided by the exact orient2d predicate, so
+// nearly collinear points never make a reflex or collinear vertex.
+
+// Convex hull using Akl-Toussaint filtering followed by monotone chain.
+Point *convex_hull(const Point *points, unsigned n, unsigned *count);
+
+// Andrew's monotone chain in O(n log(n)).
+Point *convex_hull_monotone_chain(const Point *points, unsigned n,
+                                  unsigned *count);
+
+// Quickhull in O(n log(h)) expected time for h hull vertices, which is fast
+// when most points are interior. Degrades to O(n^2) when many points are on
+// the hull.
+Point *convex_hull_quickhull(const Point *points, unsigned n, unsigned *count);
+
+// Splits the points into num_threads chunks, computes their hulls in
+// parallel, and merges them into the hull of the union.
+Point *convex_hull_parallel(const Point *points, unsigned n,
+                            unsigned num_threads, unsigned *count);
+
+// The number of points convex_hull_in_scratch needs as scratch, 2n + 1.
+unsigned convex_hull_scratch_size(unsigned n);
+
+// convex_hull without allocating, for computing many small hulls. The filtered
+// points are heap sorted in scratch, which must hold
+// convex_hull_scratch_size(n) points, and the hull is written after them.
+// Returns a pointer to the hull inside scratch.
+Point *convex_hull_in_scratch(const Point *points, unsigned n, Point *scratch,
+                              unsigned *count);
+
+// Akl-Toussaint heuristic. Copies the points that are not strictly inside the
+// octagon of extreme points in the x, y, x + y and x - y directions into out,
+// which must hold n points, and returns how many were copied. Only interior
+// points are discarded, so the hull is unchanged.
+unsigned convex_hull_filter(const Point *points, unsigned n, Point *out);
+
+#endif
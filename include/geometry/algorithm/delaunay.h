@@ -0,0 +1,45 @@
+#ifndef DELAUNAY_H
+#define DELAUNAY_H
+
+#include "geometry/structure/point.h"
+
+// A triangle of a triangulation. vertices are indices of the input points in
+// counterclockwise order, and neighbors[i] is the triangle across the edge
+// opposite vertices[i], or UINT_MAX if that edge is on the convex hull.
+typedef struct {
+  unsigned vertices[3];
+  unsigned neighbors[3];
+} Triangle;
+
+typedef struct {
+  Triangle *triangles;
+  unsigned num_triangles;
+} Triangulation;
+
+// Computes the Delaunay triangulation of the points with Bowyer-Watson
+// incremental insertion. Points are inserted in a biased randomized insertion
+// order, rounds of random points that double in size, each sorted along a
+// Hilbert curve, so every point is found by a short walk from the triangles of
+// the point before it. The triangles are kept in one array, reusing the slots
+// of the triangles each insertion removes. Expected O(n log(n)) time.
+//
+// All decisions are made with the exact orient2d and incircle, so the result
+// is valid for any input. Duplicate points are used once, by the first of
+// them in insertion order. The triangulation of cocircular points is one of
+// the valid ones. There are no triangles if there are fewer than three points
+// or they are all collinear.
+void delaunay_triangulate(const Point *points, unsigned n, Triangulation *out);
+
+// delaunay_triangulate with the insertion order computed on num_threads
+// threads. The insertions themselves are sequential.
+void delaunay_triangulate_parallel(const Point *points, unsigned n,
+                                   unsigned num_threads, Triangulation *out);
+
+void triangulation_free(Triangulation *tri);
+
+// Checks that the triangles are counterclockwise and that neighbors link up
+// both ways across the same edge.
+void triangulation_validate(const Triangulation *tri, const Point *points,
+                            unsigned n);
+
+#endif
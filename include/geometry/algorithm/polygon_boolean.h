@@ -0,0 +1,38 @@
+#ifndef POLYGON_BOOLEAN_H
+#define POLYGON_BOOLEAN_H
+
+#include "geometry/structure/polygon.h"
+
+typedef enum {
+  POLYGON_INTERSECTION,
+  POLYGON_UNION,
+  POLYGON_DIFFERENCE,
+  POLYGON_XOR,
+} PolygonOperation;
+
+// Computes subject op clip and appends the resulting polygons to out, using a
+// Martinez-Rueda sweep in O((n + k) log(n)) time for n edges and k edge
+// crossings. Inputs are read by the even-odd rule, so rings may wind either
+// way. Shared and overlapping edges, vertices touching edges and holes are
+// handled. Crossing points are rounded to doubles, while everything else is
+// decided with exact predicates.
+void polygon_boolean(const Polygon *subject, const Polygon *clip,
+                     PolygonOperation op, PolygonSet *out);
+
+// Same as polygon_boolean for sets of polygons, such as two layers.
+void polygon_set_boolean(const PolygonSet *subject, const PolygonSet *clip,
+                         PolygonOperation op, PolygonSet *out);
+
+// Clips subject to the convex polygon window with Sutherland-Hodgman in
+// O(n * m) for n subject and m window vertices, and appends the result to out
+// as one polygon, or nothing if it is empty. The window may wind either way.
+// A concave subject that the window cuts into several pieces comes out as one
+// ring joined by edges of zero width along the window's boundary, which have
+// no area and do not change point location off the boundary.
+void polygon_clip_convex(const Polygon *subject, const Point *window,
+                         unsigned m, PolygonSet *out);
+
+// Same as polygon_clip_convex for an axis-aligned box, in O(n).
+void polygon_clip_bbox(const Polygon *subject, BBox window, PolygonSet *out);
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef POLYGON_TRIANGULATE_H
+#define POLYGON_TRIANGULATE_H
+
+#include "geometry/structure/polygon.h"
+
+typedef enum {
+  // Ear clipping for polygons of up to TRIANGULATE_EAR_CLIPPING_MAX_POINTS
+  // points, monotone decomposition for larger ones.
+  TRIANGULATE_AUTO,
+  TRIANGULATE_MONOTONE,
+  TRIANGULATE_EAR_CLIPPING,
+} TriangulateMethod;
+
+// Ear clipping is faster than the sweep on polygons up to this size, and its
+// quadratic worst case is still cheap.
+#define TRIANGULATE_EAR_CLIPPING_MAX_POINTS 256
+
+// Triangulations are written as index buffers. Triangle t is the points at
+// indices triangles[3 * t], triangles[3 * t + 1] and triangles[3 * t + 2] of
+// the polygon's points, in counterclockwise order.
+//
+// The polygon's rings must be simple and must not touch each other, the holes
+// must be inside the outer ring, and rings may wind either way. A polygon with
+// n points and h holes then has n + 2h - 2 triangles.
+
+// The number of triangles the triangulations write at most, n + 2h - 2.
+unsigned polygon_triangle_count(const Polygon *poly);
+
+// Splits the polygon into y-monotone pieces with a sweep from top to bottom
+// that keeps the edges crossing the sweep line in a RedBlackTree and adds a
+// diagonal at each vertex where the boundary turns back, then triangulates
+// each piece with a stack in linear time. O(n log(n)). Points must be distinct.
+// Returns the number of triangles, which is polygon_triangle_count.
+unsigned polygon_triangulate_monotone(const Polygon *poly, unsigned *triangles);
+
+// Clips ears off a linked list of the points, after bridging each hole to the
+// outer ring. Above 80 points, candidate ears are checked only against the
+// points in their bounding box's range of a z-order curve, kept as a second
+// sorted list. O(n^2) in the worst case and close to linear for most
+// polygons. Repeated and collinear points are dropped, and self-touching or
+// slightly self-intersecting rings still give a triangulation, so it may
+// return fewer than polygon_triangle_count triangles.
+unsigned polygon_triangulate_ear_clipping(const Polygon *poly,
+                                          unsigned *triangles);
+
+unsigned polygon_triangulate(const Polygon *poly, TriangulateMethod method,
+                             unsigned *triangles);
+
+// The triangulations of a set of polygons, in one index buffer of the set's
+// points. Polygon i's triangles are
+// triangles[triangle_starts[i]..triangle_starts[i + 1]), in units of
+// triangles, so their indices start at 3 * triangle_starts[i].
+typedef struct {
+  unsigned *indices;
+  unsigned *triangle_starts;
+  unsigned num_polygons;
+  unsigned num_triangles;
+} PolygonTriangles;
+
+// Triangulates each polygon of the set on num_threads threads. The buffer is
+// sized for polygon_triangle_count triangles per polygon up front, so the
+// threads write in place, each reusing its scratch across its polygons, and
+// polygons are packed together at the end.
+void polygon_set_triangulate(const PolygonSet *set, TriangulateMethod method,
+                             unsigned num_threads, PolygonTriangles *out);
+
+void polygon_triangles_free(PolygonTriangles *triangles);
+
+#endif
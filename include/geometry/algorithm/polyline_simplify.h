@@ -0,0 +1,55 @@
+#ifndef POLYLINE_SIMPLIFY_H
+#define POLYLINE_SIMPLIFY_H
+
+#include "geometry/structure/polyline.h"
+
+typedef enum {
+  SIMPLIFY_DOUGLAS_PEUCKER,
+  SIMPLIFY_VISVALINGAM_WHYATT,
+} SimplifyMethod;
+
+typedef struct {
+  SimplifyMethod method;
+  // The largest distance of a dropped point from the simplified line for
+  // Douglas-Peucker, and the smallest effective area of a kept point for
+  // Visvalingam-Whyatt.
+  double tolerance;
+  // Visvalingam-Whyatt only. Keeps a point whose removal could make the line
+  // cross itself.
+  bool preserve_topology;
+} SimplifyOptions;
+
+// The simplifications keep the first and last points and a subset of the
+// others in order, writing them to out, which must have room for n points and
+// may be points itself. They return the number of points kept.
+
+// Douglas-Peucker: keeps the point farthest from the segment between the ends
+// if it is farther than tolerance, and recurses on both halves. The recursion
+// is a scan over a bitmap of kept points rather than a stack, which takes
+// O(n log(n)) for most lines and O(n^2) in the worst case.
+unsigned polyline_simplify_douglas_peucker(const Point *points, unsigned n,
+                                           double tolerance, Point *out);
+
+// Visvalingam-Whyatt: repeatedly drops the point whose triangle with its
+// neighbors has the smallest area, while that area is below min_area, in
+// O(n log(n)). The areas are in an IndexedHeap, so dropping a point updates
+// its neighbors' areas in place.
+//
+// With preserve_topology, a point is kept if any other point of the line is
+// in its triangle. Then a line that does not cross itself does not after
+// simplification either. A point kept this way gets another chance when one of
+// its neighbors is dropped. A closed line is never reduced below a triangle.
+unsigned polyline_simplify_visvalingam_whyatt(const Point *points, unsigned n,
+                                              double min_area,
+                                              bool preserve_topology,
+                                              Point *out);
+
+// Simplifies each line of the set into out on num_threads threads. out is
+// cleared and sized for all the input points up front, so the threads write
+// their lines into place without allocating, and the lines are packed together
+// at the end. Threads get runs of lines with about the same number of points,
+// and each allocates its scratch once for the longest line in its run.
+void polyline_set_simplify(const PolylineSet *lines, SimplifyOptions options,
+                           unsigned num_threads, PolylineSet *out);
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef ROTATING_CALIPERS_H
+#define ROTATING_CALIPERS_H
+
+#include "geometry/structure/point.h"
+
+// A rectangle of the given length along the unit vector axis and width across
+// it, centered on center.
+typedef struct {
+  Point center;
+  Point axis;
+  double length;
+  double width;
+} OrientedBox;
+
+typedef struct {
+  Point center;
+  double radius;
+} Circle;
+
+typedef struct {
+  unsigned a;
+  unsigned b;
+} IndexPair;
+
+// The hull_ functions take a convex hull as convex_hull returns it, with h
+// vertices in counterclockwise order from the lowest of the leftmost points
+// and no duplicate or collinear vertices, and rotate calipers around it in
+// O(h). The others take any points, compute their hull with
+// convex_hull_in_scratch and run the hull_ function on it, so they allocate
+// nothing. Their scratch must hold convex_hull_scratch_size(n) points.
+
+// Writes every antipodal pair of vertices, the pairs that admit two parallel
+// lines of support, to pairs and returns how many there are. Each pair is
+// written once, and there are at most 3h / 2 of them. A single vertex has no
+// pairs and a segment has one.
+unsigned hull_antipodal_pairs(const Point *hull, unsigned h, IndexPair *pairs);
+
+// The farthest pair of vertices is antipodal. Writes their indices to *a and
+// *b and returns their distance. Returns 0 with *a and *b 0 for a single
+// vertex.
+double hull_diameter(const Point *hull, unsigned h, unsigned *a, unsigned *b);
+
+// The smallest distance between two parallel lines of support, one of which
+// contains a hull edge. Writes the edge's first vertex to *edge. 0 if there
+// are fewer than three vertices.
+double hull_width(const Point *hull, unsigned h, unsigned *edge);
+
+// The smallest enclosing rectangles by area and by perimeter, each of which
+// has a side on a hull edge. The box's axis is along that edge. A segment
+// gives a box of width 0 and a single point a box with no size.
+void hull_min_area_box(const Point *hull, unsigned h, OrientedBox *box);
+void hull_min_perimeter_box(const Point *hull, unsigned h, OrientedBox *box);
+
+// Writes the indices of the two farthest points to *a and *b with *a < *b and
+// returns false if there are fewer than two points. Points at the same
+// position are a pair at distance 0.
+bool farthest_pair(const Point *points, unsigned n, Point *scratch,
+                   unsigned *a, unsigned *b);
+
+double points_width(const Point *points, unsigned n, Point *scratch);
+
+void min_area_box(const Point *points, unsigned n, Point *scratch,
+                  OrientedBox *box);
+void min_perimeter_box(const Point *points, unsigned n, Point *scratch,
+                       OrientedBox *box);
+
+// Welzl's algorithm on a shuffled copy of the points in scratch, in expected
+// O(n). It needs only n points of scratch. The shuffle is seeded so results
+// are the same on every run. Returns a circle of radius 0 at the origin if
+// there are no points.
+void min_enclosing_circle(const Point *points, unsigned n, Point *scratch,
+                          Circle *circle);
+
+// The corners of the box in counterclockwise order.
+void oriented_box_corners(const OrientedBox *box, Point corners[4]);
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef SEGMENT_INTERSECTION_H
+#define SEGMENT_INTERSECTION_H
+
+#include "geometry/structure/segment.h"
+
+// A pair of intersecting segments, identified by their indices in the input
+// with a < b. For collinear overlaps, p is the leftmost point of the overlap.
+typedef struct {
+  unsigned a;
+  unsigned b;
+  Point p;
+} SegmentIntersection;
+
+typedef void (*intersection_callback_t)(SegmentIntersection, void *);
+
+// Reports every pair of intersecting closed segments exactly once, using a
+// Bentley-Ottmann sweep in O((n + k) log(n)) time for k intersecting pairs.
+// Handles vertical segments, collinear overlaps, shared endpoints and
+// degenerate single point segments. `data` is passed through to the callback.
+void segment_intersections_sweep(const Segment *segments, unsigned n,
+                                 intersection_callback_t callback, void *data);
+
+// Same as segment_intersections_sweep, but collects the pairs into a newly
+// allocated array and sets *count to its length.
+SegmentIntersection *segment_intersections(const Segment *segments, unsigned n,
+                                           unsigned *count);
+
+// Same as segment_intersections, but splits the plane into vertical strips with
+// similar numbers of segments and sweeps them on num_threads threads. Pairs are
+// returned in no particular order.
+SegmentIntersection *segment_intersections_parallel(const Segment *segments,
+                                                    unsigned n,
+                                                    unsigned num_threads,
+                                                    unsigned *count);
+
+// Whether any two of the closed segments intersect, using a Shamos-Hoey sweep
+// in O(n log(n)) that stops at the first intersecting pair found. If one is
+// found and pair is not NULL, it is written to *pair. With
+// ignore_shared_endpoints, segments that only touch at an endpoint they share
+// exactly do not count, so a simple polygon's edges report no intersection.
+bool segments_any_intersection(const Segment *segments, unsigned n,
+                               bool ignore_shared_endpoints,
+                               SegmentIntersection *pair);
+
+// Tests all pairs in O(n^2). Reports the same pairs and points as the sweep.
+SegmentIntersection *segment_intersections_brute_force(const Segment *segments,
+                                                       unsigned n,
+                                                       unsigned *count);
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef VORONOI_H
+#define VORONOI_H
+
+#include "geometry/structure/bbox.h"
+#include "geometry/structure/point.h"
+
+// A half-edge of a Voronoi diagram. The cell of site is on its left, and next
+// is the following half-edge counterclockwise around that cell. twin is the
+// half-edge in the opposite direction in the neighboring cell, or UINT_MAX for
+// half-edges along the bounding box.
+typedef struct {
+  unsigned origin;
+  unsigned twin;
+  unsigned next;
+  unsigned site;
+} VoronoiHalfEdge;
+
+// A Voronoi diagram clipped to a box, as a doubly connected edge list. Every
+// cell that meets the box is a closed convex polygon, and cells[i] is one of
+// its half-edges, or UINT_MAX if cell i does not meet the box.
+typedef struct {
+  Point *vertices;
+  VoronoiHalfEdge *edges;
+  unsigned *cells;
+  unsigned num_vertices;
+  unsigned num_edges;
+  unsigned num_sites;
+} VoronoiDiagram;
+
+// Computes the Voronoi diagram of the sites clipped to box with Fortune's
+// sweep in O(n log(n)). The beach line is a RedBlackTree of arcs, and circle
+// events are in a PriorityQueue, where events of arcs that change are
+// invalidated and skipped when they come up. Duplicate sites share a cell,
+// which belongs to the first of them and the rest have none. Four or more
+// cocircular sites give vertices joined by edges of zero length. Which arc a
+// site lands on and whether it comes before a circle event are decided
+// exactly, so the cells stay closed and convex for sites however close, with
+// only the vertices rounded. The box must have a positive area.
+void voronoi_diagram(const Point *sites, unsigned n, BBox box,
+                     VoronoiDiagram *out);
+
+void voronoi_diagram_free(VoronoiDiagram *diagram);
+
+// Checks that the half-edges link up into closed cycles around their cells
+// and that twins are consistent.
+void voronoi_diagram_validate(const VoronoiDiagram *diagram);
+
+#endif
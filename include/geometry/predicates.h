@@ -0,0 +1,78 @@
+#ifndef PREDICATES_H
+#define PREDICATES_H
+
+#include "geometry/structure/point.h"
+#include "geometry/structure/segment.h"
+
+// Robust geometric predicates after Shewchuk's adaptive precision predicates.
+// Each predicate first evaluates its determinant in plain floating point and
+// returns it if a forward error bound shows that the sign is right, which is
+// the case for almost every input. Otherwise it recomputes the determinant
+// with exact floating point expansions, stopping as soon as the sign is
+// certain. The sign of the result is always exact, the magnitude is only an
+// approximation.
+//
+// The predicates assume finite coordinates and no overflow or underflow in the
+// intermediate products.
+
+// Twice the signed area of the triangle abc. Positive if c lies to the left of
+// the directed line from a to b, so abc is counterclockwise, negative if it
+// lies to the right, and zero if the points are collinear.
+double orient2d(Point a, Point b, Point c);
+
+// Positive if d lies inside the circle through a, b and c, negative if it lies
+// outside, and zero if the four points are cocircular. a, b and c must be in
+// counterclockwise order, otherwise the sign is flipped.
+double incircle(Point a, Point b, Point c, Point d);
+
+// Compares the circles through a and through b that touch the horizontal line
+// through p at p. Positive if the one through a is larger, negative if it is
+// smaller, and zero if they are the same. Neither a nor b may lie above the
+// line or at p, and a point on the line has an infinite circle. With the sweep
+// line of Fortune's algorithm through p, the site with the smaller circle has
+// the higher parabola at p.
+double tangent_circle_compare(Point a, Point b, Point p);
+
+// Positive if the top of the circle through a, b and c is above the horizontal
+// line at y, negative if it is below, and zero if it is on it. a, b and c must
+// be in counterclockwise order. Fortune's algorithm compares circle events with
+// sites this way.
+int circle_top_compare(Point a, Point b, Point c, double y);
+
+// Cross product of the directions of s and t, s.p1 - s.p0 and t.p1 - t.p0.
+// Positive if t turns counterclockwise from s and zero if they are parallel.
+double direction_cross(Segment s, Segment t);
+
+// A point given either exactly, or as the crossing of two segments that meet
+// at a single point, which is rarely representable. The predicates below are
+// exact for both kinds. Crossings keep a rounded approximation with an error
+// bound, and fall back to exact arithmetic on the segments only when the
+// approximation cannot decide.
+typedef struct {
+  // The point, or the crossing rounded into both segments' boxes
+  Point approx;
+  // Bound on the distance from approx to the crossing on each axis, 0 for
+  // exact points and infinite for nearly parallel segments
+  double error;
+  bool crossing;
+  Segment s;
+  Segment t;
+} ImplicitPoint;
+
+ImplicitPoint implicit_point(Point p);
+
+// The crossing of s and t, which must intersect at a single point.
+ImplicitPoint implicit_crossing(Segment s, Segment t);
+
+// Negative, zero or positive as a comes before, at or after b, ordered by x
+// and then by y.
+int implicit_compare(const ImplicitPoint *a, const ImplicitPoint *b);
+
+// Negative, zero or positive as p's x is less than, equal to or greater than
+// x, which may be infinite.
+int implicit_compare_x(const ImplicitPoint *p, double x);
+
+// orient2d for a third point that may be a crossing.
+double implicit_orient2d(Point a, Point b, const ImplicitPoint *c);
+
+#endif
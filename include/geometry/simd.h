@@ -0,0 +1,22 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+// Runtime dispatch for the vectorized batch kernels. Kernels are compiled for
+// every level the compiler supports, and the level is picked once based on
+// what the CPU reports.
+
+typedef enum { SIMD_SCALAR, SIMD_AVX2, SIMD_AVX512 } SimdLevel;
+
+// The level batch kernels dispatch to. Defaults to the best level the CPU
+// supports.
+SimdLevel simd_level();
+// Caps the dispatch level, e.g. to test or benchmark the scalar kernels.
+// Levels the CPU does not support are clamped to the best supported level.
+void simd_set_level(SimdLevel level);
+SimdLevel simd_supported_level();
+
+// Allocates a buffer of n doubles aligned to a 64 byte cache line, so that
+// vector kernels can use aligned loads. Free with `free`.
+double *simd_alloc(unsigned n);
+
+#endif
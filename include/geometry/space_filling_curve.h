@@ -0,0 +1,60 @@
+#ifndef SPACE_FILLING_CURVE_H
+#define SPACE_FILLING_CURVE_H
+
+#include "geometry/structure/bbox.h"
+#include <stdint.h>
+
+// Morton (z-order) and Hilbert curve positions of grid cells, for ordering
+// points so that points close along the curve are close in the plane.
+//
+// Morton keys interleave the bits of the cell coordinates, x in the even bits
+// and y in the odd bits. On x86 CPUs with BMI2 they take one pdep per
+// coordinate and decoding one pext, picked at runtime unless simd_level is
+// capped to SIMD_SCALAR. Elsewhere they go through tables a byte at a time.
+// Hilbert keys are computed from the Morton key by a table driven state
+// machine that converts four levels of the curve per lookup.
+
+typedef enum { CURVE_MORTON, CURVE_HILBERT } SpaceFillingCurve;
+
+uint64_t morton_encode(uint32_t x, uint32_t y);
+void morton_decode(uint64_t key, uint32_t *x, uint32_t *y);
+
+// Position of (x, y) along a Hilbert curve over the 2^bits square grid, for
+// bits from 1 to 32. The curve starts at (0, 0) and ends at (2^bits - 1, 0).
+uint64_t hilbert_encode(uint32_t x, uint32_t y, unsigned bits);
+void hilbert_decode(uint64_t key, unsigned bits, uint32_t *x, uint32_t *y);
+
+// Square cells over a box, 2^bits on each side of the box's longer side, so
+// both axes are quantized alike. Points outside the box are clamped into the
+// cells on its edge.
+typedef struct {
+  Point min;
+  // Cells per unit
+  double scale;
+  unsigned bits;
+} CurveGrid;
+
+void curve_grid_init(CurveGrid *grid, BBox box, unsigned bits);
+void curve_grid_cell(const CurveGrid *grid, Point p, uint32_t *x,
+                     uint32_t *y);
+uint64_t curve_grid_key(const CurveGrid *grid, SpaceFillingCurve curve,
+                        Point p);
+
+// Writes the key of each of the n points to keys, checking once for BMI2
+// rather than once per point.
+void curve_grid_keys(const CurveGrid *grid, SpaceFillingCurve curve,
+                     const Point *points, unsigned n, uint64_t *keys);
+
+// Grid bits for ordering n points, enough for a few cells per point in each
+// direction, so points that share a cell are close enough to go in any order
+// and keys take few radix sort passes.
+unsigned curve_grid_bits(unsigned n);
+
+// Writes the indices of the points to order sorted along the curve over their
+// bounding box, with curve_grid_bits(n) bits. Keys are computed and radix
+// sorted on num_threads threads. Contiguous ranges of order are compact
+// regions, so they also split work between threads.
+void spatial_sort(const Point *points, unsigned n, SpaceFillingCurve curve,
+                  unsigned *order, unsigned num_threads);
+
+#endif
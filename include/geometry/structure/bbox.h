@@ -0,0 +1,86 @@
+#ifndef BBOX_H
+#define BBOX_H
+
+#include "geometry/structure/segment.h"
+
+// Closed axis-aligned bounding box.
+typedef struct {
+  double min_x;
+  double min_y;
+  double max_x;
+  double max_y;
+} BBox;
+
+// The box tests run in the inner loops of the spatial indexes, so they are
+// defined here where callers can inline them. They combine comparisons with &
+// instead of && and pick bounds with min/max selects, so they compile without
+// branches.
+
+static inline double bbox_min(double a, double b) { return a < b ? a : b; }
+static inline double bbox_max(double a, double b) { return a < b ? b : a; }
+
+static inline BBox bbox_from_corners(Point min, Point max) {
+  return (BBox){.min_x = min.x, .min_y = min.y, .max_x = max.x, .max_y = max.y};
+}
+
+static inline BBox bbox_from_point(Point p) {
+  return (BBox){.min_x = p.x, .min_y = p.y, .max_x = p.x, .max_y = p.y};
+}
+
+static inline BBox bbox_from_segment(Segment s) {
+  return (BBox){
+      .min_x = bbox_min(s.p0.x, s.p1.x),
+      .min_y = bbox_min(s.p0.y, s.p1.y),
+      .max_x = bbox_max(s.p0.x, s.p1.x),
+      .max_y = bbox_max(s.p0.y, s.p1.y),
+  };
+}
+
+static inline BBox bbox_union(BBox a, BBox b) {
+  return (BBox){
+      .min_x = bbox_min(a.min_x, b.min_x),
+      .min_y = bbox_min(a.min_y, b.min_y),
+      .max_x = bbox_max(a.max_x, b.max_x),
+      .max_y = bbox_max(a.max_y, b.max_y),
+  };
+}
+
+static inline bool bbox_overlaps(BBox a, BBox b) {
+  return (a.min_x <= b.max_x) & (b.min_x <= a.max_x) & (a.min_y <= b.max_y) &
+         (b.min_y <= a.max_y);
+}
+
+static inline bool bbox_contains_point(BBox b, Point p) {
+  return (p.x >= b.min_x) & (p.x <= b.max_x) & (p.y >= b.min_y) &
+         (p.y <= b.max_y);
+}
+
+// Squared distance from p to the closest point of the box, 0 inside it.
+static inline double bbox_squared_distance(BBox b, Point p) {
+  double dx = bbox_max(bbox_max(b.min_x - p.x, p.x - b.max_x), 0);
+  double dy = bbox_max(bbox_max(b.min_y - p.y, p.y - b.max_y), 0);
+  return dx * dx + dy * dy;
+}
+
+static inline double bbox_area(BBox b) {
+  return (b.max_x - b.min_x) * (b.max_y - b.min_y);
+}
+
+// Half the perimeter.
+static inline double bbox_margin(BBox b) {
+  return (b.max_x - b.min_x) + (b.max_y - b.min_y);
+}
+
+// Area of the intersection of the boxes, 0 if they do not overlap.
+static inline double bbox_overlap_area(BBox a, BBox b) {
+  double w = bbox_min(a.max_x, b.max_x) - bbox_max(a.min_x, b.min_x);
+  double h = bbox_min(a.max_y, b.max_y) - bbox_max(a.min_y, b.min_y);
+  return bbox_max(w, 0) * bbox_max(h, 0);
+}
+
+// Whether the closed segment s intersects the closed box b: their boxes
+// overlap and the box's corners are not all strictly on one side of the
+// segment's line. The sides are decided with orient2d, so the answer is exact.
+bool segment_intersects_bbox(Segment s, BBox b);
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef BBOX_ARRAY_H
+#define BBOX_ARRAY_H
+
+#include "geometry/structure/bbox.h"
+#include <stdint.h>
+
+// Structure of arrays container for bounding boxes. Each bound lives in its own
+// contiguous, 64 byte aligned buffer so that batch kernels can test several
+// boxes per instruction.
+typedef struct {
+  double *min_xs;
+  double *min_ys;
+  double *max_xs;
+  double *max_ys;
+  unsigned size;
+  unsigned capacity;
+} BBoxArray;
+
+void bbox_array_init(BBoxArray *arr);
+void bbox_array_initn(BBoxArray *arr, unsigned n);
+void bbox_array_from_boxes(BBoxArray *arr, const BBox *boxes, unsigned n);
+void bbox_array_free(BBoxArray *arr);
+
+void bbox_array_push(BBoxArray *arr, BBox b);
+BBox bbox_array_get(const BBoxArray *arr, unsigned i);
+void bbox_array_set(BBoxArray *arr, unsigned i, BBox b);
+// Grows the capacity to at least n boxes. Never shrinks.
+void bbox_array_reserve(BBoxArray *arr, unsigned n);
+void bbox_array_clear(BBoxArray *arr);
+
+// Number of 64 bit words needed for a bitmask over n boxes.
+unsigned bbox_bitmask_words(unsigned n);
+
+// Tests query against every box in arr. Bit i % 64 of out_bitmask[i / 64] is
+// set if query overlaps the ith box. out_bitmask must have room for
+// bbox_bitmask_words(arr->size) words.
+void bbox_overlaps_many(BBox query, const BBoxArray *arr,
+                        uint64_t *out_bitmask);
+
+void bbox_array_validate(const BBoxArray *arr);
+
+#endif
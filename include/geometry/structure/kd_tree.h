@@ -0,0 +1,49 @@
+#ifndef KD_TREE_H
+#define KD_TREE_H
+
+#include "geometry/structure/point.h"
+
+// Static 2-d tree over points. The tree is implicit: the points of a subtree
+// occupy a range of the points array with the subtree's root at the middle of
+// the range, the left subtree before it and the right subtree after it. The
+// root of the whole tree splits on x and the levels alternate between x and y.
+//
+// Points are copied into the tree in tree order. ids maps each of them back
+// to its index in the input.
+typedef struct {
+  Point *points;
+  unsigned *ids;
+  unsigned size;
+} KDTree;
+
+typedef void (*kd_tree_callback_t)(unsigned id, void *data);
+
+// Builds the tree in expected O(n log(n)) time by selecting the median of
+// every range rather than sorting.
+void kd_tree_init(KDTree *tree, const Point *points, unsigned n);
+void kd_tree_free(KDTree *tree);
+
+// Writes the ids of the k points nearest to p to ids, nearest first, and
+// returns how many were written, which is less than k only if the tree holds
+// fewer than k points. Ties are broken arbitrarily.
+unsigned kd_tree_nearest(const KDTree *tree, Point p, unsigned k,
+                         unsigned *ids);
+
+// Calls callback once for every point within radius of p, and returns their
+// number.
+unsigned kd_tree_query_radius(const KDTree *tree, Point p, double radius,
+                              kd_tree_callback_t callback, void *data);
+
+// Calls callback once for every point in the closed box from min to max, and
+// returns their number.
+unsigned kd_tree_query_box(const KDTree *tree, Point min, Point max,
+                           kd_tree_callback_t callback, void *data);
+
+// Runs kd_tree_nearest for each of the m queries on num_threads threads. The
+// results of query i are written to ids[i * k..(i + 1) * k) and their number
+// to counts[i].
+void kd_tree_nearest_batch(const KDTree *tree, const Point *queries,
+                           unsigned m, unsigned k, unsigned *ids,
+                           unsigned *counts, unsigned num_threads);
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef POINT_ARRAY_H
+#define POINT_ARRAY_H
+
+#include "geometry/structure/point.h"
+
+// Structure of arrays container for points. The coordinates are stored in two
+// contiguous, 64 byte aligned buffers so that batch kernels can load several
+// points per instruction.
+typedef struct {
+  double *xs;
+  double *ys;
+  unsigned size;
+  unsigned capacity;
+} PointArray;
+
+void point_array_init(PointArray *arr);
+void point_array_initn(PointArray *arr, unsigned n);
+void point_array_from_points(PointArray *arr, const Point *points, unsigned n);
+void point_array_free(PointArray *arr);
+
+void point_array_push(PointArray *arr, Point p);
+Point point_array_get(const PointArray *arr, unsigned i);
+void point_array_set(PointArray *arr, unsigned i, Point p);
+// Grows the capacity to at least n points. Never shrinks.
+void point_array_reserve(PointArray *arr, unsigned n);
+void point_array_clear(PointArray *arr);
+
+// Batch kernels. `out` must have room for arr->size values, and out[i]
+// corresponds to the ith point.
+void point_array_distances(const PointArray *arr, Point p, double *out);
+void point_array_squared_distances(const PointArray *arr, Point p, double *out);
+// Smallest and largest coordinates over all points. The array must be
+// non-empty.
+void point_array_bounds(const PointArray *arr, Point *min, Point *max);
+Point point_array_centroid(const PointArray *arr);
+
+void point_array_validate(const PointArray *arr);
+
+#endif
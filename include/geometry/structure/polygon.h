@@ -0,0 +1,141 @@
+#ifndef POLYGON_H
+#define POLYGON_H
+
+#include "geometry/structure/bbox.h"
+#include "geometry/structure/rtree.h"
+
+// Where a point lies relative to a polygon.
+typedef enum {
+  POLYGON_OUTSIDE,
+  POLYGON_BOUNDARY,
+  POLYGON_INSIDE,
+} PolygonLocation;
+
+// A polygon with holes, as rings of points. Ring 0 is the outer boundary and
+// the others are holes. Each ring is closed implicitly, its last point
+// connecting back to its first, and the vertices of all rings are stored back
+// to back in points. Ring r is points[ring_starts[r]..ring_starts[r + 1]).
+//
+// Rings may wind either way. Inside is decided by the even-odd rule, so a
+// point is inside if it is inside the outer ring and not inside any hole.
+typedef struct {
+  Point *points;
+  unsigned *ring_starts;
+  unsigned num_rings;
+  unsigned num_points;
+} Polygon;
+
+// Initializes a polygon whose outer ring is the n points.
+void polygon_init(Polygon *poly, const Point *points, unsigned n);
+void polygon_free(Polygon *poly);
+void polygon_add_hole(Polygon *poly, const Point *points, unsigned n);
+
+unsigned polygon_ring_size(const Polygon *poly, unsigned ring);
+// The edge from vertex i of the ring to the next one.
+Segment polygon_edge(const Polygon *poly, unsigned ring, unsigned i);
+
+// Area enclosed by a ring, positive if the ring winds counterclockwise.
+double polygon_ring_signed_area(const Polygon *poly, unsigned ring);
+// Area of the outer ring minus the areas of the holes.
+double polygon_area(const Polygon *poly);
+// Whether the outer ring winds counterclockwise.
+bool polygon_is_ccw(const Polygon *poly);
+// Reverses rings as needed so the outer ring winds counterclockwise and the
+// holes clockwise.
+void polygon_orient(Polygon *poly);
+
+BBox polygon_bbox(const Polygon *poly);
+
+// Locates p by casting a ray to the right and counting the edges it crosses,
+// in O(n). Points on an edge are on the boundary. Sides are decided with
+// orient2d, so the answer is exact.
+PolygonLocation polygon_locate(const Polygon *poly, Point p);
+
+void polygon_validate(const Polygon *poly);
+
+// A set of disjoint polygons with holes, such as the result of a boolean
+// operation. The rings of all polygons share one growing buffer of points,
+// laid out as in Polygon, so building a set takes a few allocations no matter
+// how many rings it has. Polygon i is rings
+// polygon_starts[i]..polygon_starts[i + 1], its outer ring first, then its
+// holes. Outer rings wind counterclockwise and holes clockwise.
+typedef struct {
+  Point *points;
+  unsigned *ring_starts;
+  unsigned *polygon_starts;
+  unsigned num_points;
+  unsigned num_rings;
+  unsigned num_polygons;
+  unsigned points_capacity;
+  unsigned rings_capacity;
+  unsigned polygons_capacity;
+} PolygonSet;
+
+void polygon_set_init(PolygonSet *set);
+void polygon_set_free(PolygonSet *set);
+// Appends a copy of the n points as a ring, reversed if needed to wind the
+// right way. A ring that is not a hole starts a new polygon.
+void polygon_set_add_ring(PolygonSet *set, const Point *points, unsigned n,
+                          bool is_hole);
+void polygon_set_add_polygon(PolygonSet *set, const Polygon *poly);
+void polygon_set_clear(PolygonSet *set);
+// Copies polygon i of the set into a newly initialized polygon.
+void polygon_set_get(const PolygonSet *set, unsigned i, Polygon *out);
+double polygon_set_area(const PolygonSet *set);
+// Locates p by the even-odd rule over all rings, which is exact for a set of
+// disjoint polygons.
+PolygonLocation polygon_set_locate(const PolygonSet *set, Point p);
+void polygon_set_validate(const PolygonSet *set);
+
+// Slab index over the edges of one polygon, for locating many points in it.
+// The polygon's box is cut into horizontal slabs of equal height and every
+// edge is listed in each slab its y range overlaps. Locating a point only
+// tests the edges of its slab, which holds every edge its ray can cross. The
+// edges are copied slab by slab, so a query reads one contiguous run.
+//
+// There are about as many slabs as edges, fewer if long edges would be listed
+// too many times, so a slab holds O(1) edges for most polygons.
+typedef struct {
+  BBox box;
+  // Slabs per unit of y
+  double scale;
+  unsigned num_slabs;
+  // Slab s is edges[slab_starts[s]..slab_starts[s + 1])
+  unsigned *slab_starts;
+  Segment *edges;
+} PolygonSlabs;
+
+void polygon_slabs_init(PolygonSlabs *slabs, const Polygon *poly);
+void polygon_slabs_free(PolygonSlabs *slabs);
+// The same answer as polygon_locate.
+PolygonLocation polygon_slabs_locate(const PolygonSlabs *slabs, Point p);
+// Locates each of the n points on num_threads threads.
+void polygon_slabs_locate_many(const PolygonSlabs *slabs, const Point *points,
+                               unsigned n, PolygonLocation *out,
+                               unsigned num_threads);
+
+// Index over a set of polygons, for finding the polygon each of many points is
+// in. An R-tree over the polygons' boxes finds the candidates for a point and
+// each candidate's slab index decides.
+typedef struct {
+  PolygonSlabs *slabs;
+  unsigned size;
+  // Holds the diagonal of each polygon's box, whose bounding box is the
+  // polygon's box
+  RTree boxes;
+} PolygonIndex;
+
+// Builds slab indexes for the n polygons and bulk loads their boxes, on
+// num_threads threads. Polygons are identified by their index.
+void polygon_index_init(PolygonIndex *index, const Polygon *polygons,
+                        unsigned n, unsigned num_threads);
+void polygon_index_free(PolygonIndex *index);
+// The smallest id of a polygon that contains p, on its boundary or inside, or
+// UINT_MAX if there is none.
+unsigned polygon_index_locate(const PolygonIndex *index, Point p);
+// Runs polygon_index_locate for each of the n points on num_threads threads.
+void polygon_index_locate_many(const PolygonIndex *index, const Point *points,
+                               unsigned n, unsigned *out,
+                               unsigned num_threads);
+
+#endif
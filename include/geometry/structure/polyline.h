@@ -0,0 +1,51 @@
+#ifndef POLYLINE_H
+#define POLYLINE_H
+
+#include "geometry/structure/bbox.h"
+
+// An open chain of points, each joined to the next by a segment. A closed
+// chain repeats its first point at the end.
+typedef struct {
+  Point *points;
+  unsigned num_points;
+} Polyline;
+
+// Initializes a polyline with a copy of the n points.
+void polyline_init(Polyline *line, const Point *points, unsigned n);
+void polyline_free(Polyline *line);
+
+// The segment from point i to point i + 1.
+Segment polyline_segment(const Polyline *line, unsigned i);
+double polyline_length(const Polyline *line);
+BBox polyline_bbox(const Polyline *line);
+
+void polyline_validate(const Polyline *line);
+
+// Many polylines in one growing buffer of points, so that a batch of lines
+// takes a few allocations no matter how many there are. Line i is
+// points[line_starts[i]..line_starts[i + 1]).
+typedef struct {
+  Point *points;
+  unsigned *line_starts;
+  unsigned num_points;
+  unsigned num_lines;
+  unsigned points_capacity;
+  unsigned lines_capacity;
+} PolylineSet;
+
+void polyline_set_init(PolylineSet *set);
+void polyline_set_free(PolylineSet *set);
+void polyline_set_clear(PolylineSet *set);
+// Grows the capacity to at least num_points points in num_lines lines. Never
+// shrinks.
+void polyline_set_reserve(PolylineSet *set, unsigned num_points,
+                          unsigned num_lines);
+// Appends a copy of the n points as a line.
+void polyline_set_add(PolylineSet *set, const Point *points, unsigned n);
+unsigned polyline_set_line_size(const PolylineSet *set, unsigned i);
+// Copies line i of the set into a newly initialized polyline.
+void polyline_set_get(const PolylineSet *set, unsigned i, Polyline *out);
+
+void polyline_set_validate(const PolylineSet *set);
+
+#endif
@@ -0,0 +1,98 @@
+#ifndef QUADTREE_H
+#define QUADTREE_H
+
+#include "data_structure/vector.h"
+#include "geometry/structure/segment.h"
+
+// Nodes split when they hold more than this many items.
+#define QUADTREE_NODE_CAPACITY 8
+// Nodes whose subtree falls to this many items absorb their descendants.
+#define QUADTREE_MERGE_THRESHOLD 4
+// Nodes are not split once their cells are this many levels below the initial
+// root.
+#define QUADTREE_MAX_DEPTH 24
+
+// A square cell of the tree. The four children of a node are stored next to
+// each other starting at first_child, in the order bottom left, bottom right,
+// top left, top right.
+typedef struct {
+  double center_x;
+  double center_y;
+  double half;
+  unsigned first_child;
+  unsigned parent;
+  // First item of the node's list of items
+  unsigned head;
+  // Items in this node
+  unsigned count;
+  // Items in this node and its descendants
+  unsigned total;
+} QuadTreeNode;
+
+// Loose quadtree over points and segments for objects that move. An item is
+// kept in the deepest node whose cell contains the center of its bounding box
+// and whose half side is at least half the longer side of the box. The box is
+// then within the node's loose cell, which is the cell doubled in size around
+// its center, so moving an item only relinks it when its center leaves the
+// cell. When an item's center leaves the root, the root grows by doubling
+// until it covers it. Items with coordinates that are not finite are kept in
+// the root.
+//
+// Nodes come from a pool in blocks of four siblings and items are linked into
+// their nodes through index lists, so updates do not allocate once the pools
+// have grown. Children are merged back lazily, when deletion leaves a subtree
+// with at most QUADTREE_MERGE_THRESHOLD items, so nodes near the split size do
+// not split and merge on every update.
+typedef struct {
+  QuadTreeNode *nodes;
+  unsigned num_nodes;
+  unsigned node_capacity;
+  // First node of each free block of four
+  Vector free_blocks;
+  // Half side below which nodes are not split
+  double min_half;
+
+  // Item geometry by id. Points are stored as single point segments.
+  Segment *items;
+  unsigned *item_node;
+  unsigned *next;
+  unsigned *prev;
+  bool *alive;
+  // Number of live items
+  unsigned size;
+  // Number of ids handed out, including deleted ones
+  unsigned end;
+  unsigned capacity;
+  Vector free_ids;
+} QuadTree;
+
+typedef void (*quadtree_callback_t)(unsigned id, void *data);
+
+// Initializes an empty tree whose root starts as the square with corner min
+// that covers max.
+void quadtree_init(QuadTree *tree, Point min, Point max);
+void quadtree_free(QuadTree *tree);
+
+unsigned quadtree_insert_point(QuadTree *tree, Point p);
+unsigned quadtree_insert_segment(QuadTree *tree, Segment s);
+// Returns false if there is no item with the id.
+bool quadtree_delete(QuadTree *tree, unsigned id);
+// Replaces the geometry of an item, keeping its id. Returns false if there is
+// no item with the id.
+bool quadtree_move(QuadTree *tree, unsigned id, Segment s);
+Segment quadtree_get(const QuadTree *tree, unsigned id);
+
+// Calls callback once for every item that intersects the closed box from min
+// to max. Returns the number of items found.
+unsigned quadtree_query_box(const QuadTree *tree, Point min, Point max,
+                            quadtree_callback_t callback, void *data);
+
+// Writes the ids of the k items nearest to p to ids, nearest first, and returns
+// how many were written. Fewer than k are written if the tree holds fewer
+// items. Distances are to the closest point of each item.
+unsigned quadtree_nearest(const QuadTree *tree, Point p, unsigned k,
+                          unsigned *ids);
+
+void quadtree_validate(const QuadTree *tree);
+
+#endif
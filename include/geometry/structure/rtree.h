@@ -0,0 +1,90 @@
+#ifndef RTREE_H
+#define RTREE_H
+
+#include "data_structure/vector.h"
+#include "geometry/structure/segment.h"
+
+#define RTREE_MAX_ENTRIES 8
+#define RTREE_MIN_ENTRIES 3
+
+// A node's entries are stored as a structure of arrays, so each bounding box
+// coordinate of all entries fills one 64 byte cache line. Entries of leaves
+// are item ids, and entries of internal nodes are node indices.
+typedef struct {
+  alignas(64) double min_x[RTREE_MAX_ENTRIES];
+  double min_y[RTREE_MAX_ENTRIES];
+  double max_x[RTREE_MAX_ENTRIES];
+  double max_y[RTREE_MAX_ENTRIES];
+  unsigned children[RTREE_MAX_ENTRIES];
+  unsigned count;
+  unsigned parent;
+  bool leaf;
+} RTreeNode;
+
+// R-tree over points and segments, indexed by their bounding boxes. Nodes live
+// in one flat array and refer to each other by index.
+//
+// rtree_bulk_load packs a tree with Sort-Tile-Recursive. Insertions choose
+// subtrees and split nodes the way the R*-tree does.
+//
+// Items are identified by the id returned on insertion, or by their index for
+// bulk loaded items. Ids of deleted items are reused.
+typedef struct {
+  RTreeNode *nodes;
+  unsigned num_nodes;
+  unsigned node_capacity;
+  Vector free_nodes;
+  unsigned root;
+  // Number of levels, with leaves at height 1
+  unsigned height;
+
+  // Item geometry by id. Points are stored as single point segments.
+  Segment *items;
+  // Leaf holding each item
+  unsigned *item_leaf;
+  bool *alive;
+  // Number of live items
+  unsigned size;
+  // Number of ids handed out, including deleted ones
+  unsigned end;
+  unsigned capacity;
+  Vector free_ids;
+} RTree;
+
+typedef void (*rtree_callback_t)(unsigned id, void *data);
+
+void rtree_init(RTree *tree);
+void rtree_free(RTree *tree);
+
+// Replaces the contents of tree with the segments, giving the ith segment id
+// i. Sorts run on num_threads threads.
+void rtree_bulk_load(RTree *tree, const Segment *segments, unsigned n,
+                     unsigned num_threads);
+void rtree_bulk_load_points(RTree *tree, const Point *points, unsigned n,
+                            unsigned num_threads);
+
+unsigned rtree_insert_point(RTree *tree, Point p);
+unsigned rtree_insert_segment(RTree *tree, Segment s);
+// Returns false if there is no item with the id.
+bool rtree_delete(RTree *tree, unsigned id);
+Segment rtree_get(const RTree *tree, unsigned id);
+
+// Calls callback once for every item that intersects the closed box from min
+// to max. Returns the number of items found.
+unsigned rtree_query_box(const RTree *tree, Point min, Point max,
+                         rtree_callback_t callback, void *data);
+
+// Calls callback once for every item whose bounding box s passes through.
+// These are the candidates for intersecting s. Returns the number of items
+// found.
+unsigned rtree_query_segment(const RTree *tree, Segment s,
+                             rtree_callback_t callback, void *data);
+
+// Writes the ids of the k items nearest to p to ids, nearest first, and returns
+// how many were written. Fewer than k are written if the tree holds fewer
+// items. Distances are to the closest point of each item.
+unsigned rtree_nearest(const RTree *tree, Point p, unsigned k, unsigned *ids);
+
+void rtree_validate(const RTree *tree);
+
+#endif
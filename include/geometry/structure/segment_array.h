@@ -0,0 +1,53 @@
+#ifndef SEGMENT_ARRAY_H
+#define SEGMENT_ARRAY_H
+
+#include "geometry/structure/bbox_array.h"
+#include "geometry/structure/segment.h"
+#include <stdint.h>
+
+// Structure of arrays container for segments. Each endpoint coordinate lives in
+// its own contiguous, 64 byte aligned buffer so that batch kernels can test
+// several segments per instruction. The bounding box of every segment is kept
+// alongside in boxes, which always has the same size.
+typedef struct {
+  double *x0s;
+  double *y0s;
+  double *x1s;
+  double *y1s;
+  BBoxArray boxes;
+  unsigned size;
+  unsigned capacity;
+} SegmentArray;
+
+void segment_array_init(SegmentArray *arr);
+void segment_array_initn(SegmentArray *arr, unsigned n);
+void segment_array_from_segments(SegmentArray *arr, const Segment *segments,
+                                 unsigned n);
+void segment_array_free(SegmentArray *arr);
+
+void segment_array_push(SegmentArray *arr, Segment s);
+Segment segment_array_get(const SegmentArray *arr, unsigned i);
+void segment_array_set(SegmentArray *arr, unsigned i, Segment s);
+// Grows the capacity to at least n segments. Never shrinks.
+void segment_array_reserve(SegmentArray *arr, unsigned n);
+void segment_array_clear(SegmentArray *arr);
+
+// Number of 64 bit words needed for a bitmask over n segments.
+unsigned segment_bitmask_words(unsigned n);
+
+// Tests query against every segment in arr. Bit i % 64 of out_bitmask[i / 64]
+// is set if query intersects the ith segment. out_bitmask must have room for
+// segment_bitmask_words(arr->size) words.
+//
+// Segments are closed: touching endpoints and collinear overlaps intersect.
+// The test uses orientation signs and a bounding box overlap check against the
+// cached boxes, with no divisions. Runs of segments whose boxes all miss the
+// query's box skip the orientation math. Segments with an orientation too close
+// to zero for floating point to be sure of its sign are retested with
+// segment_intersects, so the result is exact.
+void segment_intersects_many(Segment query, const SegmentArray *arr,
+                             uint64_t *out_bitmask);
+
+void segment_array_validate(const SegmentArray *arr);
+
+#endif
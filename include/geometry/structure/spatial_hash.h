@@ -0,0 +1,70 @@
+#ifndef SPATIAL_HASH_H
+#define SPATIAL_HASH_H
+
+#include "data_structure/hash.h"
+#include "data_structure/vector.h"
+#include "geometry/structure/segment.h"
+
+// Uniform grid index over points and segments. The plane is divided into
+// square cells of side cell_size, and only occupied cells are stored, keyed by
+// their integer coordinates in a Hash. A segment is stored in every cell it
+// passes through, and a point in the cell containing it.
+//
+// Items are identified by the id returned on insertion. Ids of deleted items
+// are reused. Queries are not thread safe, since they mark visited items to
+// report each item once.
+typedef struct {
+  Hash cells;
+  // Occupied cells, to iterate over them
+  Vector occupied;
+  double cell_size;
+  // Item geometry by id. Points are stored as single point segments.
+  Segment *items;
+  bool *alive;
+  unsigned *stamps;
+  unsigned stamp;
+  // Number of live items
+  unsigned size;
+  // Number of ids handed out, including deleted ones
+  unsigned end;
+  unsigned capacity;
+  Vector free_ids;
+} SpatialHash;
+
+typedef void (*spatial_hash_callback_t)(unsigned id, void *data);
+typedef void (*spatial_hash_pair_callback_t)(unsigned a, unsigned b,
+                                             void *data);
+
+void spatial_hash_init(SpatialHash *hash, double cell_size);
+void spatial_hash_free(SpatialHash *hash);
+
+// Cell sizes tuned for the given data, so that cells hold a few items each. The
+// size is the larger of the side of a cell holding one item on average over
+// the data's bounding box, and the average item extent.
+double spatial_hash_cell_size(const Segment *segments, unsigned n);
+double spatial_hash_cell_size_points(const Point *points, unsigned n);
+
+unsigned spatial_hash_insert_point(SpatialHash *hash, Point p);
+unsigned spatial_hash_insert_segment(SpatialHash *hash, Segment s);
+// Returns false if there is no item with the id.
+bool spatial_hash_delete(SpatialHash *hash, unsigned id);
+Segment spatial_hash_get(const SpatialHash *hash, unsigned id);
+
+// Calls callback once for every item that intersects the closed box from min to
+// max, or that is within radius of center. Returns the number of items found.
+unsigned spatial_hash_query_box(SpatialHash *hash, Point min, Point max,
+                                spatial_hash_callback_t callback, void *data);
+unsigned spatial_hash_query_radius(SpatialHash *hash, Point center,
+                                   double radius,
+                                   spatial_hash_callback_t callback,
+                                   void *data);
+
+// Calls callback once for every pair of items that share a cell, with a < b.
+// Every pair of intersecting items is among them. Returns the number of pairs.
+unsigned spatial_hash_candidate_pairs(SpatialHash *hash,
+                                      spatial_hash_pair_callback_t callback,
+                                      void *data);
+
+void spatial_hash_validate(const SpatialHash *hash);
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef TRAPEZOIDAL_MAP_H
+#define TRAPEZOIDAL_MAP_H
+
+#include "geometry/structure/segment.h"
+
+// A face of the trapezoidal map, between its top and bottom segments and the
+// vertical walls through its left and right points. top and bottom are
+// indices of input segments, UINT_MAX where the trapezoid is unbounded. The
+// first and last trapezoids along the x axis have infinite left and right
+// points.
+typedef struct {
+  unsigned top;
+  unsigned bottom;
+  Point left;
+  Point right;
+} Trapezoid;
+
+typedef enum {
+  // Splits on the vertical line through endpoint index of the segments,
+  // which is segments[index / 2].p1 if index is odd and .p0 otherwise
+  TRAPEZOIDAL_MAP_X_NODE,
+  // Splits on segment index, with points on it above
+  TRAPEZOIDAL_MAP_Y_NODE,
+  // Trapezoid index
+  TRAPEZOIDAL_MAP_LEAF,
+} TrapezoidalMapNodeKind;
+
+// A node of the search DAG. left is the child for points left of or below the
+// split and right the child for points right of or above it.
+typedef struct {
+  TrapezoidalMapNodeKind kind;
+  unsigned index;
+  unsigned left;
+  unsigned right;
+} TrapezoidalMapNode;
+
+// The trapezoidal map of a set of segments, with the search DAG that locates
+// points in it. Points are ordered by x and then by y, which shears the plane
+// just enough that no two endpoints share a vertical line, so vertical
+// segments and shared x coordinates need no special cases.
+//
+// The DAG's nodes are in a flat array in breadth-first order from the root,
+// nodes[0], so the top levels every query passes through share cache lines.
+typedef struct {
+  // The input segments, each with p0 before p1
+  Segment *segments;
+  Trapezoid *trapezoids;
+  TrapezoidalMapNode *nodes;
+  unsigned num_segments;
+  unsigned num_trapezoids;
+  unsigned num_nodes;
+} TrapezoidalMap;
+
+// Inserts the segments in a random order, seeded so the map is the same on
+// every run, for expected O(n log(n)) time, O(n) size and O(log(n)) query
+// depth. Segments must not cross or overlap, but may share endpoints.
+// Segments that are a single point are left out of the map.
+void trapezoidal_map_init(TrapezoidalMap *map, const Segment *segments,
+                          unsigned n);
+void trapezoidal_map_free(TrapezoidalMap *map);
+
+// The index of the trapezoid that contains p. Its bottom segment is the first
+// segment hit by a ray from p straight down. Points on a segment are above it,
+// and an endpoint is right of itself, so it is in the trapezoid above every
+// segment that leaves it to the right.
+unsigned trapezoidal_map_locate(const TrapezoidalMap *map, Point p);
+
+// Runs trapezoidal_map_locate for each of the n points on num_threads threads.
+// The points are first sorted with spatial_sort along a Hilbert curve, so
+// consecutive queries follow mostly the same path through the DAG and touch
+// the same trapezoids.
+void trapezoidal_map_locate_many(const TrapezoidalMap *map,
+                                 const Point *points, unsigned n,
+                                 unsigned *out, unsigned num_threads);
+
+#endif
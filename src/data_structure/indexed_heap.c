@@ -0,0 +1,147 @@
+// Indexed min heap. Unlike PriorityQueue, whose elements are opaque, the heap
+// holds small integer ids and keeps a position per id, which is what lets a
+// key change in place instead of pushing a duplicate and skipping stale
+// entries later.
+#include "data_structure/indexed_heap.h"
+#include <assert.h>
+#include <limits.h>
+#include <stdlib.h>
+
+static bool is_less(const IndexedHeap *heap, unsigned a, unsigned b) {
+  double ka = heap->keys[a];
+  double kb = heap->keys[b];
+  return ka < kb || (ka == kb && a < b);
+}
+
+static void place(IndexedHeap *heap, unsigned i, unsigned id) {
+  heap->ids[i] = id;
+  heap->positions[id] = i;
+}
+
+static void sift_up(IndexedHeap *heap, unsigned i) {
+  unsigned id = heap->ids[i];
+  while (i > 0) {
+    unsigned parent = (i - 1) / 2;
+    if (!is_less(heap, id, heap->ids[parent])) {
+      break;
+    }
+    place(heap, i, heap->ids[parent]);
+    i = parent;
+  }
+  place(heap, i, id);
+}
+
+static void sift_down(IndexedHeap *heap, unsigned i) {
+  unsigned id = heap->ids[i];
+  for (;;) {
+    unsigned child = i * 2 + 1;
+    if (child >= heap->size) {
+      break;
+    }
+    if (child + 1 < heap->size &&
+        is_less(heap, heap->ids[child + 1], heap->ids[child])) {
+      ++child;
+    }
+    if (!is_less(heap, heap->ids[child], id)) {
+      break;
+    }
+    place(heap, i, heap->ids[child]);
+    i = child;
+  }
+  place(heap, i, id);
+}
+
+void indexed_heap_init(IndexedHeap *heap, unsigned capacity) {
+  unsigned n = capacity > 0 ? capacity : 1;
+  *heap = (IndexedHeap){
+      .ids = malloc(sizeof(unsigned) * n),
+      .keys = malloc(sizeof(double) * n),
+      .positions = malloc(sizeof(unsigned) * n),
+      .size = 0,
+      .capacity = capacity,
+  };
+  for (unsigned id = 0; id < capacity; ++id) {
+    heap->positions[id] = UINT_MAX;
+  }
+}
+
+void indexed_heap_free(IndexedHeap *heap) {
+  indexed_heap_validate(heap);
+  free(heap->ids);
+  free(heap->keys);
+  free(heap->positions);
+}
+
+void indexed_heap_clear(IndexedHeap *heap) {
+  indexed_heap_validate(heap);
+  for (unsigned i = 0; i < heap->size; ++i) {
+    heap->positions[heap->ids[i]] = UINT_MAX;
+  }
+  heap->size = 0;
+}
+
+bool indexed_heap_contains(const IndexedHeap *heap, unsigned id) {
+  assert(id < heap->capacity && "indexed heap id out of bounds");
+  return heap->positions[id] != UINT_MAX;
+}
+
+void indexed_heap_update(IndexedHeap *heap, unsigned id, double key) {
+  indexed_heap_validate(heap);
+  assert(id < heap->capacity && "indexed heap id out of bounds");
+  unsigned i = heap->positions[id];
+  if (i == UINT_MAX) {
+    heap->keys[id] = key;
+    place(heap, heap->size, id);
+    sift_up(heap, heap->size++);
+    return;
+  }
+  double old = heap->keys[id];
+  heap->keys[id] = key;
+  if (key < old) {
+    sift_up(heap, i);
+  } else {
+    sift_down(heap, i);
+  }
+}
+
+void indexed_heap_remove(IndexedHeap *heap, unsigned id) {
+  indexed_heap_validate(heap);
+  assert(id < heap->capacity && "indexed heap id out of bounds");
+  unsigned i = heap->positions[id];
+  if (i == UINT_MAX) {
+    return;
+  }
+  heap->positions[id] = UINT_MAX;
+  unsigned last = heap->ids[--heap->size];
+  if (i == heap->size) {
+    return;
+  }
+  // The last id may belong above or below the hole
+  place(heap, i, last);
+  if (i > 0 && is_less(heap, last, heap->ids[(i - 1) / 2])) {
+    sift_up(heap, i);
+  } else {
+    sift_down(heap, i);
+  }
+}
+
+unsigned indexed_heap_peek(const IndexedHeap *heap) {
+  indexed_heap_validate(heap);
+  return heap->size ? heap->ids[0] : UINT_MAX;
+}
+
+unsigned indexed_heap_pop(IndexedHeap *heap) {
+  unsigned id = indexed_heap_peek(heap);
+  if (id != UINT_MAX) {
+    indexed_heap_remove(heap, id);
+  }
+  return id;
+}
+
+void indexed_heap_validate(const IndexedHeap *heap) {
+  assert(heap && "indexed heap must not be null");
+  assert(heap->ids && heap->keys && heap->positions &&
+         "indexed heap buffers must not be null");
+  assert(heap->size <= heap->capacity &&
+         "indexed heap capacity must be >= size");
+}
@@ -0,0 +1,29 @@
+#include "data_structure/parallel.h"
+#include <assert.h>
+#include <pthread.h>
+#include <stdlib.h>
+
+void parallel_for(unsigned n_chunks, void *(*fn)(void *), void *ctx,
+                  size_t stride) {
+  assert((ctx || n_chunks == 0) && "cannot run NULL chunks");
+  if (n_chunks == 0) {
+    return;
+  }
+  char *chunks = ctx;
+  pthread_t *threads = malloc(sizeof(pthread_t) * n_chunks);
+  bool *started = malloc(sizeof(bool) * n_chunks);
+  for (unsigned t = 1; t < n_chunks; ++t) {
+    started[t] =
+        pthread_create(&threads[t], NULL, fn, chunks + t * stride) == 0;
+  }
+  fn(chunks);
+  for (unsigned t = 1; t < n_chunks; ++t) {
+    if (started[t]) {
+      pthread_join(threads[t], NULL);
+    } else {
+      fn(chunks + t * stride);
+    }
+  }
+  free(started);
+  free(threads);
+}
@@ -63,7 +63,7 @@ void pq_init(PriorityQueue *pq) {
 }
 
 void pq_initc(PriorityQueue *pq, cmp_t cmp) {
-  pq_initcn(pq, less_than_cmp, DEFAUL_INITIAL_CAPACITY);
+  pq_initcn(pq, cmp, DEFAUL_INITIAL_CAPACITY);
 }
 
 void pq_initn(PriorityQueue *pq, unsigned n) {
@@ -104,6 +104,11 @@ void *pq_pop(PriorityQueue *pq) {
   return front;
 }
 
+void *pq_peek(PriorityQueue *pq) {
+  pq_validate(pq);
+  return pq->vec.size ? pq->vec.data[0] : nullptr;
+}
+
 void pq_free(PriorityQueue *pq) {
   pq_pop(pq);
   vector_free(&pq->vec);
@@ -316,13 +316,14 @@ void insert_fixup(RedBlackTree *tree, Node *n) {
   n->color = RED;
 }
 
-bool node_insert(RedBlackTree *tree, Node *n, void *val) {
+// Returns the new node, or NULL if val already exists in the tree.
+Node *node_insert(RedBlackTree *tree, Node *n, void *val) {
   assert(n && "RBTree: cannot insert to null node");
 
   Ordering comparison = tree->cmp(val, n->val);
   if (comparison == EQUALS) {
     // Element already exists. Nothing to insert.
-    return false;
+    return NULL;
   }
 
   Direction direction = comparison == LESS ? LEFT : RIGHT;
@@ -334,19 +335,23 @@ bool node_insert(RedBlackTree *tree, Node *n, void *val) {
   }
 
   // Child does not exist. Insert the node and fixup.
-  *child = node_new(val, RED);
-  node_adopt(n, *child, direction);
+  Node *inserted = node_new(val, RED);
+  node_adopt(n, inserted, direction);
   tree->size += 1;
-  insert_fixup(tree, *child);
-  return true;
+  insert_fixup(tree, inserted);
+  return inserted;
 }
 
 bool rb_tree_insert(RedBlackTree *tree, void *val) {
+  return rb_tree_insert_node(tree, val);
+}
+
+RedBlackNode *rb_tree_insert_node(RedBlackTree *tree, void *val) {
   rb_tree_validate(tree);
   if (!tree->root) {
     tree->root = node_new(val, BLACK);
     tree->size = 1;
-    return true;
+    return tree->root;
   }
   return node_insert(tree, tree->root, val);
 }
@@ -489,6 +494,45 @@ void resolve_double_black(RedBlackTree *tree, Node *n) {
   }
 }
 
+// Swaps the positions of n and its inorder predecessor pred, which is the
+// rightmost node of n's left subtree. Each node takes over the other's parent,
+// children and color.
+void node_swap_with_pred(RedBlackTree *tree, Node *n, Node *pred) {
+  assert(n && pred && n->left && !pred->right);
+  Node *parent = n->parent;
+  Direction parent_direction;
+  if (parent) {
+    parent_direction = node_parent_direction(n);
+  }
+  Node *left = n->left;
+  Node *right = n->right;
+  Node *pred_parent = pred->parent;
+  Node *pred_left = pred->left;
+
+  Color color = n->color;
+  n->color = pred->color;
+  pred->color = color;
+
+  if (pred == left) {
+    // pred is n's direct child. n becomes pred's left child.
+    node_adopt(pred, n, LEFT);
+  } else {
+    node_adopt(pred, left, LEFT);
+    node_adopt(pred_parent, n, RIGHT);
+  }
+  node_adopt(pred, right, RIGHT);
+  n->left = NULL;
+  n->right = NULL;
+  node_adopt(n, pred_left, LEFT);
+
+  if (parent) {
+    node_adopt(parent, pred, parent_direction);
+  } else {
+    tree->root = pred;
+    pred->parent = NULL;
+  }
+}
+
 void node_delete(RedBlackTree *tree, Node *n) {
   assert(n);
   // Case 1: n only has one child. Delete n and promote the child.
@@ -574,10 +618,11 @@ void node_delete(RedBlackTree *tree, Node *n) {
 
   // Case 3: n has two children
   // n's predecessor is the rightmost node of n's left subtree
-  // First replace the entries of n and its inorder predecessor. By replacing
-  // only the entries, we maintain parent-child relationships and colors. Note
-  // that pred is not guaranteed to be a right child because it could be the
-  // left child of n.
+  // First swap the positions of n and its inorder predecessor. Colors stay
+  // with the positions, so the tree properties are unaffected. We move the
+  // nodes rather than their entries so that node handles held by callers stay
+  // valid. Note that pred is not guaranteed to be a right child because it
+  // could be the left child of n.
   //
   // After swapping, we recursively delete n. Since n is swapped into a
   // rightmost place, it cannot have any right children, so the recursive call
@@ -601,9 +646,9 @@ void node_delete(RedBlackTree *tree, Node *n) {
   assert(pred->parent &&
          "n's predecessor cannot be the root and must have a parent");
 
-  swap(&n->val, &pred->val);
+  node_swap_with_pred(tree, n, pred);
 
-  node_delete(tree, pred);
+  node_delete(tree, n);
 }
 
 void *rb_tree_delete(RedBlackTree *tree, void *val) {
@@ -612,6 +657,12 @@ void *rb_tree_delete(RedBlackTree *tree, void *val) {
   if (!n) {
     return NULL;
   }
+  return rb_tree_delete_node(tree, n);
+}
+
+void *rb_tree_delete_node(RedBlackTree *tree, RedBlackNode *n) {
+  rb_tree_validate(tree);
+  assert(n && "cannot delete null node");
   tree->size -= 1;
   void *deleted_val = n->val;
   node_delete(tree, n);
@@ -735,6 +786,81 @@ Optional rb_tree_succ(RedBlackTree *tree, void *val) {
   return node_succ(tree->root, val, tree->cmp);
 }
 
+void *rb_tree_node_val(RedBlackNode *n) {
+  assert(n && "null node has no value");
+  return n->val;
+}
+
+RedBlackNode *rb_tree_node_next(RedBlackNode *n) {
+  assert(n && "null node has no successor");
+  if (n->right) {
+    return node_leftmost(n->right);
+  }
+  while (n->parent && node_parent_direction(n) == RIGHT) {
+    n = n->parent;
+  }
+  return n->parent;
+}
+
+RedBlackNode *rb_tree_node_prev(RedBlackNode *n) {
+  assert(n && "null node has no predecessor");
+  if (n->left) {
+    return node_rightmost(n->left);
+  }
+  while (n->parent && node_parent_direction(n) == LEFT) {
+    n = n->parent;
+  }
+  return n->parent;
+}
+
+RedBlackNode *rb_tree_first_node(RedBlackTree *tree) {
+  rb_tree_validate(tree);
+  return tree->root ? node_leftmost(tree->root) : NULL;
+}
+
+RedBlackNode *rb_tree_last_node(RedBlackTree *tree) {
+  rb_tree_validate(tree);
+  return tree->root ? node_rightmost(tree->root) : NULL;
+}
+
+RedBlackNode *rb_tree_upper_bound(RedBlackTree *tree, void *val) {
+  rb_tree_validate(tree);
+  Node *n = tree->root;
+  Node *bound = NULL;
+  while (n) {
+    if (tree->cmp(val, n->val) == LESS) {
+      bound = n;
+      n = n->left;
+    } else {
+      n = n->right;
+    }
+  }
+  return bound;
+}
+
+RedBlackNode *rb_tree_insert_after(RedBlackTree *tree, RedBlackNode *pos,
+                                   void *val) {
+  rb_tree_validate(tree);
+  if (!tree->root) {
+    assert(!pos && "cannot insert after a node of an empty tree");
+    tree->root = node_new(val, BLACK);
+    tree->size = 1;
+    return tree->root;
+  }
+  // The new node goes right below the successor slot of pos
+  Node *inserted = node_new(val, RED);
+  if (!pos) {
+    node_adopt(node_leftmost(tree->root), inserted, LEFT);
+  } else if (!pos->right) {
+    node_adopt(pos, inserted, RIGHT);
+  } else {
+    node_adopt(node_leftmost(pos->right), inserted, LEFT);
+  }
+  tree->size += 1;
+  insert_fixup(tree, inserted);
+  return inserted;
+}
+
 void **rb_tree_elements(RedBlackTree *tree) {
   rb_tree_validate(tree);
   if (tree->size == 0) {
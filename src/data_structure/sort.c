@@ -1,7 +1,9 @@
 #include "data_structure/sort.h"
+#include "data_structure/parallel.h"
 #include "data_structure/red_black_tree.h"
 #include "data_structure/util.h"
 #include <assert.h>
+#include <math.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -60,11 +62,11 @@ void **heap_sort(void **data, unsigned n) {
 }
 
 void **insertion_sort(void **data, unsigned n) {
-  for (unsigned i = 0; i < n - 1; ++i) {
-    for (unsigned j = i + 1; j > 0; --j) {
-      if (data[j] < data[j - 1]) {
-        swap(data + j, data + j - 1);
-      }
+  for (unsigned i = 1; i < n; ++i) {
+    // data[0..i) is already sorted, so we can stop as soon as data[j] is in
+    // place.
+    for (unsigned j = i; j > 0 && data[j] < data[j - 1]; --j) {
+      swap(data + j, data + j - 1);
     }
   }
   return data;
@@ -173,3 +175,814 @@ void **tree_sort(void **data, unsigned n) {
   rb_tree_free(&tree);
   return data;
 }
+
+// Tim sort. A stable merge sort that takes advantage of existing order in the
+// input. The data is scanned left to right for natural runs, either
+// non-descending or strictly descending (which are reversed in place). Short
+// runs are extended to `min_run` elements with a binary insertion sort.
+//
+// Runs are pushed onto a stack and merged according to the powersort policy:
+// each boundary between two adjacent runs is assigned a "power", the depth of
+// the boundary in a perfectly balanced merge tree over [0, n). Runs on the
+// stack are merged while the boundary below the top has a greater power than
+// the new boundary. This keeps merges nearly balanced, and the stack depth is
+// bounded by log(n).
+//
+// Merges gallop. While one run keeps winning comparisons, we switch from
+// one-at-a-time merging to an exponential search in the other run and move the
+// whole block at once. `min_gallop` adapts to how well galloping pays off.
+//
+// Sorted input is a single run, so the sort costs n - 1 comparisons.
+
+static const unsigned MIN_MERGE = 64;
+static const unsigned MIN_GALLOP = 7;
+// Boundary powers increase up the stack and never exceed the bit width
+// of n, which bounds the number of pending runs.
+#define MAX_PENDING_RUNS 64
+
+typedef struct {
+  void **base;
+  unsigned len;
+  // Power of the boundary between this run and the run above it on the stack
+  unsigned power;
+} Run;
+
+typedef struct {
+  cmp_t cmp;
+  unsigned n;
+  unsigned min_gallop;
+  void **tmp;
+  unsigned tmp_capacity;
+  Run pending[MAX_PENDING_RUNS];
+  unsigned num_pending;
+} MergeState;
+
+static bool is_less(cmp_t cmp, void *a, void *b) { return cmp(a, b) == LESS; }
+
+static void reverse(void **data, unsigned n) {
+  for (unsigned i = 0, j = n - 1; i < j; ++i, --j) {
+    swap(data + i, data + j);
+  }
+}
+
+// Computes the minimum run length such that n / min_run is a power of two, or
+// slightly less than one.
+static unsigned min_run_length(unsigned n) {
+  unsigned r = 0;
+  while (n >= MIN_MERGE) {
+    r |= n & 1;
+    n >>= 1;
+  }
+  return n + r;
+}
+
+// Sorts data[0..n), given that data[0..start) is already sorted. Equal elements
+// are inserted after their existing equals to keep the sort stable.
+static void binary_insertion_sort(void **data, unsigned n, unsigned start,
+                                  cmp_t cmp) {
+  for (unsigned i = start; i < n; ++i) {
+    void *pivot = data[i];
+    unsigned lo = 0;
+    unsigned hi = i;
+    while (lo < hi) {
+      unsigned mid = lo + (hi - lo) / 2;
+      if (is_less(cmp, pivot, data[mid])) {
+        hi = mid;
+      } else {
+        lo = mid + 1;
+      }
+    }
+    memmove(data + lo + 1, data + lo, sizeof(void *) * (i - lo));
+    data[lo] = pivot;
+  }
+}
+
+// Returns the length of the run starting at data[0]. A strictly descending run
+// is reversed so that every returned run is non-descending. Descending runs
+// must be strict, otherwise reversing them would break stability.
+static unsigned count_run(void **data, unsigned n, cmp_t cmp) {
+  if (n <= 1) {
+    return n;
+  }
+  unsigned i = 2;
+  if (is_less(cmp, data[1], data[0])) {
+    while (i < n && is_less(cmp, data[i], data[i - 1])) {
+      ++i;
+    }
+    reverse(data, i);
+  } else {
+    while (i < n && !is_less(cmp, data[i], data[i - 1])) {
+      ++i;
+    }
+  }
+  return i;
+}
+
+// Returns the index k in [0, n] such that a[k - 1] < key <= a[k]. The search
+// starts at a[hint] and gallops outward, so it is cheap when the answer is near
+// the hint.
+static unsigned gallop_left(void *key, void **a, unsigned n, unsigned hint,
+                            cmp_t cmp) {
+  assert(n > 0 && hint < n);
+  long last_ofs = 0;
+  long ofs = 1;
+  if (is_less(cmp, a[hint], key)) {
+    // Gallop right until a[hint + last_ofs] < key <= a[hint + ofs]
+    long max_ofs = n - hint;
+    while (ofs < max_ofs && is_less(cmp, a[hint + ofs], key)) {
+      last_ofs = ofs;
+      ofs = (ofs << 1) + 1;
+    }
+    if (ofs > max_ofs) {
+      ofs = max_ofs;
+    }
+    last_ofs += hint;
+    ofs += hint;
+  } else {
+    // Gallop left until a[hint - ofs] < key <= a[hint - last_ofs]
+    long max_ofs = hint + 1;
+    while (ofs < max_ofs && !is_less(cmp, a[hint - ofs], key)) {
+      last_ofs = ofs;
+      ofs = (ofs << 1) + 1;
+    }
+    if (ofs > max_ofs) {
+      ofs = max_ofs;
+    }
+    long t = last_ofs;
+    last_ofs = (long)hint - ofs;
+    ofs = (long)hint - t;
+  }
+
+  // Now a[last_ofs] < key <= a[ofs]. Binary search the range in between.
+  ++last_ofs;
+  while (last_ofs < ofs) {
+    long mid = last_ofs + (ofs - last_ofs) / 2;
+    if (is_less(cmp, a[mid], key)) {
+      last_ofs = mid + 1;
+    } else {
+      ofs = mid;
+    }
+  }
+  return ofs;
+}
+
+// Returns the index k in [0, n] such that a[k - 1] <= key < a[k]. Same as
+// gallop_left, except that elements equal to key are placed to the left.
+static unsigned gallop_right(void *key, void **a, unsigned n, unsigned hint,
+                             cmp_t cmp) {
+  assert(n > 0 && hint < n);
+  long last_ofs = 0;
+  long ofs = 1;
+  if (is_less(cmp, key, a[hint])) {
+    // Gallop left until a[hint - ofs] <= key < a[hint - last_ofs]
+    long max_ofs = hint + 1;
+    while (ofs < max_ofs && is_less(cmp, key, a[hint - ofs])) {
+      last_ofs = ofs;
+      ofs = (ofs << 1) + 1;
+    }
+    if (ofs > max_ofs) {
+      ofs = max_ofs;
+    }
+    long t = last_ofs;
+    last_ofs = (long)hint - ofs;
+    ofs = (long)hint - t;
+  } else {
+    // Gallop right until a[hint + last_ofs] <= key < a[hint + ofs]
+    long max_ofs = n - hint;
+    while (ofs < max_ofs && !is_less(cmp, key, a[hint + ofs])) {
+      last_ofs = ofs;
+      ofs = (ofs << 1) + 1;
+    }
+    if (ofs > max_ofs) {
+      ofs = max_ofs;
+    }
+    last_ofs += hint;
+    ofs += hint;
+  }
+
+  // Now a[last_ofs] <= key < a[ofs]. Binary search the range in between.
+  ++last_ofs;
+  while (last_ofs < ofs) {
+    long mid = last_ofs + (ofs - last_ofs) / 2;
+    if (is_less(cmp, key, a[mid])) {
+      ofs = mid;
+    } else {
+      last_ofs = mid + 1;
+    }
+  }
+  return ofs;
+}
+
+static void **merge_state_tmp(MergeState *ms, unsigned n) {
+  if (ms->tmp_capacity < n) {
+    free(ms->tmp);
+    ms->tmp = malloc(sizeof(void *) * n);
+    ms->tmp_capacity = n;
+  }
+  return ms->tmp;
+}
+
+// Merges the adjacent runs a[0..na) and b[0..nb) in place, where na <= nb. The
+// caller guarantees b[0] < a[0] and a[na - 1] > b[nb - 1]. Only the shorter run
+// a is copied to the temporary buffer, and the merge proceeds from the left.
+static void merge_lo(MergeState *ms, void **a, unsigned na, void **b,
+                     unsigned nb) {
+  assert(na > 0 && nb > 0 && a + na == b);
+  cmp_t cmp = ms->cmp;
+  void **pa = merge_state_tmp(ms, na);
+  memcpy(pa, a, sizeof(void *) * na);
+  void **dest = a;
+
+  *dest++ = *b++;
+  if (--nb == 0) {
+    goto succeed;
+  }
+  if (na == 1) {
+    goto copy_b;
+  }
+
+  unsigned min_gallop = ms->min_gallop;
+  for (;;) {
+    unsigned a_count = 0;
+    unsigned b_count = 0;
+
+    // Merge one element at a time until one run wins min_gallop times in a row
+    for (;;) {
+      if (is_less(cmp, *b, *pa)) {
+        *dest++ = *b++;
+        ++b_count;
+        a_count = 0;
+        if (--nb == 0) {
+          goto succeed;
+        }
+        if (b_count >= min_gallop) {
+          break;
+        }
+      } else {
+        *dest++ = *pa++;
+        ++a_count;
+        b_count = 0;
+        if (--na == 1) {
+          goto copy_b;
+        }
+        if (a_count >= min_gallop) {
+          break;
+        }
+      }
+    }
+
+    // Gallop until neither run wins by a wide margin. The longer we gallop, the
+    // easier it is to re-enter galloping mode later.
+    ++min_gallop;
+    do {
+      min_gallop -= min_gallop > 1;
+      ms->min_gallop = min_gallop;
+
+      unsigned k = gallop_right(*b, pa, na, 0, cmp);
+      a_count = k;
+      if (k) {
+        memcpy(dest, pa, sizeof(void *) * k);
+        dest += k;
+        pa += k;
+        na -= k;
+        if (na == 1) {
+          goto copy_b;
+        }
+        if (na == 0) {
+          // Only reachable with an inconsistent comparator
+          goto succeed;
+        }
+      }
+      *dest++ = *b++;
+      if (--nb == 0) {
+        goto succeed;
+      }
+
+      k = gallop_left(*pa, b, nb, 0, cmp);
+      b_count = k;
+      if (k) {
+        memmove(dest, b, sizeof(void *) * k);
+        dest += k;
+        b += k;
+        nb -= k;
+        if (nb == 0) {
+          goto succeed;
+        }
+      }
+      *dest++ = *pa++;
+      if (--na == 1) {
+        goto copy_b;
+      }
+    } while (a_count >= MIN_GALLOP || b_count >= MIN_GALLOP);
+    ++min_gallop;
+    ms->min_gallop = min_gallop;
+  }
+
+succeed:
+  if (na) {
+    memcpy(dest, pa, sizeof(void *) * na);
+  }
+  return;
+
+copy_b:
+  // The last element of a belongs at the very end
+  assert(na == 1 && nb > 0);
+  memmove(dest, b, sizeof(void *) * nb);
+  dest[nb] = *pa;
+}
+
+// Merges the adjacent runs a[0..na) and b[0..nb) in place, where na >= nb. The
+// mirror image of merge_lo: only the shorter run b is copied to the temporary
+// buffer, and the merge proceeds from the right.
+static void merge_hi(MergeState *ms, void **a, unsigned na, void **b,
+                     unsigned nb) {
+  assert(na > 0 && nb > 0 && a + na == b);
+  cmp_t cmp = ms->cmp;
+  void **tmp = merge_state_tmp(ms, nb);
+  memcpy(tmp, b, sizeof(void *) * nb);
+  void **dest = b + nb - 1;
+  void **pa = a + na - 1;
+  void **pb = tmp + nb - 1;
+
+  *dest-- = *pa--;
+  if (--na == 0) {
+    goto succeed;
+  }
+  if (nb == 1) {
+    goto copy_a;
+  }
+
+  unsigned min_gallop = ms->min_gallop;
+  for (;;) {
+    unsigned a_count = 0;
+    unsigned b_count = 0;
+
+    for (;;) {
+      if (is_less(cmp, *pb, *pa)) {
+        *dest-- = *pa--;
+        ++a_count;
+        b_count = 0;
+        if (--na == 0) {
+          goto succeed;
+        }
+        if (a_count >= min_gallop) {
+          break;
+        }
+      } else {
+        *dest-- = *pb--;
+        ++b_count;
+        a_count = 0;
+        if (--nb == 1) {
+          goto copy_a;
+        }
+        if (b_count >= min_gallop) {
+          break;
+        }
+      }
+    }
+
+    ++min_gallop;
+    do {
+      min_gallop -= min_gallop > 1;
+      ms->min_gallop = min_gallop;
+
+      // Elements of a greater than *pb move as a block
+      unsigned k = na - gallop_right(*pb, a, na, na - 1, cmp);
+      a_count = k;
+      if (k) {
+        dest -= k;
+        pa -= k;
+        memmove(dest + 1, pa + 1, sizeof(void *) * k);
+        na -= k;
+        if (na == 0) {
+          goto succeed;
+        }
+      }
+      *dest-- = *pb--;
+      if (--nb == 1) {
+        goto copy_a;
+      }
+
+      // Elements of b greater than or equal to *pa move as a block
+      k = nb - gallop_left(*pa, tmp, nb, nb - 1, cmp);
+      b_count = k;
+      if (k) {
+        dest -= k;
+        pb -= k;
+        memcpy(dest + 1, pb + 1, sizeof(void *) * k);
+        nb -= k;
+        if (nb == 1) {
+          goto copy_a;
+        }
+        if (nb == 0) {
+          // Only reachable with an inconsistent comparator
+          goto succeed;
+        }
+      }
+      *dest-- = *pa--;
+      if (--na == 0) {
+        goto succeed;
+      }
+    } while (a_count >= MIN_GALLOP || b_count >= MIN_GALLOP);
+    ++min_gallop;
+    ms->min_gallop = min_gallop;
+  }
+
+succeed:
+  if (nb) {
+    memcpy(dest - (nb - 1), tmp, sizeof(void *) * nb);
+  }
+  return;
+
+copy_a:
+  // The first element of b belongs at the very front
+  assert(nb == 1 && na > 0);
+  dest -= na;
+  pa -= na;
+  memmove(dest + 1, pa + 1, sizeof(void *) * na);
+  *dest = *pb;
+}
+
+// Merges the pending runs at index i and i + 1 of the run stack.
+static void merge_at(MergeState *ms, unsigned i) {
+  assert(i + 1 < ms->num_pending);
+  Run *left = &ms->pending[i];
+  Run *right = &ms->pending[i + 1];
+  void **a = left->base;
+  unsigned na = left->len;
+  void **b = right->base;
+  unsigned nb = right->len;
+  assert(a + na == b && "merged runs must be adjacent");
+
+  left->len = na + nb;
+  left->power = right->power;
+  if (i + 2 < ms->num_pending) {
+    ms->pending[i + 1] = ms->pending[i + 2];
+  }
+  --ms->num_pending;
+
+  // Elements of a that are <= b[0] are already in place
+  unsigned k = gallop_right(*b, a, na, 0, ms->cmp);
+  a += k;
+  na -= k;
+  if (na == 0) {
+    return;
+  }
+
+  // Elements of b that are >= a[na - 1] are already in place
+  nb = gallop_left(a[na - 1], b, nb, nb - 1, ms->cmp);
+  if (nb == 0) {
+    return;
+  }
+
+  if (na <= nb) {
+    merge_lo(ms, a, na, b, nb);
+  } else {
+    merge_hi(ms, a, na, b, nb);
+  }
+}
+
+// Returns the powersort power of the boundary between the run [s1, s1 + n1)
+// and the run [s1 + n1, s1 + n1 + n2), which is the number of leading bits the
+// two runs' midpoints share as fractions of n.
+static unsigned node_power(unsigned long s1, unsigned long n1,
+                           unsigned long n2, unsigned long n) {
+  unsigned long a = 2 * s1 + n1;
+  unsigned long b = a + n1 + n2;
+  unsigned power = 0;
+  for (;;) {
+    ++power;
+    if (a >= n) {
+      a -= n;
+      b -= n;
+    } else if (b >= n) {
+      break;
+    }
+    a <<= 1;
+    b <<= 1;
+  }
+  return power;
+}
+
+// Pushes a new run onto the stack, first merging runs whose boundary powers are
+// greater than the power of the new boundary.
+static void push_run(MergeState *ms, void **base, unsigned len) {
+  if (ms->num_pending > 0) {
+    Run *top = &ms->pending[ms->num_pending - 1];
+    unsigned power = node_power(top->base - ms->pending[0].base, top->len, len,
+                                ms->n);
+    while (ms->num_pending > 1 &&
+           ms->pending[ms->num_pending - 2].power > power) {
+      merge_at(ms, ms->num_pending - 2);
+    }
+    ms->pending[ms->num_pending - 1].power = power;
+  }
+  assert(ms->num_pending < MAX_PENDING_RUNS && "run stack overflow");
+  ms->pending[ms->num_pending++] = (Run){.base = base, .len = len, .power = 0};
+}
+
+void **tim_sort(void **data, unsigned n) {
+  return tim_sortc(data, n, less_than_cmp);
+}
+
+void **tim_sortc(void **data, unsigned n, cmp_t cmp) {
+  assert(data && "cannot sort NULL data");
+  if (n <= 1) {
+    return data;
+  }
+
+  MergeState ms = {
+      .cmp = cmp,
+      .n = n,
+      .min_gallop = MIN_GALLOP,
+      .tmp = NULL,
+      .tmp_capacity = 0,
+      .num_pending = 0,
+  };
+  unsigned min_run = min_run_length(n);
+  void **lo = data;
+  unsigned remaining = n;
+  while (remaining > 0) {
+    unsigned run_len = count_run(lo, remaining, cmp);
+    if (run_len < min_run) {
+      unsigned forced_len = remaining < min_run ? remaining : min_run;
+      binary_insertion_sort(lo, forced_len, run_len, cmp);
+      run_len = forced_len;
+    }
+    push_run(&ms, lo, run_len);
+    lo += run_len;
+    remaining -= run_len;
+  }
+
+  while (ms.num_pending > 1) {
+    merge_at(&ms, ms.num_pending - 2);
+  }
+  assert(ms.pending[0].base == data && ms.pending[0].len == n);
+  free(ms.tmp);
+  return data;
+}
+
+// Selection. nth_element uses Floyd-Rivest select: before partitioning a large
+// range, it recursively selects from a small random-ish sample around the
+// expected position of the kth element, so the pivot lands very close to k and
+// each partition step discards most of the range. The expected number of
+// comparisons is n + min(k, n - k) + o(n).
+//
+// Like introsort, we bound the number of partition steps. If the bound is
+// exceeded (only possible on adversarial input), we fall back to a heap based
+// selection that is O(n log(n)) in the worst case.
+
+static const long FLOYD_RIVEST_SAMPLE_THRESHOLD = 600;
+
+static void max_heap_sift_down(void **data, unsigned n, unsigned i,
+                               cmp_t cmp) {
+  for (;;) {
+    unsigned left = i * 2 + 1;
+    if (left >= n) {
+      return;
+    }
+    unsigned right = left + 1;
+    unsigned greater =
+        right < n && is_less(cmp, data[left], data[right]) ? right : left;
+    if (!is_less(cmp, data[i], data[greater])) {
+      return;
+    }
+    swap(data + i, data + greater);
+    i = greater;
+  }
+}
+
+// Selects the kth element by keeping a max heap of the k + 1 smallest elements
+// seen so far in data[0..k].
+static void heap_select(void **data, unsigned n, unsigned k, cmp_t cmp) {
+  unsigned heap_size = k + 1;
+  for (unsigned i = heap_size; i > 0; --i) {
+    max_heap_sift_down(data, heap_size, i - 1, cmp);
+  }
+  for (unsigned i = heap_size; i < n; ++i) {
+    if (is_less(cmp, data[i], data[0])) {
+      swap(data, data + i);
+      max_heap_sift_down(data, heap_size, 0, cmp);
+    }
+  }
+  swap(data, data + k);
+}
+
+static inline long min_long(long a, long b) { return a < b ? a : b; }
+
+static inline long max_long(long a, long b) { return a > b ? a : b; }
+
+static void floyd_rivest_select(void **data, long left, long right, long k,
+                                cmp_t cmp, unsigned depth) {
+  while (right > left) {
+    if (depth == 0) {
+      heap_select(data + left, right - left + 1, k - left, cmp);
+      return;
+    }
+    --depth;
+
+    if (right - left > FLOYD_RIVEST_SAMPLE_THRESHOLD) {
+      // Select from a sample of size s around k, so that data[k] becomes a
+      // good pivot for the full range.
+      double n = right - left + 1;
+      double i = k - left + 1;
+      double z = log(n);
+      double s = 0.5 * exp(2 * z / 3);
+      double sd = 0.5 * sqrt(z * s * (n - s) / n) * (i < n / 2 ? -1 : 1);
+      long new_left = max_long(left, (long)(k - i * s / n + sd));
+      long new_right = min_long(right, (long)(k + (n - i) * s / n + sd));
+      floyd_rivest_select(data, new_left, new_right, k, cmp, depth);
+    }
+
+    // Partition data[left..right] about t = data[k]
+    void *t = data[k];
+    long i = left;
+    long j = right;
+    swap(data + left, data + k);
+    if (is_less(cmp, t, data[right])) {
+      swap(data + right, data + left);
+    }
+    while (i < j) {
+      swap(data + i, data + j);
+      ++i;
+      --j;
+      while (is_less(cmp, data[i], t)) {
+        ++i;
+      }
+      while (is_less(cmp, t, data[j])) {
+        --j;
+      }
+    }
+    if (cmp(data[left], t) == EQUALS) {
+      swap(data + left, data + j);
+    } else {
+      ++j;
+      swap(data + j, data + right);
+    }
+
+    // data[j] == t is in its final position. Continue on the side holding k.
+    if (j <= k) {
+      left = j + 1;
+    }
+    if (k <= j) {
+      right = j - 1;
+    }
+  }
+}
+
+void **nth_element(void **data, unsigned n, unsigned k) {
+  return nth_elementc(data, n, k, less_than_cmp);
+}
+
+void **nth_elementc(void **data, unsigned n, unsigned k, cmp_t cmp) {
+  assert(data && "cannot select from NULL data");
+  assert(k < n && "selected index out of bounds");
+  unsigned depth = 0;
+  for (unsigned m = n; m > 1; m >>= 1) {
+    depth += 2;
+  }
+  floyd_rivest_select(data, 0, (long)n - 1, k, cmp, depth);
+  return data;
+}
+
+void **partial_sort(void **data, unsigned n, unsigned k) {
+  return partial_sortc(data, n, k, less_than_cmp);
+}
+
+void **partial_sortc(void **data, unsigned n, unsigned k, cmp_t cmp) {
+  assert(data && "cannot sort NULL data");
+  assert(k <= n && "cannot sort more than n elements");
+  if (k == 0) {
+    return data;
+  }
+  if (k < n) {
+    nth_elementc(data, n, k - 1, cmp);
+  }
+  return tim_sortc(data, k, cmp);
+}
+
+// Radix sort. Keys are sorted one byte at a time from the least significant.
+// Each thread counts the digits in its chunk of the input, the counts give
+// every (digit, thread) pair its own range of the output, and each thread then
+// scatters its chunk into those ranges. Chunks are in input order, so every
+// pass is stable.
+
+#define RADIX_BITS 8
+#define RADIX_BUCKETS (1 << RADIX_BITS)
+
+typedef struct {
+  const uint64_t *keys;
+  const unsigned *values;
+  uint64_t *out_keys;
+  unsigned *out_values;
+  unsigned lo;
+  unsigned hi;
+  unsigned shift;
+  unsigned long counts[RADIX_BUCKETS];
+  bool scatter;
+} RadixChunk;
+
+static void *radix_chunk_pass(void *data) {
+  RadixChunk *chunk = data;
+  unsigned shift = chunk->shift;
+  if (!chunk->scatter) {
+    memset(chunk->counts, 0, sizeof(chunk->counts));
+    for (unsigned i = chunk->lo; i < chunk->hi; ++i) {
+      ++chunk->counts[(chunk->keys[i] >> shift) & (RADIX_BUCKETS - 1)];
+    }
+    return NULL;
+  }
+  // counts now hold the output offsets
+  for (unsigned i = chunk->lo; i < chunk->hi; ++i) {
+    unsigned digit = (chunk->keys[i] >> shift) & (RADIX_BUCKETS - 1);
+    unsigned long j = chunk->counts[digit]++;
+    chunk->out_keys[j] = chunk->keys[i];
+    if (chunk->values) {
+      chunk->out_values[j] = chunk->values[i];
+    }
+  }
+  return NULL;
+}
+
+void radix_sort_keys(uint64_t *keys, unsigned *values, unsigned n,
+                     unsigned num_threads) {
+  assert((keys || n == 0) && "cannot sort NULL keys");
+  assert(num_threads > 0 && "need at least one thread");
+  if (n <= 1) {
+    return;
+  }
+  uint64_t *tmp_keys = malloc(sizeof(uint64_t) * n);
+  unsigned *tmp_values = values ? malloc(sizeof(unsigned) * n) : NULL;
+  RadixChunk *chunks = malloc(sizeof(RadixChunk) * num_threads);
+
+  uint64_t *src_keys = keys;
+  unsigned *src_values = values;
+  uint64_t *dst_keys = tmp_keys;
+  unsigned *dst_values = tmp_values;
+  for (unsigned shift = 0; shift < 64; shift += RADIX_BITS) {
+    for (unsigned t = 0; t < num_threads; ++t) {
+      chunks[t] = (RadixChunk){
+          .keys = src_keys,
+          .values = src_values,
+          .out_keys = dst_keys,
+          .out_values = dst_values,
+          .lo = (unsigned)((unsigned long)n * t / num_threads),
+          .hi = (unsigned)((unsigned long)n * (t + 1) / num_threads),
+          .shift = shift,
+          .scatter = false,
+      };
+    }
+    parallel_for(num_threads, radix_chunk_pass, chunks, sizeof(RadixChunk));
+
+    // Skip the pass if every key has the same digit
+    unsigned digit = (src_keys[0] >> shift) & (RADIX_BUCKETS - 1);
+    unsigned long same = 0;
+    for (unsigned t = 0; t < num_threads; ++t) {
+      same += chunks[t].counts[digit];
+    }
+    if (same == n) {
+      continue;
+    }
+
+    unsigned long offset = 0;
+    for (unsigned d = 0; d < RADIX_BUCKETS; ++d) {
+      for (unsigned t = 0; t < num_threads; ++t) {
+        unsigned long count = chunks[t].counts[d];
+        chunks[t].counts[d] = offset;
+        offset += count;
+      }
+    }
+    for (unsigned t = 0; t < num_threads; ++t) {
+      chunks[t].scatter = true;
+    }
+    parallel_for(num_threads, radix_chunk_pass, chunks, sizeof(RadixChunk));
+
+    uint64_t *k = src_keys;
+    src_keys = dst_keys;
+    dst_keys = k;
+    unsigned *v = src_values;
+    src_values = dst_values;
+    dst_values = v;
+  }
+
+  if (src_keys != keys) {
+    memcpy(keys, src_keys, sizeof(uint64_t) * n);
+    if (values) {
+      memcpy(values, src_values, sizeof(unsigned) * n);
+    }
+  }
+  free(chunks);
+  free(tmp_values);
+  free(tmp_keys);
+}
+
+uint64_t double_sort_key(double x) {
+  // A NaN with the sign bit set would map below -infinity
+  if (isnan(x)) {
+    return UINT64_MAX;
+  }
+  uint64_t bits;
+  memcpy(&bits, &x, sizeof(bits));
+  // Flip all bits of negative numbers, and the sign bit of positive numbers
+  return bits & (1ULL << 63) ? ~bits : bits | (1ULL << 63);
+}
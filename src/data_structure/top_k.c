@@ -0,0 +1,111 @@
+// Bounded top-k accumulator. Useful when only the k smallest elements of a
+// large or unbounded stream are needed, e.g. the k nearest candidates by
+// distance. Pushing n elements costs O(n log(k)) in the worst case, and O(n)
+// once the kept elements are small, since most pushes are rejected with one
+// comparison against the root.
+#include "data_structure/top_k.h"
+#include "data_structure/sort.h"
+#include "data_structure/util.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+static bool is_less(TopK *top, void *a, void *b) {
+  return top->cmp(a, b) == LESS;
+}
+
+static void sift_up(TopK *top, unsigned i) {
+  void **data = top->data;
+  while (i > 0) {
+    unsigned parent = (i - 1) / 2;
+    if (!is_less(top, data[parent], data[i])) {
+      return;
+    }
+    swap(data + i, data + parent);
+    i = parent;
+  }
+}
+
+static void sift_down(TopK *top, unsigned i) {
+  void **data = top->data;
+  for (;;) {
+    unsigned left = i * 2 + 1;
+    if (left >= top->size) {
+      return;
+    }
+    unsigned right = left + 1;
+    unsigned greater = right < top->size && is_less(top, data[left], data[right])
+                           ? right
+                           : left;
+    if (!is_less(top, data[i], data[greater])) {
+      return;
+    }
+    swap(data + i, data + greater);
+    i = greater;
+  }
+}
+
+void top_k_init(TopK *top, unsigned k) { top_k_initc(top, k, less_than_cmp); }
+
+void top_k_initc(TopK *top, unsigned k, cmp_t cmp) {
+  assert(k > 0 && "top k needs a capacity of at least one");
+  *top = (TopK){
+      .data = malloc(sizeof(void *) * k),
+      .size = 0,
+      .capacity = k,
+      .cmp = cmp,
+  };
+}
+
+void top_k_free(TopK *top) {
+  top_k_validate(top);
+  free(top->data);
+}
+
+bool top_k_push(TopK *top, void *val) {
+  top_k_validate(top);
+  if (top->size < top->capacity) {
+    top->data[top->size] = val;
+    ++top->size;
+    sift_up(top, top->size - 1);
+    return true;
+  }
+  if (!is_less(top, val, top->data[0])) {
+    return false;
+  }
+  top->data[0] = val;
+  sift_down(top, 0);
+  return true;
+}
+
+void top_k_push_all(TopK *top, void **data, unsigned n) {
+  for (unsigned i = 0; i < n; ++i) {
+    top_k_push(top, data[i]);
+  }
+}
+
+Optional top_k_max(TopK *top) {
+  top_k_validate(top);
+  return top->size ? optional(top->data[0]) : optional_null();
+}
+
+bool top_k_full(TopK *top) {
+  top_k_validate(top);
+  return top->size == top->capacity;
+}
+
+void **top_k_elements(TopK *top) {
+  top_k_validate(top);
+  if (top->size == 0) {
+    return NULL;
+  }
+  void **elements = malloc(sizeof(void *) * top->size);
+  memcpy(elements, top->data, sizeof(void *) * top->size);
+  return tim_sortc(elements, top->size, top->cmp);
+}
+
+void top_k_validate(TopK *top) {
+  assert(top && "top k should not be null");
+  assert(top->data && "top k data should not be null");
+  assert(top->size <= top->capacity && "top k should not exceed capacity");
+}
@@ -0,0 +1,962 @@
+// Arrangements of segments, see arrangement.h.
+//
+// The build runs in passes over flat arrays:
+// 1. Intersections. Every intersecting pair adds its point to the split
+//    points of both segments. A collinear overlap is reported once, at its
+//    leftmost point, so the endpoints of each segment that lie on the other
+//    are added as well.
+// 2. Pieces. The endpoints and split points of each segment are sorted along
+//    it and merged into vertices, and consecutive distinct vertices make a
+//    piece. Pieces of overlapping segments are sorted by their pair of
+//    vertices and kept once.
+// 3. Snapping. Rounded split points move pieces off their segments, which can
+//    leave a piece through a vertex that is not on it, or across another
+//    piece next to that vertex. Every piece is split at the vertices it
+//    passes within the merge distance of, found through a uniform grid of the
+//    pieces, until none are left.
+// 4. Linking. Half-edges are radix sorted by origin, then by angle, so the
+//    half-edges leaving a vertex are a counterclockwise run. Arriving at v
+//    along h, the next half-edge around h's face is the one before h's twin
+//    in v's run.
+// 5. Faces. Every cycle of next is the outer boundary of a face, or the
+//    outer boundary of a connected piece of the arrangement, which is a hole
+//    in some face. It is the latter exactly when the cycle passes along the
+//    west side of its leftmost lowest vertex, since a face is entirely east
+//    of its boundary's leftmost lowest vertex. A ray cast west from that
+//    vertex finds the face around the hole: the face east of the first edge
+//    it hits, or if that edge is on another hole, the face around that hole.
+//    Holes are placed from left to right, so that face is known by then.
+#include "geometry/algorithm/arrangement.h"
+#include "data_structure/sort.h"
+#include "geometry/algorithm/segment_intersection.h"
+#include "geometry/predicates.h"
+#include "geometry/structure/bbox.h"
+#include <assert.h>
+#include <limits.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Points closer than this fraction of the largest magnitude of a coordinate on
+// both axes merge into one vertex. That is well above the rounding error of
+// intersection points, so the crossings of several segments at a point that is
+// not representable merge.
+static const double VERTEX_MERGE = 0x1p-40;
+// Vertex hash cells are this many merge distances wide. Points that merge
+// with a point are in the cells its merge box overlaps, which is one or two
+// per axis.
+static const double CELL_TOLERANCES = 4;
+// The ray casting grid lists edges at most this many times each on average.
+static const unsigned MAX_GRID_ENTRIES_PER_EDGE = 4;
+// Longer lists of split points are sorted with qsort.
+static const unsigned INSERTION_SORT_SIZE = 16;
+static const unsigned INITIAL_CAPACITY = 16;
+
+typedef struct {
+  unsigned segment;
+  Point p;
+} Split;
+
+typedef struct {
+  const Segment *segments;
+  Split *data;
+  unsigned size;
+  unsigned capacity;
+} SplitList;
+
+static void push_split(SplitList *splits, unsigned segment, Point p) {
+  if (splits->size == splits->capacity) {
+    splits->capacity *= 2;
+    splits->data = realloc(splits->data, sizeof(Split) * splits->capacity);
+  }
+  splits->data[splits->size++] = (Split){.segment = segment, .p = p};
+}
+
+static void push_endpoints_on(SplitList *splits, unsigned a, Segment on,
+                              Segment from) {
+  BBox box = bbox_from_segment(on);
+  if (bbox_contains_point(box, from.p0)) {
+    push_split(splits, a, from.p0);
+  }
+  if (bbox_contains_point(box, from.p1)) {
+    push_split(splits, a, from.p1);
+  }
+}
+
+static void add_intersection(SegmentIntersection x, void *data) {
+  SplitList *splits = data;
+  push_split(splits, x.a, x.p);
+  push_split(splits, x.b, x.p);
+  Segment a = splits->segments[x.a];
+  Segment b = splits->segments[x.b];
+  if (orient2d(a.p0, a.p1, b.p0) == 0 && orient2d(a.p0, a.p1, b.p1) == 0) {
+    // Collinear, so an endpoint in the other's box is on it
+    push_endpoints_on(splits, x.a, a, b);
+    push_endpoints_on(splits, x.b, b, a);
+  }
+}
+
+// Points merged into vertices. Each occupied cell has a slot in an open
+// addressing table holding its newest vertex, and chain links the vertices of
+// a cell from newest to oldest. A slot's cell is recomputed from its vertex,
+// so the table is one unsigned per slot.
+typedef struct {
+  Point *points;
+  unsigned *chain;
+  unsigned size;
+  unsigned capacity;
+  unsigned *slots;
+  unsigned mask;
+  // Points closer than this on both axes merge
+  double tolerance;
+  // Cells per unit
+  double scale;
+} VertexHash;
+
+static int64_t cell_coord(const VertexHash *hash, double v) {
+  return (int64_t)floor(v * hash->scale);
+}
+
+static unsigned cell_hash(int64_t cx, int64_t cy) {
+  uint64_t h = (uint64_t)cx * 0x9E3779B97F4A7C15ull;
+  h ^= (uint64_t)cy * 0xC2B2AE3D27D4EB4Full;
+  return (unsigned)(h ^ (h >> 32));
+}
+
+// The slot of a cell, or the empty slot where it would go.
+static unsigned *find_slot(const VertexHash *hash, int64_t cx, int64_t cy) {
+  unsigned i = cell_hash(cx, cy) & hash->mask;
+  for (;;) {
+    unsigned v = hash->slots[i];
+    if (v == UINT_MAX || (cell_coord(hash, hash->points[v].x) == cx &&
+                          cell_coord(hash, hash->points[v].y) == cy)) {
+      return &hash->slots[i];
+    }
+    i = (i + 1) & hash->mask;
+  }
+}
+
+static void link_vertex(VertexHash *hash, unsigned v) {
+  Point p = hash->points[v];
+  unsigned *slot =
+      find_slot(hash, cell_coord(hash, p.x), cell_coord(hash, p.y));
+  hash->chain[v] = *slot;
+  *slot = v;
+}
+
+static void rehash(VertexHash *hash, unsigned num_slots) {
+  free(hash->slots);
+  hash->slots = malloc(sizeof(unsigned) * num_slots);
+  memset(hash->slots, 0xff, sizeof(unsigned) * num_slots);
+  hash->mask = num_slots - 1;
+  for (unsigned v = 0; v < hash->size; ++v) {
+    link_vertex(hash, v);
+  }
+}
+
+static void vertex_hash_init(VertexHash *hash, unsigned expected,
+                             double tolerance) {
+  unsigned num_slots = INITIAL_CAPACITY;
+  while (num_slots < expected * 2) {
+    num_slots *= 2;
+  }
+  *hash = (VertexHash){
+      .points = malloc(sizeof(Point) * INITIAL_CAPACITY),
+      .chain = malloc(sizeof(unsigned) * INITIAL_CAPACITY),
+      .size = 0,
+      .capacity = INITIAL_CAPACITY,
+      .slots = NULL,
+      .tolerance = tolerance,
+      .scale = 1 / (CELL_TOLERANCES * tolerance),
+  };
+  rehash(hash, num_slots);
+}
+
+// The vertex that p merges with, added if there is none. The first vertex
+// found wins if several are.
+static unsigned vertex_of(VertexHash *hash, Point p) {
+  double tolerance = hash->tolerance;
+  int64_t x0 = cell_coord(hash, p.x - tolerance);
+  int64_t x1 = cell_coord(hash, p.x + tolerance);
+  int64_t y0 = cell_coord(hash, p.y - tolerance);
+  int64_t y1 = cell_coord(hash, p.y + tolerance);
+  for (int64_t cx = x0; cx <= x1; ++cx) {
+    for (int64_t cy = y0; cy <= y1; ++cy) {
+      for (unsigned v = *find_slot(hash, cx, cy); v != UINT_MAX;
+           v = hash->chain[v]) {
+        Point q = hash->points[v];
+        if (fabs(q.x - p.x) < tolerance && fabs(q.y - p.y) < tolerance) {
+          return v;
+        }
+      }
+    }
+  }
+  if (hash->size == hash->capacity) {
+    hash->capacity *= 2;
+    hash->points = realloc(hash->points, sizeof(Point) * hash->capacity);
+    hash->chain = realloc(hash->chain, sizeof(unsigned) * hash->capacity);
+  }
+  hash->points[hash->size] = p;
+  if ((hash->size + 1) * 2 > hash->mask + 1) {
+    ++hash->size;
+    rehash(hash, (hash->mask + 1) * 2);
+    return hash->size - 1;
+  }
+  link_vertex(hash, hash->size);
+  return hash->size++;
+}
+
+static int compare_x(const void *a, const void *b) {
+  double pa = ((const Point *)a)->x;
+  double pb = ((const Point *)b)->x;
+  return (pa > pb) - (pa < pb);
+}
+
+static int compare_y(const void *a, const void *b) {
+  double pa = ((const Point *)a)->y;
+  double pb = ((const Point *)b)->y;
+  return (pa > pb) - (pa < pb);
+}
+
+// Sorts points on a segment along it, by x or by y, whichever it spans more
+// of.
+static void sort_along(Point *points, unsigned n, bool by_x) {
+  if (n > INSERTION_SORT_SIZE) {
+    qsort(points, n, sizeof(Point), by_x ? compare_x : compare_y);
+    return;
+  }
+  for (unsigned i = 1; i < n; ++i) {
+    Point p = points[i];
+    double key = by_x ? p.x : p.y;
+    unsigned j = i;
+    for (; j > 0 && (by_x ? points[j - 1].x : points[j - 1].y) > key; --j) {
+      points[j] = points[j - 1];
+    }
+    points[j] = p;
+  }
+}
+
+typedef struct {
+  unsigned u;
+  unsigned v;
+  unsigned segment;
+} Piece;
+
+// Overlapping segments give the same piece more than once. Keeps one of each,
+// the one of the first segment.
+static Piece *unique_pieces(Piece *pieces, unsigned size, unsigned num_threads,
+                            unsigned *num_pieces) {
+  uint64_t *keys = malloc(sizeof(uint64_t) * (size > 0 ? size : 1));
+  unsigned *order = malloc(sizeof(unsigned) * (size > 0 ? size : 1));
+  for (unsigned i = 0; i < size; ++i) {
+    unsigned lo = pieces[i].u < pieces[i].v ? pieces[i].u : pieces[i].v;
+    unsigned hi = pieces[i].u ^ pieces[i].v ^ lo;
+    keys[i] = (uint64_t)lo << 32 | hi;
+    order[i] = i;
+  }
+  radix_sort_keys(keys, order, size, num_threads);
+  Piece *unique = malloc(sizeof(Piece) * (size > 0 ? size : 1));
+  unsigned count = 0;
+  for (unsigned i = 0; i < size; ++i) {
+    Piece piece = pieces[order[i]];
+    if (i == 0 || keys[i] != keys[i - 1]) {
+      unique[count++] = piece;
+    } else if (piece.segment < unique[count - 1].segment) {
+      unique[count - 1] = piece;
+    }
+  }
+  free(keys);
+  free(order);
+  free(pieces);
+  *num_pieces = count;
+  return unique;
+}
+
+// Splits every segment at its split points into pieces between distinct
+// vertices, and returns the pieces with duplicates removed.
+static Piece *build_pieces(const Segment *segments, unsigned n,
+                           const SplitList *splits, unsigned num_threads,
+                           VertexHash *vertices, unsigned *num_pieces) {
+  // Split points by segment, with room for the endpoints at the front
+  unsigned *starts = calloc(n + 1, sizeof(unsigned));
+  for (unsigned i = 0; i < splits->size; ++i) {
+    ++starts[splits->data[i].segment + 1];
+  }
+  unsigned longest = 0;
+  for (unsigned s = 0; s < n; ++s) {
+    longest = starts[s + 1] > longest ? starts[s + 1] : longest;
+    starts[s + 1] += starts[s];
+  }
+  Point *points = malloc(sizeof(Point) * (splits->size > 0 ? splits->size : 1));
+  unsigned *fill = malloc(sizeof(unsigned) * (n > 0 ? n : 1));
+  memcpy(fill, starts, sizeof(unsigned) * n);
+  for (unsigned i = 0; i < splits->size; ++i) {
+    points[fill[splits->data[i].segment]++] = splits->data[i].p;
+  }
+  free(fill);
+
+  Point *line = malloc(sizeof(Point) * (longest + 2));
+  unsigned capacity = n + splits->size;
+  Piece *pieces = malloc(sizeof(Piece) * (capacity > 0 ? capacity : 1));
+  unsigned size = 0;
+  for (unsigned s = 0; s < n; ++s) {
+    Segment seg = segments[s];
+    unsigned count = starts[s + 1] - starts[s];
+    line[0] = seg.p0;
+    line[1] = seg.p1;
+    memcpy(line + 2, points + starts[s], sizeof(Point) * count);
+    count += 2;
+    sort_along(line, count,
+               fabs(seg.p1.x - seg.p0.x) >= fabs(seg.p1.y - seg.p0.y));
+    unsigned u = vertex_of(vertices, line[0]);
+    for (unsigned i = 1; i < count; ++i) {
+      unsigned v = vertex_of(vertices, line[i]);
+      if (v != u) {
+        pieces[size++] = (Piece){.u = u, .v = v, .segment = s};
+        u = v;
+      }
+    }
+  }
+  free(line);
+  free(points);
+  free(starts);
+  return unique_pieces(pieces, size, num_threads, num_pieces);
+}
+
+// Position of the direction (dx, dy) counterclockwise from east, increasing
+// with the angle in [0, 4) without trigonometry.
+static double pseudo_angle(double dx, double dy) {
+  double p = dy / (fabs(dx) + fabs(dy));
+  return dx < 0 ? 2 - p : dy < 0 ? 4 + p : p;
+}
+
+static unsigned angle_key(Point from, Point to) {
+  double a = pseudo_angle(to.x - from.x, to.y - from.y) * (1u << 30);
+  return a >= (double)UINT_MAX ? UINT_MAX : (unsigned)a;
+}
+
+static const unsigned WEST = 2u << 30;
+
+static unsigned destination(const Arrangement *arr, unsigned h) {
+  return arr->edges[arrangement_twin(h)].origin;
+}
+
+// Orders half-edges counterclockwise around each vertex and links next and
+// prev. starts[v]..starts[v + 1] is v's run in around, and keys holds the
+// angles.
+static void link_edges(Arrangement *arr, unsigned num_threads,
+                       unsigned *starts, unsigned *around, uint64_t *keys) {
+  unsigned num_edges = arr->num_edges;
+  for (unsigned h = 0; h < num_edges; ++h) {
+    unsigned origin = arr->edges[h].origin;
+    keys[h] = (uint64_t)origin << 32 |
+              angle_key(arr->vertices[origin],
+                        arr->vertices[destination(arr, h)]);
+    around[h] = h;
+  }
+  radix_sort_keys(keys, around, num_edges, num_threads);
+  memset(starts, 0, sizeof(unsigned) * (arr->num_vertices + 1));
+  for (unsigned h = 0; h < num_edges; ++h) {
+    ++starts[arr->edges[h].origin + 1];
+  }
+  for (unsigned v = 0; v < arr->num_vertices; ++v) {
+    starts[v + 1] += starts[v];
+    arr->vertex_edges[v] = around[starts[v]];
+  }
+
+  // position[h] is where h is in around, reusing the prev fields
+  for (unsigned i = 0; i < num_edges; ++i) {
+    arr->edges[around[i]].prev = i;
+  }
+  for (unsigned h = 0; h < num_edges; ++h) {
+    unsigned twin = arrangement_twin(h);
+    unsigned v = arr->edges[twin].origin;
+    unsigned i = arr->edges[twin].prev;
+    arr->edges[h].next = around[i > starts[v] ? i - 1 : starts[v + 1] - 1];
+  }
+  for (unsigned h = 0; h < num_edges; ++h) {
+    arr->edges[arr->edges[h].next].prev = h;
+  }
+}
+
+// The half-edge leaving v whose face is just west of v.
+static unsigned west_edge(const unsigned *starts, const unsigned *around,
+                          const uint64_t *keys, unsigned v) {
+  unsigned i = starts[v];
+  while (i + 1 < starts[v + 1] && (uint32_t)keys[i + 1] < WEST) {
+    ++i;
+  }
+  if ((uint32_t)keys[i] >= WEST) {
+    // All edges are past west, so the face wraps around from the last one
+    i = starts[v + 1] - 1;
+  }
+  return around[i];
+}
+
+static bool lexicographic_less(Point a, Point b) {
+  return a.x < b.x || (a.x == b.x && a.y < b.y);
+}
+
+// A uniform grid listing the edges, as pairs of half-edges, whose bounding
+// boxes overlap each cell, in flat arrays by cell.
+typedef struct {
+  Point min;
+  double scale;
+  unsigned cols;
+  unsigned rows;
+  unsigned *starts;
+  unsigned *edges;
+} EdgeGrid;
+
+static unsigned grid_coord(double c, double min, double scale, unsigned size) {
+  double s = (c - min) * scale;
+  return s <= 0 ? 0 : s >= size - 1 ? size - 1 : (unsigned)s;
+}
+
+static unsigned grid_col(const EdgeGrid *grid, double x) {
+  return grid_coord(x, grid->min.x, grid->scale, grid->cols);
+}
+
+static unsigned grid_row(const EdgeGrid *grid, double y) {
+  return grid_coord(y, grid->min.y, grid->scale, grid->rows);
+}
+
+static void set_grid(EdgeGrid *grid, BBox box, double cell_size) {
+  grid->min = (Point){box.min_x, box.min_y};
+  grid->scale = 1 / cell_size;
+  grid->cols = (unsigned)((box.max_x - box.min_x) / cell_size) + 1;
+  grid->rows = (unsigned)((box.max_y - box.min_y) / cell_size) + 1;
+}
+
+// The cells of an edge's bounding box, in rows r0..r1 and columns c0..c1.
+static void grid_span(const EdgeGrid *grid, Point a, Point b, unsigned *c0,
+                      unsigned *c1, unsigned *r0, unsigned *r1) {
+  *c0 = grid_col(grid, fmin(a.x, b.x));
+  *c1 = grid_col(grid, fmax(a.x, b.x));
+  *r0 = grid_row(grid, fmin(a.y, b.y));
+  *r1 = grid_row(grid, fmax(a.y, b.y));
+}
+
+// Starts with about one cell per edge and doubles the cell size until the
+// edges are listed at most MAX_GRID_ENTRIES_PER_EDGE times each on average.
+static void edge_grid_init(EdgeGrid *grid, const Arrangement *arr) {
+  BBox box = bbox_from_point(arr->vertices[0]);
+  for (unsigned v = 1; v < arr->num_vertices; ++v) {
+    box = bbox_union(box, bbox_from_point(arr->vertices[v]));
+  }
+  unsigned num_pairs = arr->num_edges / 2;
+  double width = box.max_x - box.min_x, height = box.max_y - box.min_y;
+  double cell_size = width > 0 && height > 0
+                         ? sqrt(width * height / num_pairs)
+                         : fmax(width, height) / num_pairs;
+  unsigned long total;
+  for (;;) {
+    set_grid(grid, box, cell_size);
+    total = 0;
+    for (unsigned e = 0; e < num_pairs; ++e) {
+      unsigned c0, c1, r0, r1;
+      grid_span(grid, arr->vertices[arr->edges[2 * e].origin],
+                arr->vertices[arr->edges[2 * e + 1].origin], &c0, &c1, &r0,
+                &r1);
+      total += (unsigned long)(c1 - c0 + 1) * (r1 - r0 + 1);
+    }
+    if (total <= (unsigned long)MAX_GRID_ENTRIES_PER_EDGE * num_pairs ||
+        (grid->cols == 1 && grid->rows == 1)) {
+      break;
+    }
+    cell_size *= 2;
+  }
+  unsigned num_cells = grid->cols * grid->rows;
+  grid->starts = calloc(num_cells + 1, sizeof(unsigned));
+  grid->edges = malloc(sizeof(unsigned) * total);
+  for (unsigned pass = 0; pass < 2; ++pass) {
+    for (unsigned e = 0; e < num_pairs; ++e) {
+      unsigned c0, c1, r0, r1;
+      grid_span(grid, arr->vertices[arr->edges[2 * e].origin],
+                arr->vertices[arr->edges[2 * e + 1].origin], &c0, &c1, &r0,
+                &r1);
+      for (unsigned r = r0; r <= r1; ++r) {
+        for (unsigned c = c0; c <= c1; ++c) {
+          unsigned cell = r * grid->cols + c;
+          if (pass == 0) {
+            ++grid->starts[cell + 1];
+          } else {
+            grid->edges[grid->starts[cell]++] = e;
+          }
+        }
+      }
+    }
+    if (pass == 0) {
+      for (unsigned cell = 0; cell < num_cells; ++cell) {
+        grid->starts[cell + 1] += grid->starts[cell];
+      }
+    }
+  }
+  // The fill moved every start to the next cell's start
+  memmove(grid->starts + 1, grid->starts, sizeof(unsigned) * num_cells);
+  grid->starts[0] = 0;
+}
+
+// The downward half-edge of the first edge hit by a ray cast west from p, or
+// UINT_MAX. The ray is just above p, so an edge only counts if it has an
+// endpoint strictly above p and of the edges through a vertex on the ray,
+// the one farthest east just above it is hit.
+static unsigned cast_west(const EdgeGrid *grid, const Arrangement *arr,
+                          Point p) {
+  unsigned best = UINT_MAX;
+  double best_x = -INFINITY;
+  Point best_lower = {0, 0}, best_upper = {0, 0};
+  unsigned row = grid_row(grid, p.y);
+  // Cells are walked from p's westward, until a hit is east of the next
+  for (unsigned col = grid_col(grid, p.x) + 1; col-- > 0;) {
+    unsigned cell = row * grid->cols + col;
+    for (unsigned i = grid->starts[cell]; i < grid->starts[cell + 1]; ++i) {
+      unsigned e = grid->edges[i];
+      Point lower = arr->vertices[arr->edges[2 * e].origin];
+      Point upper = arr->vertices[arr->edges[2 * e + 1].origin];
+      bool up = upper.y > lower.y;
+      if (!up) {
+        Point t = lower;
+        lower = upper;
+        upper = t;
+      }
+      if (lower.y > p.y || upper.y <= p.y || orient2d(lower, upper, p) >= 0) {
+        continue;
+      }
+      double x = lower.x +
+                 (p.y - lower.y) * (upper.x - lower.x) / (upper.y - lower.y);
+      if (x > best_x ||
+          (x == best_x && orient2d(best_lower, best_upper, upper) < 0)) {
+        best_x = x;
+        best_lower = lower;
+        best_upper = upper;
+        // The half-edge from upper to lower
+        best = up ? 2 * e + 1 : 2 * e;
+      }
+    }
+    if (best != UINT_MAX && grid_col(grid, best_x) >= col) {
+      break;
+    }
+  }
+  return best;
+}
+
+// Whether the segment from p to q passes through the box of points closer to
+// v than tolerance on both axes.
+static bool passes_near(Point p, Point q, Point v, double tolerance) {
+  double from[] = {p.x, p.y};
+  double delta[] = {q.x - p.x, q.y - p.y};
+  double center[] = {v.x, v.y};
+  double t0 = 0, t1 = 1;
+  for (unsigned axis = 0; axis < 2; ++axis) {
+    double lo = center[axis] - tolerance - from[axis];
+    double hi = center[axis] + tolerance - from[axis];
+    if (delta[axis] == 0) {
+      if (lo >= 0 || hi <= 0) {
+        return false;
+      }
+      continue;
+    }
+    double ta = lo / delta[axis];
+    double tb = hi / delta[axis];
+    t0 = fmax(t0, fmin(ta, tb));
+    t1 = fmin(t1, fmax(ta, tb));
+  }
+  return t0 < t1;
+}
+
+typedef struct {
+  double along;
+  unsigned vertex;
+} Stop;
+
+static int compare_stops(const void *a, const void *b) {
+  double pa = ((const Stop *)a)->along;
+  double pb = ((const Stop *)b)->along;
+  return (pa > pb) - (pa < pb);
+}
+
+// Splits edges at every vertex they pass within tolerance of on both axes,
+// repeating until no edge passes near a vertex that is not on it. Each round
+// only adds vertices to edges, so this ends.
+static void snap_edges(Arrangement *arr, double tolerance,
+                       unsigned num_threads) {
+  while (arr->num_edges > 0) {
+    // Edge and vertex pairs, as edge << 32 | vertex
+    unsigned size = 0;
+    unsigned capacity = INITIAL_CAPACITY;
+    uint64_t *near = malloc(sizeof(uint64_t) * capacity);
+    EdgeGrid grid;
+    edge_grid_init(&grid, arr);
+    for (unsigned v = 0; v < arr->num_vertices; ++v) {
+      Point p = arr->vertices[v];
+      unsigned c0, c1, r0, r1;
+      grid_span(&grid, (Point){p.x - tolerance, p.y - tolerance},
+                (Point){p.x + tolerance, p.y + tolerance}, &c0, &c1, &r0,
+                &r1);
+      for (unsigned r = r0; r <= r1; ++r) {
+        for (unsigned c = c0; c <= c1; ++c) {
+          unsigned cell = r * grid.cols + c;
+          for (unsigned i = grid.starts[cell]; i < grid.starts[cell + 1];
+               ++i) {
+            unsigned e = grid.edges[i];
+            unsigned u = arr->edges[2 * e].origin;
+            unsigned w = arr->edges[2 * e + 1].origin;
+            if (u == v || w == v ||
+                !passes_near(arr->vertices[u], arr->vertices[w], p,
+                             tolerance)) {
+              continue;
+            }
+            if (size == capacity) {
+              capacity *= 2;
+              near = realloc(near, sizeof(uint64_t) * capacity);
+            }
+            near[size++] = (uint64_t)e << 32 | v;
+          }
+        }
+      }
+    }
+    free(grid.starts);
+    free(grid.edges);
+    if (size == 0) {
+      free(near);
+      return;
+    }
+
+    // Each edge becomes pieces through its near vertices, ordered along it.
+    // An edge listed in several cells finds a vertex more than once.
+    radix_sort_keys(near, NULL, size, num_threads);
+    unsigned num_pairs = arr->num_edges / 2;
+    Piece *pieces = malloc(sizeof(Piece) * (num_pairs + size));
+    Stop *stops = malloc(sizeof(Stop) * size);
+    unsigned num_pieces = 0;
+    for (unsigned e = 0, i = 0; e < num_pairs; ++e) {
+      unsigned u = arr->edges[2 * e].origin;
+      unsigned w = arr->edges[2 * e + 1].origin;
+      Point a = arr->vertices[u];
+      Point b = arr->vertices[w];
+      unsigned num_stops = 0;
+      for (; i < size && near[i] >> 32 == e; ++i) {
+        if (i > 0 && near[i] == near[i - 1]) {
+          continue;
+        }
+        unsigned v = (uint32_t)near[i];
+        Point p = arr->vertices[v];
+        stops[num_stops++] = (Stop){
+            .along = (p.x - a.x) * (b.x - a.x) + (p.y - a.y) * (b.y - a.y),
+            .vertex = v};
+      }
+      qsort(stops, num_stops, sizeof(Stop), compare_stops);
+      unsigned segment = arr->edges[2 * e].segment;
+      for (unsigned j = 0; j < num_stops; ++j) {
+        pieces[num_pieces++] =
+            (Piece){.u = u, .v = stops[j].vertex, .segment = segment};
+        u = stops[j].vertex;
+      }
+      pieces[num_pieces++] = (Piece){.u = u, .v = w, .segment = segment};
+    }
+    free(stops);
+    free(near);
+
+    pieces = unique_pieces(pieces, num_pieces, num_threads, &num_pieces);
+    arr->num_edges = 2 * num_pieces;
+    arr->edges = realloc(arr->edges,
+                         sizeof(ArrangementHalfEdge) * (2 * num_pieces + 1));
+    for (unsigned i = 0; i < num_pieces; ++i) {
+      arr->edges[2 * i] = (ArrangementHalfEdge){.origin = pieces[i].u,
+                                                .segment = pieces[i].segment};
+      arr->edges[2 * i + 1] = (ArrangementHalfEdge){
+          .origin = pieces[i].v, .segment = pieces[i].segment};
+    }
+    free(pieces);
+  }
+}
+
+// Splits the cycles of next into faces and holes, and places each hole in the
+// face around it.
+static void build_faces(Arrangement *arr, const unsigned *starts,
+                        const unsigned *around, const uint64_t *keys) {
+  unsigned num_edges = arr->num_edges;
+  // The cycle of each half-edge goes in its face field until faces are known
+  unsigned *cycle_edges = malloc(sizeof(unsigned) * (num_edges + 1));
+  unsigned num_cycles = 0;
+  for (unsigned h = 0; h < num_edges; ++h) {
+    arr->edges[h].face = UINT_MAX;
+  }
+  for (unsigned h = 0; h < num_edges; ++h) {
+    if (arr->edges[h].face != UINT_MAX) {
+      continue;
+    }
+    // The cycle's leftmost lowest vertex
+    unsigned lowest = h;
+    unsigned g = h;
+    do {
+      arr->edges[g].face = num_cycles;
+      if (lexicographic_less(arr->vertices[arr->edges[g].origin],
+                             arr->vertices[arr->edges[lowest].origin])) {
+        lowest = g;
+      }
+      g = arr->edges[g].next;
+    } while (g != h);
+    cycle_edges[num_cycles++] = lowest;
+  }
+
+  // Faces are numbered in cycle order after the unbounded face
+  unsigned *cycle_faces = malloc(sizeof(unsigned) * (num_cycles + 1));
+  unsigned *holes = malloc(sizeof(unsigned) * (num_cycles + 1));
+  unsigned num_holes = 0;
+  arr->face_edges = malloc(sizeof(unsigned) * (num_cycles + 1));
+  arr->face_edges[0] = UINT_MAX;
+  arr->num_faces = 1;
+  for (unsigned c = 0; c < num_cycles; ++c) {
+    unsigned v = arr->edges[cycle_edges[c]].origin;
+    unsigned west = west_edge(starts, around, keys, v);
+    if (arr->edges[west].face == c) {
+      cycle_faces[c] = UINT_MAX;
+      holes[num_holes++] = c;
+    } else {
+      cycle_faces[c] = arr->num_faces;
+      arr->face_edges[arr->num_faces++] = cycle_edges[c];
+    }
+  }
+
+  // Holes from left to right
+  uint64_t *hole_keys = malloc(sizeof(uint64_t) * (num_holes + 1));
+  for (unsigned i = 0; i < num_holes; ++i) {
+    Point lowest = arr->vertices[arr->edges[cycle_edges[holes[i]]].origin];
+    hole_keys[i] = double_sort_key(lowest.x);
+  }
+  radix_sort_keys(hole_keys, holes, num_holes, 1);
+  free(hole_keys);
+  EdgeGrid grid = {0};
+  if (num_holes > 1) {
+    edge_grid_init(&grid, arr);
+  }
+  for (unsigned i = 0; i < num_holes; ++i) {
+    unsigned c = holes[i];
+    unsigned hit =
+        i == 0 ? UINT_MAX
+               : cast_west(&grid, arr,
+                           arr->vertices[arr->edges[cycle_edges[c]].origin]);
+    cycle_faces[c] = hit == UINT_MAX ? 0 : cycle_faces[arr->edges[hit].face];
+    assert(cycle_faces[c] != UINT_MAX &&
+           "a hole must be placed after the hole around it");
+  }
+  if (num_holes > 1) {
+    free(grid.starts);
+    free(grid.edges);
+  }
+
+  arr->hole_starts = calloc(arr->num_faces + 1, sizeof(unsigned));
+  arr->holes = malloc(sizeof(unsigned) * (num_holes + 1));
+  for (unsigned i = 0; i < num_holes; ++i) {
+    ++arr->hole_starts[cycle_faces[holes[i]] + 1];
+  }
+  for (unsigned f = 0; f < arr->num_faces; ++f) {
+    arr->hole_starts[f + 1] += arr->hole_starts[f];
+  }
+  for (unsigned i = 0; i < num_holes; ++i) {
+    unsigned face = cycle_faces[holes[i]];
+    arr->holes[arr->hole_starts[face]++] = cycle_edges[holes[i]];
+  }
+  memmove(arr->hole_starts + 1, arr->hole_starts,
+          sizeof(unsigned) * arr->num_faces);
+  arr->hole_starts[0] = 0;
+
+  for (unsigned h = 0; h < num_edges; ++h) {
+    arr->edges[h].face = cycle_faces[arr->edges[h].face];
+  }
+  arr->face_edges =
+      realloc(arr->face_edges, sizeof(unsigned) * arr->num_faces);
+  free(holes);
+  free(cycle_faces);
+  free(cycle_edges);
+}
+
+void arrangement_build(const Segment *segments, unsigned n,
+                       unsigned num_threads, Arrangement *out) {
+  assert((segments || n == 0) && "cannot build from NULL segments");
+  assert(num_threads > 0 && "need at least one thread");
+  SplitList splits = {
+      .segments = segments,
+      .data = malloc(sizeof(Split) * INITIAL_CAPACITY),
+      .size = 0,
+      .capacity = INITIAL_CAPACITY,
+  };
+  if (num_threads > 1) {
+    unsigned count;
+    SegmentIntersection *pairs =
+        segment_intersections_parallel(segments, n, num_threads, &count);
+    for (unsigned i = 0; i < count; ++i) {
+      add_intersection(pairs[i], &splits);
+    }
+    free(pairs);
+  } else {
+    segment_intersections_sweep(segments, n, add_intersection, &splits);
+  }
+
+  // A soup of points at the origin merges at any positive distance
+  double magnitude = 0;
+  for (unsigned i = 0; i < n; ++i) {
+    magnitude = fmax(magnitude, fmax(fmax(fabs(segments[i].p0.x),
+                                          fabs(segments[i].p0.y)),
+                                     fmax(fabs(segments[i].p1.x),
+                                          fabs(segments[i].p1.y))));
+  }
+  double tolerance = magnitude > 0 ? magnitude * VERTEX_MERGE : 1;
+  VertexHash hash;
+  vertex_hash_init(&hash, n, tolerance);
+  unsigned num_pieces;
+  Piece *pieces =
+      build_pieces(segments, n, &splits, num_threads, &hash, &num_pieces);
+  free(splits.data);
+  free(hash.slots);
+  free(hash.chain);
+
+  // Drop vertices of segments that merged into a single point
+  unsigned *renumber = malloc(sizeof(unsigned) * (hash.size + 1));
+  memset(renumber, 0xff, sizeof(unsigned) * hash.size);
+  for (unsigned i = 0; i < num_pieces; ++i) {
+    renumber[pieces[i].u] = renumber[pieces[i].v] = 0;
+  }
+  unsigned num_vertices = 0;
+  for (unsigned v = 0; v < hash.size; ++v) {
+    if (renumber[v] != UINT_MAX) {
+      hash.points[num_vertices] = hash.points[v];
+      renumber[v] = num_vertices++;
+    }
+  }
+
+  *out = (Arrangement){
+      .vertices = realloc(hash.points, sizeof(Point) * (num_vertices + 1)),
+      .vertex_edges = malloc(sizeof(unsigned) * (num_vertices + 1)),
+      .edges = malloc(sizeof(ArrangementHalfEdge) * (2 * num_pieces + 1)),
+      .num_vertices = num_vertices,
+      .num_edges = 2 * num_pieces,
+  };
+  for (unsigned i = 0; i < num_pieces; ++i) {
+    out->edges[2 * i] = (ArrangementHalfEdge){
+        .origin = renumber[pieces[i].u], .segment = pieces[i].segment};
+    out->edges[2 * i + 1] = (ArrangementHalfEdge){
+        .origin = renumber[pieces[i].v], .segment = pieces[i].segment};
+  }
+  free(renumber);
+  free(pieces);
+  snap_edges(out, tolerance, num_threads);
+
+  unsigned *starts = malloc(sizeof(unsigned) * (num_vertices + 1));
+  unsigned *around = malloc(sizeof(unsigned) * (out->num_edges + 1));
+  uint64_t *keys = malloc(sizeof(uint64_t) * (out->num_edges + 1));
+  link_edges(out, num_threads, starts, around, keys);
+  build_faces(out, starts, around, keys);
+  free(keys);
+  free(around);
+  free(starts);
+}
+
+void arrangement_free(Arrangement *arr) {
+  free(arr->vertices);
+  free(arr->vertex_edges);
+  free(arr->edges);
+  free(arr->face_edges);
+  free(arr->hole_starts);
+  free(arr->holes);
+}
+
+unsigned arrangement_face_size(const Arrangement *arr, unsigned face) {
+  assert(face < arr->num_faces && "arrangement face out of bounds");
+  unsigned start = arr->face_edges[face];
+  if (start == UINT_MAX) {
+    return 0;
+  }
+  unsigned size = 0;
+  unsigned h = start;
+  do {
+    ++size;
+    h = arr->edges[h].next;
+  } while (h != start);
+  return size;
+}
+
+void arrangement_trapezoidal_map(const Arrangement *arr, TrapezoidalMap *map) {
+  unsigned n = arr->num_edges / 2;
+  Segment *segments = malloc(sizeof(Segment) * (n ? n : 1));
+  for (unsigned s = 0; s < n; ++s) {
+    segments[s] = (Segment){arr->vertices[arr->edges[2 * s].origin],
+                            arr->vertices[arr->edges[2 * s + 1].origin]};
+  }
+  trapezoidal_map_init(map, segments, n);
+  free(segments);
+}
+
+// The half-edge of the map's segment s that runs left to right, which the
+// face above the segment is on the left of.
+static unsigned rightward_edge(const Arrangement *arr,
+                               const TrapezoidalMap *map, unsigned s) {
+  Point origin = arr->vertices[arr->edges[2 * s].origin];
+  Point left = map->segments[s].p0;
+  return origin.x == left.x && origin.y == left.y ? 2 * s : 2 * s + 1;
+}
+
+static unsigned trapezoid_face(const Arrangement *arr,
+                               const TrapezoidalMap *map, unsigned t) {
+  Trapezoid trap = map->trapezoids[t];
+  if (trap.bottom != UINT_MAX) {
+    return arr->edges[rightward_edge(arr, map, trap.bottom)].face;
+  }
+  if (trap.top != UINT_MAX) {
+    unsigned h = arrangement_twin(rightward_edge(arr, map, trap.top));
+    return arr->edges[h].face;
+  }
+  return 0;
+}
+
+unsigned arrangement_locate(const Arrangement *arr, const TrapezoidalMap *map,
+                            Point p) {
+  return trapezoid_face(arr, map, trapezoidal_map_locate(map, p));
+}
+
+void arrangement_locate_many(const Arrangement *arr,
+                             const TrapezoidalMap *map, const Point *points,
+                             unsigned n, unsigned *faces,
+                             unsigned num_threads) {
+  trapezoidal_map_locate_many(map, points, n, faces, num_threads);
+  for (unsigned i = 0; i < n; ++i) {
+    faces[i] = trapezoid_face(arr, map, faces[i]);
+  }
+}
+
+void arrangement_validate(const Arrangement *arr) {
+  assert(arr && "arrangement must not be null");
+  assert(arr->num_edges % 2 == 0 && "half-edges come in pairs");
+  assert(arr->num_faces > 0 && arr->face_edges[0] == UINT_MAX &&
+         "face 0 is the unbounded face");
+  for (unsigned h = 0; h < arr->num_edges; ++h) {
+    const ArrangementHalfEdge *e = &arr->edges[h];
+    assert(e->origin < arr->num_vertices && e->next < arr->num_edges &&
+           e->prev < arr->num_edges && e->face < arr->num_faces &&
+           "arrangement index out of bounds");
+    assert(arr->edges[e->next].prev == h && arr->edges[e->prev].next == h &&
+           "next and prev must be inverse");
+    assert(arr->edges[e->next].origin == destination(arr, h) &&
+           "a half-edge must end where its next starts");
+    assert(arr->edges[e->next].face == e->face &&
+           "a face must be the same around its cycle");
+    assert(e->origin != destination(arr, h) && "half-edges must not be loops");
+  }
+  for (unsigned v = 0; v < arr->num_vertices; ++v) {
+    assert(arr->edges[arr->vertex_edges[v]].origin == v &&
+           "vertex edge must leave its vertex");
+  }
+  for (unsigned f = 1; f < arr->num_faces; ++f) {
+    assert(arr->edges[arr->face_edges[f]].face == f &&
+           "face edge must be on its face");
+  }
+  for (unsigned f = 0; f < arr->num_faces; ++f) {
+    for (unsigned i = arr->hole_starts[f]; i < arr->hole_starts[f + 1]; ++i) {
+      assert(arr->edges[arr->holes[i]].face == f &&
+             "hole edge must be on its face");
+    }
+  }
+}
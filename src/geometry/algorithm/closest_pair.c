@@ -0,0 +1,222 @@
+#include "geometry/algorithm/closest_pair.h"
+#include "data_structure/parallel.h"
+#include "data_structure/sort.h"
+#include "geometry/structure/kd_tree.h"
+#include <assert.h>
+#include <limits.h>
+#include <stdlib.h>
+
+// Ranges smaller than this are not split across threads.
+static const unsigned PARALLEL_CUTOFF = 1 << 12;
+
+typedef struct {
+  Point p;
+  unsigned index;
+} IndexedPoint;
+
+// Squared distance of the closest pair found so far.
+typedef struct {
+  double distance;
+  unsigned a;
+  unsigned b;
+} Best;
+
+static void consider(Best *best, IndexedPoint u, IndexedPoint v) {
+  double dx = u.p.x - v.p.x;
+  double dy = u.p.y - v.p.y;
+  double d = dx * dx + dy * dy;
+  if (d < best->distance) {
+    best->distance = d;
+    best->a = u.index < v.index ? u.index : v.index;
+    best->b = u.index < v.index ? v.index : u.index;
+  }
+}
+
+static Best closer(Best x, Best y) { return y.distance < x.distance ? y : x; }
+
+static Best closest_in_range(IndexedPoint *points, IndexedPoint *scratch,
+                             unsigned lo, unsigned hi, unsigned num_threads);
+
+typedef struct {
+  IndexedPoint *points;
+  IndexedPoint *scratch;
+  unsigned lo;
+  unsigned hi;
+  unsigned num_threads;
+  Best best;
+} ClosestJob;
+
+static void *closest_job(void *data) {
+  ClosestJob *job = data;
+  job->best = closest_in_range(job->points, job->scratch, job->lo, job->hi,
+                               job->num_threads);
+  return NULL;
+}
+
+// Returns the closest pair of points[lo..hi), which is sorted by x, and leaves
+// the range sorted by y. Uses scratch[lo..hi) for merging and the strip.
+static Best closest_in_range(IndexedPoint *points, IndexedPoint *scratch,
+                             unsigned lo, unsigned hi, unsigned num_threads) {
+  Best best = {.distance = INFINITY, .a = UINT_MAX, .b = UINT_MAX};
+  if (hi - lo <= 3) {
+    for (unsigned i = lo; i < hi; ++i) {
+      for (unsigned j = i + 1; j < hi; ++j) {
+        consider(&best, points[i], points[j]);
+      }
+    }
+    for (unsigned i = lo + 1; i < hi; ++i) {
+      IndexedPoint p = points[i];
+      unsigned j = i;
+      for (; j > lo && points[j - 1].p.y > p.p.y; --j) {
+        points[j] = points[j - 1];
+      }
+      points[j] = p;
+    }
+    return best;
+  }
+
+  unsigned mid = lo + (hi - lo) / 2;
+  double mid_x = points[mid].p.x;
+  if (num_threads > 1 && hi - lo >= PARALLEL_CUTOFF) {
+    ClosestJob halves[] = {
+        {
+            .points = points,
+            .scratch = scratch,
+            .lo = lo,
+            .hi = mid,
+            .num_threads = num_threads / 2,
+        },
+        {
+            .points = points,
+            .scratch = scratch,
+            .lo = mid,
+            .hi = hi,
+            .num_threads = num_threads - num_threads / 2,
+        },
+    };
+    parallel_for(2, closest_job, halves, sizeof(ClosestJob));
+    best = closer(halves[0].best, halves[1].best);
+  } else {
+    best = closer(closest_in_range(points, scratch, lo, mid, 1),
+                  closest_in_range(points, scratch, mid, hi, 1));
+  }
+
+  // Merge the halves by y
+  unsigned i = lo;
+  unsigned j = mid;
+  unsigned k = lo;
+  while (i < mid && j < hi) {
+    scratch[k++] = points[j].p.y < points[i].p.y ? points[j++] : points[i++];
+  }
+  while (i < mid) {
+    scratch[k++] = points[i++];
+  }
+  while (j < hi) {
+    scratch[k++] = points[j++];
+  }
+  for (k = lo; k < hi; ++k) {
+    points[k] = scratch[k];
+  }
+
+  // Only points closer to the dividing line than the best distance can pair
+  // across it, and each needs to be checked against the few before it in y
+  // order that are within the best distance in y
+  unsigned strip = lo;
+  for (i = lo; i < hi; ++i) {
+    double dx = points[i].p.x - mid_x;
+    if (dx * dx >= best.distance) {
+      continue;
+    }
+    for (j = strip; j-- > lo;) {
+      double dy = points[i].p.y - scratch[j].p.y;
+      if (dy * dy >= best.distance) {
+        break;
+      }
+      consider(&best, points[i], scratch[j]);
+    }
+    scratch[strip++] = points[i];
+  }
+  return best;
+}
+
+bool closest_pair_parallel(const Point *points, unsigned n,
+                           unsigned num_threads, unsigned *a, unsigned *b) {
+  assert((points || n == 0) && "cannot search NULL points");
+  assert(num_threads > 0 && "need at least one thread");
+  if (n < 2) {
+    return false;
+  }
+  uint64_t *keys = malloc(sizeof(uint64_t) * n);
+  unsigned *order = malloc(sizeof(unsigned) * n);
+  for (unsigned i = 0; i < n; ++i) {
+    keys[i] = double_sort_key(points[i].x);
+    order[i] = i;
+  }
+  radix_sort_keys(keys, order, n, num_threads);
+  IndexedPoint *sorted = malloc(sizeof(IndexedPoint) * n);
+  IndexedPoint *scratch = malloc(sizeof(IndexedPoint) * n);
+  for (unsigned i = 0; i < n; ++i) {
+    sorted[i] = (IndexedPoint){.p = points[order[i]], .index = order[i]};
+  }
+  Best best = closest_in_range(sorted, scratch, 0, n, num_threads);
+  *a = best.a;
+  *b = best.b;
+  free(scratch);
+  free(sorted);
+  free(order);
+  free(keys);
+  return true;
+}
+
+bool closest_pair(const Point *points, unsigned n, unsigned *a, unsigned *b) {
+  return closest_pair_parallel(points, n, 1, a, b);
+}
+
+bool closest_pair_brute_force(const Point *points, unsigned n, unsigned *a,
+                              unsigned *b) {
+  assert((points || n == 0) && "cannot search NULL points");
+  if (n < 2) {
+    return false;
+  }
+  Best best = {.distance = INFINITY, .a = UINT_MAX, .b = UINT_MAX};
+  for (unsigned i = 0; i < n; ++i) {
+    for (unsigned j = i + 1; j < n; ++j) {
+      consider(&best, (IndexedPoint){.p = points[i], .index = i},
+               (IndexedPoint){.p = points[j], .index = j});
+    }
+  }
+  *a = best.a;
+  *b = best.b;
+  return true;
+}
+
+void all_nearest_neighbors_parallel(const Point *points, unsigned n,
+                                    unsigned num_threads, unsigned *nearest) {
+  assert((points || n == 0) && "cannot search NULL points");
+  if (n < 2) {
+    for (unsigned i = 0; i < n; ++i) {
+      nearest[i] = UINT_MAX;
+    }
+    return;
+  }
+  KDTree tree;
+  kd_tree_init(&tree, points, n);
+  // Query in the tree's order, where consecutive queries are close together
+  // and visit the same nodes. The two nearest points of each point include
+  // the point itself, unless it has duplicates.
+  unsigned *ids = malloc(sizeof(unsigned) * 2 * n);
+  unsigned *counts = malloc(sizeof(unsigned) * n);
+  kd_tree_nearest_batch(&tree, tree.points, n, 2, ids, counts, num_threads);
+  for (unsigned i = 0; i < n; ++i) {
+    unsigned self = tree.ids[i];
+    nearest[self] = ids[2 * i] != self ? ids[2 * i] : ids[2 * i + 1];
+  }
+  free(counts);
+  free(ids);
+  kd_tree_free(&tree);
+}
+
+void all_nearest_neighbors(const Point *points, unsigned n,
+                           unsigned *nearest) {
+  all_nearest_neighbors_parallel(points, n, 1, nearest);
+}
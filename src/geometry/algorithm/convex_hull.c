@@ -0,0 +1,333 @@
+#include "geometry/algorithm/convex_hull.h"
+#include "data_structure/parallel.h"
+#include "data_structure/sort.h"
+#include "geometry/predicates.h"
+#include <assert.h>
+#include <stdlib.h>
+
+static bool point_before(Point a, Point b) {
+  return a.x < b.x || (a.x == b.x && a.y < b.y);
+}
+
+static bool point_same(Point a, Point b) { return a.x == b.x && a.y == b.y; }
+
+static Ordering point_cmp(void *a, void *b) {
+  Point *p = a;
+  Point *q = b;
+  if (point_before(*p, *q)) {
+    return LESS;
+  }
+  if (point_before(*q, *p)) {
+    return GREATER;
+  }
+  return EQUALS;
+}
+
+// Monotone chain over points sorted by x, then y. Returns the hull length and
+// writes the hull to out, which must hold n + 1 points.
+static unsigned monotone_chain_sorted(const Point *sorted, unsigned n,
+                                      Point *out) {
+  unsigned h = 0;
+  // Lower hull, left to right
+  for (unsigned i = 0; i < n; ++i) {
+    Point p = sorted[i];
+    while (h >= 2 && orient2d(out[h - 2], out[h - 1], p) <= 0) {
+      --h;
+    }
+    if (h == 0 || !point_same(out[h - 1], p)) {
+      out[h++] = p;
+    }
+  }
+  // Upper hull, right to left
+  unsigned lower = h;
+  for (unsigned i = n; i-- > 0;) {
+    Point p = sorted[i];
+    while (h > lower && orient2d(out[h - 2], out[h - 1], p) <= 0) {
+      --h;
+    }
+    if (!point_same(out[h - 1], p)) {
+      out[h++] = p;
+    }
+  }
+  // The last point is the first one again, unless there is only one
+  return h > 1 ? h - 1 : h;
+}
+
+Point *convex_hull_monotone_chain(const Point *points, unsigned n,
+                                  unsigned *count) {
+  assert((points || n == 0) && "cannot compute the hull of NULL points");
+  void **sorted = malloc(sizeof(void *) * (n ? n : 1));
+  for (unsigned i = 0; i < n; ++i) {
+    sorted[i] = (void *)&points[i];
+  }
+  tim_sortc(sorted, n, point_cmp);
+  Point *work = malloc(sizeof(Point) * (n ? n : 1));
+  for (unsigned i = 0; i < n; ++i) {
+    work[i] = *(Point *)sorted[i];
+  }
+  free(sorted);
+  Point *hull = malloc(sizeof(Point) * (n + 1));
+  *count = monotone_chain_sorted(work, n, hull);
+  free(work);
+  return realloc(hull, sizeof(Point) * (*count ? *count : 1));
+}
+
+// Indices of the lexicographically smallest and largest points.
+static void extremes(const Point *points, unsigned n, unsigned *min,
+                     unsigned *max) {
+  *min = 0;
+  *max = 0;
+  for (unsigned i = 1; i < n; ++i) {
+    if (point_before(points[i], points[*min])) {
+      *min = i;
+    }
+    if (point_before(points[*max], points[i])) {
+      *max = i;
+    }
+  }
+}
+
+// Moves the points strictly right of a -> b to the front of points and returns
+// how many there are.
+static unsigned partition_right(Point *points, unsigned n, Point a, Point b) {
+  unsigned m = 0;
+  for (unsigned i = 0; i < n; ++i) {
+    if (orient2d(a, b, points[i]) < 0) {
+      Point p = points[m];
+      points[m++] = points[i];
+      points[i] = p;
+    }
+  }
+  return m;
+}
+
+// Writes the hull vertices strictly between a and b to out, given the points
+// strictly right of a -> b. Returns how many were written.
+static unsigned quickhull_rec(Point a, Point b, Point *points, unsigned n,
+                              Point *out) {
+  if (n == 0) {
+    return 0;
+  }
+  // Farthest from the line through a and b. Of several equally far points,
+  // only the ones at the ends are hull vertices, so ties go to the one closest
+  // to a along the line.
+  unsigned farthest = 0;
+  double farthest_orientation = 0;
+  double farthest_along = 0;
+  for (unsigned i = 0; i < n; ++i) {
+    Point p = points[i];
+    double o = orient2d(a, b, p);
+    double along = (p.x - a.x) * (b.x - a.x) + (p.y - a.y) * (b.y - a.y);
+    if (o < farthest_orientation ||
+        (o == farthest_orientation && along < farthest_along)) {
+      farthest = i;
+      farthest_orientation = o;
+      farthest_along = along;
+    }
+  }
+  Point c = points[farthest];
+
+  // Points right of a -> c go to the front, then points right of c -> b.
+  // Points in the triangle abc are dropped.
+  unsigned before = partition_right(points, n, a, c);
+  unsigned after = partition_right(points + before, n - before, c, b);
+  unsigned h = quickhull_rec(a, c, points, before, out);
+  out[h++] = c;
+  h += quickhull_rec(c, b, points + before, after, out + h);
+  return h;
+}
+
+Point *convex_hull_quickhull(const Point *points, unsigned n,
+                             unsigned *count) {
+  assert((points || n == 0) && "cannot compute the hull of NULL points");
+  Point *hull = malloc(sizeof(Point) * (n ? n : 1));
+  if (n == 0) {
+    *count = 0;
+    return hull;
+  }
+  Point *work = malloc(sizeof(Point) * n);
+  for (unsigned i = 0; i < n; ++i) {
+    work[i] = points[i];
+  }
+  unsigned min;
+  unsigned max;
+  extremes(work, n, &min, &max);
+  Point a = work[min];
+  Point b = work[max];
+
+  unsigned h = 0;
+  hull[h++] = a;
+  if (point_same(a, b)) {
+    free(work);
+    *count = h;
+    return realloc(hull, sizeof(Point));
+  }
+  // The lower hull from a to b, then the upper hull back
+  unsigned lower = partition_right(work, n, a, b);
+  h += quickhull_rec(a, b, work, lower, hull + h);
+  hull[h++] = b;
+  unsigned upper = partition_right(work + lower, n - lower, b, a);
+  h += quickhull_rec(b, a, work + lower, upper, hull + h);
+  free(work);
+  *count = h;
+  return realloc(hull, sizeof(Point) * h);
+}
+
+unsigned convex_hull_filter(const Point *points, unsigned n, Point *out) {
+  assert((points || n == 0) && "cannot filter NULL points");
+  if (n == 0) {
+    return 0;
+  }
+  // Extremes in counter-clockwise order of direction, starting from -x
+  unsigned octagon[8] = {0};
+  for (unsigned i = 1; i < n; ++i) {
+    Point p = points[i];
+    if (p.x < points[octagon[0]].x) {
+      octagon[0] = i;
+    }
+    if (p.x + p.y < points[octagon[1]].x + points[octagon[1]].y) {
+      octagon[1] = i;
+    }
+    if (p.y < points[octagon[2]].y) {
+      octagon[2] = i;
+    }
+    if (p.x - p.y > points[octagon[3]].x - points[octagon[3]].y) {
+      octagon[3] = i;
+    }
+    if (p.x > points[octagon[4]].x) {
+      octagon[4] = i;
+    }
+    if (p.x + p.y > points[octagon[5]].x + points[octagon[5]].y) {
+      octagon[5] = i;
+    }
+    if (p.y > points[octagon[6]].y) {
+      octagon[6] = i;
+    }
+    if (p.x - p.y < points[octagon[7]].x - points[octagon[7]].y) {
+      octagon[7] = i;
+    }
+  }
+
+  // Edges of the octagon, skipping repeated vertices
+  Point from[8];
+  Point to[8];
+  unsigned edges = 0;
+  for (unsigned i = 0; i < 8; ++i) {
+    Point a = points[octagon[i]];
+    Point b = points[octagon[(i + 1) % 8]];
+    if (!point_same(a, b)) {
+      from[edges] = a;
+      to[edges] = b;
+      ++edges;
+    }
+  }
+
+  unsigned m = 0;
+  for (unsigned i = 0; i < n; ++i) {
+    Point p = points[i];
+    // An octagon with fewer than three edges has no interior
+    bool inside = edges >= 3;
+    for (unsigned e = 0; e < edges && inside; ++e) {
+      inside = orient2d(from[e], to[e], p) > 0;
+    }
+    if (!inside) {
+      out[m++] = p;
+    }
+  }
+  return m;
+}
+
+// Restores the heap order of points[i..n) below i, largest first.
+static void sift_down(Point *points, unsigned i, unsigned n) {
+  Point p = points[i];
+  for (unsigned child = 2 * i + 1; child < n; child = 2 * i + 1) {
+    if (child + 1 < n && point_before(points[child], points[child + 1])) {
+      ++child;
+    }
+    if (!point_before(p, points[child])) {
+      break;
+    }
+    points[i] = points[child];
+    i = child;
+  }
+  points[i] = p;
+}
+
+// Heap sort by x, then y, which needs no memory beyond the points.
+static void heap_sort_points(Point *points, unsigned n) {
+  for (unsigned i = n / 2; i-- > 0;) {
+    sift_down(points, i, n);
+  }
+  for (unsigned end = n; end-- > 1;) {
+    Point p = points[0];
+    points[0] = points[end];
+    points[end] = p;
+    sift_down(points, 0, end);
+  }
+}
+
+unsigned convex_hull_scratch_size(unsigned n) { return 2 * n + 1; }
+
+Point *convex_hull_in_scratch(const Point *points, unsigned n, Point *scratch,
+                              unsigned *count) {
+  assert((points || n == 0) && "cannot compute the hull of NULL points");
+  assert((scratch || n == 0) && "convex_hull_in_scratch needs scratch");
+  unsigned m = convex_hull_filter(points, n, scratch);
+  heap_sort_points(scratch, m);
+  *count = monotone_chain_sorted(scratch, m, scratch + m);
+  return scratch + m;
+}
+
+Point *convex_hull(const Point *points, unsigned n, unsigned *count) {
+  assert((points || n == 0) && "cannot compute the hull of NULL points");
+  Point *candidates = malloc(sizeof(Point) * (n ? n : 1));
+  unsigned m = convex_hull_filter(points, n, candidates);
+  Point *hull = convex_hull_monotone_chain(candidates, m, count);
+  free(candidates);
+  return hull;
+}
+
+typedef struct {
+  const Point *points;
+  unsigned n;
+  Point *hull;
+  unsigned count;
+} HullChunk;
+
+static void *chunk_hull(void *data) {
+  HullChunk *chunk = data;
+  chunk->hull = convex_hull(chunk->points, chunk->n, &chunk->count);
+  return NULL;
+}
+
+Point *convex_hull_parallel(const Point *points, unsigned n,
+                            unsigned num_threads, unsigned *count) {
+  assert((points || n == 0) && "cannot compute the hull of NULL points");
+  assert(num_threads > 0 && "need at least one thread");
+  HullChunk *chunks = malloc(sizeof(HullChunk) * num_threads);
+  for (unsigned t = 0; t < num_threads; ++t) {
+    unsigned lo = (unsigned)((unsigned long)n * t / num_threads);
+    unsigned hi = (unsigned)((unsigned long)n * (t + 1) / num_threads);
+    chunks[t] = (HullChunk){.points = points + lo, .n = hi - lo};
+  }
+
+  parallel_for(num_threads, chunk_hull, chunks, sizeof(HullChunk));
+
+  // The hull of the union is the hull of the chunk hulls
+  unsigned total = 0;
+  for (unsigned t = 0; t < num_threads; ++t) {
+    total += chunks[t].count;
+  }
+  Point *merged = malloc(sizeof(Point) * (total ? total : 1));
+  unsigned m = 0;
+  for (unsigned t = 0; t < num_threads; ++t) {
+    for (unsigned i = 0; i < chunks[t].count; ++i) {
+      merged[m++] = chunks[t].hull[i];
+    }
+    free(chunks[t].hull);
+  }
+  Point *hull = convex_hull_monotone_chain(merged, m, count);
+  free(merged);
+  free(chunks);
+  return hull;
+}
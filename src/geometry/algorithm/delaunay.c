@@ -0,0 +1,403 @@
+#include "geometry/algorithm/delaunay.h"
+#include "data_structure/parallel.h"
+#include "data_structure/sort.h"
+#include "geometry/predicates.h"
+#include "geometry/space_filling_curve.h"
+#include <assert.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+// Round r holds about half the points of round r - 1, and the last round holds
+// half of all points. Rounds past this one are merged into it.
+static const unsigned MAX_ROUNDS = 16;
+static const unsigned INITIAL_SCRATCH = 64;
+
+// A well mixed hash of i, from splitmix64, so rounds are random but the same
+// on every run and thread.
+static uint64_t mix(uint64_t i) {
+  i += 0x9e3779b97f4a7c15;
+  i = (i ^ (i >> 30)) * 0xbf58476d1ce4e5b9;
+  i = (i ^ (i >> 27)) * 0x94d049bb133111eb;
+  return i ^ (i >> 31);
+}
+
+typedef struct {
+  const Point *points;
+  uint64_t *keys;
+  unsigned *order;
+  const CurveGrid *grid;
+  unsigned lo;
+  unsigned hi;
+} KeyChunk;
+
+static void *key_chunk(void *data) {
+  KeyChunk *chunk = data;
+  curve_grid_keys(chunk->grid, CURVE_HILBERT, chunk->points + chunk->lo,
+                  chunk->hi - chunk->lo, chunk->keys + chunk->lo);
+  for (unsigned i = chunk->lo; i < chunk->hi; ++i) {
+    uint64_t round = (uint64_t)__builtin_ctzll(mix(i) | 1ull << MAX_ROUNDS);
+    if (round >= MAX_ROUNDS) {
+      round = MAX_ROUNDS - 1;
+    }
+    // Small rounds first, above the Hilbert curve position
+    uint64_t prefix = MAX_ROUNDS - 1 - round;
+    chunk->keys[i] |= prefix << (2 * chunk->grid->bits);
+    chunk->order[i] = i;
+  }
+  return NULL;
+}
+
+// Fills order with the biased randomized insertion order of the points.
+static void insertion_order(const Point *points, unsigned n,
+                            unsigned num_threads, unsigned *order) {
+  BBox box = bbox_from_point(points[0]);
+  for (unsigned i = 1; i < n; ++i) {
+    box = bbox_union(box, bbox_from_point(points[i]));
+  }
+  CurveGrid grid;
+  curve_grid_init(&grid, box, curve_grid_bits(n));
+
+  uint64_t *keys = malloc(sizeof(uint64_t) * n);
+  KeyChunk *chunks = malloc(sizeof(KeyChunk) * num_threads);
+  for (unsigned t = 0; t < num_threads; ++t) {
+    chunks[t] = (KeyChunk){
+        .points = points,
+        .keys = keys,
+        .order = order,
+        .grid = &grid,
+        .lo = (unsigned)((unsigned long)n * t / num_threads),
+        .hi = (unsigned)((unsigned long)n * (t + 1) / num_threads),
+    };
+  }
+  parallel_for(num_threads, key_chunk, chunks, sizeof(KeyChunk));
+  radix_sort_keys(keys, order, n, num_threads);
+  free(chunks);
+  free(keys);
+}
+
+// An edge a -> b of the cavity's boundary, with the triangle outside of it
+// and the position of the cavity triangle among that triangle's neighbors.
+typedef struct {
+  unsigned a;
+  unsigned b;
+  unsigned outside;
+  unsigned back;
+} CavityEdge;
+
+// Vertices are positions in insertion order, and vertex `infinite` is a point
+// at infinity. Each hull edge has a ghost triangle with the infinite vertex on
+// its outside, so every triangle has three neighbors and points outside of the
+// hull are inserted the same way as points inside.
+typedef struct {
+  const Point *points;
+  unsigned infinite;
+  Triangle *triangles;
+  unsigned num_triangles;
+  // Per triangle, the last insertion whose cavity contains it
+  unsigned *marks;
+  unsigned stamp;
+  // Per vertex, the new triangle of the current insertion starting at it
+  unsigned *fan;
+  unsigned *cavity;
+  unsigned cavity_capacity;
+  CavityEdge *boundary;
+  unsigned boundary_capacity;
+  // A live triangle without the infinite vertex, where walks start
+  unsigned last;
+} Delaunay;
+
+static bool is_ghost(const Delaunay *d, const Triangle *t) {
+  return t->vertices[0] == d->infinite || t->vertices[1] == d->infinite ||
+         t->vertices[2] == d->infinite;
+}
+
+// Whether p is strictly inside the segment ab, given that the three are
+// collinear.
+static bool strictly_between(Point a, Point b, Point p) {
+  if (a.x != b.x) {
+    return (a.x < p.x && p.x < b.x) || (b.x < p.x && p.x < a.x);
+  }
+  return (a.y < p.y && p.y < b.y) || (b.y < p.y && p.y < a.y);
+}
+
+// Whether p is strictly inside the circumcircle of t. For a ghost triangle the
+// circle is the open half plane outside of its hull edge, plus the interior of
+// the edge itself.
+static bool in_conflict(const Delaunay *d, const Triangle *t, Point p) {
+  const unsigned *v = t->vertices;
+  for (unsigned i = 0; i < 3; ++i) {
+    if (v[i] == d->infinite) {
+      Point a = d->points[v[(i + 1) % 3]];
+      Point b = d->points[v[(i + 2) % 3]];
+      double o = orient2d(a, b, p);
+      return o != 0 ? o > 0 : strictly_between(a, b, p);
+    }
+  }
+  return incircle(d->points[v[0]], d->points[v[1]], d->points[v[2]], p) > 0;
+}
+
+// Walks from d->last towards p, crossing any edge that p is strictly on the
+// other side of. Stops at the finite triangle that contains p, or at the
+// ghost triangle of the hull edge the walk leaves through.
+static unsigned locate(const Delaunay *d, Point p) {
+  unsigned t = d->last;
+  unsigned from = UINT_MAX;
+  for (;;) {
+    const Triangle *tri = &d->triangles[t];
+    if (is_ghost(d, tri)) {
+      return t;
+    }
+    unsigned next = UINT_MAX;
+    for (unsigned i = 0; i < 3 && next == UINT_MAX; ++i) {
+      unsigned neighbor = tri->neighbors[i];
+      if (neighbor != from &&
+          orient2d(d->points[tri->vertices[(i + 1) % 3]],
+                   d->points[tri->vertices[(i + 2) % 3]], p) < 0) {
+        next = neighbor;
+      }
+    }
+    if (next == UINT_MAX) {
+      return t;
+    }
+    from = t;
+    t = next;
+  }
+}
+
+static void push_cavity(Delaunay *d, unsigned *size, unsigned t) {
+  if (*size == d->cavity_capacity) {
+    d->cavity_capacity *= 2;
+    d->cavity = realloc(d->cavity, sizeof(unsigned) * d->cavity_capacity);
+  }
+  d->marks[t] = d->stamp;
+  d->cavity[(*size)++] = t;
+}
+
+static void push_boundary(Delaunay *d, unsigned *size, CavityEdge e) {
+  if (*size == d->boundary_capacity) {
+    d->boundary_capacity *= 2;
+    d->boundary =
+        realloc(d->boundary, sizeof(CavityEdge) * d->boundary_capacity);
+  }
+  d->boundary[(*size)++] = e;
+}
+
+// Removes the triangles whose circumcircle contains vertex v and connects v to
+// the boundary of the hole they leave.
+static void insert(Delaunay *d, unsigned v) {
+  Point p = d->points[v];
+  unsigned start = locate(d, p);
+  Triangle *triangles = d->triangles;
+  for (unsigned i = 0; i < 3; ++i) {
+    unsigned u = triangles[start].vertices[i];
+    if (u != d->infinite && d->points[u].x == p.x && d->points[u].y == p.y) {
+      return;
+    }
+  }
+
+  // The triangles in conflict with p form a star shaped region around it, so
+  // a search from the first one over neighbors in conflict finds them all
+  ++d->stamp;
+  unsigned cavity_size = 0;
+  unsigned boundary_size = 0;
+  push_cavity(d, &cavity_size, start);
+  for (unsigned k = 0; k < cavity_size; ++k) {
+    unsigned c = d->cavity[k];
+    for (unsigned i = 0; i < 3; ++i) {
+      unsigned neighbor = triangles[c].neighbors[i];
+      if (d->marks[neighbor] == d->stamp) {
+        continue;
+      }
+      if (in_conflict(d, &triangles[neighbor], p)) {
+        push_cavity(d, &cavity_size, neighbor);
+        continue;
+      }
+      unsigned back = 0;
+      while (triangles[neighbor].neighbors[back] != c) {
+        ++back;
+      }
+      push_boundary(d, &boundary_size,
+                    (CavityEdge){.a = triangles[c].vertices[(i + 1) % 3],
+                                 .b = triangles[c].vertices[(i + 2) % 3],
+                                 .outside = neighbor,
+                                 .back = back});
+    }
+  }
+
+  // There are two more boundary edges than cavity triangles, so the new
+  // triangles take the cavity's slots and two new ones
+  while (cavity_size < boundary_size) {
+    push_cavity(d, &cavity_size, d->num_triangles++);
+  }
+  for (unsigned k = 0; k < boundary_size; ++k) {
+    unsigned slot = d->cavity[k];
+    CavityEdge e = d->boundary[k];
+    triangles[slot] = (Triangle){
+        .vertices = {e.a, e.b, v},
+        .neighbors = {UINT_MAX, UINT_MAX, e.outside},
+    };
+    triangles[e.outside].neighbors[e.back] = slot;
+    d->fan[e.a] = slot;
+  }
+  // Triangle (a, b, v) shares edge (b, v) with the triangle starting at b
+  for (unsigned k = 0; k < boundary_size; ++k) {
+    unsigned slot = d->cavity[k];
+    unsigned next = d->fan[triangles[slot].vertices[1]];
+    triangles[slot].neighbors[0] = next;
+    triangles[next].neighbors[1] = slot;
+    if (!is_ghost(d, &triangles[slot])) {
+      d->last = slot;
+    }
+  }
+}
+
+// Creates the triangle abc, which must be counterclockwise, and the ghost
+// triangles of its three edges.
+static void init_triangle(Delaunay *d, unsigned a, unsigned b, unsigned c) {
+  unsigned inf = d->infinite;
+  d->triangles[0] = (Triangle){.vertices = {a, b, c}, .neighbors = {2, 3, 1}};
+  d->triangles[1] = (Triangle){.vertices = {b, a, inf}, .neighbors = {3, 2, 0}};
+  d->triangles[2] = (Triangle){.vertices = {c, b, inf}, .neighbors = {1, 3, 0}};
+  d->triangles[3] = (Triangle){.vertices = {a, c, inf}, .neighbors = {2, 1, 0}};
+  d->num_triangles = 4;
+  d->last = 0;
+}
+
+// Moves the finite triangles to the front of the array, drops the ghosts, and
+// renames vertices back to input indices.
+static void compact(Delaunay *d, const unsigned *order, Triangulation *out) {
+  unsigned *index = malloc(sizeof(unsigned) * d->num_triangles);
+  unsigned count = 0;
+  for (unsigned t = 0; t < d->num_triangles; ++t) {
+    index[t] = is_ghost(d, &d->triangles[t]) ? UINT_MAX : count++;
+  }
+  // Triangles only move towards the front, so each is read before its slot is
+  // written
+  for (unsigned t = 0; t < d->num_triangles; ++t) {
+    if (index[t] == UINT_MAX) {
+      continue;
+    }
+    Triangle tri = d->triangles[t];
+    for (unsigned i = 0; i < 3; ++i) {
+      tri.vertices[i] = order[tri.vertices[i]];
+      tri.neighbors[i] = index[tri.neighbors[i]];
+    }
+    d->triangles[index[t]] = tri;
+  }
+  free(index);
+  out->triangles = realloc(d->triangles, sizeof(Triangle) * count);
+  out->num_triangles = count;
+}
+
+void delaunay_triangulate_parallel(const Point *points, unsigned n,
+                                   unsigned num_threads, Triangulation *out) {
+  assert((points || n == 0) && "cannot triangulate NULL points");
+  assert(num_threads > 0 && "need at least one thread");
+  assert(out && "out should not be null");
+  out->triangles = nullptr;
+  out->num_triangles = 0;
+  if (n < 3) {
+    return;
+  }
+  unsigned *order = malloc(sizeof(unsigned) * n);
+  insertion_order(points, n, num_threads, order);
+  // Work on a copy in insertion order, so consecutive insertions touch
+  // nearby memory
+  Point *sorted = malloc(sizeof(Point) * n);
+  for (unsigned i = 0; i < n; ++i) {
+    sorted[i] = points[order[i]];
+  }
+
+  // The first triangle is the first point, the next one at another
+  // position, and the next one off the line through both
+  unsigned second = 1;
+  while (second < n && sorted[second].x == sorted[0].x &&
+         sorted[second].y == sorted[0].y) {
+    ++second;
+  }
+  unsigned third = second + 1;
+  while (third < n && orient2d(sorted[0], sorted[second], sorted[third]) == 0) {
+    ++third;
+  }
+  if (third >= n) {
+    free(sorted);
+    free(order);
+    return;
+  }
+
+  // n + 1 vertices with the infinite one give 2(n + 1) - 4 triangles with
+  // the ghosts
+  Delaunay d = {
+      .points = sorted,
+      .infinite = n,
+      .triangles = malloc(sizeof(Triangle) * 2 * n),
+      .marks = calloc(2 * n, sizeof(unsigned)),
+      .stamp = 0,
+      .fan = malloc(sizeof(unsigned) * (n + 1)),
+      .cavity = malloc(sizeof(unsigned) * INITIAL_SCRATCH),
+      .cavity_capacity = INITIAL_SCRATCH,
+      .boundary = malloc(sizeof(CavityEdge) * INITIAL_SCRATCH),
+      .boundary_capacity = INITIAL_SCRATCH,
+  };
+  if (orient2d(sorted[0], sorted[second], sorted[third]) > 0) {
+    init_triangle(&d, 0, second, third);
+  } else {
+    init_triangle(&d, 0, third, second);
+  }
+  for (unsigned i = 1; i < n; ++i) {
+    if (i != second && i != third) {
+      insert(&d, i);
+    }
+  }
+  compact(&d, order, out);
+
+  free(d.boundary);
+  free(d.cavity);
+  free(d.fan);
+  free(d.marks);
+  free(sorted);
+  free(order);
+}
+
+void delaunay_triangulate(const Point *points, unsigned n, Triangulation *out) {
+  delaunay_triangulate_parallel(points, n, 1, out);
+}
+
+void triangulation_free(Triangulation *tri) {
+  free(tri->triangles);
+  tri->triangles = nullptr;
+  tri->num_triangles = 0;
+}
+
+void triangulation_validate(const Triangulation *tri, const Point *points,
+                            unsigned n) {
+  assert(tri && "triangulation should not be null");
+  assert((tri->triangles || tri->num_triangles == 0) &&
+         "triangles should not be null");
+  for (unsigned t = 0; t < tri->num_triangles; ++t) {
+    const unsigned *v = tri->triangles[t].vertices;
+    for (unsigned i = 0; i < 3; ++i) {
+      assert(v[i] < n && "vertex out of range");
+    }
+    assert(orient2d(points[v[0]], points[v[1]], points[v[2]]) > 0 &&
+           "triangle should be counterclockwise");
+    for (unsigned i = 0; i < 3; ++i) {
+      unsigned neighbor = tri->triangles[t].neighbors[i];
+      if (neighbor == UINT_MAX) {
+        continue;
+      }
+      assert(neighbor < tri->num_triangles && "neighbor out of range");
+      const Triangle *other = &tri->triangles[neighbor];
+      unsigned a = v[(i + 1) % 3];
+      unsigned b = v[(i + 2) % 3];
+      bool linked = false;
+      for (unsigned j = 0; j < 3; ++j) {
+        linked |= other->neighbors[j] == t &&
+                  other->vertices[(j + 1) % 3] == b &&
+                  other->vertices[(j + 2) % 3] == a;
+      }
+      assert(linked && "neighbors should share the edge both ways");
+    }
+  }
+}
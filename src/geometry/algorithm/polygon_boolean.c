@@ -0,0 +1,960 @@
+// Polygon boolean operations with a Martinez-Rueda sweep, and clipping to
+// convex windows with Sutherland-Hodgman.
+//
+// The sweep follows Martinez, Rueda and Feito, "A simple algorithm for Boolean
+// operations on polygons" (2013). A vertical line sweeps left to right over
+// the edge endpoints of both inputs, kept in a PriorityQueue. Each edge has a
+// left and a right event, and the status is a RedBlackTree of the edges that
+// cross the sweep line, ordered bottom to top. Whenever two edges become
+// adjacent they are tested, and crossing edges are split at the crossing, so
+// by the time an edge leaves the status it crosses nothing. Overlapping edges
+// of the two inputs are split to the same pieces, and one piece of each pair
+// is kept to stand for both. Pairs of pieces of one input bound nothing under
+// the even-odd rule, and are dropped.
+//
+// When an edge enters the status, the edge below it tells whether the region
+// just below is inside each input. That decides whether the edge is part of
+// the result for the operation, and whether the result lies above or below
+// it. The result edges are then joined into rings by walking from each edge
+// to an unused one that starts where it ends. The closest result edge below a
+// ring's first edge tells whether the ring is a hole, and of which polygon.
+//
+// Orientations and edge overlaps are decided exactly with orient2d, against
+// the lines of the input edges, so a vertex on an input edge stays on every
+// piece of it. Only crossing points are rounded. They are clamped into both
+// pieces' boxes, and moved onto a piece's end within a few ulps of it.
+#include "geometry/algorithm/polygon_boolean.h"
+#include "data_structure/priority_queue.h"
+#include "data_structure/red_black_tree.h"
+#include "data_structure/sort.h"
+#include "data_structure/vector.h"
+#include "geometry/predicates.h"
+#include <assert.h>
+#include <limits.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Events are allocated in blocks of this many, so they never move
+static const unsigned EVENT_BLOCK_SIZE = 1024;
+
+// Crossings this close to an edge end, relative to the edges' coordinates,
+// are taken to be at it
+static const double CROSSING_SNAP = 0x1p-48;
+
+typedef enum {
+  EDGE_NORMAL,
+  // An overlapping edge that another edge stands for
+  EDGE_NON_CONTRIBUTING,
+  // Overlapping edges of the two inputs with the inside on the same side
+  EDGE_SAME_TRANSITION,
+  // Overlapping edges of the two inputs with the inside on opposite sides
+  EDGE_DIFFERENT_TRANSITION,
+} EdgeType;
+
+typedef struct Event Event;
+
+struct Event {
+  Point p;
+  // The event at the edge's other end
+  Event *other;
+  // The input edge that the edge is a piece of. Pieces ending at rounded
+  // crossings are compared by the input edge's line, so points on the input
+  // edge stay on all of its pieces.
+  const Segment *edge;
+  // Node in the status, or NULL if the edge is not in the status
+  RedBlackNode *node;
+  // Closest result edge below, for nesting the output rings
+  Event *below_in_result;
+  // Input ring, and creation order, to break ties between equal edges
+  unsigned ring;
+  unsigned id;
+  // Index of the event at the edge's other end among the result events
+  unsigned partner;
+  // Output ring the edge was joined into
+  unsigned output_ring;
+  EdgeType type;
+  bool left;
+  bool subject;
+  // Whether the piece runs against its input edge, which rounding can do
+  bool reversed;
+  // Whether crossing the edge upward leaves its own input. That is, whether
+  // the region just below it is inside its own input.
+  bool in_out;
+  // The same for the closest edge of the other input below, which is whether
+  // the edge is outside the other input
+  bool other_in_out;
+  bool in_result;
+  // Whether the region just above the edge is in the result
+  bool result_above;
+};
+
+typedef struct {
+  PolygonOperation op;
+  PriorityQueue queue;
+  RedBlackTree status;
+  Vector blocks;
+  unsigned block_used;
+  unsigned num_events;
+  // Input edges, left end first
+  Segment *edges;
+  unsigned num_edges;
+  // Events in the order they were processed
+  Vector processed;
+} Overlay;
+
+// A view of the rings of a Polygon or a PolygonSet.
+typedef struct {
+  const Point *points;
+  const unsigned *ring_starts;
+  const unsigned *polygon_starts;
+  unsigned num_rings;
+  unsigned num_polygons;
+} Rings;
+
+static bool same_point(Point a, Point b) { return a.x == b.x && a.y == b.y; }
+
+static bool point_before(Point a, Point b) {
+  return a.x < b.x || (a.x == b.x && a.y < b.y);
+}
+
+static Event *new_event(Overlay *ov, Point p, bool left, Event *other,
+                        bool subject, unsigned ring) {
+  if (ov->blocks.size == 0 || ov->block_used == EVENT_BLOCK_SIZE) {
+    vector_push(&ov->blocks, malloc(sizeof(Event) * EVENT_BLOCK_SIZE));
+    ov->block_used = 0;
+  }
+  Event *e = (Event *)ov->blocks.data[ov->blocks.size - 1] + ov->block_used++;
+  *e = (Event){
+      .p = p,
+      .other = other,
+      .node = NULL,
+      .below_in_result = NULL,
+      .ring = ring,
+      .id = ov->num_events++,
+      .partner = 0,
+      .output_ring = UINT_MAX,
+      .type = EDGE_NORMAL,
+      .left = left,
+      .subject = subject,
+  };
+  return e;
+}
+
+// Orientation of p to the line of the edge of e, positive above.
+static double edge_orient(const Event *e, Point p) {
+  double o = orient2d(e->edge->p0, e->edge->p1, p);
+  return e->reversed ? -o : o;
+}
+
+// Whether the edges of two events lie on one line.
+static bool collinear(const Event *a, const Event *b) {
+  return orient2d(a->edge->p0, a->edge->p1, b->edge->p0) == 0 &&
+         orient2d(a->edge->p0, a->edge->p1, b->edge->p1) == 0;
+}
+
+// Positive if the edge of b turns above the edge of a from the point where
+// both events are. The pieces themselves are compared, as the point may be a
+// rounded crossing off both input edges.
+static double turn(const Event *a, const Event *b) {
+  const Event *l = a->left ? a : a->other;
+  return orient2d(l->p, l->other->p, b->other->p);
+}
+
+// Which side of the edge of left event e the edge of left event f starts on,
+// positive above. An edge that starts on e goes by its direction instead,
+// which is its side of e just right of its start.
+static double side(const Event *e, const Event *f) {
+  double o = edge_orient(e, f->p);
+  return o != 0 ? o : edge_orient(e, f->other->p);
+}
+
+static bool is_vertical(const Event *e) { return e->p.x == e->other->p.x; }
+
+// Queue order. Points left to right, then bottom to top. At the same point,
+// right events come first, and among left or right events the lower edge.
+static Ordering event_cmp(void *va, void *vb) {
+  Event *a = va;
+  Event *b = vb;
+  if (a == b) {
+    return EQUALS;
+  }
+  if (a->p.x != b->p.x) {
+    return a->p.x < b->p.x ? LESS : GREATER;
+  }
+  if (a->p.y != b->p.y) {
+    return a->p.y < b->p.y ? LESS : GREATER;
+  }
+  if (a->left != b->left) {
+    return a->left ? GREATER : LESS;
+  }
+  double o = turn(a, b);
+  if (o != 0) {
+    return o > 0 ? LESS : GREATER;
+  }
+  if (a->subject != b->subject) {
+    return a->subject ? LESS : GREATER;
+  }
+  return a->id < b->id ? LESS : GREATER;
+}
+
+// Status order of two left events, bottom to top along the sweep line.
+static Ordering status_cmp(void *va, void *vb) {
+  Event *a = va;
+  Event *b = vb;
+  if (a == b) {
+    return EQUALS;
+  }
+  if (!collinear(a, b)) {
+    if (!same_point(a->p, b->p)) {
+      if (a->p.x == b->p.x) {
+        return a->p.y < b->p.y ? LESS : GREATER;
+      }
+      // Compare at the left end of the edge that was inserted later
+      if (event_cmp(a, b) == GREATER) {
+        return side(b, a) > 0 ? GREATER : LESS;
+      }
+      return side(a, b) > 0 ? LESS : GREATER;
+    }
+    double o = turn(a, b);
+    if (o != 0) {
+      return o > 0 ? LESS : GREATER;
+    }
+  }
+  // Collinear edges, or pieces that rounding put on one line. The subject's
+  // edge comes first, then edges of one input by where they start.
+  if (a->subject != b->subject) {
+    return a->subject ? LESS : GREATER;
+  }
+  if (same_point(a->p, b->p)) {
+    if (a->ring != b->ring) {
+      return a->ring < b->ring ? LESS : GREATER;
+    }
+    return a->id < b->id ? LESS : GREATER;
+  }
+  return event_cmp(a, b);
+}
+
+static bool in_result(const Event *e, PolygonOperation op) {
+  switch (e->type) {
+  case EDGE_NORMAL:
+    switch (op) {
+    case POLYGON_INTERSECTION:
+      return !e->other_in_out;
+    case POLYGON_UNION:
+      return e->other_in_out;
+    case POLYGON_DIFFERENCE:
+      return e->subject == e->other_in_out;
+    case POLYGON_XOR:
+      return true;
+    }
+    return false;
+  case EDGE_SAME_TRANSITION:
+    return op == POLYGON_INTERSECTION || op == POLYGON_UNION;
+  case EDGE_DIFFERENT_TRANSITION:
+    return op == POLYGON_DIFFERENCE;
+  case EDGE_NON_CONTRIBUTING:
+    return false;
+  }
+  return false;
+}
+
+// Whether the region just above a result edge is in the result.
+static bool above_in_result(const Event *e, PolygonOperation op) {
+  bool this_in = !e->in_out;
+  // An edge that stands for an overlapping pair is on the other input's
+  // boundary too, and its type says which side that input is on
+  bool that_in = e->type == EDGE_SAME_TRANSITION        ? this_in
+                 : e->type == EDGE_DIFFERENT_TRANSITION ? !this_in
+                                                        : !e->other_in_out;
+  switch (op) {
+  case POLYGON_INTERSECTION:
+    return this_in && that_in;
+  case POLYGON_UNION:
+    return this_in || that_in;
+  case POLYGON_DIFFERENCE:
+    return e->subject ? this_in && !that_in : that_in && !this_in;
+  case POLYGON_XOR:
+    return this_in != that_in;
+  }
+  return false;
+}
+
+// Sets the flags of a left event from prev, the edge just below it in the
+// status, or NULL if there is none.
+static void compute_fields(Event *e, const Event *prev, PolygonOperation op) {
+  if (!prev) {
+    e->in_out = false;
+    e->other_in_out = true;
+    e->below_in_result = NULL;
+  } else {
+    if (e->subject == prev->subject) {
+      e->in_out = !prev->in_out;
+      e->other_in_out = prev->other_in_out;
+    } else {
+      e->in_out = !prev->other_in_out;
+      e->other_in_out = is_vertical(prev) ? !prev->in_out : prev->in_out;
+    }
+    // A vertical edge is only below the sweep line at its top, so it cannot
+    // contain a ring that starts above it
+    e->below_in_result = !in_result(prev, op) || is_vertical(prev)
+                             ? prev->below_in_result
+                             : (Event *)prev;
+  }
+  e->in_result = in_result(e, op);
+  e->result_above = e->in_result && above_in_result(e, op);
+}
+
+// Splits the edge of left event e at p, which lies inside it.
+static void divide_segment(Overlay *ov, Event *e, Point p) {
+  Event *r = new_event(ov, p, false, e, e->subject, e->ring);
+  Event *l = new_event(ov, p, true, e->other, e->subject, e->ring);
+  r->edge = l->edge = e->edge;
+  r->reversed = l->reversed = e->reversed;
+  if (event_cmp(l, e->other) == GREATER) {
+    // Rounding put p past the edge's right end, so the right piece runs
+    // backwards
+    e->other->left = true;
+    l->left = false;
+    l->reversed = e->other->reversed = !e->reversed;
+  }
+  e->other->other = l;
+  e->other = r;
+  pq_push(&ov->queue, l);
+  pq_push(&ov->queue, r);
+}
+
+// Intersection of the edges of left events a and b. Returns 0 if they miss, 1
+// if they meet at one point, written to points[0], or 2 if they overlap from
+// points[0] to points[1].
+static unsigned intersect(const Event *a, const Event *b, Point points[2]) {
+  Point a0 = a->p, a1 = a->other->p, b0 = b->p, b1 = b->other->p;
+  if (collinear(a, b)) {
+    // Points on a line are ordered the same way along it and by
+    // point_before, so any overlap runs from the later left end to the
+    // earlier right end.
+    Point lo = point_before(a0, b0) ? b0 : a0;
+    Point hi = point_before(a1, b1) ? a1 : b1;
+    if (point_before(hi, lo)) {
+      return 0;
+    }
+    points[0] = lo;
+    points[1] = hi;
+    return same_point(lo, hi) ? 1 : 2;
+  }
+  double o0 = edge_orient(a, b0);
+  double o1 = edge_orient(a, b1);
+  double o2 = edge_orient(b, a0);
+  double o3 = edge_orient(b, a1);
+  if ((o0 > 0 && o1 > 0) || (o0 < 0 && o1 < 0) || (o2 > 0 && o3 > 0) ||
+      (o2 < 0 && o3 < 0)) {
+    return 0;
+  }
+  // An endpoint on the other edge is the exact intersection
+  if (o0 == 0 || o1 == 0) {
+    points[0] = o0 == 0 ? b0 : b1;
+    return 1;
+  }
+  if (o2 == 0 || o3 == 0) {
+    points[0] = o2 == 0 ? a0 : a1;
+    return 1;
+  }
+  // A proper crossing of the input edges' lines, where a's input ends are at
+  // distances from b's line in the ratio of their orientations
+  Segment sa = *a->edge, sb = *b->edge;
+  double d0 = orient2d(sb.p0, sb.p1, sa.p0);
+  double d1 = orient2d(sb.p0, sb.p1, sa.p1);
+  double t = d0 / (d0 - d1);
+  Point p = {.x = sa.p0.x + t * (sa.p1.x - sa.p0.x),
+             .y = sa.p0.y + t * (sa.p1.y - sa.p0.y)};
+  BBox box = {
+      .min_x = bbox_max(bbox_min(a0.x, a1.x), bbox_min(b0.x, b1.x)),
+      .min_y = bbox_max(bbox_min(a0.y, a1.y), bbox_min(b0.y, b1.y)),
+      .max_x = bbox_min(bbox_max(a0.x, a1.x), bbox_max(b0.x, b1.x)),
+      .max_y = bbox_min(bbox_max(a0.y, a1.y), bbox_max(b0.y, b1.y)),
+  };
+  points[0] = (Point){.x = bbox_max(box.min_x, bbox_min(p.x, box.max_x)),
+                      .y = bbox_max(box.min_y, bbox_min(p.y, box.max_y))};
+  // An end that misses the other edge by about the rounding error is taken as
+  // the crossing, rather than leaving a piece of a few ulps next to it
+  Point ends[4] = {a0, a1, b0, b1};
+  double magnitude = 0;
+  for (unsigned i = 0; i < 4; ++i) {
+    magnitude = fmax(magnitude, fmax(fabs(ends[i].x), fabs(ends[i].y)));
+  }
+  for (unsigned i = 0; i < 4; ++i) {
+    if (fabs(ends[i].x - points[0].x) <= magnitude * CROSSING_SNAP &&
+        fabs(ends[i].y - points[0].y) <= magnitude * CROSSING_SNAP) {
+      points[0] = ends[i];
+      break;
+    }
+  }
+  return 1;
+}
+
+static Event *node_event(RedBlackNode *n) {
+  return n ? rb_tree_node_val(n) : NULL;
+}
+
+// Tests the adjacent edges of left events a and b and splits them where they
+// meet. Returns 2 if they share their left end and overlap, in which case the
+// flags of both need computing again, and otherwise nonzero if they meet.
+// Overlapping edges of one input that share their left end are taken out of
+// the status instead.
+static unsigned possible_intersection(Overlay *ov, Event *a, Event *b) {
+  Point points[2];
+  unsigned count = intersect(a, b, points);
+  if (count == 0) {
+    return 0;
+  }
+  if (count == 1) {
+    if (same_point(a->p, b->p) || same_point(a->other->p, b->other->p)) {
+      return 0;
+    }
+    if (!same_point(a->p, points[0]) && !same_point(a->other->p, points[0])) {
+      divide_segment(ov, a, points[0]);
+    }
+    if (!same_point(b->p, points[0]) && !same_point(b->other->p, points[0])) {
+      divide_segment(ov, b, points[0]);
+    }
+    return 1;
+  }
+  // The overlapping edges' ends in queue order, leaving out shared ends
+  Event *events[4];
+  unsigned k = 0;
+  bool left_coincide = same_point(a->p, b->p);
+  bool right_coincide = same_point(a->other->p, b->other->p);
+  if (!left_coincide) {
+    bool a_first = event_cmp(a, b) == LESS;
+    events[k++] = a_first ? a : b;
+    events[k++] = a_first ? b : a;
+  }
+  if (!right_coincide) {
+    bool a_first = event_cmp(a->other, b->other) == LESS;
+    events[k++] = a_first ? a->other : b->other;
+    events[k++] = a_first ? b->other : a->other;
+  }
+
+  if (left_coincide) {
+    if (!right_coincide) {
+      divide_segment(ov, events[1]->other, events[0]->p);
+    }
+    if (a->subject == b->subject) {
+      // Under the even-odd rule the shared piece is no boundary of its input,
+      // so both leave the status and their neighbors become adjacent
+      Event *prev = node_event(rb_tree_node_prev(a->node));
+      Event *next = node_event(rb_tree_node_next(b->node));
+      rb_tree_delete_node(&ov->status, a->node);
+      rb_tree_delete_node(&ov->status, b->node);
+      a->node = b->node = NULL;
+      a->in_result = b->in_result = false;
+      if (prev && next) {
+        possible_intersection(ov, prev, next);
+      }
+      return 3;
+    }
+    // The shared piece is represented by a alone
+    b->type = EDGE_NON_CONTRIBUTING;
+    a->type = a->in_out == b->in_out ? EDGE_SAME_TRANSITION
+                                     : EDGE_DIFFERENT_TRANSITION;
+    return 2;
+  }
+  if (right_coincide) {
+    divide_segment(ov, events[0], events[1]->p);
+    return 3;
+  }
+  if (events[0] != events[3]->other) {
+    // Neither edge contains the other
+    divide_segment(ov, events[0], events[1]->p);
+    divide_segment(ov, events[1], events[2]->p);
+    return 3;
+  }
+  // One edge contains the other
+  divide_segment(ov, events[0], events[1]->p);
+  divide_segment(ov, events[3]->other, events[2]->p);
+  return 3;
+}
+
+// Computes the flags of e from prev, the edge just below it, and again for the
+// edges above that start at the same point. Edges at a point are inserted
+// lowest first, except that splitting an edge at the point adds a piece, and
+// removes the piece that ended there, under edges already inserted.
+static void refresh_fields(Overlay *ov, Event *e, Event *prev) {
+  Point p = e->p;
+  for (; e && same_point(e->p, p);
+       prev = e, e = node_event(rb_tree_node_next(e->node))) {
+    compute_fields(e, prev, ov->op);
+  }
+}
+
+static void process_left(Overlay *ov, Event *e) {
+  e->node = rb_tree_insert_node(&ov->status, e);
+  Event *prev = node_event(rb_tree_node_prev(e->node));
+  Event *next = node_event(rb_tree_node_next(e->node));
+  refresh_fields(ov, e, prev);
+  if (next && possible_intersection(ov, e, next) == 2) {
+    compute_fields(e, prev, ov->op);
+    compute_fields(next, e, ov->op);
+  }
+  if (e->node && prev && possible_intersection(ov, prev, e) == 2) {
+    compute_fields(prev, node_event(rb_tree_node_prev(prev->node)), ov->op);
+    compute_fields(e, prev, ov->op);
+  }
+}
+
+static void process_right(Overlay *ov, Event *e) {
+  Event *left = e->other;
+  if (!left->node) {
+    return;
+  }
+  Event *prev = node_event(rb_tree_node_prev(left->node));
+  Event *next = node_event(rb_tree_node_next(left->node));
+  rb_tree_delete_node(&ov->status, left->node);
+  left->node = NULL;
+  if (next && same_point(next->p, e->p)) {
+    refresh_fields(ov, next, prev);
+  }
+  if (prev && next) {
+    possible_intersection(ov, prev, next);
+  }
+}
+
+static void add_edges(Overlay *ov, const Rings *rings, bool subject,
+                      unsigned first_ring) {
+  for (unsigned r = 0; r < rings->num_rings; ++r) {
+    const Point *points = rings->points + rings->ring_starts[r];
+    unsigned size = rings->ring_starts[r + 1] - rings->ring_starts[r];
+    for (unsigned i = 0; i < size; ++i) {
+      Point a = points[i];
+      Point b = points[i + 1 < size ? i + 1 : 0];
+      if (same_point(a, b)) {
+        continue;
+      }
+      bool forward = point_before(a, b);
+      Event *e0 = new_event(ov, a, forward, NULL, subject, first_ring + r);
+      Event *e1 = new_event(ov, b, !forward, e0, subject, first_ring + r);
+      e0->other = e1;
+      Segment *edge = &ov->edges[ov->num_edges++];
+      *edge = forward ? (Segment){a, b} : (Segment){b, a};
+      e0->edge = e1->edge = edge;
+      pq_push(&ov->queue, e0);
+      pq_push(&ov->queue, e1);
+    }
+  }
+}
+
+typedef struct {
+  unsigned start;
+  unsigned size;
+  // Polygon whose hole this is, or UINT_MAX for an outer ring
+  unsigned parent;
+  unsigned first_hole;
+  unsigned next_hole;
+} Contour;
+
+// Which half of a turn around v, clockwise from the direction towards u, the
+// direction towards w is in. Going back towards u comes last.
+static int clockwise_half(Point v, Point u, Point w) {
+  double o = orient2d(v, u, w);
+  if (o != 0) {
+    return o < 0 ? 0 : 1;
+  }
+  bool back = (u.x - v.x) * (w.x - v.x) > 0 || (u.y - v.y) * (w.y - v.y) > 0;
+  return back ? 2 : 0;
+}
+
+// Whether the direction from v towards a comes before the one towards b,
+// turning clockwise from the direction towards u.
+static bool clockwise_before(Point v, Point u, Point a, Point b) {
+  int ha = clockwise_half(v, u, a);
+  int hb = clockwise_half(v, u, b);
+  if (ha != hb) {
+    return ha < hb;
+  }
+  return orient2d(v, a, b) < 0;
+}
+
+// Position of the event that continues the ring after arriving at res[pos].
+// Among the unused events at the same point, and the ring's first event, this
+// is the first edge clockwise from the one arrived on, which keeps the face
+// being traced on the left. Where rings touch at a point, that separates them
+// instead of joining them into one ring through the point. Returns start when
+// the ring closes.
+static unsigned next_position(Event **res, unsigned n, const bool *used,
+                              unsigned pos, unsigned start) {
+  Point v = res[pos]->p;
+  Point u = res[res[pos]->partner]->p;
+  unsigned lo = pos;
+  unsigned hi = pos + 1;
+  while (lo > 0 && same_point(res[lo - 1]->p, v)) {
+    --lo;
+  }
+  while (hi < n && same_point(res[hi]->p, v)) {
+    ++hi;
+  }
+  unsigned best = start;
+  bool found = false;
+  for (unsigned k = lo; k < hi; ++k) {
+    if (used[k] && k != start) {
+      continue;
+    }
+    Point w = res[res[k]->partner]->p;
+    if (!found || clockwise_before(v, u, w, res[res[best]->partner]->p)) {
+      best = k;
+      found = true;
+    }
+  }
+  return best;
+}
+
+// Joins the result edges among the processed events into rings and appends
+// them to out.
+static void connect_edges(Overlay *ov, PolygonSet *out) {
+  unsigned size = ov->processed.size;
+  Event **res = malloc(sizeof(Event *) * (2 * size + 1));
+  unsigned n = 0;
+  // Both ends of each result edge, including right ends past where the sweep
+  // stopped
+  for (unsigned i = 0; i < size; ++i) {
+    Event *e = ov->processed.data[i];
+    if (e->left && e->in_result) {
+      res[n++] = e;
+      res[n++] = e->other;
+    }
+  }
+  // Splitting edges can queue events behind the sweep, so this is nearly
+  // sorted already
+  tim_sortc((void **)res, n, event_cmp);
+  for (unsigned i = 0; i < n; ++i) {
+    res[i]->partner = i;
+  }
+  for (unsigned i = 0; i < n; ++i) {
+    if (!res[i]->left) {
+      unsigned t = res[i]->partner;
+      res[i]->partner = res[i]->other->partner;
+      res[i]->other->partner = t;
+    }
+  }
+  for (unsigned i = 0; i < n; ++i) {
+    assert(res[res[i]->partner]->partner == i &&
+           "result edges must pair up their ends");
+  }
+
+  // A ring has as many points as edges, plus its first point again
+  bool *used = calloc(n ? n : 1, sizeof(bool));
+  Point *points = malloc(sizeof(Point) * (n ? n : 1));
+  Contour *contours = malloc(sizeof(Contour) * (n ? n : 1));
+  unsigned num_points = 0;
+  unsigned num_contours = 0;
+  for (unsigned i = 0; i < n; ++i) {
+    if (used[i]) {
+      continue;
+    }
+    unsigned c = num_contours++;
+    contours[c] = (Contour){
+        .start = num_points,
+        .parent = UINT_MAX,
+        .first_hole = UINT_MAX,
+        .next_hole = UINT_MAX,
+    };
+    // The ring starts at its lowest leftmost point, along its lowest edge
+    // there, so it is a hole if the result is below that edge. The result
+    // edge below then belongs to a ring of the same polygon, which was
+    // started already.
+    const Event *lower = res[i]->below_in_result;
+    if (!res[i]->result_above && lower && lower->output_ring != UINT_MAX) {
+      unsigned parent = contours[lower->output_ring].parent;
+      contours[c].parent = parent != UINT_MAX ? parent : lower->output_ring;
+    }
+
+    points[num_points++] = res[i]->p;
+    unsigned pos = i;
+    do {
+      assert(!used[pos] && !used[res[pos]->partner] &&
+             "each result edge is joined into one ring once");
+      used[pos] = true;
+      res[pos]->output_ring = c;
+      pos = res[pos]->partner;
+      used[pos] = true;
+      res[pos]->output_ring = c;
+      points[num_points++] = res[pos]->p;
+      pos = next_position(res, n, used, pos, i);
+    } while (pos != i);
+    contours[c].size = num_points - contours[c].start;
+    if (contours[c].size > 1 &&
+        same_point(points[num_points - 1], points[contours[c].start])) {
+      --contours[c].size;
+      --num_points;
+    }
+    if (contours[c].parent != UINT_MAX) {
+      contours[c].next_hole = contours[contours[c].parent].first_hole;
+      contours[contours[c].parent].first_hole = c;
+    }
+  }
+
+  for (unsigned c = 0; c < num_contours; ++c) {
+    if (contours[c].parent != UINT_MAX || contours[c].size < 3) {
+      continue;
+    }
+    polygon_set_add_ring(out, points + contours[c].start, contours[c].size,
+                         false);
+    for (unsigned h = contours[c].first_hole; h != UINT_MAX;
+         h = contours[h].next_hole) {
+      if (contours[h].size >= 3) {
+        polygon_set_add_ring(out, points + contours[h].start,
+                             contours[h].size, true);
+      }
+    }
+  }
+  free(contours);
+  free(points);
+  free(used);
+  free(res);
+}
+
+static bool rings_bbox(const Rings *rings, BBox *box) {
+  unsigned n = rings->ring_starts[rings->num_rings];
+  if (n == 0) {
+    return false;
+  }
+  *box = bbox_from_point(rings->points[0]);
+  for (unsigned i = 1; i < n; ++i) {
+    *box = bbox_union(*box, bbox_from_point(rings->points[i]));
+  }
+  return true;
+}
+
+static void copy_rings(const Rings *rings, PolygonSet *out) {
+  for (unsigned i = 0; i < rings->num_polygons; ++i) {
+    for (unsigned r = rings->polygon_starts[i];
+         r < rings->polygon_starts[i + 1]; ++r) {
+      polygon_set_add_ring(out, rings->points + rings->ring_starts[r],
+                           rings->ring_starts[r + 1] - rings->ring_starts[r],
+                           r > rings->polygon_starts[i]);
+    }
+  }
+}
+
+static void overlay(const Rings *subject, const Rings *clip,
+                    PolygonOperation op, PolygonSet *out) {
+  polygon_set_validate(out);
+  BBox subject_box;
+  BBox clip_box;
+  bool has_subject = rings_bbox(subject, &subject_box);
+  bool has_clip = rings_bbox(clip, &clip_box);
+  if (!has_subject || !has_clip || !bbox_overlaps(subject_box, clip_box)) {
+    // Nothing overlaps, so the result is made of whole inputs
+    if (has_subject && op != POLYGON_INTERSECTION) {
+      copy_rings(subject, out);
+    }
+    if (has_clip && (op == POLYGON_UNION || op == POLYGON_XOR)) {
+      copy_rings(clip, out);
+    }
+    return;
+  }
+
+  Overlay ov = {.op = op, .block_used = 0, .num_events = 0};
+  unsigned num_edges = subject->ring_starts[subject->num_rings] +
+                       clip->ring_starts[clip->num_rings];
+  pq_initcn(&ov.queue, event_cmp, 2 * num_edges);
+  rb_tree_initc(&ov.status, status_cmp);
+  vector_init(&ov.blocks);
+  vector_initn(&ov.processed, 2 * num_edges);
+  ov.edges = malloc(sizeof(Segment) * (num_edges ? num_edges : 1));
+  ov.num_edges = 0;
+  add_edges(&ov, subject, true, 0);
+  add_edges(&ov, clip, false, subject->num_rings);
+
+  // Past the right end of the subject, or of either input for an
+  // intersection, no edge can be in the result
+  double right_bound = INFINITY;
+  if (op == POLYGON_INTERSECTION) {
+    right_bound = bbox_min(subject_box.max_x, clip_box.max_x);
+  } else if (op == POLYGON_DIFFERENCE) {
+    right_bound = subject_box.max_x;
+  }
+  while (ov.queue.vec.size > 0) {
+    Event *e = pq_pop(&ov.queue);
+    if (e->p.x > right_bound) {
+      break;
+    }
+    vector_push(&ov.processed, e);
+    if (e->left) {
+      process_left(&ov, e);
+    } else {
+      process_right(&ov, e);
+    }
+  }
+  connect_edges(&ov, out);
+
+  // pq_free still compares the events left after an early exit
+  pq_free(&ov.queue);
+  rb_tree_free(&ov.status);
+  vector_free(&ov.processed);
+  free(ov.edges);
+  for (unsigned i = 0; i < ov.blocks.size; ++i) {
+    free(ov.blocks.data[i]);
+  }
+  vector_free(&ov.blocks);
+}
+
+static Rings polygon_rings(const Polygon *poly, unsigned polygon_starts[2]) {
+  polygon_validate(poly);
+  polygon_starts[0] = 0;
+  polygon_starts[1] = poly->num_rings;
+  return (Rings){
+      .points = poly->points,
+      .ring_starts = poly->ring_starts,
+      .polygon_starts = polygon_starts,
+      .num_rings = poly->num_rings,
+      .num_polygons = 1,
+  };
+}
+
+static Rings set_rings(const PolygonSet *set) {
+  polygon_set_validate(set);
+  return (Rings){
+      .points = set->points,
+      .ring_starts = set->ring_starts,
+      .polygon_starts = set->polygon_starts,
+      .num_rings = set->num_rings,
+      .num_polygons = set->num_polygons,
+  };
+}
+
+void polygon_boolean(const Polygon *subject, const Polygon *clip,
+                     PolygonOperation op, PolygonSet *out) {
+  unsigned subject_starts[2];
+  unsigned clip_starts[2];
+  Rings a = polygon_rings(subject, subject_starts);
+  Rings b = polygon_rings(clip, clip_starts);
+  overlay(&a, &b, op, out);
+}
+
+void polygon_set_boolean(const PolygonSet *subject, const PolygonSet *clip,
+                         PolygonOperation op, PolygonSet *out) {
+  Rings a = set_rings(subject);
+  Rings b = set_rings(clip);
+  overlay(&a, &b, op, out);
+}
+
+// One side of a clip window. Either the left of the line through a and b, or
+// for a box, the points whose coordinate on an axis is at least or at most
+// value.
+typedef struct {
+  Point a;
+  Point b;
+  bool axis_aligned;
+  bool y;
+  bool at_least;
+  double value;
+} HalfPlane;
+
+static double half_plane_distance(const HalfPlane *h, Point p) {
+  if (!h->axis_aligned) {
+    return orient2d(h->a, h->b, p);
+  }
+  double d = (h->y ? p.y : p.x) - h->value;
+  return h->at_least ? d : -d;
+}
+
+// Clips the ring of n points in in to h, writing the result to out, which has
+// room for 2 * n points. Returns its size.
+static unsigned clip_ring(const HalfPlane *h, const Point *in, unsigned n,
+                          Point *out) {
+  unsigned m = 0;
+  Point s = in[n - 1];
+  double ds = half_plane_distance(h, s);
+  for (unsigned i = 0; i < n; ++i) {
+    Point e = in[i];
+    double de = half_plane_distance(h, e);
+    if ((ds >= 0) != (de >= 0)) {
+      // The edge crosses the boundary. For a box, the crossing lies exactly on
+      // it.
+      double t = ds / (ds - de);
+      Point p = {.x = s.x + t * (e.x - s.x), .y = s.y + t * (e.y - s.y)};
+      if (h->axis_aligned) {
+        *(h->y ? &p.y : &p.x) = h->value;
+      }
+      out[m++] = p;
+    }
+    if (de >= 0) {
+      out[m++] = e;
+    }
+    s = e;
+    ds = de;
+  }
+  return m;
+}
+
+static void clip_polygon(const Polygon *subject, const HalfPlane *planes,
+                         unsigned num_planes, PolygonSet *out) {
+  polygon_validate(subject);
+  polygon_set_validate(out);
+  Point *ring = NULL;
+  Point *scratch = NULL;
+  unsigned capacity = 0;
+  for (unsigned r = 0; r < subject->num_rings; ++r) {
+    unsigned n = polygon_ring_size(subject, r);
+    for (unsigned k = 0; k <= num_planes && n > 0; ++k) {
+      // A pass adds at most one point per edge
+      if (2 * n > capacity) {
+        capacity = 2 * n;
+        ring = realloc(ring, sizeof(Point) * capacity);
+        scratch = realloc(scratch, sizeof(Point) * capacity);
+      }
+      if (k == 0) {
+        memcpy(ring, subject->points + subject->ring_starts[r],
+               sizeof(Point) * n);
+        continue;
+      }
+      n = clip_ring(&planes[k - 1], ring, n, scratch);
+      Point *t = ring;
+      ring = scratch;
+      scratch = t;
+    }
+    if (n < 3) {
+      if (r == 0) {
+        // The holes are inside the outer ring, so nothing is left
+        break;
+      }
+      continue;
+    }
+    polygon_set_add_ring(out, ring, n, r > 0);
+  }
+  free(ring);
+  free(scratch);
+}
+
+void polygon_clip_convex(const Polygon *subject, const Point *window,
+                         unsigned m, PolygonSet *out) {
+  assert(window && m >= 3 && "a clip window needs at least three points");
+  // Keep the left of each window edge, or the right if the window winds
+  // clockwise
+  double area = 0;
+  for (unsigned i = 0, j = m - 1; i < m; j = i++) {
+    area += window[j].x * window[i].y - window[i].x * window[j].y;
+  }
+  HalfPlane *planes = malloc(sizeof(HalfPlane) * m);
+  for (unsigned i = 0; i < m; ++i) {
+    Point a = window[i];
+    Point b = window[i + 1 < m ? i + 1 : 0];
+    planes[i] = (HalfPlane){.a = area >= 0 ? a : b, .b = area >= 0 ? b : a};
+  }
+  clip_polygon(subject, planes, m, out);
+  free(planes);
+}
+
+void polygon_clip_bbox(const Polygon *subject, BBox window, PolygonSet *out) {
+  HalfPlane planes[] = {
+      {.axis_aligned = true, .y = false, .at_least = true,
+       .value = window.min_x},
+      {.axis_aligned = true, .y = false, .at_least = false,
+       .value = window.max_x},
+      {.axis_aligned = true, .y = true, .at_least = true,
+       .value = window.min_y},
+      {.axis_aligned = true, .y = true, .at_least = false,
+       .value = window.max_y},
+  };
+  clip_polygon(subject, planes, 4, out);
+}
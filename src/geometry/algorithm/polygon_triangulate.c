@@ -0,0 +1,1193 @@
+// Polygon triangulation, see polygon_triangulate.h.
+//
+// Both triangulators walk each ring in the direction that keeps the interior
+// on its left, the outer ring counterclockwise and the holes clockwise,
+// without modifying the input.
+//
+// Monotone decomposition sweeps the vertices from top to bottom, ties broken
+// left to right, which makes every y-monotone piece monotone under a slight
+// rotation as well. The sweep keeps the boundary edges that have the interior
+// on their right in a RedBlackTree, ordered west to east, each with a helper,
+// the last vertex seen between it and the next edge east. Split vertices,
+// where the boundary turns back up, connect to the helper of the edge west of
+// them, and merge vertices, where it turns back down, are the helper that a
+// later vertex connects to. The ring edges and the diagonals then form a
+// planar graph whose faces are the monotone pieces, found by turning clockwise
+// at each vertex. Each piece's two chains are merged top to bottom and
+// triangulated by keeping the reflex chain not yet triangulated on a stack.
+//
+// Ear clipping follows earcut. Holes are bridged to the outer ring, or to the
+// holes bridged before them, from left to right, through the closest vertex
+// visible to the west of each hole's leftmost point. Ears are then clipped off
+// the one ring until none is left. If no ear can be found, repeated and
+// collinear points are dropped, then small self-intersections are cut off,
+// then the ring is split along a diagonal and both halves are triangulated.
+#include "geometry/algorithm/polygon_triangulate.h"
+#include "data_structure/parallel.h"
+#include "data_structure/red_black_tree.h"
+#include "data_structure/sort.h"
+#include "geometry/predicates.h"
+#include "geometry/space_filling_curve.h"
+#include <assert.h>
+#include <limits.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Ear clipping checks candidate ears against the points near them on a
+// z-order curve above this many points, and against every point below.
+static const unsigned Z_ORDER_MIN_POINTS = 80;
+// Bits per coordinate of the z-order curve, so positions fit in 32 bits.
+static const unsigned Z_ORDER_BITS = 15;
+// Polygons up to this size are put in sweep order by insertion sort, which
+// beats the radix sort's passes over its buckets.
+static const unsigned INSERTION_SORT_SIZE = 48;
+
+// A polygon's rings as ranges of a points array, so the polygons of a
+// PolygonSet are triangulated with indices into the set's points. Ring r is
+// points[ring_starts[r]..ring_starts[r + 1]).
+typedef struct {
+  const Point *points;
+  const unsigned *ring_starts;
+  unsigned num_rings;
+} Rings;
+
+static unsigned rings_size(Rings rings) {
+  return rings.ring_starts[rings.num_rings] - rings.ring_starts[0];
+}
+
+static unsigned rings_triangle_count(Rings rings) {
+  return rings_size(rings) + 2 * (rings.num_rings - 1) - 2;
+}
+
+static double ring_signed_area(Rings rings, unsigned r) {
+  unsigned start = rings.ring_starts[r];
+  unsigned end = rings.ring_starts[r + 1];
+  double area = 0;
+  for (unsigned i = start, j = end - 1; i < end; j = i++) {
+    Point a = rings.points[j];
+    Point b = rings.points[i];
+    area += (a.x - b.x) * (a.y + b.y);
+  }
+  return area / 2;
+}
+
+typedef enum {
+  VERTEX_START,
+  VERTEX_END,
+  VERTEX_SPLIT,
+  VERTEX_MERGE,
+  // Regular vertices on a left chain, with the interior to their east
+  VERTEX_LEFT,
+  VERTEX_RIGHT,
+} VertexType;
+
+typedef enum { CHAIN_LEFT, CHAIN_RIGHT } Chain;
+
+// An edge in the sweep status, from vertex k to next[k] for the entry at k.
+typedef struct {
+  RedBlackNode *node;
+  unsigned helper;
+} StatusEdge;
+
+typedef struct {
+  unsigned i;
+  unsigned prev;
+  unsigned next;
+  // Neighbors on the z-order curve, UINT_MAX at its ends or before it is built
+  unsigned prev_z;
+  unsigned next_z;
+  uint32_t z;
+  Point p;
+} EarNode;
+
+// Scratch for triangulating polygons of up to capacity points, reused across
+// the polygons of a set. Vertices are numbered from 0 within the polygon.
+typedef struct {
+  unsigned capacity;
+  // Monotone decomposition
+  unsigned *next;
+  unsigned *prev;
+  unsigned *rank;
+  unsigned char *types;
+  StatusEdge *status;
+  // Diagonal d connects diagonals[2 * d] and diagonals[2 * d + 1]
+  unsigned *diagonals;
+  unsigned num_diagonals;
+  // Half-edges: k from k to next[k], and n + 2d and n + 2d + 1 along diagonal
+  // d both ways. The half-edges leaving vertex k are
+  // out_edges[out_starts[k]..out_starts[k + 1]).
+  unsigned *out_starts;
+  unsigned *out_edges;
+  unsigned char *visited;
+  unsigned *piece;
+  unsigned *merged;
+  unsigned char *chains;
+  unsigned *stack;
+  // Ear clipping
+  EarNode *nodes;
+  unsigned num_nodes;
+  unsigned nodes_capacity;
+  unsigned *holes;
+  // Sort keys and the vertices or nodes they sort
+  uint64_t *keys;
+  unsigned *order;
+  unsigned keys_capacity;
+} Scratch;
+
+static void scratch_init(Scratch *scratch) { *scratch = (Scratch){0}; }
+
+static void scratch_free(Scratch *scratch) {
+  free(scratch->next);
+  free(scratch->prev);
+  free(scratch->order);
+  free(scratch->rank);
+  free(scratch->keys);
+  free(scratch->types);
+  free(scratch->status);
+  free(scratch->diagonals);
+  free(scratch->out_starts);
+  free(scratch->out_edges);
+  free(scratch->visited);
+  free(scratch->piece);
+  free(scratch->merged);
+  free(scratch->chains);
+  free(scratch->stack);
+  free(scratch->nodes);
+  free(scratch->holes);
+}
+
+static void reserve_keys(Scratch *scratch, unsigned n) {
+  if (n > scratch->keys_capacity) {
+    scratch->keys_capacity = n;
+    scratch->keys = realloc(scratch->keys, sizeof(uint64_t) * n);
+    scratch->order = realloc(scratch->order, sizeof(unsigned) * n);
+  }
+}
+
+// Each vertex adds at most two diagonals, and the half-edges are the ring
+// edges and both halves of each diagonal.
+static void scratch_reserve(Scratch *scratch, unsigned n, unsigned num_rings) {
+  if (n > scratch->capacity) {
+    scratch->capacity = n;
+    scratch->next = realloc(scratch->next, sizeof(unsigned) * n);
+    scratch->prev = realloc(scratch->prev, sizeof(unsigned) * n);
+    scratch->rank = realloc(scratch->rank, sizeof(unsigned) * n);
+    scratch->types = realloc(scratch->types, n);
+    scratch->status = realloc(scratch->status, sizeof(StatusEdge) * n);
+    scratch->diagonals = realloc(scratch->diagonals, sizeof(unsigned) * 4 * n);
+    scratch->out_starts =
+        realloc(scratch->out_starts, sizeof(unsigned) * (n + 1));
+    scratch->out_edges = realloc(scratch->out_edges, sizeof(unsigned) * 5 * n);
+    scratch->visited = realloc(scratch->visited, 5 * n);
+    scratch->piece = realloc(scratch->piece, sizeof(unsigned) * n);
+    scratch->merged = realloc(scratch->merged, sizeof(unsigned) * n);
+    scratch->chains = realloc(scratch->chains, n);
+    scratch->stack = realloc(scratch->stack, sizeof(unsigned) * n);
+    scratch->holes = realloc(scratch->holes, sizeof(unsigned) * n);
+  }
+  // Bridging a hole adds two nodes
+  unsigned nodes = n + 2 * num_rings;
+  if (nodes > scratch->nodes_capacity) {
+    scratch->nodes_capacity = nodes;
+    scratch->nodes = realloc(scratch->nodes, sizeof(EarNode) * nodes);
+  }
+  reserve_keys(scratch, nodes);
+}
+
+// Appends the triangle of vertices a, b and c, reordered to be
+// counterclockwise, as indices from base.
+static unsigned emit(const Point *points, unsigned base, unsigned a,
+                     unsigned b, unsigned c, unsigned *triangles,
+                     unsigned count) {
+  if (orient2d(points[a], points[b], points[c]) < 0) {
+    unsigned t = b;
+    b = c;
+    c = t;
+  }
+  triangles[3 * count] = base + a;
+  triangles[3 * count + 1] = base + b;
+  triangles[3 * count + 2] = base + c;
+  return count + 1;
+}
+
+typedef struct {
+  const Point *points;
+  const Scratch *scratch;
+} Sweep;
+
+typedef struct {
+  const Sweep *sweep;
+  Point p;
+} Probe;
+
+// Orders a probe before the first edge east of it. Only used by
+// rb_tree_upper_bound, which always passes the probe first. The edges in the
+// status point down, so the probe is west of one when it is on its right.
+static Ordering status_cmp(void *probe, void *edge) {
+  const Probe *p = probe;
+  const Scratch *scratch = p->sweep->scratch;
+  unsigned k = (const StatusEdge *)edge - scratch->status;
+  Point upper = p->sweep->points[k];
+  Point lower = p->sweep->points[scratch->next[k]];
+  return orient2d(upper, lower, p->p) < 0 ? LESS : GREATER;
+}
+
+// The status edge directly west of vertex v.
+static StatusEdge *west_of(RedBlackTree *status, const Sweep *sweep,
+                           unsigned v) {
+  Probe probe = {sweep, sweep->points[v]};
+  RedBlackNode *east = rb_tree_upper_bound(status, &probe);
+  RedBlackNode *west =
+      east ? rb_tree_node_prev(east) : rb_tree_last_node(status);
+  assert(west && "polygon rings must be simple and must not cross");
+  return rb_tree_node_val(west);
+}
+
+static void insert_edge(RedBlackTree *status, const Sweep *sweep,
+                        Scratch *scratch, unsigned v) {
+  Probe probe = {sweep, sweep->points[v]};
+  RedBlackNode *east = rb_tree_upper_bound(status, &probe);
+  RedBlackNode *west =
+      east ? rb_tree_node_prev(east) : rb_tree_last_node(status);
+  scratch->status[v] = (StatusEdge){
+      .node = rb_tree_insert_after(status, west, &scratch->status[v]),
+      .helper = v,
+  };
+}
+
+static void add_diagonal(Scratch *scratch, unsigned a, unsigned b) {
+  scratch->diagonals[2 * scratch->num_diagonals] = a;
+  scratch->diagonals[2 * scratch->num_diagonals + 1] = b;
+  ++scratch->num_diagonals;
+}
+
+// Ends the edge into v, connecting v to its helper if that is a merge vertex.
+static void end_edge(RedBlackTree *status, Scratch *scratch, unsigned v) {
+  StatusEdge *e = &scratch->status[scratch->prev[v]];
+  if (scratch->types[e->helper] == VERTEX_MERGE) {
+    add_diagonal(scratch, v, e->helper);
+  }
+  rb_tree_delete_node(status, e->node);
+}
+
+// Makes v the helper of the edge west of it, connecting v to the old helper if
+// that is a merge vertex.
+static void help_west(RedBlackTree *status, const Sweep *sweep,
+                      Scratch *scratch, unsigned v) {
+  StatusEdge *e = west_of(status, sweep, v);
+  if (scratch->types[e->helper] == VERTEX_MERGE) {
+    add_diagonal(scratch, v, e->helper);
+  }
+  e->helper = v;
+}
+
+static bool sweeps_before(Point a, Point b) {
+  return a.y > b.y || (a.y == b.y && a.x < b.x);
+}
+
+// Links each ring so that the interior is on the left of next, and sorts the
+// vertices into sweep order.
+static void sweep_order(Rings rings, Scratch *scratch) {
+  unsigned base = rings.ring_starts[0];
+  for (unsigned r = 0; r < rings.num_rings; ++r) {
+    unsigned start = rings.ring_starts[r] - base;
+    unsigned end = rings.ring_starts[r + 1] - base;
+    bool forward = (ring_signed_area(rings, r) > 0) == (r == 0);
+    for (unsigned k = start; k < end; ++k) {
+      unsigned after = k + 1 < end ? k + 1 : start;
+      unsigned before = k > start ? k - 1 : end - 1;
+      scratch->next[k] = forward ? after : before;
+      scratch->prev[k] = forward ? before : after;
+    }
+  }
+  // Top to bottom, then left to right. Adding 0 turns -0.0 into 0.0, which
+  // the predicates treat the same.
+  unsigned n = rings_size(rings);
+  const Point *points = rings.points + base;
+  if (n <= INSERTION_SORT_SIZE) {
+    for (unsigned k = 0; k < n; ++k) {
+      unsigned i = k;
+      for (; i > 0 && sweeps_before(points[k], points[scratch->order[i - 1]]);
+           --i) {
+        scratch->order[i] = scratch->order[i - 1];
+      }
+      scratch->order[i] = k;
+    }
+    for (unsigned i = 0; i < n; ++i) {
+      scratch->rank[scratch->order[i]] = i;
+    }
+    return;
+  }
+  for (unsigned k = 0; k < n; ++k) {
+    scratch->order[k] = k;
+    scratch->keys[k] = double_sort_key(points[k].x + 0.0);
+  }
+  radix_sort_keys(scratch->keys, scratch->order, n, 1);
+  for (unsigned i = 0; i < n; ++i) {
+    scratch->keys[i] = ~double_sort_key(points[scratch->order[i]].y + 0.0);
+  }
+  radix_sort_keys(scratch->keys, scratch->order, n, 1);
+  for (unsigned i = 0; i < n; ++i) {
+    scratch->rank[scratch->order[i]] = i;
+  }
+}
+
+static void classify(const Point *points, unsigned n, Scratch *scratch) {
+  const unsigned *rank = scratch->rank;
+  for (unsigned v = 0; v < n; ++v) {
+    unsigned p = scratch->prev[v];
+    unsigned q = scratch->next[v];
+    bool convex = orient2d(points[p], points[v], points[q]) > 0;
+    if (rank[p] > rank[v] && rank[q] > rank[v]) {
+      scratch->types[v] = convex ? VERTEX_START : VERTEX_SPLIT;
+    } else if (rank[p] < rank[v] && rank[q] < rank[v]) {
+      scratch->types[v] = convex ? VERTEX_END : VERTEX_MERGE;
+    } else {
+      scratch->types[v] = rank[p] < rank[v] ? VERTEX_LEFT : VERTEX_RIGHT;
+    }
+  }
+}
+
+static void add_monotone_diagonals(const Point *points, unsigned n,
+                                   Scratch *scratch) {
+  Sweep sweep = {points, scratch};
+  RedBlackTree status;
+  rb_tree_initc(&status, status_cmp);
+  scratch->num_diagonals = 0;
+  for (unsigned i = 0; i < n; ++i) {
+    unsigned v = scratch->order[i];
+    switch (scratch->types[v]) {
+    case VERTEX_START:
+      insert_edge(&status, &sweep, scratch, v);
+      break;
+    case VERTEX_END:
+      end_edge(&status, scratch, v);
+      break;
+    case VERTEX_SPLIT: {
+      StatusEdge *e = west_of(&status, &sweep, v);
+      add_diagonal(scratch, v, e->helper);
+      e->helper = v;
+      insert_edge(&status, &sweep, scratch, v);
+      break;
+    }
+    case VERTEX_MERGE:
+      end_edge(&status, scratch, v);
+      help_west(&status, &sweep, scratch, v);
+      break;
+    case VERTEX_LEFT:
+      end_edge(&status, scratch, v);
+      insert_edge(&status, &sweep, scratch, v);
+      break;
+    case VERTEX_RIGHT:
+      help_west(&status, &sweep, scratch, v);
+      break;
+    }
+  }
+  assert(status.size == 0 && "polygon rings must be simple");
+  rb_tree_free(&status);
+}
+
+static unsigned half_edge_origin(const Scratch *scratch, unsigned n,
+                                 unsigned h) {
+  return h < n ? h : scratch->diagonals[h - n];
+}
+
+static unsigned half_edge_destination(const Scratch *scratch, unsigned n,
+                                      unsigned h) {
+  return h < n ? scratch->next[h] : scratch->diagonals[(h - n) ^ 1];
+}
+
+// The half-edge after h around the face on its left, the first one leaving
+// h's destination clockwise from h's twin.
+static unsigned next_half_edge(const Point *points, unsigned n,
+                               const Scratch *scratch, unsigned h) {
+  unsigned b = half_edge_destination(scratch, n, h);
+  unsigned lo = scratch->out_starts[b];
+  unsigned hi = scratch->out_starts[b + 1];
+  if (hi - lo == 1) {
+    return scratch->out_edges[lo];
+  }
+  Point pb = points[b];
+  Point pa = points[half_edge_origin(scratch, n, h)];
+  double ux = pa.x - pb.x, uy = pa.y - pb.y;
+  unsigned best = UINT_MAX;
+  double best_angle = INFINITY;
+  for (unsigned i = lo; i < hi; ++i) {
+    unsigned g = scratch->out_edges[i];
+    Point pc = points[half_edge_destination(scratch, n, g)];
+    double wx = pc.x - pb.x, wy = pc.y - pb.y;
+    double angle = -atan2(ux * wy - uy * wx, ux * wx + uy * wy);
+    if (angle <= 0) {
+      angle += 2 * M_PI;
+    }
+    if (angle < best_angle) {
+      best_angle = angle;
+      best = g;
+    }
+  }
+  return best;
+}
+
+// Triangulates a y-monotone piece whose k vertices are counterclockwise in
+// scratch->piece.
+static unsigned triangulate_piece(const Point *points, unsigned base,
+                                  unsigned k, Scratch *scratch,
+                                  unsigned *triangles, unsigned count) {
+  const unsigned *piece = scratch->piece;
+  const unsigned *rank = scratch->rank;
+  unsigned top = 0;
+  for (unsigned i = 1; i < k; ++i) {
+    if (rank[piece[i]] < rank[piece[top]]) {
+      top = i;
+    }
+  }
+  // Counterclockwise from the top goes down the left chain
+  unsigned *merged = scratch->merged;
+  unsigned char *chains = scratch->chains;
+  merged[0] = piece[top];
+  chains[0] = CHAIN_LEFT;
+  unsigned left = top + 1 < k ? top + 1 : 0;
+  unsigned right = top > 0 ? top - 1 : k - 1;
+  for (unsigned m = 1; m < k; ++m) {
+    if (left != right && rank[piece[right]] < rank[piece[left]]) {
+      merged[m] = piece[right];
+      chains[m] = CHAIN_RIGHT;
+      right = right > 0 ? right - 1 : k - 1;
+    } else {
+      merged[m] = piece[left];
+      chains[m] = CHAIN_LEFT;
+      left = left + 1 < k ? left + 1 : 0;
+    }
+  }
+
+  unsigned *stack = scratch->stack;
+  unsigned size = 2;
+  stack[0] = 0;
+  stack[1] = 1;
+  for (unsigned j = 2; j + 1 < k; ++j) {
+    unsigned u = merged[j];
+    if (chains[j] != chains[stack[size - 1]]) {
+      for (unsigned s = 0; s + 1 < size; ++s) {
+        count = emit(points, base, u, merged[stack[s]], merged[stack[s + 1]],
+                     triangles, count);
+      }
+      stack[0] = j - 1;
+      stack[1] = j;
+      size = 2;
+      continue;
+    }
+    unsigned last = stack[--size];
+    while (size > 0) {
+      Point t = points[merged[stack[size - 1]]];
+      Point p = points[merged[last]];
+      double turn = chains[j] == CHAIN_LEFT ? orient2d(t, p, points[u])
+                                            : orient2d(points[u], p, t);
+      if (turn <= 0) {
+        break;
+      }
+      count = emit(points, base, u, merged[last], merged[stack[size - 1]],
+                   triangles, count);
+      last = stack[--size];
+    }
+    stack[size++] = last;
+    stack[size++] = j;
+  }
+  unsigned bottom = merged[k - 1];
+  for (unsigned s = 0; s + 1 < size; ++s) {
+    count = emit(points, base, bottom, merged[stack[s]],
+                 merged[stack[s + 1]], triangles, count);
+  }
+  return count;
+}
+
+static unsigned triangulate_monotone(Rings rings, Scratch *scratch,
+                                     unsigned *triangles) {
+  unsigned n = rings_size(rings);
+  scratch_reserve(scratch, n, rings.num_rings);
+  unsigned base = rings.ring_starts[0];
+  const Point *points = rings.points + base;
+  sweep_order(rings, scratch);
+  classify(points, n, scratch);
+  add_monotone_diagonals(points, n, scratch);
+
+  // Half-edges leaving each vertex, the ring edge first
+  unsigned *out_starts = scratch->out_starts;
+  for (unsigned v = 0; v <= n; ++v) {
+    out_starts[v] = v > 0;
+  }
+  unsigned num_half_edges = n + 2 * scratch->num_diagonals;
+  for (unsigned h = n; h < num_half_edges; ++h) {
+    ++out_starts[scratch->diagonals[h - n] + 1];
+  }
+  for (unsigned v = 0; v < n; ++v) {
+    out_starts[v + 1] += out_starts[v];
+  }
+  for (unsigned v = 0; v < n; ++v) {
+    scratch->out_edges[out_starts[v]++] = v;
+  }
+  for (unsigned h = n; h < num_half_edges; ++h) {
+    scratch->out_edges[out_starts[scratch->diagonals[h - n]]++] = h;
+  }
+  // The fill moved every start to the next vertex's start
+  memmove(out_starts + 1, out_starts, sizeof(unsigned) * n);
+  out_starts[0] = 0;
+
+  memset(scratch->visited, 0, num_half_edges);
+  unsigned count = 0;
+  for (unsigned h = 0; h < num_half_edges; ++h) {
+    if (scratch->visited[h]) {
+      continue;
+    }
+    unsigned k = 0;
+    unsigned g = h;
+    do {
+      scratch->visited[g] = 1;
+      scratch->piece[k++] = half_edge_origin(scratch, n, g);
+      g = next_half_edge(points, n, scratch, g);
+    } while (g != h);
+    count = triangulate_piece(points, base, k, scratch, triangles, count);
+  }
+  return count;
+}
+
+// Ear clipping. Nodes are indices into scratch->nodes, which may move when a
+// node is added, so nodes are only held by index across split_ring.
+
+static unsigned new_node(Scratch *scratch, unsigned i, Point p) {
+  if (scratch->num_nodes == scratch->nodes_capacity) {
+    scratch->nodes_capacity *= 2;
+    scratch->nodes =
+        realloc(scratch->nodes, sizeof(EarNode) * scratch->nodes_capacity);
+  }
+  scratch->nodes[scratch->num_nodes] = (EarNode){
+      .i = i,
+      .prev = scratch->num_nodes,
+      .next = scratch->num_nodes,
+      .prev_z = UINT_MAX,
+      .next_z = UINT_MAX,
+      .z = 0,
+      .p = p,
+  };
+  return scratch->num_nodes++;
+}
+
+static void remove_node(EarNode *nodes, unsigned a) {
+  EarNode *node = &nodes[a];
+  nodes[node->next].prev = node->prev;
+  nodes[node->prev].next = node->next;
+  if (node->prev_z != UINT_MAX) {
+    nodes[node->prev_z].next_z = node->next_z;
+  }
+  if (node->next_z != UINT_MAX) {
+    nodes[node->next_z].prev_z = node->prev_z;
+  }
+}
+
+static double turn(const EarNode *nodes, unsigned a, unsigned b, unsigned c) {
+  return orient2d(nodes[a].p, nodes[b].p, nodes[c].p);
+}
+
+static bool same_point(Point a, Point b) { return a.x == b.x && a.y == b.y; }
+
+// Whether p is in the counterclockwise triangle abc or on its boundary.
+static bool in_triangle(Point a, Point b, Point c, Point p) {
+  return orient2d(c, a, p) >= 0 && orient2d(a, b, p) >= 0 &&
+         orient2d(b, c, p) >= 0;
+}
+
+// Links ring r of the rings as a cycle that winds counterclockwise for the
+// outer ring and clockwise for holes, returning one of its nodes.
+static unsigned link_ring(Rings rings, unsigned r, Scratch *scratch) {
+  unsigned start = rings.ring_starts[r];
+  unsigned end = rings.ring_starts[r + 1];
+  bool forward = (ring_signed_area(rings, r) > 0) == (r == 0);
+  unsigned last = UINT_MAX;
+  for (unsigned k = 0; k < end - start; ++k) {
+    unsigned i = forward ? start + k : end - 1 - k;
+    unsigned a = new_node(scratch, i, rings.points[i]);
+    if (last != UINT_MAX) {
+      EarNode *nodes = scratch->nodes;
+      nodes[a].prev = last;
+      nodes[a].next = nodes[last].next;
+      nodes[nodes[last].next].prev = a;
+      nodes[last].next = a;
+    }
+    last = a;
+  }
+  EarNode *nodes = scratch->nodes;
+  if (same_point(nodes[last].p, nodes[nodes[last].next].p)) {
+    unsigned next = nodes[last].next;
+    remove_node(nodes, last);
+    last = next;
+  }
+  return last;
+}
+
+// Drops repeated and collinear points from start until end, returning a node
+// that is still in the ring.
+static unsigned filter_points(EarNode *nodes, unsigned start, unsigned end) {
+  if (end == UINT_MAX) {
+    end = start;
+  }
+  unsigned p = start;
+  bool again;
+  do {
+    again = false;
+    unsigned next = nodes[p].next;
+    if (same_point(nodes[p].p, nodes[next].p) ||
+        turn(nodes, nodes[p].prev, p, next) == 0) {
+      remove_node(nodes, p);
+      p = end = nodes[p].prev;
+      if (p == nodes[p].next) {
+        break;
+      }
+      again = true;
+    } else {
+      p = next;
+    }
+  } while (again || p != end);
+  return end;
+}
+
+static uint32_t z_order(const CurveGrid *order, Point p) {
+  return (uint32_t)curve_grid_key(order, CURVE_MORTON, p);
+}
+
+// Links the ring's nodes along the z-order curve, sorted with radix_sort_keys.
+static void index_curve(Scratch *scratch, unsigned start,
+                        const CurveGrid *order) {
+  reserve_keys(scratch, scratch->num_nodes);
+  EarNode *nodes = scratch->nodes;
+  unsigned n = 0;
+  unsigned p = start;
+  do {
+    nodes[p].z = z_order(order, nodes[p].p);
+    scratch->keys[n] = nodes[p].z;
+    scratch->order[n++] = p;
+    p = nodes[p].next;
+  } while (p != start);
+  radix_sort_keys(scratch->keys, scratch->order, n, 1);
+  for (unsigned k = 0; k < n; ++k) {
+    EarNode *node = &nodes[scratch->order[k]];
+    node->prev_z = k > 0 ? scratch->order[k - 1] : UINT_MAX;
+    node->next_z = k + 1 < n ? scratch->order[k + 1] : UINT_MAX;
+  }
+}
+
+// Whether node q, a corner of the ring, blocks ear abc.
+static bool blocks_ear(const EarNode *nodes, unsigned a, unsigned b,
+                       unsigned c, unsigned q) {
+  return q != a && q != c &&
+         in_triangle(nodes[a].p, nodes[b].p, nodes[c].p, nodes[q].p) &&
+         turn(nodes, nodes[q].prev, q, nodes[q].next) <= 0;
+}
+
+static bool is_ear(const EarNode *nodes, unsigned b) {
+  unsigned a = nodes[b].prev;
+  unsigned c = nodes[b].next;
+  if (turn(nodes, a, b, c) <= 0) {
+    return false;
+  }
+  BBox box = bbox_union(bbox_from_segment((Segment){nodes[a].p, nodes[b].p}),
+                        bbox_from_point(nodes[c].p));
+  for (unsigned q = nodes[c].next; q != a; q = nodes[q].next) {
+    if (bbox_contains_point(box, nodes[q].p) && blocks_ear(nodes, a, b, c, q)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// is_ear, checking only the nodes in the z-order range of the ear's box,
+// outwards from the ear in both directions.
+static bool is_ear_hashed(const EarNode *nodes, unsigned b,
+                          const CurveGrid *order) {
+  unsigned a = nodes[b].prev;
+  unsigned c = nodes[b].next;
+  if (turn(nodes, a, b, c) <= 0) {
+    return false;
+  }
+  BBox box = bbox_union(bbox_from_segment((Segment){nodes[a].p, nodes[b].p}),
+                        bbox_from_point(nodes[c].p));
+  uint32_t min_z = z_order(order, (Point){box.min_x, box.min_y});
+  uint32_t max_z = z_order(order, (Point){box.max_x, box.max_y});
+  unsigned p = nodes[b].prev_z;
+  unsigned q = nodes[b].next_z;
+  while (p != UINT_MAX && nodes[p].z >= min_z) {
+    if (bbox_contains_point(box, nodes[p].p) && blocks_ear(nodes, a, b, c, p)) {
+      return false;
+    }
+    p = nodes[p].prev_z;
+  }
+  while (q != UINT_MAX && nodes[q].z <= max_z) {
+    if (bbox_contains_point(box, nodes[q].p) && blocks_ear(nodes, a, b, c, q)) {
+      return false;
+    }
+    q = nodes[q].next_z;
+  }
+  return true;
+}
+
+static int sign(double x) { return (x > 0) - (x < 0); }
+
+// Whether q is in the box of segment pr, for a q collinear with it.
+static bool on_segment(Point p, Point q, Point r) {
+  return q.x <= fmax(p.x, r.x) && q.x >= fmin(p.x, r.x) &&
+         q.y <= fmax(p.y, r.y) && q.y >= fmin(p.y, r.y);
+}
+
+// Whether segments p1q1 and p2q2 meet.
+static bool intersects(Point p1, Point q1, Point p2, Point q2) {
+  int o1 = sign(orient2d(p1, q1, p2));
+  int o2 = sign(orient2d(p1, q1, q2));
+  int o3 = sign(orient2d(p2, q2, p1));
+  int o4 = sign(orient2d(p2, q2, q1));
+  return (o1 != o2 && o3 != o4) || (o1 == 0 && on_segment(p1, p2, q1)) ||
+         (o2 == 0 && on_segment(p1, q2, q1)) ||
+         (o3 == 0 && on_segment(p2, p1, q2)) ||
+         (o4 == 0 && on_segment(p2, q1, q2));
+}
+
+// Whether diagonal ab meets an edge of the ring that does not touch a or b.
+static bool intersects_ring(const EarNode *nodes, unsigned a, unsigned b) {
+  unsigned p = a;
+  do {
+    unsigned next = nodes[p].next;
+    if (nodes[p].i != nodes[a].i && nodes[next].i != nodes[a].i &&
+        nodes[p].i != nodes[b].i && nodes[next].i != nodes[b].i &&
+        intersects(nodes[p].p, nodes[next].p, nodes[a].p, nodes[b].p)) {
+      return true;
+    }
+    p = next;
+  } while (p != a);
+  return false;
+}
+
+// Whether diagonal ab starts into the interior at a.
+static bool locally_inside(const EarNode *nodes, unsigned a, unsigned b) {
+  unsigned prev = nodes[a].prev;
+  unsigned next = nodes[a].next;
+  return turn(nodes, prev, a, next) > 0
+             ? turn(nodes, a, b, next) <= 0 && turn(nodes, a, prev, b) <= 0
+             : turn(nodes, a, b, prev) > 0 || turn(nodes, a, next, b) > 0;
+}
+
+// Whether the midpoint of diagonal ab is inside the ring.
+static bool middle_inside(const EarNode *nodes, unsigned a, unsigned b) {
+  Point m = {(nodes[a].p.x + nodes[b].p.x) / 2,
+             (nodes[a].p.y + nodes[b].p.y) / 2};
+  bool inside = false;
+  unsigned p = a;
+  do {
+    Point s = nodes[p].p;
+    Point t = nodes[nodes[p].next].p;
+    if ((s.y > m.y) != (t.y > m.y) && t.y != s.y &&
+        m.x < (t.x - s.x) * (m.y - s.y) / (t.y - s.y) + s.x) {
+      inside = !inside;
+    }
+    p = nodes[p].next;
+  } while (p != a);
+  return inside;
+}
+
+static bool is_valid_diagonal(const EarNode *nodes, unsigned a, unsigned b) {
+  unsigned bi = nodes[b].i;
+  if (nodes[nodes[a].next].i == bi || nodes[nodes[a].prev].i == bi ||
+      intersects_ring(nodes, a, b)) {
+    return false;
+  }
+  if (locally_inside(nodes, a, b) && locally_inside(nodes, b, a) &&
+      middle_inside(nodes, a, b) &&
+      (turn(nodes, nodes[a].prev, a, nodes[b].prev) != 0 ||
+       turn(nodes, a, nodes[b].prev, b) != 0)) {
+    return true;
+  }
+  // Touching points with reflex corners on both sides
+  return same_point(nodes[a].p, nodes[b].p) &&
+         turn(nodes, nodes[a].prev, a, nodes[a].next) < 0 &&
+         turn(nodes, nodes[b].prev, b, nodes[b].next) < 0;
+}
+
+// Splits the ring into two along diagonal ab, duplicating a and b. a and b
+// stay in one ring and the returned node, b's copy, is in the other.
+static unsigned split_ring(Scratch *scratch, unsigned a, unsigned b) {
+  unsigned a2 = new_node(scratch, scratch->nodes[a].i, scratch->nodes[a].p);
+  unsigned b2 = new_node(scratch, scratch->nodes[b].i, scratch->nodes[b].p);
+  EarNode *nodes = scratch->nodes;
+  unsigned an = nodes[a].next;
+  unsigned bp = nodes[b].prev;
+  nodes[a].next = b;
+  nodes[b].prev = a;
+  nodes[a2].next = an;
+  nodes[an].prev = a2;
+  nodes[b2].next = a2;
+  nodes[a2].prev = b2;
+  nodes[bp].next = b2;
+  nodes[b2].prev = bp;
+  return b2;
+}
+
+// The node of the outer ring to bridge hole node h to: the closest one
+// visible to its west, or UINT_MAX if there is none.
+static unsigned find_bridge(const EarNode *nodes, unsigned h, unsigned outer) {
+  Point hp = nodes[h].p;
+  double qx = -INFINITY;
+  unsigned m = UINT_MAX;
+  unsigned p = outer;
+  // The edge crossed first by a ray west of the hole, and its eastern end
+  do {
+    Point s = nodes[p].p;
+    Point t = nodes[nodes[p].next].p;
+    if (hp.y <= s.y && hp.y >= t.y && t.y != s.y) {
+      double x = s.x + (hp.y - s.y) * (t.x - s.x) / (t.y - s.y);
+      if (x <= hp.x && x > qx) {
+        qx = x;
+        m = s.x < t.x ? p : nodes[p].next;
+        if (x == hp.x) {
+          return m;
+        }
+      }
+    }
+    p = nodes[p].next;
+  } while (p != outer);
+  if (m == UINT_MAX) {
+    return m;
+  }
+
+  // A reflex vertex in the triangle between the hole point, the hit and m
+  // blocks m, and the one at the smallest angle from the ray replaces it
+  unsigned stop = m;
+  Point mp = nodes[m].p;
+  double tan_min = INFINITY;
+  p = m;
+  do {
+    Point pp = nodes[p].p;
+    if (hp.x >= pp.x && pp.x >= mp.x && hp.x != pp.x &&
+        in_triangle((Point){hp.y < mp.y ? hp.x : qx, hp.y}, mp,
+                    (Point){hp.y < mp.y ? qx : hp.x, hp.y}, pp)) {
+      double tan = fabs(hp.y - pp.y) / (hp.x - pp.x);
+      Point best = nodes[m].p;
+      if (locally_inside(nodes, p, h) &&
+          (tan < tan_min ||
+           (tan == tan_min &&
+            (pp.x > best.x ||
+             (pp.x == best.x &&
+              turn(nodes, nodes[m].prev, m, nodes[p].prev) > 0 &&
+              turn(nodes, nodes[p].next, m, nodes[m].next) > 0))))) {
+        m = p;
+        tan_min = tan;
+      }
+    }
+    p = nodes[p].next;
+  } while (p != stop);
+  return m;
+}
+
+static unsigned leftmost(const EarNode *nodes, unsigned start) {
+  unsigned best = start;
+  unsigned p = start;
+  do {
+    Point a = nodes[p].p, b = nodes[best].p;
+    if (a.x < b.x || (a.x == b.x && a.y < b.y)) {
+      best = p;
+    }
+    p = nodes[p].next;
+  } while (p != start);
+  return best;
+}
+
+// Bridges the holes to the outer ring from left to right, returning a node of
+// the combined ring.
+static unsigned bridge_holes(Rings rings, unsigned outer, Scratch *scratch) {
+  unsigned num_holes = 0;
+  for (unsigned r = 1; r < rings.num_rings; ++r) {
+    unsigned hole = link_ring(rings, r, scratch);
+    scratch->holes[num_holes++] = leftmost(scratch->nodes, hole);
+  }
+  for (unsigned k = 0; k < num_holes; ++k) {
+    scratch->keys[k] = double_sort_key(scratch->nodes[scratch->holes[k]].p.x);
+  }
+  radix_sort_keys(scratch->keys, scratch->holes, num_holes, 1);
+  for (unsigned k = 0; k < num_holes; ++k) {
+    unsigned hole = scratch->holes[k];
+    unsigned bridge = find_bridge(scratch->nodes, hole, outer);
+    if (bridge == UINT_MAX) {
+      continue;
+    }
+    unsigned reverse = split_ring(scratch, bridge, hole);
+    filter_points(scratch->nodes, reverse, scratch->nodes[reverse].next);
+    outer = filter_points(scratch->nodes, bridge, scratch->nodes[bridge].next);
+  }
+  return outer;
+}
+
+typedef struct {
+  unsigned *triangles;
+  unsigned count;
+  // The z-order grid, with scale 0 to check ears against every point
+  CurveGrid order;
+} EarOutput;
+
+static void push_triangle(EarOutput *out, const EarNode *nodes, unsigned a,
+                          unsigned b, unsigned c) {
+  out->triangles[3 * out->count] = nodes[a].i;
+  out->triangles[3 * out->count + 1] = nodes[b].i;
+  out->triangles[3 * out->count + 2] = nodes[c].i;
+  ++out->count;
+}
+
+// Clips off pairs of edges that cross right after each other, replacing them
+// with one edge and a triangle.
+static unsigned cure_local_intersections(Scratch *scratch, unsigned start,
+                                         EarOutput *out) {
+  EarNode *nodes = scratch->nodes;
+  unsigned p = start;
+  do {
+    unsigned a = nodes[p].prev;
+    unsigned b = nodes[nodes[p].next].next;
+    if (!same_point(nodes[a].p, nodes[b].p) &&
+        intersects(nodes[a].p, nodes[p].p, nodes[nodes[p].next].p,
+                   nodes[b].p) &&
+        locally_inside(nodes, a, b) && locally_inside(nodes, b, a)) {
+      push_triangle(out, nodes, a, p, b);
+      unsigned next = nodes[p].next;
+      remove_node(nodes, p);
+      remove_node(nodes, next);
+      p = start = b;
+    }
+    p = nodes[p].next;
+  } while (p != start);
+  return filter_points(nodes, p, UINT_MAX);
+}
+
+static void clip_ears(Scratch *scratch, unsigned ear, unsigned pass,
+                      EarOutput *out);
+
+// Splits the ring along the first valid diagonal and triangulates both halves.
+static void split_and_clip(Scratch *scratch, unsigned start, EarOutput *out) {
+  unsigned a = start;
+  do {
+    unsigned b = scratch->nodes[scratch->nodes[a].next].next;
+    while (b != scratch->nodes[a].prev) {
+      if (scratch->nodes[a].i != scratch->nodes[b].i &&
+          is_valid_diagonal(scratch->nodes, a, b)) {
+        unsigned c = split_ring(scratch, a, b);
+        EarNode *nodes = scratch->nodes;
+        a = filter_points(nodes, a, nodes[a].next);
+        c = filter_points(nodes, c, nodes[c].next);
+        clip_ears(scratch, a, 0, out);
+        clip_ears(scratch, c, 0, out);
+        return;
+      }
+      b = scratch->nodes[b].next;
+    }
+    a = scratch->nodes[a].next;
+  } while (a != start);
+}
+
+static void clip_ears(Scratch *scratch, unsigned ear, unsigned pass,
+                      EarOutput *out) {
+  if (pass == 0 && out->order.scale > 0) {
+    index_curve(scratch, ear, &out->order);
+  }
+  EarNode *nodes = scratch->nodes;
+  unsigned stop = ear;
+  while (nodes[ear].prev != nodes[ear].next) {
+    unsigned prev = nodes[ear].prev;
+    unsigned next = nodes[ear].next;
+    if (out->order.scale > 0 ? is_ear_hashed(nodes, ear, &out->order)
+                             : is_ear(nodes, ear)) {
+      push_triangle(out, nodes, prev, ear, next);
+      remove_node(nodes, ear);
+      ear = stop = nodes[next].next;
+      continue;
+    }
+    ear = next;
+    if (ear == stop) {
+      // No ear left: drop degenerate points, then cut off self-intersections,
+      // then split the ring
+      if (pass == 0) {
+        clip_ears(scratch, filter_points(nodes, ear, UINT_MAX), 1, out);
+      } else if (pass == 1) {
+        ear = cure_local_intersections(
+            scratch, filter_points(nodes, ear, UINT_MAX), out);
+        clip_ears(scratch, ear, 2, out);
+      } else {
+        split_and_clip(scratch, ear, out);
+      }
+      return;
+    }
+  }
+}
+
+static unsigned triangulate_ear_clipping(Rings rings, Scratch *scratch,
+                                         unsigned *triangles) {
+  unsigned n = rings_size(rings);
+  scratch_reserve(scratch, n, rings.num_rings);
+  scratch->num_nodes = 0;
+  unsigned outer = link_ring(rings, 0, scratch);
+  if (scratch->nodes[outer].next == scratch->nodes[outer].prev) {
+    return 0;
+  }
+  if (rings.num_rings > 1) {
+    outer = bridge_holes(rings, outer, scratch);
+  }
+  EarOutput out = {.triangles = triangles, .count = 0};
+  if (n > Z_ORDER_MIN_POINTS) {
+    BBox box = bbox_from_point(rings.points[rings.ring_starts[0]]);
+    for (unsigned i = rings.ring_starts[0];
+         i < rings.ring_starts[rings.num_rings]; ++i) {
+      box = bbox_union(box, bbox_from_point(rings.points[i]));
+    }
+    curve_grid_init(&out.order, box, Z_ORDER_BITS);
+  }
+  clip_ears(scratch, outer, 0, &out);
+  return out.count;
+}
+
+static unsigned triangulate(Rings rings, TriangulateMethod method,
+                            Scratch *scratch, unsigned *triangles) {
+  if (method == TRIANGULATE_AUTO) {
+    method = rings_size(rings) <= TRIANGULATE_EAR_CLIPPING_MAX_POINTS
+                 ? TRIANGULATE_EAR_CLIPPING
+                 : TRIANGULATE_MONOTONE;
+  }
+  return method == TRIANGULATE_MONOTONE
+             ? triangulate_monotone(rings, scratch, triangles)
+             : triangulate_ear_clipping(rings, scratch, triangles);
+}
+
+static Rings polygon_rings(const Polygon *poly) {
+  polygon_validate(poly);
+  return (Rings){poly->points, poly->ring_starts, poly->num_rings};
+}
+
+unsigned polygon_triangle_count(const Polygon *poly) {
+  return rings_triangle_count(polygon_rings(poly));
+}
+
+unsigned polygon_triangulate(const Polygon *poly, TriangulateMethod method,
+                             unsigned *triangles) {
+  Scratch scratch;
+  scratch_init(&scratch);
+  unsigned count =
+      triangulate(polygon_rings(poly), method, &scratch, triangles);
+  scratch_free(&scratch);
+  return count;
+}
+
+unsigned polygon_triangulate_monotone(const Polygon *poly,
+                                      unsigned *triangles) {
+  return polygon_triangulate(poly, TRIANGULATE_MONOTONE, triangles);
+}
+
+unsigned polygon_triangulate_ear_clipping(const Polygon *poly,
+                                          unsigned *triangles) {
+  return polygon_triangulate(poly, TRIANGULATE_EAR_CLIPPING, triangles);
+}
+
+static Rings set_rings(const PolygonSet *set, unsigned i) {
+  return (Rings){
+      set->points,
+      set->ring_starts + set->polygon_starts[i],
+      set->polygon_starts[i + 1] - set->polygon_starts[i],
+  };
+}
+
+typedef struct {
+  const PolygonSet *set;
+  TriangulateMethod method;
+  unsigned lo;
+  unsigned hi;
+  // Polygon i's triangles are written from triangle starts[i]
+  unsigned *indices;
+  const unsigned *starts;
+  unsigned *counts;
+} TriangulateChunk;
+
+static void *triangulate_chunk(void *data) {
+  TriangulateChunk *chunk = data;
+  Scratch scratch;
+  scratch_init(&scratch);
+  for (unsigned i = chunk->lo; i < chunk->hi; ++i) {
+    chunk->counts[i] =
+        triangulate(set_rings(chunk->set, i), chunk->method, &scratch,
+                    chunk->indices + 3 * (unsigned long)chunk->starts[i]);
+  }
+  scratch_free(&scratch);
+  return NULL;
+}
+
+// The first polygon whose points start at or after point.
+static unsigned polygon_at(const PolygonSet *set, unsigned long point) {
+  unsigned lo = 0;
+  unsigned hi = set->num_polygons;
+  while (lo < hi) {
+    unsigned mid = lo + (hi - lo) / 2;
+    if (set->ring_starts[set->polygon_starts[mid]] < point) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+void polygon_set_triangulate(const PolygonSet *set, TriangulateMethod method,
+                             unsigned num_threads, PolygonTriangles *out) {
+  polygon_set_validate(set);
+  assert(num_threads > 0 && "need at least one thread");
+  unsigned num_polygons = set->num_polygons;
+  unsigned *starts = malloc(sizeof(unsigned) * (num_polygons + 1));
+  starts[0] = 0;
+  for (unsigned i = 0; i < num_polygons; ++i) {
+    starts[i + 1] = starts[i] + rings_triangle_count(set_rings(set, i));
+  }
+  *out = (PolygonTriangles){
+      .indices = malloc(sizeof(unsigned) * 3 * (starts[num_polygons] + 1)),
+      .triangle_starts = starts,
+      .num_polygons = num_polygons,
+  };
+  unsigned *counts = malloc(sizeof(unsigned) * (num_polygons + 1));
+
+  // Chunks split the points evenly, rounded to whole polygons
+  unsigned long total = set->num_points;
+  TriangulateChunk *chunks = malloc(sizeof(TriangulateChunk) * num_threads);
+  for (unsigned t = 0; t < num_threads; ++t) {
+    chunks[t] = (TriangulateChunk){
+        .set = set,
+        .method = method,
+        .lo = polygon_at(set, total * t / num_threads),
+        .hi = t + 1 == num_threads
+                  ? num_polygons
+                  : polygon_at(set, total * (t + 1) / num_threads),
+        .indices = out->indices,
+        .starts = starts,
+        .counts = counts,
+    };
+  }
+  parallel_for(num_threads, triangulate_chunk, chunks,
+               sizeof(TriangulateChunk));
+  free(chunks);
+
+  // Every polygon was written at its largest offset, which is at or after
+  // where it belongs once the polygons before it are packed
+  unsigned size = 0;
+  for (unsigned i = 0; i < num_polygons; ++i) {
+    memmove(out->indices + 3 * (unsigned long)size,
+            out->indices + 3 * (unsigned long)starts[i],
+            sizeof(unsigned) * 3 * counts[i]);
+    starts[i] = size;
+    size += counts[i];
+  }
+  starts[num_polygons] = size;
+  out->num_triangles = size;
+  free(counts);
+}
+
+void polygon_triangles_free(PolygonTriangles *triangles) {
+  free(triangles->indices);
+  free(triangles->triangle_starts);
+}
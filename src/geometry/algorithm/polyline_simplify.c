@@ -0,0 +1,430 @@
+// Polyline simplification, see polyline_simplify.h.
+//
+// Douglas-Peucker marks kept points in a bitmap and walks it left to right.
+// The current span is from a kept point a to the next kept point b. If some
+// point of the span is out of tolerance, the farthest is kept and becomes the
+// new b, which handles the left half first. Otherwise the span is done, a
+// moves to b and the scan finds the next kept point, the right end of the
+// next unfinished span. Every span ends at a kept point, so nothing needs to
+// remember the pending right halves.
+//
+// Visvalingam-Whyatt keeps the remaining points in a doubly linked list over
+// their indices. For preserve_topology the points are bucketed once in a
+// uniform grid over the line's box, and a point's triangle is checked against
+// the remaining points in the cells it covers. If the line did not cross
+// itself, a segment that crosses the new edge from prev to next must enter the
+// triangle through that edge and leave it through one of the two edges being
+// removed, or have an endpoint inside. The first would be an existing
+// crossing, so only endpoints inside need checking.
+#include "geometry/algorithm/polyline_simplify.h"
+#include "data_structure/indexed_heap.h"
+#include "data_structure/parallel.h"
+#include "geometry/predicates.h"
+#include <assert.h>
+#include <limits.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Scratch for simplifying lines of up to capacity points.
+typedef struct {
+  unsigned capacity;
+  // Douglas-Peucker
+  unsigned char *keep;
+  // Visvalingam-Whyatt, prev[i] is UINT_MAX once i is dropped
+  unsigned *prev;
+  unsigned *next;
+  IndexedHeap heap;
+  // preserve_topology grid, cell c holds
+  // cell_points[cell_starts[c]..cell_starts[c + 1])
+  unsigned *cell_starts;
+  unsigned *cell_points;
+  unsigned *cells;
+} Scratch;
+
+typedef struct {
+  BBox box;
+  double scale_x;
+  double scale_y;
+  unsigned side;
+} Grid;
+
+static unsigned grid_side(unsigned n) {
+  unsigned side = (unsigned)sqrt((double)n);
+  return side > 0 ? side : 1;
+}
+
+static void scratch_init(Scratch *scratch, unsigned capacity) {
+  unsigned n = capacity > 0 ? capacity : 1;
+  unsigned side = grid_side(n);
+  *scratch = (Scratch){
+      .capacity = capacity,
+      .keep = malloc(n),
+      .prev = malloc(sizeof(unsigned) * n),
+      .next = malloc(sizeof(unsigned) * n),
+      .cell_starts = malloc(sizeof(unsigned) * (side * side + 1)),
+      .cell_points = malloc(sizeof(unsigned) * n),
+      .cells = malloc(sizeof(unsigned) * n),
+  };
+  indexed_heap_init(&scratch->heap, capacity);
+}
+
+static void scratch_free(Scratch *scratch) {
+  free(scratch->keep);
+  free(scratch->prev);
+  free(scratch->next);
+  free(scratch->cell_starts);
+  free(scratch->cell_points);
+  free(scratch->cells);
+  indexed_heap_free(&scratch->heap);
+}
+
+// Squared distance from p to the segment from a to b, given d = b - a and
+// inv = 1 / |d|^2, or 0 if a = b.
+static double segment_distance2(Point p, Point a, Point d, double inv) {
+  double px = p.x - a.x;
+  double py = p.y - a.y;
+  double t = (px * d.x + py * d.y) * inv;
+  t = t < 0 ? 0 : t > 1 ? 1 : t;
+  double ex = px - t * d.x;
+  double ey = py - t * d.y;
+  return ex * ex + ey * ey;
+}
+
+static unsigned copy_kept(const Point *points, unsigned n,
+                          const unsigned char *keep, Point *out) {
+  unsigned count = 0;
+  for (unsigned i = 0; i < n; ++i) {
+    if (keep[i]) {
+      out[count++] = points[i];
+    }
+  }
+  return count;
+}
+
+static unsigned douglas_peucker(const Point *points, unsigned n,
+                                double tolerance, Scratch *scratch,
+                                Point *out) {
+  if (n <= 2) {
+    if (n > 0) {
+      memmove(out, points, sizeof(Point) * n);
+    }
+    return n;
+  }
+  unsigned char *keep = scratch->keep;
+  memset(keep, 0, n);
+  keep[0] = keep[n - 1] = 1;
+  double tolerance2 = tolerance * tolerance;
+  unsigned a = 0;
+  unsigned b = n - 1;
+  while (a < n - 1) {
+    Point pa = points[a];
+    Point d = {points[b].x - pa.x, points[b].y - pa.y};
+    double length2 = d.x * d.x + d.y * d.y;
+    double inv = length2 > 0 ? 1 / length2 : 0;
+    double farthest = tolerance2;
+    unsigned far = 0;
+    for (unsigned i = a + 1; i < b; ++i) {
+      double distance2 = segment_distance2(points[i], pa, d, inv);
+      if (distance2 > farthest) {
+        farthest = distance2;
+        far = i;
+      }
+    }
+    if (far > 0) {
+      keep[far] = 1;
+      b = far;
+    } else {
+      a = b;
+      for (b = a + 1; b < n && !keep[b]; ++b) {
+      }
+    }
+  }
+  return copy_kept(points, n, keep, out);
+}
+
+static double triangle_area(Point a, Point b, Point c) {
+  return fabs((b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x)) / 2;
+}
+
+static unsigned grid_cell(const Grid *grid, double x, double y) {
+  double fx = (x - grid->box.min_x) * grid->scale_x;
+  double fy = (y - grid->box.min_y) * grid->scale_y;
+  unsigned limit = grid->side - 1;
+  unsigned cx = fx <= 0 ? 0 : fx >= limit ? limit : (unsigned)fx;
+  unsigned cy = fy <= 0 ? 0 : fy >= limit ? limit : (unsigned)fy;
+  return cy * grid->side + cx;
+}
+
+// Buckets the points by cell with a counting sort.
+static Grid build_grid(const Point *points, unsigned n, Scratch *scratch) {
+  Grid grid = {.box = bbox_from_point(points[0]), .side = grid_side(n)};
+  for (unsigned i = 1; i < n; ++i) {
+    grid.box = bbox_union(grid.box, bbox_from_point(points[i]));
+  }
+  double width = grid.box.max_x - grid.box.min_x;
+  double height = grid.box.max_y - grid.box.min_y;
+  grid.scale_x = width > 0 ? grid.side / width : 0;
+  grid.scale_y = height > 0 ? grid.side / height : 0;
+
+  unsigned num_cells = grid.side * grid.side;
+  unsigned *starts = scratch->cell_starts;
+  memset(starts, 0, sizeof(unsigned) * (num_cells + 1));
+  for (unsigned i = 0; i < n; ++i) {
+    scratch->cells[i] = grid_cell(&grid, points[i].x, points[i].y);
+    ++starts[scratch->cells[i] + 1];
+  }
+  for (unsigned c = 0; c < num_cells; ++c) {
+    starts[c + 1] += starts[c];
+  }
+  for (unsigned i = 0; i < n; ++i) {
+    scratch->cell_points[starts[scratch->cells[i]]++] = i;
+  }
+  // The fill moved every start to the next cell's start
+  memmove(starts + 1, starts, sizeof(unsigned) * num_cells);
+  starts[0] = 0;
+  return grid;
+}
+
+static BBox triangle_box(Point a, Point b, Point c) {
+  return bbox_union(bbox_from_segment((Segment){a, b}), bbox_from_point(c));
+}
+
+static bool in_triangle(Point a, Point b, Point c, Point p) {
+  BBox box = triangle_box(a, b, c);
+  if (!bbox_contains_point(box, p)) {
+    return false;
+  }
+  double d0 = orient2d(a, b, p);
+  double d1 = orient2d(b, c, p);
+  double d2 = orient2d(c, a, p);
+  bool negative = d0 < 0 || d1 < 0 || d2 < 0;
+  bool positive = d0 > 0 || d1 > 0 || d2 > 0;
+  return !(negative && positive);
+}
+
+// Whether dropping i could make the line cross itself: some remaining point
+// other than i and its neighbors is in their triangle. Points equal to a
+// neighbor only touch the new edge at its end, as they already did.
+static bool blocked(const Point *points, const Scratch *scratch,
+                    const Grid *grid, unsigned i) {
+  unsigned ia = scratch->prev[i];
+  unsigned ic = scratch->next[i];
+  Point a = points[ia];
+  Point b = points[i];
+  Point c = points[ic];
+  if (a.x == c.x && a.y == c.y) {
+    // Dropping i would fold the line back onto itself
+    return true;
+  }
+  BBox box = triangle_box(a, b, c);
+  unsigned lo = grid_cell(grid, box.min_x, box.min_y);
+  unsigned hi = grid_cell(grid, box.max_x, box.max_y);
+  unsigned x0 = lo % grid->side;
+  unsigned x1 = hi % grid->side;
+  for (unsigned y = lo / grid->side; y <= hi / grid->side; ++y) {
+    unsigned row = y * grid->side;
+    for (unsigned k = scratch->cell_starts[row + x0];
+         k < scratch->cell_starts[row + x1 + 1]; ++k) {
+      unsigned j = scratch->cell_points[k];
+      if (j == i || j == ia || j == ic || scratch->prev[j] == UINT_MAX) {
+        continue;
+      }
+      Point p = points[j];
+      if ((p.x == a.x && p.y == a.y) || (p.x == c.x && p.y == c.y)) {
+        continue;
+      }
+      if (in_triangle(a, b, c, p)) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+static void update_area(const Point *points, Scratch *scratch, unsigned n,
+                        unsigned i) {
+  if (i == 0 || i == n - 1) {
+    return;
+  }
+  indexed_heap_update(&scratch->heap, i,
+                      triangle_area(points[scratch->prev[i]], points[i],
+                                    points[scratch->next[i]]));
+}
+
+static unsigned visvalingam_whyatt(const Point *points, unsigned n,
+                                   double min_area, bool preserve_topology,
+                                   Scratch *scratch, Point *out) {
+  if (n <= 2) {
+    if (n > 0) {
+      memmove(out, points, sizeof(Point) * n);
+    }
+    return n;
+  }
+  unsigned *prev = scratch->prev;
+  unsigned *next = scratch->next;
+  IndexedHeap *heap = &scratch->heap;
+  for (unsigned i = 0; i < n; ++i) {
+    prev[i] = i - 1;
+    next[i] = i + 1;
+  }
+  prev[0] = 0;
+  indexed_heap_clear(heap);
+  for (unsigned i = 1; i + 1 < n; ++i) {
+    update_area(points, scratch, n, i);
+  }
+  Grid grid = {};
+  if (preserve_topology) {
+    grid = build_grid(points, n, scratch);
+  }
+
+  // A closed line keeps a triangle, as fewer points would collapse it
+  bool closed =
+      points[0].x == points[n - 1].x && points[0].y == points[n - 1].y;
+  unsigned remaining = n;
+  unsigned i;
+  while ((i = indexed_heap_peek(heap)) != UINT_MAX &&
+         heap->keys[i] < min_area) {
+    if (preserve_topology && closed && remaining <= 4) {
+      break;
+    }
+    indexed_heap_pop(heap);
+    if (preserve_topology && blocked(points, scratch, &grid, i)) {
+      continue;
+    }
+    --remaining;
+    unsigned a = prev[i];
+    unsigned c = next[i];
+    next[a] = c;
+    prev[c] = a;
+    prev[i] = UINT_MAX;
+    update_area(points, scratch, n, a);
+    update_area(points, scratch, n, c);
+  }
+
+  unsigned count = 0;
+  for (i = 0; i < n; i = next[i]) {
+    out[count++] = points[i];
+  }
+  return count;
+}
+
+unsigned polyline_simplify_douglas_peucker(const Point *points, unsigned n,
+                                           double tolerance, Point *out) {
+  assert((points || n == 0) && "cannot simplify NULL points");
+  assert(tolerance >= 0 && "tolerance must not be negative");
+  Scratch scratch;
+  scratch_init(&scratch, n);
+  unsigned count = douglas_peucker(points, n, tolerance, &scratch, out);
+  scratch_free(&scratch);
+  return count;
+}
+
+unsigned polyline_simplify_visvalingam_whyatt(const Point *points, unsigned n,
+                                              double min_area,
+                                              bool preserve_topology,
+                                              Point *out) {
+  assert((points || n == 0) && "cannot simplify NULL points");
+  Scratch scratch;
+  scratch_init(&scratch, n);
+  unsigned count = visvalingam_whyatt(points, n, min_area, preserve_topology,
+                                      &scratch, out);
+  scratch_free(&scratch);
+  return count;
+}
+
+typedef struct {
+  const PolylineSet *lines;
+  SimplifyOptions options;
+  unsigned lo;
+  unsigned hi;
+  // Simplified line i is out[line_starts[i]..line_starts[i] + counts[i])
+  Point *out;
+  unsigned *counts;
+} SimplifyChunk;
+
+static void *simplify_chunk(void *data) {
+  SimplifyChunk *chunk = data;
+  const PolylineSet *lines = chunk->lines;
+  unsigned longest = 0;
+  for (unsigned i = chunk->lo; i < chunk->hi; ++i) {
+    unsigned size = polyline_set_line_size(lines, i);
+    longest = size > longest ? size : longest;
+  }
+  Scratch scratch;
+  scratch_init(&scratch, longest);
+  for (unsigned i = chunk->lo; i < chunk->hi; ++i) {
+    const Point *points = lines->points + lines->line_starts[i];
+    unsigned n = polyline_set_line_size(lines, i);
+    Point *out = chunk->out + lines->line_starts[i];
+    chunk->counts[i] =
+        chunk->options.method == SIMPLIFY_DOUGLAS_PEUCKER
+            ? douglas_peucker(points, n, chunk->options.tolerance, &scratch,
+                              out)
+            : visvalingam_whyatt(points, n, chunk->options.tolerance,
+                                 chunk->options.preserve_topology, &scratch,
+                                 out);
+  }
+  scratch_free(&scratch);
+  return NULL;
+}
+
+// The first line that starts at or after point.
+static unsigned line_at(const PolylineSet *lines, unsigned long point) {
+  unsigned lo = 0;
+  unsigned hi = lines->num_lines;
+  while (lo < hi) {
+    unsigned mid = lo + (hi - lo) / 2;
+    if (lines->line_starts[mid] < point) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+void polyline_set_simplify(const PolylineSet *lines, SimplifyOptions options,
+                           unsigned num_threads, PolylineSet *out) {
+  polyline_set_validate(lines);
+  assert(lines != out && "cannot simplify a polyline set into itself");
+  assert(num_threads > 0 && "need at least one thread");
+  assert(options.tolerance >= 0 && "tolerance must not be negative");
+  polyline_set_clear(out);
+  polyline_set_reserve(out, lines->num_points, lines->num_lines);
+  unsigned *counts = malloc(sizeof(unsigned) * (lines->num_lines + 1));
+
+  // Chunks split the points evenly, rounded to whole lines, with any empty
+  // lines at the end going to the last one
+  unsigned long total = lines->num_points;
+  SimplifyChunk *chunks = malloc(sizeof(SimplifyChunk) * num_threads);
+  for (unsigned t = 0; t < num_threads; ++t) {
+    chunks[t] = (SimplifyChunk){
+        .lines = lines,
+        .options = options,
+        .lo = line_at(lines, total * t / num_threads),
+        .hi = t + 1 == num_threads
+                  ? lines->num_lines
+                  : line_at(lines, total * (t + 1) / num_threads),
+        .out = out->points,
+        .counts = counts,
+    };
+  }
+  parallel_for(num_threads, simplify_chunk, chunks, sizeof(SimplifyChunk));
+  free(chunks);
+
+  // Every line was written at its input offset, which is at or after where it
+  // belongs once the lines before it have shrunk
+  unsigned size = 0;
+  for (unsigned i = 0; i < lines->num_lines; ++i) {
+    if (counts[i] > 0) {
+      memmove(out->points + size, out->points + lines->line_starts[i],
+              sizeof(Point) * counts[i]);
+    }
+    size += counts[i];
+    out->line_starts[i + 1] = size;
+  }
+  out->num_points = size;
+  out->num_lines = lines->num_lines;
+  free(counts);
+}
@@ -0,0 +1,357 @@
+#include "geometry/algorithm/rotating_calipers.h"
+#include "geometry/algorithm/convex_hull.h"
+#include "geometry/predicates.h"
+#include <assert.h>
+#include <stdint.h>
+
+// Points within this fraction of the radius outside a circle are taken to be
+// on it, so rounding in the circumcircle does not restart Welzl's loops.
+static const double CIRCLE_TOLERANCE = 1e-12;
+
+static Point sub(Point a, Point b) { return (Point){a.x - b.x, a.y - b.y}; }
+
+static double dot(Point a, Point b) { return a.x * b.x + a.y * b.y; }
+
+static double cross(Point a, Point b) { return a.x * b.y - a.y * b.x; }
+
+static Point edge(const Point *hull, unsigned h, unsigned i) {
+  return sub(hull[(i + 1) % h], hull[i % h]);
+}
+
+// The vertex after the lower hull, which is the rightmost and highest.
+static unsigned hull_rightmost(const Point *hull, unsigned h) {
+  unsigned r = 0;
+  for (unsigned i = 1; i < h; ++i) {
+    if (hull[i].x > hull[r].x ||
+        (hull[i].x == hull[r].x && hull[i].y > hull[r].y)) {
+      r = i;
+    }
+  }
+  return r;
+}
+
+typedef void (*antipodal_visit_t)(void *data, unsigned a, unsigned b);
+
+// Walks i along the lower hull and j along the upper hull, which start and end
+// antipodal, always advancing the one whose next edge turns less from the
+// other's. When the two edges are parallel, both of their endpoints are
+// antipodal to each other.
+static void antipodal_walk(const Point *hull, unsigned h,
+                           antipodal_visit_t visit, void *data) {
+  if (h < 2) {
+    return;
+  }
+  if (h == 2) {
+    visit(data, 0, 1);
+    return;
+  }
+  unsigned r = hull_rightmost(hull, h);
+  unsigned i = 0;
+  unsigned j = r;
+  visit(data, i, j);
+  while (i < r || j < h) {
+    double turn = i == r   ? 1
+                  : j == h ? -1
+                           : cross(edge(hull, h, i), edge(hull, h, j));
+    if (turn < 0) {
+      ++i;
+    } else if (turn > 0) {
+      ++j;
+    } else {
+      visit(data, i + 1, j);
+      visit(data, i, (j + 1) % h);
+      ++i;
+      ++j;
+    }
+    if (i < r || j < h) {
+      visit(data, i, j % h);
+    }
+  }
+}
+
+typedef struct {
+  IndexPair *pairs;
+  unsigned count;
+} PairList;
+
+static void append_pair(void *data, unsigned a, unsigned b) {
+  PairList *list = data;
+  list->pairs[list->count++] = (IndexPair){a, b};
+}
+
+unsigned hull_antipodal_pairs(const Point *hull, unsigned h, IndexPair *pairs) {
+  PairList list = {pairs, 0};
+  antipodal_walk(hull, h, append_pair, &list);
+  return list.count;
+}
+
+// Squared distance of the farthest pair found so far.
+typedef struct {
+  const Point *hull;
+  double distance;
+  unsigned a;
+  unsigned b;
+} Farthest;
+
+static void consider(void *data, unsigned a, unsigned b) {
+  Farthest *best = data;
+  Point d = sub(best->hull[a], best->hull[b]);
+  if (dot(d, d) > best->distance) {
+    best->distance = dot(d, d);
+    best->a = a;
+    best->b = b;
+  }
+}
+
+double hull_diameter(const Point *hull, unsigned h, unsigned *a, unsigned *b) {
+  Farthest best = {hull, 0, 0, 0};
+  antipodal_walk(hull, h, consider, &best);
+  *a = best.a;
+  *b = best.b;
+  return sqrt(best.distance);
+}
+
+// Advances k from vertex k while the next vertex is farther along direction,
+// relative to origin, and returns where it stops.
+static unsigned advance(const Point *hull, unsigned h, unsigned k,
+                        Point origin, Point direction) {
+  while (dot(sub(hull[(k + 1) % h], origin), direction) >
+         dot(sub(hull[k % h], origin), direction)) {
+    ++k;
+  }
+  return k;
+}
+
+double hull_width(const Point *hull, unsigned h, unsigned *edge_start) {
+  *edge_start = 0;
+  if (h < 3) {
+    return 0;
+  }
+  double best = INFINITY;
+  unsigned far = 1;
+  for (unsigned i = 0; i < h; ++i) {
+    Point e = edge(hull, h, i);
+    Point normal = {-e.y, e.x};
+    far = advance(hull, h, far > i ? far : i + 1, hull[i], normal);
+    double width = dot(sub(hull[far % h], hull[i]), normal) / hypot(e.x, e.y);
+    if (width < best) {
+      best = width;
+      *edge_start = i;
+    }
+  }
+  return best;
+}
+
+// Rotates a box around the hull with one side on each edge in turn, keeping
+// calipers on the vertices farthest along the edge, farthest from it and
+// farthest back along it. Coordinates are taken relative to the first vertex
+// to keep the projections precise far from the origin.
+static void min_box(const Point *hull, unsigned h, bool perimeter,
+                    OrientedBox *box) {
+  if (h < 3) {
+    Point a = h ? hull[0] : (Point){0, 0};
+    Point b = h == 2 ? hull[1] : a;
+    double length = point_distance(a, b);
+    Point axis = {1, 0};
+    if (length > 0) {
+      axis = (Point){(b.x - a.x) / length, (b.y - a.y) / length};
+    }
+    *box = (OrientedBox){
+        .center = {(a.x + b.x) / 2, (a.y + b.y) / 2},
+        .axis = axis,
+        .length = length,
+        .width = 0,
+    };
+    return;
+  }
+  Point origin = hull[0];
+  double best = INFINITY;
+  unsigned right = 1;
+  unsigned far = 1;
+  unsigned left = 1;
+  for (unsigned i = 0; i < h; ++i) {
+    Point e = edge(hull, h, i);
+    double norm = hypot(e.x, e.y);
+    Point u = {e.x / norm, e.y / norm};
+    Point v = {-u.y, u.x};
+    Point back = {-u.x, -u.y};
+    right = advance(hull, h, right > i ? right : i + 1, origin, u);
+    far = advance(hull, h, far > right ? far : right, origin, v);
+    left = advance(hull, h, left > far ? left : far, origin, back);
+    double max_u = dot(sub(hull[right % h], origin), u);
+    double min_u = dot(sub(hull[left % h], origin), u);
+    double max_v = dot(sub(hull[far % h], origin), v);
+    double min_v = dot(sub(hull[i], origin), v);
+    double length = max_u - min_u;
+    double width = max_v - min_v;
+    double cost = perimeter ? length + width : length * width;
+    if (cost < best) {
+      best = cost;
+      double cu = (max_u + min_u) / 2;
+      double cv = (max_v + min_v) / 2;
+      *box = (OrientedBox){
+          .center = {origin.x + cu * u.x + cv * v.x,
+                     origin.y + cu * u.y + cv * v.y},
+          .axis = u,
+          .length = length,
+          .width = width,
+      };
+    }
+  }
+}
+
+void hull_min_area_box(const Point *hull, unsigned h, OrientedBox *box) {
+  min_box(hull, h, false, box);
+}
+
+void hull_min_perimeter_box(const Point *hull, unsigned h, OrientedBox *box) {
+  min_box(hull, h, true, box);
+}
+
+// The index of the first point at exactly p's position.
+static unsigned find_point(const Point *points, unsigned n, Point p) {
+  for (unsigned i = 0; i < n; ++i) {
+    if (points[i].x == p.x && points[i].y == p.y) {
+      return i;
+    }
+  }
+  assert(false && "hull vertex is not an input point");
+  return 0;
+}
+
+bool farthest_pair(const Point *points, unsigned n, Point *scratch,
+                   unsigned *a, unsigned *b) {
+  if (n < 2) {
+    return false;
+  }
+  unsigned h;
+  Point *hull = convex_hull_in_scratch(points, n, scratch, &h);
+  if (h < 2) {
+    *a = 0;
+    *b = 1;
+    return true;
+  }
+  unsigned i, j;
+  hull_diameter(hull, h, &i, &j);
+  unsigned x = find_point(points, n, hull[i]);
+  unsigned y = find_point(points, n, hull[j]);
+  *a = x < y ? x : y;
+  *b = x < y ? y : x;
+  return true;
+}
+
+double points_width(const Point *points, unsigned n, Point *scratch) {
+  unsigned h;
+  Point *hull = convex_hull_in_scratch(points, n, scratch, &h);
+  unsigned edge_start;
+  return hull_width(hull, h, &edge_start);
+}
+
+void min_area_box(const Point *points, unsigned n, Point *scratch,
+                  OrientedBox *box) {
+  unsigned h;
+  Point *hull = convex_hull_in_scratch(points, n, scratch, &h);
+  hull_min_area_box(hull, h, box);
+}
+
+void min_perimeter_box(const Point *points, unsigned n, Point *scratch,
+                       OrientedBox *box) {
+  unsigned h;
+  Point *hull = convex_hull_in_scratch(points, n, scratch, &h);
+  hull_min_perimeter_box(hull, h, box);
+}
+
+// A well mixed hash of i, from splitmix64, so the shuffle is random but the
+// same on every run.
+static uint64_t mix(uint64_t i) {
+  i += 0x9e3779b97f4a7c15;
+  i = (i ^ (i >> 30)) * 0xbf58476d1ce4e5b9;
+  i = (i ^ (i >> 27)) * 0x94d049bb133111eb;
+  return i ^ (i >> 31);
+}
+
+static bool circle_contains(Circle c, Point p) {
+  Point d = sub(p, c.center);
+  double r = c.radius * (1 + CIRCLE_TOLERANCE);
+  return dot(d, d) <= r * r;
+}
+
+static Circle circle_from_two(Point a, Point b) {
+  Point center = {(a.x + b.x) / 2, (a.y + b.y) / 2};
+  return (Circle){center, point_distance(a, center)};
+}
+
+// The circumcircle of a, b and c, or the smallest circle through the farthest
+// two if they are collinear. The radius is the largest distance from the
+// rounded center, so all three are inside.
+static Circle circle_from_three(Point a, Point b, Point c) {
+  double o = orient2d(a, b, c);
+  if (o == 0) {
+    Circle ab = circle_from_two(a, b);
+    Circle ac = circle_from_two(a, c);
+    Circle bc = circle_from_two(b, c);
+    Circle wide = ab.radius > ac.radius ? ab : ac;
+    return wide.radius > bc.radius ? wide : bc;
+  }
+  Point ab = sub(b, a);
+  Point ac = sub(c, a);
+  double b2 = dot(ab, ab);
+  double c2 = dot(ac, ac);
+  Point center = {a.x + (ac.y * b2 - ab.y * c2) / (2 * o),
+                  a.y + (ab.x * c2 - ac.x * b2) / (2 * o)};
+  double radius = point_distance(a, center);
+  radius = fmax(radius, point_distance(b, center));
+  radius = fmax(radius, point_distance(c, center));
+  return (Circle){center, radius};
+}
+
+void min_enclosing_circle(const Point *points, unsigned n, Point *scratch,
+                          Circle *circle) {
+  if (n == 0) {
+    *circle = (Circle){{0, 0}, 0};
+    return;
+  }
+  // Shuffle relative to the first point, which keeps the circumcircles
+  // precise far from the origin
+  Point origin = points[0];
+  for (unsigned i = 0; i < n; ++i) {
+    unsigned j = (unsigned)(mix(i) % (i + 1));
+    if (j != i) {
+      scratch[i] = scratch[j];
+    }
+    scratch[j] = sub(points[i], origin);
+  }
+  Circle c = {scratch[0], 0};
+  for (unsigned i = 1; i < n; ++i) {
+    if (circle_contains(c, scratch[i])) {
+      continue;
+    }
+    // scratch[i] is on the boundary of the circle of scratch[0..i]
+    c = (Circle){scratch[i], 0};
+    for (unsigned j = 0; j < i; ++j) {
+      if (circle_contains(c, scratch[j])) {
+        continue;
+      }
+      // And so is scratch[j]
+      c = circle_from_two(scratch[i], scratch[j]);
+      for (unsigned k = 0; k < j; ++k) {
+        if (!circle_contains(c, scratch[k])) {
+          c = circle_from_three(scratch[i], scratch[j], scratch[k]);
+        }
+      }
+    }
+  }
+  c.center.x += origin.x;
+  c.center.y += origin.y;
+  *circle = c;
+}
+
+void oriented_box_corners(const OrientedBox *box, Point corners[4]) {
+  Point u = {box->axis.x * box->length / 2, box->axis.y * box->length / 2};
+  Point v = {-box->axis.y * box->width / 2, box->axis.x * box->width / 2};
+  Point c = box->center;
+  corners[0] = (Point){c.x - u.x - v.x, c.y - u.y - v.y};
+  corners[1] = (Point){c.x + u.x - v.x, c.y + u.y - v.y};
+  corners[2] = (Point){c.x + u.x + v.x, c.y + u.y + v.y};
+  corners[3] = (Point){c.x - u.x + v.x, c.y - u.y + v.y};
+}
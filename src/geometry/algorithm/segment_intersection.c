@@ -0,0 +1,795 @@
+// All-pairs segment intersection with a Bentley-Ottmann sweep, and detecting
+// whether any pair intersects with a Shamos-Hoey sweep.
+//
+// A vertical sweep line moves left to right over the event points: segment
+// endpoints, and crossings found along the way. Points are ordered by x, then
+// by y, so a vertical segment's lower endpoint comes first. The status is a
+// RedBlackTree of the segments that cross the sweep line, ordered bottom to
+// top. Only segments that are adjacent in the status can cross before the next
+// event, so whenever two segments become adjacent we test them and schedule an
+// event at their crossing if it lies ahead of the sweep.
+//
+// At each event point p we gather:
+// U - segments whose left endpoint is p
+// L - segments in the status whose right endpoint is p
+// C - segments in the status that contain p in their interior
+// Every intersecting pair within U, L and C is reported. L and C are removed
+// from the status and U and C are inserted back in their order just right of
+// p, which reverses the segments of C that cross at p.
+//
+// Event points are exact. A crossing is kept as the pair of segments that
+// cross there, and compared with other points and segments through the exact
+// ImplicitPoint predicates, so the status is always in its exact order just
+// right of the sweep point, and several segments crossing at one point meet at
+// one event point whether or not it is representable. The ordering rules only
+// ever compare a segment through p with other segments:
+// - a segment not through p is ordered by which side of it p lies on
+// - two segments through p are ordered by direction, counter-clockwise from
+//   straight down, which is their order just right of p
+// Only crossings interior to both segments are events. Segments that overlap
+// or touch at an endpoint pass exactly through that endpoint, which is an
+// event point anyway. Segments are removed through their RedBlackTree node
+// handles, so a removal never depends on a comparison.
+//
+// Whether a pair actually intersects is always decided by the exact closed
+// segment test, and the reported point is computed from the pair alone, so
+// the output matches the brute force version.
+#include "geometry/algorithm/segment_intersection.h"
+#include "data_structure/hash.h"
+#include "data_structure/parallel.h"
+#include "data_structure/priority_queue.h"
+#include "data_structure/red_black_tree.h"
+#include "data_structure/sort.h"
+#include "data_structure/vector.h"
+#include "geometry/predicates.h"
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+typedef struct Sweep Sweep;
+
+typedef struct {
+  Point left;
+  Point right;
+  unsigned index;
+  // Node in the status, or NULL if the segment is not in the status
+  RedBlackNode *node;
+  // Marks the last event this segment was gathered at
+  unsigned stamp;
+  bool degenerate;
+  bool is_probe;
+  Sweep *sweep;
+} SweepSegment;
+
+typedef enum { SEGMENT_START, SEGMENT_END, CROSSING } EventType;
+
+typedef struct {
+  ImplicitPoint p;
+  EventType type;
+  SweepSegment *seg;
+  // The other segment of a crossing
+  SweepSegment *other;
+} Event;
+
+struct Sweep {
+  ImplicitPoint p;
+  unsigned stamp;
+  SweepSegment *segs;
+  RedBlackTree status;
+  PriorityQueue events;
+  // Reported pairs, encoded with `pair_key`
+  Hash reported;
+  // Stands in for the event point in status searches
+  SweepSegment probe;
+  // Pairs reported at event points left of x_min are dropped
+  double x_min;
+  intersection_callback_t callback;
+  void *data;
+};
+
+static bool point_before(Point a, Point b) {
+  return a.x < b.x || (a.x == b.x && a.y < b.y);
+}
+
+static bool same_point(Point a, Point b) { return a.x == b.x && a.y == b.y; }
+
+// Exact sign of the cross product of a and b.
+static double cross(Point a, Point b) {
+  return orient2d((Point){.x = 0, .y = 0}, a, b);
+}
+
+static Point direction(Point from, Point to) {
+  return (Point){.x = to.x - from.x, .y = to.y - from.y};
+}
+
+static SweepSegment sweep_segment_new(Sweep *sweep, Segment s,
+                                      unsigned index) {
+  bool forward = point_before(s.p0, s.p1);
+  return (SweepSegment){
+      .left = forward ? s.p0 : s.p1,
+      .right = forward ? s.p1 : s.p0,
+      .index = index,
+      .node = NULL,
+      .stamp = 0,
+      .degenerate = same_point(s.p0, s.p1),
+      .is_probe = false,
+      .sweep = sweep,
+  };
+}
+
+static Segment sweep_segment(const SweepSegment *s) {
+  return (Segment){.p0 = s->left, .p1 = s->right};
+}
+
+// Side of s the event point p lies on: 0 when s passes through p, and
+// positive when p lies above s. Segments in the status span the sweep point,
+// so passing through p is having p on the segment's line.
+static double side(const SweepSegment *s, const ImplicitPoint *p) {
+  return implicit_orient2d(s->left, s->right, p);
+}
+
+static bool passes_through(const SweepSegment *s, const ImplicitPoint *p) {
+  return side(s, p) == 0;
+}
+
+// Order of two segments through the sweep point, just right of it.
+static Ordering direction_cmp(const SweepSegment *a, const SweepSegment *b) {
+  double c = direction_cross(sweep_segment(a), sweep_segment(b));
+  if (c != 0) {
+    return c > 0 ? LESS : GREATER;
+  }
+  return a->index < b->index ? LESS : a->index == b->index ? EQUALS : GREATER;
+}
+
+// y coordinate of s at the sweep's x. Only used to order two segments that are
+// both away from the sweep point, which the sweep itself never needs.
+static double y_at(const SweepSegment *s, Point p) {
+  if (s->left.x == s->right.x) {
+    return fmax(s->left.y, fmin(s->right.y, p.y));
+  }
+  double t = (p.x - s->left.x) / (s->right.x - s->left.x);
+  return s->left.y + t * (s->right.y - s->left.y);
+}
+
+static Ordering status_cmp(void *va, void *vb) {
+  SweepSegment *a = va;
+  SweepSegment *b = vb;
+  if (a == b) {
+    return EQUALS;
+  }
+  const ImplicitPoint *p = &a->sweep->p;
+
+  // The probe sorts just below all segments through p
+  if (a->is_probe) {
+    return side(b, p) <= 0 ? LESS : GREATER;
+  }
+  if (b->is_probe) {
+    return side(a, p) <= 0 ? GREATER : LESS;
+  }
+
+  double a_side = side(a, p);
+  double b_side = side(b, p);
+  if (a_side == 0 && b_side == 0) {
+    return direction_cmp(a, b);
+  }
+  if (a_side == 0) {
+    return b_side > 0 ? GREATER : LESS;
+  }
+  if (b_side == 0) {
+    return a_side > 0 ? LESS : GREATER;
+  }
+  double ya = y_at(a, p->approx);
+  double yb = y_at(b, p->approx);
+  if (ya != yb) {
+    return ya < yb ? LESS : GREATER;
+  }
+  return direction_cmp(a, b);
+}
+
+static Ordering event_cmp(void *va, void *vb) {
+  int c = implicit_compare(&((Event *)va)->p, &((Event *)vb)->p);
+  return c < 0 ? LESS : c > 0 ? GREATER : EQUALS;
+}
+
+static void *pair_key(unsigned a, unsigned b) {
+  static_assert(sizeof(void *) >= sizeof(uint64_t),
+                "pair keys are packed into pointers");
+  return (void *)(uintptr_t)((uint64_t)a << 32 | b);
+}
+
+static unsigned pair_hash(void *key) {
+  uint64_t k = (uintptr_t)key;
+  k ^= k >> 33;
+  k *= 0xff51afd7ed558ccdULL;
+  k ^= k >> 33;
+  return (unsigned)k;
+}
+
+static void report(Sweep *sweep, const SweepSegment *s0,
+                   const SweepSegment *s1) {
+  unsigned a = s0->index < s1->index ? s0->index : s1->index;
+  unsigned b = s0->index < s1->index ? s1->index : s0->index;
+  Segment seg_a = sweep_segment(&sweep->segs[a]);
+  Segment seg_b = sweep_segment(&sweep->segs[b]);
+  if (!segment_intersects(seg_a, seg_b)) {
+    return;
+  }
+  if (!hash_insert(&sweep->reported, pair_key(a, b))) {
+    return;
+  }
+  // Dropped only after it is marked, or an overlap would be reported again at
+  // a later point
+  if (implicit_compare_x(&sweep->p, sweep->x_min) < 0) {
+    return;
+  }
+  sweep->callback(
+      (SegmentIntersection){
+          .a = a,
+          .b = b,
+          .p = segment_intersection_point(seg_a, seg_b),
+      },
+      sweep->data);
+}
+
+// Tests two segments that just became adjacent and schedules their crossing
+// if it lies ahead of the sweep, unless the pair was already reported. Pairs
+// that overlap or touch at an endpoint are found at that endpoint instead.
+static void check_adjacent(Sweep *sweep, SweepSegment *s0, SweepSegment *s1) {
+  if (s0->index > s1->index) {
+    SweepSegment *t = s0;
+    s0 = s1;
+    s1 = t;
+  }
+  Segment seg0 = sweep_segment(s0);
+  Segment seg1 = sweep_segment(s1);
+  if (!segment_intersects(seg0, seg1) ||
+      hash_contains(&sweep->reported, pair_key(s0->index, s1->index))) {
+    return;
+  }
+  if (orient2d(seg0.p0, seg0.p1, seg1.p0) == 0 ||
+      orient2d(seg0.p0, seg0.p1, seg1.p1) == 0 ||
+      orient2d(seg1.p0, seg1.p1, seg0.p0) == 0 ||
+      orient2d(seg1.p0, seg1.p1, seg0.p1) == 0) {
+    return;
+  }
+  ImplicitPoint q = implicit_crossing(seg0, seg1);
+  if (implicit_compare(&q, &sweep->p) <= 0) {
+    return;
+  }
+  Event *e = malloc(sizeof(Event));
+  *e = (Event){.p = q, .type = CROSSING, .seg = s0, .other = s1};
+  pq_push(&sweep->events, e);
+}
+
+static SweepSegment *node_segment(RedBlackNode *n) {
+  return n ? rb_tree_node_val(n) : NULL;
+}
+
+static void gather(Sweep *sweep, SweepSegment *s, Vector *into) {
+  s->stamp = sweep->stamp;
+  vector_push(into, s);
+}
+
+typedef struct {
+  // U and degenerate segments at p
+  Vector starting;
+  // L and C
+  Vector through;
+  Vector inserting;
+} EventScratch;
+
+static void handle_event_point(Sweep *sweep, Vector *group,
+                               EventScratch *scratch) {
+  const ImplicitPoint *p = &sweep->p;
+  ++sweep->stamp;
+  scratch->starting.size = 0;
+  scratch->through.size = 0;
+  scratch->inserting.size = 0;
+
+  for (unsigned i = 0; i < group->size; ++i) {
+    Event *e = group->data[i];
+    if (e->type == SEGMENT_START) {
+      gather(sweep, e->seg, &scratch->starting);
+    }
+  }
+  // Segments in the status through p are next to each other, just above the
+  // probe
+  for (RedBlackNode *n = rb_tree_upper_bound(&sweep->status, &sweep->probe);
+       n && passes_through(node_segment(n), p); n = rb_tree_node_next(n)) {
+    gather(sweep, node_segment(n), &scratch->through);
+  }
+#ifndef NDEBUG
+  for (unsigned i = 0; i < group->size; ++i) {
+    Event *e = group->data[i];
+    assert((e->type == SEGMENT_START || e->seg->stamp == sweep->stamp) &&
+           "segments of the events at p should pass through it");
+    assert((e->type != CROSSING || e->other->stamp == sweep->stamp) &&
+           "segments of the events at p should pass through it");
+  }
+#endif
+
+  // Report every intersecting pair among U, L and C
+  Vector *lists[] = {&scratch->starting, &scratch->through};
+  for (unsigned li = 0; li < 2; ++li) {
+    for (unsigned i = 0; i < lists[li]->size; ++i) {
+      for (unsigned lj = li; lj < 2; ++lj) {
+        for (unsigned j = li == lj ? i + 1 : 0; j < lists[lj]->size; ++j) {
+          report(sweep, lists[li]->data[i], lists[lj]->data[j]);
+        }
+      }
+    }
+  }
+
+  // Remove L and C, then insert U and C in their order just right of p
+  for (unsigned i = 0; i < scratch->through.size; ++i) {
+    SweepSegment *s = scratch->through.data[i];
+    rb_tree_delete_node(&sweep->status, s->node);
+    s->node = NULL;
+    if (p->crossing || !same_point(s->right, p->approx)) {
+      vector_push(&scratch->inserting, s);
+    }
+  }
+  for (unsigned i = 0; i < scratch->starting.size; ++i) {
+    SweepSegment *s = scratch->starting.data[i];
+    if (!s->degenerate) {
+      vector_push(&scratch->inserting, s);
+    }
+  }
+  for (unsigned i = 0; i < scratch->inserting.size; ++i) {
+    SweepSegment *s = scratch->inserting.data[i];
+    s->node = rb_tree_insert_node(&sweep->status, s);
+    assert(s->node && "segments are never equal in the status");
+  }
+
+  if (scratch->inserting.size == 0) {
+    // p left a gap. Its new neighbors are the segments just below and above.
+    RedBlackNode *above = rb_tree_upper_bound(&sweep->status, &sweep->probe);
+    RedBlackNode *below =
+        above ? rb_tree_node_prev(above) : rb_tree_last_node(&sweep->status);
+    if (above && below) {
+      check_adjacent(sweep, node_segment(below), node_segment(above));
+    }
+    return;
+  }
+
+  SweepSegment *lowest = scratch->inserting.data[0];
+  SweepSegment *highest = lowest;
+  for (unsigned i = 1; i < scratch->inserting.size; ++i) {
+    SweepSegment *s = scratch->inserting.data[i];
+    if (direction_cmp(s, lowest) == LESS) {
+      lowest = s;
+    }
+    if (direction_cmp(s, highest) == GREATER) {
+      highest = s;
+    }
+  }
+  SweepSegment *below = node_segment(rb_tree_node_prev(lowest->node));
+  if (below) {
+    check_adjacent(sweep, below, lowest);
+  }
+  SweepSegment *above = node_segment(rb_tree_node_next(highest->node));
+  if (above) {
+    check_adjacent(sweep, highest, above);
+  }
+}
+
+// Sweeps the event points left of x_max, keeping only the pairs reported at
+// event points with x in [x_min, x_max). A pair is reported at the first point
+// of its intersection, which depends on the pair alone, so sweeps over x ranges
+// that cover the plane report each pair once.
+static void sweep_between(const Segment *segments, unsigned n, double x_min,
+                          double x_max, intersection_callback_t callback,
+                          void *data) {
+  assert((segments || n == 0) && "cannot sweep NULL segments");
+  Sweep sweep = {
+      .stamp = 0,
+      .segs = malloc(sizeof(SweepSegment) * (n ? n : 1)),
+      .probe = {.is_probe = true},
+      .x_min = x_min,
+      .callback = callback,
+      .data = data,
+  };
+  sweep.probe.sweep = &sweep;
+  rb_tree_initc(&sweep.status, status_cmp);
+  pq_initcn(&sweep.events, event_cmp, 2 * n + 1);
+  hash_init(&sweep.reported, pair_hash, NULL);
+
+  Event *endpoints = malloc(sizeof(Event) * (2 * n + 1));
+  for (unsigned i = 0; i < n; ++i) {
+    SweepSegment *seg = &sweep.segs[i];
+    *seg = sweep_segment_new(&sweep, segments[i], i);
+    endpoints[2 * i] = (Event){
+        .p = implicit_point(seg->left), .type = SEGMENT_START, .seg = seg};
+    endpoints[2 * i + 1] = (Event){
+        .p = implicit_point(seg->right), .type = SEGMENT_END, .seg = seg};
+    pq_push(&sweep.events, &endpoints[2 * i]);
+    if (!seg->degenerate) {
+      pq_push(&sweep.events, &endpoints[2 * i + 1]);
+    }
+  }
+
+  Vector group;
+  vector_init(&group);
+  EventScratch scratch;
+  vector_init(&scratch.starting);
+  vector_init(&scratch.through);
+  vector_init(&scratch.inserting);
+  Event *e;
+  while ((e = pq_pop(&sweep.events)) &&
+         implicit_compare_x(&e->p, x_max) < 0) {
+    sweep.p = e->p;
+    group.size = 0;
+    vector_push(&group, e);
+    while (pq_peek(&sweep.events) &&
+           event_cmp(pq_peek(&sweep.events), e) == EQUALS) {
+      Event *next = pq_pop(&sweep.events);
+      // Prefer an endpoint, which is exact and cheaper to compare with
+      if (!next->p.crossing) {
+        sweep.p = next->p;
+      }
+      vector_push(&group, next);
+    }
+    handle_event_point(&sweep, &group, &scratch);
+    for (unsigned i = 0; i < group.size; ++i) {
+      Event *done = group.data[i];
+      if (done->type == CROSSING) {
+        free(done);
+      }
+    }
+  }
+  for (; e; e = pq_pop(&sweep.events)) {
+    if (e->type == CROSSING) {
+      free(e);
+    }
+  }
+  assert((x_max < INFINITY || sweep.status.size == 0) &&
+         "every segment should have ended");
+
+  vector_free(&scratch.inserting);
+  vector_free(&scratch.through);
+  vector_free(&scratch.starting);
+  vector_free(&group);
+  free(endpoints);
+  hash_free(&sweep.reported);
+  pq_free(&sweep.events);
+  rb_tree_free(&sweep.status);
+  free(sweep.segs);
+}
+
+void segment_intersections_sweep(const Segment *segments, unsigned n,
+                                 intersection_callback_t callback, void *data) {
+  sweep_between(segments, n, -INFINITY, INFINITY, callback, data);
+}
+
+// Shamos-Hoey shares the status ordering above, but only has endpoint events.
+// Before the first intersection no two segments swap places, so checking the
+// pairs that become adjacent finds an intersection if there is one.
+
+// Whether two intersecting segments only touch at an endpoint they share
+// exactly, like consecutive edges of a polyline. Collinear segments that share
+// an endpoint and fold back over each other overlap, so they do not count.
+static bool touch_at_shared_endpoint(Segment s0, Segment s1) {
+  Point endpoints0[] = {s0.p0, s0.p1};
+  Point endpoints1[] = {s1.p0, s1.p1};
+  for (unsigned i = 0; i < 2; ++i) {
+    for (unsigned j = 0; j < 2; ++j) {
+      if (endpoints0[i].x != endpoints1[j].x ||
+          endpoints0[i].y != endpoints1[j].y) {
+        continue;
+      }
+      Point d0 = direction(endpoints0[i], endpoints0[1 - i]);
+      Point d1 = direction(endpoints1[j], endpoints1[1 - j]);
+      return cross(d0, d1) != 0 || d0.x * d1.x + d0.y * d1.y <= 0;
+    }
+  }
+  return false;
+}
+
+typedef struct {
+  bool ignore_shared_endpoints;
+  bool found;
+  SegmentIntersection pair;
+} Detection;
+
+// Records the pair if it intersects. Returns whether the search is over.
+static bool detect(Detection *detection, const SweepSegment *s0,
+                   const SweepSegment *s1) {
+  if (!s0 || !s1) {
+    return false;
+  }
+  unsigned a = s0->index < s1->index ? s0->index : s1->index;
+  unsigned b = s0->index < s1->index ? s1->index : s0->index;
+  const SweepSegment *segs = s0->sweep->segs;
+  Segment seg_a = sweep_segment(&segs[a]);
+  Segment seg_b = sweep_segment(&segs[b]);
+  if (!segment_intersects(seg_a, seg_b) ||
+      (detection->ignore_shared_endpoints &&
+       touch_at_shared_endpoint(seg_a, seg_b))) {
+    return false;
+  }
+  detection->found = true;
+  detection->pair = (SegmentIntersection){
+      .a = a,
+      .b = b,
+      .p = segment_intersection_point(seg_a, seg_b),
+  };
+  return true;
+}
+
+// Processes the endpoints at one event point. Segments starting at p are
+// inserted before those ending at p are removed, so that they meet in the
+// status.
+// Returns whether an intersection was found.
+static bool detect_at_event_point(Sweep *sweep, Event **group,
+                                  unsigned group_size, Detection *detection) {
+  const ImplicitPoint *p = &sweep->p;
+  for (unsigned i = 0; i < group_size; ++i) {
+    SweepSegment *s = group[i]->seg;
+    if (group[i]->type != SEGMENT_START || s->degenerate) {
+      continue;
+    }
+    s->node = rb_tree_insert_node(&sweep->status, s);
+    assert(s->node && "segments are never equal in the status");
+    if (detect(detection, node_segment(rb_tree_node_prev(s->node)), s) ||
+        detect(detection, s, node_segment(rb_tree_node_next(s->node)))) {
+      return true;
+    }
+  }
+
+  // Single point segments are not inserted. They hit whatever passes
+  // through p.
+  const SweepSegment *point_segment = NULL;
+  for (unsigned i = 0; i < group_size; ++i) {
+    SweepSegment *s = group[i]->seg;
+    if (group[i]->type != SEGMENT_START || !s->degenerate) {
+      continue;
+    }
+    RedBlackNode *n = rb_tree_upper_bound(&sweep->status, &sweep->probe);
+    for (; n && passes_through(node_segment(n), p); n = rb_tree_node_next(n)) {
+      if (detect(detection, s, node_segment(n))) {
+        return true;
+      }
+    }
+    if (detect(detection, point_segment, s)) {
+      return true;
+    }
+    point_segment = s;
+  }
+
+  for (unsigned i = 0; i < group_size; ++i) {
+    SweepSegment *s = group[i]->seg;
+    if (group[i]->type != SEGMENT_END) {
+      continue;
+    }
+    SweepSegment *below = node_segment(rb_tree_node_prev(s->node));
+    SweepSegment *above = node_segment(rb_tree_node_next(s->node));
+    rb_tree_delete_node(&sweep->status, s->node);
+    s->node = NULL;
+    if (detect(detection, below, above)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool segments_any_intersection(const Segment *segments, unsigned n,
+                               bool ignore_shared_endpoints,
+                               SegmentIntersection *pair) {
+  assert((segments || n == 0) && "cannot sweep NULL segments");
+  Sweep sweep = {
+      .stamp = 0,
+      .segs = malloc(sizeof(SweepSegment) * (n ? n : 1)),
+      .probe = {.is_probe = true},
+  };
+  sweep.probe.sweep = &sweep;
+  rb_tree_initc(&sweep.status, status_cmp);
+
+  // Only endpoints are events, so they can be sorted up front
+  Event *endpoints = malloc(sizeof(Event) * (2 * n + 1));
+  Event **events = malloc(sizeof(Event *) * (2 * n + 1));
+  unsigned num_events = 0;
+  for (unsigned i = 0; i < n; ++i) {
+    SweepSegment *seg = &sweep.segs[i];
+    *seg = sweep_segment_new(&sweep, segments[i], i);
+    endpoints[2 * i] = (Event){
+        .p = implicit_point(seg->left), .type = SEGMENT_START, .seg = seg};
+    endpoints[2 * i + 1] = (Event){
+        .p = implicit_point(seg->right), .type = SEGMENT_END, .seg = seg};
+    events[num_events++] = &endpoints[2 * i];
+    if (!seg->degenerate) {
+      events[num_events++] = &endpoints[2 * i + 1];
+    }
+  }
+  tim_sortc((void **)events, num_events, event_cmp);
+
+  Detection detection = {
+      .ignore_shared_endpoints = ignore_shared_endpoints,
+      .found = false,
+  };
+  for (unsigned i = 0; i < num_events && !detection.found;) {
+    unsigned group_end = i + 1;
+    while (group_end < num_events &&
+           event_cmp(events[group_end], events[i]) == EQUALS) {
+      ++group_end;
+    }
+    sweep.p = events[i]->p;
+    ++sweep.stamp;
+    detect_at_event_point(&sweep, &events[i], group_end - i, &detection);
+    i = group_end;
+  }
+
+  free(events);
+  free(endpoints);
+  rb_tree_free(&sweep.status);
+  free(sweep.segs);
+  if (detection.found && pair) {
+    *pair = detection.pair;
+  }
+  return detection.found;
+}
+
+typedef struct {
+  SegmentIntersection *data;
+  unsigned size;
+  unsigned capacity;
+} IntersectionList;
+
+static void collect(SegmentIntersection intersection, void *data) {
+  IntersectionList *list = data;
+  if (list->size == list->capacity) {
+    list->capacity = list->capacity ? list->capacity * 2 : 16;
+    list->data =
+        realloc(list->data, sizeof(SegmentIntersection) * list->capacity);
+  }
+  list->data[list->size++] = intersection;
+}
+
+SegmentIntersection *segment_intersections(const Segment *segments, unsigned n,
+                                           unsigned *count) {
+  IntersectionList list = {.data = NULL, .size = 0, .capacity = 0};
+  segment_intersections_sweep(segments, n, collect, &list);
+  *count = list.size;
+  return list.data;
+}
+
+SegmentIntersection *segment_intersections_brute_force(const Segment *segments,
+                                                       unsigned n,
+                                                       unsigned *count) {
+  IntersectionList list = {.data = NULL, .size = 0, .capacity = 0};
+  for (unsigned i = 0; i < n; ++i) {
+    for (unsigned j = i + 1; j < n; ++j) {
+      if (segment_intersects(segments[i], segments[j])) {
+        collect(
+            (SegmentIntersection){
+                .a = i,
+                .b = j,
+                .p = segment_intersection_point(segments[i], segments[j]),
+            },
+            &list);
+      }
+    }
+  }
+  *count = list.size;
+  return list.data;
+}
+
+// Parallel version. The plane is cut into vertical strips at quantiles of the
+// segments' left x coordinates, so strips start with similar numbers of
+// segments. Each strip holds copies of every segment overlapping it, and is
+// swept on its own thread up to its right edge, keeping the pairs reported at
+// event points inside it. Both segments of a pair pass through its event
+// point, so the strip containing that point holds both of them.
+
+typedef struct {
+  double lo;
+  double hi;
+  Segment *segments;
+  // Index of each strip segment in the input
+  unsigned *indices;
+  unsigned n;
+  IntersectionList found;
+} Strip;
+
+static void strip_collect(SegmentIntersection intersection, void *data) {
+  Strip *strip = data;
+  // Strip segments are in input order, so a < b still holds
+  intersection.a = strip->indices[intersection.a];
+  intersection.b = strip->indices[intersection.b];
+  collect(intersection, &strip->found);
+}
+
+static void *strip_sweep(void *data) {
+  Strip *strip = data;
+  sweep_between(strip->segments, strip->n, strip->lo, strip->hi,
+                strip_collect, strip);
+  return NULL;
+}
+
+static Ordering double_cmp(void *a, void *b) {
+  double x = *(double *)a;
+  double y = *(double *)b;
+  return x < y ? LESS : x > y ? GREATER : EQUALS;
+}
+
+// Fills in the strip boundaries, with strips[0].lo = -inf and
+// strips[num_strips - 1].hi = inf.
+static void strip_bounds(const Segment *segments, unsigned n, Strip *strips,
+                         unsigned num_strips) {
+  double *xs = malloc(sizeof(double) * (n ? n : 1));
+  void **order = malloc(sizeof(void *) * (n ? n : 1));
+  for (unsigned i = 0; i < n; ++i) {
+    xs[i] = fmin(segments[i].p0.x, segments[i].p1.x);
+    order[i] = &xs[i];
+  }
+  strips[0].lo = -INFINITY;
+  strips[num_strips - 1].hi = INFINITY;
+  unsigned prev_k = 0;
+  for (unsigned i = 1; i < num_strips; ++i) {
+    unsigned k = (unsigned)((unsigned long)n * i / num_strips);
+    double bound = -INFINITY;
+    if (k < n) {
+      // Everything before prev_k is already below the remaining quantiles
+      nth_elementc(order + prev_k, n - prev_k, k - prev_k, double_cmp);
+      bound = *(double *)order[k];
+      prev_k = k;
+    }
+    strips[i - 1].hi = bound;
+    strips[i].lo = bound;
+  }
+  free(order);
+  free(xs);
+}
+
+SegmentIntersection *segment_intersections_parallel(const Segment *segments,
+                                                    unsigned n,
+                                                    unsigned num_threads,
+                                                    unsigned *count) {
+  assert((segments || n == 0) && "cannot sweep NULL segments");
+  assert(num_threads > 0 && "need at least one thread");
+  Strip *strips = malloc(sizeof(Strip) * num_threads);
+  strip_bounds(segments, n, strips, num_threads);
+
+  for (unsigned t = 0; t < num_threads; ++t) {
+    Strip *strip = &strips[t];
+    strip->n = 0;
+    strip->found = (IntersectionList){.data = NULL, .size = 0, .capacity = 0};
+    unsigned capacity = 16;
+    strip->segments = malloc(sizeof(Segment) * capacity);
+    strip->indices = malloc(sizeof(unsigned) * capacity);
+    if (strip->lo >= strip->hi) {
+      // Empty strip from repeated quantiles
+      continue;
+    }
+    for (unsigned i = 0; i < n; ++i) {
+      Segment s = segments[i];
+      if (fmax(s.p0.x, s.p1.x) < strip->lo ||
+          fmin(s.p0.x, s.p1.x) > strip->hi) {
+        continue;
+      }
+      if (strip->n == capacity) {
+        capacity *= 2;
+        strip->segments = realloc(strip->segments, sizeof(Segment) * capacity);
+        strip->indices = realloc(strip->indices, sizeof(unsigned) * capacity);
+      }
+      strip->segments[strip->n] = s;
+      strip->indices[strip->n] = i;
+      ++strip->n;
+    }
+  }
+
+  parallel_for(num_threads, strip_sweep, strips, sizeof(Strip));
+
+  IntersectionList list = {.data = NULL, .size = 0, .capacity = 0};
+  for (unsigned t = 0; t < num_threads; ++t) {
+    Strip *strip = &strips[t];
+    for (unsigned i = 0; i < strip->found.size; ++i) {
+      collect(strip->found.data[i], &list);
+    }
+    free(strip->found.data);
+    free(strip->indices);
+    free(strip->segments);
+  }
+  free(strips);
+  *count = list.size;
+  return list.data;
+}
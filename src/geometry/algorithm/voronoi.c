@@ -0,0 +1,815 @@
+// Voronoi diagrams with Fortune's sweep.
+//
+// A horizontal line sweeps upwards over the sites. The beach line is the
+// boundary of the part of the plane that is closer to a site below the sweep
+// line than to the line itself. It is a sequence of parabolic arcs, one or
+// more per site, kept left to right in a RedBlackTree. The breakpoints between
+// adjacent arcs trace out the Voronoi edges as the sweep moves.
+//
+// A site event splits the arc above the new site and inserts an arc for it,
+// which starts a new edge. When three adjacent arcs belong to sites whose
+// circle the breakpoints converge on, the middle arc shrinks to nothing once
+// the sweep reaches the top of that circle. That circle event ends two edges
+// at the circle's center, a Voronoi vertex, and starts one. Circle events are
+// kept in a PriorityQueue. The queue cannot remove events, so when an arc's
+// neighbors change its event is marked invalid and skipped when it comes up.
+// Sites are sorted up front and merged with the queue, which then only holds
+// circle events.
+//
+// The edges are then clipped to the box and linked into a half-edge structure
+// around each cell, closing cells that meet the box boundary with half-edges
+// along it.
+#include "geometry/algorithm/voronoi.h"
+#include "data_structure/priority_queue.h"
+#include "data_structure/red_black_tree.h"
+#include "data_structure/sort.h"
+#include "data_structure/vector.h"
+#include "geometry/predicates.h"
+#include <assert.h>
+#include <limits.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+static const unsigned EVENT_BLOCK_SIZE = 1024;
+
+typedef struct Arc Arc;
+
+typedef struct CircleEvent {
+  Point center;
+  // Certainly below the top of the circle, the sweep position at which the
+  // arc vanishes
+  double below;
+  // NULL once invalidated
+  Arc *arc;
+  struct CircleEvent *next_free;
+} CircleEvent;
+
+struct Arc {
+  unsigned site;
+  // Slot in ends of the edge end traced by the breakpoint with next
+  unsigned right_end;
+  Arc *prev;
+  Arc *next;
+  RedBlackNode *node;
+  CircleEvent *event;
+};
+
+// Sites are numbered by their position in sweep order, and the arcs of the
+// beach line at any time belong to sites close together in it.
+typedef struct {
+  const Point *sites;
+  unsigned num_sites;
+  // Index of the next site the sweep reaches
+  unsigned next_site;
+  RedBlackTree beach;
+  PriorityQueue events;
+  Vector blocks;
+  unsigned block_used;
+  CircleEvent *free_events;
+  Arc *arcs;
+  unsigned num_arcs;
+  Point *vertices;
+  unsigned num_vertices;
+  // Edge i has site edge_sites[2i] on its left going from vertex ends[2i] to
+  // ends[2i + 1], and site edge_sites[2i + 1] on its right. Ends the sweep
+  // never reaches are UINT_MAX, and are at infinity.
+  unsigned *edge_sites;
+  unsigned *ends;
+  unsigned num_edges;
+} Fortune;
+
+// What the beach line is searched for: the arc above a new site.
+typedef struct {
+  const Fortune *f;
+  Point p;
+} Probe;
+
+// Whether p on the sweep line is left of the breakpoint between the arcs of a
+// on the left and b on the right. Left of it the arc of a is the higher one,
+// which tangent_circle_compare decides exactly. The parabolas of sites at
+// different heights cross twice, on either side of the narrower one's focus,
+// and the breakpoint is the crossing on the side of the other arc. A site on
+// the sweep line has a vertical ray for an arc. A p exactly on the breakpoint
+// counts as right of it.
+static bool left_of_breakpoint(Point a, Point b, Point p) {
+  if (a.y == p.y) {
+    return p.x < a.x;
+  }
+  if (b.y == p.y) {
+    return p.x < b.x;
+  }
+  bool a_higher = tangent_circle_compare(a, b, p) < 0;
+  if (a.y > b.y) {
+    return p.x < a.x || a_higher;
+  }
+  if (a.y < b.y) {
+    return p.x < b.x && a_higher;
+  }
+  return a_higher;
+}
+
+// Orders a probe before the first arc whose left breakpoint is right of it.
+// Only used by rb_tree_upper_bound, which always passes the probe first.
+static Ordering beach_cmp(void *probe, void *arc) {
+  const Probe *p = probe;
+  const Arc *a = arc;
+  if (!a->prev) {
+    return GREATER;
+  }
+  const Point *sites = p->f->sites;
+  return left_of_breakpoint(sites[a->prev->site], sites[a->site], p->p)
+             ? LESS
+             : GREATER;
+}
+
+static Ordering event_cmp(void *a, void *b) {
+  const CircleEvent *e0 = a;
+  const CircleEvent *e1 = b;
+  if (e0->below != e1->below) {
+    return e0->below < e1->below ? LESS : GREATER;
+  }
+  if (e0->center.x != e1->center.x) {
+    return e0->center.x < e1->center.x ? LESS : GREATER;
+  }
+  return EQUALS;
+}
+
+static Arc *new_arc(Fortune *f, unsigned site) {
+  Arc *arc = &f->arcs[f->num_arcs++];
+  *arc = (Arc){.site = site, .right_end = UINT_MAX};
+  return arc;
+}
+
+static unsigned new_edge(Fortune *f, unsigned left, unsigned right) {
+  unsigned e = f->num_edges++;
+  f->edge_sites[2 * e] = left;
+  f->edge_sites[2 * e + 1] = right;
+  f->ends[2 * e] = UINT_MAX;
+  f->ends[2 * e + 1] = UINT_MAX;
+  return e;
+}
+
+static CircleEvent *new_event(Fortune *f) {
+  if (f->free_events) {
+    CircleEvent *e = f->free_events;
+    f->free_events = e->next_free;
+    return e;
+  }
+  if (f->blocks.size == 0 || f->block_used == EVENT_BLOCK_SIZE) {
+    vector_push(&f->blocks, malloc(sizeof(CircleEvent) * EVENT_BLOCK_SIZE));
+    f->block_used = 0;
+  }
+  return (CircleEvent *)f->blocks.data[f->blocks.size - 1] + f->block_used++;
+}
+
+static void recycle_event(Fortune *f, CircleEvent *e) {
+  e->next_free = f->free_events;
+  f->free_events = e;
+}
+
+static void invalidate(Arc *arc) {
+  if (arc->event) {
+    arc->event->arc = NULL;
+    arc->event = NULL;
+  }
+}
+
+// Queues the circle event of arc if its breakpoints converge, which is when
+// its site and its neighbors' sites are counterclockwise. The center is found
+// relative to the site opposite the longest side, so that two sites close
+// together do not cancel out against a third far away, and with the
+// orientation of the same differences, as orient2d only gets its sign exact.
+// Events are ordered by a bound below the top that circle_top_compare
+// confirms, so that the sweep can tell when an event might come before a site.
+static void check_circle(Fortune *f, Arc *arc) {
+  Arc *l = arc->prev;
+  Arc *r = arc->next;
+  if (!l || !r || l->site == r->site) {
+    return;
+  }
+  Point p[3] = {f->sites[l->site], f->sites[arc->site], f->sites[r->site]};
+  double o = orient2d(p[0], p[1], p[2]);
+  if (o <= 0) {
+    return;
+  }
+  unsigned k = 0;
+  double longest = 0;
+  for (unsigned i = 0; i < 3; ++i) {
+    Point q0 = p[(i + 1) % 3];
+    Point q1 = p[(i + 2) % 3];
+    double d = (q1.x - q0.x) * (q1.x - q0.x) + (q1.y - q0.y) * (q1.y - q0.y);
+    if (d > longest) {
+      k = i;
+      longest = d;
+    }
+  }
+  Point a = p[k];
+  Point b = p[(k + 1) % 3];
+  Point c = p[(k + 2) % 3];
+  double bx = b.x - a.x;
+  double by = b.y - a.y;
+  double cx = c.x - a.x;
+  double cy = c.y - a.y;
+  double b2 = bx * bx + by * by;
+  double c2 = cx * cx + cy * cy;
+  double det = bx * cy - by * cx;
+  if (det <= 0) {
+    det = o;
+  }
+  double ux = (cy * b2 - by * c2) / (2 * det);
+  double uy = (bx * c2 - cx * b2) / (2 * det);
+  // The top is uy + r above a, which cancels for a center far below
+  double radius = sqrt(ux * ux + uy * uy);
+  double top = uy >= 0 ? uy + radius : ux * ux / (radius - uy);
+  // Far more than rounding is off by, but for a degenerate triangle
+  double margin = 0x1p-40 * (fabs(a.y) + fabs(uy) + radius);
+  double below = a.y + top - margin;
+  if (!(circle_top_compare(p[0], p[1], p[2], below) > 0)) {
+    below = -INFINITY;
+  }
+  CircleEvent *e = new_event(f);
+  *e = (CircleEvent){
+      .center = {.x = a.x + ux, .y = a.y + uy},
+      .below = below,
+      .arc = arc,
+  };
+  arc->event = e;
+  pq_push(&f->events, e);
+}
+
+static void site_event(Fortune *f, unsigned site, double first_y) {
+  Point p = f->sites[site];
+  Arc *arc = new_arc(f, site);
+  if (!f->beach.root) {
+    arc->node = rb_tree_insert_after(&f->beach, NULL, arc);
+    return;
+  }
+  if (p.y == first_y) {
+    // Every site so far is on the sweep line, so their arcs are vertical rays
+    // in x order, and the new one goes last
+    Arc *last = rb_tree_node_val(rb_tree_last_node(&f->beach));
+    last->right_end = 2 * new_edge(f, last->site, site) + 1;
+    last->next = arc;
+    arc->prev = last;
+    arc->node = rb_tree_insert_after(&f->beach, last->node, arc);
+    return;
+  }
+
+  Probe probe = {.f = f, .p = p};
+  RedBlackNode *after = rb_tree_upper_bound(&f->beach, &probe);
+  Arc *above = after ? ((Arc *)rb_tree_node_val(after))->prev
+                     : rb_tree_node_val(rb_tree_last_node(&f->beach));
+  invalidate(above);
+
+  // above splits into itself on the left and right on the right, with the
+  // new arc in between. Both breakpoints trace the new edge.
+  Arc *right = new_arc(f, above->site);
+  unsigned e = new_edge(f, above->site, site);
+  right->right_end = above->right_end;
+  above->right_end = 2 * e + 1;
+  arc->right_end = 2 * e;
+  right->next = above->next;
+  if (right->next) {
+    right->next->prev = right;
+  }
+  right->prev = arc;
+  arc->next = right;
+  arc->prev = above;
+  above->next = arc;
+  arc->node = rb_tree_insert_after(&f->beach, above->node, arc);
+  right->node = rb_tree_insert_after(&f->beach, arc->node, right);
+  check_circle(f, above);
+  check_circle(f, right);
+}
+
+static void circle_event(Fortune *f, CircleEvent *e) {
+  Arc *arc = e->arc;
+  Arc *l = arc->prev;
+  Arc *r = arc->next;
+  unsigned v = f->num_vertices++;
+  f->vertices[v] = e->center;
+  f->ends[l->right_end] = v;
+  f->ends[arc->right_end] = v;
+  unsigned edge = new_edge(f, l->site, r->site);
+  f->ends[2 * edge] = v;
+  l->right_end = 2 * edge + 1;
+  l->next = r;
+  r->prev = l;
+  rb_tree_delete_node(&f->beach, arc->node);
+  arc->event = NULL;
+  invalidate(l);
+  invalidate(r);
+  check_circle(f, l);
+  check_circle(f, r);
+}
+
+// Sorts the sites by y, then x, and drops duplicates after the first.
+// Returns the number left.
+static unsigned sweep_order(const Point *sites, unsigned n, unsigned *order) {
+  uint64_t *keys = malloc(sizeof(uint64_t) * n);
+  for (unsigned i = 0; i < n; ++i) {
+    keys[i] = double_sort_key(sites[i].x);
+    order[i] = i;
+  }
+  radix_sort_keys(keys, order, n, 1);
+  // Stable, so equal y stay sorted by x
+  for (unsigned i = 0; i < n; ++i) {
+    keys[i] = double_sort_key(sites[order[i]].y);
+  }
+  radix_sort_keys(keys, order, n, 1);
+  free(keys);
+  unsigned m = 0;
+  for (unsigned i = 0; i < n; ++i) {
+    Point p = sites[order[i]];
+    if (m == 0 || p.x != sites[order[m - 1]].x ||
+        p.y != sites[order[m - 1]].y) {
+      order[m++] = order[i];
+    }
+  }
+  return m;
+}
+
+// Sites go first while they are below every event. Otherwise the first event
+// is compared with the next site exactly, as an arc left past its event would
+// be found by the site, and one removed too early would not. An event that
+// turns out to be above the site waits for it, while events after it in the
+// queue are tried, since their tops may still be lower.
+static void sweep(Fortune *f) {
+  double first_y = f->sites[0].y;
+  Vector waiting;
+  vector_init(&waiting);
+  for (;;) {
+    CircleEvent *top = pq_peek(&f->events);
+    if (top && !top->arc) {
+      recycle_event(f, pq_pop(&f->events));
+      continue;
+    }
+    if (f->next_site == f->num_sites && !top) {
+      break;
+    }
+    if (f->next_site == f->num_sites ||
+        (top && top->below <= f->sites[f->next_site].y &&
+         circle_top_compare(f->sites[top->arc->prev->site],
+                            f->sites[top->arc->site],
+                            f->sites[top->arc->next->site],
+                            f->sites[f->next_site].y) <= 0)) {
+      pq_pop(&f->events);
+      circle_event(f, top);
+      recycle_event(f, top);
+    } else if (!top || f->sites[f->next_site].y < top->below) {
+      unsigned site = f->next_site++;
+      site_event(f, site, first_y);
+      while (waiting.size > 0) {
+        pq_push(&f->events, vector_pop_back(&waiting));
+      }
+    } else {
+      vector_push(&waiting, pq_pop(&f->events));
+    }
+  }
+  vector_free(&waiting);
+}
+
+// The half-edge structure under construction.
+typedef struct {
+  BBox box;
+  Point *vertices;
+  unsigned num_vertices;
+  VoronoiHalfEdge *edges;
+  unsigned num_edges;
+  unsigned edges_capacity;
+  unsigned corners[4];
+} Builder;
+
+static unsigned add_vertex(Builder *b, Point p) {
+  b->vertices[b->num_vertices] = p;
+  return b->num_vertices++;
+}
+
+static unsigned add_half_edge(Builder *b, unsigned origin, unsigned twin,
+                              unsigned site) {
+  if (b->num_edges == b->edges_capacity) {
+    b->edges_capacity *= 2;
+    b->edges =
+        realloc(b->edges, sizeof(VoronoiHalfEdge) * b->edges_capacity);
+  }
+  b->edges[b->num_edges] = (VoronoiHalfEdge){
+      .origin = origin,
+      .twin = twin,
+      .next = UINT_MAX,
+      .site = site,
+  };
+  return b->num_edges++;
+}
+
+// Clips edge e of the sweep to the box with Liang-Barsky. Writes the vertices
+// of the clipped ends, adding vertices on the box where it was cut, and
+// returns false if nothing of the edge is inside. The edge is on the bisector
+// of its sites, parametrized from their midpoint, since nearly collinear sites
+// give vertices so far away that points between them and a vertex in the box
+// would lose all precision.
+static bool clip_edge(const Fortune *f, Builder *b, unsigned e,
+                      unsigned *from, unsigned *to) {
+  unsigned v0 = f->ends[2 * e];
+  unsigned v1 = f->ends[2 * e + 1];
+  if (v0 != UINT_MAX && v1 != UINT_MAX &&
+      bbox_contains_point(b->box, b->vertices[v0]) &&
+      bbox_contains_point(b->box, b->vertices[v1])) {
+    *from = v0;
+    *to = v1;
+    return true;
+  }
+  Point s0 = f->sites[f->edge_sites[2 * e]];
+  Point s1 = f->sites[f->edge_sites[2 * e + 1]];
+  // The edge runs along d, with s0 on the left
+  Point d = {.x = s0.y - s1.y, .y = s1.x - s0.x};
+  Point base = {.x = (s0.x + s1.x) / 2, .y = (s0.y + s1.y) / 2};
+  double length = d.x * d.x + d.y * d.y;
+  double t0 = -INFINITY;
+  double t1 = INFINITY;
+  if (v0 != UINT_MAX) {
+    Point v = b->vertices[v0];
+    t0 = ((v.x - base.x) * d.x + (v.y - base.y) * d.y) / length;
+  }
+  if (v1 != UINT_MAX) {
+    Point v = b->vertices[v1];
+    t1 = ((v.x - base.x) * d.x + (v.y - base.y) * d.y) / length;
+  }
+
+  // Constraints p * t <= q for the left, right, bottom and top sides
+  BBox box = b->box;
+  double p[4] = {-d.x, d.x, -d.y, d.y};
+  double q[4] = {base.x - box.min_x, box.max_x - base.x, base.y - box.min_y,
+                 box.max_y - base.y};
+  int side0 = -1;
+  int side1 = -1;
+  for (int k = 0; k < 4; ++k) {
+    if (p[k] == 0) {
+      if (q[k] < 0) {
+        return false;
+      }
+      continue;
+    }
+    double r = q[k] / p[k];
+    if (p[k] < 0 && r > t0) {
+      t0 = r;
+      side0 = k;
+    } else if (p[k] > 0 && r < t1) {
+      t1 = r;
+      side1 = k;
+    }
+  }
+  if (t0 >= t1) {
+    return false;
+  }
+
+  int sides[2] = {side0, side1};
+  double ts[2] = {t0, t1};
+  unsigned originals[2] = {v0, v1};
+  unsigned *out[2] = {from, to};
+  Point ends[2];
+  for (unsigned i = 0; i < 2; ++i) {
+    if (sides[i] < 0) {
+      ends[i] = b->vertices[originals[i]];
+      continue;
+    }
+    Point c = {.x = base.x + ts[i] * d.x, .y = base.y + ts[i] * d.y};
+    c.x = bbox_min(bbox_max(c.x, box.min_x), box.max_x);
+    c.y = bbox_min(bbox_max(c.y, box.min_y), box.max_y);
+    double snapped[4] = {box.min_x, box.max_x, box.min_y, box.max_y};
+    if (sides[i] < 2) {
+      c.x = snapped[sides[i]];
+    } else {
+      c.y = snapped[sides[i]];
+    }
+    ends[i] = c;
+  }
+  // An edge through a corner of the box, or within rounding of one, only
+  // touches it
+  if (ends[0].x == ends[1].x && ends[0].y == ends[1].y) {
+    return false;
+  }
+  for (unsigned i = 0; i < 2; ++i) {
+    *out[i] = sides[i] < 0 ? originals[i] : add_vertex(b, ends[i]);
+  }
+  return true;
+}
+
+// Distance of p counterclockwise along the box boundary from the bottom left
+// corner, measured on the side p is closest to.
+static double perimeter_position(BBox box, Point p) {
+  double w = box.max_x - box.min_x;
+  double h = box.max_y - box.min_y;
+  double d[4] = {fabs(p.y - box.min_y), fabs(box.max_x - p.x),
+                 fabs(box.max_y - p.y), fabs(p.x - box.min_x)};
+  unsigned side = 0;
+  for (unsigned k = 1; k < 4; ++k) {
+    side = d[k] < d[side] ? k : side;
+  }
+  double along[4] = {p.x - box.min_x, w + p.y - box.min_y,
+                     w + h + box.max_x - p.x, 2 * w + h + box.max_y - p.y};
+  return along[side];
+}
+
+static unsigned corner_vertex(Builder *b, unsigned k) {
+  if (b->corners[k] == UINT_MAX) {
+    BBox box = b->box;
+    Point corners[4] = {{box.min_x, box.min_y},
+                        {box.max_x, box.min_y},
+                        {box.max_x, box.max_y},
+                        {box.min_x, box.max_y}};
+    b->corners[k] = add_vertex(b, corners[k]);
+  }
+  return b->corners[k];
+}
+
+// Links half-edge from, which ends on the box, to half-edge to, which starts
+// on it, with half-edges along the box through the corners in between.
+static void close_along_box(Builder *b, unsigned from, unsigned to,
+                            unsigned site) {
+  BBox box = b->box;
+  double w = box.max_x - box.min_x;
+  double h = box.max_y - box.min_y;
+  double perimeter = 2 * (w + h);
+  double corners[4] = {0, w, w + h, 2 * w + h};
+  unsigned start = b->edges[b->edges[from].twin].origin;
+  double pos = perimeter_position(box, b->vertices[start]);
+  double dist = perimeter_position(box, b->vertices[b->edges[to].origin]) - pos;
+  if (dist < 0) {
+    dist += perimeter;
+  }
+  unsigned first = 0;
+  while (first < 4 && corners[first] <= pos) {
+    ++first;
+  }
+  unsigned prev = from;
+  unsigned current = start;
+  for (unsigned step = 0; step < 4; ++step) {
+    unsigned k = (first + step) % 4;
+    double offset = corners[k] - pos;
+    if (offset <= 0) {
+      offset += perimeter;
+    }
+    if (offset >= dist) {
+      break;
+    }
+    unsigned edge = add_half_edge(b, current, UINT_MAX, site);
+    b->edges[prev].next = edge;
+    prev = edge;
+    current = corner_vertex(b, k);
+  }
+  unsigned edge = add_half_edge(b, current, UINT_MAX, site);
+  b->edges[prev].next = edge;
+  b->edges[edge].next = to;
+}
+
+// A half-edge of a cell with the sites on either side of it, which give its
+// direction even when it has no length.
+typedef struct {
+  Point site;
+  Point neighbor;
+  unsigned edge;
+} Spoke;
+
+// Orders spokes of a cell counterclockwise by the direction from the site to
+// the neighbor, starting from the positive x axis. The half-edge runs along
+// that direction turned a quarter counterclockwise, so this is also the order
+// of the half-edges around the convex cell.
+static Ordering spoke_cmp(void *a, void *b) {
+  const Spoke *s = a;
+  const Spoke *t = b;
+  bool s_lower = s->neighbor.y < s->site.y ||
+                 (s->neighbor.y == s->site.y && s->neighbor.x < s->site.x);
+  bool t_lower = t->neighbor.y < t->site.y ||
+                 (t->neighbor.y == t->site.y && t->neighbor.x < t->site.x);
+  if (s_lower != t_lower) {
+    return s_lower ? GREATER : LESS;
+  }
+  double o = orient2d(s->site, s->neighbor, t->neighbor);
+  return o > 0 ? LESS : o < 0 ? GREATER : EQUALS;
+}
+
+// Links the half-edges of each cell into a cycle. Each vertex inside the box
+// starts one half-edge of each of its cells, which follows the one of the same
+// cell ending there. Where that leaves a half-edge without a next one, the
+// cell leaves the box, and its half-edges are linked in the order of their
+// directions instead, with the cycle continuing along the box between ones
+// that do not share a vertex. Going by direction links every half-edge exactly
+// once, however rounding places the points where the cell crosses the box.
+static void link_cells(Builder *b, const Point *sites, unsigned num_sites,
+                       unsigned *cells) {
+  unsigned num_voronoi = b->num_edges;
+  unsigned *starts = calloc(num_sites + 1, sizeof(unsigned));
+  for (unsigned i = 0; i < num_voronoi; ++i) {
+    ++starts[b->edges[i].site + 1];
+  }
+  unsigned largest = 0;
+  for (unsigned s = 0; s < num_sites; ++s) {
+    largest = starts[s + 1] > largest ? starts[s + 1] : largest;
+    starts[s + 1] += starts[s];
+  }
+  unsigned *by_cell = malloc(sizeof(unsigned) * (num_voronoi + 1));
+  unsigned *fill = malloc(sizeof(unsigned) * (num_sites + 1));
+  for (unsigned s = 0; s <= num_sites; ++s) {
+    fill[s] = starts[s];
+  }
+  for (unsigned i = 0; i < num_voronoi; ++i) {
+    by_cell[fill[b->edges[i].site]++] = i;
+  }
+  free(fill);
+
+  // Per vertex, the half-edge of the current cell starting there
+  unsigned *starting = malloc(sizeof(unsigned) * (b->num_vertices + 1));
+  for (unsigned v = 0; v <= b->num_vertices; ++v) {
+    starting[v] = UINT_MAX;
+  }
+  // The spokes of one cell at a time
+  Spoke *spokes = malloc(sizeof(Spoke) * (largest + 1));
+  void **sorted = malloc(sizeof(void *) * (largest + 1));
+  for (unsigned s = 0; s < num_sites; ++s) {
+    unsigned lo = starts[s];
+    unsigned n = starts[s + 1] - lo;
+    if (n == 0) {
+      cells[s] = UINT_MAX;
+      continue;
+    }
+    cells[s] = by_cell[lo];
+    for (unsigned k = lo; k < lo + n; ++k) {
+      starting[b->edges[by_cell[k]].origin] = by_cell[k];
+    }
+    bool linked = true;
+    for (unsigned k = lo; k < lo + n && linked; ++k) {
+      unsigned edge = by_cell[k];
+      unsigned next = starting[b->edges[b->edges[edge].twin].origin];
+      linked = next != UINT_MAX && b->edges[next].site == s;
+      b->edges[edge].next = next;
+    }
+    if (linked) {
+      continue;
+    }
+
+    for (unsigned k = 0; k < n; ++k) {
+      unsigned edge = by_cell[lo + k];
+      spokes[k] = (Spoke){
+          .site = sites[s],
+          .neighbor = sites[b->edges[b->edges[edge].twin].site],
+          .edge = edge,
+      };
+      sorted[k] = &spokes[k];
+    }
+    tim_sortc(sorted, n, spoke_cmp);
+    cells[s] = ((Spoke *)sorted[0])->edge;
+    for (unsigned k = 0; k < n; ++k) {
+      unsigned edge = ((Spoke *)sorted[k])->edge;
+      unsigned next = ((Spoke *)sorted[k + 1 < n ? k + 1 : 0])->edge;
+      unsigned end = b->edges[b->edges[edge].twin].origin;
+      if (end == b->edges[next].origin) {
+        b->edges[edge].next = next;
+      } else {
+        close_along_box(b, edge, next, s);
+      }
+    }
+  }
+  free(sorted);
+  free(spokes);
+  free(starting);
+  free(by_cell);
+  free(starts);
+}
+
+void voronoi_diagram(const Point *sites, unsigned n, BBox box,
+                     VoronoiDiagram *out) {
+  assert((sites || n == 0) && "cannot compute the diagram of NULL sites");
+  assert(box.min_x < box.max_x && box.min_y < box.max_y &&
+         "box should have a positive area");
+  assert(out && "out should not be null");
+  *out = (VoronoiDiagram){
+      .cells = malloc(sizeof(unsigned) * (n ? n : 1)),
+      .num_sites = n,
+  };
+  for (unsigned i = 0; i < n; ++i) {
+    out->cells[i] = UINT_MAX;
+  }
+  if (n == 0) {
+    return;
+  }
+
+  unsigned *order = malloc(sizeof(unsigned) * n);
+  unsigned m = sweep_order(sites, n, order);
+  Point *sorted = malloc(sizeof(Point) * m);
+  for (unsigned i = 0; i < m; ++i) {
+    sorted[i] = sites[order[i]];
+  }
+  // Each site adds at most two arcs, each vanishing arc a vertex, and each
+  // event an edge
+  Fortune f = {
+      .sites = sorted,
+      .num_sites = m,
+      .arcs = malloc(sizeof(Arc) * 2 * m),
+      .vertices = malloc(sizeof(Point) * 2 * m),
+      .edge_sites = malloc(sizeof(unsigned) * 6 * m),
+      .ends = malloc(sizeof(unsigned) * 6 * m),
+  };
+  rb_tree_initc(&f.beach, beach_cmp);
+  pq_initcn(&f.events, event_cmp, m);
+  vector_init(&f.blocks);
+  sweep(&f);
+
+  // Clipping adds up to two vertices per edge, and closing cells the corners
+  Builder b = {
+      .box = box,
+      .vertices =
+          realloc(f.vertices, sizeof(Point) * (f.num_vertices +
+                                               2 * f.num_edges + 4)),
+      .num_vertices = f.num_vertices,
+      .edges = malloc(sizeof(VoronoiHalfEdge) * (2 * f.num_edges + 8)),
+      .edges_capacity = 2 * f.num_edges + 8,
+      .corners = {UINT_MAX, UINT_MAX, UINT_MAX, UINT_MAX},
+  };
+  for (unsigned e = 0; e < f.num_edges; ++e) {
+    unsigned from, to;
+    if (clip_edge(&f, &b, e, &from, &to)) {
+      unsigned h = b.num_edges;
+      add_half_edge(&b, from, h + 1, order[f.edge_sites[2 * e]]);
+      add_half_edge(&b, to, h, order[f.edge_sites[2 * e + 1]]);
+    }
+  }
+  if (b.num_edges > 0) {
+    link_cells(&b, sites, n, out->cells);
+  } else {
+    // The box is inside a single cell, the one of the site closest to it
+    Point center = {(box.min_x + box.max_x) / 2, (box.min_y + box.max_y) / 2};
+    unsigned closest = order[0];
+    for (unsigned i = 1; i < m; ++i) {
+      double d = point_distance(sites[order[i]], center);
+      double best = point_distance(sites[closest], center);
+      if (d < best || (d == best && order[i] < closest)) {
+        closest = order[i];
+      }
+    }
+    for (unsigned k = 0; k < 4; ++k) {
+      add_half_edge(&b, corner_vertex(&b, k), UINT_MAX, closest);
+    }
+    for (unsigned k = 0; k < 4; ++k) {
+      b.edges[k].next = (k + 1) % 4;
+    }
+    out->cells[closest] = 0;
+  }
+
+  out->vertices = b.vertices;
+  out->num_vertices = b.num_vertices;
+  out->edges = b.edges;
+  out->num_edges = b.num_edges;
+
+  pq_free(&f.events);
+  for (unsigned i = 0; i < f.blocks.size; ++i) {
+    free(f.blocks.data[i]);
+  }
+  vector_free(&f.blocks);
+  rb_tree_free(&f.beach);
+  free(f.ends);
+  free(f.edge_sites);
+  free(f.arcs);
+  free(sorted);
+  free(order);
+}
+
+void voronoi_diagram_free(VoronoiDiagram *diagram) {
+  free(diagram->vertices);
+  free(diagram->edges);
+  free(diagram->cells);
+  *diagram = (VoronoiDiagram){0};
+}
+
+void voronoi_diagram_validate(const VoronoiDiagram *diagram) {
+  assert(diagram && "diagram should not be null");
+  for (unsigned i = 0; i < diagram->num_edges; ++i) {
+    const VoronoiHalfEdge *e = &diagram->edges[i];
+    assert(e->origin < diagram->num_vertices && "origin out of range");
+    assert(e->site < diagram->num_sites && "site out of range");
+    assert(e->next < diagram->num_edges && "next out of range");
+    const VoronoiHalfEdge *next = &diagram->edges[e->next];
+    assert(next->site == e->site && "next should be in the same cell");
+    if (e->twin != UINT_MAX) {
+      assert(e->twin < diagram->num_edges && "twin out of range");
+      const VoronoiHalfEdge *twin = &diagram->edges[e->twin];
+      assert(twin->twin == i && "twins should point at each other");
+      assert(twin->origin == next->origin &&
+             "a half-edge should end where its twin starts");
+      assert(twin->site != e->site && "twins should be in different cells");
+    }
+  }
+  for (unsigned s = 0; s < diagram->num_sites; ++s) {
+    unsigned start = diagram->cells[s];
+    if (start == UINT_MAX) {
+      continue;
+    }
+    assert(diagram->edges[start].site == s && "cell edge of another site");
+    unsigned edge = start;
+    unsigned steps = 0;
+    do {
+      edge = diagram->edges[edge].next;
+      assert(++steps <= diagram->num_edges && "cell should be a cycle");
+    } while (edge != start);
+  }
+}
@@ -0,0 +1,806 @@
+// Adaptive orient2d and incircle after Shewchuk, "Adaptive Precision
+// Floating-Point Arithmetic and Fast Robust Geometric Predicates".
+//
+// An expansion is a sum of doubles that do not overlap bit-wise, stored from
+// the smallest magnitude to the largest, so it represents a value exactly and
+// its largest component has the sign of the whole sum. Sums and products of
+// doubles are turned into expansions with error-free transformations: the
+// rounded result plus the exact rounding error. These rely on every operation
+// being rounded separately, which geo is compiled for, and products use fma to
+// get the exact error of a product.
+#include "geometry/predicates.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Relative error bounds of the stages, in units of 2^-53, the largest
+// relative rounding error of one operation.
+static const double RESULT_BOUND = (3.0 + 8.0 * 0x1p-53) * 0x1p-53;
+static const double CCW_BOUND_A = (3.0 + 16.0 * 0x1p-53) * 0x1p-53;
+static const double CCW_BOUND_B = (2.0 + 12.0 * 0x1p-53) * 0x1p-53;
+static const double CCW_BOUND_C = (9.0 + 64.0 * 0x1p-53) * 0x1p-53 * 0x1p-53;
+static const double ICC_BOUND_A = (10.0 + 96.0 * 0x1p-53) * 0x1p-53;
+static const double ICC_BOUND_B = (4.0 + 48.0 * 0x1p-53) * 0x1p-53;
+static const double TANGENT_BOUND = (8.0 + 64.0 * 0x1p-53) * 0x1p-53;
+static const double TOP_BOUND = (10.0 + 128.0 * 0x1p-53) * 0x1p-53;
+
+// Components of the products scaled inside expansion_product.
+#define MAX_SCALED 32
+// Components of a 2x2 determinant or squared length of differences that are
+// exact as two components each.
+#define MAX_MINOR 16
+// Components of one term of the incircle determinant.
+#define MAX_TERM (2 * MAX_MINOR * MAX_MINOR)
+
+// a + b = *sum + *error exactly.
+static void two_sum(double a, double b, double *sum, double *error) {
+  double s = a + b;
+  double b_virtual = s - a;
+  double a_virtual = s - b_virtual;
+  *error = (a - a_virtual) + (b - b_virtual);
+  *sum = s;
+}
+
+// two_sum for |a| >= |b|.
+static void fast_two_sum(double a, double b, double *sum, double *error) {
+  double s = a + b;
+  *error = b - (s - a);
+  *sum = s;
+}
+
+// a * b = *product + *error exactly.
+static void two_product(double a, double b, double *product, double *error) {
+  double p = a * b;
+  *error = fma(a, b, -p);
+  *product = p;
+}
+
+// The rounding error of difference, the rounded a - b.
+static double difference_tail(double a, double b, double difference) {
+  double b_virtual = a - difference;
+  double a_virtual = difference + b_virtual;
+  return (a - a_virtual) + (b_virtual - b);
+}
+
+// h = e + f, dropping zero components. h needs room for elen + flen
+// components.
+static unsigned expansion_sum(unsigned elen, const double *e, unsigned flen,
+                              const double *f, double *h) {
+  unsigned i = 0;
+  unsigned j = 0;
+  unsigned hlen = 0;
+  double q;
+  // Add components in order of magnitude
+  if ((f[0] > e[0]) == (f[0] > -e[0])) {
+    q = e[i++];
+  } else {
+    q = f[j++];
+  }
+  double error;
+  if (i < elen && j < flen) {
+    if ((f[j] > e[i]) == (f[j] > -e[i])) {
+      fast_two_sum(e[i++], q, &q, &error);
+    } else {
+      fast_two_sum(f[j++], q, &q, &error);
+    }
+    if (error != 0) {
+      h[hlen++] = error;
+    }
+    while (i < elen && j < flen) {
+      if ((f[j] > e[i]) == (f[j] > -e[i])) {
+        two_sum(q, e[i++], &q, &error);
+      } else {
+        two_sum(q, f[j++], &q, &error);
+      }
+      if (error != 0) {
+        h[hlen++] = error;
+      }
+    }
+  }
+  while (i < elen) {
+    two_sum(q, e[i++], &q, &error);
+    if (error != 0) {
+      h[hlen++] = error;
+    }
+  }
+  while (j < flen) {
+    two_sum(q, f[j++], &q, &error);
+    if (error != 0) {
+      h[hlen++] = error;
+    }
+  }
+  if (q != 0 || hlen == 0) {
+    h[hlen++] = q;
+  }
+  return hlen;
+}
+
+// h = e * b, dropping zero components. h needs room for 2 * elen components.
+static unsigned scale_expansion(unsigned elen, const double *e, double b,
+                                double *h) {
+  unsigned hlen = 0;
+  double q;
+  double error;
+  two_product(e[0], b, &q, &error);
+  if (error != 0) {
+    h[hlen++] = error;
+  }
+  for (unsigned i = 1; i < elen; ++i) {
+    double product;
+    double product_error;
+    double sum;
+    two_product(e[i], b, &product, &product_error);
+    two_sum(q, product_error, &sum, &error);
+    if (error != 0) {
+      h[hlen++] = error;
+    }
+    fast_two_sum(product, sum, &q, &error);
+    if (error != 0) {
+      h[hlen++] = error;
+    }
+  }
+  if (q != 0 || hlen == 0) {
+    h[hlen++] = q;
+  }
+  return hlen;
+}
+
+// h = e * f as the sum of e scaled by each component of f. h and scratch need
+// room for 2 * elen * flen components.
+static unsigned expansion_product(unsigned elen, const double *e,
+                                  unsigned flen, const double *f, double *h,
+                                  double *scratch) {
+  assert(2 * elen <= MAX_SCALED && "expansion too long to scale");
+  double scaled[MAX_SCALED];
+  unsigned hlen = scale_expansion(elen, e, f[0], h);
+  for (unsigned i = 1; i < flen; ++i) {
+    unsigned slen = scale_expansion(elen, e, f[i], scaled);
+    hlen = expansion_sum(hlen, h, slen, scaled, scratch);
+    memcpy(h, scratch, sizeof(double) * hlen);
+  }
+  return hlen;
+}
+
+static void negate(unsigned elen, double *e) {
+  for (unsigned i = 0; i < elen; ++i) {
+    e[i] = -e[i];
+  }
+}
+
+static int sign_of(double x) { return (x > 0) - (x < 0); }
+
+// An approximation of the value of an expansion with the same sign.
+static double estimate(unsigned elen, const double *e) {
+  double sum = e[0];
+  for (unsigned i = 1; i < elen; ++i) {
+    sum += e[i];
+  }
+  return sum;
+}
+
+// h = ax * by - ay * bx for expansions of length n, which is 1 or 2. h needs
+// room for 4 * n * n components.
+static unsigned cross_product(unsigned n, const double *ax, const double *ay,
+                              const double *bx, const double *by, double *h) {
+  double left[8];
+  double right[8];
+  double scratch[8];
+  unsigned left_length = expansion_product(n, ax, n, by, left, scratch);
+  unsigned right_length = expansion_product(n, ay, n, bx, right, scratch);
+  negate(right_length, right);
+  return expansion_sum(left_length, left, right_length, right, h);
+}
+
+// h = x * x + y * y for expansions of length n, which is 1 or 2. h needs room
+// for 4 * n * n components.
+static unsigned squared_length(unsigned n, const double *x, const double *y,
+                               double *h) {
+  double xx[8];
+  double yy[8];
+  double scratch[8];
+  unsigned xx_length = expansion_product(n, x, n, x, xx, scratch);
+  unsigned yy_length = expansion_product(n, y, n, y, yy, scratch);
+  return expansion_sum(xx_length, xx, yy_length, yy, h);
+}
+
+static double orient2d_adapt(Point a, Point b, Point c, double detsum) {
+  double acx = a.x - c.x;
+  double bcx = b.x - c.x;
+  double acy = a.y - c.y;
+  double bcy = b.y - c.y;
+
+  // Exact determinant of the rounded differences
+  double exact[4];
+  unsigned exact_length = cross_product(1, &acx, &acy, &bcx, &bcy, exact);
+  double det = estimate(exact_length, exact);
+  double bound = CCW_BOUND_B * detsum;
+  if (det >= bound || -det >= bound) {
+    return det;
+  }
+
+  double acx_tail = difference_tail(a.x, c.x, acx);
+  double bcx_tail = difference_tail(b.x, c.x, bcx);
+  double acy_tail = difference_tail(a.y, c.y, acy);
+  double bcy_tail = difference_tail(b.y, c.y, bcy);
+  if (acx_tail == 0 && bcx_tail == 0 && acy_tail == 0 && bcy_tail == 0) {
+    return det;
+  }
+
+  // First order correction for the rounding of the differences
+  bound = CCW_BOUND_C * detsum + RESULT_BOUND * fabs(det);
+  det += (acx * bcy_tail + bcy * acx_tail) - (acy * bcx_tail + bcx * acy_tail);
+  if (det >= bound || -det >= bound) {
+    return det;
+  }
+
+  // Exact determinant of the exact differences
+  double ax[2] = {acx_tail, acx};
+  double ay[2] = {acy_tail, acy};
+  double bx[2] = {bcx_tail, bcx};
+  double by[2] = {bcy_tail, bcy};
+  double full[MAX_MINOR];
+  unsigned full_length = cross_product(2, ax, ay, bx, by, full);
+  return full[full_length - 1];
+}
+
+double orient2d(Point a, Point b, Point c) {
+  double detleft = (a.x - c.x) * (b.y - c.y);
+  double detright = (a.y - c.y) * (b.x - c.x);
+  double det = detleft - detright;
+
+  // Terms of opposite signs cannot cancel
+  double detsum;
+  if (detleft > 0) {
+    if (detright <= 0) {
+      return det;
+    }
+    detsum = detleft + detright;
+  } else if (detleft < 0) {
+    if (detright >= 0) {
+      return det;
+    }
+    detsum = -detleft - detright;
+  } else {
+    return det;
+  }
+
+  double bound = CCW_BOUND_A * detsum;
+  if (det >= bound || -det >= bound) {
+    return det;
+  }
+  return orient2d_adapt(a, b, c, detsum);
+}
+
+// The incircle determinant of the differences x[i] and y[i] of the first three
+// points and the fourth, each an expansion of length n, which is 1 or 2.
+static double incircle_exact(unsigned n, const double *x[3],
+                             const double *y[3]) {
+  double sum[3 * MAX_TERM];
+  double scratch[3 * MAX_TERM];
+  unsigned sum_length = 0;
+  for (unsigned i = 0; i < 3; ++i) {
+    unsigned j = (i + 1) % 3;
+    unsigned k = (i + 2) % 3;
+    double lift[MAX_MINOR];
+    double minor[MAX_MINOR];
+    double term[MAX_TERM];
+    unsigned lift_length = squared_length(n, x[i], y[i], lift);
+    unsigned minor_length = cross_product(n, x[j], y[j], x[k], y[k], minor);
+    unsigned term_length = expansion_product(lift_length, lift, minor_length,
+                                             minor, term, scratch);
+    if (sum_length == 0) {
+      memcpy(sum, term, sizeof(double) * term_length);
+      sum_length = term_length;
+    } else {
+      sum_length = expansion_sum(sum_length, sum, term_length, term, scratch);
+      memcpy(sum, scratch, sizeof(double) * sum_length);
+    }
+  }
+  return estimate(sum_length, sum);
+}
+
+static double incircle_adapt(Point a, Point b, Point c, Point d,
+                             double permanent) {
+  Point points[] = {a, b, c};
+  // Each difference with its rounding error first
+  double dx[3][2];
+  double dy[3][2];
+  const double *rounded_x[3];
+  const double *rounded_y[3];
+  const double *full_x[3];
+  const double *full_y[3];
+  bool exact = true;
+  for (unsigned i = 0; i < 3; ++i) {
+    dx[i][1] = points[i].x - d.x;
+    dy[i][1] = points[i].y - d.y;
+    dx[i][0] = difference_tail(points[i].x, d.x, dx[i][1]);
+    dy[i][0] = difference_tail(points[i].y, d.y, dy[i][1]);
+    exact = exact && dx[i][0] == 0 && dy[i][0] == 0;
+    rounded_x[i] = &dx[i][1];
+    rounded_y[i] = &dy[i][1];
+    full_x[i] = dx[i];
+    full_y[i] = dy[i];
+  }
+
+  // Exact determinant of the rounded differences
+  double det = incircle_exact(1, rounded_x, rounded_y);
+  double bound = ICC_BOUND_B * permanent;
+  if (det >= bound || -det >= bound || exact) {
+    return det;
+  }
+  return incircle_exact(2, full_x, full_y);
+}
+
+double incircle(Point a, Point b, Point c, Point d) {
+  double adx = a.x - d.x;
+  double bdx = b.x - d.x;
+  double cdx = c.x - d.x;
+  double ady = a.y - d.y;
+  double bdy = b.y - d.y;
+  double cdy = c.y - d.y;
+
+  double bdxcdy = bdx * cdy;
+  double cdxbdy = cdx * bdy;
+  double alift = adx * adx + ady * ady;
+  double cdxady = cdx * ady;
+  double adxcdy = adx * cdy;
+  double blift = bdx * bdx + bdy * bdy;
+  double adxbdy = adx * bdy;
+  double bdxady = bdx * ady;
+  double clift = cdx * cdx + cdy * cdy;
+
+  double det = alift * (bdxcdy - cdxbdy) + blift * (cdxady - adxcdy) +
+               clift * (adxbdy - bdxady);
+  double permanent = (fabs(bdxcdy) + fabs(cdxbdy)) * alift +
+                     (fabs(cdxady) + fabs(adxcdy)) * blift +
+                     (fabs(adxbdy) + fabs(bdxady)) * clift;
+  double bound = ICC_BOUND_A * permanent;
+  if (det > bound || -det > bound) {
+    return det;
+  }
+  return incircle_adapt(a, b, c, d, permanent);
+}
+
+// a.y * |b|^2 - b.y * |a|^2 for the exact differences of a and b from the
+// point of tangency, each an expansion of two components.
+static double tangent_circle_exact(const double *ax, const double *ay,
+                                   const double *bx, const double *by) {
+  double a_lift[MAX_MINOR];
+  double b_lift[MAX_MINOR];
+  double left[4 * MAX_MINOR];
+  double right[4 * MAX_MINOR];
+  double sum[8 * MAX_MINOR];
+  double scratch[4 * MAX_MINOR];
+  unsigned a_lift_length = squared_length(2, ax, ay, a_lift);
+  unsigned b_lift_length = squared_length(2, bx, by, b_lift);
+  unsigned left_length =
+      expansion_product(b_lift_length, b_lift, 2, ay, left, scratch);
+  unsigned right_length =
+      expansion_product(a_lift_length, a_lift, 2, by, right, scratch);
+  negate(right_length, right);
+  unsigned sum_length =
+      expansion_sum(left_length, left, right_length, right, sum);
+  return sum[sum_length - 1];
+}
+
+double tangent_circle_compare(Point a, Point b, Point p) {
+  double adx = a.x - p.x;
+  double ady = a.y - p.y;
+  double bdx = b.x - p.x;
+  double bdy = b.y - p.y;
+  double left = ady * (bdx * bdx + bdy * bdy);
+  double right = bdy * (adx * adx + ady * ady);
+  double det = left - right;
+  double bound = TANGENT_BOUND * (fabs(left) + fabs(right));
+  if (det > bound || -det > bound) {
+    return det;
+  }
+
+  double ax[2] = {difference_tail(a.x, p.x, adx), adx};
+  double ay[2] = {difference_tail(a.y, p.y, ady), ady};
+  double bx[2] = {difference_tail(b.x, p.x, bdx), bdx};
+  double by[2] = {difference_tail(b.y, p.y, bdy), bdy};
+  return tangent_circle_exact(ax, ay, bx, by);
+}
+
+// h = e * f for expansions of any length. h needs room for 2 * elen * flen
+// components and scratch for 2 * elen * (flen + 1).
+static unsigned long_product(unsigned elen, const double *e, unsigned flen,
+                             const double *f, double *h, double *scratch) {
+  double *scaled = scratch + 2 * elen * flen;
+  unsigned hlen = scale_expansion(elen, e, f[0], h);
+  for (unsigned i = 1; i < flen; ++i) {
+    unsigned slen = scale_expansion(elen, e, f[i], scaled);
+    hlen = expansion_sum(hlen, h, slen, scaled, scratch);
+    memcpy(h, scratch, sizeof(double) * hlen);
+  }
+  return hlen;
+}
+
+// h = e * f - g * k, where e and g have two components. h needs room for
+// 4 * (flen + klen) components.
+static unsigned difference_of_products(const double *e, unsigned flen,
+                                       const double *f, const double *g,
+                                       unsigned klen, const double *k,
+                                       double *h) {
+  double left[4 * MAX_MINOR];
+  double right[4 * MAX_MINOR];
+  double scratch[4 * MAX_MINOR];
+  unsigned left_length = expansion_product(flen, f, 2, e, left, scratch);
+  unsigned right_length = expansion_product(klen, k, 2, g, right, scratch);
+  negate(right_length, right);
+  return expansion_sum(left_length, left, right_length, right, h);
+}
+
+// The center of the circle through a and points b and c relative to it is
+// a + U / (2 * d), with d = b x c and U = (c.y * |b|^2 - b.y * |c|^2,
+// b.x * |c|^2 - c.x * |b|^2). For H = 2 * d * h, where h is the height of the
+// line above a, the top is on or below the line when U.y + |U| <= H, which is
+// H - U.y >= 0 and U.x^2 <= H * (H - 2 * U.y).
+static int circle_top_exact(Point a, Point b, Point c, double y) {
+  double bx[2] = {difference_tail(b.x, a.x, b.x - a.x), b.x - a.x};
+  double by[2] = {difference_tail(b.y, a.y, b.y - a.y), b.y - a.y};
+  double cx[2] = {difference_tail(c.x, a.x, c.x - a.x), c.x - a.x};
+  double cy[2] = {difference_tail(c.y, a.y, c.y - a.y), c.y - a.y};
+  double h[2] = {difference_tail(y, a.y, y - a.y), y - a.y};
+  double b2[MAX_MINOR];
+  double c2[MAX_MINOR];
+  double d[MAX_MINOR];
+  double scratch[8 * MAX_MINOR];
+  unsigned b2_length = squared_length(2, bx, by, b2);
+  unsigned c2_length = squared_length(2, cx, cy, c2);
+  unsigned d_length = cross_product(2, bx, by, cx, cy, d);
+  double ux[8 * MAX_MINOR];
+  double uy[8 * MAX_MINOR];
+  unsigned ux_length =
+      difference_of_products(cy, b2_length, b2, by, c2_length, c2, ux);
+  unsigned uy_length =
+      difference_of_products(bx, c2_length, c2, cx, b2_length, b2, uy);
+  double H[4 * MAX_MINOR];
+  unsigned H_length = expansion_product(d_length, d, 2, h, H, scratch);
+  for (unsigned i = 0; i < H_length; ++i) {
+    H[i] *= 2;
+  }
+
+  // H - U.y, and then H - 2 * U.y
+  negate(uy_length, uy);
+  double once[12 * MAX_MINOR];
+  double rest[20 * MAX_MINOR];
+  unsigned once_length = expansion_sum(H_length, H, uy_length, uy, once);
+  if (once[once_length - 1] < 0) {
+    return 1;
+  }
+  unsigned rest_length =
+      expansion_sum(once_length, once, uy_length, uy, rest);
+
+  unsigned left_capacity = 2 * ux_length * ux_length;
+  unsigned right_capacity = 2 * H_length * rest_length;
+  unsigned capacity = left_capacity + right_capacity;
+  double *left = malloc(sizeof(double) *
+                        (2 * capacity + 2 * (ux_length + rest_length)));
+  double *right = left + left_capacity;
+  double *work = right + right_capacity;
+  unsigned left_length =
+      long_product(ux_length, ux, ux_length, ux, left, work);
+  unsigned right_length =
+      long_product(rest_length, rest, H_length, H, right, work);
+  negate(right_length, right);
+  unsigned sum_length =
+      expansion_sum(left_length, left, right_length, right, work);
+  int sign = sign_of(work[sum_length - 1]);
+  free(left);
+  return sign;
+}
+
+int circle_top_compare(Point a, Point b, Point c, double y) {
+  double bx = b.x - a.x;
+  double by = b.y - a.y;
+  double cx = c.x - a.x;
+  double cy = c.y - a.y;
+  double h = y - a.y;
+  double b2 = bx * bx + by * by;
+  double c2 = cx * cx + cy * cy;
+  double ux = cy * b2 - by * c2;
+  double uy = bx * c2 - cx * b2;
+  double H = 2 * (bx * cy - by * cx) * h;
+  double ux_permanent = fabs(cy) * b2 + fabs(by) * c2;
+  double uy_permanent = fabs(bx) * c2 + fabs(cx) * b2;
+  double H_permanent = 2 * (fabs(bx * cy) + fabs(by * cx)) * fabs(h);
+
+  double rest = H - uy;
+  double bound = TOP_BOUND * (H_permanent + uy_permanent);
+  if (rest < -bound) {
+    return 1;
+  }
+  if (rest > bound) {
+    double det = ux * ux - H * (rest - uy);
+    double permanent = ux_permanent * ux_permanent +
+                       H_permanent * (H_permanent + 2 * uy_permanent);
+    bound = TOP_BOUND * permanent;
+    if (det > bound || -det > bound) {
+      return det > 0 ? 1 : -1;
+    }
+  }
+  return circle_top_exact(a, b, c, y);
+}
+
+double direction_cross(Segment s, Segment t) {
+  double sx = s.p1.x - s.p0.x;
+  double sy = s.p1.y - s.p0.y;
+  double tx = t.p1.x - t.p0.x;
+  double ty = t.p1.y - t.p0.y;
+  double detleft = sx * ty;
+  double detright = sy * tx;
+  double det = detleft - detright;
+
+  // Terms of opposite signs cannot cancel
+  if ((detleft > 0 && detright <= 0) || (detleft < 0 && detright >= 0) ||
+      detleft == 0) {
+    return det;
+  }
+  double bound = CCW_BOUND_A * (fabs(detleft) + fabs(detright));
+  if (det >= bound || -det >= bound) {
+    return det;
+  }
+
+  double ax[2] = {difference_tail(s.p1.x, s.p0.x, sx), sx};
+  double ay[2] = {difference_tail(s.p1.y, s.p0.y, sy), sy};
+  double bx[2] = {difference_tail(t.p1.x, t.p0.x, tx), tx};
+  double by[2] = {difference_tail(t.p1.y, t.p0.y, ty), ty};
+  double full[MAX_MINOR];
+  unsigned full_length = cross_product(2, ax, ay, bx, by, full);
+  return full[full_length - 1];
+}
+
+// Implicit points. For d = s.p1 - s.p0 and e = t.p1 - t.p0, the crossing of s
+// and t is s.p0 + d * N / D with D = d x e and N = (t.p0 - s.p0) x e. Its
+// coordinates relative to a point r, times D, are (s.p0 - r) * D + d * N,
+// which the exact differences turn into expansions. Comparisons multiply
+// through by D and correct for its sign.
+
+// Components of a coordinate of a crossing times D.
+#define MAX_COORDINATE (8 * MAX_MINOR)
+
+// a - b exactly, as an expansion of two components.
+static void exact_difference(double a, double b, double h[2]) {
+  h[1] = a - b;
+  h[0] = difference_tail(a, b, h[1]);
+}
+
+typedef struct {
+  // s.p1 - s.p0 on each axis
+  double d[2][2];
+  double D[MAX_MINOR];
+  unsigned D_length;
+  double N[MAX_MINOR];
+  unsigned N_length;
+} CrossingTerms;
+
+static void crossing_terms(const ImplicitPoint *c, CrossingTerms *terms) {
+  double e[2][2];
+  double w[2][2];
+  exact_difference(c->s.p1.x, c->s.p0.x, terms->d[0]);
+  exact_difference(c->s.p1.y, c->s.p0.y, terms->d[1]);
+  exact_difference(c->t.p1.x, c->t.p0.x, e[0]);
+  exact_difference(c->t.p1.y, c->t.p0.y, e[1]);
+  exact_difference(c->t.p0.x, c->s.p0.x, w[0]);
+  exact_difference(c->t.p0.y, c->s.p0.y, w[1]);
+  terms->D_length =
+      cross_product(2, terms->d[0], terms->d[1], e[0], e[1], terms->D);
+  terms->N_length = cross_product(2, w[0], w[1], e[0], e[1], terms->N);
+  assert(terms->D[terms->D_length - 1] != 0 &&
+         "crossing segments should not be parallel");
+}
+
+// The coordinate of the crossing on an axis, 0 for x and 1 for y, relative to
+// r and times D. h needs room for MAX_COORDINATE components.
+static unsigned crossing_coordinate(const ImplicitPoint *c,
+                                    const CrossingTerms *terms, unsigned axis,
+                                    double r, double *h) {
+  double base[2];
+  exact_difference(axis == 0 ? c->s.p0.x : c->s.p0.y, r, base);
+  double offset[4 * MAX_MINOR];
+  double along[4 * MAX_MINOR];
+  double scratch[4 * MAX_MINOR];
+  unsigned offset_length = expansion_product(2, base, terms->D_length,
+                                             terms->D, offset, scratch);
+  unsigned along_length = expansion_product(2, terms->d[axis],
+                                            terms->N_length, terms->N, along,
+                                            scratch);
+  return expansion_sum(offset_length, offset, along_length, along, h);
+}
+
+// Exact sign of the coordinate of the crossing c minus v on an axis.
+static int crossing_compare_value(const ImplicitPoint *c, unsigned axis,
+                                  double v) {
+  CrossingTerms terms;
+  crossing_terms(c, &terms);
+  double h[MAX_COORDINATE];
+  unsigned length = crossing_coordinate(c, &terms, axis, v, h);
+  return sign_of(h[length - 1]) * sign_of(terms.D[terms.D_length - 1]);
+}
+
+// Exact sign of a's coordinate minus b's on an axis, for two crossings:
+// a.D * b.D * (a.X * b.D - b.X * a.D).
+static int crossing_compare(const ImplicitPoint *a, const ImplicitPoint *b,
+                            unsigned axis) {
+  CrossingTerms a_terms;
+  CrossingTerms b_terms;
+  crossing_terms(a, &a_terms);
+  crossing_terms(b, &b_terms);
+  double a_coordinate[MAX_COORDINATE];
+  double b_coordinate[MAX_COORDINATE];
+  unsigned a_length = crossing_coordinate(a, &a_terms, axis, 0, a_coordinate);
+  unsigned b_length = crossing_coordinate(b, &b_terms, axis, 0, b_coordinate);
+
+  unsigned left_capacity = 2 * b_terms.D_length * a_length;
+  unsigned right_capacity = 2 * a_terms.D_length * b_length;
+  unsigned capacity = left_capacity + right_capacity;
+  double *left = malloc(sizeof(double) * 2 * capacity);
+  double *right = left + left_capacity;
+  double *scratch = right + right_capacity;
+  double *sum = scratch;
+  unsigned left_length =
+      expansion_product(b_terms.D_length, b_terms.D, a_length, a_coordinate,
+                        left, scratch);
+  unsigned right_length =
+      expansion_product(a_terms.D_length, a_terms.D, b_length, b_coordinate,
+                        right, scratch);
+  negate(right_length, right);
+  unsigned sum_length =
+      expansion_sum(left_length, left, right_length, right, sum);
+  int sign = sign_of(sum[sum_length - 1]) *
+             sign_of(a_terms.D[a_terms.D_length - 1]) *
+             sign_of(b_terms.D[b_terms.D_length - 1]);
+  free(left);
+  return sign;
+}
+
+static bool same_point(Point a, Point b) { return a.x == b.x && a.y == b.y; }
+
+// Whether a line through a and b is the line through s.
+static bool same_line(Point a, Point b, Segment s) {
+  return (same_point(a, s.p0) && same_point(b, s.p1)) ||
+         (same_point(a, s.p1) && same_point(b, s.p0));
+}
+
+// Whether two crossings are of the same segments, which is how a crossing is
+// usually compared with itself.
+static bool same_crossing(const ImplicitPoint *a, const ImplicitPoint *b) {
+  return (same_line(a->s.p0, a->s.p1, b->s) &&
+          same_line(a->t.p0, a->t.p1, b->t)) ||
+         (same_line(a->s.p0, a->s.p1, b->t) &&
+          same_line(a->t.p0, a->t.p1, b->s));
+}
+
+ImplicitPoint implicit_point(Point p) {
+  return (ImplicitPoint){.approx = p, .error = 0, .crossing = false};
+}
+
+ImplicitPoint implicit_crossing(Segment s, Segment t) {
+  double dx = s.p1.x - s.p0.x;
+  double dy = s.p1.y - s.p0.y;
+  double ex = t.p1.x - t.p0.x;
+  double ey = t.p1.y - t.p0.y;
+  double wx = t.p0.x - s.p0.x;
+  double wy = t.p0.y - s.p0.y;
+  double D = dx * ey - dy * ex;
+  double D_error = CCW_BOUND_A * (fabs(dx * ey) + fabs(dy * ex));
+  double N = wx * ey - wy * ex;
+  double N_error = CCW_BOUND_A * (fabs(wx * ey) + fabs(wy * ex));
+
+  ImplicitPoint c = {.error = INFINITY, .crossing = true, .s = s, .t = t};
+  double min_x = fmax(fmin(s.p0.x, s.p1.x), fmin(t.p0.x, t.p1.x));
+  double max_x = fmin(fmax(s.p0.x, s.p1.x), fmax(t.p0.x, t.p1.x));
+  double min_y = fmax(fmin(s.p0.y, s.p1.y), fmin(t.p0.y, t.p1.y));
+  double max_y = fmin(fmax(s.p0.y, s.p1.y), fmax(t.p0.y, t.p1.y));
+  c.approx = (Point){.x = (min_x + max_x) / 2, .y = (min_y + max_y) / 2};
+  if (fabs(D) > D_error) {
+    // Bound the error of the parameter along s from the bounds on D and N,
+    // then of the point from it and the roundings that follow. The result is
+    // doubled to cover the roundings of the bounds themselves.
+    double along = N / D;
+    double along_error =
+        (N_error + fabs(along) * D_error) / (fabs(D) - D_error) +
+        0x1p-52 * fabs(along);
+    c.approx.x = s.p0.x + along * dx;
+    c.approx.y = s.p0.y + along * dy;
+    double x_error = along_error * fabs(dx) + 0x1p-52 * fabs(along * dx) +
+                     0x1p-53 * fabs(c.approx.x);
+    double y_error = along_error * fabs(dy) + 0x1p-52 * fabs(along * dy) +
+                     0x1p-53 * fabs(c.approx.y);
+    c.error = 2 * fmax(x_error, y_error);
+  }
+  // The crossing lies in both boxes, so this only moves approx closer to it
+  c.approx.x = fmax(min_x, fmin(max_x, c.approx.x));
+  c.approx.y = fmax(min_y, fmin(max_y, c.approx.y));
+  return c;
+}
+
+int implicit_compare(const ImplicitPoint *a, const ImplicitPoint *b) {
+  if (!a->crossing && !b->crossing) {
+    Point p = a->approx;
+    Point q = b->approx;
+    return p.x != q.x ? sign_of(p.x - q.x) : sign_of(p.y - q.y);
+  }
+  if (a->crossing && b->crossing && same_crossing(a, b)) {
+    return 0;
+  }
+  for (unsigned axis = 0; axis < 2; ++axis) {
+    double av = axis == 0 ? a->approx.x : a->approx.y;
+    double bv = axis == 0 ? b->approx.x : b->approx.y;
+    double difference = av - bv;
+    double bound = a->error + b->error;
+    int sign;
+    if (difference > bound || -difference > bound) {
+      sign = sign_of(difference);
+    } else if (!a->crossing && !b->crossing) {
+      sign = 0;
+    } else if (!a->crossing) {
+      sign = -crossing_compare_value(b, axis, av);
+    } else if (!b->crossing) {
+      sign = crossing_compare_value(a, axis, bv);
+    } else {
+      sign = crossing_compare(a, b, axis);
+    }
+    if (sign != 0) {
+      return sign;
+    }
+  }
+  return 0;
+}
+
+int implicit_compare_x(const ImplicitPoint *p, double x) {
+  if (isinf(x)) {
+    return x > 0 ? -1 : 1;
+  }
+  double difference = p->approx.x - x;
+  if (difference > p->error || -difference > p->error) {
+    return sign_of(difference);
+  }
+  return p->crossing ? crossing_compare_value(p, 0, x) : 0;
+}
+
+double implicit_orient2d(Point a, Point b, const ImplicitPoint *c) {
+  if (!c->crossing) {
+    return orient2d(a, b, c->approx);
+  }
+  if (same_line(a, b, c->s) || same_line(a, b, c->t)) {
+    return 0;
+  }
+  double bax = b.x - a.x;
+  double bay = b.y - a.y;
+  double detleft = bax * (c->approx.y - a.y);
+  double detright = bay * (c->approx.x - a.x);
+  double det = detleft - detright;
+  double bound = CCW_BOUND_A * (fabs(detleft) + fabs(detright)) +
+                 (fabs(bax) + fabs(bay)) * c->error;
+  if (det > bound || -det > bound) {
+    return det;
+  }
+
+  // (b - a) x (c - a), times D
+  CrossingTerms terms;
+  crossing_terms(c, &terms);
+  double x[MAX_COORDINATE];
+  double y[MAX_COORDINATE];
+  unsigned x_length = crossing_coordinate(c, &terms, 0, a.x, x);
+  unsigned y_length = crossing_coordinate(c, &terms, 1, a.y, y);
+  double ba_x[2];
+  double ba_y[2];
+  exact_difference(b.x, a.x, ba_x);
+  exact_difference(b.y, a.y, ba_y);
+  double left[4 * MAX_COORDINATE];
+  double right[4 * MAX_COORDINATE];
+  double scratch[4 * MAX_COORDINATE];
+  double sum[8 * MAX_COORDINATE];
+  unsigned left_length =
+      expansion_product(2, ba_x, y_length, y, left, scratch);
+  unsigned right_length =
+      expansion_product(2, ba_y, x_length, x, right, scratch);
+  negate(right_length, right);
+  unsigned sum_length =
+      expansion_sum(left_length, left, right_length, right, sum);
+  return sign_of(sum[sum_length - 1]) *
+         sign_of(terms.D[terms.D_length - 1]);
+}
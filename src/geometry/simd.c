@@ -0,0 +1,48 @@
+#include "geometry/simd.h"
+#include <stdatomic.h>
+#include <stdlib.h>
+
+static const unsigned ALIGNMENT = 64;
+
+// The dispatch level, or -1 until it is first read or set. Kernels on several
+// threads may read it at once.
+static atomic_int level = -1;
+
+SimdLevel simd_supported_level() {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f")) {
+    return SIMD_AVX512;
+  }
+  if (__builtin_cpu_supports("avx2")) {
+    return SIMD_AVX2;
+  }
+#endif
+  return SIMD_SCALAR;
+}
+
+SimdLevel simd_level() {
+  int l = atomic_load_explicit(&level, memory_order_relaxed);
+  if (l < 0) {
+    // Threads racing here all detect the same level. One set by
+    // simd_set_level in the meantime wins.
+    int unset = -1;
+    l = simd_supported_level();
+    if (!atomic_compare_exchange_strong(&level, &unset, l)) {
+      l = unset;
+    }
+  }
+  return (SimdLevel)l;
+}
+
+void simd_set_level(SimdLevel l) {
+  SimdLevel supported = simd_supported_level();
+  atomic_store(&level, l < supported ? l : supported);
+}
+
+double *simd_alloc(unsigned n) {
+  size_t bytes = sizeof(double) * n;
+  // aligned_alloc requires the size to be a multiple of the alignment
+  bytes = (bytes + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+  return aligned_alloc(ALIGNMENT, bytes ? bytes : ALIGNMENT);
+}
@@ -0,0 +1,339 @@
+// Morton and Hilbert keys and the spatial sort built on them.
+//
+// Morton keys are built with BMI2's pdep and taken apart with pext where the
+// CPU has them, and otherwise a byte of each coordinate at a time through
+// tables. Hilbert keys are converted from and to Morton keys with a state
+// machine over the four orientations of the curve, one table lookup per four
+// levels.
+//
+// The tables are built on first use, once for all threads.
+#include "geometry/space_filling_curve.h"
+#include "data_structure/parallel.h"
+#include "data_structure/sort.h"
+#include "geometry/simd.h"
+#include <assert.h>
+#include <pthread.h>
+#include <stdlib.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define HAS_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+// Grids for sorting have about 4^CELL_BITS cells per point, so points that
+// share a cell are close enough to go in any order.
+static const unsigned CELL_BITS = 3;
+static const uint64_t EVEN_BITS = 0x5555555555555555;
+static const uint64_t ODD_BITS = 0xAAAAAAAAAAAAAAAA;
+// Orientations of the Hilbert curve within a cell, as bits of the state
+enum { HILBERT_SWAP = 1, HILBERT_COMPLEMENT = 2 };
+
+// The bits of a byte spread to the even bits of 16
+static uint16_t spread[256];
+// The even bits of a byte in the low nibble and the odd bits in the high one
+static uint8_t compact[256];
+// Indexed by state and four levels of Morton or Hilbert key, the same four
+// levels of the other key with the state after them in bits 8 and up
+static uint16_t hilbert_from_morton[4][256];
+static uint16_t morton_from_hilbert[4][256];
+static pthread_once_t tables_once = PTHREAD_ONCE_INIT;
+
+// The Hilbert digit of a cell's quadrant given as its x and y bits, in the
+// orientation state. Updates state to the orientation within the quadrant.
+static unsigned hilbert_digit(unsigned *state, unsigned bx, unsigned by) {
+  unsigned complement = (*state & HILBERT_COMPLEMENT) != 0;
+  unsigned rx = ((*state & HILBERT_SWAP) ? by : bx) ^ complement;
+  unsigned ry = ((*state & HILBERT_SWAP) ? bx : by) ^ complement;
+  // The lower quadrants are transposed, and the lower right one mirrored
+  if (ry == 0) {
+    *state ^= HILBERT_SWAP | (rx ? HILBERT_COMPLEMENT : 0);
+  }
+  return (3 * rx) ^ ry;
+}
+
+// The inverse of hilbert_digit, returning the quadrant as x | y << 1.
+static unsigned hilbert_quadrant(unsigned *state, unsigned digit) {
+  unsigned complement = (*state & HILBERT_COMPLEMENT) != 0;
+  unsigned rx = digit >> 1;
+  unsigned ry = (digit ^ rx) & 1;
+  unsigned a = rx ^ complement;
+  unsigned b = ry ^ complement;
+  unsigned quadrant = (*state & HILBERT_SWAP) ? b | a << 1 : a | b << 1;
+  if (ry == 0) {
+    *state ^= HILBERT_SWAP | (rx ? HILBERT_COMPLEMENT : 0);
+  }
+  return quadrant;
+}
+
+static void build_tables() {
+  for (unsigned i = 0; i < 256; ++i) {
+    spread[i] = 0;
+    compact[i] = 0;
+    for (unsigned b = 0; b < 8; ++b) {
+      spread[i] |= (uint16_t)(((i >> b) & 1) << 2 * b);
+      compact[i] |= (uint8_t)(((i >> b) & 1) << (b / 2 + (b % 2) * 4));
+    }
+  }
+  for (unsigned s = 0; s < 4; ++s) {
+    for (unsigned i = 0; i < 256; ++i) {
+      unsigned encode_state = s;
+      unsigned decode_state = s;
+      unsigned hilbert = 0;
+      unsigned morton = 0;
+      for (int level = 3; level >= 0; --level) {
+        unsigned pair = (i >> 2 * level) & 3;
+        hilbert |= hilbert_digit(&encode_state, pair & 1, pair >> 1)
+                   << 2 * level;
+        morton |= hilbert_quadrant(&decode_state, pair) << 2 * level;
+      }
+      hilbert_from_morton[s][i] = (uint16_t)(hilbert | encode_state << 8);
+      morton_from_hilbert[s][i] = (uint16_t)(morton | decode_state << 8);
+    }
+  }
+}
+
+static void init_tables() { pthread_once(&tables_once, build_tables); }
+
+static uint64_t morton_encode_table(uint32_t x, uint32_t y) {
+  uint64_t key = 0;
+  for (unsigned b = 0; b < 4; ++b) {
+    uint64_t bytes = spread[(x >> 8 * b) & 255] |
+                     (uint64_t)spread[(y >> 8 * b) & 255] << 1;
+    key |= bytes << 16 * b;
+  }
+  return key;
+}
+
+static void morton_decode_table(uint64_t key, uint32_t *x, uint32_t *y) {
+  *x = 0;
+  *y = 0;
+  for (unsigned b = 0; b < 8; ++b) {
+    uint8_t nibbles = compact[(key >> 8 * b) & 255];
+    *x |= (uint32_t)(nibbles & 15) << 4 * b;
+    *y |= (uint32_t)(nibbles >> 4) << 4 * b;
+  }
+}
+
+#ifdef HAS_X86_KERNELS
+__attribute__((target("bmi2"))) static uint64_t
+morton_encode_bmi2(uint32_t x, uint32_t y) {
+  return _pdep_u64(x, EVEN_BITS) | _pdep_u64(y, ODD_BITS);
+}
+
+__attribute__((target("bmi2"))) static void
+morton_decode_bmi2(uint64_t key, uint32_t *x, uint32_t *y) {
+  *x = (uint32_t)_pext_u64(key, EVEN_BITS);
+  *y = (uint32_t)_pext_u64(key, ODD_BITS);
+}
+#endif
+
+// Whether to use BMI2, which follows simd_level so that capping it to
+// SIMD_SCALAR also tests and benchmarks the tables.
+static bool use_bmi2() {
+#ifdef HAS_X86_KERNELS
+  return simd_level() != SIMD_SCALAR && __builtin_cpu_supports("bmi2");
+#else
+  return false;
+#endif
+}
+
+uint64_t morton_encode(uint32_t x, uint32_t y) {
+#ifdef HAS_X86_KERNELS
+  if (use_bmi2()) {
+    return morton_encode_bmi2(x, y);
+  }
+#endif
+  init_tables();
+  return morton_encode_table(x, y);
+}
+
+void morton_decode(uint64_t key, uint32_t *x, uint32_t *y) {
+#ifdef HAS_X86_KERNELS
+  if (use_bmi2()) {
+    morton_decode_bmi2(key, x, y);
+    return;
+  }
+#endif
+  init_tables();
+  morton_decode_table(key, x, y);
+}
+
+// Levels above the key's bits are zero in both keys. Each of them flips the
+// swap bit, so the walk starts in the state that reaches the top level of the
+// key unrotated.
+static unsigned hilbert_bytes(unsigned bits, unsigned *state) {
+  unsigned bytes = (bits + 3) / 4;
+  *state = (4 * bytes - bits) % 2 ? HILBERT_SWAP : 0;
+  return bytes;
+}
+
+static uint64_t hilbert_walk(const uint16_t table[4][256], uint64_t key,
+                             unsigned bits) {
+  unsigned state;
+  uint64_t out = 0;
+  for (unsigned b = hilbert_bytes(bits, &state); b-- > 0;) {
+    uint16_t entry = table[state][(key >> 8 * b) & 255];
+    out |= (uint64_t)(entry & 255) << 8 * b;
+    state = entry >> 8;
+  }
+  return out;
+}
+
+static void check_bits(uint32_t x, uint32_t y, unsigned bits) {
+  assert(bits >= 1 && bits <= 32 && "curve bits out of range");
+  assert((bits == 32 || ((x | y) >> bits) == 0) && "cell outside the grid");
+  (void)x;
+  (void)y;
+  (void)bits;
+}
+
+uint64_t hilbert_encode(uint32_t x, uint32_t y, unsigned bits) {
+  check_bits(x, y, bits);
+  init_tables();
+  return hilbert_walk(hilbert_from_morton, morton_encode(x, y), bits);
+}
+
+void hilbert_decode(uint64_t key, unsigned bits, uint32_t *x, uint32_t *y) {
+  check_bits(0, 0, bits);
+  assert((bits == 32 || key >> 2 * bits == 0) && "key outside the curve");
+  init_tables();
+  morton_decode(hilbert_walk(morton_from_hilbert, key, bits), x, y);
+}
+
+void curve_grid_init(CurveGrid *grid, BBox box, unsigned bits) {
+  check_bits(0, 0, bits);
+  double width = box.max_x - box.min_x;
+  double height = box.max_y - box.min_y;
+  double extent = width > height ? width : height;
+  *grid = (CurveGrid){
+      .min = {box.min_x, box.min_y},
+      .scale = extent > 0 ? (double)((1ull << bits) - 1) / extent : 0,
+      .bits = bits,
+  };
+}
+
+static uint32_t quantize(double v, double min, double scale, uint32_t last) {
+  double cell = (v - min) * scale;
+  // NaNs fail every comparison and go to the first cell
+  if (!(cell > 0)) {
+    return 0;
+  }
+  return cell < last ? (uint32_t)cell : last;
+}
+
+void curve_grid_cell(const CurveGrid *grid, Point p, uint32_t *x,
+                     uint32_t *y) {
+  uint32_t last = (uint32_t)((1ull << grid->bits) - 1);
+  *x = quantize(p.x, grid->min.x, grid->scale, last);
+  *y = quantize(p.y, grid->min.y, grid->scale, last);
+}
+
+uint64_t curve_grid_key(const CurveGrid *grid, SpaceFillingCurve curve,
+                        Point p) {
+  uint32_t x, y;
+  curve_grid_cell(grid, p, &x, &y);
+  return curve == CURVE_HILBERT ? hilbert_encode(x, y, grid->bits)
+                                : morton_encode(x, y);
+}
+
+static void grid_keys_table(const CurveGrid *grid, SpaceFillingCurve curve,
+                            const Point *points, unsigned n, uint64_t *keys) {
+  for (unsigned i = 0; i < n; ++i) {
+    uint32_t x, y;
+    curve_grid_cell(grid, points[i], &x, &y);
+    keys[i] = morton_encode_table(x, y);
+  }
+  if (curve == CURVE_HILBERT) {
+    for (unsigned i = 0; i < n; ++i) {
+      keys[i] = hilbert_walk(hilbert_from_morton, keys[i], grid->bits);
+    }
+  }
+}
+
+#ifdef HAS_X86_KERNELS
+__attribute__((target("bmi2"))) static void
+grid_keys_bmi2(const CurveGrid *grid, SpaceFillingCurve curve,
+               const Point *points, unsigned n, uint64_t *keys) {
+  for (unsigned i = 0; i < n; ++i) {
+    uint32_t x, y;
+    curve_grid_cell(grid, points[i], &x, &y);
+    keys[i] = morton_encode_bmi2(x, y);
+  }
+  if (curve == CURVE_HILBERT) {
+    for (unsigned i = 0; i < n; ++i) {
+      keys[i] = hilbert_walk(hilbert_from_morton, keys[i], grid->bits);
+    }
+  }
+}
+#endif
+
+void curve_grid_keys(const CurveGrid *grid, SpaceFillingCurve curve,
+                     const Point *points, unsigned n, uint64_t *keys) {
+  init_tables();
+#ifdef HAS_X86_KERNELS
+  if (use_bmi2()) {
+    grid_keys_bmi2(grid, curve, points, n, keys);
+    return;
+  }
+#endif
+  grid_keys_table(grid, curve, points, n, keys);
+}
+
+unsigned curve_grid_bits(unsigned n) {
+  if (n <= 1) {
+    return CELL_BITS;
+  }
+  return (32 - (unsigned)__builtin_clz(n) + 1) / 2 + CELL_BITS;
+}
+
+typedef struct {
+  const Point *points;
+  const CurveGrid *grid;
+  SpaceFillingCurve curve;
+  uint64_t *keys;
+  unsigned *order;
+  unsigned lo;
+  unsigned hi;
+} KeyChunk;
+
+static void *key_chunk(void *data) {
+  KeyChunk *chunk = data;
+  curve_grid_keys(chunk->grid, chunk->curve, chunk->points + chunk->lo,
+                  chunk->hi - chunk->lo, chunk->keys + chunk->lo);
+  for (unsigned i = chunk->lo; i < chunk->hi; ++i) {
+    chunk->order[i] = i;
+  }
+  return NULL;
+}
+
+void spatial_sort(const Point *points, unsigned n, SpaceFillingCurve curve,
+                  unsigned *order, unsigned num_threads) {
+  assert(num_threads > 0 && "spatial_sort needs at least one thread");
+  if (n == 0) {
+    return;
+  }
+  BBox box = bbox_from_point(points[0]);
+  for (unsigned i = 1; i < n; ++i) {
+    box = bbox_union(box, bbox_from_point(points[i]));
+  }
+  CurveGrid grid;
+  curve_grid_init(&grid, box, curve_grid_bits(n));
+
+  uint64_t *keys = malloc(sizeof(uint64_t) * n);
+  KeyChunk *chunks = malloc(sizeof(KeyChunk) * num_threads);
+  for (unsigned t = 0; t < num_threads; ++t) {
+    chunks[t] = (KeyChunk){
+        .points = points,
+        .grid = &grid,
+        .curve = curve,
+        .keys = keys,
+        .order = order,
+        .lo = (unsigned)((unsigned long)n * t / num_threads),
+        .hi = (unsigned)((unsigned long)n * (t + 1) / num_threads),
+    };
+  }
+  parallel_for(num_threads, key_chunk, chunks, sizeof(KeyChunk));
+  radix_sort_keys(keys, order, n, num_threads);
+  free(chunks);
+  free(keys);
+}
@@ -0,0 +1,25 @@
+#include "geometry/structure/bbox.h"
+#include "geometry/predicates.h"
+
+bool segment_intersects_bbox(Segment s, BBox b) {
+  if (!bbox_overlaps(bbox_from_segment(s), b)) {
+    return false;
+  }
+  // An endpoint in the box settles it without the orientation tests, which
+  // are slow for a segment that is a single point
+  if (bbox_contains_point(b, s.p0) | bbox_contains_point(b, s.p1)) {
+    return true;
+  }
+  Point corners[] = {{b.min_x, b.min_y},
+                     {b.max_x, b.min_y},
+                     {b.max_x, b.max_y},
+                     {b.min_x, b.max_y}};
+  unsigned above = 0;
+  unsigned below = 0;
+  for (unsigned i = 0; i < 4; ++i) {
+    double o = orient2d(s.p0, s.p1, corners[i]);
+    above += o > 0;
+    below += o < 0;
+  }
+  return above < 4 && below < 4;
+}
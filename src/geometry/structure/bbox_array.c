@@ -0,0 +1,191 @@
+// Structure of arrays bounding box container and the one-vs-many overlap
+// kernel.
+//
+// The kernel has scalar, AVX2 and AVX-512 versions like the PointArray
+// kernels. Each is four comparisons per box combined into a mask, with no
+// branches per box.
+#include "geometry/structure/bbox_array.h"
+#include "geometry/simd.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define HAS_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+static const unsigned DEFAULT_INITIAL_CAPACITY = 16;
+
+void bbox_array_init(BBoxArray *arr) {
+  bbox_array_initn(arr, DEFAULT_INITIAL_CAPACITY);
+}
+
+void bbox_array_initn(BBoxArray *arr, unsigned n) {
+  *arr = (BBoxArray){
+      .min_xs = simd_alloc(n),
+      .min_ys = simd_alloc(n),
+      .max_xs = simd_alloc(n),
+      .max_ys = simd_alloc(n),
+      .size = 0,
+      .capacity = n,
+  };
+}
+
+void bbox_array_from_boxes(BBoxArray *arr, const BBox *boxes, unsigned n) {
+  bbox_array_initn(arr, n);
+  arr->size = n;
+  for (unsigned i = 0; i < n; ++i) {
+    bbox_array_set(arr, i, boxes[i]);
+  }
+}
+
+void bbox_array_free(BBoxArray *arr) {
+  bbox_array_validate(arr);
+  free(arr->min_xs);
+  free(arr->min_ys);
+  free(arr->max_xs);
+  free(arr->max_ys);
+}
+
+static double *grow(double *buffer, unsigned size, unsigned capacity) {
+  // realloc does not preserve alignment, so copy into a fresh buffer
+  double *grown = simd_alloc(capacity);
+  memcpy(grown, buffer, sizeof(double) * size);
+  free(buffer);
+  return grown;
+}
+
+void bbox_array_reserve(BBoxArray *arr, unsigned n) {
+  bbox_array_validate(arr);
+  if (n <= arr->capacity) {
+    return;
+  }
+  arr->min_xs = grow(arr->min_xs, arr->size, n);
+  arr->min_ys = grow(arr->min_ys, arr->size, n);
+  arr->max_xs = grow(arr->max_xs, arr->size, n);
+  arr->max_ys = grow(arr->max_ys, arr->size, n);
+  arr->capacity = n;
+}
+
+void bbox_array_push(BBoxArray *arr, BBox b) {
+  bbox_array_validate(arr);
+  if (arr->size == arr->capacity) {
+    bbox_array_reserve(arr, arr->capacity == 0 ? DEFAULT_INITIAL_CAPACITY
+                                               : arr->capacity * 2);
+  }
+  ++arr->size;
+  bbox_array_set(arr, arr->size - 1, b);
+}
+
+BBox bbox_array_get(const BBoxArray *arr, unsigned i) {
+  assert(i < arr->size && "bbox array index out of bounds");
+  return (BBox){
+      .min_x = arr->min_xs[i],
+      .min_y = arr->min_ys[i],
+      .max_x = arr->max_xs[i],
+      .max_y = arr->max_ys[i],
+  };
+}
+
+void bbox_array_set(BBoxArray *arr, unsigned i, BBox b) {
+  assert(i < arr->size && "bbox array index out of bounds");
+  arr->min_xs[i] = b.min_x;
+  arr->min_ys[i] = b.min_y;
+  arr->max_xs[i] = b.max_x;
+  arr->max_ys[i] = b.max_y;
+}
+
+void bbox_array_clear(BBoxArray *arr) {
+  bbox_array_validate(arr);
+  arr->size = 0;
+}
+
+unsigned bbox_bitmask_words(unsigned n) { return (n + 63) / 64; }
+
+static void overlaps_many_scalar(BBox q, const BBoxArray *arr, unsigned start,
+                                 uint64_t *out) {
+  for (unsigned i = start; i < arr->size; ++i) {
+    bool hit = (arr->min_xs[i] <= q.max_x) & (arr->max_xs[i] >= q.min_x) &
+               (arr->min_ys[i] <= q.max_y) & (arr->max_ys[i] >= q.min_y);
+    out[i / 64] |= (uint64_t)hit << (i % 64);
+  }
+}
+
+#ifdef HAS_X86_KERNELS
+
+__attribute__((target("avx2"))) static void
+overlaps_many_avx2(BBox q, const BBoxArray *arr, uint64_t *out) {
+  __m256d q_min_x = _mm256_set1_pd(q.min_x);
+  __m256d q_min_y = _mm256_set1_pd(q.min_y);
+  __m256d q_max_x = _mm256_set1_pd(q.max_x);
+  __m256d q_max_y = _mm256_set1_pd(q.max_y);
+
+  unsigned i = 0;
+  for (; i + 4 <= arr->size; i += 4) {
+    __m256d overlap = _mm256_and_pd(
+        _mm256_and_pd(_mm256_cmp_pd(_mm256_load_pd(arr->min_xs + i), q_max_x,
+                                    _CMP_LE_OQ),
+                      _mm256_cmp_pd(_mm256_load_pd(arr->max_xs + i), q_min_x,
+                                    _CMP_GE_OQ)),
+        _mm256_and_pd(_mm256_cmp_pd(_mm256_load_pd(arr->min_ys + i), q_max_y,
+                                    _CMP_LE_OQ),
+                      _mm256_cmp_pd(_mm256_load_pd(arr->max_ys + i), q_min_y,
+                                    _CMP_GE_OQ)));
+    uint64_t hits = _mm256_movemask_pd(overlap);
+    out[i / 64] |= hits << (i % 64);
+  }
+  overlaps_many_scalar(q, arr, i, out);
+}
+
+__attribute__((target("avx512f"))) static void
+overlaps_many_avx512(BBox q, const BBoxArray *arr, uint64_t *out) {
+  __m512d q_min_x = _mm512_set1_pd(q.min_x);
+  __m512d q_min_y = _mm512_set1_pd(q.min_y);
+  __m512d q_max_x = _mm512_set1_pd(q.max_x);
+  __m512d q_max_y = _mm512_set1_pd(q.max_y);
+
+  unsigned i = 0;
+  for (; i + 8 <= arr->size; i += 8) {
+    __mmask8 overlap =
+        _mm512_cmp_pd_mask(_mm512_load_pd(arr->min_xs + i), q_max_x,
+                           _CMP_LE_OQ) &
+        _mm512_cmp_pd_mask(_mm512_load_pd(arr->max_xs + i), q_min_x,
+                           _CMP_GE_OQ) &
+        _mm512_cmp_pd_mask(_mm512_load_pd(arr->min_ys + i), q_max_y,
+                           _CMP_LE_OQ) &
+        _mm512_cmp_pd_mask(_mm512_load_pd(arr->max_ys + i), q_min_y,
+                           _CMP_GE_OQ);
+    uint64_t hits = overlap;
+    out[i / 64] |= hits << (i % 64);
+  }
+  overlaps_many_scalar(q, arr, i, out);
+}
+
+#endif
+
+void bbox_overlaps_many(BBox query, const BBoxArray *arr,
+                        uint64_t *out_bitmask) {
+  bbox_array_validate(arr);
+  assert(out_bitmask && "cannot write overlaps to NULL");
+  memset(out_bitmask, 0, sizeof(uint64_t) * bbox_bitmask_words(arr->size));
+  switch (simd_level()) {
+#ifdef HAS_X86_KERNELS
+  case SIMD_AVX512:
+    overlaps_many_avx512(query, arr, out_bitmask);
+    return;
+  case SIMD_AVX2:
+    overlaps_many_avx2(query, arr, out_bitmask);
+    return;
+#endif
+  default:
+    overlaps_many_scalar(query, arr, 0, out_bitmask);
+  }
+}
+
+void bbox_array_validate(const BBoxArray *arr) {
+  assert(arr && "bbox array must not be null");
+  assert(arr->min_xs && arr->min_ys && arr->max_xs && arr->max_ys &&
+         "bbox array buffers must not be null");
+  assert(arr->capacity >= arr->size && "bbox array capacity must be >= size");
+}
@@ -0,0 +1,348 @@
+#include "geometry/structure/kd_tree.h"
+#include "data_structure/parallel.h"
+#include <assert.h>
+#include <stdlib.h>
+
+// Neighbor heaps up to this size live on the stack.
+#define STACK_HEAP_SIZE 64
+
+typedef struct {
+  unsigned lo;
+  unsigned hi;
+  unsigned axis;
+} Range;
+
+static double coord(Point p, unsigned axis) { return axis ? p.y : p.x; }
+
+static double squared_distance(Point a, Point b) {
+  double dx = a.x - b.x;
+  double dy = a.y - b.y;
+  return dx * dx + dy * dy;
+}
+
+static void swap_points(KDTree *tree, unsigned i, unsigned j) {
+  Point p = tree->points[i];
+  tree->points[i] = tree->points[j];
+  tree->points[j] = p;
+  unsigned id = tree->ids[i];
+  tree->ids[i] = tree->ids[j];
+  tree->ids[j] = id;
+}
+
+static double median_of_three(double a, double b, double c) {
+  if (a < b) {
+    return b < c ? b : (a < c ? c : a);
+  }
+  return a < c ? a : (b < c ? c : b);
+}
+
+// Quickselect with a three way partition, so runs of equal coordinates do not
+// degrade it. Moves the point of rank k in [lo, hi) by axis to k.
+static void select_point(KDTree *tree, unsigned lo, unsigned hi, unsigned k,
+                         unsigned axis) {
+  while (hi - lo > 1) {
+    unsigned mid = lo + (hi - lo) / 2;
+    double pivot = median_of_three(coord(tree->points[lo], axis),
+                                   coord(tree->points[mid], axis),
+                                   coord(tree->points[hi - 1], axis));
+    unsigned lt = lo;
+    unsigned i = lo;
+    unsigned gt = hi;
+    while (i < gt) {
+      double v = coord(tree->points[i], axis);
+      if (v < pivot) {
+        swap_points(tree, lt++, i++);
+      } else if (v > pivot) {
+        swap_points(tree, i, --gt);
+      } else {
+        ++i;
+      }
+    }
+    if (k < lt) {
+      hi = lt;
+    } else if (k >= gt) {
+      lo = gt;
+    } else {
+      return;
+    }
+  }
+}
+
+void kd_tree_init(KDTree *tree, const Point *points, unsigned n) {
+  assert((points || n == 0) && "cannot build from NULL points");
+  *tree = (KDTree){
+      .points = malloc(sizeof(Point) * (n ? n : 1)),
+      .ids = malloc(sizeof(unsigned) * (n ? n : 1)),
+      .size = n,
+  };
+  for (unsigned i = 0; i < n; ++i) {
+    tree->points[i] = points[i];
+    tree->ids[i] = i;
+  }
+
+  // Ranges are split in depth first order, so the stack never holds more than
+  // one range per level
+  Range stack[64];
+  unsigned top = 0;
+  stack[top++] = (Range){.lo = 0, .hi = n, .axis = 0};
+  while (top > 0) {
+    Range r = stack[--top];
+    if (r.hi - r.lo <= 1) {
+      continue;
+    }
+    unsigned mid = r.lo + (r.hi - r.lo) / 2;
+    select_point(tree, r.lo, r.hi, mid, r.axis);
+    stack[top++] = (Range){.lo = r.lo, .hi = mid, .axis = r.axis ^ 1};
+    stack[top++] = (Range){.lo = mid + 1, .hi = r.hi, .axis = r.axis ^ 1};
+  }
+}
+
+void kd_tree_free(KDTree *tree) {
+  free(tree->ids);
+  free(tree->points);
+}
+
+// Max heap of the k nearest points found so far, by squared distance.
+typedef struct {
+  double *distances;
+  unsigned *positions;
+  unsigned size;
+  unsigned k;
+} NeighborHeap;
+
+static double heap_bound(const NeighborHeap *heap) {
+  return heap->size < heap->k ? INFINITY : heap->distances[0];
+}
+
+static void heap_sift_down(NeighborHeap *heap, unsigned i) {
+  double d = heap->distances[i];
+  unsigned position = heap->positions[i];
+  for (;;) {
+    unsigned child = 2 * i + 1;
+    if (child >= heap->size) {
+      break;
+    }
+    if (child + 1 < heap->size &&
+        heap->distances[child + 1] > heap->distances[child]) {
+      ++child;
+    }
+    if (heap->distances[child] <= d) {
+      break;
+    }
+    heap->distances[i] = heap->distances[child];
+    heap->positions[i] = heap->positions[child];
+    i = child;
+  }
+  heap->distances[i] = d;
+  heap->positions[i] = position;
+}
+
+static void heap_offer(NeighborHeap *heap, double d, unsigned position) {
+  if (heap->size < heap->k) {
+    unsigned i = heap->size++;
+    while (i > 0 && heap->distances[(i - 1) / 2] < d) {
+      heap->distances[i] = heap->distances[(i - 1) / 2];
+      heap->positions[i] = heap->positions[(i - 1) / 2];
+      i = (i - 1) / 2;
+    }
+    heap->distances[i] = d;
+    heap->positions[i] = position;
+  } else if (d < heap->distances[0]) {
+    heap->distances[0] = d;
+    heap->positions[0] = position;
+    heap_sift_down(heap, 0);
+  }
+}
+
+static void nearest_search(const KDTree *tree, unsigned lo, unsigned hi,
+                           unsigned axis, Point p, NeighborHeap *heap) {
+  while (lo < hi) {
+    unsigned mid = lo + (hi - lo) / 2;
+    Point q = tree->points[mid];
+    heap_offer(heap, squared_distance(p, q), mid);
+    double diff = coord(p, axis) - coord(q, axis);
+    // Search the side of p first, then the other side unless the splitting
+    // line is farther than the kth nearest point so far
+    if (diff < 0) {
+      nearest_search(tree, lo, mid, axis ^ 1, p, heap);
+      lo = mid + 1;
+    } else {
+      nearest_search(tree, mid + 1, hi, axis ^ 1, p, heap);
+      hi = mid;
+    }
+    if (diff * diff >= heap_bound(heap)) {
+      return;
+    }
+    axis ^= 1;
+  }
+}
+
+unsigned kd_tree_nearest(const KDTree *tree, Point p, unsigned k,
+                         unsigned *ids) {
+  double stack_distances[STACK_HEAP_SIZE];
+  unsigned stack_positions[STACK_HEAP_SIZE];
+  bool on_stack = k <= STACK_HEAP_SIZE;
+  NeighborHeap heap = {
+      .distances = on_stack ? stack_distances : malloc(sizeof(double) * k),
+      .positions = on_stack ? stack_positions : malloc(sizeof(unsigned) * k),
+      .size = 0,
+      .k = k,
+  };
+  if (k > 0) {
+    nearest_search(tree, 0, tree->size, 0, p, &heap);
+  }
+
+  // Popping the max heap gives the neighbors farthest first
+  unsigned count = heap.size;
+  while (heap.size > 0) {
+    ids[heap.size - 1] = tree->ids[heap.positions[0]];
+    --heap.size;
+    heap.distances[0] = heap.distances[heap.size];
+    heap.positions[0] = heap.positions[heap.size];
+    heap_sift_down(&heap, 0);
+  }
+  if (!on_stack) {
+    free(heap.positions);
+    free(heap.distances);
+  }
+  return count;
+}
+
+typedef struct {
+  Point center;
+  double radius2;
+  kd_tree_callback_t callback;
+  void *data;
+  unsigned found;
+} RadiusQuery;
+
+static void radius_search(const KDTree *tree, unsigned lo, unsigned hi,
+                          unsigned axis, RadiusQuery *query) {
+  while (lo < hi) {
+    unsigned mid = lo + (hi - lo) / 2;
+    Point q = tree->points[mid];
+    if (squared_distance(query->center, q) <= query->radius2) {
+      ++query->found;
+      query->callback(tree->ids[mid], query->data);
+    }
+    double diff = coord(query->center, axis) - coord(q, axis);
+    bool both = diff * diff <= query->radius2;
+    if (diff < 0) {
+      if (both) {
+        radius_search(tree, mid + 1, hi, axis ^ 1, query);
+      }
+      hi = mid;
+    } else {
+      if (both) {
+        radius_search(tree, lo, mid, axis ^ 1, query);
+      }
+      lo = mid + 1;
+    }
+    axis ^= 1;
+  }
+}
+
+unsigned kd_tree_query_radius(const KDTree *tree, Point p, double radius,
+                              kd_tree_callback_t callback, void *data) {
+  RadiusQuery query = {
+      .center = p,
+      .radius2 = radius * radius,
+      .callback = callback,
+      .data = data,
+      .found = 0,
+  };
+  if (radius >= 0) {
+    radius_search(tree, 0, tree->size, 0, &query);
+  }
+  return query.found;
+}
+
+typedef struct {
+  Point min;
+  Point max;
+  kd_tree_callback_t callback;
+  void *data;
+  unsigned found;
+} BoxQuery;
+
+static void box_search(const KDTree *tree, unsigned lo, unsigned hi,
+                       unsigned axis, BoxQuery *query) {
+  while (lo < hi) {
+    unsigned mid = lo + (hi - lo) / 2;
+    Point q = tree->points[mid];
+    if (q.x >= query->min.x && q.x <= query->max.x && q.y >= query->min.y &&
+        q.y <= query->max.y) {
+      ++query->found;
+      query->callback(tree->ids[mid], query->data);
+    }
+    double split = coord(q, axis);
+    bool left = coord(query->min, axis) <= split;
+    bool right = coord(query->max, axis) >= split;
+    if (left && right) {
+      box_search(tree, lo, mid, axis ^ 1, query);
+      lo = mid + 1;
+    } else if (left) {
+      hi = mid;
+    } else if (right) {
+      lo = mid + 1;
+    } else {
+      return;
+    }
+    axis ^= 1;
+  }
+}
+
+unsigned kd_tree_query_box(const KDTree *tree, Point min, Point max,
+                           kd_tree_callback_t callback, void *data) {
+  BoxQuery query = {
+      .min = min,
+      .max = max,
+      .callback = callback,
+      .data = data,
+      .found = 0,
+  };
+  box_search(tree, 0, tree->size, 0, &query);
+  return query.found;
+}
+
+typedef struct {
+  const KDTree *tree;
+  const Point *queries;
+  unsigned lo;
+  unsigned hi;
+  unsigned k;
+  unsigned *ids;
+  unsigned *counts;
+} NearestChunk;
+
+static void *nearest_chunk(void *data) {
+  NearestChunk *chunk = data;
+  for (unsigned i = chunk->lo; i < chunk->hi; ++i) {
+    unsigned *ids = chunk->ids + (unsigned long)i * chunk->k;
+    chunk->counts[i] =
+        kd_tree_nearest(chunk->tree, chunk->queries[i], chunk->k, ids);
+  }
+  return NULL;
+}
+
+void kd_tree_nearest_batch(const KDTree *tree, const Point *queries,
+                           unsigned m, unsigned k, unsigned *ids,
+                           unsigned *counts, unsigned num_threads) {
+  assert((queries || m == 0) && "cannot query NULL points");
+  assert(num_threads > 0 && "need at least one thread");
+  NearestChunk *chunks = malloc(sizeof(NearestChunk) * num_threads);
+  for (unsigned t = 0; t < num_threads; ++t) {
+    chunks[t] = (NearestChunk){
+        .tree = tree,
+        .queries = queries,
+        .lo = (unsigned)((unsigned long)m * t / num_threads),
+        .hi = (unsigned)((unsigned long)m * (t + 1) / num_threads),
+        .k = k,
+        .ids = ids,
+        .counts = counts,
+    };
+  }
+
+  parallel_for(num_threads, nearest_chunk, chunks, sizeof(NearestChunk));
+  free(chunks);
+}
@@ -0,0 +1,511 @@
+// Polygon, see polygon.h.
+//
+// Point location casts a ray from the point to the right and flips between
+// outside and inside at every edge it crosses. An edge counts if its endpoints
+// are on different sides of the ray's line, with an endpoint on the line
+// counting as above it, so a ray through a vertex counts the two edges there
+// consistently. Whether the crossing is right of the point is the sign of
+// orient2d, which is exact, and a zero orientation within the edge's range
+// puts the point on the boundary.
+#include "geometry/structure/polygon.h"
+#include "data_structure/parallel.h"
+#include "geometry/predicates.h"
+#include <assert.h>
+#include <limits.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Slab indexes list at most this many edges per polygon edge, halving the
+// number of slabs until they fit.
+static const unsigned MAX_SLAB_ENTRIES_PER_EDGE = 4;
+
+static const unsigned DEFAULT_INITIAL_CAPACITY = 16;
+
+void polygon_init(Polygon *poly, const Point *points, unsigned n) {
+  *poly = (Polygon){
+      .points = NULL,
+      .ring_starts = malloc(sizeof(unsigned)),
+      .num_rings = 0,
+      .num_points = 0,
+  };
+  poly->ring_starts[0] = 0;
+  polygon_add_hole(poly, points, n);
+}
+
+void polygon_free(Polygon *poly) {
+  polygon_validate(poly);
+  free(poly->points);
+  free(poly->ring_starts);
+}
+
+void polygon_add_hole(Polygon *poly, const Point *points, unsigned n) {
+  assert(points && "cannot add a NULL ring");
+  assert(n >= 3 && "a ring needs at least three points");
+  poly->points =
+      realloc(poly->points, sizeof(Point) * (poly->num_points + n));
+  memcpy(poly->points + poly->num_points, points, sizeof(Point) * n);
+  poly->num_points += n;
+  ++poly->num_rings;
+  poly->ring_starts =
+      realloc(poly->ring_starts, sizeof(unsigned) * (poly->num_rings + 1));
+  poly->ring_starts[poly->num_rings] = poly->num_points;
+}
+
+unsigned polygon_ring_size(const Polygon *poly, unsigned ring) {
+  assert(ring < poly->num_rings && "polygon ring out of bounds");
+  return poly->ring_starts[ring + 1] - poly->ring_starts[ring];
+}
+
+Segment polygon_edge(const Polygon *poly, unsigned ring, unsigned i) {
+  unsigned size = polygon_ring_size(poly, ring);
+  assert(i < size && "polygon edge out of bounds");
+  const Point *points = poly->points + poly->ring_starts[ring];
+  return (Segment){.p0 = points[i], .p1 = points[i + 1 < size ? i + 1 : 0]};
+}
+
+// Shoelace formula, relative to the first point to keep the products small.
+static double ring_signed_area(const Point *points, unsigned size) {
+  Point origin = points[0];
+  double sum = 0;
+  for (unsigned i = 1; i + 1 < size; ++i) {
+    sum += (points[i].x - origin.x) * (points[i + 1].y - origin.y) -
+           (points[i + 1].x - origin.x) * (points[i].y - origin.y);
+  }
+  return sum / 2;
+}
+
+static void reverse_ring(Point *points, unsigned size) {
+  for (unsigned i = 0, j = size - 1; i < j; ++i, --j) {
+    Point t = points[i];
+    points[i] = points[j];
+    points[j] = t;
+  }
+}
+
+double polygon_ring_signed_area(const Polygon *poly, unsigned ring) {
+  return ring_signed_area(poly->points + poly->ring_starts[ring],
+                          polygon_ring_size(poly, ring));
+}
+
+double polygon_area(const Polygon *poly) {
+  polygon_validate(poly);
+  double area = fabs(polygon_ring_signed_area(poly, 0));
+  for (unsigned r = 1; r < poly->num_rings; ++r) {
+    area -= fabs(polygon_ring_signed_area(poly, r));
+  }
+  return area;
+}
+
+bool polygon_is_ccw(const Polygon *poly) {
+  polygon_validate(poly);
+  return polygon_ring_signed_area(poly, 0) > 0;
+}
+
+void polygon_orient(Polygon *poly) {
+  polygon_validate(poly);
+  for (unsigned r = 0; r < poly->num_rings; ++r) {
+    bool ccw = polygon_ring_signed_area(poly, r) > 0;
+    if (ccw == (r == 0)) {
+      continue;
+    }
+    reverse_ring(poly->points + poly->ring_starts[r],
+                 polygon_ring_size(poly, r));
+  }
+}
+
+BBox polygon_bbox(const Polygon *poly) {
+  polygon_validate(poly);
+  BBox b = bbox_from_point(poly->points[0]);
+  for (unsigned i = 1; i < poly->num_points; ++i) {
+    b = bbox_union(b, bbox_from_point(poly->points[i]));
+  }
+  return b;
+}
+
+// Tests the edge from a to b against the ray cast from p to the right.
+// Returns true if p lies on the edge, and otherwise flips *inside if the ray
+// crosses the edge.
+static bool cross_edge(Point a, Point b, Point p, bool *inside) {
+  if ((a.y < p.y && b.y < p.y) || (a.y > p.y && b.y > p.y)) {
+    return false;
+  }
+  double o = orient2d(a, b, p);
+  if (o == 0) {
+    // p is on the edge's line within its y range. That is on the edge unless
+    // the edge is horizontal and p is past one of its ends.
+    return p.x >= bbox_min(a.x, b.x) && p.x <= bbox_max(a.x, b.x);
+  }
+  if ((a.y > p.y) != (b.y > p.y) && (b.y > a.y) == (o > 0)) {
+    *inside = !*inside;
+  }
+  return false;
+}
+
+// Even-odd location over rings stored as in Polygon.
+static PolygonLocation locate_rings(const Point *points,
+                                    const unsigned *ring_starts,
+                                    unsigned num_rings, Point p) {
+  bool inside = false;
+  for (unsigned r = 0; r < num_rings; ++r) {
+    const Point *ring = points + ring_starts[r];
+    unsigned size = ring_starts[r + 1] - ring_starts[r];
+    for (unsigned i = 0, j = size - 1; i < size; j = i++) {
+      if (cross_edge(ring[j], ring[i], p, &inside)) {
+        return POLYGON_BOUNDARY;
+      }
+    }
+  }
+  return inside ? POLYGON_INSIDE : POLYGON_OUTSIDE;
+}
+
+PolygonLocation polygon_locate(const Polygon *poly, Point p) {
+  polygon_validate(poly);
+  return locate_rings(poly->points, poly->ring_starts, poly->num_rings, p);
+}
+
+void polygon_validate(const Polygon *poly) {
+  assert(poly && "polygon must not be null");
+  assert(poly->num_rings > 0 && "polygon needs an outer ring");
+  assert(poly->points && poly->ring_starts &&
+         "polygon buffers must not be null");
+  assert(poly->ring_starts[poly->num_rings] == poly->num_points &&
+         "polygon ring starts out of sync");
+}
+
+void polygon_set_init(PolygonSet *set) {
+  *set = (PolygonSet){
+      .points = malloc(sizeof(Point) * DEFAULT_INITIAL_CAPACITY),
+      .ring_starts = malloc(sizeof(unsigned) * DEFAULT_INITIAL_CAPACITY),
+      .polygon_starts = malloc(sizeof(unsigned) * DEFAULT_INITIAL_CAPACITY),
+      .num_points = 0,
+      .num_rings = 0,
+      .num_polygons = 0,
+      .points_capacity = DEFAULT_INITIAL_CAPACITY,
+      .rings_capacity = DEFAULT_INITIAL_CAPACITY,
+      .polygons_capacity = DEFAULT_INITIAL_CAPACITY,
+  };
+  set->ring_starts[0] = 0;
+  set->polygon_starts[0] = 0;
+}
+
+void polygon_set_free(PolygonSet *set) {
+  polygon_set_validate(set);
+  free(set->points);
+  free(set->ring_starts);
+  free(set->polygon_starts);
+}
+
+void polygon_set_clear(PolygonSet *set) {
+  polygon_set_validate(set);
+  set->num_points = 0;
+  set->num_rings = 0;
+  set->num_polygons = 0;
+}
+
+void polygon_set_add_ring(PolygonSet *set, const Point *points, unsigned n,
+                          bool is_hole) {
+  polygon_set_validate(set);
+  assert(n >= 3 && "a ring needs at least three points");
+  assert((set->num_polygons > 0 || !is_hole) && "a hole needs a polygon");
+  while (set->num_points + n > set->points_capacity) {
+    set->points_capacity *= 2;
+    set->points = realloc(set->points, sizeof(Point) * set->points_capacity);
+  }
+  // The starts arrays hold one more entry than there are rings or polygons
+  if (set->num_rings + 2 > set->rings_capacity) {
+    set->rings_capacity *= 2;
+    set->ring_starts =
+        realloc(set->ring_starts, sizeof(unsigned) * set->rings_capacity);
+  }
+  if (set->num_polygons + 2 > set->polygons_capacity) {
+    set->polygons_capacity *= 2;
+    set->polygon_starts = realloc(set->polygon_starts,
+                                  sizeof(unsigned) * set->polygons_capacity);
+  }
+
+  Point *ring = set->points + set->num_points;
+  memcpy(ring, points, sizeof(Point) * n);
+  if ((ring_signed_area(ring, n) > 0) == is_hole) {
+    reverse_ring(ring, n);
+  }
+  set->num_points += n;
+  set->ring_starts[++set->num_rings] = set->num_points;
+  if (!is_hole) {
+    ++set->num_polygons;
+  }
+  set->polygon_starts[set->num_polygons] = set->num_rings;
+}
+
+void polygon_set_add_polygon(PolygonSet *set, const Polygon *poly) {
+  polygon_validate(poly);
+  for (unsigned r = 0; r < poly->num_rings; ++r) {
+    polygon_set_add_ring(set, poly->points + poly->ring_starts[r],
+                         polygon_ring_size(poly, r), r > 0);
+  }
+}
+
+void polygon_set_get(const PolygonSet *set, unsigned i, Polygon *out) {
+  polygon_set_validate(set);
+  assert(i < set->num_polygons && "polygon set index out of bounds");
+  for (unsigned r = set->polygon_starts[i]; r < set->polygon_starts[i + 1];
+       ++r) {
+    const Point *points = set->points + set->ring_starts[r];
+    unsigned size = set->ring_starts[r + 1] - set->ring_starts[r];
+    if (r == set->polygon_starts[i]) {
+      polygon_init(out, points, size);
+    } else {
+      polygon_add_hole(out, points, size);
+    }
+  }
+}
+
+double polygon_set_area(const PolygonSet *set) {
+  polygon_set_validate(set);
+  // Holes wind clockwise, so their signed areas subtract
+  double area = 0;
+  for (unsigned r = 0; r < set->num_rings; ++r) {
+    area += ring_signed_area(set->points + set->ring_starts[r],
+                             set->ring_starts[r + 1] - set->ring_starts[r]);
+  }
+  return area;
+}
+
+PolygonLocation polygon_set_locate(const PolygonSet *set, Point p) {
+  polygon_set_validate(set);
+  return locate_rings(set->points, set->ring_starts, set->num_rings, p);
+}
+
+void polygon_set_validate(const PolygonSet *set) {
+  assert(set && "polygon set must not be null");
+  assert(set->points && set->ring_starts && set->polygon_starts &&
+         "polygon set buffers must not be null");
+  assert(set->ring_starts[set->num_rings] == set->num_points &&
+         "polygon set ring starts out of sync");
+  assert(set->polygon_starts[set->num_polygons] == set->num_rings &&
+         "polygon set polygon starts out of sync");
+  assert(set->num_points <= set->points_capacity &&
+         set->num_rings < set->rings_capacity &&
+         set->num_polygons < set->polygons_capacity &&
+         "polygon set capacity must be >= size");
+}
+
+// The slab holding y, clamped to the slabs.
+static unsigned slab_of(const PolygonSlabs *slabs, double y) {
+  double s = (y - slabs->box.min_y) * slabs->scale;
+  return s <= 0 ? 0
+         : s >= slabs->num_slabs - 1 ? slabs->num_slabs - 1
+                                     : (unsigned)s;
+}
+
+static void set_slabs(PolygonSlabs *slabs, unsigned num_slabs) {
+  double height = slabs->box.max_y - slabs->box.min_y;
+  slabs->num_slabs = num_slabs;
+  slabs->scale = height > 0 ? num_slabs / height : 0;
+}
+
+void polygon_slabs_init(PolygonSlabs *slabs, const Polygon *poly) {
+  polygon_validate(poly);
+  unsigned n = poly->num_points;
+  slabs->box = polygon_bbox(poly);
+  Segment *edges = malloc(sizeof(Segment) * n);
+  for (unsigned r = 0, k = 0; r < poly->num_rings; ++r) {
+    for (unsigned i = 0; i < polygon_ring_size(poly, r); ++i) {
+      edges[k++] = polygon_edge(poly, r, i);
+    }
+  }
+
+  // Start with a slab per edge and halve the slabs while long edges would be
+  // listed too often. A flat polygon needs just the one.
+  set_slabs(slabs, slabs->box.max_y > slabs->box.min_y ? n : 1);
+  for (;;) {
+    unsigned long entries = 0;
+    for (unsigned i = 0; i < n; ++i) {
+      BBox b = bbox_from_segment(edges[i]);
+      entries += slab_of(slabs, b.max_y) - slab_of(slabs, b.min_y) + 1;
+    }
+    if (slabs->num_slabs == 1 ||
+        entries <= (unsigned long)MAX_SLAB_ENTRIES_PER_EDGE * n) {
+      break;
+    }
+    set_slabs(slabs, slabs->num_slabs / 2);
+  }
+
+  // Count the edges of each slab, then place them
+  unsigned num_slabs = slabs->num_slabs;
+  slabs->slab_starts = calloc(num_slabs + 1, sizeof(unsigned));
+  for (unsigned i = 0; i < n; ++i) {
+    BBox b = bbox_from_segment(edges[i]);
+    for (unsigned s = slab_of(slabs, b.min_y); s <= slab_of(slabs, b.max_y);
+         ++s) {
+      ++slabs->slab_starts[s + 1];
+    }
+  }
+  for (unsigned s = 0; s < num_slabs; ++s) {
+    slabs->slab_starts[s + 1] += slabs->slab_starts[s];
+  }
+  slabs->edges = malloc(sizeof(Segment) * slabs->slab_starts[num_slabs]);
+  unsigned *next = malloc(sizeof(unsigned) * num_slabs);
+  memcpy(next, slabs->slab_starts, sizeof(unsigned) * num_slabs);
+  for (unsigned i = 0; i < n; ++i) {
+    BBox b = bbox_from_segment(edges[i]);
+    for (unsigned s = slab_of(slabs, b.min_y); s <= slab_of(slabs, b.max_y);
+         ++s) {
+      slabs->edges[next[s]++] = edges[i];
+    }
+  }
+  free(next);
+  free(edges);
+}
+
+void polygon_slabs_free(PolygonSlabs *slabs) {
+  free(slabs->slab_starts);
+  free(slabs->edges);
+}
+
+PolygonLocation polygon_slabs_locate(const PolygonSlabs *slabs, Point p) {
+  if (!bbox_contains_point(slabs->box, p)) {
+    return POLYGON_OUTSIDE;
+  }
+  unsigned s = slab_of(slabs, p.y);
+  bool inside = false;
+  for (unsigned i = slabs->slab_starts[s]; i < slabs->slab_starts[s + 1];
+       ++i) {
+    if (cross_edge(slabs->edges[i].p0, slabs->edges[i].p1, p, &inside)) {
+      return POLYGON_BOUNDARY;
+    }
+  }
+  return inside ? POLYGON_INSIDE : POLYGON_OUTSIDE;
+}
+
+typedef struct {
+  const PolygonSlabs *slabs;
+  const PolygonIndex *index;
+  const Point *points;
+  unsigned lo;
+  unsigned hi;
+  PolygonLocation *locations;
+  unsigned *ids;
+} LocateChunk;
+
+// Splits [0, n) into num_threads chunks and runs each through run, with the
+// calling thread taking the first chunk.
+static void run_chunks(LocateChunk base, unsigned n, unsigned num_threads,
+                       void *(*run)(void *)) {
+  assert(num_threads > 0 && "need at least one thread");
+  LocateChunk *chunks = malloc(sizeof(LocateChunk) * num_threads);
+  for (unsigned t = 0; t < num_threads; ++t) {
+    chunks[t] = base;
+    chunks[t].lo = (unsigned)((unsigned long)n * t / num_threads);
+    chunks[t].hi = (unsigned)((unsigned long)n * (t + 1) / num_threads);
+  }
+  parallel_for(num_threads, run, chunks, sizeof(LocateChunk));
+  free(chunks);
+}
+
+static void *slabs_chunk(void *data) {
+  LocateChunk *chunk = data;
+  for (unsigned i = chunk->lo; i < chunk->hi; ++i) {
+    chunk->locations[i] = polygon_slabs_locate(chunk->slabs, chunk->points[i]);
+  }
+  return NULL;
+}
+
+void polygon_slabs_locate_many(const PolygonSlabs *slabs, const Point *points,
+                               unsigned n, PolygonLocation *out,
+                               unsigned num_threads) {
+  assert((points || n == 0) && "cannot locate NULL points");
+  run_chunks((LocateChunk){.slabs = slabs, .points = points, .locations = out},
+             n, num_threads, slabs_chunk);
+}
+
+typedef struct {
+  const Polygon *polygons;
+  PolygonSlabs *slabs;
+  unsigned lo;
+  unsigned hi;
+} BuildChunk;
+
+static void *build_chunk(void *data) {
+  BuildChunk *chunk = data;
+  for (unsigned i = chunk->lo; i < chunk->hi; ++i) {
+    polygon_slabs_init(&chunk->slabs[i], &chunk->polygons[i]);
+  }
+  return NULL;
+}
+
+void polygon_index_init(PolygonIndex *index, const Polygon *polygons,
+                        unsigned n, unsigned num_threads) {
+  assert((polygons || n == 0) && "cannot index NULL polygons");
+  assert(num_threads > 0 && "need at least one thread");
+  index->slabs = malloc(sizeof(PolygonSlabs) * (n > 0 ? n : 1));
+  index->size = n;
+
+  BuildChunk *chunks = malloc(sizeof(BuildChunk) * num_threads);
+  for (unsigned t = 0; t < num_threads; ++t) {
+    chunks[t] = (BuildChunk){
+        .polygons = polygons,
+        .slabs = index->slabs,
+        .lo = (unsigned)((unsigned long)n * t / num_threads),
+        .hi = (unsigned)((unsigned long)n * (t + 1) / num_threads),
+    };
+  }
+  parallel_for(num_threads, build_chunk, chunks, sizeof(BuildChunk));
+  free(chunks);
+
+  Segment *diagonals = malloc(sizeof(Segment) * (n > 0 ? n : 1));
+  for (unsigned i = 0; i < n; ++i) {
+    BBox b = index->slabs[i].box;
+    diagonals[i] = segment_from_coords(b.min_x, b.min_y, b.max_x, b.max_y);
+  }
+  rtree_init(&index->boxes);
+  rtree_bulk_load(&index->boxes, diagonals, n, num_threads);
+  free(diagonals);
+}
+
+void polygon_index_free(PolygonIndex *index) {
+  for (unsigned i = 0; i < index->size; ++i) {
+    polygon_slabs_free(&index->slabs[i]);
+  }
+  free(index->slabs);
+  rtree_free(&index->boxes);
+}
+
+typedef struct {
+  const PolygonIndex *index;
+  Point p;
+  unsigned best;
+} IndexQuery;
+
+static void index_candidate(unsigned id, void *data) {
+  IndexQuery *query = data;
+  if (id < query->best && polygon_slabs_locate(&query->index->slabs[id],
+                                               query->p) != POLYGON_OUTSIDE) {
+    query->best = id;
+  }
+}
+
+unsigned polygon_index_locate(const PolygonIndex *index, Point p) {
+  IndexQuery query = {.index = index, .p = p, .best = UINT_MAX};
+  // The boxes a single point segment passes through are the boxes that
+  // contain the point
+  rtree_query_segment(&index->boxes, (Segment){.p0 = p, .p1 = p},
+                      index_candidate, &query);
+  return query.best;
+}
+
+static void *index_chunk(void *data) {
+  LocateChunk *chunk = data;
+  for (unsigned i = chunk->lo; i < chunk->hi; ++i) {
+    chunk->ids[i] = polygon_index_locate(chunk->index, chunk->points[i]);
+  }
+  return NULL;
+}
+
+void polygon_index_locate_many(const PolygonIndex *index, const Point *points,
+                               unsigned n, unsigned *out,
+                               unsigned num_threads) {
+  assert((points || n == 0) && "cannot locate NULL points");
+  run_chunks((LocateChunk){.index = index, .points = points, .ids = out}, n,
+             num_threads, index_chunk);
+}
@@ -0,0 +1,131 @@
+#include "geometry/structure/polyline.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const unsigned DEFAULT_INITIAL_CAPACITY = 16;
+
+void polyline_init(Polyline *line, const Point *points, unsigned n) {
+  assert((points || n == 0) && "cannot copy NULL points");
+  *line = (Polyline){
+      .points = malloc(sizeof(Point) * (n > 0 ? n : 1)),
+      .num_points = n,
+  };
+  if (n > 0) {
+    memcpy(line->points, points, sizeof(Point) * n);
+  }
+}
+
+void polyline_free(Polyline *line) {
+  polyline_validate(line);
+  free(line->points);
+}
+
+Segment polyline_segment(const Polyline *line, unsigned i) {
+  assert(i + 1 < line->num_points && "polyline segment out of bounds");
+  return (Segment){line->points[i], line->points[i + 1]};
+}
+
+double polyline_length(const Polyline *line) {
+  polyline_validate(line);
+  double length = 0;
+  for (unsigned i = 1; i < line->num_points; ++i) {
+    length += point_distance(line->points[i - 1], line->points[i]);
+  }
+  return length;
+}
+
+BBox polyline_bbox(const Polyline *line) {
+  polyline_validate(line);
+  assert(line->num_points > 0 && "an empty polyline has no box");
+  BBox box = bbox_from_point(line->points[0]);
+  for (unsigned i = 1; i < line->num_points; ++i) {
+    box = bbox_union(box, bbox_from_point(line->points[i]));
+  }
+  return box;
+}
+
+void polyline_validate(const Polyline *line) {
+  assert(line && "polyline must not be null");
+  assert(line->points && "polyline points must not be null");
+}
+
+void polyline_set_init(PolylineSet *set) {
+  *set = (PolylineSet){
+      .points = malloc(sizeof(Point) * DEFAULT_INITIAL_CAPACITY),
+      .line_starts = malloc(sizeof(unsigned) * DEFAULT_INITIAL_CAPACITY),
+      .num_points = 0,
+      .num_lines = 0,
+      .points_capacity = DEFAULT_INITIAL_CAPACITY,
+      .lines_capacity = DEFAULT_INITIAL_CAPACITY,
+  };
+  set->line_starts[0] = 0;
+}
+
+void polyline_set_free(PolylineSet *set) {
+  polyline_set_validate(set);
+  free(set->points);
+  free(set->line_starts);
+}
+
+void polyline_set_clear(PolylineSet *set) {
+  polyline_set_validate(set);
+  set->num_points = 0;
+  set->num_lines = 0;
+}
+
+void polyline_set_reserve(PolylineSet *set, unsigned num_points,
+                          unsigned num_lines) {
+  polyline_set_validate(set);
+  if (num_points > set->points_capacity) {
+    set->points_capacity = num_points;
+    set->points = realloc(set->points, sizeof(Point) * set->points_capacity);
+  }
+  // line_starts holds one more entry than there are lines
+  if (num_lines + 1 > set->lines_capacity) {
+    set->lines_capacity = num_lines + 1;
+    set->line_starts =
+        realloc(set->line_starts, sizeof(unsigned) * set->lines_capacity);
+  }
+}
+
+void polyline_set_add(PolylineSet *set, const Point *points, unsigned n) {
+  polyline_set_validate(set);
+  assert((points || n == 0) && "cannot add NULL points");
+  unsigned points_capacity = set->points_capacity;
+  while (set->num_points + n > points_capacity) {
+    points_capacity *= 2;
+  }
+  unsigned lines_capacity = set->lines_capacity;
+  while (set->num_lines + 2 > lines_capacity) {
+    lines_capacity *= 2;
+  }
+  polyline_set_reserve(set, points_capacity, lines_capacity - 1);
+  if (n > 0) {
+    memcpy(set->points + set->num_points, points, sizeof(Point) * n);
+  }
+  set->num_points += n;
+  set->line_starts[++set->num_lines] = set->num_points;
+}
+
+unsigned polyline_set_line_size(const PolylineSet *set, unsigned i) {
+  assert(i < set->num_lines && "polyline set index out of bounds");
+  return set->line_starts[i + 1] - set->line_starts[i];
+}
+
+void polyline_set_get(const PolylineSet *set, unsigned i, Polyline *out) {
+  polyline_set_validate(set);
+  polyline_init(out, set->points + set->line_starts[i],
+                polyline_set_line_size(set, i));
+}
+
+void polyline_set_validate(const PolylineSet *set) {
+  assert(set && "polyline set must not be null");
+  assert(set->points && set->line_starts &&
+         "polyline set buffers must not be null");
+  assert(set->line_starts[set->num_lines] == set->num_points &&
+         "polyline set line starts out of sync");
+  assert(set->num_points <= set->points_capacity &&
+         set->num_lines < set->lines_capacity &&
+         "polyline set capacity must be >= size");
+}
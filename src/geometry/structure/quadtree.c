@@ -0,0 +1,560 @@
+#include "geometry/structure/quadtree.h"
+#include "geometry/structure/bbox.h"
+#include "data_structure/priority_queue.h"
+#include <assert.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+static const unsigned DEFAULT_INITIAL_CAPACITY = 16;
+static const unsigned NO_NODE = UINT_MAX;
+static const unsigned NO_ITEM = UINT_MAX;
+static const unsigned ROOT = 0;
+
+// Where an item goes: the center of its bounding box and half its longer side.
+typedef struct {
+  Point center;
+  double half;
+} Extent;
+
+static Extent segment_extent(Segment s) {
+  BBox b = bbox_from_segment(s);
+  return (Extent){
+      .center = {(b.min_x + b.max_x) / 2, (b.min_y + b.max_y) / 2},
+      .half = fmax(b.max_x - b.min_x, b.max_y - b.min_y) / 2,
+  };
+}
+
+// The loose cell, twice the size of the cell.
+static BBox loose_box(const QuadTreeNode *node) {
+  double reach = 2 * node->half;
+  return (BBox){
+      .min_x = node->center_x - reach,
+      .min_y = node->center_y - reach,
+      .max_x = node->center_x + reach,
+      .max_y = node->center_y + reach,
+  };
+}
+
+static double squared_distance_to_segment(Segment s, Point p) {
+  double dx = s.p1.x - s.p0.x;
+  double dy = s.p1.y - s.p0.y;
+  double length2 = dx * dx + dy * dy;
+  double t = length2 > 0
+                 ? ((p.x - s.p0.x) * dx + (p.y - s.p0.y) * dy) / length2
+                 : 0;
+  t = fmax(0, fmin(1, t));
+  double ex = s.p0.x + t * dx - p.x;
+  double ey = s.p0.y + t * dy - p.y;
+  return ex * ex + ey * ey;
+}
+
+static void *index_ptr(unsigned i) { return (void *)(uintptr_t)i; }
+
+static unsigned ptr_index(void *ptr) { return (unsigned)(uintptr_t)ptr; }
+
+// Whether the closed cell of a node contains p.
+static bool in_cell(const QuadTreeNode *node, Point p) {
+  return p.x >= node->center_x - node->half &&
+         p.x <= node->center_x + node->half &&
+         p.y >= node->center_y - node->half &&
+         p.y <= node->center_y + node->half;
+}
+
+static unsigned quadrant(const QuadTreeNode *node, Point p) {
+  return (p.x >= node->center_x) | (p.y >= node->center_y) << 1;
+}
+
+// The child of a node that an item would move down into, or NO_NODE if it
+// stays in the node.
+static unsigned child_for(const QuadTree *tree, unsigned index, Extent e) {
+  const QuadTreeNode *node = &tree->nodes[index];
+  if (node->first_child == NO_NODE ||
+      (index == ROOT && !in_cell(node, e.center))) {
+    return NO_NODE;
+  }
+  unsigned child = node->first_child + quadrant(node, e.center);
+  return e.half <= tree->nodes[child].half ? child : NO_NODE;
+}
+
+// Returns the first node of a block of four. May move the node array.
+static unsigned alloc_block(QuadTree *tree) {
+  if (tree->free_blocks.size > 0) {
+    return ptr_index(vector_pop_back(&tree->free_blocks));
+  }
+  if (tree->num_nodes + 4 > tree->node_capacity) {
+    tree->node_capacity *= 2;
+    tree->nodes =
+        realloc(tree->nodes, sizeof(QuadTreeNode) * tree->node_capacity);
+  }
+  unsigned first = tree->num_nodes;
+  tree->num_nodes += 4;
+  return first;
+}
+
+static void link_item(QuadTree *tree, unsigned index, unsigned id) {
+  QuadTreeNode *node = &tree->nodes[index];
+  tree->prev[id] = NO_ITEM;
+  tree->next[id] = node->head;
+  if (node->head != NO_ITEM) {
+    tree->prev[node->head] = id;
+  }
+  node->head = id;
+  ++node->count;
+  tree->item_node[id] = index;
+}
+
+static void unlink_item(QuadTree *tree, unsigned id) {
+  QuadTreeNode *node = &tree->nodes[tree->item_node[id]];
+  if (tree->prev[id] != NO_ITEM) {
+    tree->next[tree->prev[id]] = tree->next[id];
+  } else {
+    node->head = tree->next[id];
+  }
+  if (tree->next[id] != NO_ITEM) {
+    tree->prev[tree->next[id]] = tree->prev[id];
+  }
+  --node->count;
+}
+
+// Gives a leaf four children and moves the items that fit into them down.
+static void split(QuadTree *tree, unsigned index) {
+  unsigned first = alloc_block(tree);
+  QuadTreeNode *node = &tree->nodes[index];
+  double quarter = node->half / 2;
+  for (unsigned q = 0; q < 4; ++q) {
+    tree->nodes[first + q] = (QuadTreeNode){
+        .center_x = node->center_x + (q & 1 ? quarter : -quarter),
+        .center_y = node->center_y + (q & 2 ? quarter : -quarter),
+        .half = quarter,
+        .first_child = NO_NODE,
+        .parent = index,
+        .head = NO_ITEM,
+        .count = 0,
+        .total = 0,
+    };
+  }
+  node->first_child = first;
+
+  unsigned id = node->head;
+  while (id != NO_ITEM) {
+    unsigned next = tree->next[id];
+    unsigned child = child_for(tree, index, segment_extent(tree->items[id]));
+    if (child != NO_NODE) {
+      unlink_item(tree, id);
+      link_item(tree, child, id);
+      ++tree->nodes[child].total;
+    }
+    id = next;
+  }
+  for (unsigned q = 0; q < 4; ++q) {
+    QuadTreeNode *child = &tree->nodes[first + q];
+    if (child->count > QUADTREE_NODE_CAPACITY && child->half > tree->min_half) {
+      split(tree, first + q);
+    }
+  }
+}
+
+// Moves the items of a subtree into a node and frees the subtree's blocks.
+static void absorb(QuadTree *tree, unsigned index, unsigned from) {
+  while (tree->nodes[from].head != NO_ITEM) {
+    unsigned id = tree->nodes[from].head;
+    unlink_item(tree, id);
+    link_item(tree, index, id);
+  }
+  unsigned first = tree->nodes[from].first_child;
+  if (first != NO_NODE) {
+    for (unsigned q = 0; q < 4; ++q) {
+      absorb(tree, index, first + q);
+    }
+    vector_push(&tree->free_blocks, index_ptr(first));
+    tree->nodes[from].first_child = NO_NODE;
+  }
+}
+
+static void merge(QuadTree *tree, unsigned index) {
+  unsigned first = tree->nodes[index].first_child;
+  for (unsigned q = 0; q < 4; ++q) {
+    absorb(tree, index, first + q);
+  }
+  vector_push(&tree->free_blocks, index_ptr(first));
+  tree->nodes[index].first_child = NO_NODE;
+}
+
+static void insert_item(QuadTree *tree, unsigned id);
+
+// Doubles the root until its cell contains p. The old root becomes one of the
+// new root's children, and its items are inserted again since they may now fit
+// further down or belong to another child.
+static void grow(QuadTree *tree, Point p) {
+  while (isfinite(p.x) && isfinite(p.y) && !in_cell(&tree->nodes[ROOT], p)) {
+    unsigned first = alloc_block(tree);
+    QuadTreeNode old = tree->nodes[ROOT];
+    double center_x = old.center_x + (p.x < old.center_x ? -1 : 1) * old.half;
+    double center_y = old.center_y + (p.y < old.center_y ? -1 : 1) * old.half;
+    for (unsigned q = 0; q < 4; ++q) {
+      tree->nodes[first + q] = (QuadTreeNode){
+          .center_x = center_x + (q & 1 ? old.half : -old.half),
+          .center_y = center_y + (q & 2 ? old.half : -old.half),
+          .half = old.half,
+          .first_child = NO_NODE,
+          .parent = ROOT,
+          .head = NO_ITEM,
+          .count = 0,
+          .total = 0,
+      };
+    }
+    unsigned moved = first + ((old.center_x >= center_x) |
+                              (old.center_y >= center_y) << 1);
+    tree->nodes[moved].first_child = old.first_child;
+    tree->nodes[moved].total = old.total - old.count;
+    if (old.first_child != NO_NODE) {
+      for (unsigned q = 0; q < 4; ++q) {
+        tree->nodes[old.first_child + q].parent = moved;
+      }
+    }
+    tree->nodes[ROOT] = (QuadTreeNode){
+        .center_x = center_x,
+        .center_y = center_y,
+        .half = 2 * old.half,
+        .first_child = first,
+        .parent = NO_NODE,
+        .head = NO_ITEM,
+        .count = 0,
+        .total = old.total - old.count,
+    };
+    unsigned id = old.head;
+    while (id != NO_ITEM) {
+      unsigned next = tree->next[id];
+      insert_item(tree, id);
+      id = next;
+    }
+  }
+}
+
+// Links an item into the deepest node under index that it fits in. The item
+// is already counted in the total of index.
+static void place(QuadTree *tree, unsigned index, unsigned id, Extent e) {
+  for (unsigned child; (child = child_for(tree, index, e)) != NO_NODE;) {
+    index = child;
+    ++tree->nodes[index].total;
+  }
+  link_item(tree, index, id);
+  QuadTreeNode *node = &tree->nodes[index];
+  if (node->first_child == NO_NODE && node->count > QUADTREE_NODE_CAPACITY &&
+      node->half > tree->min_half) {
+    split(tree, index);
+  }
+}
+
+static void insert_item(QuadTree *tree, unsigned id) {
+  Extent e = segment_extent(tree->items[id]);
+  grow(tree, e.center);
+  ++tree->nodes[ROOT].total;
+  place(tree, ROOT, id, e);
+}
+
+static void remove_item(QuadTree *tree, unsigned id) {
+  unsigned index = tree->item_node[id];
+  unlink_item(tree, id);
+  // Merge at the highest ancestor that became sparse
+  unsigned sparse = NO_NODE;
+  for (; index != NO_NODE; index = tree->nodes[index].parent) {
+    QuadTreeNode *node = &tree->nodes[index];
+    --node->total;
+    if (node->first_child != NO_NODE &&
+        node->total <= QUADTREE_MERGE_THRESHOLD) {
+      sparse = index;
+    }
+  }
+  if (sparse != NO_NODE) {
+    merge(tree, sparse);
+  }
+}
+
+void quadtree_init(QuadTree *tree, Point min, Point max) {
+  double half = fmax(max.x - min.x, max.y - min.y) / 2;
+  // The root has to have a size to be able to grow
+  if (!(half > 0)) {
+    half = 1;
+  }
+  *tree = (QuadTree){
+      .nodes = malloc(sizeof(QuadTreeNode) * DEFAULT_INITIAL_CAPACITY),
+      .num_nodes = 1,
+      .node_capacity = DEFAULT_INITIAL_CAPACITY,
+      .items = malloc(sizeof(Segment) * DEFAULT_INITIAL_CAPACITY),
+      .item_node = malloc(sizeof(unsigned) * DEFAULT_INITIAL_CAPACITY),
+      .next = malloc(sizeof(unsigned) * DEFAULT_INITIAL_CAPACITY),
+      .prev = malloc(sizeof(unsigned) * DEFAULT_INITIAL_CAPACITY),
+      .alive = malloc(sizeof(bool) * DEFAULT_INITIAL_CAPACITY),
+      .min_half = ldexp(half, -QUADTREE_MAX_DEPTH),
+      .size = 0,
+      .end = 0,
+      .capacity = DEFAULT_INITIAL_CAPACITY,
+  };
+  tree->nodes[ROOT] = (QuadTreeNode){
+      .center_x = min.x + half,
+      .center_y = min.y + half,
+      .half = half,
+      .first_child = NO_NODE,
+      .parent = NO_NODE,
+      .head = NO_ITEM,
+      .count = 0,
+      .total = 0,
+  };
+  vector_init(&tree->free_blocks);
+  vector_init(&tree->free_ids);
+}
+
+void quadtree_free(QuadTree *tree) {
+  vector_free(&tree->free_ids);
+  vector_free(&tree->free_blocks);
+  free(tree->alive);
+  free(tree->prev);
+  free(tree->next);
+  free(tree->item_node);
+  free(tree->items);
+  free(tree->nodes);
+}
+
+unsigned quadtree_insert_segment(QuadTree *tree, Segment s) {
+  unsigned id;
+  if (tree->free_ids.size > 0) {
+    id = ptr_index(vector_pop_back(&tree->free_ids));
+  } else {
+    if (tree->end == tree->capacity) {
+      tree->capacity *= 2;
+      tree->items = realloc(tree->items, sizeof(Segment) * tree->capacity);
+      tree->item_node =
+          realloc(tree->item_node, sizeof(unsigned) * tree->capacity);
+      tree->next = realloc(tree->next, sizeof(unsigned) * tree->capacity);
+      tree->prev = realloc(tree->prev, sizeof(unsigned) * tree->capacity);
+      tree->alive = realloc(tree->alive, sizeof(bool) * tree->capacity);
+    }
+    id = tree->end++;
+  }
+  tree->items[id] = s;
+  tree->alive[id] = true;
+  ++tree->size;
+  insert_item(tree, id);
+  return id;
+}
+
+unsigned quadtree_insert_point(QuadTree *tree, Point p) {
+  return quadtree_insert_segment(tree, (Segment){.p0 = p, .p1 = p});
+}
+
+bool quadtree_delete(QuadTree *tree, unsigned id) {
+  if (id >= tree->end || !tree->alive[id]) {
+    return false;
+  }
+  remove_item(tree, id);
+  tree->alive[id] = false;
+  --tree->size;
+  vector_push(&tree->free_ids, index_ptr(id));
+  return true;
+}
+
+// Whether an item may be kept in a node, whether or not it fits further down.
+static bool fits_node(const QuadTree *tree, unsigned index, Extent e) {
+  const QuadTreeNode *node = &tree->nodes[index];
+  if (index == ROOT) {
+    return !isfinite(e.center.x) || !isfinite(e.center.y) ||
+           in_cell(node, e.center);
+  }
+  return e.half <= node->half && in_cell(node, e.center);
+}
+
+bool quadtree_move(QuadTree *tree, unsigned id, Segment s) {
+  if (id >= tree->end || !tree->alive[id]) {
+    return false;
+  }
+  tree->items[id] = s;
+  unsigned index = tree->item_node[id];
+  Extent e = segment_extent(s);
+  if (fits_node(tree, index, e) && child_for(tree, index, e) == NO_NODE) {
+    return true;
+  }
+
+  // Climb to the lowest node the item fits in and go down from there, so small
+  // moves only touch the nodes around the item
+  unlink_item(tree, id);
+  unsigned sparse = NO_NODE;
+  while (!fits_node(tree, index, e)) {
+    QuadTreeNode *node = &tree->nodes[index];
+    --node->total;
+    if (node->first_child != NO_NODE &&
+        node->total <= QUADTREE_MERGE_THRESHOLD) {
+      sparse = index;
+    }
+    if (index == ROOT) {
+      break;
+    }
+    index = node->parent;
+  }
+  if (sparse != NO_NODE) {
+    merge(tree, sparse);
+  }
+  if (!fits_node(tree, index, e)) {
+    // The root has to grow
+    insert_item(tree, id);
+  } else {
+    place(tree, index, id, e);
+  }
+  return true;
+}
+
+Segment quadtree_get(const QuadTree *tree, unsigned id) {
+  assert(id < tree->end && tree->alive[id] && "no item with this id");
+  return tree->items[id];
+}
+
+typedef struct {
+  BBox box;
+  quadtree_callback_t callback;
+  void *data;
+  unsigned found;
+} BoxQuery;
+
+static void box_search(const QuadTree *tree, unsigned index, BoxQuery *query) {
+  const QuadTreeNode *node = &tree->nodes[index];
+  for (unsigned id = node->head; id != NO_ITEM; id = tree->next[id]) {
+    if (segment_intersects_bbox(tree->items[id], query->box)) {
+      ++query->found;
+      query->callback(id, query->data);
+    }
+  }
+  if (node->first_child == NO_NODE) {
+    return;
+  }
+  for (unsigned q = 0; q < 4; ++q) {
+    const QuadTreeNode *child = &tree->nodes[node->first_child + q];
+    if (child->total > 0 && bbox_overlaps(loose_box(child), query->box)) {
+      box_search(tree, node->first_child + q, query);
+    }
+  }
+}
+
+unsigned quadtree_query_box(const QuadTree *tree, Point min, Point max,
+                            quadtree_callback_t callback, void *data) {
+  BoxQuery query = {
+      .box = bbox_from_corners(min, max),
+      .callback = callback,
+      .data = data,
+      .found = 0,
+  };
+  // The root is not pruned, as it also holds items that are not finite
+  box_search(tree, ROOT, &query);
+  return query.found;
+}
+
+// Best first search entry of a node or an item, queued by squared distance.
+// Entries are queued by pointer, and popped ones are reused.
+typedef struct {
+  double distance;
+  unsigned ref;
+  bool item;
+} QueueEntry;
+
+static Ordering entry_cmp(void *a, void *b) {
+  double da = ((QueueEntry *)a)->distance;
+  double db = ((QueueEntry *)b)->distance;
+  return da < db ? LESS : da > db ? GREATER : EQUALS;
+}
+
+static void queue_push(PriorityQueue *q, Vector *spare, QueueEntry e) {
+  QueueEntry *entry =
+      spare->size > 0 ? vector_pop_back(spare) : malloc(sizeof(QueueEntry));
+  *entry = e;
+  pq_push(q, entry);
+}
+
+static void queue_free(PriorityQueue *q, Vector *spare) {
+  void *entry;
+  while ((entry = pq_pop(q))) {
+    free(entry);
+  }
+  for (unsigned i = 0; i < spare->size; ++i) {
+    free(spare->data[i]);
+  }
+  vector_free(spare);
+  pq_free(q);
+}
+
+unsigned quadtree_nearest(const QuadTree *tree, Point p, unsigned k,
+                          unsigned *ids) {
+  PriorityQueue q;
+  pq_initc(&q, entry_cmp);
+  Vector spare;
+  vector_init(&spare);
+  queue_push(&q, &spare,
+             (QueueEntry){.distance = 0, .ref = ROOT, .item = false});
+  unsigned found = 0;
+  QueueEntry *top;
+  while (found < k && (top = pq_pop(&q))) {
+    QueueEntry e = *top;
+    vector_push(&spare, top);
+    if (e.item) {
+      ids[found++] = e.ref;
+      continue;
+    }
+    const QuadTreeNode *node = &tree->nodes[e.ref];
+    for (unsigned id = node->head; id != NO_ITEM; id = tree->next[id]) {
+      double distance = squared_distance_to_segment(tree->items[id], p);
+      queue_push(&q, &spare,
+                 (QueueEntry){.distance = distance, .ref = id, .item = true});
+    }
+    if (node->first_child != NO_NODE) {
+      for (unsigned c = 0; c < 4; ++c) {
+        const QuadTreeNode *child = &tree->nodes[node->first_child + c];
+        if (child->total > 0) {
+          queue_push(&q, &spare,
+                     (QueueEntry){
+                         .distance = bbox_squared_distance(loose_box(child), p),
+                         .ref = node->first_child + c,
+                         .item = false,
+                     });
+        }
+      }
+    }
+  }
+  queue_free(&q, &spare);
+  return found;
+}
+
+// Validates the subtree under a node and returns how many items it holds.
+static unsigned validate_node(const QuadTree *tree, unsigned index) {
+  const QuadTreeNode *node = &tree->nodes[index];
+  unsigned count = 0;
+  for (unsigned id = node->head; id != NO_ITEM; id = tree->next[id]) {
+    assert(id < tree->end && tree->alive[id] && "quadtree holds a dead item");
+    assert(tree->item_node[id] == index && "quadtree item node out of sync");
+    Extent e = segment_extent(tree->items[id]);
+    assert((index == ROOT ||
+            (e.half <= node->half && in_cell(node, e.center))) &&
+           "quadtree item outside of its node");
+    assert(child_for(tree, index, e) == NO_NODE &&
+           "quadtree item must be in the deepest node it fits");
+    ++count;
+  }
+  assert(count == node->count && "quadtree node count out of sync");
+  unsigned total = count;
+  if (node->first_child != NO_NODE) {
+    assert(node->half > tree->min_half && "quadtree too deep");
+    for (unsigned q = 0; q < 4; ++q) {
+      assert(tree->nodes[node->first_child + q].parent == index &&
+             "quadtree parent out of sync");
+      total += validate_node(tree, node->first_child + q);
+    }
+  }
+  assert(total == node->total && "quadtree node total out of sync");
+  return total;
+}
+
+void quadtree_validate(const QuadTree *tree) {
+  assert(tree && "quadtree must not be null");
+  assert(tree->size + tree->free_ids.size == tree->end &&
+         "quadtree ids must be either live or free");
+  assert(validate_node(tree, ROOT) == tree->size &&
+         "quadtree must hold every live item");
+}
@@ -0,0 +1,745 @@
+// R-tree, see rtree.h.
+//
+// Bulk loading uses Sort-Tile-Recursive. The boxes of one level are sorted by
+// the x of their centers and cut into about sqrt(P) vertical slices, where P is
+// the number of nodes the level needs. Each slice is sorted by the y of the
+// centers and packed into full nodes in that order, except that the last two
+// nodes of a level split their entries evenly when the last would be under
+// RTREE_MIN_ENTRIES. The nodes become the boxes of the next level, until one
+// node is left. Sorts are radix sorts on order-preserving keys, and slices are
+// sorted in parallel.
+//
+// Insertion follows the R*-tree. The subtree is chosen by least overlap
+// enlargement just above the leaves and least area enlargement higher up. An
+// overflowing node is split along the axis with the smallest total margin over
+// all distributions, picking the distribution with the least overlap. Forced
+// reinsertion is not used.
+//
+// Deletion removes the item from its leaf. Nodes left with fewer than
+// RTREE_MIN_ENTRIES entries are dissolved and their items inserted again.
+#include "geometry/structure/rtree.h"
+#include "geometry/structure/bbox.h"
+#include "data_structure/priority_queue.h"
+#include "data_structure/parallel.h"
+#include "data_structure/sort.h"
+#include <assert.h>
+#include <limits.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const unsigned DEFAULT_INITIAL_CAPACITY = 16;
+static const unsigned NO_NODE = UINT_MAX;
+
+// A depth first query holds at most RTREE_MAX_ENTRIES - 1 pending entries per
+// level, plus the one being expanded. Every node but the root has at least
+// RTREE_MIN_ENTRIES entries, so 2^32 items are at most 20 levels deep, and
+// rtree_validate checks that the height fits.
+#define QUERY_STACK_SIZE (RTREE_MAX_ENTRIES * 64)
+
+static double squared_distance_to_segment(Segment s, Point p) {
+  double dx = s.p1.x - s.p0.x;
+  double dy = s.p1.y - s.p0.y;
+  double length2 = dx * dx + dy * dy;
+  double t = length2 > 0
+                 ? ((p.x - s.p0.x) * dx + (p.y - s.p0.y) * dy) / length2
+                 : 0;
+  t = fmax(0, fmin(1, t));
+  double ex = s.p0.x + t * dx - p.x;
+  double ey = s.p0.y + t * dy - p.y;
+  return ex * ex + ey * ey;
+}
+
+static void *index_ptr(unsigned i) { return (void *)(uintptr_t)i; }
+
+static unsigned ptr_index(void *ptr) { return (unsigned)(uintptr_t)ptr; }
+
+static BBox entry_box(const RTreeNode *node, unsigned i) {
+  return (BBox){
+      .min_x = node->min_x[i],
+      .min_y = node->min_y[i],
+      .max_x = node->max_x[i],
+      .max_y = node->max_y[i],
+  };
+}
+
+static BBox node_box(const RTreeNode *node) {
+  assert(node->count > 0 && "empty nodes have no box");
+  BBox b = entry_box(node, 0);
+  for (unsigned i = 1; i < node->count; ++i) {
+    b = bbox_union(b, entry_box(node, i));
+  }
+  return b;
+}
+
+// Sets entry i of a node and records the node as the owner of the child.
+static void set_entry(RTree *tree, unsigned index, unsigned i, BBox b,
+                      unsigned child) {
+  RTreeNode *node = &tree->nodes[index];
+  node->min_x[i] = b.min_x;
+  node->min_y[i] = b.min_y;
+  node->max_x[i] = b.max_x;
+  node->max_y[i] = b.max_y;
+  node->children[i] = child;
+  if (node->leaf) {
+    tree->item_leaf[child] = index;
+  } else {
+    tree->nodes[child].parent = index;
+  }
+}
+
+static void remove_entry(RTree *tree, unsigned index, unsigned i) {
+  RTreeNode *node = &tree->nodes[index];
+  unsigned last = --node->count;
+  if (i != last) {
+    set_entry(tree, index, i, entry_box(node, last), node->children[last]);
+  }
+}
+
+static unsigned entry_of(const RTreeNode *node, unsigned child) {
+  for (unsigned i = 0; i < node->count; ++i) {
+    if (node->children[i] == child) {
+      return i;
+    }
+  }
+  assert(false && "child not found in its parent");
+  return 0;
+}
+
+// Returns the index of a new empty node. May move the node array.
+static unsigned new_node(RTree *tree, bool leaf) {
+  unsigned index;
+  if (tree->free_nodes.size > 0) {
+    index = ptr_index(vector_pop_back(&tree->free_nodes));
+  } else {
+    if (tree->num_nodes == tree->node_capacity) {
+      // aligned_alloc has no realloc, so nodes are copied over
+      unsigned capacity = tree->node_capacity * 2;
+      RTreeNode *nodes = aligned_alloc(64, sizeof(RTreeNode) * capacity);
+      memcpy(nodes, tree->nodes, sizeof(RTreeNode) * tree->num_nodes);
+      free(tree->nodes);
+      tree->nodes = nodes;
+      tree->node_capacity = capacity;
+    }
+    index = tree->num_nodes++;
+  }
+  RTreeNode *node = &tree->nodes[index];
+  node->count = 0;
+  node->parent = NO_NODE;
+  node->leaf = leaf;
+  return index;
+}
+
+static void free_node(RTree *tree, unsigned index) {
+  vector_push(&tree->free_nodes, index_ptr(index));
+}
+
+static void reserve_items(RTree *tree, unsigned n) {
+  if (n <= tree->capacity) {
+    return;
+  }
+  unsigned capacity = tree->capacity;
+  while (capacity < n) {
+    capacity *= 2;
+  }
+  tree->items = realloc(tree->items, sizeof(Segment) * capacity);
+  tree->item_leaf = realloc(tree->item_leaf, sizeof(unsigned) * capacity);
+  tree->alive = realloc(tree->alive, sizeof(bool) * capacity);
+  tree->capacity = capacity;
+}
+
+void rtree_init(RTree *tree) {
+  *tree = (RTree){
+      .nodes = aligned_alloc(64, sizeof(RTreeNode) * DEFAULT_INITIAL_CAPACITY),
+      .num_nodes = 0,
+      .node_capacity = DEFAULT_INITIAL_CAPACITY,
+      .items = malloc(sizeof(Segment) * DEFAULT_INITIAL_CAPACITY),
+      .item_leaf = malloc(sizeof(unsigned) * DEFAULT_INITIAL_CAPACITY),
+      .alive = malloc(sizeof(bool) * DEFAULT_INITIAL_CAPACITY),
+      .size = 0,
+      .end = 0,
+      .capacity = DEFAULT_INITIAL_CAPACITY,
+  };
+  vector_init(&tree->free_nodes);
+  vector_init(&tree->free_ids);
+  tree->root = new_node(tree, true);
+  tree->height = 1;
+}
+
+void rtree_free(RTree *tree) {
+  vector_free(&tree->free_ids);
+  vector_free(&tree->free_nodes);
+  free(tree->alive);
+  free(tree->item_leaf);
+  free(tree->items);
+  free(tree->nodes);
+}
+
+typedef struct {
+  const BBox *boxes;
+  uint64_t *keys;
+  unsigned *order;
+  unsigned count;
+  unsigned slice;
+  unsigned first;
+  unsigned step;
+} SliceSort;
+
+// Sorts every step-th slice of boxes by the y of their centers, writing the
+// sorted positions to order.
+static void *sort_slices(void *data) {
+  SliceSort *job = data;
+  for (unsigned lo = job->first * job->slice; lo < job->count;
+       lo += job->step * job->slice) {
+    unsigned hi = lo + job->slice < job->count ? lo + job->slice : job->count;
+    for (unsigned i = lo; i < hi; ++i) {
+      job->keys[i] = double_sort_key(job->boxes[i].min_y + job->boxes[i].max_y);
+      job->order[i] = i;
+    }
+    radix_sort_keys(job->keys + lo, job->order + lo, hi - lo, 1);
+  }
+  return NULL;
+}
+
+// Packs one level of boxes into nodes with Sort-Tile-Recursive. On return,
+// boxes and refs hold the new nodes' boxes and indices, and *count their
+// number.
+static void str_pack(RTree *tree, BBox *boxes, unsigned *refs, unsigned *count,
+                     bool leaf, unsigned num_threads) {
+  unsigned n = *count;
+  unsigned num_nodes = (n + RTREE_MAX_ENTRIES - 1) / RTREE_MAX_ENTRIES;
+  unsigned num_slices = (unsigned)ceil(sqrt((double)num_nodes));
+  unsigned slice = num_slices * RTREE_MAX_ENTRIES;
+
+  uint64_t *keys = malloc(sizeof(uint64_t) * n);
+  unsigned *order = malloc(sizeof(unsigned) * n);
+  for (unsigned i = 0; i < n; ++i) {
+    keys[i] = double_sort_key(boxes[i].min_x + boxes[i].max_x);
+    order[i] = i;
+  }
+  radix_sort_keys(keys, order, n, num_threads);
+
+  // Gather the boxes in x order once, so the slices are contiguous
+  BBox *sorted_boxes = malloc(sizeof(BBox) * n);
+  unsigned *sorted_refs = malloc(sizeof(unsigned) * n);
+  for (unsigned i = 0; i < n; ++i) {
+    sorted_boxes[i] = boxes[order[i]];
+    sorted_refs[i] = refs[order[i]];
+  }
+
+  unsigned num_jobs = num_threads < num_slices ? num_threads : num_slices;
+  SliceSort *jobs = malloc(sizeof(SliceSort) * num_jobs);
+  for (unsigned t = 0; t < num_jobs; ++t) {
+    jobs[t] = (SliceSort){
+        .boxes = sorted_boxes,
+        .keys = keys,
+        .order = order,
+        .count = n,
+        .slice = slice,
+        .first = t,
+        .step = num_jobs,
+    };
+  }
+  parallel_for(num_jobs, sort_slices, jobs, sizeof(SliceSort));
+  free(jobs);
+
+  // Pack consecutive runs of the order into full nodes. A last node that would
+  // be under RTREE_MIN_ENTRIES splits the entries of the last two evenly.
+  unsigned packed = 0;
+  for (unsigned lo = 0, hi; lo < n; lo = hi) {
+    unsigned size = n - lo < RTREE_MAX_ENTRIES ? n - lo : RTREE_MAX_ENTRIES;
+    unsigned rest = n - lo - size;
+    if (rest > 0 && rest < RTREE_MIN_ENTRIES) {
+      size = (size + rest) / 2;
+    }
+    hi = lo + size;
+    unsigned index = new_node(tree, leaf);
+    for (unsigned i = lo; i < hi; ++i) {
+      set_entry(tree, index, i - lo, sorted_boxes[order[i]],
+                sorted_refs[order[i]]);
+    }
+    tree->nodes[index].count = hi - lo;
+    boxes[packed] = node_box(&tree->nodes[index]);
+    refs[packed] = index;
+    ++packed;
+  }
+  *count = packed;
+  free(sorted_refs);
+  free(sorted_boxes);
+  free(order);
+  free(keys);
+}
+
+void rtree_bulk_load(RTree *tree, const Segment *segments, unsigned n,
+                     unsigned num_threads) {
+  assert((segments || n == 0) && "cannot load NULL segments");
+  assert(num_threads > 0 && "need at least one thread");
+  tree->num_nodes = 0;
+  tree->free_nodes.size = 0;
+  tree->free_ids.size = 0;
+  reserve_items(tree, n);
+  tree->size = n;
+  tree->end = n;
+  if (n == 0) {
+    tree->root = new_node(tree, true);
+    tree->height = 1;
+    return;
+  }
+
+  BBox *boxes = malloc(sizeof(BBox) * n);
+  unsigned *refs = malloc(sizeof(unsigned) * n);
+  for (unsigned i = 0; i < n; ++i) {
+    tree->items[i] = segments[i];
+    tree->alive[i] = true;
+    boxes[i] = bbox_from_segment(segments[i]);
+    refs[i] = i;
+  }
+  unsigned count = n;
+  bool leaf = true;
+  tree->height = 0;
+  do {
+    str_pack(tree, boxes, refs, &count, leaf, num_threads);
+    leaf = false;
+    ++tree->height;
+  } while (count > 1);
+  tree->root = refs[0];
+  tree->nodes[tree->root].parent = NO_NODE;
+  free(refs);
+  free(boxes);
+}
+
+void rtree_bulk_load_points(RTree *tree, const Point *points, unsigned n,
+                            unsigned num_threads) {
+  assert((points || n == 0) && "cannot load NULL points");
+  Segment *segments = malloc(sizeof(Segment) * (n ? n : 1));
+  for (unsigned i = 0; i < n; ++i) {
+    segments[i] = (Segment){.p0 = points[i], .p1 = points[i]};
+  }
+  rtree_bulk_load(tree, segments, n, num_threads);
+  free(segments);
+}
+
+// Recomputes the boxes of the ancestors of a node.
+static void adjust_boxes(RTree *tree, unsigned index) {
+  while (index != tree->root) {
+    unsigned parent = tree->nodes[index].parent;
+    unsigned i = entry_of(&tree->nodes[parent], index);
+    set_entry(tree, parent, i, node_box(&tree->nodes[index]), index);
+    index = parent;
+  }
+}
+
+static unsigned choose_leaf(const RTree *tree, BBox b) {
+  unsigned index = tree->root;
+  while (!tree->nodes[index].leaf) {
+    const RTreeNode *node = &tree->nodes[index];
+    bool above_leaves = tree->nodes[node->children[0]].leaf;
+    unsigned best = 0;
+    double best_overlap = INFINITY;
+    double best_enlargement = INFINITY;
+    double best_area = INFINITY;
+    for (unsigned i = 0; i < node->count; ++i) {
+      BBox e = entry_box(node, i);
+      BBox enlarged = bbox_union(e, b);
+      double area = bbox_area(e);
+      double enlargement = bbox_area(enlarged) - area;
+      double overlap = 0;
+      if (above_leaves) {
+        for (unsigned j = 0; j < node->count; ++j) {
+          if (j != i) {
+            BBox other = entry_box(node, j);
+            overlap += bbox_overlap_area(enlarged, other) -
+                       bbox_overlap_area(e, other);
+          }
+        }
+      }
+      if (overlap < best_overlap ||
+          (overlap == best_overlap &&
+           (enlargement < best_enlargement ||
+            (enlargement == best_enlargement && area < best_area)))) {
+        best = i;
+        best_overlap = overlap;
+        best_enlargement = enlargement;
+        best_area = area;
+      }
+    }
+    index = node->children[best];
+  }
+  return index;
+}
+
+// Sorts entry indices by key with insertion sort. There are at most
+// RTREE_MAX_ENTRIES + 1 of them.
+static void sort_entries(unsigned *order, const double *keys, unsigned n) {
+  for (unsigned i = 1; i < n; ++i) {
+    unsigned e = order[i];
+    unsigned j = i;
+    for (; j > 0 && keys[order[j - 1]] > keys[e]; --j) {
+      order[j] = order[j - 1];
+    }
+    order[j] = e;
+  }
+}
+
+// Bounding boxes of the first k and the last n - k entries in order, for every
+// k.
+static void group_boxes(const BBox *boxes, const unsigned *order, unsigned n,
+                        BBox *prefix, BBox *suffix) {
+  prefix[1] = boxes[order[0]];
+  for (unsigned k = 2; k <= n; ++k) {
+    prefix[k] = bbox_union(prefix[k - 1], boxes[order[k - 1]]);
+  }
+  suffix[n - 1] = boxes[order[n - 1]];
+  for (unsigned k = n - 1; k-- > 0;) {
+    suffix[k] = bbox_union(suffix[k + 1], boxes[order[k]]);
+  }
+}
+
+// R* split of n = RTREE_MAX_ENTRIES + 1 boxes. Writes the chosen order to
+// order and returns the size of the first group.
+static unsigned rstar_split(const BBox *boxes, unsigned n, unsigned *order) {
+  enum { N = RTREE_MAX_ENTRIES + 1 };
+  double keys[4][N];
+  for (unsigned i = 0; i < n; ++i) {
+    keys[0][i] = boxes[i].min_x;
+    keys[1][i] = boxes[i].max_x;
+    keys[2][i] = boxes[i].min_y;
+    keys[3][i] = boxes[i].max_y;
+  }
+  unsigned orders[4][N];
+  BBox prefix[4][N + 1];
+  BBox suffix[4][N + 1];
+  for (unsigned s = 0; s < 4; ++s) {
+    for (unsigned i = 0; i < n; ++i) {
+      orders[s][i] = i;
+    }
+    sort_entries(orders[s], keys[s], n);
+    group_boxes(boxes, orders[s], n, prefix[s], suffix[s]);
+  }
+
+  // The axis with the least total margin, sorting by lower and upper bounds
+  double margins[2] = {0, 0};
+  for (unsigned s = 0; s < 4; ++s) {
+    for (unsigned k = RTREE_MIN_ENTRIES; k <= n - RTREE_MIN_ENTRIES; ++k) {
+      margins[s / 2] += bbox_margin(prefix[s][k]) + bbox_margin(suffix[s][k]);
+    }
+  }
+  unsigned axis = margins[1] < margins[0] ? 1 : 0;
+
+  // The distribution on that axis with the least overlap, then least area
+  unsigned best_s = 2 * axis;
+  unsigned best_k = RTREE_MIN_ENTRIES;
+  double best_overlap = INFINITY;
+  double best_area = INFINITY;
+  for (unsigned s = 2 * axis; s < 2 * axis + 2; ++s) {
+    for (unsigned k = RTREE_MIN_ENTRIES; k <= n - RTREE_MIN_ENTRIES; ++k) {
+      double overlap = bbox_overlap_area(prefix[s][k], suffix[s][k]);
+      double area = bbox_area(prefix[s][k]) + bbox_area(suffix[s][k]);
+      if (overlap < best_overlap ||
+          (overlap == best_overlap && area < best_area)) {
+        best_s = s;
+        best_k = k;
+        best_overlap = overlap;
+        best_area = area;
+      }
+    }
+  }
+  memcpy(order, orders[best_s], sizeof(unsigned) * n);
+  return best_k;
+}
+
+static void add_entry(RTree *tree, unsigned index, BBox b, unsigned child);
+
+// Splits a full node that also has to take the entry (b, child).
+static void split(RTree *tree, unsigned index, BBox b, unsigned child) {
+  enum { N = RTREE_MAX_ENTRIES + 1 };
+  BBox boxes[N];
+  unsigned children[N];
+  RTreeNode *node = &tree->nodes[index];
+  for (unsigned i = 0; i < RTREE_MAX_ENTRIES; ++i) {
+    boxes[i] = entry_box(node, i);
+    children[i] = node->children[i];
+  }
+  boxes[RTREE_MAX_ENTRIES] = b;
+  children[RTREE_MAX_ENTRIES] = child;
+
+  unsigned order[N];
+  unsigned k = rstar_split(boxes, N, order);
+  unsigned sibling = new_node(tree, tree->nodes[index].leaf);
+  for (unsigned i = 0; i < k; ++i) {
+    set_entry(tree, index, i, boxes[order[i]], children[order[i]]);
+  }
+  tree->nodes[index].count = k;
+  for (unsigned i = k; i < N; ++i) {
+    set_entry(tree, sibling, i - k, boxes[order[i]], children[order[i]]);
+  }
+  tree->nodes[sibling].count = N - k;
+
+  if (index == tree->root) {
+    unsigned root = new_node(tree, false);
+    set_entry(tree, root, 0, node_box(&tree->nodes[index]), index);
+    set_entry(tree, root, 1, node_box(&tree->nodes[sibling]), sibling);
+    tree->nodes[root].count = 2;
+    tree->root = root;
+    ++tree->height;
+    return;
+  }
+  unsigned parent = tree->nodes[index].parent;
+  set_entry(tree, parent, entry_of(&tree->nodes[parent], index),
+            node_box(&tree->nodes[index]), index);
+  add_entry(tree, parent, node_box(&tree->nodes[sibling]), sibling);
+}
+
+static void add_entry(RTree *tree, unsigned index, BBox b, unsigned child) {
+  RTreeNode *node = &tree->nodes[index];
+  if (node->count == RTREE_MAX_ENTRIES) {
+    split(tree, index, b, child);
+    return;
+  }
+  set_entry(tree, index, node->count++, b, child);
+  adjust_boxes(tree, index);
+}
+
+static void insert_item(RTree *tree, unsigned id) {
+  BBox b = bbox_from_segment(tree->items[id]);
+  add_entry(tree, choose_leaf(tree, b), b, id);
+}
+
+unsigned rtree_insert_segment(RTree *tree, Segment s) {
+  unsigned id;
+  if (tree->free_ids.size > 0) {
+    id = ptr_index(vector_pop_back(&tree->free_ids));
+  } else {
+    reserve_items(tree, tree->end + 1);
+    id = tree->end++;
+  }
+  tree->items[id] = s;
+  tree->alive[id] = true;
+  ++tree->size;
+  insert_item(tree, id);
+  return id;
+}
+
+unsigned rtree_insert_point(RTree *tree, Point p) {
+  return rtree_insert_segment(tree, (Segment){.p0 = p, .p1 = p});
+}
+
+// Collects the items below a node and frees the node and its descendants.
+static void dissolve(RTree *tree, unsigned index, Vector *items) {
+  RTreeNode *node = &tree->nodes[index];
+  for (unsigned i = 0; i < node->count; ++i) {
+    if (node->leaf) {
+      vector_push(items, index_ptr(node->children[i]));
+    } else {
+      dissolve(tree, node->children[i], items);
+    }
+  }
+  free_node(tree, index);
+}
+
+bool rtree_delete(RTree *tree, unsigned id) {
+  if (id >= tree->end || !tree->alive[id]) {
+    return false;
+  }
+  unsigned index = tree->item_leaf[id];
+  remove_entry(tree, index, entry_of(&tree->nodes[index], id));
+  tree->alive[id] = false;
+  --tree->size;
+  vector_push(&tree->free_ids, index_ptr(id));
+
+  // Dissolve underfull nodes on the way up and fix the boxes of the rest
+  Vector orphans;
+  vector_init(&orphans);
+  while (index != tree->root) {
+    unsigned parent = tree->nodes[index].parent;
+    unsigned i = entry_of(&tree->nodes[parent], index);
+    if (tree->nodes[index].count < RTREE_MIN_ENTRIES) {
+      remove_entry(tree, parent, i);
+      dissolve(tree, index, &orphans);
+    } else {
+      set_entry(tree, parent, i, node_box(&tree->nodes[index]), index);
+    }
+    index = parent;
+  }
+  while (!tree->nodes[tree->root].leaf && tree->nodes[tree->root].count == 1) {
+    unsigned old_root = tree->root;
+    tree->root = tree->nodes[old_root].children[0];
+    tree->nodes[tree->root].parent = NO_NODE;
+    free_node(tree, old_root);
+    --tree->height;
+  }
+  if (tree->nodes[tree->root].count == 0) {
+    tree->nodes[tree->root].leaf = true;
+    tree->height = 1;
+  }
+  for (unsigned i = 0; i < orphans.size; ++i) {
+    insert_item(tree, ptr_index(orphans.data[i]));
+  }
+  vector_free(&orphans);
+  return true;
+}
+
+Segment rtree_get(const RTree *tree, unsigned id) {
+  assert(id < tree->end && tree->alive[id] && "no item with this id");
+  return tree->items[id];
+}
+
+unsigned rtree_query_box(const RTree *tree, Point min, Point max,
+                         rtree_callback_t callback, void *data) {
+  BBox query = bbox_from_corners(min, max);
+  unsigned stack[QUERY_STACK_SIZE];
+  unsigned top = 0;
+  stack[top++] = tree->root;
+  unsigned found = 0;
+  while (top > 0) {
+    const RTreeNode *node = &tree->nodes[stack[--top]];
+    for (unsigned i = 0; i < node->count; ++i) {
+      if (!bbox_overlaps(entry_box(node, i), query)) {
+        continue;
+      }
+      if (!node->leaf) {
+        assert(top < QUERY_STACK_SIZE && "tree too deep for query stack");
+        stack[top++] = node->children[i];
+      } else if (segment_intersects_bbox(tree->items[node->children[i]],
+                                         query)) {
+        ++found;
+        callback(node->children[i], data);
+      }
+    }
+  }
+  return found;
+}
+
+unsigned rtree_query_segment(const RTree *tree, Segment s,
+                             rtree_callback_t callback, void *data) {
+  unsigned stack[QUERY_STACK_SIZE];
+  unsigned top = 0;
+  stack[top++] = tree->root;
+  unsigned found = 0;
+  while (top > 0) {
+    const RTreeNode *node = &tree->nodes[stack[--top]];
+    for (unsigned i = 0; i < node->count; ++i) {
+      if (!segment_intersects_bbox(s, entry_box(node, i))) {
+        continue;
+      }
+      if (!node->leaf) {
+        assert(top < QUERY_STACK_SIZE && "tree too deep for query stack");
+        stack[top++] = node->children[i];
+      } else {
+        ++found;
+        callback(node->children[i], data);
+      }
+    }
+  }
+  return found;
+}
+
+// Best first search entry of a node or an item, queued by squared distance.
+// Entries are queued by pointer, and popped ones are reused.
+typedef struct {
+  double distance;
+  unsigned ref;
+  bool item;
+} QueueEntry;
+
+static Ordering entry_cmp(void *a, void *b) {
+  double da = ((QueueEntry *)a)->distance;
+  double db = ((QueueEntry *)b)->distance;
+  return da < db ? LESS : da > db ? GREATER : EQUALS;
+}
+
+static void queue_push(PriorityQueue *q, Vector *spare, QueueEntry e) {
+  QueueEntry *entry =
+      spare->size > 0 ? vector_pop_back(spare) : malloc(sizeof(QueueEntry));
+  *entry = e;
+  pq_push(q, entry);
+}
+
+static void queue_free(PriorityQueue *q, Vector *spare) {
+  void *entry;
+  while ((entry = pq_pop(q))) {
+    free(entry);
+  }
+  for (unsigned i = 0; i < spare->size; ++i) {
+    free(spare->data[i]);
+  }
+  vector_free(spare);
+  pq_free(q);
+}
+
+unsigned rtree_nearest(const RTree *tree, Point p, unsigned k, unsigned *ids) {
+  PriorityQueue q;
+  pq_initc(&q, entry_cmp);
+  Vector spare;
+  vector_init(&spare);
+  queue_push(&q, &spare,
+             (QueueEntry){.distance = 0, .ref = tree->root, .item = false});
+  unsigned found = 0;
+  QueueEntry *top;
+  while (found < k && (top = pq_pop(&q))) {
+    QueueEntry e = *top;
+    vector_push(&spare, top);
+    if (e.item) {
+      ids[found++] = e.ref;
+      continue;
+    }
+    const RTreeNode *node = &tree->nodes[e.ref];
+    for (unsigned i = 0; i < node->count; ++i) {
+      unsigned child = node->children[i];
+      double distance =
+          node->leaf ? squared_distance_to_segment(tree->items[child], p)
+                     : bbox_squared_distance(entry_box(node, i), p);
+      queue_push(&q, &spare,
+                 (QueueEntry){
+                     .distance = distance, .ref = child, .item = node->leaf});
+    }
+  }
+  queue_free(&q, &spare);
+  return found;
+}
+
+// Validates the subtree under a node and returns how many items it holds.
+static unsigned validate_node(const RTree *tree, unsigned index,
+                              unsigned depth) {
+  const RTreeNode *node = &tree->nodes[index];
+  assert(node->count <= RTREE_MAX_ENTRIES && "rtree node overflows");
+  assert((index == tree->root || node->count >= RTREE_MIN_ENTRIES) &&
+         "rtree non-root nodes must be at least RTREE_MIN_ENTRIES full");
+  if (node->leaf) {
+    assert(depth == tree->height && "rtree leaves must all be at one depth");
+    for (unsigned i = 0; i < node->count; ++i) {
+      unsigned id = node->children[i];
+      assert(id < tree->end && tree->alive[id] && "rtree holds a dead item");
+      assert(tree->item_leaf[id] == index && "rtree item leaf out of sync");
+      BBox b = bbox_from_segment(tree->items[id]);
+      BBox e = entry_box(node, i);
+      assert(b.min_x == e.min_x && b.min_y == e.min_y && b.max_x == e.max_x &&
+             b.max_y == e.max_y && "rtree item box out of sync");
+    }
+    return node->count;
+  }
+  unsigned items = 0;
+  for (unsigned i = 0; i < node->count; ++i) {
+    unsigned child = node->children[i];
+    assert(tree->nodes[child].parent == index && "rtree parent out of sync");
+    BBox b = node_box(&tree->nodes[child]);
+    BBox e = entry_box(node, i);
+    assert(b.min_x == e.min_x && b.min_y == e.min_y && b.max_x == e.max_x &&
+           b.max_y == e.max_y && "rtree node box out of sync");
+    items += validate_node(tree, child, depth + 1);
+  }
+  return items;
+}
+
+void rtree_validate(const RTree *tree) {
+  assert(tree && "rtree must not be null");
+  assert(tree->nodes[tree->root].parent == NO_NODE &&
+         "rtree root must not have a parent");
+  assert(tree->size + tree->free_ids.size == tree->end &&
+         "rtree ids must be either live or free");
+  assert(tree->height * (RTREE_MAX_ENTRIES - 1) < QUERY_STACK_SIZE &&
+         "rtree too deep for the query stack");
+  unsigned items = validate_node(tree, tree->root, 1);
+  assert(items == tree->size && "rtree must hold every live item");
+}
@@ -1,4 +1,6 @@
 #include "geometry/structure/segment.h"
+#include "geometry/predicates.h"
+#include "geometry/structure/bbox.h"
 
 Segment segment_from_coords(double x0, double y0, double x1, double y1) {
   Point p0 = (Point){.x = x0, .y = y0};
@@ -24,53 +26,77 @@ Line segment_to_line(Segment segment) {
   };
 }
 
-// Does not check that p lies on s, just that it is within the bounds of s.
-static bool segment_bound_contains_point(Segment s, Point p) {
-  double lower_x;
-  double upper_x;
-  if (s.p0.x < s.p1.x) {
-    lower_x = s.p0.x;
-    upper_x = s.p1.x;
-  } else {
-    lower_x = s.p1.x;
-    upper_x = s.p0.x;
-  }
+static int sign(double x) { return (x > 0) - (x < 0); }
 
-  double lower_y;
-  double upper_y;
-  if (s.p0.y < s.p1.y) {
-    lower_y = s.p0.y;
-    upper_y = s.p1.y;
-  } else {
-    lower_y = s.p1.y;
-    upper_y = s.p0.y;
-  }
+static bool point_before(Point a, Point b) {
+  return a.x < b.x || (a.x == b.x && a.y < b.y);
+}
 
-  return p.x >= lower_x && p.x <= upper_x && p.y >= lower_y && p.y <= upper_y;
+// Writes the orientations of s1's endpoints relative to s0 and of s0's
+// endpoints relative to s1 to d, and returns whether the closed segments
+// intersect. Neither segment may have both endpoints strictly on one side of
+// the other's line. For collinear segments every orientation is zero and the
+// boxes decide. Boxes that do not overlap are rejected before any
+// orientations are computed.
+static bool orientations(Segment s0, Segment s1, double d[4]) {
+  if (!bbox_overlaps(bbox_from_segment(s0), bbox_from_segment(s1))) {
+    return false;
+  }
+  d[0] = orient2d(s0.p0, s0.p1, s1.p0);
+  d[1] = orient2d(s0.p0, s0.p1, s1.p1);
+  d[2] = orient2d(s1.p0, s1.p1, s0.p0);
+  d[3] = orient2d(s1.p0, s1.p1, s0.p1);
+  return (sign(d[0]) * sign(d[1]) <= 0) & (sign(d[2]) * sign(d[3]) <= 0);
 }
 
 Point segment_intersection_point(Segment s0, Segment s1) {
-  Point intersect_point =
-      line_intersection_point(segment_to_line(s0), segment_to_line(s1));
-  return segment_bound_contains_point(s0, intersect_point) &&
-                 segment_bound_contains_point(s1, intersect_point)
-             ? intersect_point
-             : nan_point();
+  double d[4];
+  if (!orientations(s0, s1, d)) {
+    return nan_point();
+  }
+  if (d[2] == 0 && d[3] == 0) {
+    // Collinear, or one segment is a point on the other. The overlap starts at
+    // the later of the two left endpoints.
+    Point left0 = point_before(s0.p0, s0.p1) ? s0.p0 : s0.p1;
+    Point left1 = point_before(s1.p0, s1.p1) ? s1.p0 : s1.p1;
+    return point_before(left0, left1) ? left1 : left0;
+  }
+  // An endpoint on the other segment is the intersection
+  if (d[0] == 0) {
+    return s1.p0;
+  }
+  if (d[1] == 0) {
+    return s1.p1;
+  }
+  if (d[2] == 0) {
+    return s0.p0;
+  }
+  if (d[3] == 0) {
+    return s0.p1;
+  }
+  // s0's endpoints are on opposite sides of s1, at distances from its line
+  // proportional to d[2] and d[3]
+  double t = d[2] / (d[2] - d[3]);
+  return (Point){
+      .x = s0.p0.x + t * (s0.p1.x - s0.p0.x),
+      .y = s0.p0.y + t * (s0.p1.y - s0.p0.y),
+  };
 }
 
 bool segment_intersects(Segment s0, Segment s1) {
-  return !is_nan_point(segment_intersection_point(s0, s1));
+  double d[4];
+  return orientations(s0, s1, d);
 }
 
 bool segment_line_intersect(Segment s, Line l) {
   // TODO: this is untested. do we need this API?
   Point intersect_point =
       line_intersection_point(segment_to_line(s), l);
-  return segment_bound_contains_point(s, intersect_point);
+  return bbox_contains_point(bbox_from_segment(s), intersect_point);
 }
 
 bool point_lies_on_segment(Point p, Segment s) {
-  return segment_bound_contains_point(s, p) &&
+  return bbox_contains_point(bbox_from_segment(s), p) &&
          point_lies_on_line(p, segment_to_line(s));
 }
 
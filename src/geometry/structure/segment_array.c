@@ -0,0 +1,417 @@
+// Structure of arrays segment container and the one-vs-many intersection
+// kernel.
+//
+// Two closed segments intersect iff their bounding boxes overlap and the
+// endpoints of each segment do not lie strictly on the same side of the other
+// segment's line. For collinear segments all orientations are zero and the
+// bounding box check alone decides. Each orientation is a 2x2 cross product, so
+// the test needs no divisions and no special cases for vertical segments.
+//
+// Segment boxes are cached in a BBoxArray next to the endpoints. The kernels
+// test a vector of cached boxes first and skip the endpoint loads and
+// orientations when none of them overlap the query's box, which is most of the
+// time when queries are short compared to the spread of the segments.
+//
+// Orientations are evaluated in floating point the way orient2d's first stage
+// does, and each is checked against the same forward error bound. A segment
+// with an orientation too close to zero for its sign to be certain, such as
+// one touching or collinear with the query, is retested with the exact
+// segment_intersects, so the result is exact.
+//
+// The kernel has scalar, AVX2 and AVX-512 versions like the PointArray
+// kernels. The vector versions evaluate the exact same expressions as the
+// scalar version, and the result is exact anyway, so every level produces the
+// same bitmask.
+#include "geometry/structure/segment_array.h"
+#include "geometry/simd.h"
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define HAS_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+static const unsigned DEFAULT_INITIAL_CAPACITY = 16;
+// An orientation l - r computed in floating point has the right sign if its
+// magnitude is more than this times |l| + |r|, as in orient2d.
+static const double ORIENTATION_BOUND = (3.0 + 16.0 * 0x1p-53) * 0x1p-53;
+
+void segment_array_init(SegmentArray *arr) {
+  segment_array_initn(arr, DEFAULT_INITIAL_CAPACITY);
+}
+
+void segment_array_initn(SegmentArray *arr, unsigned n) {
+  *arr = (SegmentArray){
+      .x0s = simd_alloc(n),
+      .y0s = simd_alloc(n),
+      .x1s = simd_alloc(n),
+      .y1s = simd_alloc(n),
+      .size = 0,
+      .capacity = n,
+  };
+  bbox_array_initn(&arr->boxes, n);
+}
+
+void segment_array_from_segments(SegmentArray *arr, const Segment *segments,
+                                 unsigned n) {
+  segment_array_initn(arr, n);
+  arr->size = n;
+  arr->boxes.size = n;
+  for (unsigned i = 0; i < n; ++i) {
+    segment_array_set(arr, i, segments[i]);
+  }
+}
+
+void segment_array_free(SegmentArray *arr) {
+  segment_array_validate(arr);
+  free(arr->x0s);
+  free(arr->y0s);
+  free(arr->x1s);
+  free(arr->y1s);
+  bbox_array_free(&arr->boxes);
+}
+
+static double *grow(double *buffer, unsigned size, unsigned capacity) {
+  // realloc does not preserve alignment, so copy into a fresh buffer
+  double *grown = simd_alloc(capacity);
+  memcpy(grown, buffer, sizeof(double) * size);
+  free(buffer);
+  return grown;
+}
+
+void segment_array_reserve(SegmentArray *arr, unsigned n) {
+  segment_array_validate(arr);
+  if (n <= arr->capacity) {
+    return;
+  }
+  arr->x0s = grow(arr->x0s, arr->size, n);
+  arr->y0s = grow(arr->y0s, arr->size, n);
+  arr->x1s = grow(arr->x1s, arr->size, n);
+  arr->y1s = grow(arr->y1s, arr->size, n);
+  bbox_array_reserve(&arr->boxes, n);
+  arr->capacity = n;
+}
+
+void segment_array_push(SegmentArray *arr, Segment s) {
+  segment_array_validate(arr);
+  if (arr->size == arr->capacity) {
+    segment_array_reserve(arr, arr->capacity == 0 ? DEFAULT_INITIAL_CAPACITY
+                                                  : arr->capacity * 2);
+  }
+  ++arr->size;
+  ++arr->boxes.size;
+  segment_array_set(arr, arr->size - 1, s);
+}
+
+Segment segment_array_get(const SegmentArray *arr, unsigned i) {
+  assert(i < arr->size && "segment array index out of bounds");
+  return segment_from_coords(arr->x0s[i], arr->y0s[i], arr->x1s[i],
+                             arr->y1s[i]);
+}
+
+void segment_array_set(SegmentArray *arr, unsigned i, Segment s) {
+  assert(i < arr->size && "segment array index out of bounds");
+  arr->x0s[i] = s.p0.x;
+  arr->y0s[i] = s.p0.y;
+  arr->x1s[i] = s.p1.x;
+  arr->y1s[i] = s.p1.y;
+  bbox_array_set(&arr->boxes, i, bbox_from_segment(s));
+}
+
+void segment_array_clear(SegmentArray *arr) {
+  segment_array_validate(arr);
+  arr->size = 0;
+  bbox_array_clear(&arr->boxes);
+}
+
+unsigned segment_bitmask_words(unsigned n) { return (n + 63) / 64; }
+
+// The query segment, with the values every kernel needs precomputed.
+typedef struct {
+  double x0;
+  double y0;
+  double x1;
+  double y1;
+  double dx;
+  double dy;
+  BBox box;
+} Query;
+
+static Query query_from_segment(Segment s) {
+  return (Query){
+      .x0 = s.p0.x,
+      .y0 = s.p0.y,
+      .x1 = s.p1.x,
+      .y1 = s.p1.y,
+      .dx = s.p1.x - s.p0.x,
+      .dy = s.p1.y - s.p0.y,
+      .box = bbox_from_segment(s),
+  };
+}
+
+static bool uncertain(double l, double r) {
+  return fabs(l - r) <= ORIENTATION_BOUND * (fabs(l) + fabs(r));
+}
+
+static bool crosses_exact(const Query *q, double x0, double y0, double x1,
+                          double y1) {
+  return segment_intersects(
+      segment_from_coords(q->x0, q->y0, q->x1, q->y1),
+      segment_from_coords(x0, y0, x1, y1));
+}
+
+// Whether the segment's endpoints and the query's endpoints are not strictly on
+// one side of each other's line, assuming their boxes overlap.
+static bool crosses_scalar(const Query *q, double x0, double y0, double x1,
+                           double y1) {
+  // Orientations of the segment's endpoints relative to the query
+  double l0 = q->dx * (y0 - q->y0), r0 = q->dy * (x0 - q->x0);
+  double l1 = q->dx * (y1 - q->y0), r1 = q->dy * (x1 - q->x0);
+  // Orientations of the query's endpoints relative to the segment
+  double sdx = x1 - x0;
+  double sdy = y1 - y0;
+  double l2 = sdx * (q->y0 - y0), r2 = sdy * (q->x0 - x0);
+  double l3 = sdx * (q->y1 - y0), r3 = sdy * (q->x1 - x0);
+  if (uncertain(l0, r0) | uncertain(l1, r1) | uncertain(l2, r2) |
+      uncertain(l3, r3)) {
+    return crosses_exact(q, x0, y0, x1, y1);
+  }
+  double d0 = l0 - r0;
+  double d1 = l1 - r1;
+  double d2 = l2 - r2;
+  double d3 = l3 - r3;
+
+  bool same_side = ((d0 > 0) & (d1 > 0)) | ((d0 < 0) & (d1 < 0)) |
+                   ((d2 > 0) & (d3 > 0)) | ((d2 < 0) & (d3 < 0));
+  return !same_side;
+}
+
+static void intersects_many_scalar(const Query *q, const SegmentArray *arr,
+                                   unsigned start, uint64_t *out) {
+  const BBoxArray *boxes = &arr->boxes;
+  for (unsigned i = start; i < arr->size; ++i) {
+    bool boxes_overlap = (boxes->min_xs[i] <= q->box.max_x) &
+                         (boxes->max_xs[i] >= q->box.min_x) &
+                         (boxes->min_ys[i] <= q->box.max_y) &
+                         (boxes->max_ys[i] >= q->box.min_y);
+    if (!boxes_overlap) {
+      continue;
+    }
+    bool hit = crosses_scalar(q, arr->x0s[i], arr->y0s[i], arr->x1s[i],
+                              arr->y1s[i]);
+    out[i / 64] |= (uint64_t)hit << (i % 64);
+  }
+}
+
+#ifdef HAS_X86_KERNELS
+
+// Replaces the hits of the lanes set in retest, whose orientations are too
+// close to zero to trust, with the exact test.
+static uint64_t retest_lanes(const Query *q, const SegmentArray *arr,
+                             unsigned i, unsigned retest, uint64_t hits) {
+  hits &= ~(uint64_t)retest;
+  for (; retest; retest &= retest - 1) {
+    unsigned j = i + __builtin_ctz(retest);
+    hits |= (uint64_t)crosses_exact(q, arr->x0s[j], arr->y0s[j], arr->x1s[j],
+                                    arr->y1s[j])
+            << (j - i);
+  }
+  return hits;
+}
+
+// Lanes of the orientation d = l - r whose sign is not certain.
+__attribute__((target("avx2"))) static inline __m256d
+uncertain_avx2(__m256d l, __m256d r, __m256d d) {
+  __m256d sign = _mm256_set1_pd(-0.0);
+  __m256d bound =
+      _mm256_mul_pd(_mm256_set1_pd(ORIENTATION_BOUND),
+                    _mm256_add_pd(_mm256_andnot_pd(sign, l),
+                                  _mm256_andnot_pd(sign, r)));
+  return _mm256_cmp_pd(_mm256_andnot_pd(sign, d), bound, _CMP_LE_OQ);
+}
+
+__attribute__((target("avx512f"))) static inline __mmask8
+uncertain_avx512(__m512d l, __m512d r, __m512d d) {
+  __m512d bound = _mm512_mul_pd(
+      _mm512_set1_pd(ORIENTATION_BOUND),
+      _mm512_add_pd(_mm512_abs_pd(l), _mm512_abs_pd(r)));
+  return _mm512_cmp_pd_mask(_mm512_abs_pd(d), bound, _CMP_LE_OQ);
+}
+
+__attribute__((target("avx2"))) static void
+intersects_many_avx2(const Query *q, const SegmentArray *arr, uint64_t *out) {
+  __m256d qx0 = _mm256_set1_pd(q->x0);
+  __m256d qy0 = _mm256_set1_pd(q->y0);
+  __m256d qx1 = _mm256_set1_pd(q->x1);
+  __m256d qy1 = _mm256_set1_pd(q->y1);
+  __m256d qdx = _mm256_set1_pd(q->dx);
+  __m256d qdy = _mm256_set1_pd(q->dy);
+  __m256d q_min_x = _mm256_set1_pd(q->box.min_x);
+  __m256d q_min_y = _mm256_set1_pd(q->box.min_y);
+  __m256d q_max_x = _mm256_set1_pd(q->box.max_x);
+  __m256d q_max_y = _mm256_set1_pd(q->box.max_y);
+  __m256d zero = _mm256_setzero_pd();
+  const BBoxArray *boxes = &arr->boxes;
+
+  unsigned i = 0;
+  for (; i + 4 <= arr->size; i += 4) {
+    __m256d boxes_overlap = _mm256_and_pd(
+        _mm256_and_pd(_mm256_cmp_pd(_mm256_load_pd(boxes->min_xs + i),
+                                    q_max_x, _CMP_LE_OQ),
+                      _mm256_cmp_pd(_mm256_load_pd(boxes->max_xs + i),
+                                    q_min_x, _CMP_GE_OQ)),
+        _mm256_and_pd(_mm256_cmp_pd(_mm256_load_pd(boxes->min_ys + i),
+                                    q_max_y, _CMP_LE_OQ),
+                      _mm256_cmp_pd(_mm256_load_pd(boxes->max_ys + i),
+                                    q_min_y, _CMP_GE_OQ)));
+    if (_mm256_movemask_pd(boxes_overlap) == 0) {
+      continue;
+    }
+
+    __m256d x0 = _mm256_load_pd(arr->x0s + i);
+    __m256d y0 = _mm256_load_pd(arr->y0s + i);
+    __m256d x1 = _mm256_load_pd(arr->x1s + i);
+    __m256d y1 = _mm256_load_pd(arr->y1s + i);
+
+    __m256d l0 = _mm256_mul_pd(qdx, _mm256_sub_pd(y0, qy0));
+    __m256d r0 = _mm256_mul_pd(qdy, _mm256_sub_pd(x0, qx0));
+    __m256d l1 = _mm256_mul_pd(qdx, _mm256_sub_pd(y1, qy0));
+    __m256d r1 = _mm256_mul_pd(qdy, _mm256_sub_pd(x1, qx0));
+    __m256d sdx = _mm256_sub_pd(x1, x0);
+    __m256d sdy = _mm256_sub_pd(y1, y0);
+    __m256d l2 = _mm256_mul_pd(sdx, _mm256_sub_pd(qy0, y0));
+    __m256d r2 = _mm256_mul_pd(sdy, _mm256_sub_pd(qx0, x0));
+    __m256d l3 = _mm256_mul_pd(sdx, _mm256_sub_pd(qy1, y0));
+    __m256d r3 = _mm256_mul_pd(sdy, _mm256_sub_pd(qx1, x0));
+    __m256d d0 = _mm256_sub_pd(l0, r0);
+    __m256d d1 = _mm256_sub_pd(l1, r1);
+    __m256d d2 = _mm256_sub_pd(l2, r2);
+    __m256d d3 = _mm256_sub_pd(l3, r3);
+    __m256d unsure = _mm256_or_pd(
+        _mm256_or_pd(uncertain_avx2(l0, r0, d0), uncertain_avx2(l1, r1, d1)),
+        _mm256_or_pd(uncertain_avx2(l2, r2, d2), uncertain_avx2(l3, r3, d3)));
+
+    __m256d same_side = _mm256_or_pd(
+        _mm256_or_pd(_mm256_and_pd(_mm256_cmp_pd(d0, zero, _CMP_GT_OQ),
+                                   _mm256_cmp_pd(d1, zero, _CMP_GT_OQ)),
+                     _mm256_and_pd(_mm256_cmp_pd(d0, zero, _CMP_LT_OQ),
+                                   _mm256_cmp_pd(d1, zero, _CMP_LT_OQ))),
+        _mm256_or_pd(_mm256_and_pd(_mm256_cmp_pd(d2, zero, _CMP_GT_OQ),
+                                   _mm256_cmp_pd(d3, zero, _CMP_GT_OQ)),
+                     _mm256_and_pd(_mm256_cmp_pd(d2, zero, _CMP_LT_OQ),
+                                   _mm256_cmp_pd(d3, zero, _CMP_LT_OQ))));
+
+    uint64_t hits =
+        _mm256_movemask_pd(_mm256_andnot_pd(same_side, boxes_overlap));
+    unsigned retest = _mm256_movemask_pd(_mm256_and_pd(unsure, boxes_overlap));
+    hits = retest_lanes(q, arr, i, retest, hits);
+    out[i / 64] |= hits << (i % 64);
+  }
+  intersects_many_scalar(q, arr, i, out);
+}
+
+__attribute__((target("avx512f"))) static void
+intersects_many_avx512(const Query *q, const SegmentArray *arr,
+                       uint64_t *out) {
+  __m512d qx0 = _mm512_set1_pd(q->x0);
+  __m512d qy0 = _mm512_set1_pd(q->y0);
+  __m512d qx1 = _mm512_set1_pd(q->x1);
+  __m512d qy1 = _mm512_set1_pd(q->y1);
+  __m512d qdx = _mm512_set1_pd(q->dx);
+  __m512d qdy = _mm512_set1_pd(q->dy);
+  __m512d q_min_x = _mm512_set1_pd(q->box.min_x);
+  __m512d q_min_y = _mm512_set1_pd(q->box.min_y);
+  __m512d q_max_x = _mm512_set1_pd(q->box.max_x);
+  __m512d q_max_y = _mm512_set1_pd(q->box.max_y);
+  __m512d zero = _mm512_setzero_pd();
+  const BBoxArray *boxes = &arr->boxes;
+
+  unsigned i = 0;
+  for (; i + 8 <= arr->size; i += 8) {
+    __mmask8 boxes_overlap =
+        _mm512_cmp_pd_mask(_mm512_load_pd(boxes->min_xs + i), q_max_x,
+                           _CMP_LE_OQ) &
+        _mm512_cmp_pd_mask(_mm512_load_pd(boxes->max_xs + i), q_min_x,
+                           _CMP_GE_OQ) &
+        _mm512_cmp_pd_mask(_mm512_load_pd(boxes->min_ys + i), q_max_y,
+                           _CMP_LE_OQ) &
+        _mm512_cmp_pd_mask(_mm512_load_pd(boxes->max_ys + i), q_min_y,
+                           _CMP_GE_OQ);
+    if (boxes_overlap == 0) {
+      continue;
+    }
+
+    __m512d x0 = _mm512_load_pd(arr->x0s + i);
+    __m512d y0 = _mm512_load_pd(arr->y0s + i);
+    __m512d x1 = _mm512_load_pd(arr->x1s + i);
+    __m512d y1 = _mm512_load_pd(arr->y1s + i);
+
+    __m512d l0 = _mm512_mul_pd(qdx, _mm512_sub_pd(y0, qy0));
+    __m512d r0 = _mm512_mul_pd(qdy, _mm512_sub_pd(x0, qx0));
+    __m512d l1 = _mm512_mul_pd(qdx, _mm512_sub_pd(y1, qy0));
+    __m512d r1 = _mm512_mul_pd(qdy, _mm512_sub_pd(x1, qx0));
+    __m512d sdx = _mm512_sub_pd(x1, x0);
+    __m512d sdy = _mm512_sub_pd(y1, y0);
+    __m512d l2 = _mm512_mul_pd(sdx, _mm512_sub_pd(qy0, y0));
+    __m512d r2 = _mm512_mul_pd(sdy, _mm512_sub_pd(qx0, x0));
+    __m512d l3 = _mm512_mul_pd(sdx, _mm512_sub_pd(qy1, y0));
+    __m512d r3 = _mm512_mul_pd(sdy, _mm512_sub_pd(qx1, x0));
+    __m512d d0 = _mm512_sub_pd(l0, r0);
+    __m512d d1 = _mm512_sub_pd(l1, r1);
+    __m512d d2 = _mm512_sub_pd(l2, r2);
+    __m512d d3 = _mm512_sub_pd(l3, r3);
+    __mmask8 unsure =
+        uncertain_avx512(l0, r0, d0) | uncertain_avx512(l1, r1, d1) |
+        uncertain_avx512(l2, r2, d2) | uncertain_avx512(l3, r3, d3);
+
+    __mmask8 same_side =
+        (_mm512_cmp_pd_mask(d0, zero, _CMP_GT_OQ) &
+         _mm512_cmp_pd_mask(d1, zero, _CMP_GT_OQ)) |
+        (_mm512_cmp_pd_mask(d0, zero, _CMP_LT_OQ) &
+         _mm512_cmp_pd_mask(d1, zero, _CMP_LT_OQ)) |
+        (_mm512_cmp_pd_mask(d2, zero, _CMP_GT_OQ) &
+         _mm512_cmp_pd_mask(d3, zero, _CMP_GT_OQ)) |
+        (_mm512_cmp_pd_mask(d2, zero, _CMP_LT_OQ) &
+         _mm512_cmp_pd_mask(d3, zero, _CMP_LT_OQ));
+
+    uint64_t hits = (__mmask8)(boxes_overlap & ~same_side);
+    hits = retest_lanes(q, arr, i, boxes_overlap & unsure, hits);
+    out[i / 64] |= hits << (i % 64);
+  }
+  intersects_many_scalar(q, arr, i, out);
+}
+
+#endif
+
+void segment_intersects_many(Segment query, const SegmentArray *arr,
+                             uint64_t *out_bitmask) {
+  segment_array_validate(arr);
+  assert(out_bitmask && "cannot write intersections to NULL");
+  memset(out_bitmask, 0, sizeof(uint64_t) * segment_bitmask_words(arr->size));
+  Query q = query_from_segment(query);
+  switch (simd_level()) {
+#ifdef HAS_X86_KERNELS
+  case SIMD_AVX512:
+    intersects_many_avx512(&q, arr, out_bitmask);
+    return;
+  case SIMD_AVX2:
+    intersects_many_avx2(&q, arr, out_bitmask);
+    return;
+#endif
+  default:
+    intersects_many_scalar(&q, arr, 0, out_bitmask);
+  }
+}
+
+void segment_array_validate(const SegmentArray *arr) {
+  assert(arr && "segment array must not be null");
+  assert(arr->x0s && arr->y0s && arr->x1s && arr->y1s &&
+         "segment array buffers must not be null");
+  assert(arr->capacity >= arr->size &&
+         "segment array capacity must be >= size");
+  assert(arr->boxes.size == arr->size &&
+         "segment array must have one box per segment");
+}
@@ -0,0 +1,414 @@
+// Uniform grid index, see spatial_hash.h.
+//
+// Cell coordinates are packed into a 64 bit key that is stored directly in the
+// Hash's void pointer keys. Each cell holds a Vector of item ids, also stored
+// as pointers.
+//
+// Segments are rasterized one grid column at a time: the segment's y range
+// within the column gives the rows it passes through. Both ranges are widened
+// by a tiny fraction of a cell, so rounding can only add cells, never drop
+// one. Box queries then only need to look at the cells the box covers, and
+// test the items found there exactly.
+#include "geometry/structure/spatial_hash.h"
+#include "geometry/structure/bbox.h"
+#include <assert.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+static const unsigned DEFAULT_INITIAL_CAPACITY = 16;
+
+// Widening applied to rasterized ranges, relative to the cell size
+static const double RASTER_SLACK = 1e-9;
+
+typedef struct {
+  void *key;
+  Vector ids;
+  // Position in the occupied list
+  unsigned slot;
+} Cell;
+
+static int32_t cell_coord(const SpatialHash *hash, double v) {
+  double c = floor(v / hash->cell_size);
+  if (c < INT32_MIN) {
+    return INT32_MIN;
+  }
+  if (c > INT32_MAX) {
+    return INT32_MAX;
+  }
+  return (int32_t)c;
+}
+
+static void *cell_key(int32_t cx, int32_t cy) {
+  static_assert(sizeof(void *) >= sizeof(uint64_t),
+                "cell keys are packed into pointers");
+  return (void *)(uintptr_t)((uint64_t)(uint32_t)cx << 32 | (uint32_t)cy);
+}
+
+static unsigned cell_hash(void *key) {
+  uint64_t k = (uintptr_t)key;
+  k ^= k >> 33;
+  k *= 0xff51afd7ed558ccdULL;
+  k ^= k >> 33;
+  return (unsigned)k;
+}
+
+static void *id_ptr(unsigned id) { return (void *)(uintptr_t)id; }
+
+static unsigned ptr_id(void *ptr) { return (unsigned)(uintptr_t)ptr; }
+
+void spatial_hash_init(SpatialHash *hash, double cell_size) {
+  assert(cell_size > 0 && "cell size must be positive");
+  *hash = (SpatialHash){
+      .cell_size = cell_size,
+      .items = malloc(sizeof(Segment) * DEFAULT_INITIAL_CAPACITY),
+      .alive = malloc(sizeof(bool) * DEFAULT_INITIAL_CAPACITY),
+      .stamps = malloc(sizeof(unsigned) * DEFAULT_INITIAL_CAPACITY),
+      .stamp = 0,
+      .size = 0,
+      .end = 0,
+      .capacity = DEFAULT_INITIAL_CAPACITY,
+  };
+  hash_init(&hash->cells, cell_hash, NULL);
+  vector_init(&hash->occupied);
+  vector_init(&hash->free_ids);
+}
+
+void spatial_hash_free(SpatialHash *hash) {
+  spatial_hash_validate(hash);
+  for (unsigned i = 0; i < hash->occupied.size; ++i) {
+    Cell *cell = hash->occupied.data[i];
+    vector_free(&cell->ids);
+    free(cell);
+  }
+  vector_free(&hash->occupied);
+  vector_free(&hash->free_ids);
+  hash_free(&hash->cells);
+  free(hash->stamps);
+  free(hash->alive);
+  free(hash->items);
+}
+
+static double cell_size_for(double width, double height, double extent_sum,
+                            unsigned n) {
+  if (n == 0) {
+    return 1;
+  }
+  double area = width * height;
+  double side = area > 0 ? sqrt(area / n) : fmax(width, height) / n;
+  double size = fmax(side, extent_sum / n);
+  return size > 0 ? size : 1;
+}
+
+double spatial_hash_cell_size(const Segment *segments, unsigned n) {
+  assert((segments || n == 0) && "cannot size cells for NULL segments");
+  double min_x = INFINITY, min_y = INFINITY;
+  double max_x = -INFINITY, max_y = -INFINITY;
+  double extent_sum = 0;
+  for (unsigned i = 0; i < n; ++i) {
+    Segment s = segments[i];
+    min_x = fmin(min_x, fmin(s.p0.x, s.p1.x));
+    min_y = fmin(min_y, fmin(s.p0.y, s.p1.y));
+    max_x = fmax(max_x, fmax(s.p0.x, s.p1.x));
+    max_y = fmax(max_y, fmax(s.p0.y, s.p1.y));
+    extent_sum += fmax(fabs(s.p1.x - s.p0.x), fabs(s.p1.y - s.p0.y));
+  }
+  return cell_size_for(max_x - min_x, max_y - min_y, extent_sum, n);
+}
+
+double spatial_hash_cell_size_points(const Point *points, unsigned n) {
+  assert((points || n == 0) && "cannot size cells for NULL points");
+  double min_x = INFINITY, min_y = INFINITY;
+  double max_x = -INFINITY, max_y = -INFINITY;
+  for (unsigned i = 0; i < n; ++i) {
+    min_x = fmin(min_x, points[i].x);
+    min_y = fmin(min_y, points[i].y);
+    max_x = fmax(max_x, points[i].x);
+    max_y = fmax(max_y, points[i].y);
+  }
+  return cell_size_for(max_x - min_x, max_y - min_y, 0, n);
+}
+
+typedef void (*cell_visitor_t)(SpatialHash *hash, int32_t cx, int32_t cy,
+                               unsigned id, void *data);
+
+// Calls visit once for every cell s passes through.
+static void rasterize(SpatialHash *hash, Segment s, unsigned id,
+                      cell_visitor_t visit, void *data) {
+  Point p0 = s.p0.x <= s.p1.x ? s.p0 : s.p1;
+  Point p1 = s.p0.x <= s.p1.x ? s.p1 : s.p0;
+  double c = hash->cell_size;
+  double slack = RASTER_SLACK * c;
+  double min_y = fmin(p0.y, p1.y);
+  double max_y = fmax(p0.y, p1.y);
+  double dx = p1.x - p0.x;
+  int32_t cx0 = cell_coord(hash, p0.x);
+  int32_t cx1 = cell_coord(hash, p1.x);
+  for (int64_t cx = cx0; cx <= cx1; ++cx) {
+    double ylo = min_y;
+    double yhi = max_y;
+    if (dx > 0) {
+      double xa = fmax(p0.x, cx * c - slack);
+      double xb = fmin(p1.x, (cx + 1) * c + slack);
+      double ya = p0.y + (xa - p0.x) / dx * (p1.y - p0.y);
+      double yb = p0.y + (xb - p0.x) / dx * (p1.y - p0.y);
+      ylo = fmax(min_y, fmin(ya, yb) - slack);
+      yhi = fmin(max_y, fmax(ya, yb) + slack);
+    }
+    int32_t cy0 = cell_coord(hash, ylo);
+    int32_t cy1 = cell_coord(hash, yhi);
+    for (int64_t cy = cy0; cy <= cy1; ++cy) {
+      visit(hash, (int32_t)cx, (int32_t)cy, id, data);
+    }
+  }
+}
+
+static void add_to_cell(SpatialHash *hash, int32_t cx, int32_t cy, unsigned id,
+                        void *data) {
+  (void)data;
+  void *key = cell_key(cx, cy);
+  Cell *cell = hash_get(&hash->cells, key);
+  if (!cell) {
+    cell = malloc(sizeof(Cell));
+    cell->key = key;
+    cell->slot = hash->occupied.size;
+    vector_init(&cell->ids);
+    hash_insert_pair(&hash->cells, key, cell);
+    vector_push(&hash->occupied, cell);
+  }
+  vector_push(&cell->ids, id_ptr(id));
+}
+
+static void remove_from_cell(SpatialHash *hash, int32_t cx, int32_t cy,
+                             unsigned id, void *data) {
+  (void)data;
+  Cell *cell = hash_get(&hash->cells, cell_key(cx, cy));
+  if (!cell) {
+    return;
+  }
+  for (unsigned i = 0; i < cell->ids.size; ++i) {
+    if (cell->ids.data[i] == id_ptr(id)) {
+      cell->ids.data[i] = cell->ids.data[--cell->ids.size];
+      break;
+    }
+  }
+  if (cell->ids.size > 0) {
+    return;
+  }
+  // Drop the empty cell, moving the last occupied cell into its slot
+  Cell *last = vector_pop_back(&hash->occupied);
+  if (last != cell) {
+    last->slot = cell->slot;
+    hash->occupied.data[cell->slot] = last;
+  }
+  hash_delete(&hash->cells, cell->key);
+  vector_free(&cell->ids);
+  free(cell);
+}
+
+static unsigned new_id(SpatialHash *hash) {
+  if (hash->free_ids.size > 0) {
+    return ptr_id(vector_pop_back(&hash->free_ids));
+  }
+  if (hash->end == hash->capacity) {
+    hash->capacity *= 2;
+    hash->items = realloc(hash->items, sizeof(Segment) * hash->capacity);
+    hash->alive = realloc(hash->alive, sizeof(bool) * hash->capacity);
+    hash->stamps = realloc(hash->stamps, sizeof(unsigned) * hash->capacity);
+  }
+  return hash->end++;
+}
+
+unsigned spatial_hash_insert_segment(SpatialHash *hash, Segment s) {
+  spatial_hash_validate(hash);
+  unsigned id = new_id(hash);
+  hash->items[id] = s;
+  hash->alive[id] = true;
+  hash->stamps[id] = hash->stamp;
+  ++hash->size;
+  rasterize(hash, s, id, add_to_cell, NULL);
+  return id;
+}
+
+unsigned spatial_hash_insert_point(SpatialHash *hash, Point p) {
+  return spatial_hash_insert_segment(hash, (Segment){.p0 = p, .p1 = p});
+}
+
+bool spatial_hash_delete(SpatialHash *hash, unsigned id) {
+  spatial_hash_validate(hash);
+  if (id >= hash->end || !hash->alive[id]) {
+    return false;
+  }
+  rasterize(hash, hash->items[id], id, remove_from_cell, NULL);
+  hash->alive[id] = false;
+  --hash->size;
+  vector_push(&hash->free_ids, id_ptr(id));
+  return true;
+}
+
+Segment spatial_hash_get(const SpatialHash *hash, unsigned id) {
+  assert(id < hash->end && hash->alive[id] && "no item with this id");
+  return hash->items[id];
+}
+
+static double squared_distance_to_segment(Segment s, Point p) {
+  double dx = s.p1.x - s.p0.x;
+  double dy = s.p1.y - s.p0.y;
+  double length2 = dx * dx + dy * dy;
+  double t = length2 > 0
+                 ? ((p.x - s.p0.x) * dx + (p.y - s.p0.y) * dy) / length2
+                 : 0;
+  t = fmax(0, fmin(1, t));
+  double ex = s.p0.x + t * dx - p.x;
+  double ey = s.p0.y + t * dy - p.y;
+  return ex * ex + ey * ey;
+}
+
+typedef struct {
+  Point min;
+  Point max;
+  // Zero for box queries
+  double radius;
+  Point center;
+  spatial_hash_callback_t callback;
+  void *data;
+  unsigned found;
+} Query;
+
+static void query_cell(SpatialHash *hash, Cell *cell, Query *query) {
+  for (unsigned i = 0; i < cell->ids.size; ++i) {
+    unsigned id = ptr_id(cell->ids.data[i]);
+    if (hash->stamps[id] == hash->stamp) {
+      continue;
+    }
+    hash->stamps[id] = hash->stamp;
+    Segment s = hash->items[id];
+    bool hit = query->radius > 0
+                   ? squared_distance_to_segment(s, query->center) <=
+                         query->radius * query->radius
+                   : segment_intersects_bbox(
+                         s, bbox_from_corners(query->min, query->max));
+    if (hit) {
+      ++query->found;
+      query->callback(id, query->data);
+    }
+  }
+}
+
+static unsigned query(SpatialHash *hash, Query *q) {
+  spatial_hash_validate(hash);
+  ++hash->stamp;
+  int64_t cx0 = cell_coord(hash, q->min.x);
+  int64_t cy0 = cell_coord(hash, q->min.y);
+  int64_t cx1 = cell_coord(hash, q->max.x);
+  int64_t cy1 = cell_coord(hash, q->max.y);
+  if (cx0 > cx1 || cy0 > cy1) {
+    return 0;
+  }
+  if ((uint64_t)(cx1 - cx0 + 1) * (uint64_t)(cy1 - cy0 + 1) >
+      hash->occupied.size) {
+    // The box covers more cells than are occupied
+    for (unsigned i = 0; i < hash->occupied.size; ++i) {
+      Cell *cell = hash->occupied.data[i];
+      uint64_t key = (uintptr_t)cell->key;
+      int32_t cx = (int32_t)(uint32_t)(key >> 32);
+      int32_t cy = (int32_t)(uint32_t)key;
+      if (cx >= cx0 && cx <= cx1 && cy >= cy0 && cy <= cy1) {
+        query_cell(hash, cell, q);
+      }
+    }
+    return q->found;
+  }
+  for (int64_t cx = cx0; cx <= cx1; ++cx) {
+    for (int64_t cy = cy0; cy <= cy1; ++cy) {
+      Cell *cell = hash_get(&hash->cells, cell_key(cx, cy));
+      if (cell) {
+        query_cell(hash, cell, q);
+      }
+    }
+  }
+  return q->found;
+}
+
+unsigned spatial_hash_query_box(SpatialHash *hash, Point min, Point max,
+                                spatial_hash_callback_t callback, void *data) {
+  Query q = {
+      .min = min,
+      .max = max,
+      .radius = 0,
+      .callback = callback,
+      .data = data,
+      .found = 0,
+  };
+  return query(hash, &q);
+}
+
+unsigned spatial_hash_query_radius(SpatialHash *hash, Point center,
+                                   double radius,
+                                   spatial_hash_callback_t callback,
+                                   void *data) {
+  if (radius <= 0) {
+    // Only items through the center itself
+    return spatial_hash_query_box(hash, center, center, callback, data);
+  }
+  Query q = {
+      .min = {center.x - radius, center.y - radius},
+      .max = {center.x + radius, center.y + radius},
+      .radius = radius,
+      .center = center,
+      .callback = callback,
+      .data = data,
+      .found = 0,
+  };
+  return query(hash, &q);
+}
+
+typedef struct {
+  spatial_hash_pair_callback_t callback;
+  void *data;
+  unsigned found;
+} PairQuery;
+
+// Reports the items after id in the cell that were not reported for id yet.
+static void pair_cell(SpatialHash *hash, int32_t cx, int32_t cy, unsigned id,
+                      void *data) {
+  PairQuery *q = data;
+  Cell *cell = hash_get(&hash->cells, cell_key(cx, cy));
+  for (unsigned i = 0; i < cell->ids.size; ++i) {
+    unsigned other = ptr_id(cell->ids.data[i]);
+    if (other <= id || hash->stamps[other] == hash->stamp) {
+      continue;
+    }
+    hash->stamps[other] = hash->stamp;
+    ++q->found;
+    q->callback(id, other, q->data);
+  }
+}
+
+unsigned spatial_hash_candidate_pairs(SpatialHash *hash,
+                                      spatial_hash_pair_callback_t callback,
+                                      void *data) {
+  spatial_hash_validate(hash);
+  PairQuery q = {.callback = callback, .data = data, .found = 0};
+  // Each item collects its partners with larger ids over all its cells, so
+  // every pair is reported once.
+  for (unsigned id = 0; id < hash->end; ++id) {
+    if (!hash->alive[id]) {
+      continue;
+    }
+    ++hash->stamp;
+    rasterize(hash, hash->items[id], id, pair_cell, &q);
+  }
+  return q.found;
+}
+
+void spatial_hash_validate(const SpatialHash *hash) {
+  assert(hash && "spatial hash must not be null");
+  assert(hash->cell_size > 0 && "spatial hash cell size must be positive");
+  assert(hash->end <= hash->capacity &&
+         "spatial hash capacity must be >= number of ids");
+  assert(hash->size + hash->free_ids.size == hash->end &&
+         "spatial hash ids must be either live or free");
+  assert(hash->occupied.size == hash->cells.size &&
+         "spatial hash occupied list must match its cells");
+}
@@ -0,0 +1,440 @@
+#include "geometry/structure/trapezoidal_map.h"
+#include "data_structure/parallel.h"
+#include "geometry/space_filling_curve.h"
+#include "geometry/predicates.h"
+#include <assert.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+static const unsigned INITIAL_CAPACITY = 64;
+
+static bool point_before(Point a, Point b) {
+  return a.x < b.x || (a.x == b.x && a.y < b.y);
+}
+
+static bool point_same(Point a, Point b) { return a.x == b.x && a.y == b.y; }
+
+static Point endpoint(const Segment *segments, unsigned index) {
+  return index & 1 ? segments[index / 2].p1 : segments[index / 2].p0;
+}
+
+// Follows the DAG from the root to the leaf whose trapezoid contains p. When
+// p is on a Y node's segment, which happens when it is an endpoint the
+// segment shares with the one being inserted, q, that segment's other
+// endpoint, decides. Queries pass q = p, which puts them above.
+static unsigned descend(const TrapezoidalMapNode *nodes,
+                        const Segment *segments, Point p, Point q) {
+  unsigned n = 0;
+  while (nodes[n].kind != TRAPEZOIDAL_MAP_LEAF) {
+    TrapezoidalMapNode node = nodes[n];
+    bool right;
+    if (node.kind == TRAPEZOIDAL_MAP_X_NODE) {
+      right = !point_before(p, endpoint(segments, node.index));
+    } else {
+      Segment s = segments[node.index];
+      double o = orient2d(s.p0, s.p1, p);
+      right = o > 0 || (o == 0 && orient2d(s.p0, s.p1, q) >= 0);
+    }
+    n = right ? node.right : node.left;
+  }
+  return n;
+}
+
+// A trapezoid while the map is built, with its neighbors across its left and
+// right walls. A wall has a neighbor above and below the point it passes
+// through. Where it extends only one way, both slots hold the one neighbor,
+// and where it has no length, both are UINT_MAX.
+typedef struct {
+  Trapezoid t;
+  unsigned upper_left;
+  unsigned lower_left;
+  unsigned upper_right;
+  unsigned lower_right;
+  unsigned node;
+  bool dead;
+} Piece;
+
+typedef struct {
+  const Segment *segments;
+  Piece *pieces;
+  TrapezoidalMapNode *nodes;
+  // The trapezoids the segment being inserted crosses, left to right, and
+  // the pieces above and below it in each
+  unsigned *path;
+  unsigned *ups;
+  unsigned *lows;
+  unsigned num_pieces;
+  unsigned num_nodes;
+  unsigned piece_capacity;
+  unsigned node_capacity;
+  unsigned path_capacity;
+} Builder;
+
+static unsigned new_node(Builder *b, TrapezoidalMapNodeKind kind,
+                         unsigned index, unsigned left, unsigned right) {
+  if (b->num_nodes == b->node_capacity) {
+    b->node_capacity *= 2;
+    b->nodes =
+        realloc(b->nodes, sizeof(TrapezoidalMapNode) * b->node_capacity);
+  }
+  b->nodes[b->num_nodes] = (TrapezoidalMapNode){kind, index, left, right};
+  return b->num_nodes++;
+}
+
+static unsigned new_piece(Builder *b, unsigned top, unsigned bottom,
+                          Point left, Point right) {
+  if (b->num_pieces == b->piece_capacity) {
+    b->piece_capacity *= 2;
+    b->pieces = realloc(b->pieces, sizeof(Piece) * b->piece_capacity);
+  }
+  unsigned id = b->num_pieces++;
+  b->pieces[id] = (Piece){
+      .t = {top, bottom, left, right},
+      .upper_left = UINT_MAX,
+      .lower_left = UINT_MAX,
+      .upper_right = UINT_MAX,
+      .lower_right = UINT_MAX,
+      .node = new_node(b, TRAPEZOIDAL_MAP_LEAF, id, 0, 0),
+      .dead = false,
+  };
+  return id;
+}
+
+static void set_left(Builder *b, unsigned id, unsigned upper, unsigned lower) {
+  b->pieces[id].upper_left = upper;
+  b->pieces[id].lower_left = lower;
+}
+
+static void set_right(Builder *b, unsigned id, unsigned upper,
+                      unsigned lower) {
+  b->pieces[id].upper_right = upper;
+  b->pieces[id].lower_right = lower;
+}
+
+// Points the left neighbor slots of id that hold from at to instead.
+static void replace_left(Builder *b, unsigned id, unsigned from, unsigned to) {
+  if (id == UINT_MAX) {
+    return;
+  }
+  Piece *piece = &b->pieces[id];
+  piece->upper_left = piece->upper_left == from ? to : piece->upper_left;
+  piece->lower_left = piece->lower_left == from ? to : piece->lower_left;
+}
+
+static void replace_right(Builder *b, unsigned id, unsigned from,
+                          unsigned to) {
+  if (id == UINT_MAX) {
+    return;
+  }
+  Piece *piece = &b->pieces[id];
+  piece->upper_right = piece->upper_right == from ? to : piece->upper_right;
+  piece->lower_right = piece->lower_right == from ? to : piece->lower_right;
+}
+
+static bool starts_at(const Builder *b, unsigned segment, Point p) {
+  return segment != UINT_MAX && point_same(b->segments[segment].p0, p);
+}
+
+static bool ends_at(const Builder *b, unsigned segment, Point p) {
+  return segment != UINT_MAX && point_same(b->segments[segment].p1, p);
+}
+
+static void push_path(Builder *b, unsigned k, unsigned id) {
+  if (k == b->path_capacity) {
+    b->path_capacity *= 2;
+    b->path = realloc(b->path, sizeof(unsigned) * b->path_capacity);
+    b->ups = realloc(b->ups, sizeof(unsigned) * b->path_capacity);
+    b->lows = realloc(b->lows, sizeof(unsigned) * b->path_capacity);
+  }
+  b->path[k] = id;
+}
+
+// Finds the trapezoids segment i crosses by walking right from the one that
+// contains its left endpoint, and returns the index of the last.
+static unsigned follow_segment(Builder *b, unsigned i) {
+  Point p = b->segments[i].p0;
+  Point q = b->segments[i].p1;
+  unsigned d = b->nodes[descend(b->nodes, b->segments, p, q)].index;
+  unsigned k = 0;
+  push_path(b, k, d);
+  while (point_before(b->pieces[d].t.right, q)) {
+    Piece piece = b->pieces[d];
+    d = orient2d(p, q, piece.t.right) > 0 ? piece.lower_right
+                                          : piece.upper_right;
+    assert(d != UINT_MAX && "segments cross");
+    push_path(b, ++k, d);
+  }
+  return k;
+}
+
+// Splits the trapezoids segment i crosses into the pieces above and below it,
+// merging the pieces on the side of it where a wall was cut, and the pieces
+// left of its left endpoint and right of its right endpoint.
+static void insert_segment(Builder *b, unsigned i) {
+  Point p = b->segments[i].p0;
+  Point q = b->segments[i].p1;
+  unsigned k = follow_segment(b, i);
+
+  unsigned first = b->path[0];
+  Piece d = b->pieces[first];
+  unsigned up = new_piece(b, d.t.top, i, p, q);
+  unsigned low = new_piece(b, i, d.t.bottom, p, q);
+  unsigned left = UINT_MAX;
+  if (point_before(d.t.left, p)) {
+    left = new_piece(b, d.t.top, d.t.bottom, d.t.left, p);
+    set_left(b, left, d.upper_left, d.lower_left);
+    replace_right(b, d.upper_left, first, left);
+    replace_right(b, d.lower_left, first, left);
+    set_right(b, left, up, low);
+    set_left(b, up, left, left);
+    set_left(b, low, left, left);
+  } else if (starts_at(b, d.t.top, p)) {
+    set_left(b, low, d.lower_left, d.lower_left);
+    replace_right(b, d.lower_left, first, low);
+  } else if (starts_at(b, d.t.bottom, p)) {
+    set_left(b, up, d.upper_left, d.upper_left);
+    replace_right(b, d.upper_left, first, up);
+  } else {
+    set_left(b, up, d.upper_left, d.upper_left);
+    set_left(b, low, d.lower_left, d.lower_left);
+    replace_right(b, d.upper_left, first, up);
+    replace_right(b, d.lower_left, first, low);
+  }
+  b->ups[0] = up;
+  b->lows[0] = low;
+
+  for (unsigned j = 1; j <= k; ++j) {
+    unsigned prev = b->path[j - 1];
+    unsigned cur = b->path[j];
+    Piece before = b->pieces[prev];
+    Piece after = b->pieces[cur];
+    Point w = before.t.right;
+    if (orient2d(p, q, w) > 0) {
+      // The wall through w is cut below w, so the pieces below merge
+      unsigned next = new_piece(b, after.t.top, i, w, q);
+      b->pieces[up].t.right = w;
+      set_right(b, up, before.upper_right != cur ? before.upper_right : next,
+                next);
+      replace_left(b, before.upper_right, prev, up);
+      set_left(b, next, after.upper_left != prev ? after.upper_left : up, up);
+      replace_right(b, after.upper_left, cur, next);
+      up = next;
+    } else {
+      unsigned next = new_piece(b, i, after.t.bottom, w, q);
+      b->pieces[low].t.right = w;
+      set_right(b, low, next,
+                before.lower_right != cur ? before.lower_right : next);
+      replace_left(b, before.lower_right, prev, low);
+      set_left(b, next, low, after.lower_left != prev ? after.lower_left : low);
+      replace_right(b, after.lower_left, cur, next);
+      low = next;
+    }
+    b->ups[j] = up;
+    b->lows[j] = low;
+  }
+
+  unsigned last = b->path[k];
+  d = b->pieces[last];
+  unsigned right = UINT_MAX;
+  if (point_before(q, d.t.right)) {
+    right = new_piece(b, d.t.top, d.t.bottom, q, d.t.right);
+    set_right(b, right, d.upper_right, d.lower_right);
+    replace_left(b, d.upper_right, last, right);
+    replace_left(b, d.lower_right, last, right);
+    set_left(b, right, up, low);
+    set_right(b, up, right, right);
+    set_right(b, low, right, right);
+  } else if (ends_at(b, d.t.top, q)) {
+    set_right(b, low, d.lower_right, d.lower_right);
+    replace_left(b, d.lower_right, last, low);
+  } else if (ends_at(b, d.t.bottom, q)) {
+    set_right(b, up, d.upper_right, d.upper_right);
+    replace_left(b, d.upper_right, last, up);
+  } else {
+    set_right(b, up, d.upper_right, d.upper_right);
+    set_right(b, low, d.lower_right, d.lower_right);
+    replace_left(b, d.upper_right, last, up);
+    replace_left(b, d.lower_right, last, low);
+  }
+
+  // Each crossed trapezoid's leaf becomes the root of the DAG that splits it
+  for (unsigned j = 0; j <= k; ++j) {
+    unsigned root = new_node(b, TRAPEZOIDAL_MAP_Y_NODE, i,
+                             b->pieces[b->lows[j]].node,
+                             b->pieces[b->ups[j]].node);
+    if (j == k && right != UINT_MAX) {
+      root = new_node(b, TRAPEZOIDAL_MAP_X_NODE, 2 * i + 1, root,
+                      b->pieces[right].node);
+    }
+    if (j == 0 && left != UINT_MAX) {
+      root = new_node(b, TRAPEZOIDAL_MAP_X_NODE, 2 * i,
+                      b->pieces[left].node, root);
+    }
+    Piece *crossed = &b->pieces[b->path[j]];
+    b->nodes[crossed->node] = b->nodes[root];
+    crossed->dead = true;
+  }
+}
+
+// A well mixed hash of i, from splitmix64, so the insertion order is random
+// but the same on every run.
+static uint64_t mix(uint64_t i) {
+  i += 0x9e3779b97f4a7c15;
+  i = (i ^ (i >> 30)) * 0xbf58476d1ce4e5b9;
+  i = (i ^ (i >> 27)) * 0x94d049bb133111eb;
+  return i ^ (i >> 31);
+}
+
+// Copies the live trapezoids and the nodes reachable from the root into the
+// map, numbering nodes in breadth-first order.
+static void finish(Builder *b, TrapezoidalMap *map) {
+  unsigned *trapezoid_ids = malloc(sizeof(unsigned) * b->num_pieces);
+  map->trapezoids = malloc(sizeof(Trapezoid) * b->num_pieces);
+  map->num_trapezoids = 0;
+  for (unsigned i = 0; i < b->num_pieces; ++i) {
+    if (!b->pieces[i].dead) {
+      trapezoid_ids[i] = map->num_trapezoids;
+      map->trapezoids[map->num_trapezoids++] = b->pieces[i].t;
+    }
+  }
+
+  unsigned *node_ids = malloc(sizeof(unsigned) * b->num_nodes);
+  unsigned *queue = malloc(sizeof(unsigned) * b->num_nodes);
+  for (unsigned i = 0; i < b->num_nodes; ++i) {
+    node_ids[i] = UINT_MAX;
+  }
+  unsigned size = 0;
+  node_ids[0] = 0;
+  queue[size++] = 0;
+  for (unsigned head = 0; head < size; ++head) {
+    TrapezoidalMapNode node = b->nodes[queue[head]];
+    if (node.kind == TRAPEZOIDAL_MAP_LEAF) {
+      continue;
+    }
+    unsigned children[2] = {node.left, node.right};
+    for (unsigned c = 0; c < 2; ++c) {
+      if (node_ids[children[c]] == UINT_MAX) {
+        node_ids[children[c]] = size;
+        queue[size++] = children[c];
+      }
+    }
+  }
+  map->nodes = malloc(sizeof(TrapezoidalMapNode) * size);
+  map->num_nodes = size;
+  for (unsigned i = 0; i < size; ++i) {
+    TrapezoidalMapNode node = b->nodes[queue[i]];
+    if (node.kind == TRAPEZOIDAL_MAP_LEAF) {
+      node.index = trapezoid_ids[node.index];
+    } else {
+      node.left = node_ids[node.left];
+      node.right = node_ids[node.right];
+    }
+    map->nodes[i] = node;
+  }
+  free(queue);
+  free(node_ids);
+  free(trapezoid_ids);
+}
+
+void trapezoidal_map_init(TrapezoidalMap *map, const Segment *segments,
+                          unsigned n) {
+  assert((segments || n == 0) && "cannot build a map of NULL segments");
+  map->segments = malloc(sizeof(Segment) * (n ? n : 1));
+  map->num_segments = n;
+  unsigned *order = malloc(sizeof(unsigned) * (n ? n : 1));
+  unsigned m = 0;
+  for (unsigned i = 0; i < n; ++i) {
+    Segment s = segments[i];
+    if (point_before(s.p1, s.p0)) {
+      s = (Segment){s.p1, s.p0};
+    }
+    map->segments[i] = s;
+    if (point_same(s.p0, s.p1)) {
+      continue;
+    }
+    // Inside-out Fisher-Yates shuffle
+    unsigned j = (unsigned)(mix(m) % (m + 1));
+    if (j != m) {
+      order[m] = order[j];
+    }
+    order[j] = i;
+    ++m;
+  }
+
+  Builder b = {
+      .segments = map->segments,
+      .pieces = malloc(sizeof(Piece) * INITIAL_CAPACITY),
+      .nodes = malloc(sizeof(TrapezoidalMapNode) * INITIAL_CAPACITY),
+      .path = malloc(sizeof(unsigned) * INITIAL_CAPACITY),
+      .ups = malloc(sizeof(unsigned) * INITIAL_CAPACITY),
+      .lows = malloc(sizeof(unsigned) * INITIAL_CAPACITY),
+      .piece_capacity = INITIAL_CAPACITY,
+      .node_capacity = INITIAL_CAPACITY,
+      .path_capacity = INITIAL_CAPACITY,
+  };
+  new_piece(&b, UINT_MAX, UINT_MAX, (Point){-INFINITY, -INFINITY},
+            (Point){INFINITY, INFINITY});
+  for (unsigned i = 0; i < m; ++i) {
+    insert_segment(&b, order[i]);
+  }
+  finish(&b, map);
+  free(b.lows);
+  free(b.ups);
+  free(b.path);
+  free(b.nodes);
+  free(b.pieces);
+  free(order);
+}
+
+void trapezoidal_map_free(TrapezoidalMap *map) {
+  free(map->segments);
+  free(map->trapezoids);
+  free(map->nodes);
+}
+
+unsigned trapezoidal_map_locate(const TrapezoidalMap *map, Point p) {
+  return map->nodes[descend(map->nodes, map->segments, p, p)].index;
+}
+
+typedef struct {
+  const TrapezoidalMap *map;
+  const Point *points;
+  const unsigned *order;
+  unsigned *out;
+  unsigned lo;
+  unsigned hi;
+} LocateChunk;
+
+static void *locate_chunk(void *data) {
+  LocateChunk *chunk = data;
+  for (unsigned i = chunk->lo; i < chunk->hi; ++i) {
+    unsigned k = chunk->order[i];
+    chunk->out[k] = trapezoidal_map_locate(chunk->map, chunk->points[k]);
+  }
+  return NULL;
+}
+
+void trapezoidal_map_locate_many(const TrapezoidalMap *map,
+                                 const Point *points, unsigned n,
+                                 unsigned *out, unsigned num_threads) {
+  assert((points || n == 0) && "cannot locate NULL points");
+  assert(num_threads > 0 && "need at least one thread");
+  unsigned *order = malloc(sizeof(unsigned) * (n ? n : 1));
+  spatial_sort(points, n, CURVE_HILBERT, order, num_threads);
+
+  LocateChunk *chunks = malloc(sizeof(LocateChunk) * num_threads);
+  for (unsigned t = 0; t < num_threads; ++t) {
+    chunks[t] = (LocateChunk){
+        .map = map,
+        .points = points,
+        .order = order,
+        .out = out,
+        .lo = (unsigned)((unsigned long)n * t / num_threads),
+        .hi = (unsigned)((unsigned long)n * (t + 1) / num_threads),
+    };
+  }
+  parallel_for(num_threads, locate_chunk, chunks, sizeof(LocateChunk));
+  free(chunks);
+  free(order);
+}
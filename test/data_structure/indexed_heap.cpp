@@ -0,0 +1,88 @@
+extern "C" {
+#include "data_structure/indexed_heap.h"
+}
+#include <climits>
+#include <gtest/gtest.h>
+#include <set>
+#include <utility>
+#include <vector>
+
+TEST(IndexedHeapTest, Empty) {
+  IndexedHeap heap;
+  indexed_heap_init(&heap, 0);
+  ASSERT_EQ(indexed_heap_peek(&heap), UINT_MAX);
+  ASSERT_EQ(indexed_heap_pop(&heap), UINT_MAX);
+  indexed_heap_free(&heap);
+}
+
+TEST(IndexedHeapTest, Update) {
+  IndexedHeap heap;
+  indexed_heap_init(&heap, 4);
+  indexed_heap_update(&heap, 0, 3);
+  indexed_heap_update(&heap, 1, 1);
+  indexed_heap_update(&heap, 2, 2);
+  ASSERT_EQ(indexed_heap_peek(&heap), 1);
+  indexed_heap_update(&heap, 1, 5);
+  ASSERT_EQ(indexed_heap_peek(&heap), 2);
+  indexed_heap_update(&heap, 0, 0);
+  ASSERT_TRUE(indexed_heap_contains(&heap, 0));
+  ASSERT_FALSE(indexed_heap_contains(&heap, 3));
+  ASSERT_EQ(indexed_heap_pop(&heap), 0);
+  ASSERT_FALSE(indexed_heap_contains(&heap, 0));
+
+  // Equal keys come out by id
+  indexed_heap_update(&heap, 3, 2);
+  ASSERT_EQ(indexed_heap_pop(&heap), 2);
+  ASSERT_EQ(indexed_heap_pop(&heap), 3);
+  ASSERT_EQ(indexed_heap_pop(&heap), 1);
+  ASSERT_EQ(indexed_heap_pop(&heap), UINT_MAX);
+  indexed_heap_free(&heap);
+}
+
+TEST(IndexedHeapTest, Random) {
+  // Cross-check against an ordered set of (key, id)
+  srand(0);
+  const unsigned n = 500;
+  IndexedHeap heap;
+  indexed_heap_init(&heap, n);
+  std::set<std::pair<double, unsigned>> expected;
+  std::vector<double> keys(n);
+  for (unsigned step = 0; step < 20000; ++step) {
+    unsigned id = rand() % n;
+    switch (rand() % 4) {
+    case 0:
+    case 1: {
+      double key = rand() % 100;
+      if (indexed_heap_contains(&heap, id)) {
+        expected.erase({keys[id], id});
+      }
+      keys[id] = key;
+      expected.insert({key, id});
+      indexed_heap_update(&heap, id, key);
+      break;
+    }
+    case 2:
+      if (indexed_heap_contains(&heap, id)) {
+        expected.erase({keys[id], id});
+      }
+      indexed_heap_remove(&heap, id);
+      break;
+    default: {
+      unsigned popped = indexed_heap_pop(&heap);
+      if (expected.empty()) {
+        ASSERT_EQ(popped, UINT_MAX);
+      } else {
+        ASSERT_EQ(popped, expected.begin()->second);
+        expected.erase(expected.begin());
+      }
+    }
+    }
+    ASSERT_EQ(heap.size, expected.size());
+  }
+  indexed_heap_clear(&heap);
+  ASSERT_EQ(heap.size, 0);
+  for (unsigned id = 0; id < n; ++id) {
+    ASSERT_FALSE(indexed_heap_contains(&heap, id));
+  }
+  indexed_heap_free(&heap);
+}
@@ -0,0 +1,36 @@
+extern "C" {
+#include "data_structure/parallel.h"
+}
+#include <gtest/gtest.h>
+#include <pthread.h>
+#include <vector>
+
+typedef struct {
+  unsigned index;
+  unsigned runs;
+  pthread_t thread;
+} Chunk;
+
+static void *run_chunk(void *data) {
+  Chunk *chunk = (Chunk *)data;
+  ++chunk->runs;
+  chunk->thread = pthread_self();
+  return NULL;
+}
+
+TEST(Parallel, ParallelFor) {
+  parallel_for(0, run_chunk, nullptr, sizeof(Chunk));
+  for (unsigned n : {1, 2, 7, 64}) {
+    std::vector<Chunk> chunks(n);
+    for (unsigned i = 0; i < n; ++i) {
+      chunks[i] = {.index = i, .runs = 0};
+    }
+    parallel_for(n, run_chunk, chunks.data(), sizeof(Chunk));
+    for (unsigned i = 0; i < n; ++i) {
+      ASSERT_EQ(chunks[i].index, i);
+      ASSERT_EQ(chunks[i].runs, 1);
+    }
+    // The calling thread takes the first chunk
+    ASSERT_TRUE(pthread_equal(chunks[0].thread, pthread_self()));
+  }
+}
@@ -96,3 +96,17 @@ TEST(PriorityQueueTest, Length8) { pq_test_length(8); }
 TEST(PriorityQueueTest, Length128) { pq_test_length(128); }
 TEST(PriorityQueueTest, LengthBar) { pq_test_length(0xBA5); }
 TEST(PriorityQueueTest, LengthFoo) { pq_test_length(0xF00); }
+
+TEST(PriorityQueueTest, Comparator) {
+  PriorityQueue pq;
+  pq_initc(&pq, greater_than_cmp);
+  for (long i = 0; i < 100; ++i) {
+    pq_push(&pq, (void *)i);
+  }
+  for (long i = 99; i >= 0; --i) {
+    ASSERT_EQ((long)pq_peek(&pq), i);
+    ASSERT_EQ((long)pq_pop(&pq), i);
+  }
+  ASSERT_FALSE(pq_peek(&pq));
+  pq_free(&pq);
+}
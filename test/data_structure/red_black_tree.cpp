@@ -4,6 +4,7 @@ extern "C" {
 #include "data_structure/vector.h"
 }
 #include <gtest/gtest.h>
+#include <vector>
 
 static const unsigned STRIDE = 5;
 
@@ -276,3 +277,100 @@ TEST(RedBlackTree, LengthABC) { rb_tree_test_length(0xABC); }
 TEST(RedBlackTree, LengthBar) { rb_tree_test_length(0xBA5); }
 TEST(RedBlackTree, LengthCao) { rb_tree_test_length(0xCA0); }
 TEST(RedBlackTree, LengthFoo) { rb_tree_test_length(0xF00); }
+
+// Inserts 0..n-1 in a shuffled order keeping the handles, deletes every
+// STRIDEth element through its handle, and checks that the remaining handles
+// still hold their values and link to their neighbors.
+void rb_tree_test_node_handles(unsigned n) {
+  srand(n);
+  RedBlackTree tree;
+  rb_tree_init(&tree);
+  long *order = (long *)malloc(sizeof(long) * n);
+  for (long i = 0; i < n; ++i) {
+    order[i] = i;
+  }
+  for (unsigned i = n; i > 1; --i) {
+    unsigned j = rand() % i;
+    long t = order[i - 1];
+    order[i - 1] = order[j];
+    order[j] = t;
+  }
+  RedBlackNode **nodes = (RedBlackNode **)malloc(sizeof(RedBlackNode *) * n);
+  for (unsigned i = 0; i < n; ++i) {
+    nodes[order[i]] = rb_tree_insert_node(&tree, (void *)order[i]);
+    ASSERT_TRUE(nodes[order[i]]);
+  }
+  ASSERT_FALSE(rb_tree_insert_node(&tree, (void *)0));
+
+  for (unsigned long i = 0; i < n; i += STRIDE) {
+    ASSERT_EQ(rb_tree_delete_node(&tree, nodes[i]), (void *)i);
+    rb_tree_validate_expensive(&tree);
+  }
+  for (unsigned long i = 0; i < n; ++i) {
+    if (i % STRIDE == 0) {
+      test_get_false(&tree, i);
+      continue;
+    }
+    ASSERT_EQ(rb_tree_node_val(nodes[i]), (void *)i);
+    RedBlackNode *next = rb_tree_node_next(nodes[i]);
+    RedBlackNode *prev = rb_tree_node_prev(nodes[i]);
+    unsigned long expected_next = (i + 1) % STRIDE == 0 ? i + 2 : i + 1;
+    unsigned long expected_prev = (i - 1) % STRIDE == 0 ? i - 2 : i - 1;
+    if (expected_next < n) {
+      ASSERT_EQ(rb_tree_node_val(next), (void *)expected_next);
+    } else {
+      ASSERT_FALSE(next);
+    }
+    if (i > 1) {
+      ASSERT_EQ(rb_tree_node_val(prev), (void *)expected_prev);
+    } else {
+      ASSERT_FALSE(prev);
+    }
+  }
+  ASSERT_EQ(rb_tree_node_val(rb_tree_first_node(&tree)), (void *)1);
+  ASSERT_EQ(rb_tree_upper_bound(&tree, (void *)1), nodes[2]);
+  ASSERT_EQ(rb_tree_upper_bound(&tree, (void *)4), nodes[6]);
+  ASSERT_FALSE(rb_tree_upper_bound(&tree, rb_tree_node_val(rb_tree_last_node(&tree))));
+  free(nodes);
+  free(order);
+  rb_tree_free(&tree);
+}
+
+TEST(RedBlackTree, NodeHandles) {
+  rb_tree_test_node_handles(16);
+  rb_tree_test_node_handles(128);
+  rb_tree_test_node_handles(0xBA5);
+}
+
+TEST(RedBlackTree, InsertAfter) {
+  // Build 0..n-1 in a shuffled order of positional insertions
+  static const unsigned n = 500;
+  RedBlackTree tree;
+  rb_tree_init(&tree);
+  std::vector<RedBlackNode *> nodes(n, nullptr);
+  srand(0);
+  for (unsigned k = 0; k < n; ++k) {
+    unsigned long i = k == 0 ? 0 : rand() % n;
+    while (nodes[i]) {
+      i = (i + 1) % n;
+    }
+    RedBlackNode *before = nullptr;
+    for (unsigned long j = i; j-- > 0;) {
+      if (nodes[j]) {
+        before = nodes[j];
+        break;
+      }
+    }
+    nodes[i] = rb_tree_insert_after(&tree, before, (void *)i);
+    rb_tree_validate_expensive(&tree);
+  }
+  ASSERT_EQ(tree.size, n);
+  RedBlackNode *node = rb_tree_first_node(&tree);
+  for (unsigned long i = 0; i < n; ++i) {
+    ASSERT_EQ(node, nodes[i]);
+    ASSERT_EQ(rb_tree_node_val(node), (void *)i);
+    node = rb_tree_node_next(node);
+  }
+  ASSERT_FALSE(node);
+  rb_tree_free(&tree);
+}
@@ -1,7 +1,9 @@
 extern "C" {
 #include "data_structure/sort.h"
 }
+#include <cmath>
 #include <gtest/gtest.h>
+#include <vector>
 
 static void test_sorted(void **data, sort_t sort, unsigned n) {
   data = sort(data, n);
@@ -50,6 +52,7 @@ static void test_length(unsigned n) {
   test_sort(quick_sort, n);
   test_sort(selection_sort, n);
   test_sort(tree_sort, n);
+  test_sort(tim_sort, n);
 }
 
 TEST(Sort, Length1) { test_length(1); }
@@ -67,3 +70,235 @@ TEST(Sort, LengthABC) { test_length(0xABC); }
 TEST(Sort, LengthBar) { test_length(0xBA5); }
 TEST(Sort, LengthCao) { test_length(0xCA0); }
 TEST(Sort, LengthFoo) { test_length(0xF00); }
+
+typedef struct {
+  long key;
+  unsigned index;
+} Keyed;
+
+static Ordering keyed_cmp(void *a, void *b) {
+  long ka = ((Keyed *)a)->key;
+  long kb = ((Keyed *)b)->key;
+  if (ka < kb) {
+    return LESS;
+  } else if (ka == kb) {
+    return EQUALS;
+  }
+  return GREATER;
+}
+
+// Sorts n elements with keys in [0, num_keys) and checks that elements with
+// equal keys keep their original relative order.
+static void test_stable(unsigned n, unsigned num_keys) {
+  srand(n);
+  Keyed *items = (Keyed *)malloc(sizeof(Keyed) * n);
+  void **data = (void **)malloc(sizeof(void *) * n);
+  for (unsigned i = 0; i < n; ++i) {
+    items[i] = (Keyed){.key = rand() % num_keys, .index = i};
+    data[i] = items + i;
+  }
+  tim_sortc(data, n, keyed_cmp);
+  for (unsigned i = 1; i < n; ++i) {
+    Keyed *prev = (Keyed *)data[i - 1];
+    Keyed *curr = (Keyed *)data[i];
+    ASSERT_LE(prev->key, curr->key);
+    if (prev->key == curr->key) {
+      ASSERT_LT(prev->index, curr->index);
+    }
+  }
+  free(data);
+  free(items);
+}
+
+// Sorted input where every `stride`th element is swapped with a random
+// neighbor within `distance`.
+static void test_nearly_sorted(sort_t sort, unsigned n, unsigned stride,
+                               unsigned distance) {
+  srand(n);
+  void **data = (void **)malloc(sizeof(void *) * n);
+  for (long i = 0; i < n; ++i) {
+    data[i] = (void *)i;
+  }
+  for (unsigned i = 0; i + distance < n; i += stride) {
+    unsigned j = i + 1 + rand() % distance;
+    void *t = data[i];
+    data[i] = data[j];
+    data[j] = t;
+  }
+  test_sorted(data, sort, n);
+}
+
+TEST(Sort, TimSortComparator) {
+  const unsigned n = 1000;
+  void **data = (void **)malloc(sizeof(void *) * n);
+  for (long i = 0; i < n; ++i) {
+    data[i] = (void *)(long)rand();
+  }
+  tim_sortc(data, n, greater_than_cmp);
+  for (unsigned i = 0; i < n - 1; ++i) {
+    ASSERT_GE(data[i], data[i + 1]);
+  }
+  free(data);
+}
+
+TEST(Sort, TimSortStable) {
+  test_stable(100, 3);
+  test_stable(5000, 10);
+  test_stable(100000, 50);
+  test_stable(100000, 5000);
+}
+
+TEST(Sort, TimSortNearlySorted) {
+  test_nearly_sorted(tim_sort, 10000, 100, 10);
+  test_nearly_sorted(tim_sort, 10000, 10, 1000);
+  test_nearly_sorted(tim_sort, 100000, 1000, 50000);
+  test_nearly_sorted(insertion_sort, 10000, 100, 10);
+}
+
+TEST(Sort, TimSortRuns) {
+  // Alternating ascending and descending runs of varying lengths
+  const unsigned n = 100000;
+  void **data = (void **)malloc(sizeof(void *) * n);
+  unsigned i = 0;
+  for (unsigned run = 1; i < n; ++run) {
+    unsigned len = (run * 37) % 500 + 1;
+    for (unsigned j = 0; j < len && i < n; ++j, ++i) {
+      long v = run % 2 ? (long)j : (long)(len - j);
+      data[i] = (void *)(v * 100003 + run);
+    }
+  }
+  test_sorted(data, tim_sort, n);
+}
+
+static int long_cmp(const void *a, const void *b) {
+  long la = *(const long *)a;
+  long lb = *(const long *)b;
+  return (la > lb) - (la < lb);
+}
+
+// Fills data with n values from a small range when `duplicates` is set, so that
+// many elements compare equal to the selected one.
+static void fill_random(void **data, long *sorted, unsigned n, bool duplicates) {
+  for (unsigned i = 0; i < n; ++i) {
+    long v = duplicates ? rand() % 16 : rand();
+    data[i] = (void *)v;
+    sorted[i] = v;
+  }
+  qsort(sorted, n, sizeof(long), long_cmp);
+}
+
+static void test_nth_element(unsigned n, bool duplicates) {
+  srand(n);
+  void **data = (void **)malloc(sizeof(void *) * n);
+  long *sorted = (long *)malloc(sizeof(long) * n);
+  unsigned ks[] = {0, n / 3, n / 2, n - 1};
+  for (unsigned k : ks) {
+    fill_random(data, sorted, n, duplicates);
+    nth_element(data, n, k);
+    ASSERT_EQ((long)data[k], sorted[k]);
+    for (unsigned i = 0; i < k; ++i) {
+      ASSERT_LE(data[i], data[k]);
+    }
+    for (unsigned i = k + 1; i < n; ++i) {
+      ASSERT_GE(data[i], data[k]);
+    }
+  }
+  free(sorted);
+  free(data);
+}
+
+static void test_partial_sort(unsigned n, unsigned k) {
+  srand(n + k);
+  void **data = (void **)malloc(sizeof(void *) * n);
+  long *sorted = (long *)malloc(sizeof(long) * n);
+  fill_random(data, sorted, n, false);
+  partial_sort(data, n, k);
+  for (unsigned i = 0; i < k; ++i) {
+    ASSERT_EQ((long)data[i], sorted[i]);
+  }
+  free(sorted);
+  free(data);
+}
+
+TEST(Sort, NthElement) {
+  test_nth_element(1, false);
+  test_nth_element(2, false);
+  test_nth_element(100, false);
+  test_nth_element(1000, false);
+  test_nth_element(100000, false);
+  test_nth_element(1000, true);
+  test_nth_element(100000, true);
+}
+
+TEST(Sort, NthElementSortedInput) {
+  const unsigned n = 100000;
+  void **data = (void **)malloc(sizeof(void *) * n);
+  for (long i = 0; i < n; ++i) {
+    data[i] = (void *)i;
+  }
+  nth_element(data, n, 12345);
+  ASSERT_EQ((long)data[12345], 12345);
+  for (long i = 0; i < n; ++i) {
+    data[i] = (void *)(n - i);
+  }
+  nth_elementc(data, n, 0, greater_than_cmp);
+  ASSERT_EQ((long)data[0], n);
+  free(data);
+}
+
+TEST(Sort, PartialSort) {
+  test_partial_sort(1, 1);
+  test_partial_sort(100, 0);
+  test_partial_sort(100, 10);
+  test_partial_sort(100, 100);
+  test_partial_sort(100000, 1);
+  test_partial_sort(100000, 100);
+  test_partial_sort(100000, 5000);
+}
+
+static void test_radix_sort(unsigned n, unsigned num_threads,
+                            uint64_t key_mask) {
+  std::vector<uint64_t> keys(n);
+  std::vector<unsigned> values(n);
+  for (unsigned i = 0; i < n; ++i) {
+    keys[i] = ((uint64_t)rand() << 40 ^ (uint64_t)rand() << 20 ^ rand()) &
+              key_mask;
+    values[i] = i;
+  }
+  std::vector<uint64_t> original = keys;
+  radix_sort_keys(keys.data(), values.data(), n, num_threads);
+  for (unsigned i = 0; i < n; ++i) {
+    ASSERT_EQ(keys[i], original[values[i]]);
+    if (i > 0) {
+      ASSERT_LE(keys[i - 1], keys[i]);
+      // Stable
+      if (keys[i - 1] == keys[i]) {
+        ASSERT_LT(values[i - 1], values[i]);
+      }
+    }
+  }
+}
+
+TEST(Sort, RadixSortKeys) {
+  srand(0);
+  for (unsigned threads : {1, 3, 8}) {
+    test_radix_sort(0, threads, ~0ULL);
+    test_radix_sort(1, threads, ~0ULL);
+    test_radix_sort(1000, threads, ~0ULL);
+    test_radix_sort(10000, threads, 0xFF);
+    test_radix_sort(10000, threads, 0xF0F000000000ULL);
+  }
+  std::vector<uint64_t> keys = {3, 1, 2};
+  radix_sort_keys(keys.data(), NULL, keys.size(), 2);
+  ASSERT_EQ(keys, std::vector<uint64_t>({1, 2, 3}));
+}
+
+TEST(Sort, DoubleSortKey) {
+  std::vector<double> values = {-INFINITY, -1e300, -2.5, -1e-300, -0.0,
+                                0.0,       1e-300, 1,    2.5,     INFINITY};
+  for (unsigned i = 1; i < values.size(); ++i) {
+    ASSERT_LT(double_sort_key(values[i - 1]), double_sort_key(values[i]));
+  }
+  ASSERT_LT(double_sort_key(INFINITY), double_sort_key(NAN));
+  ASSERT_EQ(double_sort_key(-NAN), double_sort_key(NAN));
+}
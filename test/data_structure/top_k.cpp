@@ -0,0 +1,78 @@
+extern "C" {
+#include "data_structure/top_k.h"
+}
+#include <gtest/gtest.h>
+
+static int long_cmp(const void *a, const void *b) {
+  long la = *(const long *)a;
+  long lb = *(const long *)b;
+  return (la > lb) - (la < lb);
+}
+
+static void top_k_test_random(unsigned n, unsigned k) {
+  srand(n * k);
+  TopK top;
+  top_k_init(&top, k);
+  long *all = (long *)malloc(sizeof(long) * n);
+  for (unsigned i = 0; i < n; ++i) {
+    all[i] = rand();
+    top_k_push(&top, (void *)all[i]);
+    ASSERT_EQ(top.size, i + 1 < k ? i + 1 : k);
+  }
+  qsort(all, n, sizeof(long), long_cmp);
+
+  unsigned kept = n < k ? n : k;
+  ASSERT_EQ(top_k_full(&top), n >= k);
+  Optional max = top_k_max(&top);
+  ASSERT_TRUE(max.present);
+  ASSERT_EQ((long)max.val, all[kept - 1]);
+
+  void **elements = top_k_elements(&top);
+  for (unsigned i = 0; i < kept; ++i) {
+    ASSERT_EQ((long)elements[i], all[i]);
+  }
+  free(elements);
+  free(all);
+  top_k_free(&top);
+}
+
+TEST(TopKTest, Empty) {
+  TopK top;
+  top_k_init(&top, 4);
+  ASSERT_FALSE(top_k_max(&top).present);
+  ASSERT_FALSE(top_k_elements(&top));
+  ASSERT_FALSE(top_k_full(&top));
+  top_k_free(&top);
+}
+
+TEST(TopKTest, RejectsLarger) {
+  TopK top;
+  top_k_init(&top, 2);
+  ASSERT_TRUE(top_k_push(&top, (void *)5));
+  ASSERT_TRUE(top_k_push(&top, (void *)3));
+  ASSERT_FALSE(top_k_push(&top, (void *)7));
+  ASSERT_FALSE(top_k_push(&top, (void *)5));
+  ASSERT_TRUE(top_k_push(&top, (void *)1));
+  ASSERT_EQ((long)top_k_max(&top).val, 3);
+  top_k_free(&top);
+}
+
+TEST(TopKTest, Comparator) {
+  TopK top;
+  top_k_initc(&top, 3, greater_than_cmp);
+  for (long i = 0; i < 100; ++i) {
+    top_k_push(&top, (void *)i);
+  }
+  void **elements = top_k_elements(&top);
+  ASSERT_EQ((long)elements[0], 99);
+  ASSERT_EQ((long)elements[1], 98);
+  ASSERT_EQ((long)elements[2], 97);
+  free(elements);
+  top_k_free(&top);
+}
+
+TEST(TopKTest, Length1) { top_k_test_random(1, 1); }
+TEST(TopKTest, LessThanK) { top_k_test_random(5, 10); }
+TEST(TopKTest, Length128) { top_k_test_random(128, 8); }
+TEST(TopKTest, LengthFoo) { top_k_test_random(0xF00, 100); }
+TEST(TopKTest, Large) { top_k_test_random(1000000, 100); }
@@ -0,0 +1,460 @@
+#include "geometry/util.h"
+#include "random.h"
+extern "C" {
+#include "geometry/algorithm/arrangement.h"
+#include "geometry/predicates.h"
+}
+#include <algorithm>
+#include <climits>
+#include <gtest/gtest.h>
+#include <numeric>
+#include <vector>
+
+static Point destination(const Arrangement &arr, unsigned h) {
+  return arr.vertices[arr.edges[arrangement_twin(h)].origin];
+}
+
+static std::vector<Point> cycle(const Arrangement &arr, unsigned start) {
+  std::vector<Point> points;
+  unsigned h = start;
+  do {
+    points.push_back(arr.vertices[arr.edges[h].origin]);
+    h = arr.edges[h].next;
+  } while (h != start);
+  return points;
+}
+
+static double signed_area(const std::vector<Point> &ring) {
+  double area = 0;
+  for (unsigned i = 0; i < ring.size(); ++i) {
+    Point a = ring[i];
+    Point b = ring[(i + 1) % ring.size()];
+    area += a.x * b.y - b.x * a.y;
+  }
+  return area / 2;
+}
+
+// Whether p is strictly inside the ring, by the even-odd rule.
+static bool inside(const std::vector<Point> &ring, Point p) {
+  bool in = false;
+  for (unsigned i = 0; i < ring.size(); ++i) {
+    Point a = ring[i];
+    Point b = ring[(i + 1) % ring.size()];
+    if ((a.y > p.y) != (b.y > p.y) &&
+        p.x < a.x + (p.y - a.y) * (b.x - a.x) / (b.y - a.y)) {
+      in = !in;
+    }
+  }
+  return in;
+}
+
+static unsigned find(std::vector<unsigned> &parent, unsigned v) {
+  while (parent[v] != v) {
+    v = parent[v] = parent[parent[v]];
+  }
+  return v;
+}
+
+// Whether half-edges h and g leave the same vertex in the same direction.
+static bool overlap(const Arrangement &arr, unsigned h, unsigned g) {
+  if (arr.edges[h].origin != arr.edges[g].origin) {
+    return false;
+  }
+  Point p = arr.vertices[arr.edges[h].origin];
+  Point a = destination(arr, h);
+  Point b = destination(arr, g);
+  return orient2d(p, a, b) == 0 &&
+         (a.x - p.x) * (b.x - p.x) + (a.y - p.y) * (b.y - p.y) > 0;
+}
+
+// Checks that edges only meet at shared vertices: edges that share a vertex do
+// not overlap, and other edges do not intersect at all.
+static void check_planar(const Arrangement &arr) {
+  for (unsigned h = 0; h < arr.num_edges; h += 2) {
+    Segment a = {arr.vertices[arr.edges[h].origin], destination(arr, h)};
+    for (unsigned g = h + 2; g < arr.num_edges; g += 2) {
+      Segment b = {arr.vertices[arr.edges[g].origin], destination(arr, g)};
+      bool shared = false;
+      for (unsigned i : {h, h + 1}) {
+        for (unsigned j : {g, g + 1}) {
+          shared |= arr.edges[i].origin == arr.edges[j].origin;
+          ASSERT_FALSE(overlap(arr, i, j))
+              << "edges " << h << " and " << g << " overlap";
+        }
+      }
+      ASSERT_TRUE(shared || !segment_intersects(a, b))
+          << "edges " << h << " and " << g << " intersect";
+    }
+  }
+}
+
+// Checks the structure, planarity, Euler's formula, that bounded faces wind
+// counterclockwise and holes do not, that no two vertices are close enough to
+// merge, and that each hole is inside the outer boundary of its face.
+static void check_arrangement(const Arrangement &arr) {
+  arrangement_validate(&arr);
+  check_planar(arr);
+  std::vector<unsigned> parent(arr.num_vertices);
+  std::iota(parent.begin(), parent.end(), 0);
+  for (unsigned h = 0; h < arr.num_edges; h += 2) {
+    parent[find(parent, arr.edges[h].origin)] =
+        find(parent, arr.edges[h + 1].origin);
+  }
+  unsigned components = 0;
+  for (unsigned v = 0; v < arr.num_vertices; ++v) {
+    components += find(parent, v) == v;
+  }
+  ASSERT_EQ((long)arr.num_vertices - arr.num_edges / 2 + arr.num_faces,
+            1 + components);
+  ASSERT_EQ(arr.hole_starts[arr.num_faces], components);
+
+  double magnitude = 0;
+  for (unsigned v = 0; v < arr.num_vertices; ++v) {
+    magnitude = std::max({magnitude, fabs(arr.vertices[v].x),
+                          fabs(arr.vertices[v].y)});
+  }
+  for (unsigned v = 0; v < arr.num_vertices; ++v) {
+    for (unsigned w = v + 1; w < arr.num_vertices; ++w) {
+      Point a = arr.vertices[v];
+      Point b = arr.vertices[w];
+      ASSERT_FALSE(fabs(a.x - b.x) < magnitude * 0x1p-40 &&
+                   fabs(a.y - b.y) < magnitude * 0x1p-40);
+    }
+  }
+  double total = 0;
+  for (unsigned f = 0; f < arr.num_faces; ++f) {
+    std::vector<Point> outer;
+    if (f > 0) {
+      outer = cycle(arr, arr.face_edges[f]);
+      double area = signed_area(outer);
+      ASSERT_GT(area, 0);
+      total += area;
+    }
+    for (unsigned i = arr.hole_starts[f]; i < arr.hole_starts[f + 1]; ++i) {
+      std::vector<Point> hole = cycle(arr, arr.holes[i]);
+      double area = signed_area(hole);
+      ASSERT_LE(area, 1e-9);
+      total += area;
+      if (f > 0) {
+        // A hole vertex that is not on the outer boundary is inside it
+        for (Point p : hole) {
+          bool on_outer = false;
+          for (Point q : outer) {
+            on_outer |= p.x == q.x && p.y == q.y;
+          }
+          if (!on_outer) {
+            ASSERT_TRUE(inside(outer, p));
+          }
+        }
+      }
+    }
+  }
+  ASSERT_NEAR(total, 0, 1e-6);
+}
+
+static void build(const std::vector<Segment> &segments, Arrangement *arr,
+                  unsigned threads = 1) {
+  arrangement_build(segments.data(), segments.size(), threads, arr);
+  check_arrangement(*arr);
+}
+
+TEST(Arrangement, Empty) {
+  Arrangement arr;
+  build({}, &arr);
+  ASSERT_EQ(arr.num_vertices, 0);
+  ASSERT_EQ(arr.num_edges, 0);
+  ASSERT_EQ(arr.num_faces, 1);
+  ASSERT_EQ(arrangement_face_size(&arr, 0), 0);
+  arrangement_free(&arr);
+
+  // A single point adds nothing
+  build({segment_from_coords(1, 1, 1, 1)}, &arr);
+  ASSERT_EQ(arr.num_vertices, 0);
+  arrangement_free(&arr);
+}
+
+TEST(Arrangement, Square) {
+  Arrangement arr;
+  build({segment_from_coords(0, 0, 4, 0), segment_from_coords(4, 0, 4, 4),
+         segment_from_coords(0, 4, 4, 4), segment_from_coords(0, 0, 0, 4)},
+        &arr);
+  ASSERT_EQ(arr.num_vertices, 4);
+  ASSERT_EQ(arr.num_edges, 8);
+  ASSERT_EQ(arr.num_faces, 2);
+  ASSERT_EQ(arrangement_face_size(&arr, 1), 4);
+  ASSERT_DOUBLE_EQ(signed_area(cycle(arr, arr.face_edges[1])), 16);
+  // The square is a hole of the unbounded face
+  ASSERT_EQ(arr.hole_starts[1], 1);
+  ASSERT_DOUBLE_EQ(signed_area(cycle(arr, arr.holes[0])), -16);
+  for (unsigned h = 0; h < arr.num_edges; ++h) {
+    Point a = arr.vertices[arr.edges[h].origin];
+    Point b = destination(arr, h);
+    ASSERT_EQ(arr.edges[h].face, (b.x - a.x) * (2 - a.y) - (b.y - a.y) *
+                                             (2 - a.x) > 0
+                                     ? 1u
+                                     : 0u);
+  }
+  arrangement_free(&arr);
+}
+
+TEST(Arrangement, Crossings) {
+  // Two crossing segments, and a segment ending on another
+  Arrangement arr;
+  build({segment_from_coords(0, 0, 2, 2), segment_from_coords(0, 2, 2, 0)},
+        &arr);
+  ASSERT_EQ(arr.num_vertices, 5);
+  ASSERT_EQ(arr.num_edges, 8);
+  ASSERT_EQ(arr.num_faces, 1);
+  arrangement_free(&arr);
+  build({segment_from_coords(0, 0, 4, 0), segment_from_coords(2, 0, 2, 3)},
+        &arr);
+  ASSERT_EQ(arr.num_vertices, 4);
+  ASSERT_EQ(arr.num_edges, 6);
+  arrangement_free(&arr);
+
+  // A triangle with a diagonal through a vertex
+  build({segment_from_coords(0, 0, 4, 0), segment_from_coords(4, 0, 0, 4),
+         segment_from_coords(0, 4, 0, 0), segment_from_coords(-1, -1, 3, 3)},
+        &arr);
+  ASSERT_EQ(arr.num_vertices, 6);
+  ASSERT_EQ(arr.num_faces, 3);
+  arrangement_free(&arr);
+}
+
+TEST(Arrangement, Grid) {
+  for (unsigned threads : {1, 3}) {
+    std::vector<Segment> segments;
+    for (unsigned i = 0; i < 10; ++i) {
+      segments.push_back(segment_from_coords(0, i, 9, i));
+      segments.push_back(segment_from_coords(i, 0, i, 9));
+    }
+    Arrangement arr;
+    build(segments, &arr, threads);
+    ASSERT_EQ(arr.num_vertices, 100);
+    ASSERT_EQ(arr.num_edges, 2 * 2 * 10 * 9);
+    ASSERT_EQ(arr.num_faces, 82);
+    for (unsigned f = 1; f < arr.num_faces; ++f) {
+      ASSERT_EQ(arrangement_face_size(&arr, f), 4);
+      ASSERT_DOUBLE_EQ(signed_area(cycle(arr, arr.face_edges[f])), 1);
+    }
+    arrangement_free(&arr);
+  }
+}
+
+TEST(Arrangement, Overlaps) {
+  // Collinear overlaps and duplicates are kept once
+  Arrangement arr;
+  build({segment_from_coords(0, 0, 10, 0), segment_from_coords(5, 0, 15, 0),
+         segment_from_coords(15, 0, 5, 0), segment_from_coords(2, 0, 3, 0)},
+        &arr);
+  ASSERT_EQ(arr.num_vertices, 6);
+  ASSERT_EQ(arr.num_edges, 10);
+  for (unsigned h = 0; h < arr.num_edges; ++h) {
+    Point a = arr.vertices[arr.edges[h].origin];
+    unsigned s = arr.edges[h].segment;
+    // Pieces of [0, 10] come from the first segment
+    ASSERT_EQ(s, a.x < 10 || destination(arr, h).x < 10 ? 0u : 1u);
+  }
+  arrangement_free(&arr);
+
+  // Points within 2^-40 of the largest coordinate merge
+  build({segment_from_coords(0, 0, 1, 0), segment_from_coords(1, 1e-13, 1, 1),
+         segment_from_coords(1 - 1e-13, 1, 1e-13, -1e-13)},
+        &arr);
+  ASSERT_EQ(arr.num_vertices, 3);
+  ASSERT_EQ(arr.num_faces, 2);
+  arrangement_free(&arr);
+}
+
+TEST(Arrangement, Holes) {
+  // Nested squares, and one beside them
+  auto square = [](std::vector<Segment> &segments, double x, double y,
+                   double side) {
+    segments.push_back(segment_from_coords(x, y, x + side, y));
+    segments.push_back(segment_from_coords(x + side, y, x + side, y + side));
+    segments.push_back(segment_from_coords(x + side, y + side, x, y + side));
+    segments.push_back(segment_from_coords(x, y + side, x, y));
+  };
+  std::vector<Segment> segments;
+  square(segments, 0, 0, 10);
+  square(segments, 2, 2, 6);
+  square(segments, 4, 4, 2);
+  square(segments, 20, 0, 5);
+  // A lone segment in the middle square's ring
+  segments.push_back(segment_from_coords(2.5, 5, 3.5, 5));
+  Arrangement arr;
+  build(segments, &arr);
+  ASSERT_EQ(arr.num_faces, 5);
+  ASSERT_EQ(arr.hole_starts[arr.num_faces], 5);
+  // The unbounded face has the two outer squares as holes, and every other
+  // square but the smallest has one
+  ASSERT_EQ(arr.hole_starts[1] - arr.hole_starts[0], 2);
+  unsigned with_two = 0;
+  for (unsigned f = 1; f < arr.num_faces; ++f) {
+    double area = signed_area(cycle(arr, arr.face_edges[f]));
+    unsigned holes = arr.hole_starts[f + 1] - arr.hole_starts[f];
+    ASSERT_EQ(holes, area == 100 ? 1u : area == 36 ? 2u : 0u);
+    with_two += holes == 2;
+  }
+  ASSERT_EQ(with_two, 1);
+  arrangement_free(&arr);
+}
+
+// The face whose outer boundary is the smallest one around p, which is the
+// face p is in, or the unbounded face if there is none.
+static unsigned brute_force_locate(const Arrangement &arr, Point p) {
+  unsigned best = 0;
+  double best_area = INFINITY;
+  for (unsigned f = 1; f < arr.num_faces; ++f) {
+    std::vector<Point> outer = cycle(arr, arr.face_edges[f]);
+    double area = signed_area(outer);
+    if (area < best_area && inside(outer, p)) {
+      best = f;
+      best_area = area;
+    }
+  }
+  return best;
+}
+
+TEST(Arrangement, Locate) {
+  srand(2);
+  for (unsigned k = 0; k < 4; ++k) {
+    // Nested squares and random segments crossing them
+    std::vector<Segment> segments;
+    for (unsigned i = 0; i < 4; ++i) {
+      double lo = -80 + 20.0 * i, hi = 80 - 20.0 * i;
+      segments.push_back(segment_from_coords(lo, lo, hi, lo));
+      segments.push_back(segment_from_coords(hi, lo, hi, hi));
+      segments.push_back(segment_from_coords(hi, hi, lo, hi));
+      segments.push_back(segment_from_coords(lo, hi, lo, lo));
+    }
+    for (unsigned i = 0; i < 10 * k; ++i) {
+      Point p = {random_coord(), random_coord()};
+      segments.push_back(segment_from_coords(p.x, p.y,
+                                             p.x + random_coord() / 2,
+                                             p.y + random_coord() / 2));
+    }
+    Arrangement arr;
+    build(segments, &arr);
+    TrapezoidalMap map;
+    arrangement_trapezoidal_map(&arr, &map);
+    std::vector<Point> queries;
+    for (unsigned i = 0; i < 500; ++i) {
+      queries.push_back({random_coord(), random_coord()});
+    }
+    std::vector<unsigned> faces(queries.size());
+    arrangement_locate_many(&arr, &map, queries.data(), queries.size(),
+                            faces.data(), 2);
+    for (unsigned i = 0; i < queries.size(); ++i) {
+      ASSERT_EQ(arrangement_locate(&arr, &map, queries[i]), faces[i]);
+      ASSERT_EQ(faces[i], brute_force_locate(arr, queries[i]));
+    }
+    trapezoidal_map_free(&map);
+    arrangement_free(&arr);
+  }
+}
+
+TEST(Arrangement, Random) {
+  srand(0);
+  for (unsigned n : {5, 30, 150}) {
+    std::vector<Segment> segments;
+    for (unsigned i = 0; i < n; ++i) {
+      Point p = {random_coord(), random_coord()};
+      segments.push_back(segment_from_coords(p.x, p.y,
+                                             p.x + random_coord() / 4,
+                                             p.y + random_coord() / 4));
+    }
+    for (unsigned threads : {1, 4}) {
+      Arrangement arr;
+      build(segments, &arr, threads);
+      arrangement_free(&arr);
+    }
+  }
+
+  // Integer grids give many shared endpoints and collinear overlaps
+  for (unsigned k = 0; k < 5; ++k) {
+    std::vector<Segment> segments;
+    for (unsigned i = 0; i < 60; ++i) {
+      double x = rand() % 10, y = rand() % 10;
+      switch (rand() % 3) {
+      case 0:
+        segments.push_back(segment_from_coords(x, y, x + rand() % 4, y));
+        break;
+      case 1:
+        segments.push_back(segment_from_coords(x, y, x, y + rand() % 4));
+        break;
+      default:
+        segments.push_back(segment_from_coords(x, y, x + 2, y + 2));
+      }
+    }
+    Arrangement arr;
+    build(segments, &arr);
+    arrangement_free(&arr);
+  }
+}
+
+// Crossings of segments on the 0.1 grid, which is not representable, so
+// crossings that should coincide are only nearly concurrent.
+TEST(Arrangement, RandomDecimalGrid) {
+  srand(0);
+  for (unsigned trial = 0; trial < 300; ++trial) {
+    std::vector<Segment> segments;
+    for (unsigned i = 0; i < 12; ++i) {
+      segments.push_back(
+          segment_from_coords(random_decimal_coord(), random_decimal_coord(),
+                              random_decimal_coord(), random_decimal_coord()));
+    }
+    for (unsigned threads : {1, 3}) {
+      Arrangement arr;
+      build(segments, &arr, threads);
+      arrangement_free(&arr);
+    }
+  }
+}
+
+// Scaling by a power of two scales every computed point exactly, so soups far
+// smaller and larger than unit size give the same arrangement, scaled.
+TEST(Arrangement, Scaled) {
+  srand(2);
+  std::vector<std::vector<Segment>> soups(2);
+  for (unsigned i = 0; i < 100; ++i) {
+    Point p = {random_coord(), random_coord()};
+    soups[0].push_back(segment_from_coords(
+        p.x, p.y, p.x + random_coord() / 4, p.y + random_coord() / 4));
+  }
+  // Concurrent crossings at points that are not representable
+  for (unsigned i = 0; i < 40; ++i) {
+    soups[1].push_back(segment_from_coords(rand() % 7, rand() % 7,
+                                           rand() % 7, rand() % 7));
+  }
+  for (const std::vector<Segment> &segments : soups) {
+    for (unsigned threads : {1, 4}) {
+      Arrangement expected;
+      build(segments, &expected, threads);
+      for (double scale : {0x1p-40, 0x1p-20, 0x1p60}) {
+        std::vector<Segment> scaled;
+        for (Segment s : segments) {
+          scaled.push_back(segment_from_coords(s.p0.x * scale, s.p0.y * scale,
+                                               s.p1.x * scale, s.p1.y * scale));
+        }
+        Arrangement arr;
+        arrangement_build(scaled.data(), scaled.size(), threads, &arr);
+        arrangement_validate(&arr);
+        ASSERT_EQ(arr.num_vertices, expected.num_vertices);
+        ASSERT_EQ(arr.num_edges, expected.num_edges);
+        ASSERT_EQ(arr.num_faces, expected.num_faces);
+        for (unsigned v = 0; v < arr.num_vertices; ++v) {
+          ASSERT_EQ(arr.vertices[v].x, expected.vertices[v].x * scale);
+          ASSERT_EQ(arr.vertices[v].y, expected.vertices[v].y * scale);
+        }
+        for (unsigned h = 0; h < arr.num_edges; ++h) {
+          ASSERT_EQ(arr.edges[h].origin, expected.edges[h].origin);
+          ASSERT_EQ(arr.edges[h].next, expected.edges[h].next);
+          ASSERT_EQ(arr.edges[h].face, expected.edges[h].face);
+        }
+        arrangement_free(&arr);
+      }
+      arrangement_free(&expected);
+    }
+  }
+}
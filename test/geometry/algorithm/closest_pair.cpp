@@ -0,0 +1,111 @@
+#include "geometry/util.h"
+#include "random.h"
+extern "C" {
+#include "geometry/algorithm/closest_pair.h"
+}
+#include <climits>
+#include <gtest/gtest.h>
+#include <vector>
+
+static double squared_distance(Point a, Point b) {
+  return (a.x - b.x) * (a.x - b.x) + (a.y - b.y) * (a.y - b.y);
+}
+
+static void test_closest_pair(const std::vector<Point> &points) {
+  unsigned expected_a, expected_b;
+  ASSERT_TRUE(closest_pair_brute_force(points.data(), points.size(),
+                                       &expected_a, &expected_b));
+  double expected = squared_distance(points[expected_a], points[expected_b]);
+  for (unsigned threads : {1, 2, 5}) {
+    unsigned a, b;
+    ASSERT_TRUE(
+        closest_pair_parallel(points.data(), points.size(), threads, &a, &b));
+    ASSERT_LT(a, b);
+    ASSERT_EQ(squared_distance(points[a], points[b]), expected);
+  }
+}
+
+static void test_all_nearest(const std::vector<Point> &points) {
+  for (unsigned threads : {1, 3}) {
+    std::vector<unsigned> nearest(points.size());
+    all_nearest_neighbors_parallel(points.data(), points.size(), threads,
+                                   nearest.data());
+    for (unsigned i = 0; i < points.size(); ++i) {
+      double expected = INFINITY;
+      for (unsigned j = 0; j < points.size(); ++j) {
+        if (j != i) {
+          expected = std::min(expected, squared_distance(points[i], points[j]));
+        }
+      }
+      ASSERT_NE(nearest[i], i);
+      ASSERT_EQ(squared_distance(points[i], points[nearest[i]]), expected);
+    }
+  }
+}
+
+TEST(ClosestPair, Small) {
+  unsigned a, b;
+  ASSERT_FALSE(closest_pair(NULL, 0, &a, &b));
+  Point one[] = {{1, 1}};
+  ASSERT_FALSE(closest_pair(one, 1, &a, &b));
+
+  Point points[] = {{0, 0}, {5, 5}, {1, 0.5}, {10, 0}, {5.2, 5.1}};
+  ASSERT_TRUE(closest_pair(points, 5, &a, &b));
+  ASSERT_EQ(a, 1);
+  ASSERT_EQ(b, 4);
+}
+
+TEST(ClosestPair, Random) {
+  srand(0);
+  std::vector<Point> points;
+  for (unsigned i = 0; i < 20000; ++i) {
+    points.push_back({random_coord(), random_coord()});
+  }
+  test_closest_pair(points);
+}
+
+TEST(ClosestPair, Degenerate) {
+  // All on one vertical line, so every split is on the same x
+  std::vector<Point> line;
+  for (unsigned i = 0; i < 5000; ++i) {
+    line.push_back({1, (double)((i * 7919) % 5000) * 1.5});
+  }
+  line.push_back({1, 100.25});
+  test_closest_pair(line);
+
+  // Duplicates are at distance 0
+  srand(1);
+  std::vector<Point> grid;
+  for (unsigned i = 0; i < 5000; ++i) {
+    grid.push_back({(double)(rand() % 100), (double)(rand() % 100)});
+  }
+  test_closest_pair(grid);
+}
+
+TEST(AllNearestNeighbors, Small) {
+  unsigned nearest[3];
+  Point one[] = {{1, 1}};
+  all_nearest_neighbors(one, 1, nearest);
+  ASSERT_EQ(nearest[0], UINT_MAX);
+
+  Point points[] = {{0, 0}, {3, 0}, {1, 0}};
+  all_nearest_neighbors(points, 3, nearest);
+  ASSERT_EQ(nearest[0], 2);
+  ASSERT_EQ(nearest[1], 2);
+  ASSERT_EQ(nearest[2], 0);
+}
+
+TEST(AllNearestNeighbors, Random) {
+  srand(2);
+  std::vector<Point> points;
+  for (unsigned i = 0; i < 1500; ++i) {
+    points.push_back({random_coord(), random_coord()});
+  }
+  test_all_nearest(points);
+
+  std::vector<Point> grid;
+  for (unsigned i = 0; i < 1500; ++i) {
+    grid.push_back({(double)(rand() % 20), (double)(rand() % 20)});
+  }
+  test_all_nearest(grid);
+}
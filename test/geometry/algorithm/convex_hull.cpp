@@ -0,0 +1,141 @@
+#include "geometry/util.h"
+#include "random.h"
+extern "C" {
+#include "geometry/algorithm/convex_hull.h"
+#include "geometry/predicates.h"
+}
+#include <gtest/gtest.h>
+#include <vector>
+
+typedef Point *(*hull_t)(const Point *, unsigned, unsigned *);
+
+static Point *parallel_hull(const Point *points, unsigned n, unsigned *count) {
+  return convex_hull_parallel(points, n, 3, count);
+}
+
+static Point *scratch_hull(const Point *points, unsigned n, unsigned *count) {
+  std::vector<Point> scratch(convex_hull_scratch_size(n));
+  Point *hull = convex_hull_in_scratch(points, n, scratch.data(), count);
+  Point *copy = (Point *)malloc(sizeof(Point) * (*count + 1));
+  std::copy(hull, hull + *count, copy);
+  return copy;
+}
+
+static const hull_t HULLS[] = {convex_hull, convex_hull_monotone_chain,
+                               convex_hull_quickhull, parallel_hull,
+                               scratch_hull};
+
+static void test_hull(const std::vector<Point> &points,
+                      const std::vector<Point> &expected) {
+  for (hull_t hull_fn : HULLS) {
+    unsigned count;
+    Point *hull = hull_fn(points.data(), points.size(), &count);
+    ASSERT_EQ(count, expected.size());
+    for (unsigned i = 0; i < count; ++i) {
+      ASSERT_EQ(hull[i].x, expected[i].x);
+      ASSERT_EQ(hull[i].y, expected[i].y);
+    }
+    free(hull);
+  }
+}
+
+// Checks that every variant agrees with monotone chain, and that the hull is
+// strictly convex and contains every point.
+static void test_against_monotone_chain(const std::vector<Point> &points) {
+  unsigned count;
+  Point *hull = convex_hull_monotone_chain(points.data(), points.size(), &count);
+  for (unsigned i = 0; count >= 3 && i < count; ++i) {
+    Point a = hull[i];
+    Point b = hull[(i + 1) % count];
+    Point c = hull[(i + 2) % count];
+    ASSERT_GT(orient2d(a, b, c), 0);
+    for (Point p : points) {
+      ASSERT_GE(orient2d(a, b, p), 0);
+    }
+  }
+  test_hull(points, std::vector<Point>(hull, hull + count));
+  free(hull);
+}
+
+TEST(ConvexHull, Empty) { test_hull({}, {}); }
+
+TEST(ConvexHull, Degenerate) {
+  test_hull({{1, 2}}, {{1, 2}});
+  test_hull({{1, 2}, {1, 2}, {1, 2}}, {{1, 2}});
+  test_hull({{3, 3}, {0, 0}, {1, 1}, {2, 2}, {1, 1}}, {{0, 0}, {3, 3}});
+  test_hull({{0, 2}, {0, 0}, {0, 1}}, {{0, 0}, {0, 2}});
+}
+
+TEST(ConvexHull, Square) {
+  // Interior points, points on edges and duplicated corners
+  test_hull({{1, 1},
+             {0, 0},
+             {2, 2},
+             {0, 2},
+             {2, 0},
+             {1, 0},
+             {2, 1},
+             {0, 0},
+             {0.5, 1.5},
+             {1, 2}},
+            {{0, 0}, {2, 0}, {2, 2}, {0, 2}});
+}
+
+TEST(ConvexHull, Filter) {
+  std::vector<Point> points = {{0, 0}, {4, 0}, {4, 4}, {0, 4},
+                               {2, 2}, {1, 3}, {4, 2}, {2, 0}};
+  std::vector<Point> out(points.size());
+  unsigned m = convex_hull_filter(points.data(), points.size(), out.data());
+  // The interior points are dropped, the edge points are kept
+  ASSERT_EQ(m, 6);
+  for (unsigned i = 0; i < m; ++i) {
+    ASSERT_FALSE(out[i].x == 2 && out[i].y == 2);
+    ASSERT_FALSE(out[i].x == 1 && out[i].y == 3);
+  }
+}
+
+TEST(ConvexHull, Random) {
+  srand(0);
+  for (unsigned trial = 0; trial < 50; ++trial) {
+    std::vector<Point> points;
+    unsigned n = rand() % 500;
+    for (unsigned i = 0; i < n; ++i) {
+      points.push_back({random_coord(), random_coord()});
+    }
+    test_against_monotone_chain(points);
+  }
+}
+
+TEST(ConvexHull, Circle) {
+  std::vector<Point> points;
+  for (unsigned i = 0; i < 1000; ++i) {
+    double angle = 2 * M_PI * i / 1000;
+    points.push_back({100 * cos(angle), 100 * sin(angle)});
+  }
+  test_against_monotone_chain(points);
+}
+
+TEST(ConvexHull, RandomGrid) {
+  // Many duplicate and collinear points
+  srand(0);
+  for (unsigned trial = 0; trial < 200; ++trial) {
+    std::vector<Point> points;
+    unsigned n = rand() % 50;
+    for (unsigned i = 0; i < n; ++i) {
+      points.push_back({(double)(rand() % 5), (double)(rand() % 5)});
+    }
+    test_against_monotone_chain(points);
+  }
+}
+
+TEST(ConvexHull, NearlyCollinear) {
+  // A grid a few ulps wide on the line y = x, between two points far out on
+  // it, where floating point orientations have the wrong sign
+  std::vector<Point> points = {{12, 12}, {24, 24}};
+  for (unsigned i = 0; i < 16; ++i) {
+    for (unsigned j = 0; j < 16; ++j) {
+      points.push_back({0.5 + i * 0x1p-53, 0.5 + j * 0x1p-53});
+    }
+  }
+  test_against_monotone_chain(points);
+}
@@ -0,0 +1,169 @@
+#include "geometry/util.h"
+#include "random.h"
+extern "C" {
+#include "geometry/algorithm/convex_hull.h"
+#include "geometry/algorithm/delaunay.h"
+#include "geometry/predicates.h"
+}
+#include <climits>
+#include <gtest/gtest.h>
+#include <set>
+#include <vector>
+
+static double hull_area(const std::vector<Point> &points) {
+  unsigned count;
+  Point *hull = convex_hull(points.data(), points.size(), &count);
+  double area = 0;
+  for (unsigned i = 0; i < count; ++i) {
+    Point a = hull[i];
+    Point b = hull[(i + 1) % count];
+    area += a.x * b.y - b.x * a.y;
+  }
+  free(hull);
+  return area / 2;
+}
+
+// Checks the structure, that no point is strictly inside the circumcircle of a
+// triangle, that the triangles cover the convex hull, and that every distinct
+// point is a vertex.
+static void check_delaunay(const std::vector<Point> &points,
+                           const Triangulation &tri) {
+  triangulation_validate(&tri, points.data(), points.size());
+  double area = 0;
+  std::set<std::pair<double, double>> used;
+  for (unsigned t = 0; t < tri.num_triangles; ++t) {
+    const unsigned *v = tri.triangles[t].vertices;
+    Point a = points[v[0]], b = points[v[1]], c = points[v[2]];
+    area += orient2d(a, b, c) / 2;
+    for (unsigned i = 0; i < 3; ++i) {
+      used.insert({points[v[i]].x, points[v[i]].y});
+    }
+    for (const Point &p : points) {
+      ASSERT_LE(incircle(a, b, c, p), 0);
+    }
+  }
+  std::set<std::pair<double, double>> distinct;
+  for (const Point &p : points) {
+    distinct.insert({p.x, p.y});
+  }
+  ASSERT_EQ(used, distinct);
+  ASSERT_NEAR(area, hull_area(points), 1e-9 * (1 + area));
+}
+
+static void test_delaunay(const std::vector<Point> &points) {
+  for (unsigned threads : {1, 3}) {
+    Triangulation tri;
+    delaunay_triangulate_parallel(points.data(), points.size(), threads, &tri);
+    check_delaunay(points, tri);
+    triangulation_free(&tri);
+  }
+}
+
+TEST(Delaunay, Degenerate) {
+  Triangulation tri;
+  delaunay_triangulate(nullptr, 0, &tri);
+  ASSERT_EQ(tri.num_triangles, 0);
+  std::vector<Point> points = {{0, 0}, {1, 1}};
+  delaunay_triangulate(points.data(), points.size(), &tri);
+  ASSERT_EQ(tri.num_triangles, 0);
+
+  // Collinear and duplicate points
+  points = {{0, 0}, {1, 1}, {3, 3}, {1, 1}, {-2, -2}, {0, 0}};
+  delaunay_triangulate(points.data(), points.size(), &tri);
+  ASSERT_EQ(tri.num_triangles, 0);
+  points = {{2, 2}, {2, 2}, {2, 2}};
+  delaunay_triangulate(points.data(), points.size(), &tri);
+  ASSERT_EQ(tri.num_triangles, 0);
+
+  // One point off the line
+  points.push_back({0, 5});
+  points.push_back({5, 0});
+  points.push_back({2, 2});
+  delaunay_triangulate(points.data(), points.size(), &tri);
+  ASSERT_EQ(tri.num_triangles, 1);
+  triangulation_free(&tri);
+  points = {{0, 0}, {1, 0}, {2, 0}, {3, 0}, {4, 0}, {2, 1}};
+  delaunay_triangulate(points.data(), points.size(), &tri);
+  ASSERT_EQ(tri.num_triangles, 4);
+  check_delaunay(points, tri);
+  triangulation_free(&tri);
+}
+
+TEST(Delaunay, Square) {
+  // Cocircular, so either diagonal is valid
+  std::vector<Point> points = {{0, 0}, {1, 0}, {1, 1}, {0, 1}};
+  Triangulation tri;
+  delaunay_triangulate(points.data(), points.size(), &tri);
+  ASSERT_EQ(tri.num_triangles, 2);
+  check_delaunay(points, tri);
+  unsigned shared = 0;
+  for (unsigned t = 0; t < 2; ++t) {
+    for (unsigned i = 0; i < 3; ++i) {
+      shared += tri.triangles[t].neighbors[i] != UINT_MAX;
+    }
+  }
+  ASSERT_EQ(shared, 2);
+  triangulation_free(&tri);
+}
+
+TEST(Delaunay, Random) {
+  srand(0);
+  for (unsigned n : {3, 4, 10, 100, 500}) {
+    std::vector<Point> points;
+    for (unsigned i = 0; i < n; ++i) {
+      points.push_back({random_coord(), random_coord()});
+    }
+    test_delaunay(points);
+  }
+}
+
+TEST(Delaunay, Grid) {
+  // Many cocircular, collinear and duplicate points
+  srand(1);
+  std::vector<Point> points;
+  for (unsigned i = 0; i < 400; ++i) {
+    points.push_back({(double)(rand() % 20), (double)(rand() % 20)});
+  }
+  test_delaunay(points);
+
+  points.clear();
+  for (unsigned x = 0; x < 20; ++x) {
+    for (unsigned y = 0; y < 20; ++y) {
+      points.push_back({(double)x, (double)y});
+    }
+  }
+  Triangulation tri;
+  delaunay_triangulate(points.data(), points.size(), &tri);
+  ASSERT_EQ(tri.num_triangles, 2 * 19 * 19);
+  check_delaunay(points, tri);
+  triangulation_free(&tri);
+}
+
+TEST(Delaunay, Circle) {
+  // Every point is on the hull, and nearly cocircular with every other
+  std::vector<Point> points;
+  for (unsigned i = 0; i < 64; ++i) {
+    double angle = 2 * M_PI * i / 64;
+    points.push_back(
+        {std::round(cos(angle) * 1e6), std::round(sin(angle) * 1e6)});
+  }
+  for (unsigned i = 0; i < 64; i += 16) {
+    points.push_back({points[i].x / 2, points[i].y / 2});
+  }
+  test_delaunay(points);
+}
+
+TEST(Delaunay, Large) {
+  srand(2);
+  std::vector<Point> points;
+  for (unsigned i = 0; i < 100000; ++i) {
+    points.push_back({random_coord(), random_coord()});
+  }
+  unsigned hull_count;
+  free(convex_hull(points.data(), points.size(), &hull_count));
+  Triangulation tri;
+  delaunay_triangulate(points.data(), points.size(), &tri);
+  triangulation_validate(&tri, points.data(), points.size());
+  ASSERT_EQ(tri.num_triangles, 2 * points.size() - hull_count - 2);
+  triangulation_free(&tri);
+}
@@ -0,0 +1,398 @@
+#include "geometry/util.h"
+#include "random.h"
+extern "C" {
+#include "geometry/algorithm/polygon_boolean.h"
+}
+#include <cmath>
+#include <gtest/gtest.h>
+#include <vector>
+
+static const PolygonOperation OPERATIONS[] = {
+    POLYGON_INTERSECTION, POLYGON_UNION, POLYGON_DIFFERENCE, POLYGON_XOR};
+
+static Polygon rectangle(double x0, double y0, double x1, double y1) {
+  Point points[] = {{x0, y0}, {x1, y0}, {x1, y1}, {x0, y1}};
+  Polygon poly;
+  polygon_init(&poly, points, 4);
+  return poly;
+}
+
+static void add_rectangle_hole(Polygon *poly, double x0, double y0, double x1,
+                               double y1) {
+  Point points[] = {{x0, y0}, {x1, y0}, {x1, y1}, {x0, y1}};
+  polygon_add_hole(poly, points, 4);
+}
+
+static bool apply(PolygonOperation op, bool a, bool b) {
+  switch (op) {
+  case POLYGON_INTERSECTION:
+    return a && b;
+  case POLYGON_UNION:
+    return a || b;
+  case POLYGON_DIFFERENCE:
+    return a && !b;
+  case POLYGON_XOR:
+    return a != b;
+  }
+  return false;
+}
+
+// Checks that outer rings wind counterclockwise, holes clockwise and inside
+// their outer ring, and that random points are located in the result as the
+// operation says.
+static void check_result(const Polygon &a, const Polygon &b,
+                         PolygonOperation op, const PolygonSet &set) {
+  polygon_set_validate(&set);
+  for (unsigned i = 0; i < set.num_polygons; ++i) {
+    Polygon poly;
+    polygon_set_get(&set, i, &poly);
+    ASSERT_GT(polygon_ring_signed_area(&poly, 0), 0);
+    for (unsigned r = 1; r < poly.num_rings; ++r) {
+      ASSERT_LT(polygon_ring_signed_area(&poly, r), 0);
+      Polygon outer;
+      polygon_init(&outer, poly.points, polygon_ring_size(&poly, 0));
+      ASSERT_NE(polygon_locate(&outer, poly.points[poly.ring_starts[r]]),
+                POLYGON_OUTSIDE);
+      polygon_free(&outer);
+    }
+    polygon_free(&poly);
+  }
+
+  BBox box = bbox_union(polygon_bbox(&a), polygon_bbox(&b));
+  for (unsigned i = 0; i < 2000; ++i) {
+    double tx = (double)rand() / RAND_MAX;
+    double ty = (double)rand() / RAND_MAX;
+    Point p = {box.min_x + tx * (box.max_x - box.min_x),
+               box.min_y + ty * (box.max_y - box.min_y)};
+    PolygonLocation la = polygon_locate(&a, p);
+    PolygonLocation lb = polygon_locate(&b, p);
+    if (la == POLYGON_BOUNDARY || lb == POLYGON_BOUNDARY) {
+      continue;
+    }
+    bool expected =
+        apply(op, la == POLYGON_INSIDE, lb == POLYGON_INSIDE);
+    ASSERT_EQ(polygon_set_locate(&set, p),
+              expected ? POLYGON_INSIDE : POLYGON_OUTSIDE)
+        << "op " << op << " at " << p.x << " " << p.y;
+  }
+}
+
+// Runs every operation on a and b, checks each result, and checks the areas
+// against the intersection's.
+static void check_operations(const Polygon &a, const Polygon &b) {
+  double areas[4];
+  for (PolygonOperation op : OPERATIONS) {
+    PolygonSet set;
+    polygon_set_init(&set);
+    polygon_boolean(&a, &b, op, &set);
+    check_result(a, b, op, set);
+    areas[op] = polygon_set_area(&set);
+    polygon_set_free(&set);
+  }
+  double area_a = polygon_area(&a);
+  double area_b = polygon_area(&b);
+  double eps = 1e-9 * (area_a + area_b);
+  ASSERT_NEAR(areas[POLYGON_UNION],
+              area_a + area_b - areas[POLYGON_INTERSECTION], eps);
+  ASSERT_NEAR(areas[POLYGON_DIFFERENCE],
+              area_a - areas[POLYGON_INTERSECTION], eps);
+  ASSERT_NEAR(areas[POLYGON_XOR],
+              areas[POLYGON_UNION] - areas[POLYGON_INTERSECTION], eps);
+}
+
+// Where rings touch at a point, either one ring through the point or one ring
+// on each side is right, so counts of -1 are not checked.
+struct Expected {
+  double area;
+  int polygons;
+  int rings;
+};
+
+static void check_exact(const Polygon &a, const Polygon &b,
+                        const Expected (&expected)[4]) {
+  for (PolygonOperation op : OPERATIONS) {
+    PolygonSet set;
+    polygon_set_init(&set);
+    polygon_boolean(&a, &b, op, &set);
+    check_result(a, b, op, set);
+    ASSERT_EQ(polygon_set_area(&set), expected[op].area) << "op " << op;
+    if (expected[op].polygons >= 0) {
+      ASSERT_EQ(set.num_polygons, expected[op].polygons) << "op " << op;
+      ASSERT_EQ(set.num_rings, expected[op].rings) << "op " << op;
+    }
+    polygon_set_free(&set);
+  }
+}
+
+TEST(PolygonBoolean, OverlappingSquares) {
+  Polygon a = rectangle(0, 0, 10, 10);
+  Polygon b = rectangle(5, 5, 15, 15);
+  check_exact(a, b, {{25, 1, 1}, {175, 1, 1}, {75, 1, 1}, {150, -1, -1}});
+  polygon_free(&a);
+  polygon_free(&b);
+}
+
+TEST(PolygonBoolean, SharedEdges) {
+  // Side by side
+  Polygon a = rectangle(0, 0, 10, 10);
+  Polygon b = rectangle(10, 0, 20, 10);
+  check_exact(a, b, {{0, 0, 0}, {200, 1, 1}, {100, 1, 1}, {200, 1, 1}});
+  polygon_free(&b);
+
+  // Overlapping along the top and bottom
+  b = rectangle(5, 0, 15, 10);
+  check_exact(a, b, {{50, 1, 1}, {150, 1, 1}, {50, 1, 1}, {100, 2, 2}});
+  polygon_free(&b);
+
+  // The same square, wound the other way
+  Point reversed[] = {{0, 0}, {0, 10}, {10, 10}, {10, 0}};
+  polygon_init(&b, reversed, 4);
+  check_exact(a, b, {{100, 1, 1}, {100, 1, 1}, {0, 0, 0}, {0, 0, 0}});
+  polygon_free(&b);
+  polygon_free(&a);
+}
+
+TEST(PolygonBoolean, Holes) {
+  Polygon a = rectangle(0, 0, 10, 10);
+  Polygon b = rectangle(3, 3, 7, 7);
+  check_exact(a, b, {{16, 1, 1}, {100, 1, 1}, {84, 1, 2}, {84, 1, 2}});
+
+  // Filling the hole again, and adding an island inside it
+  Polygon holed = rectangle(0, 0, 10, 10);
+  add_rectangle_hole(&holed, 3, 3, 7, 7);
+  check_exact(holed, b, {{0, 0, 0}, {100, 1, 1}, {84, 1, 2}, {100, 1, 1}});
+  polygon_free(&b);
+  b = rectangle(4, 4, 6, 6);
+  check_exact(holed, b, {{0, 0, 0}, {88, 2, 3}, {84, 1, 2}, {88, 2, 3}});
+  polygon_free(&b);
+
+  // Cutting across the hole splits the polygon's ring
+  b = rectangle(-1, 4, 11, 6);
+  check_exact(holed, b, {{12, 2, 2}, {96, 1, 3}, {72, 2, 2}, {84, -1, -1}});
+  polygon_free(&b);
+  polygon_free(&holed);
+  polygon_free(&a);
+}
+
+TEST(PolygonBoolean, DisjointAndTouching) {
+  Polygon a = rectangle(0, 0, 10, 10);
+  Polygon b = rectangle(20, 0, 30, 10);
+  check_exact(a, b, {{0, 0, 0}, {200, 2, 2}, {100, 1, 1}, {200, 2, 2}});
+  polygon_free(&b);
+
+  // A triangle whose tip touches the square's right edge
+  Point triangle[] = {{10, 5}, {20, 0}, {20, 10}};
+  polygon_init(&b, triangle, 3);
+  check_exact(a, b, {{0, 0, 0}, {150, -1, -1}, {100, 1, 1}, {150, -1, -1}});
+  polygon_free(&b);
+
+  // A triangle with its tip inside the square
+  Point crossing[] = {{5, 5}, {15, 0}, {15, 10}};
+  polygon_init(&b, crossing, 3);
+  check_operations(a, b);
+  polygon_free(&b);
+  polygon_free(&a);
+}
+
+TEST(PolygonBoolean, RandomStars) {
+  srand(0);
+  for (unsigned trial = 0; trial < 40; ++trial) {
+    unsigned n = 3 + rand() % 60;
+    Polygon a = random_star({random_coord() / 4, random_coord() / 4}, 50, n);
+    Polygon b = random_star({random_coord() / 4, random_coord() / 4}, 50,
+                            3 + rand() % 60);
+    check_operations(a, b);
+    // Against itself every edge overlaps
+    check_operations(a, a);
+    polygon_free(&a);
+    polygon_free(&b);
+  }
+}
+
+TEST(PolygonBoolean, Grids) {
+  // Many shared vertices and collinear edges
+  srand(1);
+  for (unsigned trial = 0; trial < 40; ++trial) {
+    std::vector<Point> points;
+    unsigned n = 3 + rand() % 10;
+    for (unsigned i = 0; i < n; ++i) {
+      double angle = 2 * M_PI * i / n;
+      double r = 2 + rand() % 4;
+      points.push_back({round(r * cos(angle)), round(r * sin(angle))});
+    }
+    Polygon a;
+    polygon_init(&a, points.data(), n);
+    Polygon b = rectangle(rand() % 5 - 4, rand() % 5 - 4, 1 + rand() % 4,
+                          1 + rand() % 4);
+    if (polygon_area(&a) != 0) {
+      check_operations(a, b);
+    }
+    polygon_free(&a);
+    polygon_free(&b);
+  }
+}
+
+// A star shaped polygon with integer vertices, which gives pairs of polygons
+// with shared vertices, collinear edges and vertices on edges.
+static Polygon random_grid_star() {
+  Point center = {(double)(8 + rand() % 5), (double)(8 + rand() % 5)};
+  unsigned n = 3 + rand() % 10;
+  std::vector<Point> points;
+  for (unsigned i = 0; i < n; ++i) {
+    double angle = 2 * M_PI * i / n;
+    double r = 2 + rand() % 8;
+    points.push_back({round(center.x + r * cos(angle)),
+                      round(center.y + r * sin(angle))});
+  }
+  Polygon poly;
+  polygon_init(&poly, points.data(), n);
+  return poly;
+}
+
+TEST(PolygonBoolean, RandomGridStars) {
+  // Both ends of a result edge past where the intersection stops sweeping
+  Point a_points[] = {{19, 15}, {13, 7}, {17, 4}};
+  Point b_points[] = {{11, 13}, {13, 17}, {9, 12}, {8, 11}, {7, 11},
+                      {3, 13},  {8, 10},  {10, 6}, {15, 1}};
+  Polygon a, b;
+  polygon_init(&a, a_points, 3);
+  polygon_init(&b, b_points, 9);
+  check_operations(a, b);
+  polygon_free(&a);
+  polygon_free(&b);
+
+  srand(11);
+  for (unsigned trial = 0; trial < 200; ++trial) {
+    a = random_grid_star();
+    b = random_grid_star();
+    check_operations(a, b);
+    // A hole that can cross the outer ring or run along it, which only the
+    // even-odd rule makes sense of, so the areas are not checked
+    add_rectangle_hole(&a, 9, 9, 11, 11);
+    for (PolygonOperation op : OPERATIONS) {
+      PolygonSet set;
+      polygon_set_init(&set);
+      polygon_boolean(&a, &b, op, &set);
+      check_result(a, b, op, set);
+      polygon_set_free(&set);
+    }
+    polygon_free(&a);
+    polygon_free(&b);
+  }
+}
+
+TEST(PolygonBoolean, Sets) {
+  srand(2);
+  PolygonSet a, b;
+  polygon_set_init(&a);
+  polygon_set_init(&b);
+  std::vector<Polygon> as, bs;
+  for (unsigned i = 0; i < 5; ++i) {
+    // Disjoint polygons within each set, each overlapping only its pair
+    as.push_back(random_star({i * 200.0, 0}, 40, 20));
+    bs.push_back(random_star({i * 200.0 + 30, 20}, 40, 20));
+    polygon_set_add_polygon(&a, &as.back());
+    polygon_set_add_polygon(&b, &bs.back());
+  }
+
+  PolygonSet result;
+  polygon_set_init(&result);
+  polygon_set_boolean(&a, &b, POLYGON_UNION, &result);
+  for (unsigned i = 0; i < 2000; ++i) {
+    Point p = {random_coord() * 5 + 400, random_coord() * 0.7};
+    PolygonLocation la = polygon_set_locate(&a, p);
+    PolygonLocation lb = polygon_set_locate(&b, p);
+    if (la != POLYGON_BOUNDARY && lb != POLYGON_BOUNDARY) {
+      bool inside = la == POLYGON_INSIDE || lb == POLYGON_INSIDE;
+      ASSERT_EQ(polygon_set_locate(&result, p),
+                inside ? POLYGON_INSIDE : POLYGON_OUTSIDE);
+    }
+  }
+  double area = 0;
+  for (unsigned i = 0; i < 5; ++i) {
+    PolygonSet pair;
+    polygon_set_init(&pair);
+    polygon_boolean(&as[i], &bs[i], POLYGON_UNION, &pair);
+    area += polygon_set_area(&pair);
+    polygon_set_free(&pair);
+  }
+  ASSERT_NEAR(polygon_set_area(&result), area, 1e-6);
+
+  PolygonSet empty;
+  polygon_set_init(&empty);
+  polygon_set_clear(&result);
+  polygon_set_boolean(&a, &empty, POLYGON_INTERSECTION, &result);
+  ASSERT_EQ(result.num_rings, 0);
+  polygon_set_boolean(&a, &empty, POLYGON_DIFFERENCE, &result);
+  ASSERT_EQ(result.num_polygons, 5);
+  ASSERT_NEAR(polygon_set_area(&result), polygon_set_area(&a), 1e-9);
+
+  polygon_set_free(&empty);
+  polygon_set_free(&result);
+  for (unsigned i = 0; i < 5; ++i) {
+    polygon_free(&as[i]);
+    polygon_free(&bs[i]);
+  }
+  polygon_set_free(&a);
+  polygon_set_free(&b);
+}
+
+TEST(PolygonClip, MatchesIntersection) {
+  srand(3);
+  Point hexagon[6];
+  for (unsigned i = 0; i < 6; ++i) {
+    hexagon[i] = {40 * cos(M_PI * i / 3) + 10, 40 * sin(M_PI * i / 3)};
+  }
+  Point reversed[6];
+  for (unsigned i = 0; i < 6; ++i) {
+    reversed[i] = hexagon[5 - i];
+  }
+  Polygon window;
+  polygon_init(&window, hexagon, 6);
+  Polygon box = rectangle(-20, -30, 35, 25);
+
+  for (unsigned trial = 0; trial < 20; ++trial) {
+    Polygon star = random_star({random_coord() / 4, random_coord() / 4}, 50,
+                               3 + rand() % 60);
+    PolygonSet expected, clipped;
+    polygon_set_init(&expected);
+    polygon_set_init(&clipped);
+
+    polygon_boolean(&star, &window, POLYGON_INTERSECTION, &expected);
+    for (const Point *w : {hexagon, reversed}) {
+      polygon_set_clear(&clipped);
+      polygon_clip_convex(&star, w, 6, &clipped);
+      ASSERT_LE(clipped.num_polygons, 1);
+      ASSERT_NEAR(polygon_set_area(&clipped), polygon_set_area(&expected),
+                  1e-6);
+      check_result(star, window, POLYGON_INTERSECTION, clipped);
+    }
+
+    polygon_set_clear(&expected);
+    polygon_set_clear(&clipped);
+    polygon_boolean(&star, &box, POLYGON_INTERSECTION, &expected);
+    polygon_clip_bbox(&star, {-20, -30, 35, 25}, &clipped);
+    ASSERT_NEAR(polygon_set_area(&clipped), polygon_set_area(&expected),
+                1e-6);
+    check_result(star, box, POLYGON_INTERSECTION, clipped);
+
+    polygon_set_free(&expected);
+    polygon_set_free(&clipped);
+    polygon_free(&star);
+  }
+
+  // Windows that miss the polygon or contain it
+  Polygon small = rectangle(0, 0, 1, 1);
+  PolygonSet clipped;
+  polygon_set_init(&clipped);
+  polygon_clip_bbox(&small, {5, 5, 6, 6}, &clipped);
+  ASSERT_EQ(clipped.num_polygons, 0);
+  polygon_clip_convex(&small, hexagon, 6, &clipped);
+  ASSERT_EQ(clipped.num_polygons, 1);
+  ASSERT_EQ(polygon_set_area(&clipped), 1);
+  polygon_set_free(&clipped);
+
+  polygon_free(&small);
+  polygon_free(&box);
+  polygon_free(&window);
+}
@@ -0,0 +1,213 @@
+#include "geometry/util.h"
+extern "C" {
+#include "geometry/algorithm/polygon_triangulate.h"
+#include "geometry/predicates.h"
+}
+#include <cmath>
+#include <gtest/gtest.h>
+#include <vector>
+
+static const TriangulateMethod METHODS[] = {
+    TRIANGULATE_AUTO, TRIANGULATE_MONOTONE, TRIANGULATE_EAR_CLIPPING};
+
+// A star shaped ring of n points counterclockwise around center, each at a
+// random angle in its own slice of the circle and a random radius between r0
+// and r1.
+static std::vector<Point> star(Point center, unsigned n, double r0, double r1) {
+  std::vector<Point> points;
+  for (unsigned i = 0; i < n; ++i) {
+    double angle = 2 * M_PI * (i + (double)rand() / RAND_MAX * 0.9) / n;
+    double r = r0 + (double)rand() / RAND_MAX * (r1 - r0);
+    points.push_back({center.x + r * cos(angle), center.y + r * sin(angle)});
+  }
+  return points;
+}
+
+static std::vector<Point> square(double x, double y, double side) {
+  return {{x, y}, {x + side, y}, {x + side, y + side}, {x, y + side}};
+}
+
+static Polygon make_polygon(const std::vector<std::vector<Point>> &rings) {
+  Polygon poly;
+  polygon_init(&poly, rings[0].data(), rings[0].size());
+  for (unsigned r = 1; r < rings.size(); ++r) {
+    polygon_add_hole(&poly, rings[r].data(), rings[r].size());
+  }
+  return poly;
+}
+
+// Checks that the triangles are counterclockwise, inside the polygon and add
+// up to its area, which together mean they tile it.
+static void check_triangles(const Polygon &poly,
+                            const std::vector<unsigned> &triangles,
+                            unsigned count) {
+  double area = 0;
+  for (unsigned t = 0; t < count; ++t) {
+    Point p[3];
+    for (unsigned k = 0; k < 3; ++k) {
+      ASSERT_LT(triangles[3 * t + k], poly.num_points);
+      p[k] = poly.points[triangles[3 * t + k]];
+    }
+    double a = orient2d(p[0], p[1], p[2]);
+    ASSERT_GE(a, 0);
+    area += a / 2;
+    if (a > 0) {
+      Point centroid = {(p[0].x + p[1].x + p[2].x) / 3,
+                        (p[0].y + p[1].y + p[2].y) / 3};
+      ASSERT_NE(polygon_locate(&poly, centroid), POLYGON_OUTSIDE);
+    }
+  }
+  double expected = polygon_area(&poly);
+  ASSERT_NEAR(area, expected, 1e-9 * std::max(1.0, expected));
+}
+
+// Triangulates with each method and checks the result. Monotone
+// decomposition gives exactly polygon_triangle_count triangles, as does ear
+// clipping unless it drops points, which it may when points are collinear.
+static void check_polygon(const Polygon &poly, bool exact_count = true) {
+  unsigned expected = polygon_triangle_count(&poly);
+  for (TriangulateMethod method : METHODS) {
+    std::vector<unsigned> triangles(3 * expected);
+    unsigned count = polygon_triangulate(&poly, method, triangles.data());
+    if (exact_count || method == TRIANGULATE_MONOTONE) {
+      ASSERT_EQ(count, expected);
+    } else {
+      ASSERT_LE(count, expected);
+    }
+    check_triangles(poly, triangles, count);
+  }
+}
+
+TEST(PolygonTriangulate, Convex) {
+  Polygon poly = make_polygon({square(0, 0, 1)});
+  ASSERT_EQ(polygon_triangle_count(&poly), 2);
+  check_polygon(poly);
+  std::vector<unsigned> triangles(6);
+  ASSERT_EQ(polygon_triangulate_monotone(&poly, triangles.data()), 2);
+  ASSERT_EQ(polygon_triangulate_ear_clipping(&poly, triangles.data()), 2);
+  polygon_free(&poly);
+
+  // Clockwise rings give counterclockwise triangles
+  std::vector<Point> ring = {{0, 0}, {0, 2}, {1, 3}, {2, 2}, {2, 0}};
+  poly = make_polygon({ring});
+  check_polygon(poly);
+  polygon_free(&poly);
+}
+
+TEST(PolygonTriangulate, Concave) {
+  // A comb with teeth pointing down from the top and up from the bottom,
+  // which has split and merge vertices
+  std::vector<Point> ring;
+  for (unsigned i = 0; i <= 10; ++i) {
+    ring.push_back({i * 2.0, i % 2 ? 3.0 : 0.0});
+  }
+  for (unsigned i = 10; i-- > 0;) {
+    ring.push_back({i * 2.0 + 1, i % 2 ? 5.0 : 8.0});
+  }
+  Polygon poly = make_polygon({ring});
+  check_polygon(poly);
+  polygon_free(&poly);
+
+  // A staircase, with many vertices at the same height
+  ring.clear();
+  for (unsigned i = 0; i < 10; ++i) {
+    ring.push_back({(double)i, (double)i});
+    ring.push_back({i + 1.0, (double)i});
+  }
+  ring.push_back({10, 10});
+  ring.push_back({0, 10});
+  poly = make_polygon({ring});
+  check_polygon(poly);
+  polygon_free(&poly);
+}
+
+TEST(PolygonTriangulate, Holes) {
+  std::vector<Point> outer = square(0, 0, 10);
+  std::vector<Point> hole = square(2, 2, 2);
+  std::swap(hole[1], hole[3]);
+  Polygon poly = make_polygon({outer, hole, square(6, 5, 3), square(2, 6, 1)});
+  ASSERT_EQ(polygon_triangle_count(&poly), 16 + 2 * 3 - 2);
+  check_polygon(poly, false);
+  polygon_free(&poly);
+
+  // Holes that share heights with the outer ring and each other
+  poly = make_polygon({square(0, 0, 12), square(1, 0.5, 1), square(4, 0.5, 1),
+                       square(7, 1, 1)});
+  check_polygon(poly, false);
+  polygon_free(&poly);
+}
+
+TEST(PolygonTriangulate, Degenerate) {
+  // Ear clipping drops a repeated point once no ear is left
+  std::vector<Point> ring = {{0, 0}, {1, 0}, {2, 0}, {2, 0}, {2, 2},
+                             {1, 2}, {0, 2}, {0, 1}};
+  Polygon poly = make_polygon({ring});
+  unsigned expected = polygon_triangle_count(&poly);
+  std::vector<unsigned> triangles(3 * expected);
+  unsigned count = polygon_triangulate_ear_clipping(&poly, triangles.data());
+  ASSERT_LT(count, expected);
+  check_triangles(poly, triangles, count);
+  polygon_free(&poly);
+
+  // Collinear points alone are kept by monotone decomposition
+  ring = {{0, 0}, {1, 0}, {2, 0}, {2, 2}, {1, 2}, {0, 2}};
+  poly = make_polygon({ring});
+  check_polygon(poly, false);
+  polygon_free(&poly);
+}
+
+TEST(PolygonTriangulate, Random) {
+  srand(0);
+  for (unsigned n : {5, 20, 100, 1000, 5000}) {
+    for (unsigned k = 0; k < 5; ++k) {
+      std::vector<std::vector<Point>> rings = {star({0, 0}, n, 50, 100)};
+      // Up to four holes that fit between the center and the inner radius,
+      // which the outer ring stays outside of when n is not too small
+      for (unsigned h = 0; n >= 20 && h < k; ++h) {
+        rings.push_back(star({h % 2 ? 15.0 : -15.0, h / 2 ? 15.0 : -15.0},
+                             3 + n / 10, 2, 8));
+      }
+      Polygon poly = make_polygon(rings);
+      check_polygon(poly, false);
+      polygon_free(&poly);
+    }
+  }
+}
+
+TEST(PolygonTriangulate, Set) {
+  srand(1);
+  PolygonSet set;
+  polygon_set_init(&set);
+  for (unsigned i = 0; i < 200; ++i) {
+    Point center = {(double)(i % 20) * 300, (double)(i / 20) * 300};
+    std::vector<Point> outer = star(center, 3 + rand() % 200, 50, 100);
+    polygon_set_add_ring(&set, outer.data(), outer.size(), false);
+    if (i % 3 == 0) {
+      std::vector<Point> hole = star(center, 3 + rand() % 20, 5, 20);
+      polygon_set_add_ring(&set, hole.data(), hole.size(), true);
+    }
+  }
+  for (TriangulateMethod method : METHODS) {
+    for (unsigned threads : {1, 4}) {
+      PolygonTriangles out;
+      polygon_set_triangulate(&set, method, threads, &out);
+      ASSERT_EQ(out.num_polygons, set.num_polygons);
+      ASSERT_EQ(out.triangle_starts[out.num_polygons], out.num_triangles);
+      for (unsigned i = 0; i < set.num_polygons; ++i) {
+        Polygon poly;
+        polygon_set_get(&set, i, &poly);
+        std::vector<unsigned> expected(3 * polygon_triangle_count(&poly));
+        unsigned count = polygon_triangulate(&poly, method, expected.data());
+        ASSERT_EQ(out.triangle_starts[i + 1] - out.triangle_starts[i], count);
+        unsigned base = set.ring_starts[set.polygon_starts[i]];
+        for (unsigned j = 0; j < 3 * count; ++j) {
+          ASSERT_EQ(out.indices[3 * out.triangle_starts[i] + j],
+                    base + expected[j]);
+        }
+        polygon_free(&poly);
+      }
+      polygon_triangles_free(&out);
+    }
+  }
+  polygon_set_free(&set);
+}
@@ -0,0 +1,268 @@
+#include "geometry/util.h"
+extern "C" {
+#include "geometry/algorithm/polyline_simplify.h"
+}
+#include <cmath>
+#include <gtest/gtest.h>
+#include <vector>
+
+// A random walk of n points.
+static std::vector<Point> random_walk(unsigned n) {
+  std::vector<Point> points;
+  Point p = {0, 0};
+  for (unsigned i = 0; i < n; ++i) {
+    p.x += (double)rand() / RAND_MAX * 2 - 1;
+    p.y += (double)rand() / RAND_MAX * 2 - 1;
+    points.push_back(p);
+  }
+  return points;
+}
+
+static double segment_distance(Point p, Point a, Point b) {
+  double dx = b.x - a.x, dy = b.y - a.y;
+  double length2 = dx * dx + dy * dy;
+  double t = length2 > 0 ? ((p.x - a.x) * dx + (p.y - a.y) * dy) / length2 : 0;
+  t = std::max(0.0, std::min(1.0, t));
+  return std::hypot(p.x - a.x - t * dx, p.y - a.y - t * dy);
+}
+
+static void reference_douglas_peucker(const std::vector<Point> &points,
+                                      unsigned a, unsigned b, double tolerance,
+                                      std::vector<bool> &keep) {
+  double farthest = tolerance;
+  unsigned far = 0;
+  for (unsigned i = a + 1; i < b; ++i) {
+    double d = segment_distance(points[i], points[a], points[b]);
+    if (d > farthest) {
+      farthest = d;
+      far = i;
+    }
+  }
+  if (far > 0) {
+    keep[far] = true;
+    reference_douglas_peucker(points, a, far, tolerance, keep);
+    reference_douglas_peucker(points, far, b, tolerance, keep);
+  }
+}
+
+static double triangle_area(Point a, Point b, Point c) {
+  return fabs((b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x)) / 2;
+}
+
+// Drops the interior point with the smallest area, the first of any ties,
+// until none is below min_area.
+static std::vector<Point> reference_visvalingam(std::vector<Point> points,
+                                                double min_area) {
+  for (;;) {
+    unsigned best = 0;
+    double smallest = min_area;
+    for (unsigned i = 1; i + 1 < points.size(); ++i) {
+      double area = triangle_area(points[i - 1], points[i], points[i + 1]);
+      if (area < smallest) {
+        smallest = area;
+        best = i;
+      }
+    }
+    if (best == 0) {
+      return points;
+    }
+    points.erase(points.begin() + best);
+  }
+}
+
+// Whether any two segments that are not consecutive along the line meet. The
+// first and last segments of a closed line are consecutive.
+static bool crosses_itself(const std::vector<Point> &points) {
+  unsigned n = points.size();
+  bool closed = n > 3 && point_equals(points[0], points[n - 1]);
+  for (unsigned i = 0; i + 1 < n; ++i) {
+    for (unsigned j = i + 2; j + 1 < n; ++j) {
+      if (closed && i == 0 && j == n - 2) {
+        continue;
+      }
+      if (segment_intersects({points[i], points[i + 1]},
+                             {points[j], points[j + 1]})) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+// A closed star shaped ring of n points with radii alternating near inner and
+// outer.
+static std::vector<Point> star_ring(unsigned n, double inner, double outer) {
+  std::vector<Point> points;
+  for (unsigned i = 0; i < n; ++i) {
+    double angle = 2 * M_PI * i / n;
+    double r = (i % 2 ? inner : outer) * (1 + (double)rand() / RAND_MAX / 10);
+    points.push_back({r * cos(angle), r * sin(angle)});
+  }
+  points.push_back(points[0]);
+  return points;
+}
+
+TEST(PolylineSimplify, DouglasPeucker) {
+  // Points within tolerance of the line between the ends are dropped
+  std::vector<Point> points = {{0, 0}, {1, 0.1}, {2, -0.1}, {3, 5}, {4, 6},
+                               {5, 7}, {6, 8.1}, {7, 9}};
+  std::vector<Point> out(points.size());
+  unsigned count = polyline_simplify_douglas_peucker(
+      points.data(), points.size(), 0.5, out.data());
+  ASSERT_EQ(count, 4);
+  ASSERT_TRUE(point_equals(out[0], {0, 0}));
+  ASSERT_TRUE(point_equals(out[1], {2, -0.1}));
+  ASSERT_TRUE(point_equals(out[2], {3, 5}));
+  ASSERT_TRUE(point_equals(out[3], {7, 9}));
+
+  ASSERT_EQ(polyline_simplify_douglas_peucker(nullptr, 0, 1, nullptr), 0);
+  ASSERT_EQ(
+      polyline_simplify_douglas_peucker(points.data(), 2, 100, out.data()), 2);
+
+  srand(0);
+  for (unsigned n : {3, 10, 100, 2000}) {
+    for (double tolerance : {0.0, 0.5, 2.0, 10.0}) {
+      points = random_walk(n);
+      std::vector<bool> keep(n);
+      keep[0] = keep[n - 1] = true;
+      reference_douglas_peucker(points, 0, n - 1, tolerance, keep);
+      out.resize(n);
+      count = polyline_simplify_douglas_peucker(points.data(), n, tolerance,
+                                                out.data());
+      unsigned k = 0;
+      for (unsigned i = 0; i < n; ++i) {
+        if (keep[i]) {
+          ASSERT_LT(k, count);
+          ASSERT_TRUE(point_equals(out[k++], points[i]));
+        }
+      }
+      ASSERT_EQ(k, count);
+
+      // In place
+      count = polyline_simplify_douglas_peucker(points.data(), n, tolerance,
+                                                points.data());
+      ASSERT_EQ(count, k);
+      for (unsigned i = 0; i < count; ++i) {
+        ASSERT_TRUE(point_equals(points[i], out[i]));
+      }
+    }
+  }
+}
+
+TEST(PolylineSimplify, VisvalingamWhyatt) {
+  // The middle of three collinear points has no area
+  std::vector<Point> points = {{0, 0}, {1, 1}, {2, 2}, {3, 0}};
+  std::vector<Point> out(points.size());
+  unsigned count = polyline_simplify_visvalingam_whyatt(
+      points.data(), points.size(), 0.1, false, out.data());
+  ASSERT_EQ(count, 3);
+  ASSERT_TRUE(point_equals(out[1], {2, 2}));
+  ASSERT_EQ(
+      polyline_simplify_visvalingam_whyatt(nullptr, 0, 1, false, nullptr), 0);
+
+  srand(1);
+  for (unsigned n : {3, 10, 100, 1000}) {
+    for (double min_area : {0.0, 0.1, 1.0, 10.0}) {
+      points = random_walk(n);
+      std::vector<Point> expected = reference_visvalingam(points, min_area);
+      out.resize(n);
+      count = polyline_simplify_visvalingam_whyatt(points.data(), n, min_area,
+                                                   false, out.data());
+      ASSERT_EQ(count, expected.size());
+      for (unsigned i = 0; i < count; ++i) {
+        ASSERT_TRUE(point_equals(out[i], expected[i]));
+      }
+    }
+  }
+}
+
+TEST(PolylineSimplify, PreserveTopology) {
+  // Dropping the flat bump at (50, 2) would cut below (50, 1)
+  std::vector<Point> hook = {{0, 0},     {50, 2}, {100, 0},
+                             {100, -50}, {50, 1}, {50, -50}};
+  ASSERT_FALSE(crosses_itself(hook));
+  std::vector<Point> out(hook.size());
+  unsigned count = polyline_simplify_visvalingam_whyatt(
+      hook.data(), hook.size(), 200, false, out.data());
+  out.resize(count);
+  ASSERT_EQ(count, 5);
+  ASSERT_TRUE(crosses_itself(out));
+  out.resize(hook.size());
+  count = polyline_simplify_visvalingam_whyatt(hook.data(), hook.size(), 200,
+                                               true, out.data());
+  ASSERT_EQ(count, 6);
+
+  srand(2);
+  for (unsigned n : {20, 200, 2000}) {
+    std::vector<Point> ring = star_ring(n, 50, 100);
+    ASSERT_FALSE(crosses_itself(ring));
+    out.resize(ring.size());
+    count = polyline_simplify_visvalingam_whyatt(ring.data(), ring.size(), 1e4,
+                                                 true, out.data());
+    out.resize(count);
+    ASSERT_FALSE(crosses_itself(out));
+    ASSERT_GE(count, 4);
+    ASSERT_LT(count, ring.size());
+  }
+
+  // A closed ring stops at a triangle
+  std::vector<Point> ring = {{0, 0}, {4, 0}, {5, 3}, {2, 5}, {-1, 3}, {0, 0}};
+  out.resize(ring.size());
+  ASSERT_EQ(polyline_simplify_visvalingam_whyatt(ring.data(), ring.size(), 1e9,
+                                                 true, out.data()),
+            4);
+
+  // Random walks cross themselves, but simplifying adds no crossings where
+  // there were none
+  for (unsigned k = 0; k < 50; ++k) {
+    std::vector<Point> points = random_walk(30);
+    if (crosses_itself(points)) {
+      continue;
+    }
+    out.resize(points.size());
+    count = polyline_simplify_visvalingam_whyatt(
+        points.data(), points.size(), 100, true, out.data());
+    out.resize(count);
+    ASSERT_FALSE(crosses_itself(out));
+  }
+}
+
+TEST(PolylineSimplify, Set) {
+  srand(3);
+  PolylineSet lines;
+  polyline_set_init(&lines);
+  for (unsigned i = 0; i < 300; ++i) {
+    std::vector<Point> points = random_walk(rand() % 40);
+    polyline_set_add(&lines, points.data(), points.size());
+  }
+  for (SimplifyMethod method :
+       {SIMPLIFY_DOUGLAS_PEUCKER, SIMPLIFY_VISVALINGAM_WHYATT}) {
+    for (unsigned threads : {1, 4}) {
+      SimplifyOptions options = {
+          .method = method, .tolerance = 0.5, .preserve_topology = true};
+      PolylineSet out;
+      polyline_set_init(&out);
+      polyline_set_simplify(&lines, options, threads, &out);
+      polyline_set_validate(&out);
+      ASSERT_EQ(out.num_lines, lines.num_lines);
+      for (unsigned i = 0; i < lines.num_lines; ++i) {
+        unsigned n = polyline_set_line_size(&lines, i);
+        std::vector<Point> expected(n);
+        const Point *points = lines.points + lines.line_starts[i];
+        unsigned count =
+            method == SIMPLIFY_DOUGLAS_PEUCKER
+                ? polyline_simplify_douglas_peucker(points, n, 0.5,
+                                                    expected.data())
+                : polyline_simplify_visvalingam_whyatt(points, n, 0.5, true,
+                                                       expected.data());
+        ASSERT_EQ(polyline_set_line_size(&out, i), count);
+        for (unsigned j = 0; j < count; ++j) {
+          ASSERT_TRUE(point_equals(out.points[out.line_starts[i] + j],
+                                   expected[j]));
+        }
+      }
+      polyline_set_free(&out);
+    }
+  }
+  polyline_set_free(&lines);
+}
@@ -0,0 +1,270 @@
+#include "geometry/util.h"
+#include "random.h"
+extern "C" {
+#include "geometry/algorithm/convex_hull.h"
+#include "geometry/algorithm/rotating_calipers.h"
+}
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <set>
+#include <vector>
+
+static std::vector<Point> hull_of(const std::vector<Point> &points) {
+  std::vector<Point> scratch(convex_hull_scratch_size(points.size()));
+  unsigned h;
+  Point *hull =
+      convex_hull_in_scratch(points.data(), points.size(), scratch.data(), &h);
+  return std::vector<Point>(hull, hull + h);
+}
+
+static double dot(Point a, Point b) { return a.x * b.x + a.y * b.y; }
+
+// The area or perimeter of the smallest box with a side on one of the hull's
+// edges, trying every edge against every point.
+static double brute_force_box(const std::vector<Point> &hull, bool perimeter) {
+  double best = INFINITY;
+  for (unsigned i = 0; i < hull.size(); ++i) {
+    Point a = hull[i];
+    Point b = hull[(i + 1) % hull.size()];
+    double norm = point_distance(a, b);
+    Point u = {(b.x - a.x) / norm, (b.y - a.y) / norm};
+    Point v = {-u.y, u.x};
+    double min_u = INFINITY, max_u = -INFINITY;
+    double min_v = INFINITY, max_v = -INFINITY;
+    for (Point p : hull) {
+      min_u = std::min(min_u, dot(p, u));
+      max_u = std::max(max_u, dot(p, u));
+      min_v = std::min(min_v, dot(p, v));
+      max_v = std::max(max_v, dot(p, v));
+    }
+    double length = max_u - min_u;
+    double width = max_v - min_v;
+    best = std::min(best, perimeter ? 2 * (length + width) : length * width);
+  }
+  return best;
+}
+
+static void check_box_contains(const OrientedBox &box,
+                               const std::vector<Point> &points) {
+  ASSERT_NEAR(hypot(box.axis.x, box.axis.y), 1, 1e-12);
+  Point v = {-box.axis.y, box.axis.x};
+  for (Point p : points) {
+    Point d = {p.x - box.center.x, p.y - box.center.y};
+    ASSERT_LE(fabs(dot(d, box.axis)), box.length / 2 + 1e-9);
+    ASSERT_LE(fabs(dot(d, v)), box.width / 2 + 1e-9);
+  }
+}
+
+static bool circle_contains(const Circle &c, Point p) {
+  return point_distance(c.center, p) <= c.radius * (1 + 1e-9) + 1e-12;
+}
+
+// The smallest circle through two or three of the points that contains all of
+// them, in O(n^4).
+static double brute_force_circle(const std::vector<Point> &points) {
+  double best = INFINITY;
+  auto consider = [&](Circle c) {
+    if (c.radius >= best) {
+      return;
+    }
+    for (Point p : points) {
+      if (!circle_contains(c, p)) {
+        return;
+      }
+    }
+    best = c.radius;
+  };
+  unsigned n = points.size();
+  for (unsigned i = 0; i < n; ++i) {
+    for (unsigned j = i + 1; j < n; ++j) {
+      Point a = points[i], b = points[j];
+      Point m = {(a.x + b.x) / 2, (a.y + b.y) / 2};
+      consider({m, point_distance(a, m)});
+      for (unsigned k = j + 1; k < n; ++k) {
+        Point c = points[k];
+        double bx = b.x - a.x, by = b.y - a.y;
+        double cx = c.x - a.x, cy = c.y - a.y;
+        double d = 2 * (bx * cy - by * cx);
+        if (d == 0) {
+          continue;
+        }
+        double b2 = bx * bx + by * by, c2 = cx * cx + cy * cy;
+        Point center = {a.x + (cy * b2 - by * c2) / d,
+                        a.y + (bx * c2 - cx * b2) / d};
+        consider({center, point_distance(a, center)});
+      }
+    }
+  }
+  return best;
+}
+
+TEST(RotatingCalipers, AntipodalPairs) {
+  std::vector<IndexPair> pairs(8);
+  std::vector<Point> square = {{0, 0}, {1, 0}, {1, 1}, {0, 1}};
+  ASSERT_EQ(hull_antipodal_pairs(square.data(), 4, pairs.data()), 6);
+  std::set<std::pair<unsigned, unsigned>> seen;
+  for (unsigned i = 0; i < 6; ++i) {
+    seen.insert(std::minmax(pairs[i].a, pairs[i].b));
+  }
+  // Every pair of a square's vertices is antipodal
+  ASSERT_EQ(seen.size(), 6);
+
+  std::vector<Point> triangle = {{0, 0}, {2, 0}, {0, 1}};
+  ASSERT_EQ(hull_antipodal_pairs(triangle.data(), 3, pairs.data()), 3);
+  ASSERT_EQ(hull_antipodal_pairs(triangle.data(), 2, pairs.data()), 1);
+  ASSERT_EQ(hull_antipodal_pairs(triangle.data(), 1, pairs.data()), 0);
+
+  // Each of the octagon's four pairs of parallel edges gives four pairs, which
+  // share the two diagonals between them, and odd regular polygons have no
+  // parallel edges
+  std::vector<Point> octagon = {{1, 0}, {2, 0}, {3, 1}, {3, 2},
+                                {2, 3}, {1, 3}, {0, 2}, {0, 1}};
+  std::vector<Point> hull = hull_of(octagon);
+  pairs.resize(12);
+  ASSERT_EQ(hull_antipodal_pairs(hull.data(), 8, pairs.data()), 12);
+  std::vector<Point> heptagon;
+  for (unsigned i = 0; i < 7; ++i) {
+    heptagon.push_back({cos(2 * M_PI * i / 7), sin(2 * M_PI * i / 7)});
+  }
+  hull = hull_of(heptagon);
+  ASSERT_EQ(hull_antipodal_pairs(hull.data(), 7, pairs.data()), 7);
+}
+
+TEST(RotatingCalipers, Degenerate) {
+  std::vector<Point> scratch(convex_hull_scratch_size(3));
+  unsigned a, b;
+  Point one = {1, 2};
+  ASSERT_FALSE(farthest_pair(&one, 1, scratch.data(), &a, &b));
+  OrientedBox box;
+  min_area_box(&one, 1, scratch.data(), &box);
+  ASSERT_EQ(box.center.x, 1);
+  ASSERT_EQ(box.length, 0);
+  Circle circle;
+  min_enclosing_circle(&one, 1, scratch.data(), &circle);
+  ASSERT_EQ(circle.center.y, 2);
+  ASSERT_EQ(circle.radius, 0);
+
+  // Repeated and collinear points
+  std::vector<Point> points = {{1, 1}, {1, 1}};
+  ASSERT_TRUE(farthest_pair(points.data(), 2, scratch.data(), &a, &b));
+  ASSERT_EQ(a, 0);
+  ASSERT_EQ(b, 1);
+  points = {{0, 0}, {3, 4}, {6, 8}};
+  ASSERT_TRUE(farthest_pair(points.data(), 3, scratch.data(), &a, &b));
+  ASSERT_EQ(a, 0);
+  ASSERT_EQ(b, 2);
+  ASSERT_EQ(points_width(points.data(), 3, scratch.data()), 0);
+  min_perimeter_box(points.data(), 3, scratch.data(), &box);
+  ASSERT_DOUBLE_EQ(box.length, 10);
+  ASSERT_EQ(box.width, 0);
+  ASSERT_DOUBLE_EQ(box.axis.x, 0.6);
+  min_enclosing_circle(points.data(), 3, scratch.data(), &circle);
+  ASSERT_DOUBLE_EQ(circle.radius, 5);
+  ASSERT_DOUBLE_EQ(circle.center.x, 3);
+}
+
+TEST(RotatingCalipers, Rectangle) {
+  // A rotated rectangle is its own smallest box
+  double c = cos(0.3), s = sin(0.3);
+  std::vector<Point> points;
+  for (Point p : std::vector<Point>{{0, 0}, {4, 0}, {4, 1}, {0, 1}, {2, 0.5}}) {
+    points.push_back({100 + p.x * c - p.y * s, 50 + p.x * s + p.y * c});
+  }
+  std::vector<Point> scratch(convex_hull_scratch_size(points.size()));
+  OrientedBox box;
+  min_area_box(points.data(), points.size(), scratch.data(), &box);
+  ASSERT_NEAR(box.length * box.width, 4, 1e-9);
+  ASSERT_NEAR(box.center.x, points[4].x, 1e-9);
+  ASSERT_NEAR(box.center.y, points[4].y, 1e-9);
+  Point corners[4];
+  oriented_box_corners(&box, corners);
+  for (Point corner : corners) {
+    bool found = false;
+    for (unsigned i = 0; i < 4; ++i) {
+      found |= point_equals(corner, points[i]);
+    }
+    ASSERT_TRUE(found);
+  }
+  ASSERT_NEAR(points_width(points.data(), points.size(), scratch.data()), 1,
+              1e-9);
+  Circle circle;
+  min_enclosing_circle(points.data(), points.size(), scratch.data(), &circle);
+  ASSERT_NEAR(circle.radius, sqrt(17) / 2, 1e-9);
+}
+
+TEST(RotatingCalipers, Random) {
+  srand(0);
+  for (unsigned trial = 0; trial < 200; ++trial) {
+    unsigned n = 2 + rand() % (trial < 150 ? 30 : 300);
+    std::vector<Point> points;
+    for (unsigned i = 0; i < n; ++i) {
+      // Some trials on a coarse grid, for repeated and collinear points
+      if (trial % 4 == 0) {
+        points.push_back({(double)(rand() % 6), (double)(rand() % 6)});
+      } else {
+        points.push_back({random_coord(), random_coord()});
+      }
+    }
+    std::vector<Point> scratch(convex_hull_scratch_size(n));
+    std::vector<Point> hull = hull_of(points);
+
+    double farthest = 0;
+    for (Point p : points) {
+      for (Point q : points) {
+        farthest = std::max(farthest, point_distance(p, q));
+      }
+    }
+    unsigned a, b;
+    ASSERT_TRUE(farthest_pair(points.data(), n, scratch.data(), &a, &b));
+    ASSERT_LT(a, b);
+    ASSERT_DOUBLE_EQ(point_distance(points[a], points[b]), farthest);
+
+    std::vector<IndexPair> pairs(3 * hull.size() / 2 + 1);
+    unsigned count = hull_antipodal_pairs(hull.data(), hull.size(),
+                                          pairs.data());
+    ASSERT_LE(count, std::max<unsigned>(1, 3 * hull.size() / 2));
+    std::set<std::pair<unsigned, unsigned>> seen;
+    for (unsigned i = 0; i < count; ++i) {
+      ASSERT_NE(pairs[i].a, pairs[i].b);
+      seen.insert(std::minmax(pairs[i].a, pairs[i].b));
+    }
+    ASSERT_EQ(seen.size(), count);
+
+    double width = INFINITY;
+    for (unsigned i = 0; hull.size() >= 3 && i < hull.size(); ++i) {
+      Point p = hull[i];
+      Point q = hull[(i + 1) % hull.size()];
+      double far = 0;
+      for (Point r : hull) {
+        far = std::max(far, ((q.x - p.x) * (r.y - p.y) -
+                             (q.y - p.y) * (r.x - p.x)) /
+                                point_distance(p, q));
+      }
+      width = std::min(width, far);
+    }
+    ASSERT_NEAR(points_width(points.data(), n, scratch.data()),
+                hull.size() >= 3 ? width : 0, 1e-9);
+
+    OrientedBox box;
+    min_area_box(points.data(), n, scratch.data(), &box);
+    check_box_contains(box, points);
+    if (hull.size() >= 3) {
+      ASSERT_NEAR(box.length * box.width, brute_force_box(hull, false), 1e-6);
+    }
+    min_perimeter_box(points.data(), n, scratch.data(), &box);
+    check_box_contains(box, points);
+    if (hull.size() >= 3) {
+      ASSERT_NEAR(2 * (box.length + box.width), brute_force_box(hull, true),
+                  1e-6);
+    }
+
+    Circle circle;
+    min_enclosing_circle(points.data(), n, scratch.data(), &circle);
+    for (Point p : points) {
+      ASSERT_TRUE(circle_contains(circle, p));
+    }
+    if (n <= 32) {
+      ASSERT_NEAR(circle.radius, brute_force_circle(points), 1e-9);
+    }
+  }
+}
@@ -0,0 +1,455 @@
+#include "geometry/util.h"
+#include "random.h"
+extern "C" {
+#include "geometry/algorithm/segment_intersection.h"
+}
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <vector>
+
+// Small integer coordinates, which produce many shared endpoints, collinear
+// overlaps, vertical segments and concurrent crossings.
+static double random_grid_coord() { return rand() % 9; }
+
+static std::vector<SegmentIntersection> sorted(SegmentIntersection *data,
+                                               unsigned count) {
+  std::vector<SegmentIntersection> result(data, data + count);
+  std::sort(result.begin(), result.end(),
+            [](const SegmentIntersection &l, const SegmentIntersection &r) {
+              return l.a < r.a || (l.a == r.a && l.b < r.b);
+            });
+  free(data);
+  return result;
+}
+
+// Whether computed intersection points agree, to within tolerance on each axis.
+static bool near(Point a, Point b, double tolerance) {
+  return fabs(a.x - b.x) <= tolerance && fabs(a.y - b.y) <= tolerance;
+}
+
+static void test_against_brute_force(const std::vector<Segment> &segments,
+                                     double tolerance = TOLERANCE) {
+  unsigned n = segments.size();
+  unsigned sweep_count;
+  unsigned brute_count;
+  SegmentIntersection *sweep_data =
+      segment_intersections(segments.data(), n, &sweep_count);
+  SegmentIntersection *brute_data =
+      segment_intersections_brute_force(segments.data(), n, &brute_count);
+  std::vector<SegmentIntersection> sweep = sorted(sweep_data, sweep_count);
+  std::vector<SegmentIntersection> brute = sorted(brute_data, brute_count);
+  ASSERT_EQ(sweep.size(), brute.size());
+  for (unsigned i = 0; i < sweep.size(); ++i) {
+    ASSERT_EQ(sweep[i].a, brute[i].a);
+    ASSERT_EQ(sweep[i].b, brute[i].b);
+    ASSERT_TRUE(near(sweep[i].p, brute[i].p, tolerance));
+  }
+}
+
+TEST(SegmentIntersection, Empty) {
+  unsigned count;
+  SegmentIntersection *result = segment_intersections(NULL, 0, &count);
+  ASSERT_EQ(count, 0);
+  free(result);
+}
+
+TEST(SegmentIntersection, Cross) {
+  Segment segments[] = {
+      segment_from_coords(0, 0, 2, 2),
+      segment_from_coords(0, 2, 2, 0),
+      segment_from_coords(3, 0, 3, 1),
+  };
+  unsigned count;
+  SegmentIntersection *result = segment_intersections(segments, 3, &count);
+  ASSERT_EQ(count, 1);
+  ASSERT_EQ(result[0].a, 0);
+  ASSERT_EQ(result[0].b, 1);
+  ASSERT_TRUE(point_equals(result[0].p, (Point{1, 1})));
+  free(result);
+}
+
+TEST(SegmentIntersection, Degenerate) {
+  test_against_brute_force({
+      // Concurrent crossing at (2, 2), including a vertical segment
+      segment_from_coords(0, 0, 4, 4),
+      segment_from_coords(0, 4, 4, 0),
+      segment_from_coords(2, 0, 2, 4),
+      segment_from_coords(0, 2, 4, 2),
+      // Collinear overlap
+      segment_from_coords(5, 5, 8, 8),
+      segment_from_coords(6, 6, 9, 9),
+      // Shared endpoints
+      segment_from_coords(10, 0, 11, 1),
+      segment_from_coords(11, 1, 12, 0),
+      segment_from_coords(11, 1, 11, 5),
+      // Single point segments on and off other segments
+      segment_from_coords(1, 1, 1, 1),
+      segment_from_coords(20, 20, 20, 20),
+      // Overlapping vertical segments
+      segment_from_coords(30, 0, 30, 2),
+      segment_from_coords(30, 1, 30, 3),
+      // Endpoint touching an interior
+      segment_from_coords(40, 0, 44, 0),
+      segment_from_coords(42, 0, 42, 3),
+  });
+}
+
+TEST(SegmentIntersection, Random) {
+  srand(0);
+  for (unsigned trial = 0; trial < 20; ++trial) {
+    std::vector<Segment> segments;
+    for (unsigned i = 0; i < 200; ++i) {
+      segments.push_back(segment_from_coords(random_coord(), random_coord(),
+                                             random_coord(), random_coord()));
+    }
+    test_against_brute_force(segments);
+  }
+}
+
+TEST(SegmentIntersection, RandomGrid) {
+  srand(0);
+  for (unsigned trial = 0; trial < 200; ++trial) {
+    std::vector<Segment> segments;
+    for (unsigned i = 0; i < 30; ++i) {
+      segments.push_back(
+          segment_from_coords(random_grid_coord(), random_grid_coord(),
+                              random_grid_coord(), random_grid_coord()));
+    }
+    test_against_brute_force(segments);
+  }
+}
+
+TEST(SegmentIntersection, ConcurrentCrossings) {
+  // Segments through one point, where the crossings of some pairs round to
+  // either side of a vertical segment or an endpoint at that point
+  test_against_brute_force({segment_from_coords(16, 19, 11, 32),
+                            segment_from_coords(16, 1, 16, 25),
+                            segment_from_coords(26, 19, 3, 19),
+                            segment_from_coords(11, 16, 31, 28)});
+  test_against_brute_force({segment_from_coords(25, 26, 0, 13),
+                            segment_from_coords(0, 21, 29, 16),
+                            segment_from_coords(15, 22, 15, 17),
+                            segment_from_coords(21, 23, 7, 14),
+                            segment_from_coords(19, 22, 16, 23)});
+}
+
+TEST(SegmentIntersection, RandomDecimalGrid) {
+  // Crossings at (0.34, 0.3) of segments on the 0.1 grid, once missed
+  test_against_brute_force({segment_from_coords(0.5, 0.1, 0.2, 0.2),
+                            segment_from_coords(0.4, 0.1, 0, 0.3),
+                            segment_from_coords(0.6, 0.5, 0.1, 0)});
+  srand(0);
+  for (unsigned trial = 0; trial < 4000; ++trial) {
+    std::vector<Segment> segments;
+    for (unsigned i = 0; i < 9; ++i) {
+      segments.push_back(
+          segment_from_coords(random_decimal_coord(), random_decimal_coord(),
+                              random_decimal_coord(), random_decimal_coord()));
+    }
+    test_against_brute_force(segments);
+  }
+}
+
+// Segments through a point that is not representable, so that every pair
+// crosses within rounding of the same point. There are only a dozen angles, so
+// some segments are nearly collinear too.
+static std::vector<Segment> nearly_concurrent_soup(unsigned n) {
+  Point center = {1.0 / 3, 2.0 / 7};
+  std::vector<Segment> segments;
+  for (unsigned i = 0; i < n; ++i) {
+    double angle = rand() % 12 * M_PI / 12;
+    double r0 = 0.1 + (double)rand() / RAND_MAX;
+    double r1 = 0.1 + (double)rand() / RAND_MAX;
+    segments.push_back(segment_from_coords(
+        center.x - r0 * cos(angle), center.y - r0 * sin(angle),
+        center.x + r1 * cos(angle), center.y + r1 * sin(angle)));
+  }
+  return segments;
+}
+
+TEST(SegmentIntersection, NearlyConcurrent) {
+  srand(0);
+  for (unsigned trial = 0; trial < 500; ++trial) {
+    test_against_brute_force(nearly_concurrent_soup(2 + rand() % 12));
+  }
+}
+
+// Reference for segments_any_intersection: brute force, minus pairs that only
+// touch at a shared endpoint.
+static bool any_intersection_brute_force(const std::vector<Segment> &segments,
+                                         bool ignore_shared_endpoints) {
+  unsigned count;
+  SegmentIntersection *pairs = segment_intersections_brute_force(
+      segments.data(), segments.size(), &count);
+  bool found = false;
+  for (unsigned i = 0; i < count && !found; ++i) {
+    Segment a = segments[pairs[i].a];
+    Segment b = segments[pairs[i].b];
+    Point ends_a[] = {a.p0, a.p1};
+    Point ends_b[] = {b.p0, b.p1};
+    bool touch = false;
+    for (unsigned j = 0; j < 2; ++j) {
+      for (unsigned k = 0; k < 2; ++k) {
+        if (ends_a[j].x == ends_b[k].x && ends_a[j].y == ends_b[k].y) {
+          double dax = ends_a[1 - j].x - ends_a[j].x;
+          double day = ends_a[1 - j].y - ends_a[j].y;
+          double dbx = ends_b[1 - k].x - ends_b[k].x;
+          double dby = ends_b[1 - k].y - ends_b[k].y;
+          touch = dax * dby - day * dbx != 0 || dax * dbx + day * dby <= 0;
+        }
+      }
+    }
+    found = !(ignore_shared_endpoints && touch);
+  }
+  free(pairs);
+  return found;
+}
+
+static void test_any_intersection(const std::vector<Segment> &segments,
+                                  bool ignore_shared_endpoints) {
+  SegmentIntersection pair;
+  bool found = segments_any_intersection(segments.data(), segments.size(),
+                                         ignore_shared_endpoints, &pair);
+  ASSERT_EQ(found,
+            any_intersection_brute_force(segments, ignore_shared_endpoints));
+  if (found) {
+    ASSERT_LT(pair.a, pair.b);
+    ASSERT_TRUE(any_intersection_brute_force(
+        {segments[pair.a], segments[pair.b]}, ignore_shared_endpoints));
+  }
+}
+
+// Edges of the polygon through the given points, closing back to the first.
+static std::vector<Segment> ring(const std::vector<Point> &points) {
+  std::vector<Segment> edges;
+  for (unsigned i = 0; i < points.size(); ++i) {
+    Point p0 = points[i];
+    Point p1 = points[(i + 1) % points.size()];
+    edges.push_back(segment_from_coords(p0.x, p0.y, p1.x, p1.y));
+  }
+  return edges;
+}
+
+TEST(SegmentIntersection, AnyIntersectionRing) {
+  std::vector<Segment> square = ring({{0, 0}, {2, 0}, {2, 2}, {0, 2}});
+  ASSERT_TRUE(segments_any_intersection(square.data(), square.size(), false,
+                                        NULL));
+  ASSERT_FALSE(segments_any_intersection(square.data(), square.size(), true,
+                                         NULL));
+
+  SegmentIntersection pair;
+  std::vector<Segment> bowtie = ring({{0, 0}, {2, 2}, {2, 0}, {0, 2}});
+  ASSERT_TRUE(segments_any_intersection(bowtie.data(), bowtie.size(), true,
+                                        &pair));
+  ASSERT_EQ(pair.a, 0);
+  ASSERT_EQ(pair.b, 2);
+  ASSERT_TRUE(point_equals(pair.p, (Point){1, 1}));
+
+  // Consecutive edges that fold back over each other
+  std::vector<Segment> spike = ring({{0, 0}, {4, 0}, {2, 0}, {2, 2}});
+  ASSERT_TRUE(segments_any_intersection(spike.data(), spike.size(), true,
+                                        &pair));
+  ASSERT_EQ(pair.a, 0);
+  ASSERT_EQ(pair.b, 1);
+
+  // A vertex touching another edge
+  std::vector<Segment> touching =
+      ring({{0, 0}, {4, 0}, {4, 4}, {2, 0}, {0, 4}});
+  ASSERT_TRUE(segments_any_intersection(touching.data(), touching.size(), true,
+                                        NULL));
+}
+
+TEST(SegmentIntersection, AnyIntersectionStarPolygon) {
+  // Vertices sorted by angle around the origin form a simple polygon
+  srand(0);
+  std::vector<Point> points;
+  for (unsigned i = 0; i < 1000; ++i) {
+    double angle = 2 * M_PI * i / 1000;
+    double radius = 10 + (double)rand() / RAND_MAX * 90;
+    points.push_back({radius * cos(angle), radius * sin(angle)});
+  }
+  std::vector<Segment> edges = ring(points);
+  ASSERT_FALSE(
+      segments_any_intersection(edges.data(), edges.size(), true, NULL));
+
+  std::swap(points[100], points[600]);
+  edges = ring(points);
+  test_any_intersection(edges, true);
+  ASSERT_TRUE(
+      segments_any_intersection(edges.data(), edges.size(), true, NULL));
+}
+
+TEST(SegmentIntersection, AnyIntersectionRandom) {
+  srand(0);
+  for (unsigned trial = 0; trial < 500; ++trial) {
+    std::vector<Segment> segments;
+    unsigned n = 2 + rand() % 10;
+    for (unsigned i = 0; i < n; ++i) {
+      segments.push_back(segment_from_coords(random_coord(), random_coord(),
+                                             random_coord(), random_coord()));
+    }
+    test_any_intersection(segments, false);
+  }
+}
+
+TEST(SegmentIntersection, AnyIntersectionRandomGrid) {
+  srand(0);
+  for (unsigned trial = 0; trial < 2000; ++trial) {
+    std::vector<Segment> segments;
+    unsigned n = 2 + rand() % 6;
+    for (unsigned i = 0; i < n; ++i) {
+      segments.push_back(
+          segment_from_coords(random_grid_coord(), random_grid_coord(),
+                              random_grid_coord(), random_grid_coord()));
+    }
+    test_any_intersection(segments, false);
+    test_any_intersection(segments, true);
+  }
+}
+
+static void test_parallel(const std::vector<Segment> &segments,
+                          unsigned num_threads, double tolerance = TOLERANCE) {
+  unsigned n = segments.size();
+  unsigned parallel_count;
+  unsigned brute_count;
+  SegmentIntersection *parallel_data = segment_intersections_parallel(
+      segments.data(), n, num_threads, &parallel_count);
+  SegmentIntersection *brute_data =
+      segment_intersections_brute_force(segments.data(), n, &brute_count);
+  std::vector<SegmentIntersection> parallel =
+      sorted(parallel_data, parallel_count);
+  std::vector<SegmentIntersection> brute = sorted(brute_data, brute_count);
+  ASSERT_EQ(parallel.size(), brute.size()) << num_threads << " threads";
+  for (unsigned i = 0; i < parallel.size(); ++i) {
+    ASSERT_EQ(parallel[i].a, brute[i].a);
+    ASSERT_EQ(parallel[i].b, brute[i].b);
+    ASSERT_TRUE(near(parallel[i].p, brute[i].p, tolerance));
+  }
+}
+
+TEST(SegmentIntersection, ParallelRandom) {
+  srand(0);
+  std::vector<Segment> segments;
+  for (unsigned i = 0; i < 500; ++i) {
+    segments.push_back(segment_from_coords(random_coord(), random_coord(),
+                                           random_coord(), random_coord()));
+  }
+  for (unsigned threads : {1, 2, 3, 8, 64}) {
+    test_parallel(segments, threads);
+  }
+  test_parallel({}, 4);
+  test_parallel({segments[0], segments[1]}, 4);
+}
+
+TEST(SegmentIntersection, ParallelRandomGrid) {
+  srand(0);
+  for (unsigned trial = 0; trial < 50; ++trial) {
+    std::vector<Segment> segments;
+    for (unsigned i = 0; i < 30; ++i) {
+      segments.push_back(
+          segment_from_coords(random_grid_coord(), random_grid_coord(),
+                              random_grid_coord(), random_grid_coord()));
+    }
+    for (unsigned threads : {2, 5}) {
+      test_parallel(segments, threads);
+    }
+  }
+}
+
+TEST(SegmentIntersection, ParallelRandomDecimalGrid) {
+  srand(0);
+  for (unsigned trial = 0; trial < 500; ++trial) {
+    std::vector<Segment> segments;
+    for (unsigned i = 0; i < 12; ++i) {
+      segments.push_back(
+          segment_from_coords(random_decimal_coord(), random_decimal_coord(),
+                              random_decimal_coord(), random_decimal_coord()));
+    }
+    for (unsigned threads : {2, 3, 8}) {
+      test_parallel(segments, threads);
+    }
+  }
+}
+
+TEST(SegmentIntersection, ParallelNearlyConcurrent) {
+  srand(0);
+  for (unsigned trial = 0; trial < 200; ++trial) {
+    std::vector<Segment> segments = nearly_concurrent_soup(2 + rand() % 12);
+    // A strip edge through the rounded center, next to all the crossings
+    segments.push_back(segment_from_coords(1.0 / 3, 0, 1.0 / 3, 1));
+    for (unsigned threads : {2, 3, 8, 64}) {
+      test_parallel(segments, threads);
+    }
+  }
+}
+
+// Random and grid soups scaled far below and above TOLERANCE, which the sweeps
+// must handle the same at every scale. Grid soups are scaled by powers of two,
+// so their shared endpoints, overlaps and concurrent crossings stay exact.
+static std::vector<Segment> scaled_soup(unsigned n, double scale, bool grid) {
+  std::vector<Segment> segments;
+  for (unsigned i = 0; i < n; ++i) {
+    if (grid) {
+      segments.push_back(segment_from_coords(
+          random_grid_coord() * scale, random_grid_coord() * scale,
+          random_grid_coord() * scale, random_grid_coord() * scale));
+    } else {
+      segments.push_back(segment_from_coords(
+          random_coord() * scale, random_coord() * scale,
+          random_coord() * scale, random_coord() * scale));
+    }
+  }
+  return segments;
+}
+
+TEST(SegmentIntersection, Scaled) {
+  for (double scale : {1e-9, 1e-5, 1e-3, 1e6, 1e14, 1e20}) {
+    srand(0);
+    for (unsigned trial = 0; trial < 5; ++trial) {
+      std::vector<Segment> segments = scaled_soup(100, scale, false);
+      test_against_brute_force(segments, scale * 1e-9);
+      for (unsigned threads : {1, 3}) {
+        test_parallel(segments, threads, scale * 1e-9);
+      }
+    }
+  }
+  for (double scale : {0x1p-40, 0x1p-20, 0x1p40, 0x1p70}) {
+    srand(0);
+    for (unsigned trial = 0; trial < 50; ++trial) {
+      std::vector<Segment> segments = scaled_soup(30, scale, true);
+      test_against_brute_force(segments, scale * 1e-9);
+      test_parallel(segments, 4, scale * 1e-9);
+    }
+  }
+}
+
+TEST(SegmentIntersection, AnyIntersectionScaled) {
+  for (double scale : {1e-9, 1e-5, 1e14, 1e20}) {
+    srand(0);
+    for (unsigned trial = 0; trial < 200; ++trial) {
+      test_any_intersection(scaled_soup(2 + rand() % 10, scale, false), false);
+    }
+    // A small polygon
+    std::vector<Point> points;
+    for (unsigned i = 0; i < 100; ++i) {
+      double angle = 2 * M_PI * i / 100;
+      double radius = scale * (10 + (double)rand() / RAND_MAX * 90);
+      points.push_back({radius * cos(angle), radius * sin(angle)});
+    }
+    std::vector<Segment> edges = ring(points);
+    ASSERT_FALSE(
+        segments_any_intersection(edges.data(), edges.size(), true, NULL));
+    std::swap(points[10], points[60]);
+    edges = ring(points);
+    ASSERT_TRUE(
+        segments_any_intersection(edges.data(), edges.size(), true, NULL));
+  }
+  for (double scale : {0x1p-40, 0x1p70}) {
+    srand(0);
+    for (unsigned trial = 0; trial < 1000; ++trial) {
+      std::vector<Segment> segments = scaled_soup(2 + rand() % 6, scale, true);
+      test_any_intersection(segments, false);
+      test_any_intersection(segments, true);
+    }
+  }
+}
@@ -0,0 +1,308 @@
+#include "geometry/util.h"
+#include "random.h"
+extern "C" {
+#include "geometry/algorithm/voronoi.h"
+}
+#include <climits>
+#include <gtest/gtest.h>
+#include <vector>
+
+static const BBox BOX = {.min_x = -100, .min_y = -100, .max_x = 100,
+                         .max_y = 100};
+
+static double squared_distance(Point a, Point b) {
+  return (a.x - b.x) * (a.x - b.x) + (a.y - b.y) * (a.y - b.y);
+}
+
+// The nearest site to p, the lowest index among duplicates.
+static unsigned nearest_site(const std::vector<Point> &sites, Point p) {
+  unsigned best = 0;
+  for (unsigned i = 1; i < sites.size(); ++i) {
+    if (squared_distance(sites[i], p) < squared_distance(sites[best], p)) {
+      best = i;
+    }
+  }
+  return best;
+}
+
+// Whether p is inside the convex polygon, up to tolerance.
+static bool polygon_contains(const std::vector<Point> &polygon, Point p,
+                             double tolerance) {
+  if (polygon.empty()) {
+    return false;
+  }
+  for (unsigned i = 0; i < polygon.size(); ++i) {
+    Point a = polygon[i];
+    Point b = polygon[(i + 1) % polygon.size()];
+    double side = (b.x - a.x) * (p.y - a.y) - (b.y - a.y) * (p.x - a.x);
+    if (side < -tolerance) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static std::vector<Point> cell_polygon(const VoronoiDiagram &d, unsigned s) {
+  std::vector<Point> polygon;
+  unsigned edge = d.cells[s];
+  do {
+    polygon.push_back(d.vertices[d.edges[edge].origin]);
+    edge = d.edges[edge].next;
+  } while (edge != d.cells[s]);
+  return polygon;
+}
+
+// Checks the structure, that cells are convex, that their vertices are no
+// closer to another site, that the cells tile the box, and that random points
+// are in the cell of their nearest site, or of one as near up to rounding.
+static void check_diagram(const std::vector<Point> &sites, BBox box,
+                          const VoronoiDiagram &d) {
+  voronoi_diagram_validate(&d);
+  ASSERT_EQ(d.num_sites, sites.size());
+  double scale = box.max_x - box.min_x + box.max_y - box.min_y;
+  double eps = 1e-9 * scale;
+  double total = 0;
+  std::vector<std::vector<Point>> polygons(sites.size());
+  for (unsigned s = 0; s < sites.size(); ++s) {
+    if (d.cells[s] == UINT_MAX) {
+      continue;
+    }
+    std::vector<Point> &polygon = polygons[s];
+    polygon = cell_polygon(d, s);
+    // Relative to the corner of the box, so a small box far from the origin
+    // does not cancel
+    double area = 0;
+    for (unsigned i = 0; i < polygon.size(); ++i) {
+      Point a = polygon[i];
+      Point b = polygon[(i + 1) % polygon.size()];
+      Point c = polygon[(i + 2) % polygon.size()];
+      area += (a.x - box.min_x) * (b.y - box.min_y) -
+              (b.x - box.min_x) * (a.y - box.min_y);
+      double turn = (b.x - a.x) * (c.y - b.y) - (b.y - a.y) * (c.x - b.x);
+      ASSERT_GE(turn, -eps * scale);
+      ASSERT_TRUE(bbox_contains_point(
+          {box.min_x - eps, box.min_y - eps, box.max_x + eps, box.max_y + eps},
+          a));
+      double own = sqrt(squared_distance(a, sites[s]));
+      double best = sqrt(squared_distance(a, sites[nearest_site(sites, a)]));
+      ASSERT_LE(own, best + eps);
+    }
+    ASSERT_GE(area, -eps * scale);
+    total += area / 2;
+  }
+  double box_area = (box.max_x - box.min_x) * (box.max_y - box.min_y);
+  ASSERT_NEAR(total, box_area, 1e-9 * box_area);
+
+  for (unsigned k = 0; k < 200; ++k) {
+    Point p = {box.min_x + (double)rand() / RAND_MAX * (box.max_x - box.min_x),
+               box.min_y + (double)rand() / RAND_MAX * (box.max_y - box.min_y)};
+    double best = sqrt(squared_distance(p, sites[nearest_site(sites, p)]));
+    bool found = false;
+    for (unsigned s = 0; s < sites.size() && !found; ++s) {
+      found = sqrt(squared_distance(p, sites[s])) <= best + eps &&
+              polygon_contains(polygons[s], p, eps * scale);
+    }
+    ASSERT_TRUE(found);
+  }
+}
+
+// Appends copies of n random sites, which have no cell of their own.
+static void add_duplicates(std::vector<Point> &sites, unsigned n) {
+  unsigned size = sites.size();
+  for (unsigned i = 0; i < n; ++i) {
+    sites.push_back(sites[rand() % size]);
+  }
+}
+
+static void test_voronoi(const std::vector<Point> &sites, BBox box = BOX) {
+  VoronoiDiagram d;
+  voronoi_diagram(sites.data(), sites.size(), box, &d);
+  check_diagram(sites, box, d);
+  voronoi_diagram_free(&d);
+}
+
+TEST(Voronoi, Small) {
+  VoronoiDiagram d;
+  voronoi_diagram(nullptr, 0, BOX, &d);
+  ASSERT_EQ(d.num_edges, 0);
+  voronoi_diagram_free(&d);
+
+  // One site owns the whole box
+  std::vector<Point> sites = {{5, 5}};
+  voronoi_diagram(sites.data(), sites.size(), BOX, &d);
+  ASSERT_EQ(d.num_edges, 4);
+  check_diagram(sites, BOX, d);
+  voronoi_diagram_free(&d);
+
+  test_voronoi({{0, 0}, {10, 0}});
+  test_voronoi({{0, 0}, {0, 10}});
+  test_voronoi({{0, 0}, {10, 10}});
+  test_voronoi({{0, 0}, {10, 0}, {5, 8}});
+  test_voronoi({{0, 0}, {10, 0}, {5, -8}});
+}
+
+TEST(Voronoi, Random) {
+  srand(0);
+  for (unsigned n : {3, 10, 50, 300}) {
+    std::vector<Point> sites;
+    for (unsigned i = 0; i < n; ++i) {
+      sites.push_back({random_coord(), random_coord()});
+    }
+    test_voronoi(sites);
+  }
+}
+
+TEST(Voronoi, Degenerate) {
+  // Cocircular sites on a grid, and rows and columns of collinear sites
+  std::vector<Point> sites;
+  for (int x = -4; x <= 4; ++x) {
+    for (int y = -4; y <= 4; ++y) {
+      sites.push_back({x * 20.0, y * 20.0});
+    }
+  }
+  test_voronoi(sites);
+  sites.clear();
+  for (int x = -4; x <= 4; ++x) {
+    sites.push_back({x * 20.0 + 3, 7});
+  }
+  test_voronoi(sites);
+  sites.clear();
+  for (int y = -4; y <= 4; ++y) {
+    sites.push_back({-3, y * 20.0 + 1});
+  }
+  test_voronoi(sites);
+
+  // A bottom row followed by other sites
+  sites = {{-50, -90}, {0, -90}, {50, -90}, {-20, 0}, {30, 40}, {0, -60}};
+  test_voronoi(sites);
+
+  // Duplicates have no cell of their own
+  sites = {{0, 0}, {10, 10}, {0, 0}, {-20, 5}, {10, 10}};
+  VoronoiDiagram d;
+  voronoi_diagram(sites.data(), sites.size(), BOX, &d);
+  check_diagram(sites, BOX, d);
+  ASSERT_NE(d.cells[0], UINT_MAX);
+  ASSERT_NE(d.cells[1], UINT_MAX);
+  ASSERT_EQ(d.cells[2], UINT_MAX);
+  ASSERT_EQ(d.cells[4], UINT_MAX);
+  voronoi_diagram_free(&d);
+}
+
+TEST(Voronoi, NearlyCoincident) {
+  // Two sites an ulp from the same height, whose breakpoint is far away
+  test_voronoi({{-5, 8}, {-5, -8 + 1e-15}, {5, -8}},
+               {.min_x = -15, .min_y = -15, .max_x = 15, .max_y = 15});
+  // A site on top of circles through sites ulps from cocircular
+  test_voronoi({{-30, 10.000000000000002},
+                {0, 5},
+                {0, 15},
+                {-40, 10},
+                {0, 14.999999999999998},
+                {5, 10},
+                {-35, 5}});
+  // A bisector within rounding of a corner of the box
+  test_voronoi({{15, -10}, {10, -14.999999999999998}},
+               {.min_x = 11, .min_y = -11, .max_x = 11.1, .max_y = -10.8});
+}
+
+TEST(Voronoi, RegularPolygons) {
+  // Cocircular up to rounding, with the center, a smaller polygon inside,
+  // and duplicates
+  srand(4);
+  for (unsigned i = 0; i < 50; ++i) {
+    std::vector<Point> sites;
+    Point center = {(double)(rand() % 21 - 10), (double)(rand() % 21 - 10)};
+    double radius = 1 + rand() % 80;
+    for (unsigned n : {3 + rand() % 100, rand() % 2 * (3 + rand() % 30)}) {
+      for (unsigned j = 0; j < n; ++j) {
+        double angle = 2 * M_PI * j / n;
+        sites.push_back({center.x + radius * cos(angle),
+                         center.y + radius * sin(angle)});
+      }
+      radius /= 2;
+    }
+    if (rand() % 2) {
+      sites.push_back(center);
+    }
+    add_duplicates(sites, rand() % 10);
+    test_voronoi(sites);
+  }
+}
+
+TEST(Voronoi, PerturbedGrid) {
+  // Grid points, some moved by an ulp, so that many sites are nearly
+  // cocircular or in a row, seen in the whole box and in small ones. Zero
+  // stays put, as an ulp from it is subnormal.
+  srand(5);
+  for (unsigned i = 0; i < 50; ++i) {
+    std::vector<Point> sites;
+    unsigned n = 20 + rand() % 200;
+    for (unsigned j = 0; j < n; ++j) {
+      Point p = {(double)(rand() % 21 - 10) * 5,
+                 (double)(rand() % 21 - 10) * 5};
+      if (rand() % 3 == 0 && p.y != 0) {
+        p.y = nextafter(p.y, rand() % 2 ? INFINITY : -INFINITY);
+      }
+      if (rand() % 5 == 0 && p.x != 0) {
+        p.x = nextafter(p.x, rand() % 2 ? INFINITY : -INFINITY);
+      }
+      sites.push_back(p);
+    }
+    add_duplicates(sites, rand() % 10);
+    test_voronoi(sites);
+    double x = rand() % 40 - 20;
+    double y = rand() % 40 - 20;
+    double size = pow(10, -(rand() % 4));
+    test_voronoi(sites, {.min_x = x,
+                         .min_y = y,
+                         .max_x = x + size,
+                         .max_y = y + 2 * size});
+  }
+}
+
+TEST(Voronoi, SitesOutsideBox) {
+  srand(1);
+  std::vector<Point> sites;
+  for (unsigned i = 0; i < 100; ++i) {
+    sites.push_back({random_coord() * 3, random_coord() * 3});
+  }
+  test_voronoi(sites);
+
+  // A box inside a single cell, and one in the corner of a few
+  test_voronoi(sites, {.min_x = 1, .min_y = 1, .max_x = 1.001, .max_y = 1.001});
+  test_voronoi({{0, 0}, {10, 0}, {0, 10}},
+               {.min_x = 4, .min_y = 4, .max_x = 6, .max_y = 6});
+}
+
+TEST(Voronoi, Integer) {
+  // Many sites sharing rows and columns, and many cocircular
+  srand(2);
+  std::vector<Point> sites;
+  for (unsigned i = 0; i < 300; ++i) {
+    sites.push_back(
+        {(double)(rand() % 21 - 10) * 9, (double)(rand() % 21 - 10) * 9});
+  }
+  test_voronoi(sites);
+}
+
+TEST(Voronoi, Large) {
+  srand(3);
+  std::vector<Point> sites;
+  for (unsigned i = 0; i < 20000; ++i) {
+    sites.push_back({random_coord(), random_coord()});
+  }
+  VoronoiDiagram d;
+  voronoi_diagram(sites.data(), sites.size(), BOX, &d);
+  voronoi_diagram_validate(&d);
+  double total = 0;
+  for (unsigned s = 0; s < sites.size(); ++s) {
+    std::vector<Point> polygon = cell_polygon(d, s);
+    for (unsigned i = 0; i < polygon.size(); ++i) {
+      Point a = polygon[i];
+      Point b = polygon[(i + 1) % polygon.size()];
+      total += (a.x * b.y - b.x * a.y) / 2;
+    }
+  }
+  ASSERT_NEAR(total, 200.0 * 200.0, 1e-6);
+  voronoi_diagram_free(&d);
+}
@@ -0,0 +1,314 @@
+#include "geometry/util.h"
+extern "C" {
+#include "geometry/predicates.h"
+}
+#include <gtest/gtest.h>
+#include <vector>
+
+static const double ULP = 0x1p-53;
+
+static int sign(double x) { return (x > 0) - (x < 0); }
+
+// Exact orientation of points whose coordinates are multiples of 2^-53 below
+// 32, in integer arithmetic.
+static int exact_orientation(Point a, Point b, Point c) {
+  __int128 ax = (__int128)(a.x / ULP), ay = (__int128)(a.y / ULP);
+  __int128 bx = (__int128)(b.x / ULP), by = (__int128)(b.y / ULP);
+  __int128 cx = (__int128)(c.x / ULP), cy = (__int128)(c.y / ULP);
+  __int128 det = (ax - cx) * (by - cy) - (ay - cy) * (bx - cx);
+  return (det > 0) - (det < 0);
+}
+
+// Checks that the sign is consistent under permutations of the points.
+static void test_orientation(Point a, Point b, Point c, int expected) {
+  ASSERT_EQ(sign(orient2d(a, b, c)), expected);
+  ASSERT_EQ(sign(orient2d(b, c, a)), expected);
+  ASSERT_EQ(sign(orient2d(c, a, b)), expected);
+  ASSERT_EQ(sign(orient2d(b, a, c)), -expected);
+  ASSERT_EQ(sign(orient2d(a, c, b)), -expected);
+}
+
+static void test_incircle(Point a, Point b, Point c, Point d, int expected) {
+  ASSERT_EQ(sign(incircle(a, b, c, d)), expected);
+  ASSERT_EQ(sign(incircle(b, c, a, d)), expected);
+  ASSERT_EQ(sign(incircle(c, a, b, d)), expected);
+  ASSERT_EQ(sign(incircle(b, a, c, d)), -expected);
+}
+
+TEST(Predicates, Orient2dSimple) {
+  test_orientation({0, 0}, {1, 0}, {0, 1}, 1);
+  test_orientation({0, 0}, {1, 0}, {0, -1}, -1);
+  test_orientation({0, 0}, {1, 1}, {3, 3}, 0);
+  test_orientation({1, 1}, {1, 1}, {5, -2}, 0);
+  ASSERT_EQ(orient2d({0, 0}, {2, 0}, {0, 3}), 6);
+}
+
+// Points within a few ulps of the line y = x, where the naive determinant
+// gets the sign wrong for many of them.
+TEST(Predicates, Orient2dNearlyCollinear) {
+  Point b = {12, 12};
+  Point c = {24, 24};
+  unsigned naive_wrong = 0;
+  for (int i = 0; i < 64; ++i) {
+    for (int j = 0; j < 64; ++j) {
+      Point a = {0.5 + i * ULP, 0.5 + j * ULP};
+      int expected = exact_orientation(a, b, c);
+      test_orientation(a, b, c, expected);
+      double naive = (a.x - c.x) * (b.y - c.y) - (a.y - c.y) * (b.x - c.x);
+      naive_wrong += sign(naive) != expected;
+    }
+  }
+  ASSERT_GT(naive_wrong, 0);
+}
+
+TEST(Predicates, Orient2dRandom) {
+  srand(0);
+  for (unsigned i = 0; i < 10000; ++i) {
+    Point p[3];
+    for (Point &q : p) {
+      // Multiples of 2^-53 below 32
+      q = {(double)(rand() % 4096) / 128 + (rand() % 16) * ULP,
+           (double)(rand() % 4096) / 128 + (rand() % 16) * ULP};
+    }
+    // Nearly collinear, by moving the last point onto the line through the
+    // first two and rounding it back to a multiple of 2^-53
+    if (i % 2) {
+      double t = (double)(rand() % 64) / 64;
+      p[2].x = round((p[0].x + t * (p[1].x - p[0].x)) / ULP) * ULP;
+      p[2].y = round((p[0].y + t * (p[1].y - p[0].y)) / ULP) * ULP;
+    }
+    test_orientation(p[0], p[1], p[2], exact_orientation(p[0], p[1], p[2]));
+  }
+}
+
+TEST(Predicates, IncircleSimple) {
+  Point a = {1, 0};
+  Point b = {0, 1};
+  Point c = {-1, 0};
+  test_incircle(a, b, c, {0, 0}, 1);
+  test_incircle(a, b, c, {0.5, -0.5}, 1);
+  test_incircle(a, b, c, {2, 2}, -1);
+  test_incircle(a, b, c, {0, -1}, 0);
+  test_incircle(a, b, c, a, 0);
+}
+
+// Points on or within an ulp of the circle, which the floating point
+// determinant cannot tell apart.
+TEST(Predicates, IncircleNearlyCocircular) {
+  // Far from the origin, where the differences are exact
+  double center = 0x1p20;
+  Point a = {center + 1, center};
+  Point b = {center, center + 1};
+  Point c = {center - 1, center};
+  test_incircle(a, b, c, {center, center - 1}, 0);
+  test_incircle(a, b, c, {center, nextafter(center - 1, 0)}, -1);
+  test_incircle(a, b, c, {center, nextafter(center - 1, INFINITY)}, 1);
+
+  // Tiny offsets, where the differences are rounded
+  Point unit_a = {1, 0};
+  Point unit_b = {0, 1};
+  Point unit_c = {-1, 0};
+  test_incircle(unit_a, unit_b, unit_c, {0x1p-60, -1}, -1);
+  test_incircle(unit_a, unit_b, unit_c, {0x1p-60, -1 + ULP}, 1);
+  test_incircle(unit_a, unit_b, unit_c, {-0x1p-60, 1}, -1);
+}
+
+// Rotating the triangle keeps the sign of incircle and flipping it negates
+// the sign.
+TEST(Predicates, IncircleSymmetric) {
+  srand(1);
+  for (unsigned i = 0; i < 2000; ++i) {
+    Point p[4];
+    for (Point &q : p) {
+      q = {(double)rand() / RAND_MAX, (double)rand() / RAND_MAX};
+    }
+    if (orient2d(p[0], p[1], p[2]) < 0) {
+      std::swap(p[0], p[1]);
+    }
+    double d = incircle(p[0], p[1], p[2], p[3]);
+    ASSERT_EQ(sign(incircle(p[1], p[2], p[0], p[3])), sign(d));
+    ASSERT_EQ(sign(incircle(p[1], p[0], p[2], p[3])), -sign(d));
+  }
+}
+
+// A random multiple of 2^-10, up to 2^20 away from the origin.
+static double random_lattice_coord() {
+  double scale = rand() % 2 ? 0x1p20 : 100;
+  return round(((double)rand() / RAND_MAX * 2 - 1) * scale * 1024) / 1024;
+}
+
+// The twelve points of the circle of radius 5k around center at integer
+// multiples of k from it, counterclockwise from the bottom.
+static std::vector<Point> lattice_circle(Point center, double k) {
+  static const int OFFSETS[12][2] = {{0, -5}, {3, -4}, {4, -3},  {5, 0},
+                                     {4, 3},  {3, 4},  {0, 5},   {-3, 4},
+                                     {-4, 3}, {-5, 0}, {-4, -3}, {-3, -4}};
+  std::vector<Point> points;
+  for (const int *o : OFFSETS) {
+    points.push_back({center.x + o[0] * k, center.y + o[1] * k});
+  }
+  return points;
+}
+
+// Circles touching the line at p are the same through points of one lattice
+// circle, and grow with it.
+TEST(Predicates, TangentCircleCompare) {
+  srand(3);
+  for (unsigned i = 0; i < 2000; ++i) {
+    Point p = {random_lattice_coord(), random_lattice_coord()};
+    double k = (1 + rand() % 1024) / 1024.0;
+    std::vector<Point> small = lattice_circle({p.x, p.y - 5 * k}, k);
+    std::vector<Point> large = lattice_circle({p.x, p.y - 10 * k}, 2 * k);
+    // The top of each is p itself
+    Point a = small[rand() % 12];
+    Point b = small[rand() % 12];
+    if (a.y == p.y || b.y == p.y) {
+      continue;
+    }
+    ASSERT_EQ(sign(tangent_circle_compare(a, b, p)), 0);
+    Point c = large[rand() % 12];
+    if (c.y != p.y) {
+      ASSERT_EQ(sign(tangent_circle_compare(a, c, p)), -1);
+      ASSERT_EQ(sign(tangent_circle_compare(c, a, p)), 1);
+    }
+    // An ulp further from the line at the bottom makes the circle larger
+    Point bottom = small[0];
+    Point lower = {bottom.x, nextafter(bottom.y, -INFINITY)};
+    Point higher = {bottom.x, nextafter(bottom.y, INFINITY)};
+    ASSERT_EQ(sign(tangent_circle_compare(lower, a, p)), 1);
+    ASSERT_EQ(sign(tangent_circle_compare(higher, a, p)), -1);
+    ASSERT_EQ(sign(tangent_circle_compare({p.x + k, p.y}, a, p)), 1);
+  }
+}
+
+// The top of a lattice circle is exact, so the line through it and an ulp
+// either side of it are each decided.
+TEST(Predicates, CircleTopCompare) {
+  srand(4);
+  for (unsigned i = 0; i < 2000; ++i) {
+    Point center = {random_lattice_coord(), random_lattice_coord()};
+    double k = (1 + rand() % 1024) / 1024.0;
+    std::vector<Point> circle = lattice_circle(center, k);
+    unsigned a = rand() % 10;
+    unsigned b = a + 1 + rand() % (10 - a);
+    unsigned c = b + 1 + rand() % (11 - b);
+    double top = center.y + 5 * k;
+    Point pa = circle[a];
+    Point pb = circle[b];
+    Point pc = circle[c];
+    ASSERT_EQ(sign(circle_top_compare(pa, pb, pc, top)), 0);
+    ASSERT_EQ(sign(circle_top_compare(pb, pc, pa, top)), 0);
+    double above = nextafter(top, INFINITY);
+    double below = nextafter(top, -INFINITY);
+    ASSERT_EQ(sign(circle_top_compare(pa, pb, pc, above)), -1);
+    ASSERT_EQ(sign(circle_top_compare(pa, pb, pc, below)), 1);
+    ASSERT_EQ(sign(circle_top_compare(pa, pb, pc, center.y)), 1);
+    ASSERT_EQ(sign(circle_top_compare(pa, pb, pc, top + k)), -1);
+  }
+}
+
+// Each sign of direction_cross, for directions a few ulps from parallel.
+TEST(Predicates, DirectionCrossNearlyParallel) {
+  Point b = {12, 12};
+  Point c = {24, 24};
+  for (int i = 0; i < 64; ++i) {
+    for (int j = 0; j < 64; ++j) {
+      Point a = {0.5 + i * ULP, 0.5 + j * ULP};
+      // Both directions leave b, so their cross product is orient2d(a, b, c)
+      ASSERT_EQ(sign(direction_cross({a, b}, {b, c})),
+                exact_orientation(a, b, c));
+    }
+  }
+}
+
+// Homogeneous coordinates of a point, with w > 0.
+struct Rational {
+  __int128 x;
+  __int128 y;
+  __int128 w;
+};
+
+// Small integers offset by 2^24, where the rounded crossings are off by more
+// than nearby crossings are apart, and on a grid coarse enough that many
+// crossings coincide exactly. Exact values are relative to the offset, which
+// moves every point alike.
+static const double OFFSET = 0x1p24;
+
+static __int128 grid_units(double v) { return (__int128)(v - OFFSET); }
+
+static Point random_grid_point(bool coarse) {
+  int x = coarse ? rand() % 9 * 8 : rand() % 64;
+  int y = coarse ? rand() % 9 * 8 : rand() % 64;
+  return {OFFSET + x, OFFSET + y};
+}
+
+static Rational exact_point(Point p) {
+  return {grid_units(p.x), grid_units(p.y), 1};
+}
+
+static Rational exact_crossing(Segment s, Segment t) {
+  __int128 dx = grid_units(s.p1.x) - grid_units(s.p0.x);
+  __int128 dy = grid_units(s.p1.y) - grid_units(s.p0.y);
+  __int128 ex = grid_units(t.p1.x) - grid_units(t.p0.x);
+  __int128 ey = grid_units(t.p1.y) - grid_units(t.p0.y);
+  __int128 wx = grid_units(t.p0.x) - grid_units(s.p0.x);
+  __int128 wy = grid_units(t.p0.y) - grid_units(s.p0.y);
+  __int128 d = dx * ey - dy * ex;
+  __int128 n = wx * ey - wy * ex;
+  Rational r = {grid_units(s.p0.x) * d + dx * n,
+                grid_units(s.p0.y) * d + dy * n, d};
+  return d < 0 ? Rational{-r.x, -r.y, -r.w} : r;
+}
+
+static int exact_compare(Rational a, Rational b) {
+  __int128 x = a.x * b.w - b.x * a.w;
+  if (x != 0) {
+    return x > 0 ? 1 : -1;
+  }
+  __int128 y = a.y * b.w - b.y * a.w;
+  return (y > 0) - (y < 0);
+}
+
+static int exact_orientation(Point a, Point b, Rational c) {
+  __int128 ax = grid_units(a.x), ay = grid_units(a.y);
+  __int128 det = (grid_units(b.x) - ax) * (c.y - ay * c.w) -
+                 (grid_units(b.y) - ay) * (c.x - ax * c.w);
+  return (det > 0) - (det < 0);
+}
+
+TEST(Predicates, ImplicitPoints) {
+  srand(2);
+  std::vector<ImplicitPoint> points;
+  std::vector<Rational> exact;
+  std::vector<Segment> segments;
+  while (points.size() < 300) {
+    bool coarse = rand() % 4 != 0;
+    Segment s = {random_grid_point(coarse), random_grid_point(coarse)};
+    Segment t = {random_grid_point(coarse), random_grid_point(coarse)};
+    if (!segment_intersects(s, t) || direction_cross(s, t) == 0) {
+      continue;
+    }
+    ImplicitPoint c = implicit_crossing(s, t);
+    ASSERT_TRUE(c.crossing);
+    ASSERT_EQ(implicit_orient2d(s.p0, s.p1, &c), 0);
+    ASSERT_EQ(implicit_orient2d(t.p1, t.p0, &c), 0);
+    points.push_back(c);
+    exact.push_back(exact_crossing(s, t));
+    points.push_back(implicit_point(s.p0));
+    exact.push_back(exact_point(s.p0));
+    segments.push_back(s);
+    segments.push_back(t);
+  }
+  for (unsigned i = 0; i < points.size(); ++i) {
+    for (unsigned j = 0; j < points.size(); ++j) {
+      ASSERT_EQ(implicit_compare(&points[i], &points[j]),
+                exact_compare(exact[i], exact[j]))
+          << i << " " << j;
+    }
+    for (const Segment &s : segments) {
+      ASSERT_EQ(sign(implicit_orient2d(s.p0, s.p1, &points[i])),
+                exact_orientation(s.p0, s.p1, exact[i]))
+          << i;
+    }
+  }
+}
@@ -0,0 +1,190 @@
+#include "geometry/util.h"
+extern "C" {
+#include "geometry/simd.h"
+#include "geometry/space_filling_curve.h"
+}
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <stdint.h>
+#include <vector>
+
+// Scalar tables and, where the CPU has it, BMI2
+static const SimdLevel LEVELS[] = {SIMD_SCALAR, SIMD_AVX512};
+
+static uint32_t random_u32() { return (uint32_t)rand() << 16 ^ rand(); }
+
+// Position along the Hilbert curve one level at a time, rotating the
+// remaining coordinates in place.
+static uint64_t reference_hilbert(uint32_t x, uint32_t y, unsigned bits) {
+  uint32_t all = (uint32_t)((1ull << bits) - 1);
+  uint64_t d = 0;
+  for (uint64_t s = 1ull << (bits - 1); s > 0; s /= 2) {
+    unsigned rx = (x & s) > 0;
+    unsigned ry = (y & s) > 0;
+    d += s * s * ((3 * rx) ^ ry);
+    if (ry == 0) {
+      if (rx == 1) {
+        x ^= all;
+        y ^= all;
+      }
+      std::swap(x, y);
+    }
+  }
+  return d;
+}
+
+static uint64_t reference_morton(uint32_t x, uint32_t y) {
+  uint64_t key = 0;
+  for (unsigned b = 0; b < 32; ++b) {
+    key |= (uint64_t)((x >> b) & 1) << 2 * b;
+    key |= (uint64_t)((y >> b) & 1) << (2 * b + 1);
+  }
+  return key;
+}
+
+TEST(SpaceFillingCurve, Morton) {
+  srand(0);
+  for (SimdLevel level : LEVELS) {
+    simd_set_level(level);
+    ASSERT_EQ(morton_encode(0, 0), 0);
+    ASSERT_EQ(morton_encode(1, 0), 1);
+    ASSERT_EQ(morton_encode(0, 1), 2);
+    ASSERT_EQ(morton_encode(UINT32_MAX, UINT32_MAX), UINT64_MAX);
+    for (unsigned i = 0; i < 10000; ++i) {
+      uint32_t x = random_u32(), y = random_u32();
+      uint64_t key = morton_encode(x, y);
+      ASSERT_EQ(key, reference_morton(x, y)) << "level " << level;
+      uint32_t dx, dy;
+      morton_decode(key, &dx, &dy);
+      ASSERT_EQ(dx, x);
+      ASSERT_EQ(dy, y);
+    }
+  }
+  simd_set_level(simd_supported_level());
+}
+
+TEST(SpaceFillingCurve, Hilbert) {
+  srand(1);
+  for (SimdLevel level : LEVELS) {
+    simd_set_level(level);
+    // Every cell of small grids, which the curve visits one step at a time
+    for (unsigned bits = 1; bits <= 6; ++bits) {
+      uint32_t side = 1u << bits;
+      std::vector<std::pair<uint32_t, uint32_t>> cells(side * side);
+      for (uint32_t x = 0; x < side; ++x) {
+        for (uint32_t y = 0; y < side; ++y) {
+          uint64_t key = hilbert_encode(x, y, bits);
+          ASSERT_EQ(key, reference_hilbert(x, y, bits)) << "bits " << bits;
+          cells[key] = {x, y};
+        }
+      }
+      ASSERT_EQ(cells.front(), std::make_pair(0u, 0u));
+      ASSERT_EQ(cells.back(), std::make_pair(side - 1, 0u));
+      for (uint64_t d = 0; d < cells.size(); ++d) {
+        uint32_t x, y;
+        hilbert_decode(d, bits, &x, &y);
+        ASSERT_EQ(std::make_pair(x, y), cells[d]);
+        if (d > 0) {
+          uint32_t px = cells[d - 1].first, py = cells[d - 1].second;
+          ASSERT_EQ(std::max(x, px) - std::min(x, px) +
+                        std::max(y, py) - std::min(y, py),
+                    1);
+        }
+      }
+    }
+    for (unsigned bits = 7; bits <= 32; ++bits) {
+      uint32_t mask = (uint32_t)((1ull << bits) - 1);
+      for (unsigned i = 0; i < 1000; ++i) {
+        uint32_t x = random_u32() & mask, y = random_u32() & mask;
+        uint64_t key = hilbert_encode(x, y, bits);
+        ASSERT_EQ(key, reference_hilbert(x, y, bits)) << "bits " << bits;
+        uint32_t dx, dy;
+        hilbert_decode(key, bits, &dx, &dy);
+        ASSERT_EQ(dx, x);
+        ASSERT_EQ(dy, y);
+      }
+    }
+  }
+  simd_set_level(simd_supported_level());
+}
+
+TEST(SpaceFillingCurve, Grid) {
+  CurveGrid grid;
+  curve_grid_init(&grid, bbox_from_corners({-1, 2}, {3, 4}), 2);
+  uint32_t x, y;
+  curve_grid_cell(&grid, {-1, 2}, &x, &y);
+  ASSERT_EQ(x, 0);
+  ASSERT_EQ(y, 0);
+  // Cells are square, so the shorter side spans fewer of them
+  curve_grid_cell(&grid, {3, 4}, &x, &y);
+  ASSERT_EQ(x, 3);
+  ASSERT_EQ(y, 1);
+  // Points outside are clamped
+  curve_grid_cell(&grid, {-5, 100}, &x, &y);
+  ASSERT_EQ(x, 0);
+  ASSERT_EQ(y, 3);
+  curve_grid_cell(&grid, {NAN, 2}, &x, &y);
+  ASSERT_EQ(x, 0);
+  ASSERT_EQ(curve_grid_key(&grid, CURVE_MORTON, {3, 4}), morton_encode(3, 1));
+  ASSERT_EQ(curve_grid_key(&grid, CURVE_HILBERT, {3, 4}),
+            hilbert_encode(3, 1, 2));
+
+  // A box that is a single point puts everything in the first cell
+  curve_grid_init(&grid, bbox_from_point({1, 1}), 32);
+  curve_grid_cell(&grid, {1, 1}, &x, &y);
+  ASSERT_EQ(x, 0);
+  ASSERT_EQ(y, 0);
+}
+
+TEST(SpaceFillingCurve, SpatialSort) {
+  srand(2);
+  spatial_sort(nullptr, 0, CURVE_HILBERT, nullptr, 1);
+  for (unsigned n : {1, 2, 100, 5000}) {
+    std::vector<Point> points;
+    for (unsigned i = 0; i < n; ++i) {
+      // Some repeated points
+      if (i % 7 == 3) {
+        points.push_back(points[i / 2]);
+      } else {
+        points.push_back({(double)rand() / RAND_MAX * 200 - 100,
+                          (double)rand() / RAND_MAX * 50});
+      }
+    }
+    BBox box = bbox_from_point(points[0]);
+    for (Point p : points) {
+      box = bbox_union(box, bbox_from_point(p));
+    }
+    CurveGrid grid;
+    curve_grid_init(&grid, box, curve_grid_bits(n));
+    for (SpaceFillingCurve curve : {CURVE_MORTON, CURVE_HILBERT}) {
+      std::vector<uint64_t> keys(n);
+      for (SimdLevel level : LEVELS) {
+        simd_set_level(level);
+        curve_grid_keys(&grid, curve, points.data(), n, keys.data());
+        for (unsigned i = 0; i < n; ++i) {
+          ASSERT_EQ(keys[i], curve_grid_key(&grid, curve, points[i]));
+        }
+      }
+      simd_set_level(simd_supported_level());
+      std::vector<unsigned> first(n);
+      for (unsigned threads : {1, 3}) {
+        std::vector<unsigned> order(n);
+        spatial_sort(points.data(), n, curve, order.data(), threads);
+        std::vector<bool> seen(n);
+        for (unsigned i = 0; i < n; ++i) {
+          ASSERT_FALSE(seen[order[i]]);
+          seen[order[i]] = true;
+          // Stable, so equal keys keep their input order
+          if (i > 0) {
+            uint64_t a = keys[order[i - 1]], b = keys[order[i]];
+            ASSERT_TRUE(a < b || (a == b && order[i - 1] < order[i]));
+          }
+        }
+        if (threads == 1) {
+          first = order;
+        }
+        ASSERT_EQ(order, first);
+      }
+    }
+  }
+}
@@ -0,0 +1,74 @@
+#include "geometry/util.h"
+extern "C" {
+#include "geometry/structure/bbox.h"
+}
+#include <gtest/gtest.h>
+
+static BBox box(double min_x, double min_y, double max_x, double max_y) {
+  return bbox_from_corners({min_x, min_y}, {max_x, max_y});
+}
+
+static void test_overlaps(BBox a, BBox b, bool expected) {
+  ASSERT_EQ(bbox_overlaps(a, b), expected);
+  ASSERT_EQ(bbox_overlaps(b, a), expected);
+  ASSERT_EQ(bbox_overlap_area(a, b) > 0,
+            expected && bbox_area(a) > 0 && bbox_area(b) > 0 &&
+                a.max_x != b.min_x && b.max_x != a.min_x &&
+                a.max_y != b.min_y && b.max_y != a.min_y);
+}
+
+TEST(BBox, FromSegment) {
+  BBox b = bbox_from_segment(segment_from_coords(3, -1, -2, 4));
+  ASSERT_EQ(b.min_x, -2);
+  ASSERT_EQ(b.min_y, -1);
+  ASSERT_EQ(b.max_x, 3);
+  ASSERT_EQ(b.max_y, 4);
+  ASSERT_EQ(bbox_area(b), 25);
+  ASSERT_EQ(bbox_margin(b), 10);
+
+  BBox p = bbox_from_point({1, 2});
+  ASSERT_EQ(bbox_area(p), 0);
+  BBox u = bbox_union(b, bbox_from_point({7, -3}));
+  ASSERT_EQ(u.min_x, -2);
+  ASSERT_EQ(u.min_y, -3);
+  ASSERT_EQ(u.max_x, 7);
+  ASSERT_EQ(u.max_y, 4);
+}
+
+TEST(BBox, Overlaps) {
+  BBox b = box(0, 0, 4, 2);
+  test_overlaps(b, box(1, 1, 2, 3), true);
+  test_overlaps(b, box(-1, -1, 5, 3), true);
+  // Closed boxes that only share an edge or a corner
+  test_overlaps(b, box(4, 0, 6, 2), true);
+  test_overlaps(b, box(4, 2, 6, 3), true);
+  test_overlaps(b, box(4.5, 0, 6, 2), false);
+  test_overlaps(b, box(0, -3, 4, -0.5), false);
+  test_overlaps(b, bbox_from_point({2, 1}), true);
+  ASSERT_EQ(bbox_overlap_area(b, box(1, 1, 2, 3)), 1);
+}
+
+TEST(BBox, ContainsPointAndDistance) {
+  BBox b = box(0, 0, 4, 2);
+  ASSERT_TRUE(bbox_contains_point(b, {0, 0}));
+  ASSERT_TRUE(bbox_contains_point(b, {4, 1}));
+  ASSERT_FALSE(bbox_contains_point(b, {4.5, 1}));
+  ASSERT_FALSE(bbox_contains_point(b, {2, -0.5}));
+  ASSERT_FALSE(bbox_contains_point(b, nan_point()));
+  ASSERT_EQ(bbox_squared_distance(b, {2, 1}), 0);
+  ASSERT_EQ(bbox_squared_distance(b, {7, 6}), 25);
+  ASSERT_EQ(bbox_squared_distance(b, {2, -3}), 9);
+}
+
+TEST(BBox, SegmentIntersectsBBox) {
+  BBox b = box(0, 0, 4, 2);
+  ASSERT_TRUE(segment_intersects_bbox(segment_from_coords(1, 1, 2, 1), b));
+  ASSERT_TRUE(segment_intersects_bbox(segment_from_coords(-1, 1, 5, 1), b));
+  ASSERT_TRUE(segment_intersects_bbox(segment_from_coords(-1, -1, 5, 3), b));
+  // Through a corner only
+  ASSERT_TRUE(segment_intersects_bbox(segment_from_coords(3, 3, 5, 1), b));
+  // The boxes overlap but the segment passes the corner
+  ASSERT_FALSE(segment_intersects_bbox(segment_from_coords(3, 3.5, 5, 1), b));
+  ASSERT_FALSE(segment_intersects_bbox(segment_from_coords(5, 0, 5, 2), b));
+  ASSERT_TRUE(segment_intersects_bbox(segment_from_coords(2, 1, 2, 1), b));
+}
@@ -0,0 +1,75 @@
+#include "geometry/util.h"
+#include "random.h"
+extern "C" {
+#include "geometry/simd.h"
+#include "geometry/structure/bbox_array.h"
+}
+#include <gtest/gtest.h>
+#include <stdint.h>
+
+static const SimdLevel LEVELS[] = {SIMD_SCALAR, SIMD_AVX2, SIMD_AVX512};
+
+static BBox random_box() {
+  Point p = {random_coord(), random_coord()};
+  return bbox_from_corners(p, {p.x + rand() % 30, p.y + rand() % 30});
+}
+
+static bool bit(const uint64_t *bitmask, unsigned i) {
+  return bitmask[i / 64] >> (i % 64) & 1;
+}
+
+static void test_overlaps_many(unsigned n) {
+  srand(n);
+  BBoxArray arr;
+  bbox_array_init(&arr);
+  for (unsigned i = 0; i < n; ++i) {
+    bbox_array_push(&arr, random_box());
+  }
+  uint64_t *bitmask =
+      (uint64_t *)malloc(sizeof(uint64_t) * (bbox_bitmask_words(n) + 1));
+  for (unsigned trial = 0; trial < 10; ++trial) {
+    BBox query = random_box();
+    for (SimdLevel level : LEVELS) {
+      simd_set_level(level);
+      bbox_overlaps_many(query, &arr, bitmask);
+      for (unsigned i = 0; i < n; ++i) {
+        bool expected = bbox_overlaps(query, bbox_array_get(&arr, i));
+        ASSERT_EQ(bit(bitmask, i), expected) << "box " << i << " level "
+                                             << level;
+      }
+    }
+  }
+  simd_set_level(simd_supported_level());
+  free(bitmask);
+  bbox_array_free(&arr);
+}
+
+TEST(BBoxArray, PushGet) {
+  BBoxArray arr;
+  bbox_array_initn(&arr, 1);
+  for (unsigned i = 0; i < 100; ++i) {
+    bbox_array_push(&arr, bbox_from_corners({(double)i, -(double)i},
+                                            {(double)i + 1, 0}));
+    ASSERT_EQ((uintptr_t)arr.min_xs % 64, 0);
+    ASSERT_EQ((uintptr_t)arr.max_ys % 64, 0);
+  }
+  ASSERT_EQ(arr.size, 100);
+  for (unsigned i = 0; i < 100; ++i) {
+    BBox b = bbox_array_get(&arr, i);
+    ASSERT_EQ(b.min_x, i);
+    ASSERT_EQ(b.min_y, -(double)i);
+    ASSERT_EQ(b.max_x, i + 1);
+    ASSERT_EQ(b.max_y, 0);
+  }
+  bbox_array_clear(&arr);
+  ASSERT_EQ(arr.size, 0);
+  bbox_array_free(&arr);
+}
+
+TEST(BBoxArray, OverlapsMany) {
+  test_overlaps_many(1);
+  test_overlaps_many(7);
+  test_overlaps_many(64);
+  test_overlaps_many(67);
+  test_overlaps_many(1000);
+}
@@ -0,0 +1,146 @@
+#include "geometry/util.h"
+#include "random.h"
+extern "C" {
+#include "geometry/structure/kd_tree.h"
+}
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <vector>
+
+static void collect_id(unsigned id, void *data) {
+  ((std::vector<unsigned> *)data)->push_back(id);
+}
+
+static double squared_distance(Point a, Point b) {
+  return (a.x - b.x) * (a.x - b.x) + (a.y - b.y) * (a.y - b.y);
+}
+
+// Checks nearest, radius and box queries against a scan over the points.
+static void check_queries(const std::vector<Point> &points) {
+  KDTree tree;
+  kd_tree_init(&tree, points.data(), points.size());
+  ASSERT_EQ(tree.size, points.size());
+  for (unsigned q = 0; q < 100; ++q) {
+    Point p = {random_coord(), random_coord()};
+    std::vector<double> distances;
+    for (Point point : points) {
+      distances.push_back(squared_distance(point, p));
+    }
+    std::sort(distances.begin(), distances.end());
+
+    for (unsigned k : {1, 7, 100}) {
+      std::vector<unsigned> ids(k);
+      unsigned count = kd_tree_nearest(&tree, p, k, ids.data());
+      ASSERT_EQ(count, std::min<unsigned>(k, points.size()));
+      for (unsigned i = 0; i < count; ++i) {
+        ASSERT_EQ(squared_distance(points[ids[i]], p), distances[i]);
+      }
+    }
+
+    double radius = fabs(random_coord()) / 4;
+    std::vector<unsigned> ids;
+    unsigned count = kd_tree_query_radius(&tree, p, radius, collect_id, &ids);
+    ASSERT_EQ(count, ids.size());
+    std::sort(ids.begin(), ids.end());
+    std::vector<unsigned> expected;
+    for (unsigned i = 0; i < points.size(); ++i) {
+      if (squared_distance(points[i], p) <= radius * radius) {
+        expected.push_back(i);
+      }
+    }
+    ASSERT_EQ(ids, expected);
+
+    Point max = {p.x + fabs(random_coord()) / 4, p.y + fabs(random_coord()) / 4};
+    ids.clear();
+    count = kd_tree_query_box(&tree, p, max, collect_id, &ids);
+    ASSERT_EQ(count, ids.size());
+    std::sort(ids.begin(), ids.end());
+    expected.clear();
+    for (unsigned i = 0; i < points.size(); ++i) {
+      if (points[i].x >= p.x && points[i].x <= max.x && points[i].y >= p.y &&
+          points[i].y <= max.y) {
+        expected.push_back(i);
+      }
+    }
+    ASSERT_EQ(ids, expected);
+  }
+  kd_tree_free(&tree);
+}
+
+TEST(KDTree, Empty) {
+  KDTree tree;
+  kd_tree_init(&tree, NULL, 0);
+  unsigned id;
+  ASSERT_EQ(kd_tree_nearest(&tree, {0, 0}, 1, &id), 0);
+  std::vector<unsigned> ids;
+  ASSERT_EQ(kd_tree_query_radius(&tree, {0, 0}, 1, collect_id, &ids), 0);
+  ASSERT_EQ(kd_tree_query_box(&tree, {0, 0}, {1, 1}, collect_id, &ids), 0);
+  kd_tree_free(&tree);
+}
+
+TEST(KDTree, Small) {
+  Point points[] = {{0, 0}, {3, 0}, {0, 4}, {-1, -1}};
+  KDTree tree;
+  kd_tree_init(&tree, points, 4);
+  unsigned ids[5];
+  ASSERT_EQ(kd_tree_nearest(&tree, {2.5, 0.5}, 5, ids), 4);
+  ASSERT_EQ(ids[0], 1);
+  ASSERT_EQ(ids[1], 0);
+  ASSERT_EQ(ids[2], 3);
+  ASSERT_EQ(ids[3], 2);
+  ASSERT_EQ(kd_tree_nearest(&tree, {2.5, 0.5}, 0, ids), 0);
+
+  std::vector<unsigned> found;
+  ASSERT_EQ(kd_tree_query_radius(&tree, {0, 0}, 3, collect_id, &found), 3);
+  ASSERT_EQ(kd_tree_query_radius(&tree, {0, 0}, -1, collect_id, &found), 0);
+  kd_tree_free(&tree);
+}
+
+TEST(KDTree, Random) {
+  srand(0);
+  std::vector<Point> points;
+  for (unsigned i = 0; i < 3000; ++i) {
+    points.push_back({random_coord(), random_coord()});
+  }
+  check_queries(points);
+}
+
+TEST(KDTree, Duplicates) {
+  // Few distinct coordinates, so many points tie with the medians
+  srand(1);
+  std::vector<Point> points;
+  for (unsigned i = 0; i < 2000; ++i) {
+    points.push_back({(double)(rand() % 5) * 20, (double)(rand() % 3) * 30});
+  }
+  check_queries(points);
+}
+
+TEST(KDTree, NearestBatch) {
+  srand(2);
+  std::vector<Point> points;
+  for (unsigned i = 0; i < 2000; ++i) {
+    points.push_back({random_coord(), random_coord()});
+  }
+  std::vector<Point> queries;
+  for (unsigned i = 0; i < 300; ++i) {
+    queries.push_back({random_coord(), random_coord()});
+  }
+  KDTree tree;
+  kd_tree_init(&tree, points.data(), points.size());
+  static const unsigned K = 5;
+  for (unsigned threads : {1, 4}) {
+    std::vector<unsigned> ids(queries.size() * K);
+    std::vector<unsigned> counts(queries.size());
+    kd_tree_nearest_batch(&tree, queries.data(), queries.size(), K,
+                          ids.data(), counts.data(), threads);
+    for (unsigned i = 0; i < queries.size(); ++i) {
+      unsigned expected[K];
+      ASSERT_EQ(counts[i], K);
+      ASSERT_EQ(kd_tree_nearest(&tree, queries[i], K, expected), K);
+      for (unsigned j = 0; j < K; ++j) {
+        ASSERT_EQ(ids[i * K + j], expected[j]);
+      }
+    }
+  }
+  kd_tree_free(&tree);
+}
@@ -0,0 +1,135 @@
+#include "geometry/util.h"
+#include "random.h"
+extern "C" {
+#include "geometry/simd.h"
+#include "geometry/structure/point_array.h"
+}
+#include <gtest/gtest.h>
+#include <math.h>
+#include <stdint.h>
+
+static const SimdLevel LEVELS[] = {SIMD_SCALAR, SIMD_AVX2, SIMD_AVX512};
+
+static void fill_random(PointArray *arr, unsigned n) {
+  for (unsigned i = 0; i < n; ++i) {
+    point_array_push(arr, (Point){.x = random_coord() * 10,
+                                  .y = random_coord() * 10});
+  }
+}
+
+static void test_distances(unsigned n) {
+  srand(n);
+  PointArray arr;
+  point_array_init(&arr);
+  fill_random(&arr, n);
+  Point p = {.x = random_coord() * 10, .y = random_coord() * 10};
+  double *distances = (double *)malloc(sizeof(double) * (n + 1));
+  double *squared = (double *)malloc(sizeof(double) * (n + 1));
+  for (SimdLevel level : LEVELS) {
+    simd_set_level(level);
+    point_array_distances(&arr, p, distances);
+    point_array_squared_distances(&arr, p, squared);
+    for (unsigned i = 0; i < n; ++i) {
+      Point q = point_array_get(&arr, i);
+      ASSERT_EQ(distances[i], point_distance(q, p)) << "level " << level;
+      double dx = q.x - p.x;
+      double dy = q.y - p.y;
+      ASSERT_EQ(squared[i], dx * dx + dy * dy) << "level " << level;
+    }
+  }
+  simd_set_level(simd_supported_level());
+  free(squared);
+  free(distances);
+  point_array_free(&arr);
+}
+
+static void test_bounds_and_centroid(unsigned n) {
+  srand(n);
+  PointArray arr;
+  point_array_init(&arr);
+  fill_random(&arr, n);
+  Point expected_min = point_array_get(&arr, 0);
+  Point expected_max = expected_min;
+  double sum_x = 0;
+  double sum_y = 0;
+  for (unsigned i = 0; i < n; ++i) {
+    Point p = point_array_get(&arr, i);
+    expected_min.x = fmin(expected_min.x, p.x);
+    expected_min.y = fmin(expected_min.y, p.y);
+    expected_max.x = fmax(expected_max.x, p.x);
+    expected_max.y = fmax(expected_max.y, p.y);
+    sum_x += p.x;
+    sum_y += p.y;
+  }
+  Point expected_centroid = {.x = sum_x / n, .y = sum_y / n};
+
+  for (SimdLevel level : LEVELS) {
+    simd_set_level(level);
+    Point min;
+    Point max;
+    point_array_bounds(&arr, &min, &max);
+    ASSERT_EQ(min.x, expected_min.x);
+    ASSERT_EQ(min.y, expected_min.y);
+    ASSERT_EQ(max.x, expected_max.x);
+    ASSERT_EQ(max.y, expected_max.y);
+    ASSERT_TRUE(point_equals(point_array_centroid(&arr), expected_centroid));
+  }
+  simd_set_level(simd_supported_level());
+  point_array_free(&arr);
+}
+
+TEST(PointArray, PushGet) {
+  PointArray arr;
+  point_array_initn(&arr, 1);
+  for (unsigned i = 0; i < 1000; ++i) {
+    point_array_push(&arr, (Point){.x = (double)i, .y = -(double)i});
+    ASSERT_EQ(arr.size, i + 1);
+    ASSERT_EQ((uintptr_t)arr.xs % 64, 0);
+    ASSERT_EQ((uintptr_t)arr.ys % 64, 0);
+  }
+  for (unsigned i = 0; i < 1000; ++i) {
+    Point p = point_array_get(&arr, i);
+    ASSERT_EQ(p.x, i);
+    ASSERT_EQ(p.y, -(double)i);
+  }
+  point_array_set(&arr, 5, (Point){.x = 1, .y = 2});
+  ASSERT_TRUE(point_equals(point_array_get(&arr, 5), (Point){.x = 1, .y = 2}));
+  point_array_clear(&arr);
+  ASSERT_EQ(arr.size, 0);
+  point_array_free(&arr);
+}
+
+TEST(PointArray, FromPoints) {
+  Point points[] = {{.x = 1, .y = 2}, {.x = 3, .y = 4}, {.x = 5, .y = 6}};
+  PointArray arr;
+  point_array_from_points(&arr, points, 3);
+  ASSERT_EQ(arr.size, 3);
+  for (unsigned i = 0; i < 3; ++i) {
+    ASSERT_TRUE(point_equals(point_array_get(&arr, i), points[i]));
+  }
+  point_array_free(&arr);
+}
+
+TEST(PointArray, Distances) {
+  test_distances(1);
+  test_distances(7);
+  test_distances(8);
+  test_distances(17);
+  test_distances(1000);
+  test_distances(0xF00);
+}
+
+TEST(PointArray, BoundsAndCentroid) {
+  test_bounds_and_centroid(1);
+  test_bounds_and_centroid(3);
+  test_bounds_and_centroid(9);
+  test_bounds_and_centroid(1000);
+  test_bounds_and_centroid(0xBA5);
+}
+
+TEST(PointArray, EmptyCentroid) {
+  PointArray arr;
+  point_array_init(&arr);
+  ASSERT_TRUE(is_nan_point(point_array_centroid(&arr)));
+  point_array_free(&arr);
+}
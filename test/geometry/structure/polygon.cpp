@@ -0,0 +1,180 @@
+#include "geometry/util.h"
+#include "random.h"
+extern "C" {
+#include "geometry/structure/polygon.h"
+}
+#include <climits>
+#include <cmath>
+#include <gtest/gtest.h>
+#include <vector>
+
+// A square from (0, 0) to (10, 10) with a square hole from (4, 4) to (6, 6),
+// both counterclockwise.
+static void square_with_hole(Polygon *poly) {
+  Point outer[] = {{0, 0}, {10, 0}, {10, 10}, {0, 10}};
+  Point hole[] = {{4, 4}, {6, 4}, {6, 6}, {4, 6}};
+  polygon_init(poly, outer, 4);
+  polygon_add_hole(poly, hole, 4);
+}
+
+TEST(Polygon, AreaAndOrientation) {
+  Polygon poly;
+  square_with_hole(&poly);
+  ASSERT_EQ(poly.num_rings, 2);
+  ASSERT_EQ(polygon_ring_size(&poly, 1), 4);
+  ASSERT_EQ(polygon_ring_signed_area(&poly, 0), 100);
+  ASSERT_EQ(polygon_ring_signed_area(&poly, 1), 4);
+  ASSERT_EQ(polygon_area(&poly), 96);
+  ASSERT_TRUE(polygon_is_ccw(&poly));
+  ASSERT_TRUE(segment_equals(polygon_edge(&poly, 0, 3),
+                             segment_from_coords(0, 10, 0, 0)));
+
+  polygon_orient(&poly);
+  ASSERT_EQ(polygon_ring_signed_area(&poly, 0), 100);
+  ASSERT_EQ(polygon_ring_signed_area(&poly, 1), -4);
+  ASSERT_EQ(polygon_area(&poly), 96);
+
+  BBox b = polygon_bbox(&poly);
+  ASSERT_EQ(b.min_x, 0);
+  ASSERT_EQ(b.min_y, 0);
+  ASSERT_EQ(b.max_x, 10);
+  ASSERT_EQ(b.max_y, 10);
+  polygon_free(&poly);
+}
+
+TEST(Polygon, Locate) {
+  Polygon poly;
+  square_with_hole(&poly);
+  PolygonSlabs slabs;
+  polygon_slabs_init(&slabs, &poly);
+
+  std::vector<std::pair<Point, PolygonLocation>> cases = {
+      {{1, 1}, POLYGON_INSIDE},    {{5, 5}, POLYGON_OUTSIDE},
+      {{-1, 5}, POLYGON_OUTSIDE},  {{11, 5}, POLYGON_OUTSIDE},
+      {{5, 11}, POLYGON_OUTSIDE},  {{0, 0}, POLYGON_BOUNDARY},
+      {{10, 10}, POLYGON_BOUNDARY}, {{5, 0}, POLYGON_BOUNDARY},
+      {{0, 5}, POLYGON_BOUNDARY},  {{4, 5}, POLYGON_BOUNDARY},
+      {{5, 6}, POLYGON_BOUNDARY},  {{6, 6}, POLYGON_BOUNDARY},
+      // Rays through vertices and along horizontal edges
+      {{2, 4}, POLYGON_INSIDE},    {{2, 6}, POLYGON_INSIDE},
+      {{-1, 0}, POLYGON_OUTSIDE},  {{-1, 10}, POLYGON_OUTSIDE},
+      {{8, 4}, POLYGON_INSIDE},    {{11, 0}, POLYGON_OUTSIDE},
+  };
+  for (auto [p, location] : cases) {
+    ASSERT_EQ(polygon_locate(&poly, p), location) << p.x << " " << p.y;
+    ASSERT_EQ(polygon_slabs_locate(&slabs, p), location) << p.x << " " << p.y;
+  }
+
+  // A diamond with a vertex on the ray's line pointing up and one pointing
+  // down
+  Point diamond[] = {{0, -2}, {2, 0}, {0, 2}, {-2, 0}};
+  Polygon d;
+  polygon_init(&d, diamond, 4);
+  ASSERT_EQ(polygon_locate(&d, {-3, 0}), POLYGON_OUTSIDE);
+  ASSERT_EQ(polygon_locate(&d, {0, 0}), POLYGON_INSIDE);
+  ASSERT_EQ(polygon_locate(&d, {1, 1}), POLYGON_BOUNDARY);
+  ASSERT_EQ(polygon_locate(&d, {-1, -2}), POLYGON_OUTSIDE);
+  ASSERT_EQ(polygon_locate(&d, {0, 2}), POLYGON_BOUNDARY);
+  polygon_free(&d);
+
+  polygon_slabs_free(&slabs);
+  polygon_free(&poly);
+}
+
+TEST(Polygon, SlabsMatchLocate) {
+  srand(0);
+  for (unsigned n : {3, 10, 100, 1000}) {
+    Polygon poly = random_star({0, 0}, 100, n);
+    PolygonSlabs slabs;
+    polygon_slabs_init(&slabs, &poly);
+    ASSERT_GE(slabs.num_slabs, 1);
+
+    std::vector<Point> points;
+    for (unsigned i = 0; i < 2000; ++i) {
+      points.push_back({random_coord(), random_coord()});
+    }
+    // Vertices and points on the rays through them
+    for (unsigned i = 0; i < poly.num_points; ++i) {
+      points.push_back(poly.points[i]);
+      points.push_back({random_coord(), poly.points[i].y});
+    }
+
+    std::vector<PolygonLocation> expected;
+    for (Point p : points) {
+      expected.push_back(polygon_locate(&poly, p));
+      ASSERT_EQ(polygon_slabs_locate(&slabs, p), expected.back());
+    }
+    for (unsigned i = 0; i < poly.num_points; ++i) {
+      ASSERT_EQ(expected[2000 + 2 * i], POLYGON_BOUNDARY);
+    }
+    for (unsigned threads : {1, 2, 3, 8}) {
+      std::vector<PolygonLocation> locations(points.size());
+      polygon_slabs_locate_many(&slabs, points.data(), points.size(),
+                                locations.data(), threads);
+      ASSERT_EQ(locations, expected);
+    }
+    polygon_slabs_free(&slabs);
+    polygon_free(&poly);
+  }
+}
+
+TEST(Polygon, DegenerateSlabs) {
+  // A polygon with no height still gets a slab
+  Point flat[] = {{0, 0}, {1, 0}, {2, 0}};
+  Polygon poly;
+  polygon_init(&poly, flat, 3);
+  PolygonSlabs slabs;
+  polygon_slabs_init(&slabs, &poly);
+  ASSERT_EQ(slabs.num_slabs, 1);
+  ASSERT_EQ(polygon_slabs_locate(&slabs, {1, 0}), POLYGON_BOUNDARY);
+  ASSERT_EQ(polygon_slabs_locate(&slabs, {3, 0}), POLYGON_OUTSIDE);
+  ASSERT_EQ(polygon_slabs_locate(&slabs, {1, 1}), POLYGON_OUTSIDE);
+  polygon_slabs_free(&slabs);
+  polygon_free(&poly);
+}
+
+TEST(PolygonIndex, MatchesBruteForce) {
+  srand(1);
+  std::vector<Polygon> polygons;
+  for (unsigned i = 0; i < 200; ++i) {
+    polygons.push_back(
+        random_star({random_coord(), random_coord()}, 10, 3 + rand() % 30));
+  }
+  std::vector<Point> points;
+  for (unsigned i = 0; i < 5000; ++i) {
+    points.push_back({random_coord(), random_coord()});
+  }
+  std::vector<unsigned> expected;
+  for (Point p : points) {
+    unsigned id = UINT_MAX;
+    for (unsigned i = 0; i < polygons.size() && id == UINT_MAX; ++i) {
+      if (polygon_locate(&polygons[i], p) != POLYGON_OUTSIDE) {
+        id = i;
+      }
+    }
+    expected.push_back(id);
+  }
+
+  for (unsigned threads : {1, 2, 3, 8}) {
+    PolygonIndex index;
+    polygon_index_init(&index, polygons.data(), polygons.size(), threads);
+    ASSERT_EQ(index.size, polygons.size());
+    for (unsigned i = 0; i < 100; ++i) {
+      ASSERT_EQ(polygon_index_locate(&index, points[i]), expected[i]);
+    }
+    std::vector<unsigned> ids(points.size());
+    polygon_index_locate_many(&index, points.data(), points.size(),
+                              ids.data(), threads);
+    ASSERT_EQ(ids, expected);
+    polygon_index_free(&index);
+  }
+
+  PolygonIndex empty;
+  polygon_index_init(&empty, NULL, 0, 2);
+  ASSERT_EQ(polygon_index_locate(&empty, {0, 0}), UINT_MAX);
+  polygon_index_free(&empty);
+
+  for (Polygon &poly : polygons) {
+    polygon_free(&poly);
+  }
+}
@@ -0,0 +1,63 @@
+#include "geometry/util.h"
+extern "C" {
+#include "geometry/structure/polyline.h"
+}
+#include <gtest/gtest.h>
+#include <vector>
+
+TEST(Polyline, Measures) {
+  Point points[] = {{0, 0}, {3, 4}, {3, -1}, {-2, -1}};
+  Polyline line;
+  polyline_init(&line, points, 4);
+  ASSERT_EQ(line.num_points, 4);
+  ASSERT_NE(line.points, points);
+  ASSERT_DOUBLE_EQ(polyline_length(&line), 15);
+  Segment s = polyline_segment(&line, 1);
+  ASSERT_TRUE(point_equals(s.p0, {3, 4}));
+  ASSERT_TRUE(point_equals(s.p1, {3, -1}));
+  BBox box = polyline_bbox(&line);
+  ASSERT_EQ(box.min_x, -2);
+  ASSERT_EQ(box.min_y, -1);
+  ASSERT_EQ(box.max_x, 3);
+  ASSERT_EQ(box.max_y, 4);
+  polyline_free(&line);
+
+  polyline_init(&line, nullptr, 0);
+  ASSERT_EQ(polyline_length(&line), 0);
+  polyline_free(&line);
+}
+
+TEST(Polyline, Set) {
+  PolylineSet set;
+  polyline_set_init(&set);
+  std::vector<std::vector<Point>> lines;
+  for (unsigned i = 0; i < 100; ++i) {
+    std::vector<Point> line;
+    for (unsigned j = 0; j < i % 7; ++j) {
+      line.push_back({(double)i, (double)j});
+    }
+    polyline_set_add(&set, line.data(), line.size());
+    lines.push_back(line);
+  }
+  polyline_set_validate(&set);
+  ASSERT_EQ(set.num_lines, 100);
+  for (unsigned i = 0; i < 100; ++i) {
+    ASSERT_EQ(polyline_set_line_size(&set, i), lines[i].size());
+    Polyline line;
+    polyline_set_get(&set, i, &line);
+    for (unsigned j = 0; j < line.num_points; ++j) {
+      ASSERT_TRUE(point_equals(line.points[j], lines[i][j]));
+    }
+    polyline_free(&line);
+  }
+
+  polyline_set_clear(&set);
+  ASSERT_EQ(set.num_points, 0);
+  polyline_set_reserve(&set, 1000, 50);
+  ASSERT_GE(set.points_capacity, 1000);
+  ASSERT_GT(set.lines_capacity, 50);
+  Point p = {1, 2};
+  polyline_set_add(&set, &p, 1);
+  ASSERT_EQ(set.num_points, 1);
+  polyline_set_free(&set);
+}
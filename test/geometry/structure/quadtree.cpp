@@ -0,0 +1,242 @@
+#include "geometry/util.h"
+#include "random.h"
+extern "C" {
+#include "geometry/structure/quadtree.h"
+}
+#include <algorithm>
+#include <climits>
+#include <gtest/gtest.h>
+#include <vector>
+
+static void collect_id(unsigned id, void *data) {
+  ((std::vector<unsigned> *)data)->push_back(id);
+}
+
+static bool segment_in_box(Segment s, Point min, Point max) {
+  // Clip the segment against the box
+  double t0 = 0;
+  double t1 = 1;
+  double d[] = {s.p1.x - s.p0.x, s.p1.y - s.p0.y};
+  double p[] = {s.p0.x, s.p0.y};
+  double lo[] = {min.x, min.y};
+  double hi[] = {max.x, max.y};
+  for (unsigned axis = 0; axis < 2; ++axis) {
+    if (d[axis] == 0) {
+      if (p[axis] < lo[axis] || p[axis] > hi[axis]) {
+        return false;
+      }
+      continue;
+    }
+    double ta = (lo[axis] - p[axis]) / d[axis];
+    double tb = (hi[axis] - p[axis]) / d[axis];
+    t0 = std::max(t0, std::min(ta, tb));
+    t1 = std::min(t1, std::max(ta, tb));
+  }
+  return t0 <= t1;
+}
+
+static double squared_distance(Segment s, Point p) {
+  double dx = s.p1.x - s.p0.x;
+  double dy = s.p1.y - s.p0.y;
+  double length2 = dx * dx + dy * dy;
+  double t =
+      length2 > 0 ? ((p.x - s.p0.x) * dx + (p.y - s.p0.y) * dy) / length2 : 0;
+  t = std::max(0.0, std::min(1.0, t));
+  double ex = s.p0.x + t * dx - p.x;
+  double ey = s.p0.y + t * dy - p.y;
+  return ex * ex + ey * ey;
+}
+
+static std::vector<unsigned> query_box(QuadTree *tree, Point min, Point max) {
+  std::vector<unsigned> ids;
+  unsigned count = quadtree_query_box(tree, min, max, collect_id, &ids);
+  EXPECT_EQ(count, ids.size());
+  std::sort(ids.begin(), ids.end());
+  return ids;
+}
+
+// Checks box and nearest queries against a scan over the live items.
+static void check_queries(QuadTree *tree, const std::vector<Segment> &segments,
+                          const std::vector<bool> &alive) {
+  for (unsigned q = 0; q < 50; ++q) {
+    Point a = {random_coord() * 1.2, random_coord() * 1.2};
+    Point b = {a.x + random_coord() / 4 + 25, a.y + random_coord() / 4 + 25};
+    std::vector<unsigned> expected;
+    for (unsigned i = 0; i < segments.size(); ++i) {
+      if (alive[i] && segment_in_box(segments[i], a, b)) {
+        expected.push_back(i);
+      }
+    }
+    ASSERT_EQ(query_box(tree, a, b), expected);
+
+    static const unsigned K = 10;
+    unsigned nearest[K];
+    unsigned live = std::count(alive.begin(), alive.end(), true);
+    ASSERT_EQ(quadtree_nearest(tree, a, K, nearest), std::min(K, live));
+    std::vector<double> distances;
+    for (unsigned i = 0; i < segments.size(); ++i) {
+      if (alive[i]) {
+        distances.push_back(squared_distance(segments[i], a));
+      }
+    }
+    std::sort(distances.begin(), distances.end());
+    for (unsigned i = 0; i < std::min(K, live); ++i) {
+      ASSERT_EQ(squared_distance(segments[nearest[i]], a), distances[i]);
+    }
+  }
+}
+
+TEST(QuadTree, Points) {
+  QuadTree tree;
+  quadtree_init(&tree, {-10, -10}, {10, 10});
+  unsigned a = quadtree_insert_point(&tree, {0.5, 0.5});
+  unsigned b = quadtree_insert_point(&tree, {2.5, 0.5});
+  unsigned c = quadtree_insert_point(&tree, {-3, -3});
+  // Outside of the bounds, so the root grows
+  unsigned d = quadtree_insert_point(&tree, {50, 50});
+  quadtree_validate(&tree);
+  ASSERT_EQ(tree.size, 4);
+  ASSERT_EQ(tree.nodes[0].half, 40);
+
+  ASSERT_EQ(query_box(&tree, {0, 0}, {3, 1}), std::vector<unsigned>({a, b}));
+  ASSERT_EQ(query_box(&tree, {40, 40}, {60, 60}), std::vector<unsigned>({d}));
+  unsigned nearest[4];
+  ASSERT_EQ(quadtree_nearest(&tree, {2, 0}, 4, nearest), 4);
+  ASSERT_EQ(nearest[0], b);
+  ASSERT_EQ(nearest[1], a);
+  ASSERT_EQ(nearest[2], c);
+  ASSERT_EQ(nearest[3], d);
+
+  ASSERT_TRUE(quadtree_move(&tree, d, {{5, 5}, {5, 5}}));
+  quadtree_validate(&tree);
+  ASSERT_EQ(query_box(&tree, {4, 4}, {6, 6}), std::vector<unsigned>({d}));
+  ASSERT_EQ(query_box(&tree, {40, 40}, {60, 60}), std::vector<unsigned>());
+
+  ASSERT_TRUE(quadtree_delete(&tree, a));
+  ASSERT_FALSE(quadtree_delete(&tree, a));
+  ASSERT_FALSE(quadtree_move(&tree, a, {{0, 0}, {0, 0}}));
+  quadtree_validate(&tree);
+  ASSERT_EQ(query_box(&tree, {0, 0}, {3, 1}), std::vector<unsigned>({b}));
+
+  // Deleted ids are reused
+  ASSERT_EQ(quadtree_insert_point(&tree, {7, 7}), a);
+  ASSERT_TRUE(point_equals(quadtree_get(&tree, a).p0, {7, 7}));
+  quadtree_free(&tree);
+}
+
+TEST(QuadTree, SplitAndMerge) {
+  QuadTree tree;
+  quadtree_init(&tree, {0, 0}, {100, 100});
+  std::vector<unsigned> ids;
+  for (unsigned i = 0; i < 100; ++i) {
+    ids.push_back(quadtree_insert_point(&tree, {(double)i, (double)i}));
+  }
+  quadtree_validate(&tree);
+  ASSERT_NE(tree.nodes[0].first_child, UINT_MAX);
+  for (unsigned i = 0; i < 96; ++i) {
+    ASSERT_TRUE(quadtree_delete(&tree, ids[i]));
+  }
+  quadtree_validate(&tree);
+  // The root absorbed everything once few items were left
+  ASSERT_EQ(tree.nodes[0].first_child, UINT_MAX);
+  ASSERT_EQ(tree.nodes[0].count, 4);
+  // Blocks are reused
+  unsigned num_nodes = tree.num_nodes;
+  for (unsigned i = 0; i < 96; ++i) {
+    quadtree_insert_point(&tree, {(double)i, (double)i});
+  }
+  quadtree_validate(&tree);
+  ASSERT_EQ(tree.num_nodes, num_nodes);
+  quadtree_free(&tree);
+}
+
+TEST(QuadTree, Grow) {
+  QuadTree tree;
+  quadtree_init(&tree, {0, 0}, {1, 1});
+  std::vector<Segment> segments;
+  for (unsigned i = 0; i < 200; ++i) {
+    double x = (double)(i % 20) - 10;
+    double y = (double)(i / 20) * 3 - 20;
+    segments.push_back(segment_from_coords(x, y, x + 0.5, y + 0.25));
+    quadtree_insert_segment(&tree, segments.back());
+  }
+  // Items that are not finite stay in the root
+  unsigned nan_id = quadtree_insert_point(&tree, {NAN, 0});
+  quadtree_validate(&tree);
+  ASSERT_GE(tree.nodes[0].half, 16);
+  ASSERT_EQ(tree.item_node[nan_id], 0);
+  std::vector<unsigned> expected;
+  for (unsigned i = 0; i < segments.size(); ++i) {
+    if (segment_in_box(segments[i], {-5, -5}, {5, 5})) {
+      expected.push_back(i);
+    }
+  }
+  ASSERT_EQ(query_box(&tree, {-5, -5}, {5, 5}), expected);
+  quadtree_free(&tree);
+}
+
+TEST(QuadTree, Duplicates) {
+  // Identical points stop splitting at the maximum depth
+  QuadTree tree;
+  quadtree_init(&tree, {0, 0}, {1, 1});
+  for (unsigned i = 0; i < 50; ++i) {
+    quadtree_insert_point(&tree, {0.3, 0.3});
+  }
+  quadtree_validate(&tree);
+  ASSERT_EQ(query_box(&tree, {0.3, 0.3}, {0.3, 0.3}).size(), 50);
+  quadtree_free(&tree);
+}
+
+TEST(QuadTree, RandomUpdates) {
+  srand(0);
+  std::vector<Segment> segments;
+  std::vector<bool> alive;
+  QuadTree tree;
+  quadtree_init(&tree, {-100, -100}, {100, 100});
+  for (unsigned i = 0; i < 3000; ++i) {
+    Segment s = i % 11 == 0
+                    ? segment_from_coords(random_coord(), random_coord(),
+                                          random_coord(), random_coord())
+                    : random_short_segment(10);
+    ASSERT_EQ(quadtree_insert_segment(&tree, s), i);
+    segments.push_back(s);
+    alive.push_back(true);
+  }
+  quadtree_validate(&tree);
+  check_queries(&tree, segments, alive);
+
+  // Small and large moves, some out of bounds, and deletes
+  for (unsigned round = 0; round < 5; ++round) {
+    for (unsigned i = 0; i < segments.size(); ++i) {
+      if (!alive[i]) {
+        continue;
+      }
+      if (rand() % 10 == 0) {
+        ASSERT_TRUE(quadtree_delete(&tree, i));
+        alive[i] = false;
+        continue;
+      }
+      double dx = rand() % 4 == 0 ? random_coord() : random_coord() / 50;
+      double dy = rand() % 4 == 0 ? random_coord() : random_coord() / 50;
+      Segment s = segments[i];
+      s.p0.x += dx;
+      s.p1.x += dx;
+      s.p0.y += dy;
+      s.p1.y += dy;
+      ASSERT_TRUE(quadtree_move(&tree, i, s));
+      segments[i] = s;
+    }
+    quadtree_validate(&tree);
+    check_queries(&tree, segments, alive);
+  }
+
+  for (unsigned i = 0; i < segments.size(); ++i) {
+    if (alive[i]) {
+      ASSERT_TRUE(quadtree_delete(&tree, i));
+    }
+  }
+  quadtree_validate(&tree);
+  ASSERT_EQ(tree.size, 0);
+  ASSERT_EQ(tree.nodes[0].first_child, UINT_MAX);
+  quadtree_free(&tree);
+}
@@ -0,0 +1,251 @@
+#include "geometry/util.h"
+#include "random.h"
+extern "C" {
+#include "geometry/structure/rtree.h"
+}
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <vector>
+
+static void collect_id(unsigned id, void *data) {
+  ((std::vector<unsigned> *)data)->push_back(id);
+}
+
+static bool segment_in_box(Segment s, Point min, Point max) {
+  // Clip the segment against the box
+  double t0 = 0;
+  double t1 = 1;
+  double d[] = {s.p1.x - s.p0.x, s.p1.y - s.p0.y};
+  double p[] = {s.p0.x, s.p0.y};
+  double lo[] = {min.x, min.y};
+  double hi[] = {max.x, max.y};
+  for (unsigned axis = 0; axis < 2; ++axis) {
+    if (d[axis] == 0) {
+      if (p[axis] < lo[axis] || p[axis] > hi[axis]) {
+        return false;
+      }
+      continue;
+    }
+    double ta = (lo[axis] - p[axis]) / d[axis];
+    double tb = (hi[axis] - p[axis]) / d[axis];
+    t0 = std::max(t0, std::min(ta, tb));
+    t1 = std::min(t1, std::max(ta, tb));
+  }
+  return t0 <= t1;
+}
+
+static double squared_distance(Segment s, Point p) {
+  double dx = s.p1.x - s.p0.x;
+  double dy = s.p1.y - s.p0.y;
+  double length2 = dx * dx + dy * dy;
+  double t =
+      length2 > 0 ? ((p.x - s.p0.x) * dx + (p.y - s.p0.y) * dy) / length2 : 0;
+  t = std::max(0.0, std::min(1.0, t));
+  double ex = s.p0.x + t * dx - p.x;
+  double ey = s.p0.y + t * dy - p.y;
+  return ex * ex + ey * ey;
+}
+
+static std::vector<unsigned> query_box(RTree *tree, Point min, Point max) {
+  std::vector<unsigned> ids;
+  unsigned count = rtree_query_box(tree, min, max, collect_id, &ids);
+  EXPECT_EQ(count, ids.size());
+  std::sort(ids.begin(), ids.end());
+  return ids;
+}
+
+// Checks box, segment and nearest queries against a scan over the live items.
+static void check_queries(RTree *tree, const std::vector<Segment> &segments,
+                          const std::vector<bool> &alive) {
+  for (unsigned q = 0; q < 50; ++q) {
+    Point a = {random_coord(), random_coord()};
+    Point b = {a.x + random_coord() / 4 + 25, a.y + random_coord() / 4 + 25};
+    std::vector<unsigned> expected;
+    for (unsigned i = 0; i < segments.size(); ++i) {
+      if (alive[i] && segment_in_box(segments[i], a, b)) {
+        expected.push_back(i);
+      }
+    }
+    ASSERT_EQ(query_box(tree, a, b), expected);
+
+    // Every live item whose bounding box the segment crosses
+    Segment s = random_short_segment(5);
+    std::vector<unsigned> ids;
+    unsigned count = rtree_query_segment(tree, s, collect_id, &ids);
+    ASSERT_EQ(count, ids.size());
+    std::sort(ids.begin(), ids.end());
+    expected.clear();
+    for (unsigned i = 0; i < segments.size(); ++i) {
+      Point lo = {std::min(segments[i].p0.x, segments[i].p1.x),
+                  std::min(segments[i].p0.y, segments[i].p1.y)};
+      Point hi = {std::max(segments[i].p0.x, segments[i].p1.x),
+                  std::max(segments[i].p0.y, segments[i].p1.y)};
+      if (alive[i] && segment_in_box(s, lo, hi)) {
+        expected.push_back(i);
+      }
+    }
+    ASSERT_EQ(ids, expected);
+
+    static const unsigned K = 10;
+    unsigned nearest[K];
+    unsigned live = std::count(alive.begin(), alive.end(), true);
+    ASSERT_EQ(rtree_nearest(tree, a, K, nearest), std::min(K, live));
+    std::vector<double> distances;
+    for (unsigned i = 0; i < segments.size(); ++i) {
+      if (alive[i]) {
+        distances.push_back(squared_distance(segments[i], a));
+      }
+    }
+    std::sort(distances.begin(), distances.end());
+    for (unsigned i = 0; i < std::min(K, live); ++i) {
+      ASSERT_EQ(squared_distance(segments[nearest[i]], a), distances[i]);
+    }
+  }
+}
+
+TEST(RTree, Empty) {
+  RTree tree;
+  rtree_init(&tree);
+  rtree_validate(&tree);
+  unsigned id;
+  ASSERT_EQ(rtree_nearest(&tree, {0, 0}, 1, &id), 0);
+  ASSERT_EQ(query_box(&tree, {-1, -1}, {1, 1}), std::vector<unsigned>());
+  ASSERT_FALSE(rtree_delete(&tree, 0));
+
+  rtree_bulk_load(&tree, NULL, 0, 1);
+  rtree_validate(&tree);
+  ASSERT_EQ(tree.size, 0);
+  rtree_free(&tree);
+}
+
+TEST(RTree, Points) {
+  RTree tree;
+  rtree_init(&tree);
+  unsigned a = rtree_insert_point(&tree, {0.5, 0.5});
+  unsigned b = rtree_insert_point(&tree, {2.5, 0.5});
+  unsigned c = rtree_insert_point(&tree, {-3, -3});
+  rtree_validate(&tree);
+  ASSERT_EQ(tree.size, 3);
+
+  ASSERT_EQ(query_box(&tree, {0, 0}, {3, 1}), std::vector<unsigned>({a, b}));
+  ASSERT_EQ(query_box(&tree, {-10, -10}, {10, 10}),
+            std::vector<unsigned>({a, b, c}));
+  ASSERT_EQ(query_box(&tree, {5, 5}, {6, 6}), std::vector<unsigned>());
+
+  unsigned nearest[3];
+  ASSERT_EQ(rtree_nearest(&tree, {2, 0}, 3, nearest), 3);
+  ASSERT_EQ(nearest[0], b);
+  ASSERT_EQ(nearest[1], a);
+  ASSERT_EQ(nearest[2], c);
+
+  ASSERT_TRUE(rtree_delete(&tree, a));
+  ASSERT_FALSE(rtree_delete(&tree, a));
+  rtree_validate(&tree);
+  ASSERT_EQ(tree.size, 2);
+  ASSERT_EQ(query_box(&tree, {0, 0}, {3, 1}), std::vector<unsigned>({b}));
+
+  // Deleted ids are reused
+  ASSERT_EQ(rtree_insert_point(&tree, {7, 7}), a);
+  ASSERT_TRUE(point_equals(rtree_get(&tree, a).p0, {7, 7}));
+  rtree_free(&tree);
+}
+
+TEST(RTree, BulkLoad) {
+  srand(0);
+  std::vector<Segment> segments;
+  for (unsigned i = 0; i < 5000; ++i) {
+    segments.push_back(random_short_segment(5));
+  }
+  std::vector<bool> alive(segments.size(), true);
+  for (unsigned threads : {1, 3}) {
+    RTree tree;
+    rtree_init(&tree);
+    rtree_bulk_load(&tree, segments.data(), segments.size(), threads);
+    rtree_validate(&tree);
+    ASSERT_EQ(tree.size, segments.size());
+    // Packed nodes are full, so the tree is as shallow as it can be
+    ASSERT_EQ(tree.height, 5);
+    check_queries(&tree, segments, alive);
+    rtree_free(&tree);
+  }
+
+  // A last node left with fewer than RTREE_MIN_ENTRIES shares the entries of
+  // the one before it, on every level
+  for (unsigned n : {1, 2, 9, 10, 17, 65, 66, 513, 522}) {
+    std::vector<Segment> prefix(segments.begin(), segments.begin() + n);
+    RTree tree;
+    rtree_init(&tree);
+    rtree_bulk_load(&tree, prefix.data(), n, 2);
+    rtree_validate(&tree);
+    check_queries(&tree, prefix, std::vector<bool>(n, true));
+    rtree_free(&tree);
+  }
+}
+
+TEST(RTree, BulkLoadPoints) {
+  std::vector<Point> points;
+  for (unsigned i = 0; i < 1000; ++i) {
+    points.push_back({(double)(i % 10), (double)(i / 10)});
+  }
+  RTree tree;
+  rtree_init(&tree);
+  rtree_bulk_load_points(&tree, points.data(), points.size(), 2);
+  rtree_validate(&tree);
+  ASSERT_EQ(query_box(&tree, {2, 3}, {3, 4}),
+            std::vector<unsigned>({32, 33, 42, 43}));
+  unsigned nearest;
+  ASSERT_EQ(rtree_nearest(&tree, {7.1, 55.2}, 1, &nearest), 1);
+  ASSERT_EQ(nearest, 557);
+  rtree_free(&tree);
+}
+
+TEST(RTree, InsertDelete) {
+  srand(1);
+  std::vector<Segment> segments;
+  std::vector<bool> alive;
+  RTree tree;
+  rtree_init(&tree);
+  for (unsigned i = 0; i < 3000; ++i) {
+    Segment s = i % 7 == 0 ? segment_from_coords(random_coord(),
+                                                 random_coord(),
+                                                 random_coord(), random_coord())
+                           : random_short_segment(5);
+    ASSERT_EQ(rtree_insert_segment(&tree, s), i);
+    segments.push_back(s);
+    alive.push_back(true);
+  }
+  rtree_validate(&tree);
+  check_queries(&tree, segments, alive);
+
+  // Delete two thirds, which dissolves and reinserts many nodes
+  for (unsigned i = 0; i < segments.size(); ++i) {
+    if (i % 3 != 0) {
+      ASSERT_TRUE(rtree_delete(&tree, i));
+      alive[i] = false;
+    }
+  }
+  rtree_validate(&tree);
+  check_queries(&tree, segments, alive);
+
+  // Reused ids
+  for (unsigned i = 0; i < 500; ++i) {
+    Segment s = random_short_segment(5);
+    unsigned id = rtree_insert_segment(&tree, s);
+    ASSERT_FALSE(alive[id]);
+    segments[id] = s;
+    alive[id] = true;
+  }
+  rtree_validate(&tree);
+  check_queries(&tree, segments, alive);
+
+  // Deleting everything leaves an empty leaf root
+  for (unsigned i = 0; i < segments.size(); ++i) {
+    if (alive[i]) {
+      ASSERT_TRUE(rtree_delete(&tree, i));
+    }
+  }
+  rtree_validate(&tree);
+  ASSERT_EQ(tree.size, 0);
+  ASSERT_EQ(tree.height, 1);
+  rtree_free(&tree);
+}
@@ -113,3 +113,37 @@ TEST(Segment, PointsLieOnDiagonalLine) {
   ASSERT_FALSE(point_lies_on_segment((Point){.x = left, .y = right + 1}, s));
   ASSERT_FALSE(point_lies_on_segment((Point){.x = left, .y = right - 1}, s));
 }
+
+TEST(Segment, SegmentIntersectionCollinear) {
+  // Overlapping collinear segments meet at the start of the overlap
+  test_segment_intersection(0, 0, 4, 4, 6, 6, 2, 2, 2, 2);
+  test_segment_intersection(0, 0, 4, 0, 4, 0, 9, 0, 4, 0);
+  test_segment_intersection(0, 0, 0, 4, 0, 1, 0, 2, 0, 1);
+  // A single point on a segment
+  test_segment_intersection(0, 0, 4, 4, 3, 3, 3, 3, 3, 3);
+  test_segment_intersection(1, 1, 1, 1, 1, 1, 1, 1, 1, 1);
+  test_segment_no_intersection(1, 1, 1, 1, 1, 2, 1, 2);
+}
+
+TEST(Segment, SegmentIntersectionNearlyTouching) {
+  // The endpoint (1.5, 0.5) lies exactly on the first segment, and moving it
+  // by one ulp in either direction decides whether the segments touch
+  Segment s = segment_from_coords(0, 0, 3, 1);
+  Segment on = segment_from_coords(1.5, 0.5, 1.5, -1);
+  Segment below = segment_from_coords(1.5, nextafter(0.5, 0), 1.5, -1);
+  Segment above = segment_from_coords(1.5, nextafter(0.5, 1), 1.5, -1);
+  ASSERT_TRUE(segment_intersects(s, on));
+  ASSERT_FALSE(segment_intersects(s, below));
+  ASSERT_TRUE(segment_intersects(s, above));
+  Point p = segment_intersection_point(s, on);
+  ASSERT_EQ(p.x, 1.5);
+  ASSERT_EQ(p.y, 0.5);
+
+  // Far from the origin, where the slope and intercept lose the low bits
+  double o = 0x1p40;
+  s = segment_from_coords(o, o, o + 3, o + 1);
+  ASSERT_TRUE(segment_intersects(s, segment_from_coords(o + 1.5, o + 0.5,
+                                                        o + 1.5, o - 1)));
+  ASSERT_FALSE(segment_intersects(
+      s, segment_from_coords(o + 1.5, nextafter(o + 0.5, 0), o + 1.5, o - 1)));
+}
@@ -0,0 +1,157 @@
+#include "geometry/util.h"
+#include "random.h"
+extern "C" {
+#include "geometry/simd.h"
+#include "geometry/structure/segment_array.h"
+}
+#include <gtest/gtest.h>
+
+static const SimdLevel LEVELS[] = {SIMD_SCALAR, SIMD_AVX2, SIMD_AVX512};
+
+static bool bit(const uint64_t *bitmask, unsigned i) {
+  return bitmask[i / 64] >> (i % 64) & 1;
+}
+
+// Checks every SIMD level against the expected results.
+static void test_many(Segment query, const SegmentArray *arr,
+                      const bool *expected) {
+  uint64_t *bitmask =
+      (uint64_t *)malloc(sizeof(uint64_t) * segment_bitmask_words(arr->size));
+  for (SimdLevel level : LEVELS) {
+    simd_set_level(level);
+    segment_intersects_many(query, arr, bitmask);
+    for (unsigned i = 0; i < arr->size; ++i) {
+      ASSERT_EQ(bit(bitmask, i), expected[i]) << "segment " << i << " level "
+                                               << level;
+    }
+  }
+  simd_set_level(simd_supported_level());
+  free(bitmask);
+}
+
+TEST(SegmentArray, PushGet) {
+  SegmentArray arr;
+  segment_array_initn(&arr, 1);
+  for (unsigned i = 0; i < 100; ++i) {
+    segment_array_push(&arr, segment_from_coords(i, i + 1, i + 2, i + 3));
+  }
+  ASSERT_EQ(arr.size, 100);
+  for (unsigned i = 0; i < 100; ++i) {
+    ASSERT_TRUE(segment_equals(segment_array_get(&arr, i),
+                               segment_from_coords(i, i + 1, i + 2, i + 3)));
+  }
+  segment_array_clear(&arr);
+  ASSERT_EQ(arr.size, 0);
+  segment_array_free(&arr);
+}
+
+TEST(SegmentArray, CachedBoxes) {
+  SegmentArray arr;
+  segment_array_initn(&arr, 1);
+  for (unsigned i = 0; i < 100; ++i) {
+    segment_array_push(&arr, segment_from_coords(i, i + 1, i - 2, i + 3));
+  }
+  segment_array_set(&arr, 7, segment_from_coords(5, 5, -5, -5));
+  ASSERT_EQ(arr.boxes.size, arr.size);
+  for (unsigned i = 0; i < arr.size; ++i) {
+    BBox expected = bbox_from_segment(segment_array_get(&arr, i));
+    BBox b = bbox_array_get(&arr.boxes, i);
+    ASSERT_EQ(b.min_x, expected.min_x);
+    ASSERT_EQ(b.min_y, expected.min_y);
+    ASSERT_EQ(b.max_x, expected.max_x);
+    ASSERT_EQ(b.max_y, expected.max_y);
+  }
+  segment_array_clear(&arr);
+  ASSERT_EQ(arr.boxes.size, 0);
+  segment_array_free(&arr);
+}
+
+TEST(SegmentArray, AgreesWithSegmentIntersects) {
+  srand(0);
+  const unsigned n = 1000;
+  for (unsigned trial = 0; trial < 20; ++trial) {
+    SegmentArray arr;
+    segment_array_init(&arr);
+    bool expected[n];
+    Segment query = random_segment();
+    for (unsigned i = 0; i < n; ++i) {
+      Segment s = random_segment();
+      segment_array_push(&arr, s);
+      expected[i] = segment_intersects(query, s);
+    }
+    test_many(query, &arr, expected);
+    segment_array_free(&arr);
+  }
+}
+
+TEST(SegmentArray, Degenerate) {
+  Segment query = segment_from_coords(0, 0, 10, 0);
+  Segment segments[] = {
+      // vertical, crossing
+      segment_from_coords(5, -5, 5, 5),
+      // vertical, touching the query's endpoint
+      segment_from_coords(10, 0, 10, 5),
+      // vertical, missing the query
+      segment_from_coords(11, -5, 11, 5),
+      // collinear and overlapping
+      segment_from_coords(8, 0, 12, 0),
+      // collinear and disjoint
+      segment_from_coords(11, 0, 12, 0),
+      // collinear, sharing an endpoint
+      segment_from_coords(-3, 0, 0, 0),
+      // parallel
+      segment_from_coords(0, 1, 10, 1),
+      // T junction in the middle of the query
+      segment_from_coords(3, 0, 3, 7),
+      // a single point on the query
+      segment_from_coords(4, 0, 4, 0),
+      // a single point off the query
+      segment_from_coords(4, 1, 4, 1),
+      // crosses the query's line outside the query
+      segment_from_coords(15, -1, 16, 1),
+  };
+  bool expected[] = {true,  true, false, true,  false, true,
+                     false, true, true,  false, false};
+  unsigned n = sizeof(segments) / sizeof(Segment);
+  SegmentArray arr;
+  segment_array_from_segments(&arr, segments, n);
+  test_many(query, &arr, expected);
+  segment_array_free(&arr);
+}
+
+TEST(SegmentArray, VerticalQuery) {
+  Segment query = segment_from_coords(0, -10, 0, 10);
+  Segment segments[] = {
+      segment_from_coords(-1, 0, 1, 0),
+      segment_from_coords(-1, -1, 1, 1),
+      segment_from_coords(1, -1, 2, 1),
+      segment_from_coords(0, 10, 0, 20),
+      segment_from_coords(0, 11, 0, 20),
+  };
+  bool expected[] = {true, true, false, true, false};
+  SegmentArray arr;
+  segment_array_from_segments(&arr, segments, 5);
+  test_many(query, &arr, expected);
+  segment_array_free(&arr);
+}
+
+// Segments that end within a few ulps of the query's line, on either side of
+// it or exactly on it, where floating point orientations get the sign wrong.
+TEST(SegmentArray, NearlyCollinear) {
+  Segment query = segment_from_coords(12, 12, -24, -24);
+  const unsigned side = 16;
+  Segment segments[side * side];
+  bool expected[side * side];
+  for (unsigned i = 0; i < side; ++i) {
+    for (unsigned j = 0; j < side; ++j) {
+      double x = 0.5 + i * 0x1p-53, y = 0.5 + j * 0x1p-53;
+      // The other endpoint is well below the line y = x
+      segments[i * side + j] = segment_from_coords(x, y, x + 1, y - 1);
+      expected[i * side + j] = j >= i;
+    }
+  }
+  SegmentArray arr;
+  segment_array_from_segments(&arr, segments, side * side);
+  test_many(query, &arr, expected);
+  segment_array_free(&arr);
+}
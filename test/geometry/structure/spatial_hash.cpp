@@ -0,0 +1,193 @@
+#include "geometry/util.h"
+#include "random.h"
+extern "C" {
+#include "geometry/algorithm/segment_intersection.h"
+#include "geometry/structure/spatial_hash.h"
+}
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <set>
+#include <utility>
+#include <vector>
+
+static void collect_id(unsigned id, void *data) {
+  ((std::vector<unsigned> *)data)->push_back(id);
+}
+
+static void collect_pair(unsigned a, unsigned b, void *data) {
+  ((std::vector<std::pair<unsigned, unsigned>> *)data)->push_back({a, b});
+}
+
+static bool segment_in_box(Segment s, Point min, Point max) {
+  // Clip the segment against the box
+  double t0 = 0;
+  double t1 = 1;
+  double d[] = {s.p1.x - s.p0.x, s.p1.y - s.p0.y};
+  double p[] = {s.p0.x, s.p0.y};
+  double lo[] = {min.x, min.y};
+  double hi[] = {max.x, max.y};
+  for (unsigned axis = 0; axis < 2; ++axis) {
+    if (d[axis] == 0) {
+      if (p[axis] < lo[axis] || p[axis] > hi[axis]) {
+        return false;
+      }
+      continue;
+    }
+    double ta = (lo[axis] - p[axis]) / d[axis];
+    double tb = (hi[axis] - p[axis]) / d[axis];
+    t0 = std::max(t0, std::min(ta, tb));
+    t1 = std::min(t1, std::max(ta, tb));
+  }
+  return t0 <= t1;
+}
+
+static std::vector<unsigned> query_box(SpatialHash *hash, Point min,
+                                       Point max) {
+  std::vector<unsigned> ids;
+  unsigned count = spatial_hash_query_box(hash, min, max, collect_id, &ids);
+  EXPECT_EQ(count, ids.size());
+  std::sort(ids.begin(), ids.end());
+  return ids;
+}
+
+TEST(SpatialHash, Points) {
+  SpatialHash hash;
+  spatial_hash_init(&hash, 1);
+  unsigned a = spatial_hash_insert_point(&hash, {0.5, 0.5});
+  unsigned b = spatial_hash_insert_point(&hash, {2.5, 0.5});
+  unsigned c = spatial_hash_insert_point(&hash, {-3, -3});
+  ASSERT_EQ(hash.size, 3);
+
+  ASSERT_EQ(query_box(&hash, {0, 0}, {3, 1}), std::vector<unsigned>({a, b}));
+  ASSERT_EQ(query_box(&hash, {-10, -10}, {10, 10}),
+            std::vector<unsigned>({a, b, c}));
+  ASSERT_EQ(query_box(&hash, {5, 5}, {6, 6}), std::vector<unsigned>());
+
+  std::vector<unsigned> ids;
+  ASSERT_EQ(spatial_hash_query_radius(&hash, {1.5, 0.5}, 1, collect_id, &ids),
+            2);
+
+  ASSERT_TRUE(spatial_hash_delete(&hash, a));
+  ASSERT_FALSE(spatial_hash_delete(&hash, a));
+  ASSERT_EQ(hash.size, 2);
+  ASSERT_EQ(query_box(&hash, {0, 0}, {3, 1}), std::vector<unsigned>({b}));
+
+  // Deleted ids are reused
+  ASSERT_EQ(spatial_hash_insert_point(&hash, {7, 7}), a);
+  spatial_hash_free(&hash);
+}
+
+TEST(SpatialHash, LongSegment) {
+  SpatialHash hash;
+  spatial_hash_init(&hash, 1);
+  // Crosses many cells, including exactly through cell corners
+  unsigned id = spatial_hash_insert_segment(&hash,
+                                            segment_from_coords(0, 0, 10, 10));
+  for (double v = 0.25; v < 10; v += 0.5) {
+    ASSERT_EQ(query_box(&hash, {v - 0.1, v - 0.1}, {v + 0.1, v + 0.1}),
+              std::vector<unsigned>({id}));
+  }
+  ASSERT_EQ(query_box(&hash, {3, 0}, {4, 2}), std::vector<unsigned>());
+  ASSERT_EQ(query_box(&hash, {2, 0}, {4, 2}), std::vector<unsigned>({id}));
+  ASSERT_TRUE(spatial_hash_delete(&hash, id));
+  ASSERT_EQ(hash.occupied.size, 0);
+  spatial_hash_free(&hash);
+}
+
+TEST(SpatialHash, RandomQueries) {
+  srand(0);
+  std::vector<Segment> segments;
+  for (unsigned i = 0; i < 1000; ++i) {
+    segments.push_back(i % 3 == 0
+                           ? segment_from_coords(random_coord(), random_coord(),
+                                                 random_coord(), random_coord())
+                           : random_short_segment(5));
+  }
+  SpatialHash hash;
+  spatial_hash_init(&hash,
+                    spatial_hash_cell_size(segments.data(), segments.size()));
+  for (Segment s : segments) {
+    spatial_hash_insert_segment(&hash, s);
+  }
+  // Delete every fifth segment
+  for (unsigned i = 0; i < segments.size(); i += 5) {
+    ASSERT_TRUE(spatial_hash_delete(&hash, i));
+  }
+
+  for (unsigned q = 0; q < 200; ++q) {
+    Point a = {random_coord(), random_coord()};
+    Point b = {a.x + random_coord() / 4 + 25, a.y + random_coord() / 4 + 25};
+    std::vector<unsigned> expected;
+    for (unsigned i = 0; i < segments.size(); ++i) {
+      if (i % 5 != 0 && segment_in_box(segments[i], a, b)) {
+        expected.push_back(i);
+      }
+    }
+    ASSERT_EQ(query_box(&hash, a, b), expected);
+
+    double radius = fabs(random_coord()) / 5;
+    std::vector<unsigned> ids;
+    spatial_hash_query_radius(&hash, a, radius, collect_id, &ids);
+    std::sort(ids.begin(), ids.end());
+    expected.clear();
+    for (unsigned i = 0; i < segments.size(); ++i) {
+      Segment s = segments[i];
+      double dx = s.p1.x - s.p0.x;
+      double dy = s.p1.y - s.p0.y;
+      double t = ((a.x - s.p0.x) * dx + (a.y - s.p0.y) * dy) /
+                 (dx * dx + dy * dy);
+      t = std::max(0.0, std::min(1.0, t));
+      double ex = s.p0.x + t * dx - a.x;
+      double ey = s.p0.y + t * dy - a.y;
+      if (i % 5 != 0 && ex * ex + ey * ey <= radius * radius) {
+        expected.push_back(i);
+      }
+    }
+    ASSERT_EQ(ids, expected);
+  }
+  spatial_hash_free(&hash);
+}
+
+TEST(SpatialHash, CandidatePairs) {
+  srand(0);
+  std::vector<Segment> segments;
+  for (unsigned i = 0; i < 2000; ++i) {
+    segments.push_back(random_short_segment(5));
+  }
+  SpatialHash hash;
+  spatial_hash_init(&hash,
+                    spatial_hash_cell_size(segments.data(), segments.size()));
+  for (Segment s : segments) {
+    spatial_hash_insert_segment(&hash, s);
+  }
+
+  std::vector<std::pair<unsigned, unsigned>> pairs;
+  unsigned count = spatial_hash_candidate_pairs(&hash, collect_pair, &pairs);
+  ASSERT_EQ(count, pairs.size());
+  std::set<std::pair<unsigned, unsigned>> unique(pairs.begin(), pairs.end());
+  ASSERT_EQ(unique.size(), pairs.size());
+
+  unsigned num_intersections;
+  SegmentIntersection *intersections = segment_intersections(
+      segments.data(), segments.size(), &num_intersections);
+  ASSERT_GT(num_intersections, 0);
+  for (unsigned i = 0; i < num_intersections; ++i) {
+    ASSERT_TRUE(unique.count({intersections[i].a, intersections[i].b}));
+  }
+  free(intersections);
+  spatial_hash_free(&hash);
+}
+
+TEST(SpatialHash, CellSize) {
+  ASSERT_EQ(spatial_hash_cell_size(NULL, 0), 1);
+  Point same[] = {{1, 1}, {1, 1}};
+  ASSERT_GT(spatial_hash_cell_size_points(same, 2), 0);
+  // 10000 points over a 100 by 100 square get cells of side 1
+  std::vector<Point> points;
+  for (unsigned i = 0; i < 10000; ++i) {
+    points.push_back(
+        {(double)(i % 100) * 100 / 99, (double)(i / 100) * 100 / 99});
+  }
+  ASSERT_NEAR(spatial_hash_cell_size_points(points.data(), points.size()), 1,
+              1e-9);
+}
@@ -0,0 +1,162 @@
+#include "geometry/util.h"
+#include "random.h"
+extern "C" {
+#include "geometry/structure/trapezoidal_map.h"
+}
+#include <climits>
+#include <gtest/gtest.h>
+#include <vector>
+
+// The y of the non-vertical segment s at x, which must be in its x range.
+static double y_at(Segment s, double x) {
+  return s.p0.y + (s.p1.y - s.p0.y) * (x - s.p0.x) / (s.p1.x - s.p0.x);
+}
+
+// The segment hit first by a ray from p straight up or down, or UINT_MAX.
+static unsigned brute_force_hit(const std::vector<Segment> &segments, Point p,
+                                bool up) {
+  unsigned best = UINT_MAX;
+  double best_y = up ? INFINITY : -INFINITY;
+  for (unsigned i = 0; i < segments.size(); ++i) {
+    Segment s = segments[i];
+    double lo = std::min(s.p0.x, s.p1.x);
+    double hi = std::max(s.p0.x, s.p1.x);
+    if (s.p0.x == s.p1.x || p.x < lo || p.x > hi) {
+      continue;
+    }
+    double y = y_at(s, p.x);
+    if (up ? y > p.y && y < best_y : y < p.y && y > best_y) {
+      best = i;
+      best_y = y;
+    }
+  }
+  return best;
+}
+
+static void check_locate(const TrapezoidalMap &map,
+                         const std::vector<Segment> &segments,
+                         const std::vector<Point> &queries) {
+  std::vector<unsigned> many(queries.size());
+  for (unsigned threads : {1, 3}) {
+    trapezoidal_map_locate_many(&map, queries.data(), queries.size(),
+                                many.data(), threads);
+    for (unsigned i = 0; i < queries.size(); ++i) {
+      Point p = queries[i];
+      unsigned t = trapezoidal_map_locate(&map, p);
+      ASSERT_EQ(many[i], t);
+      ASSERT_LT(t, map.num_trapezoids);
+      Trapezoid trap = map.trapezoids[t];
+      ASSERT_LE(trap.left.x, p.x);
+      ASSERT_GE(trap.right.x, p.x);
+      ASSERT_EQ(trap.bottom, brute_force_hit(segments, p, false));
+      ASSERT_EQ(trap.top, brute_force_hit(segments, p, true));
+    }
+  }
+}
+
+TEST(TrapezoidalMap, Empty) {
+  TrapezoidalMap map;
+  trapezoidal_map_init(&map, nullptr, 0);
+  ASSERT_EQ(map.num_trapezoids, 1);
+  ASSERT_EQ(trapezoidal_map_locate(&map, {1, 2}), 0);
+  ASSERT_EQ(map.trapezoids[0].top, UINT_MAX);
+  trapezoidal_map_free(&map);
+
+  // A single point adds nothing
+  Segment point = segment_from_coords(1, 1, 1, 1);
+  trapezoidal_map_init(&map, &point, 1);
+  ASSERT_EQ(map.num_trapezoids, 1);
+  trapezoidal_map_free(&map);
+}
+
+TEST(TrapezoidalMap, Segment) {
+  std::vector<Segment> segments = {segment_from_coords(4, 2, 0, 0)};
+  TrapezoidalMap map;
+  trapezoidal_map_init(&map, segments.data(), 1);
+  // Segments are stored left to right
+  ASSERT_EQ(map.segments[0].p0.x, 0);
+  ASSERT_EQ(map.num_trapezoids, 4);
+  unsigned above = trapezoidal_map_locate(&map, {2, 3});
+  unsigned below = trapezoidal_map_locate(&map, {2, 0});
+  ASSERT_NE(above, below);
+  ASSERT_EQ(map.trapezoids[above].bottom, 0);
+  ASSERT_EQ(map.trapezoids[below].top, 0);
+  // Points on the segment are above it
+  ASSERT_EQ(trapezoidal_map_locate(&map, {2, 1}), above);
+  ASSERT_EQ(map.trapezoids[trapezoidal_map_locate(&map, {-1, 0})].right.x, 0);
+  ASSERT_EQ(map.trapezoids[trapezoidal_map_locate(&map, {5, 0})].left.x, 4);
+  trapezoidal_map_free(&map);
+}
+
+TEST(TrapezoidalMap, Random) {
+  srand(0);
+  for (unsigned n : {2, 10, 100, 400}) {
+    // Short random segments, keeping those that miss the ones before
+    std::vector<Segment> segments;
+    while (segments.size() < n) {
+      double x = random_coord(), y = random_coord();
+      Segment s = segment_from_coords(x, y, x + random_coord() / 4,
+                                      y + random_coord() / 4);
+      bool crosses = false;
+      for (Segment t : segments) {
+        crosses |= segment_intersects(s, t);
+      }
+      if (!crosses) {
+        segments.push_back(s);
+      }
+    }
+    TrapezoidalMap map;
+    trapezoidal_map_init(&map, segments.data(), n);
+    ASSERT_EQ(map.num_segments, n);
+    ASSERT_LE(map.num_trapezoids, 3 * n + 1);
+    std::vector<Point> queries;
+    for (unsigned i = 0; i < 1000; ++i) {
+      queries.push_back({random_coord() * 1.2, random_coord() * 1.2});
+    }
+    check_locate(map, segments, queries);
+    trapezoidal_map_free(&map);
+  }
+}
+
+TEST(TrapezoidalMap, SharedEndpoints) {
+  // A triangulated grid, whose vertices are shared by up to six segments and
+  // whose columns of vertical segments share x coordinates
+  srand(1);
+  std::vector<Segment> segments;
+  for (unsigned i = 0; i < 10; ++i) {
+    for (unsigned j = 0; j < 10; ++j) {
+      double x = i, y = j;
+      if (i < 9) {
+        segments.push_back(segment_from_coords(x, y, x + 1, y));
+      }
+      if (j < 9) {
+        segments.push_back(segment_from_coords(x, y + 1, x, y));
+      }
+      if (i < 9 && j < 9) {
+        segments.push_back((i + j) % 2
+                               ? segment_from_coords(x, y, x + 1, y + 1)
+                               : segment_from_coords(x + 1, y, x, y + 1));
+      }
+    }
+  }
+  TrapezoidalMap map;
+  trapezoidal_map_init(&map, segments.data(), segments.size());
+  std::vector<Point> queries;
+  for (unsigned i = 0; i < 2000; ++i) {
+    queries.push_back({(double)rand() / RAND_MAX * 11 - 1,
+                       (double)rand() / RAND_MAX * 11 - 1});
+  }
+  check_locate(map, segments, queries);
+
+  // Vertices are in the trapezoid right of them and above every segment
+  // through them, which is above the vertical segment up from them
+  for (unsigned i = 0; i < 9; ++i) {
+    Point p = {(double)i, 4};
+    Trapezoid trap = map.trapezoids[trapezoidal_map_locate(&map, p)];
+    ASSERT_EQ(trap.left.x, p.x);
+    ASSERT_EQ(trap.left.y, p.y);
+    Segment bottom = map.segments[trap.bottom];
+    ASSERT_TRUE(segment_equals(bottom, segment_from_coords(i, 4, i, 5)));
+  }
+  trapezoidal_map_free(&map);
+}
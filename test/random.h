@@ -0,0 +1,53 @@
+#ifndef TEST_RANDOM_H
+#define TEST_RANDOM_H
+
+// Random inputs shared by the geometry tests. Each test seeds rand() itself,
+// so its inputs stay the same from run to run.
+
+extern "C" {
+#include "geometry/structure/polygon.h"
+#include "geometry/structure/segment.h"
+}
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+static double random_coord() { return (double)rand() / RAND_MAX * 200 - 100; }
+
+// Multiples of 0.1 up to 0.6, which are not representable, so lines through
+// them that would cross at one point only nearly do.
+static double random_decimal_coord() { return rand() % 7 / 10.0; }
+
+// A segment between two random points.
+static Segment random_segment() {
+  return segment_from_coords(random_coord(), random_coord(), random_coord(),
+                             random_coord());
+}
+
+// A segment from a random point, with each coordinate of the other end offset
+// by random_coord() / shrink.
+static Segment random_short_segment(double shrink) {
+  double x = random_coord();
+  double y = random_coord();
+  return segment_from_coords(x, y, x + random_coord() / shrink,
+                             y + random_coord() / shrink);
+}
+
+// A random star shaped polygon around center, with a star shaped hole inside
+// the outer ring's smallest radius.
+static Polygon random_star(Point center, double radius, unsigned n) {
+  std::vector<Point> outer, hole;
+  for (unsigned i = 0; i < n; ++i) {
+    double angle = 2 * M_PI * i / n;
+    double r = radius * (0.5 + (double)rand() / RAND_MAX / 2);
+    outer.push_back({center.x + r * cos(angle), center.y + r * sin(angle)});
+    r = radius * (0.1 + (double)rand() / RAND_MAX * 0.3);
+    hole.push_back({center.x + r * cos(angle), center.y + r * sin(angle)});
+  }
+  Polygon poly;
+  polygon_init(&poly, outer.data(), n);
+  polygon_add_hole(&poly, hole.data(), n);
+  return poly;
+}
+
+#endif